@@ -3,6 +3,7 @@
 uniform sampler2D gColorMap;                                                        
                                                                                     
 in vec2 TexCoord;                                                                   
+in vec4 Color0;
 out vec4 FragColor;                                                                 
                                                                                     
 void main()                                                                         
@@ -12,4 +13,6 @@ void main()
     if (FragColor.r == 1 && FragColor.g == 1 && FragColor.b == 1) {
         discard;                                                                    
     }                                                                               
+
+    FragColor *= Color0;
 }
@@ -6,38 +6,50 @@ layout(max_vertices = 4) out;
                                                                                     
 uniform mat4 gVP;                                                                   
 uniform vec3 gCameraPos;                                                            
+uniform ivec2 gAtlasSize;
+
+in float VSSize[];
+in vec4 VSColor[];
+flat in uint VSAtlasIndex[];
                                                                                     
 out vec2 TexCoord;                                                                  
+out vec4 Color0;
                                                                                     
 void main()                                                                         
 {                                                                                   
     vec3 Pos = gl_in[0].gl_Position.xyz;                                            
     vec3 CameraToPoint = normalize(Pos - gCameraPos);                                    
-    vec3 up = vec3(0.0, 1.0, 0.0);                                                  
-    vec3 right = cross(up, CameraToPoint);                                               
+    vec3 up = vec3(0.0, 1.0, 0.0) * VSSize[0];
+    vec3 right = cross(vec3(0.0, 1.0, 0.0), CameraToPoint) * VSSize[0];
+
+    int Index = int(VSAtlasIndex[0]);
+    vec2 Tile = vec2(Index % gAtlasSize.x, Index / gAtlasSize.x);
+    vec2 TileSize = 1.0 / vec2(gAtlasSize);
+
+    Color0 = VSColor[0];
          
     // bottom left
     gl_Position = gVP * vec4(Pos, 1.0);
-    TexCoord = vec2(0.0, 0.0);                                                      
+    TexCoord = (Tile + vec2(0.0, 0.0)) * TileSize;
     EmitVertex(); 
                   
     // top left
-    Pos.y += 1.0;                                                                   
+    Pos += up;
     gl_Position = gVP * vec4(Pos, 1.0);                                             
-    TexCoord = vec2(0.0, 1.0);                                                      
+    TexCoord = (Tile + vec2(0.0, 1.0)) * TileSize;
     EmitVertex();                                                                   
     
     // bottom right
-    Pos.y -= 1.0;
+    Pos -= up;
     Pos += right;    
     gl_Position = gVP * vec4(Pos, 1.0);
-    TexCoord = vec2(1.0, 0.0);
+    TexCoord = (Tile + vec2(1.0, 0.0)) * TileSize;
     EmitVertex();
 
     // top right
-    Pos.y += 1.0;
+    Pos += up;
     gl_Position = gVP * vec4(Pos, 1.0);
-    TexCoord = vec2(1.0, 1.0);
+    TexCoord = (Tile + vec2(1.0, 1.0)) * TileSize;
     EmitVertex();
                                                                                     
     EndPrimitive();                                                                 
@@ -1,8 +1,18 @@
 #version 330                                                                        
                                                                                     
 layout (location = 0) in vec3 Position;                                             
+layout (location = 1) in float Size;
+layout (location = 2) in vec4 Color;
+layout (location = 3) in uint AtlasIndex;
+
+out float VSSize;
+out vec4 VSColor;
+flat out uint VSAtlasIndex;
                                                                                     
 void main()                                                                         
 {                                                                                   
     gl_Position = vec4(Position, 1.0);                                              
-}                                                                                   
+    VSSize = Size;
+    VSColor = Color;
+    VSAtlasIndex = AtlasIndex;
+}
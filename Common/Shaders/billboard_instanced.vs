@@ -0,0 +1,35 @@
+#version 330
+
+// Per instance - one billboard
+layout (location = 0) in vec3 Position;
+layout (location = 1) in float Size;
+layout (location = 2) in vec4 Color;
+layout (location = 3) in uint AtlasIndex;
+
+uniform mat4 gVP;
+uniform vec3 gCameraPos;
+uniform ivec2 gAtlasSize;
+
+out vec2 TexCoord;
+out vec4 Color0;
+
+// Same quad as billboard.gs without the geometry shader. Drawn as a
+// triangle strip of 4 vertices per instance.
+void main()
+{
+    vec3 CameraToPoint = normalize(Position - gCameraPos);
+    vec3 up = vec3(0.0, 1.0, 0.0);
+    vec3 right = cross(up, CameraToPoint);
+
+    // 0 - bottom left, 1 - top left, 2 - bottom right, 3 - top right
+    vec2 Corner = vec2(float(gl_VertexID >> 1), float(gl_VertexID & 1));
+
+    vec3 Pos = Position + (right * Corner.x + up * Corner.y) * Size;
+    gl_Position = gVP * vec4(Pos, 1.0);
+
+    int Index = int(AtlasIndex);
+    vec2 Tile = vec2(Index % gAtlasSize.x, Index / gAtlasSize.x);
+    TexCoord = (Tile + Corner) / vec2(gAtlasSize);
+
+    Color0 = Color;
+}
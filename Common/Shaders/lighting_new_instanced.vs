@@ -0,0 +1,37 @@
+//
+// Instanced version of lighting_new.vs. The WVP and world matrices are per-instance
+// attributes. Since every instance has its own local space the lighting is done in
+// world space - the renderer provides world space light and camera params in place
+// of the local ones.
+//
+
+#version 330
+
+layout (location = 0) in vec3 Position;
+layout (location = 1) in vec2 TexCoord;
+layout (location = 2) in vec3 Normal;
+layout (location = 3) in mat4 InstanceWVP;
+layout (location = 7) in mat4 InstanceWorld;
+
+uniform vec4 gClipPlane;
+
+out vec2 TexCoord0;
+out vec3 Normal0;
+out vec3 LocalPos0;
+out vec3 WorldPos0;
+out vec4 LightSpacePos0; // shadow mapping is not supported with instancing
+out vec3 EdgeDistance0; // to match lighting_new_to_vs.gs
+
+void main()
+{
+    vec4 Pos4 = vec4(Position, 1.0);
+    gl_Position = InstanceWVP * Pos4;
+    TexCoord0 = TexCoord;
+    Normal0 = (InstanceWorld * vec4(Normal, 0.0)).xyz;   // assumes uniform scaling
+    WorldPos0 = (InstanceWorld * Pos4).xyz;
+    LocalPos0 = WorldPos0;
+    LightSpacePos0 = vec4(0.0, 0.0, 0.0, 1.0);
+    EdgeDistance0 = vec3(-1.0, -1.0, -1.0);   // used only by wireframe_on_mesh.gs
+
+    gl_ClipDistance[0] = dot(vec4(WorldPos0, 1.0), gClipPlane);
+}
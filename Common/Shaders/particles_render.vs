@@ -0,0 +1,28 @@
+#version 430
+
+layout(std430, binding = 0) readonly buffer Positions { vec4 PosAge[]; };
+layout(std430, binding = 3) readonly buffer AliveList { uint AliveSlots[]; };
+
+uniform mat4 gVP;
+uniform vec3 gCameraPos;
+uniform float gBillboardSize;
+
+out vec2 TexCoord;
+
+// One instance per live particle, expanded into a quad from gl_VertexID
+// in the same order as billboard.gs
+void main()
+{
+    vec3 Pos = PosAge[AliveSlots[gl_InstanceID]].xyz;
+    vec3 CameraToPoint = normalize(Pos - gCameraPos);
+    vec3 up = vec3(0.0, 1.0, 0.0);
+    vec3 right = cross(up, CameraToPoint);
+
+    // 0 - bottom left, 1 - top left, 2 - bottom right, 3 - top right
+    vec2 Corner = vec2(float(gl_VertexID >> 1), float(gl_VertexID & 1));
+
+    Pos += (right * Corner.x + up * Corner.y) * gBillboardSize;
+
+    gl_Position = gVP * vec4(Pos, 1.0);
+    TexCoord = Corner;
+}
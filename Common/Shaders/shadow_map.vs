@@ -2,7 +2,10 @@
 
 layout (location = 0) in vec3 Position;
 
-uniform mat4 gWVP;
+// Per draw, from a UniformDrawBuffer (see ShadowMappingTechnique::DrawBlock)
+layout (std140, row_major) uniform DrawBlock {
+    mat4 gWVP;
+};
 
 void main()
 {
@@ -4,8 +4,11 @@ layout (location = 0) in vec3 Position;
 layout (location = 1) in vec2 TexCoord;
 layout (location = 2) in vec3 Normal;
 
-uniform mat4 gWVP;
-uniform mat4 gWorld;
+// Per draw, from a UniformDrawBuffer (see ShadowMappingPointLightTechnique::DrawBlock)
+layout (std140, row_major) uniform DrawBlock {
+    mat4 gWVP;
+    mat4 gWorld;
+};
 
 out vec3 WorldPos;
                   
@@ -25,11 +25,22 @@
 #include <glm/gtx/string_cast.hpp>
 #endif
 #include <iostream>
+#include <atomic>
 #include <stdlib.h>
 
 #include "ogldev_util.h"
 #include "ogldev_math_3d.h"
 
+#ifdef OGLDEV_MATH_SSE
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define OGLDEV_TARGET_AVX
+#else
+#define OGLDEV_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
 
 Vector4f& Vector4f::Normalize()
 {
@@ -305,7 +316,7 @@ float Matrix4f::Determinant() const
 }
 
 
-Matrix4f Matrix4f::Inverse() const
+Matrix4f Matrix4f::InverseReference() const
 {
         // Compute the reciprocal determinant
         float det = Determinant();
@@ -355,6 +366,440 @@ Matrix4f Matrix4f::Inverse() const
 }
 
 
+Matrix4f Matrix4f::InverseAffine() const
+{
+    // The inverse of the upper 3x3 is made of the cross products of its rows
+    Vector3f r0(m[0][0], m[0][1], m[0][2]);
+    Vector3f r1(m[1][0], m[1][1], m[1][2]);
+    Vector3f r2(m[2][0], m[2][1], m[2][2]);
+
+    Vector3f c0 = r1.Cross(r2);
+    Vector3f c1 = r2.Cross(r0);
+    Vector3f c2 = r0.Cross(r1);
+
+    float det = r0.Dot(c0);
+
+    if (det == 0.0f) {
+        assert(0);
+        return *this;
+    }
+
+    float invdet = 1.0f / det;
+
+    Matrix4f res;
+    res.m[0][0] = c0.x * invdet; res.m[0][1] = c1.x * invdet; res.m[0][2] = c2.x * invdet;
+    res.m[1][0] = c0.y * invdet; res.m[1][1] = c1.y * invdet; res.m[1][2] = c2.y * invdet;
+    res.m[2][0] = c0.z * invdet; res.m[2][1] = c1.z * invdet; res.m[2][2] = c2.z * invdet;
+
+    // The translation is the negated original translation in the inverted basis
+    for (int i = 0 ; i < 3 ; i++) {
+        res.m[i][3] = -(res.m[i][0] * m[0][3] + res.m[i][1] * m[1][3] + res.m[i][2] * m[2][3]);
+    }
+
+    res.m[3][0] = 0.0f; res.m[3][1] = 0.0f; res.m[3][2] = 0.0f; res.m[3][3] = 1.0f;
+
+    return res;
+}
+
+
+#ifdef OGLDEV_MATH_SSE
+
+#define SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+// (v[x], v[y], v[z], v[w])
+#define SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, SHUFFLE_MASK(x, y, z, w))
+// (v1[x], v1[y], v2[z], v2[w])
+#define SHUFFLE(v1, v2, x, y, z, w) _mm_shuffle_ps(v1, v2, SHUFFLE_MASK(x, y, z, w))
+
+//
+// The 4x4 matrix is handled as four 2x2 row major blocks | A B |
+//                                                         | C D |
+// with each block in a single register.
+//
+
+// A * B
+static inline __m128 Mat2Mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, SWIZZLE(b, 0, 3, 0, 3)),
+                      _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adj(A) * B
+static inline __m128 Mat2AdjMul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 3, 3, 0, 0), b),
+                      _mm_mul_ps(SWIZZLE(a, 1, 1, 2, 2), SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// A * adj(B)
+static inline __m128 Mat2MulAdj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, SWIZZLE(b, 3, 0, 3, 0)),
+                      _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+
+static Matrix4f InverseSSE(const Matrix4f& Mat)
+{
+    __m128 Row0 = _mm_loadu_ps(Mat.m[0]);
+    __m128 Row1 = _mm_loadu_ps(Mat.m[1]);
+    __m128 Row2 = _mm_loadu_ps(Mat.m[2]);
+    __m128 Row3 = _mm_loadu_ps(Mat.m[3]);
+
+    __m128 A = _mm_movelh_ps(Row0, Row1);
+    __m128 B = _mm_movehl_ps(Row1, Row0);
+    __m128 C = _mm_movelh_ps(Row2, Row3);
+    __m128 D = _mm_movehl_ps(Row3, Row2);
+
+    // (|A|, |B|, |C|, |D|)
+    __m128 DetSub = _mm_sub_ps(_mm_mul_ps(SHUFFLE(Row0, Row2, 0, 2, 0, 2), SHUFFLE(Row1, Row3, 1, 3, 1, 3)),
+                               _mm_mul_ps(SHUFFLE(Row0, Row2, 1, 3, 1, 3), SHUFFLE(Row1, Row3, 0, 2, 0, 2)));
+
+    __m128 DetA = SWIZZLE(DetSub, 0, 0, 0, 0);
+    __m128 DetB = SWIZZLE(DetSub, 1, 1, 1, 1);
+    __m128 DetC = SWIZZLE(DetSub, 2, 2, 2, 2);
+    __m128 DetD = SWIZZLE(DetSub, 3, 3, 3, 3);
+
+    __m128 D_C = Mat2AdjMul(D, C);
+    __m128 A_B = Mat2AdjMul(A, B);
+
+    // Adjugates of the four blocks of the inverse
+    __m128 X = _mm_sub_ps(_mm_mul_ps(DetD, A), Mat2Mul(B, D_C));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(DetA, D), Mat2Mul(C, A_B));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(DetB, C), Mat2MulAdj(D, A_B));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(DetC, B), Mat2MulAdj(A, D_C));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B * adj(D)C)
+    __m128 Tr = _mm_mul_ps(A_B, SWIZZLE(D_C, 0, 2, 1, 3));
+    Tr = _mm_add_ps(Tr, SWIZZLE(Tr, 2, 3, 0, 1));
+    Tr = _mm_add_ps(Tr, SWIZZLE(Tr, 1, 0, 3, 2));
+
+    __m128 DetM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(DetA, DetD), _mm_mul_ps(DetB, DetC)), Tr);
+
+    if (_mm_cvtss_f32(DetM) == 0.0f) {
+        assert(0);
+        return Mat;
+    }
+
+    __m128 RcpDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), DetM);
+
+    X = _mm_mul_ps(X, RcpDetM);
+    Y = _mm_mul_ps(Y, RcpDetM);
+    Z = _mm_mul_ps(Z, RcpDetM);
+    W = _mm_mul_ps(W, RcpDetM);
+
+    // Applies the final adjugate shuffle while storing
+    Matrix4f Res;
+    _mm_storeu_ps(Res.m[0], SHUFFLE(X, Y, 3, 1, 3, 1));
+    _mm_storeu_ps(Res.m[1], SHUFFLE(X, Y, 2, 0, 2, 0));
+    _mm_storeu_ps(Res.m[2], SHUFFLE(Z, W, 3, 1, 3, 1));
+    _mm_storeu_ps(Res.m[3], SHUFFLE(Z, W, 2, 0, 2, 0));
+
+    return Res;
+}
+
+
+static void MatrixMulBatchSSE(const Matrix4f& Left, const Matrix4f* pRight, Matrix4f* pOut, int Count)
+{
+    // The broadcast elements of the left matrix are the same for the whole batch
+    __m128 L[4][4];
+
+    for (int r = 0 ; r < 4 ; r++) {
+        __m128 Row = _mm_loadu_ps(Left.m[r]);
+        L[r][0] = SWIZZLE(Row, 0, 0, 0, 0);
+        L[r][1] = SWIZZLE(Row, 1, 1, 1, 1);
+        L[r][2] = SWIZZLE(Row, 2, 2, 2, 2);
+        L[r][3] = SWIZZLE(Row, 3, 3, 3, 3);
+    }
+
+    for (int i = 0 ; i < Count ; i++) {
+        __m128 R0 = _mm_loadu_ps(pRight[i].m[0]);
+        __m128 R1 = _mm_loadu_ps(pRight[i].m[1]);
+        __m128 R2 = _mm_loadu_ps(pRight[i].m[2]);
+        __m128 R3 = _mm_loadu_ps(pRight[i].m[3]);
+
+        for (int r = 0 ; r < 4 ; r++) {
+            __m128 Res = _mm_add_ps(_mm_add_ps(_mm_mul_ps(L[r][0], R0), _mm_mul_ps(L[r][1], R1)),
+                                    _mm_add_ps(_mm_mul_ps(L[r][2], R2), _mm_mul_ps(L[r][3], R3)));
+            _mm_storeu_ps(pOut[i].m[r], Res);
+        }
+    }
+}
+
+
+static void TransformVectorsSSE(const Matrix4f& m, const Vector4f* pIn, Vector4f* pOut, int Count)
+{
+    Matrix4f t = m.Transpose();
+
+    __m128 Col0 = _mm_loadu_ps(t.m[0]);
+    __m128 Col1 = _mm_loadu_ps(t.m[1]);
+    __m128 Col2 = _mm_loadu_ps(t.m[2]);
+    __m128 Col3 = _mm_loadu_ps(t.m[3]);
+
+    for (int i = 0 ; i < Count ; i++) {
+        __m128 v = _mm_loadu_ps(&pIn[i].x);
+        __m128 Res = _mm_mul_ps(SWIZZLE(v, 0, 0, 0, 0), Col0);
+        Res = _mm_add_ps(Res, _mm_mul_ps(SWIZZLE(v, 1, 1, 1, 1), Col1));
+        Res = _mm_add_ps(Res, _mm_mul_ps(SWIZZLE(v, 2, 2, 2, 2), Col2));
+        Res = _mm_add_ps(Res, _mm_mul_ps(SWIZZLE(v, 3, 3, 3, 3), Col3));
+        _mm_storeu_ps(&pOut[i].x, Res);
+    }
+}
+
+
+OGLDEV_TARGET_AVX
+static void MatrixMulBatchAVX(const Matrix4f& Left, const Matrix4f* pRight, Matrix4f* pOut, int Count)
+{
+    // Two rows of the left matrix per register, each element broadcast within its lane
+    __m256 L01 = _mm256_loadu_ps(Left.m[0]);
+    __m256 L23 = _mm256_loadu_ps(Left.m[2]);
+
+    __m256 L01_0 = _mm256_permute_ps(L01, 0x00);
+    __m256 L01_1 = _mm256_permute_ps(L01, 0x55);
+    __m256 L01_2 = _mm256_permute_ps(L01, 0xAA);
+    __m256 L01_3 = _mm256_permute_ps(L01, 0xFF);
+    __m256 L23_0 = _mm256_permute_ps(L23, 0x00);
+    __m256 L23_1 = _mm256_permute_ps(L23, 0x55);
+    __m256 L23_2 = _mm256_permute_ps(L23, 0xAA);
+    __m256 L23_3 = _mm256_permute_ps(L23, 0xFF);
+
+    for (int i = 0 ; i < Count ; i++) {
+        __m256 R0 = _mm256_broadcast_ps((const __m128*)pRight[i].m[0]);
+        __m256 R1 = _mm256_broadcast_ps((const __m128*)pRight[i].m[1]);
+        __m256 R2 = _mm256_broadcast_ps((const __m128*)pRight[i].m[2]);
+        __m256 R3 = _mm256_broadcast_ps((const __m128*)pRight[i].m[3]);
+
+        __m256 Out01 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(L01_0, R0), _mm256_mul_ps(L01_1, R1)),
+                                     _mm256_add_ps(_mm256_mul_ps(L01_2, R2), _mm256_mul_ps(L01_3, R3)));
+        __m256 Out23 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(L23_0, R0), _mm256_mul_ps(L23_1, R1)),
+                                     _mm256_add_ps(_mm256_mul_ps(L23_2, R2), _mm256_mul_ps(L23_3, R3)));
+
+        _mm256_storeu_ps(pOut[i].m[0], Out01);
+        _mm256_storeu_ps(pOut[i].m[2], Out23);
+    }
+}
+
+
+OGLDEV_TARGET_AVX
+static void TransformVectorsAVX(const Matrix4f& m, const Vector4f* pIn, Vector4f* pOut, int Count)
+{
+    Matrix4f t = m.Transpose();
+
+    __m256 Col0 = _mm256_broadcast_ps((const __m128*)t.m[0]);
+    __m256 Col1 = _mm256_broadcast_ps((const __m128*)t.m[1]);
+    __m256 Col2 = _mm256_broadcast_ps((const __m128*)t.m[2]);
+    __m256 Col3 = _mm256_broadcast_ps((const __m128*)t.m[3]);
+
+    int i = 0;
+
+    // Two vectors per iteration
+    for ( ; i + 1 < Count ; i += 2) {
+        __m256 v = _mm256_loadu_ps(&pIn[i].x);
+        __m256 Res = _mm256_mul_ps(_mm256_permute_ps(v, 0x00), Col0);
+        Res = _mm256_add_ps(Res, _mm256_mul_ps(_mm256_permute_ps(v, 0x55), Col1));
+        Res = _mm256_add_ps(Res, _mm256_mul_ps(_mm256_permute_ps(v, 0xAA), Col2));
+        Res = _mm256_add_ps(Res, _mm256_mul_ps(_mm256_permute_ps(v, 0xFF), Col3));
+        _mm256_storeu_ps(&pOut[i].x, Res);
+    }
+
+    if (i < Count) {
+        TransformVectorsSSE(m, pIn + i, pOut + i, Count - i);
+    }
+}
+
+
+static bool CpuSupportsAVX()
+{
+#ifdef _MSC_VER
+    int Info[4];
+    __cpuid(Info, 1);
+
+    bool HasOSXSave = (Info[2] & (1 << 27)) != 0;
+    bool HasAVX = (Info[2] & (1 << 28)) != 0;
+
+    if (!HasOSXSave || !HasAVX) {
+        return false;
+    }
+
+    // Make sure the OS saves the YMM registers
+    unsigned long long XCR0 = _xgetbv(0);
+    return (XCR0 & 0x6) == 0x6;
+#else
+    return __builtin_cpu_supports("avx");
+#endif
+}
+
+#endif  // OGLDEV_MATH_SSE
+
+
+bool IsMathBackendSupported(MATH_BACKEND Backend)
+{
+    switch (Backend) {
+    case MATH_BACKEND_SCALAR:
+        return true;
+
+#if defined(OGLDEV_MATH_SSE)
+    case MATH_BACKEND_SSE:
+        return true;
+
+    case MATH_BACKEND_AVX:
+        return CpuSupportsAVX();
+#elif defined(OGLDEV_MATH_NEON)
+    case MATH_BACKEND_NEON:
+        return true;
+#endif
+
+    default:
+        return false;
+    }
+}
+
+
+static MATH_BACKEND DetectMathBackend()
+{
+    if (IsMathBackendSupported(MATH_BACKEND_AVX)) {
+        return MATH_BACKEND_AVX;
+    }
+
+    if (IsMathBackendSupported(MATH_BACKEND_SSE)) {
+        return MATH_BACKEND_SSE;
+    }
+
+    if (IsMathBackendSupported(MATH_BACKEND_NEON)) {
+        return MATH_BACKEND_NEON;
+    }
+
+    return MATH_BACKEND_SCALAR;
+}
+
+
+// Atomic because the JobSystem/ParallelFor workers read it while another
+// thread may switch it. Relaxed is enough - the backends agree up to
+// rounding so a worker may finish its batch with the previous one.
+static std::atomic<MATH_BACKEND>& CurMathBackend()
+{
+    static std::atomic<MATH_BACKEND> Backend(DetectMathBackend());
+    return Backend;
+}
+
+
+MATH_BACKEND GetMathBackend()
+{
+    return CurMathBackend().load(std::memory_order_relaxed);
+}
+
+
+bool SetMathBackend(MATH_BACKEND Backend)
+{
+    if (!IsMathBackendSupported(Backend)) {
+        return false;
+    }
+
+    CurMathBackend().store(Backend, std::memory_order_relaxed);
+
+    return true;
+}
+
+
+const char* GetMathBackendName(MATH_BACKEND Backend)
+{
+    switch (Backend) {
+    case MATH_BACKEND_SCALAR:
+        return "Scalar";
+    case MATH_BACKEND_SSE:
+        return "SSE";
+    case MATH_BACKEND_AVX:
+        return "AVX";
+    case MATH_BACKEND_NEON:
+        return "NEON";
+    default:
+        return "Unknown";
+    }
+}
+
+
+MATH_BACKEND GetInverseBackend(MATH_BACKEND Backend)
+{
+    switch (Backend) {
+#ifdef OGLDEV_MATH_SSE
+    case MATH_BACKEND_SSE:
+    case MATH_BACKEND_AVX:
+        return MATH_BACKEND_SSE;
+#endif
+
+    default:
+        return MATH_BACKEND_SCALAR;
+    }
+}
+
+
+Matrix4f Matrix4f::Inverse() const
+{
+#ifdef OGLDEV_MATH_SSE
+    if (GetInverseBackend(GetMathBackend()) == MATH_BACKEND_SSE) {
+        return InverseSSE(*this);
+    }
+#endif
+
+    return InverseReference();
+}
+
+
+void MatrixMulBatch(const Matrix4f& Left, const Matrix4f* pRight, Matrix4f* pOut, int Count)
+{
+    switch (GetMathBackend()) {
+#if defined(OGLDEV_MATH_SSE)
+    case MATH_BACKEND_AVX:
+        MatrixMulBatchAVX(Left, pRight, pOut, Count);
+        break;
+
+    case MATH_BACKEND_SSE:
+        MatrixMulBatchSSE(Left, pRight, pOut, Count);
+        break;
+#elif defined(OGLDEV_MATH_NEON)
+    case MATH_BACKEND_NEON:
+        for (int i = 0 ; i < Count ; i++) {
+            MatrixMulSIMD(&Left.m[0][0], &pRight[i].m[0][0], &pOut[i].m[0][0]);
+        }
+        break;
+#endif
+
+    default:
+        for (int i = 0 ; i < Count ; i++) {
+            pOut[i] = Left.MulReference(pRight[i]);
+        }
+        break;
+    }
+}
+
+
+void TransformVectors(const Matrix4f& m, const Vector4f* pIn, Vector4f* pOut, int Count)
+{
+    switch (GetMathBackend()) {
+#if defined(OGLDEV_MATH_SSE)
+    case MATH_BACKEND_AVX:
+        TransformVectorsAVX(m, pIn, pOut, Count);
+        break;
+
+    case MATH_BACKEND_SSE:
+        TransformVectorsSSE(m, pIn, pOut, Count);
+        break;
+#elif defined(OGLDEV_MATH_NEON)
+    case MATH_BACKEND_NEON:
+        for (int i = 0 ; i < Count ; i++) {
+            MatrixMulVec4SIMD(&m.m[0][0], &pIn[i].x, &pOut[i].x);
+        }
+        break;
+#endif
+
+    default:
+        for (int i = 0 ; i < Count ; i++) {
+            pOut[i] = m.MulReference(pIn[i]);
+        }
+        break;
+    }
+}
+
+
 void Matrix4f::CalcClipPlanes(Vector4f& l, Vector4f& r, Vector4f& b, Vector4f& t, Vector4f& n, Vector4f& f) const
 {
     Vector4f Row1(m[0][0], m[0][1], m[0][2], m[0][3]);
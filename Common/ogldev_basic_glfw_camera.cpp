@@ -16,6 +16,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <atomic>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
@@ -25,6 +26,11 @@
 static int MARGIN = 40;
 static float EDGE_STEP = 0.5f;
 
+// Shared by all cameras so a generation value identifies a single camera state,
+// even after a camera has been copied over another one. Atomic because cameras
+// may be changed from several threads.
+static std::atomic<uint> gCameraGeneration(0);
+
 BasicCamera::BasicCamera(int WindowWidth, int WindowHeight)
 {
     m_windowWidth  = WindowWidth;
@@ -122,6 +128,14 @@ void BasicCamera::InitInternal()
     m_OnRightEdge = false;
     m_mousePos.x  = m_windowWidth / 2;
     m_mousePos.y  = m_windowHeight / 2;
+
+    OnChange();
+}
+
+
+void BasicCamera::OnChange()
+{
+    m_generation = ++gCameraGeneration;
 }
 
 
@@ -131,6 +145,8 @@ void BasicCamera::SetPosition(float x, float y, float z)
     m_pos.x = x;
     m_pos.y = y;
     m_pos.z = z;
+
+    OnChange();
 }
 
 
@@ -145,6 +161,8 @@ void BasicCamera::SetTarget(float x, float y, float z)
     m_target.x = x;
     m_target.y = y;
     m_target.z = z;
+
+    OnChange();
 }
 
 
@@ -240,6 +258,7 @@ bool BasicCamera::OnKeyboard(int Key)
     }
 
     if (CameraChangedPos) {
+        OnChange();
         //        printf("Camera pos: "); m_pos.Print(); printf("\n");
     }
 
@@ -334,26 +353,38 @@ void BasicCamera::Update()
 
     m_up = m_target.Cross(U);
     m_up.Normalize();
+
+    OnChange();
 }
 
 
 
 Matrix4f BasicCamera::GetMatrix() const
 {
-    Matrix4f CameraTransformation;
-    CameraTransformation.InitCameraTransform(m_pos, m_target, m_up);
+    if (m_viewGeneration != m_generation) {
+        UpdateViewProj();
+    }
 
-    return CameraTransformation;
+    return m_view;
 }
 
 
 
-Matrix4f BasicCamera::GetViewProjMatrix() const
+const Matrix4f& BasicCamera::GetViewProjMatrix() const
+{
+    if (m_viewGeneration != m_generation) {
+        UpdateViewProj();
+    }
+
+    return m_viewProj;
+}
+
+
+void BasicCamera::UpdateViewProj() const
 {
-    Matrix4f View = GetMatrix();
-    Matrix4f Projection = GetProjectionMat();
-    Matrix4f ViewProj = Projection * View;
-    return ViewProj;
+    m_view.InitCameraTransform(m_pos, m_target, m_up);
+    m_viewProj = m_projection * m_view;
+    m_viewGeneration = m_generation;
 }
 
 
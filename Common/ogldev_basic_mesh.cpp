@@ -26,6 +26,8 @@ using namespace std;
 #define POSITION_LOCATION  0
 #define TEX_COORD_LOCATION 1
 #define NORMAL_LOCATION    2
+#define INSTANCE_WVP_LOCATION   3   // used only by RenderInstanced
+#define INSTANCE_WORLD_LOCATION 7   // used only by RenderInstanced
 
 
 BasicMesh::~BasicMesh()
@@ -633,6 +635,66 @@ void BasicMesh::Render(unsigned int NumInstances, const Matrix4f* WVPMats, const
 }
 
 
+static void SetInstanceMatrixAttrib(GLuint Location, GLintptr Offset)
+{
+    for (uint i = 0 ; i < 4 ; i++) {
+        glEnableVertexAttribArray(Location + i);
+        glVertexAttribPointer(Location + i, 4, GL_FLOAT, GL_FALSE, sizeof(BasicMesh::InstanceData),
+                              (const void*)(Offset + i * sizeof(Vector4f)));
+        glVertexAttribDivisor(Location + i, 1);
+    }
+}
+
+
+// The VAO is shared with Render() which must not see the instance attributes
+static void ResetInstanceMatrixAttrib(GLuint Location)
+{
+    for (uint i = 0 ; i < 4 ; i++) {
+        glDisableVertexAttribArray(Location + i);
+        glVertexAttribDivisor(Location + i, 0);
+    }
+}
+
+
+void BasicMesh::RenderInstanced(uint NumInstances, GLuint InstanceBuffer, GLintptr BaseOffset)
+{
+    glBindVertexArray(m_VAO);
+
+    // The instance buffer is usually a streaming buffer so the offset changes every frame
+    glBindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+    SetInstanceMatrixAttrib(INSTANCE_WVP_LOCATION, BaseOffset + offsetof(InstanceData, WVP));
+    SetInstanceMatrixAttrib(INSTANCE_WORLD_LOCATION, BaseOffset + offsetof(InstanceData, World));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    for (unsigned int i = 0 ; i < m_Meshes.size() ; i++) {
+        const unsigned int MaterialIndex = m_Meshes[i].MaterialIndex;
+
+        assert(MaterialIndex < m_Materials.size());
+
+        if (m_Materials[MaterialIndex].pDiffuse) {
+            m_Materials[MaterialIndex].pDiffuse->Bind(COLOR_TEXTURE_UNIT);
+        }
+
+        if (m_Materials[MaterialIndex].pSpecularExponent) {
+            m_Materials[MaterialIndex].pSpecularExponent->Bind(SPECULAR_EXPONENT_UNIT);
+        }
+
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES,
+                                          m_Meshes[i].NumIndices,
+                                          GL_UNSIGNED_INT,
+                                          (void*)(sizeof(unsigned int) * m_Meshes[i].BaseIndex),
+                                          NumInstances,
+                                          m_Meshes[i].BaseVertex);
+    }
+
+    ResetInstanceMatrixAttrib(INSTANCE_WVP_LOCATION);
+    ResetInstanceMatrixAttrib(INSTANCE_WORLD_LOCATION);
+
+    // Make sure the VAO is not changed from the outside
+    glBindVertexArray(0);
+}
+
+
 const Material& BasicMesh::GetMaterial()
 {
     for (unsigned int i = 0 ; i < m_Materials.size() ; i++) {
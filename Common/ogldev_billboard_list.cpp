@@ -16,10 +16,32 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <math.h>
+#include <stddef.h>
+
 #include "ogldev_util.h"
 #include "ogldev_engine_common.h"
+#include "ogldev_gl_state.h"
+#include "ogldev_radix_sort.h"
 #include "ogldev_billboard_list.h"
 
+// Below this a chunk is not worth a job
+#define BILLBOARD_MIN_CHUNK_SIZE 4096
+
+// The quad spans [0, Size] along right and up from the position
+#define BILLBOARD_RADIUS_FACTOR 1.4142136f
+
+
+static u32 PackColor(const Vector4f& Color)
+{
+    u32 r = (u32)(std::min(std::max(Color.x, 0.0f), 1.0f) * 255.0f + 0.5f);
+    u32 g = (u32)(std::min(std::max(Color.y, 0.0f), 1.0f) * 255.0f + 0.5f);
+    u32 b = (u32)(std::min(std::max(Color.z, 0.0f), 1.0f) * 255.0f + 0.5f);
+    u32 a = (u32)(std::min(std::max(Color.w, 0.0f), 1.0f) * 255.0f + 0.5f);
+
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
 
 BillboardList::BillboardList()
 {
@@ -31,65 +53,331 @@ BillboardList::BillboardList()
 BillboardList::~BillboardList()
 {
     SAFE_DELETE(m_pTexture);
+
+    for (int i = 0 ; i < BILLBOARD_LIST_NUM_REGIONS ; i++) {
+        if (m_fences[i]) {
+            glDeleteSync(m_fences[i]);
+        }
+    }
     
+    // Deleting the buffer also removes the persistent mapping
     if (m_VB != INVALID_OGL_VALUE) {
         glDeleteBuffers(1, &m_VB);
     }
 
-    if (m_vao != INVALID_OGL_VALUE) {
-        glDeleteVertexArrays(1, &m_vao);
+    if (m_pointsVAO != INVALID_OGL_VALUE) {
+        glDeleteVertexArrays(1, &m_pointsVAO);
+    }
+
+    if (m_instancedVAO != INVALID_OGL_VALUE) {
+        glDeleteVertexArrays(1, &m_instancedVAO);
     }
 }
     
     
 bool BillboardList::Init(const std::string& TexFilename, const std::vector<Vector3f>& Positions)
 {
+    if (!Init(TexFilename, (int)Positions.size())) {
+        return false;
+    }
+
+    m_billboards.resize(Positions.size());
+
+    for (uint i = 0 ; i < Positions.size() ; i++) {
+        m_billboards[i].Pos = Positions[i];
+    }
+
+    return true;
+}
+
+
+bool BillboardList::Init(const std::string& TexFilename, int MaxBillboards, int AtlasCols, int AtlasRows)
+{
+    m_maxBillboards = MaxBillboards;
+    m_atlasCols = AtlasCols;
+    m_atlasRows = AtlasRows;
+
     m_pTexture = new Texture(GL_TEXTURE_2D, TexFilename.c_str());
         
     if (!m_pTexture->Load()) {
         return false;
     }
 
-    CreatePositionBuffer(Positions);
+    CreateBuffers();
     
     if (!m_technique.Init()) {
         return false;
     }
 
+    m_technique.Enable();
     m_technique.SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+    m_technique.SetAtlasSize(AtlasCols, AtlasRows);
+
+    if (!m_instancedTechnique.Init()) {
+        return false;
+    }
+
+    m_instancedTechnique.Enable();
+    m_instancedTechnique.SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+    m_instancedTechnique.SetAtlasSize(AtlasCols, AtlasRows);
     
     return true;
 }
 
 
-void BillboardList::CreatePositionBuffer(const std::vector<Vector3f>& Positions)
+void BillboardList::CreateBuffers()
 {    
-    m_numPoints = (int)Positions.size();
+    glGenBuffers(1, &m_VB);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VB);
 
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
+    GLsizeiptr RegionSize = sizeof(BillboardInstance) * std::max(m_maxBillboards, 1);
 
-    glGenBuffers(1, &m_VB);
-  	glBindBuffer(GL_ARRAY_BUFFER, m_VB);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(Positions[0]) * Positions.size(), &Positions[0], GL_STATIC_DRAW);
+    // Base instance is needed to draw from the region of the current frame
+    if (GLEW_ARB_buffer_storage && GLEW_ARB_base_instance) {
+        GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, RegionSize * BILLBOARD_LIST_NUM_REGIONS, NULL, Flags);
+        m_pMappedVB = (BillboardInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, RegionSize * BILLBOARD_LIST_NUM_REGIONS, Flags);
+    }
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);   // position
+    if (!m_pMappedVB) {
+        glBufferData(GL_ARRAY_BUFFER, RegionSize, NULL, GL_STREAM_DRAW);
+    }
+
+    glGenVertexArrays(1, &m_pointsVAO);
+    SetupVertexAttribs(m_pointsVAO, 0);
+
+    glGenVertexArrays(1, &m_instancedVAO);
+    SetupVertexAttribs(m_instancedVAO, 1);
 
-    glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 
+void BillboardList::SetupVertexAttribs(GLuint VAO, GLuint Divisor)
+{
+    GLState::BindVertexArray(VAO);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BillboardInstance), (const void*)offsetof(BillboardInstance, Pos));
+    glVertexAttribDivisor(0, Divisor);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(BillboardInstance), (const void*)offsetof(BillboardInstance, Size));
+    glVertexAttribDivisor(1, Divisor);
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BillboardInstance), (const void*)offsetof(BillboardInstance, Color));
+    glVertexAttribDivisor(2, Divisor);
+
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(BillboardInstance), (const void*)offsetof(BillboardInstance, AtlasIndex));
+    glVertexAttribDivisor(3, Divisor);
+
+    GLState::BindVertexArray(0);
+}
+
+
+void BillboardList::SetBillboards(const std::vector<Billboard>& Billboards)
+{
+    if ((int)Billboards.size() > m_maxBillboards) {
+        // The regions of the streaming buffer only have room for m_maxBillboards
+        OGLDEV_ERROR("Too many billboards - %d (max %d)\n", (int)Billboards.size(), m_maxBillboards);
+        m_billboards.assign(Billboards.begin(), Billboards.begin() + m_maxBillboards);
+    } else {
+        m_billboards = Billboards;
+    }
+
+    m_isDirty = true;
+}
+
+
+void BillboardList::UpdateBillboard(int Index, const Billboard& b)
+{
+    m_billboards[Index] = b;
+    m_isDirty = true;
+}
+
+
+void BillboardList::CullAndSort(const Matrix4f& VP)
+{
+    int Count = (int)m_billboards.size();
+
+    // All the planes face inwards and are normalized so that the
+    // distance can be compared against the radius
+    Vector4f Planes[6];
+    VP.CalcClipPlanes(Planes[0], Planes[1], Planes[2], Planes[3], Planes[4], Planes[5]);
+
+    for (int i = 0 ; i < 6 ; i++) {
+        float Sign = (i & 1) ? -1.0f : 1.0f;       // right, top and far point outwards
+        float Length = sqrtf(Planes[i].x * Planes[i].x + Planes[i].y * Planes[i].y + Planes[i].z * Planes[i].z);
+        float Scale = (Length > 0.0f) ? Sign / Length : Sign;
+        Planes[i] = Vector4f(Planes[i].x * Scale, Planes[i].y * Scale, Planes[i].z * Scale, Planes[i].w * Scale);
+    }
+
+    // Clip space w is the view space depth
+    Vector4f DepthRow(VP.m[3][0], VP.m[3][1], VP.m[3][2], VP.m[3][3]);
+
+    // The chunks are concatenated in order so the visible list keeps the order
+    // of m_billboards for any number of chunks
+    int NumChunks = std::max(1, std::min(m_jobs.GetNumThreads(), Count / BILLBOARD_MIN_CHUNK_SIZE));
+    int ChunkSize = (Count + NumChunks - 1) / NumChunks;
+
+    m_chunkVisible.resize(NumChunks);
+    m_chunkKeys.resize(NumChunks);
+
+    m_jobs.Dispatch(NumChunks, [&](int Chunk, int) {
+        std::vector<u32>& Visible = m_chunkVisible[Chunk];
+        std::vector<u32>& Keys = m_chunkKeys[Chunk];
+        Visible.clear();
+        Keys.clear();
+
+        int End = std::min((Chunk + 1) * ChunkSize, Count);
+
+        for (int i = Chunk * ChunkSize ; i < End ; i++) {
+            const Billboard& b = m_billboards[i];
+            Vector4f Pos(b.Pos, 1.0f);
+
+            if (m_isCullingEnabled) {
+                float MinDist = -b.Size * BILLBOARD_RADIUS_FACTOR;
+                bool Inside = true;
+
+                for (int p = 0 ; (p < 6) && Inside ; p++) {
+                    Inside = Planes[p].Dot(Pos) >= MinDist;
+                }
+
+                if (!Inside) {
+                    continue;
+                }
+            }
+
+            Visible.push_back((u32)i);
+
+            if (m_isSortingEnabled) {
+                // Descending depth - back to front
+                Keys.push_back(~FloatToSortableKey(DepthRow.Dot(Pos)));
+            }
+        }
+    });
+
+    m_visible.clear();
+    m_sortKeys.clear();
+
+    for (int c = 0 ; c < NumChunks ; c++) {
+        m_visible.insert(m_visible.end(), m_chunkVisible[c].begin(), m_chunkVisible[c].end());
+        m_sortKeys.insert(m_sortKeys.end(), m_chunkKeys[c].begin(), m_chunkKeys[c].end());
+    }
+
+    if (m_isSortingEnabled) {
+        ParallelRadixSort(m_jobs, m_sortKeys, m_visible, m_tempKeys, m_tempVisible);
+    }
+}
+
+
+void BillboardList::Upload(const Matrix4f& VP)
+{
+    if (m_isCullingEnabled || m_isSortingEnabled) {
+        CullAndSort(VP);
+    } else {
+        m_visible.resize(m_billboards.size());
+
+        for (uint i = 0 ; i < m_visible.size() ; i++) {
+            m_visible[i] = i;
+        }
+    }
+
+    m_numVisible = (int)m_visible.size();
+
+    BillboardInstance* pDst = NULL;
+
+    if (m_pMappedVB) {
+        m_currRegion = (m_currRegion + 1) % BILLBOARD_LIST_NUM_REGIONS;
+
+        // Wait until the GPU is done with the draw that used this region
+        GLsync& Fence = m_fences[m_currRegion];
+
+        if (Fence) {
+            while (glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(Fence);
+            Fence = NULL;
+        }
+
+        m_firstInstance = m_currRegion * m_maxBillboards;
+        pDst = m_pMappedVB + m_firstInstance;
+    } else {
+        m_uploadBuffer.resize(m_numVisible);
+        m_firstInstance = 0;
+        pDst = m_uploadBuffer.data();
+    }
+
+    int NumChunks = std::max(1, std::min(m_jobs.GetNumThreads(), m_numVisible / BILLBOARD_MIN_CHUNK_SIZE));
+    int ChunkSize = (m_numVisible + NumChunks - 1) / NumChunks;
+
+    m_jobs.Dispatch(NumChunks, [&](int Chunk, int) {
+        int End = std::min((Chunk + 1) * ChunkSize, m_numVisible);
+
+        for (int i = Chunk * ChunkSize ; i < End ; i++) {
+            const Billboard& b = m_billboards[m_visible[i]];
+            pDst[i].Pos = b.Pos;
+            pDst[i].Size = b.Size;
+            pDst[i].Color = PackColor(b.Color);
+            pDst[i].AtlasIndex = b.AtlasIndex;
+        }
+    });
+
+    if (!m_pMappedVB && (m_numVisible > 0)) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_VB);
+        // Orphan the previous contents so that we don't wait for the GPU
+        glBufferData(GL_ARRAY_BUFFER, sizeof(BillboardInstance) * std::max(m_maxBillboards, 1), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(BillboardInstance) * m_numVisible, pDst);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    m_isDirty = false;
+}
+
+
 void BillboardList::Render(const Matrix4f& VP, const Vector3f& CameraPos)
 {
-    m_technique.Enable();
-    m_technique.SetVP(VP);
-    m_technique.SetCameraPosition(CameraPos);
+    // A static list without culling and sorting is uploaded only once
+    if (m_isDirty || m_isCullingEnabled || m_isSortingEnabled) {
+        Upload(VP);
+    }
+
+    if (m_numVisible == 0) {
+        return;
+    }
+
+    BillboardTechnique* pTech = m_useGeometryShader ? &m_technique : &m_instancedTechnique;
+
+    pTech->Enable();
+    pTech->SetVP(VP);
+    pTech->SetCameraPosition(CameraPos);
     
     m_pTexture->Bind(COLOR_TEXTURE_UNIT);
-       
-    glBindVertexArray(m_vao);
-    glDrawArrays(GL_POINTS, 0, m_numPoints);
-    glBindVertexArray(0);     
-}
\ No newline at end of file
+
+    if (m_useGeometryShader) {
+        GLState::BindVertexArray(m_pointsVAO);
+        glDrawArrays(GL_POINTS, m_firstInstance, m_numVisible);
+    } else {
+        GLState::BindVertexArray(m_instancedVAO);
+
+        if (m_firstInstance == 0) {
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_numVisible);
+        } else {
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, m_numVisible, m_firstInstance);
+        }
+    }
+
+    GLState::BindVertexArray(0);
+
+    if (m_pMappedVB) {
+        GLsync& Fence = m_fences[m_currRegion];
+
+        // The region can be drawn more than once if it was not updated
+        if (Fence) {
+            glDeleteSync(Fence);
+        }
+
+        Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
@@ -46,13 +46,43 @@ bool BillboardTechnique::Init()
         return false;
     }
 
+    return InitUniforms();
+}
+
+
+bool InstancedBillboardTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_VERTEX_SHADER, "../Common/Shaders/billboard_instanced.vs")) {
+        return false;
+    }
+
+    if (!AddShader(GL_FRAGMENT_SHADER, "../Common/Shaders/billboard.fs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    return InitUniforms();
+}
+
+
+bool BillboardTechnique::InitUniforms()
+{
     m_VPLocation = GetUniformLocation("gVP");
     m_cameraPosLocation = GetUniformLocation("gCameraPos");
     m_colorMapLocation = GetUniformLocation("gColorMap");
+    m_atlasSizeLocation = GetUniformLocation("gAtlasSize");
 
     if (m_VPLocation == INVALID_UNIFORM_LOCATION ||
         m_cameraPosLocation == INVALID_UNIFORM_LOCATION ||
-        m_colorMapLocation == INVALID_UNIFORM_LOCATION) {
+        m_colorMapLocation == INVALID_UNIFORM_LOCATION ||
+        m_atlasSizeLocation == INVALID_UNIFORM_LOCATION) {
         return false;        
     }
     
@@ -76,3 +106,9 @@ void BillboardTechnique::SetColorTextureUnit(unsigned int TextureUnit)
 {
     glUniform1i(m_colorMapLocation, TextureUnit);
 }
+
+
+void BillboardTechnique::SetAtlasSize(int Cols, int Rows)
+{
+    glUniform2i(m_atlasSizeLocation, Cols, Rows);
+}
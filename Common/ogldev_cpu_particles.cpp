@@ -0,0 +1,238 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_cpu_particles.h"
+
+// Below this a chunk is not worth a thread
+#define MIN_PARTICLES_PER_CHUNK 16384
+
+
+void CPUParticleSystem::Init(int MaxParticles, const ParticleEmitterDesc& Emitter)
+{
+    m_maxParticles = MaxParticles;
+    m_emitter = Emitter;
+    m_clock = ParticleEmissionClock();
+    m_numEmitted = 0;
+
+    m_posX.assign(MaxParticles, 0.0f);
+    m_posY.assign(MaxParticles, 0.0f);
+    m_posZ.assign(MaxParticles, 0.0f);
+    m_velX.assign(MaxParticles, 0.0f);
+    m_velY.assign(MaxParticles, 0.0f);
+    m_velZ.assign(MaxParticles, 0.0f);
+    m_age.assign(MaxParticles, 0.0f);
+    m_lifetime.assign(MaxParticles, 0.0f);   // age >= lifetime - all dead
+
+    // Descending so that the first emission takes slot 0
+    m_freeList.resize(MaxParticles);
+
+    for (int i = 0 ; i < MaxParticles ; i++) {
+        m_freeList[i] = MaxParticles - 1 - i;
+    }
+}
+
+
+void CPUParticleSystem::Update(float DeltaTimeSecs)
+{
+    int NumChunks = (m_numThreads > 0) ? m_numThreads : m_jobs.GetNumThreads();
+    NumChunks = std::max(1, std::min(NumChunks, (m_maxParticles + MIN_PARTICLES_PER_CHUNK - 1) / MIN_PARTICLES_PER_CHUNK));
+
+    // Multiple of 4 so that only the last chunk has a scalar tail
+    int ChunkSize = (((m_maxParticles + NumChunks - 1) / NumChunks) + 3) & ~3;
+
+    std::vector<std::vector<u32>> Died(NumChunks);
+
+    // Every frame so on the persistent threads rather than ParallelFor
+    m_jobs.Dispatch(NumChunks, [&](int c, int) {
+        int Start = std::min(c * ChunkSize, m_maxParticles);
+        int End = std::min(Start + ChunkSize, m_maxParticles);
+        UpdateRange(Start, End, DeltaTimeSecs, Died[c]);
+    });
+
+    // The chunks are in ascending order and so are the slots inside each chunk
+    for (int c = 0 ; c < NumChunks ; c++) {
+        m_freeList.insert(m_freeList.end(), Died[c].begin(), Died[c].end());
+    }
+
+    Emit(m_clock.Advance(m_emitter.EmitRate, DeltaTimeSecs));
+}
+
+
+void CPUParticleSystem::UpdateRange(int Start, int End, float DeltaTimeSecs, std::vector<u32>& Died)
+{
+    float* pPosX = m_posX.data();
+    float* pPosY = m_posY.data();
+    float* pPosZ = m_posZ.data();
+    float* pVelX = m_velX.data();
+    float* pVelY = m_velY.data();
+    float* pVelZ = m_velZ.data();
+    float* pAge = m_age.data();
+    const float* pLifetime = m_lifetime.data();
+
+    // Collect the particles that die in this frame. Age + dt is computed
+    // exactly like in the kernel below.
+    for (int i = Start ; i < End ; i++) {
+        if ((pAge[i] < pLifetime[i]) && (pAge[i] + DeltaTimeSecs >= pLifetime[i])) {
+            Died.push_back((u32)i);
+        }
+    }
+
+    const float dt = DeltaTimeSecs;
+    const float Drag = m_emitter.Drag;
+    const Vector3f& Gravity = m_emitter.Gravity;
+
+    int i = Start;
+
+#if defined(OGLDEV_MATH_SSE)
+    const __m128 dt4 = _mm_set1_ps(dt);
+    const __m128 Drag4 = _mm_set1_ps(Drag);
+    const __m128 GravityX = _mm_set1_ps(Gravity.x);
+    const __m128 GravityY = _mm_set1_ps(Gravity.y);
+    const __m128 GravityZ = _mm_set1_ps(Gravity.z);
+
+    for ( ; i + 4 <= End ; i += 4) {
+        __m128 Age = _mm_loadu_ps(pAge + i);
+        __m128 Alive = _mm_cmplt_ps(Age, _mm_loadu_ps(pLifetime + i));
+
+        __m128 vx = _mm_loadu_ps(pVelX + i);
+        __m128 vy = _mm_loadu_ps(pVelY + i);
+        __m128 vz = _mm_loadu_ps(pVelZ + i);
+
+        // Only the live lanes move
+        __m128 dvx = _mm_and_ps(Alive, _mm_mul_ps(_mm_sub_ps(GravityX, _mm_mul_ps(Drag4, vx)), dt4));
+        __m128 dvy = _mm_and_ps(Alive, _mm_mul_ps(_mm_sub_ps(GravityY, _mm_mul_ps(Drag4, vy)), dt4));
+        __m128 dvz = _mm_and_ps(Alive, _mm_mul_ps(_mm_sub_ps(GravityZ, _mm_mul_ps(Drag4, vz)), dt4));
+        vx = _mm_add_ps(vx, dvx);
+        vy = _mm_add_ps(vy, dvy);
+        vz = _mm_add_ps(vz, dvz);
+
+        __m128 Masked_dt = _mm_and_ps(Alive, dt4);
+
+        _mm_storeu_ps(pPosX + i, _mm_add_ps(_mm_loadu_ps(pPosX + i), _mm_mul_ps(vx, Masked_dt)));
+        _mm_storeu_ps(pPosY + i, _mm_add_ps(_mm_loadu_ps(pPosY + i), _mm_mul_ps(vy, Masked_dt)));
+        _mm_storeu_ps(pPosZ + i, _mm_add_ps(_mm_loadu_ps(pPosZ + i), _mm_mul_ps(vz, Masked_dt)));
+        _mm_storeu_ps(pVelX + i, vx);
+        _mm_storeu_ps(pVelY + i, vy);
+        _mm_storeu_ps(pVelZ + i, vz);
+        _mm_storeu_ps(pAge + i, _mm_add_ps(Age, Masked_dt));
+    }
+#elif defined(OGLDEV_MATH_NEON)
+    const float32x4_t dt4 = vdupq_n_f32(dt);
+    const float32x4_t Drag4 = vdupq_n_f32(Drag);
+    const float32x4_t GravityX = vdupq_n_f32(Gravity.x);
+    const float32x4_t GravityY = vdupq_n_f32(Gravity.y);
+    const float32x4_t GravityZ = vdupq_n_f32(Gravity.z);
+
+    for ( ; i + 4 <= End ; i += 4) {
+        float32x4_t Age = vld1q_f32(pAge + i);
+        uint32x4_t Alive = vcltq_f32(Age, vld1q_f32(pLifetime + i));
+
+        float32x4_t vx = vld1q_f32(pVelX + i);
+        float32x4_t vy = vld1q_f32(pVelY + i);
+        float32x4_t vz = vld1q_f32(pVelZ + i);
+
+        // vmulq + vaddq rather than vmlaq so the rounding matches the scalar code
+        float32x4_t nvx = vaddq_f32(vx, vmulq_f32(vsubq_f32(GravityX, vmulq_f32(Drag4, vx)), dt4));
+        float32x4_t nvy = vaddq_f32(vy, vmulq_f32(vsubq_f32(GravityY, vmulq_f32(Drag4, vy)), dt4));
+        float32x4_t nvz = vaddq_f32(vz, vmulq_f32(vsubq_f32(GravityZ, vmulq_f32(Drag4, vz)), dt4));
+
+        float32x4_t px = vld1q_f32(pPosX + i);
+        float32x4_t py = vld1q_f32(pPosY + i);
+        float32x4_t pz = vld1q_f32(pPosZ + i);
+
+        vst1q_f32(pPosX + i, vbslq_f32(Alive, vaddq_f32(px, vmulq_f32(nvx, dt4)), px));
+        vst1q_f32(pPosY + i, vbslq_f32(Alive, vaddq_f32(py, vmulq_f32(nvy, dt4)), py));
+        vst1q_f32(pPosZ + i, vbslq_f32(Alive, vaddq_f32(pz, vmulq_f32(nvz, dt4)), pz));
+        vst1q_f32(pVelX + i, vbslq_f32(Alive, nvx, vx));
+        vst1q_f32(pVelY + i, vbslq_f32(Alive, nvy, vy));
+        vst1q_f32(pVelZ + i, vbslq_f32(Alive, nvz, vz));
+        vst1q_f32(pAge + i, vbslq_f32(Alive, vaddq_f32(Age, dt4), Age));
+    }
+#endif
+
+    for ( ; i < End ; i++) {
+        if (pAge[i] >= pLifetime[i]) {
+            continue;
+        }
+
+        pVelX[i] += (Gravity.x - Drag * pVelX[i]) * dt;
+        pVelY[i] += (Gravity.y - Drag * pVelY[i]) * dt;
+        pVelZ[i] += (Gravity.z - Drag * pVelZ[i]) * dt;
+        pPosX[i] += pVelX[i] * dt;
+        pPosY[i] += pVelY[i] * dt;
+        pPosZ[i] += pVelZ[i] * dt;
+        pAge[i] += dt;
+    }
+}
+
+
+void CPUParticleSystem::Emit(int Count)
+{
+    // Requests that don't fit still consume their index, like on the GPU
+    u32 EmitBase = m_numEmitted;
+    m_numEmitted += Count;
+
+    Count = std::min(Count, (int)m_freeList.size());
+
+    for (int i = 0 ; i < Count ; i++) {
+        u32 Slot = m_freeList.back();
+        m_freeList.pop_back();
+
+        Vector3f Vel;
+        float Lifetime = 0.0f;
+        ParticleEmitValues(m_emitter, EmitBase + i, Vel, Lifetime);
+
+        m_posX[Slot] = m_emitter.Pos.x;
+        m_posY[Slot] = m_emitter.Pos.y;
+        m_posZ[Slot] = m_emitter.Pos.z;
+        m_velX[Slot] = Vel.x;
+        m_velY[Slot] = Vel.y;
+        m_velZ[Slot] = Vel.z;
+        m_age[Slot] = 0.0f;
+        m_lifetime[Slot] = Lifetime;
+    }
+}
+
+
+bool CPUParticleSystem::CalcBounds(Vector3f& Min, Vector3f& Max) const
+{
+    bool Found = false;
+
+    for (int i = 0 ; i < m_maxParticles ; i++) {
+        if (!IsAlive(i)) {
+            continue;
+        }
+
+        Vector3f Pos = GetPos(i);
+
+        if (!Found) {
+            Min = Pos;
+            Max = Pos;
+            Found = true;
+        } else {
+            Min.x = std::min(Min.x, Pos.x);
+            Min.y = std::min(Min.y, Pos.y);
+            Min.z = std::min(Min.z, Pos.z);
+            Max.x = std::max(Max.x, Pos.x);
+            Max.y = std::max(Max.y, Pos.y);
+            Max.z = std::max(Max.z, Pos.z);
+        }
+    }
+
+    return Found;
+}
@@ -12,23 +12,35 @@ Framebuffer::Framebuffer()
 
 
 Framebuffer::~Framebuffer()
+{
+	Destroy();
+}
+
+
+void Framebuffer::Destroy()
 {
 	if (m_fbo != 0) {
 		glDeleteFramebuffers(1, &m_fbo);
+		m_fbo = 0;
 	}
 
 	if (m_textureBuffer != 0) {
 		glDeleteTextures(1, &m_textureBuffer);
+		m_textureBuffer = 0;
 	}
 
 	if (m_depthBuffer != 0) {
 		glDeleteTextures(1, &m_depthBuffer);
+		m_depthBuffer = 0;
 	}
 }
 
 
 void Framebuffer::Init(int Width, int Height)
 {
+	// Init can be called again to resize
+	Destroy();
+
 	m_width = Width;
 	m_height = Height;
 
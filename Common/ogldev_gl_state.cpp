@@ -0,0 +1,369 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_util.h"
+#include "ogldev_gl_state.h"
+
+#define UNKNOWN_STATE 0xffffffff
+#define MAX_TEXTURE_UNITS 32
+
+// Only these capabilities are shadowed; the rest go straight to GL
+static const GLenum TrackedCaps[] = {
+    GL_BLEND,
+    GL_DEPTH_TEST,
+    GL_CULL_FACE,
+    GL_SCISSOR_TEST,
+    GL_STENCIL_TEST,
+    GL_PRIMITIVE_RESTART,
+    GL_PROGRAM_POINT_SIZE,
+    GL_TEXTURE_CUBE_MAP_SEAMLESS
+};
+
+#define NUM_TRACKED_CAPS ARRAY_SIZE_IN_ELEMENTS(TrackedCaps)
+
+struct TextureUnitState {
+    GLenum Target;
+    GLuint Texture;
+};
+
+struct ShadowState {
+    GLuint Program;
+    GLuint VAO;
+    GLenum ActiveTextureUnit;
+    TextureUnitState TextureUnits[MAX_TEXTURE_UNITS];
+    GLuint DrawFBO;
+    GLuint ReadFBO;
+    int Viewport[4];
+    bool IsViewportKnown;
+    GLuint Caps[NUM_TRACKED_CAPS];      // GL_TRUE/GL_FALSE/UNKNOWN_STATE
+    GLenum BlendSrc;
+    GLenum BlendDst;
+    GLenum DepthFunc;
+    GLuint DepthMask;
+};
+
+static ShadowState s_state;
+static int s_isDSA = -1;
+
+bool GLState::s_isFilteringEnabled = false;
+GLStateStats GLState::s_stats;
+
+static const char* CategoryNames[GL_STATE_NUM_CATEGORIES] = {
+    "program", "vao", "texture", "framebuffer", "viewport", "enable", "blend", "depth"
+};
+
+
+u64 GLStateStats::GetTotalIssued() const
+{
+    u64 Total = 0;
+
+    for (int i = 0 ; i < GL_STATE_NUM_CATEGORIES ; i++) {
+        Total += NumIssued[i];
+    }
+
+    return Total;
+}
+
+
+u64 GLStateStats::GetTotalFiltered() const
+{
+    u64 Total = 0;
+
+    for (int i = 0 ; i < GL_STATE_NUM_CATEGORIES ; i++) {
+        Total += NumFiltered[i];
+    }
+
+    return Total;
+}
+
+
+void GLStateStats::Print() const
+{
+    printf("GL state calls: %llu issued, %llu filtered\n",
+           (unsigned long long)GetTotalIssued(), (unsigned long long)GetTotalFiltered());
+
+    for (int i = 0 ; i < GL_STATE_NUM_CATEGORIES ; i++) {
+        if (NumIssued[i] + NumFiltered[i] > 0) {
+            printf("    %-12s %8llu issued %8llu filtered\n", CategoryNames[i],
+                   (unsigned long long)NumIssued[i], (unsigned long long)NumFiltered[i]);
+        }
+    }
+}
+
+
+void GLState::SetFilteringEnabled(bool Enabled)
+{
+    s_isFilteringEnabled = Enabled;
+    Invalidate();
+}
+
+
+void GLState::Invalidate()
+{
+    s_state.Program = UNKNOWN_STATE;
+    s_state.VAO = UNKNOWN_STATE;
+    s_state.ActiveTextureUnit = UNKNOWN_STATE;
+
+    for (int i = 0 ; i < MAX_TEXTURE_UNITS ; i++) {
+        s_state.TextureUnits[i].Target = UNKNOWN_STATE;
+        s_state.TextureUnits[i].Texture = UNKNOWN_STATE;
+    }
+
+    s_state.DrawFBO = UNKNOWN_STATE;
+    s_state.ReadFBO = UNKNOWN_STATE;
+    s_state.IsViewportKnown = false;
+
+    for (int i = 0 ; i < (int)NUM_TRACKED_CAPS ; i++) {
+        s_state.Caps[i] = UNKNOWN_STATE;
+    }
+
+    s_state.BlendSrc = UNKNOWN_STATE;
+    s_state.BlendDst = UNKNOWN_STATE;
+    s_state.DepthFunc = UNKNOWN_STATE;
+    s_state.DepthMask = UNKNOWN_STATE;
+}
+
+
+void GLState::ResetStats()
+{
+    s_stats = GLStateStats();
+}
+
+
+bool GLState::IsDSAAvailable()
+{
+    if (s_isDSA == -1) {
+        s_isDSA = IsGLVersionHigher(4, 5) ? 1 : 0;
+    }
+
+    return s_isDSA == 1;
+}
+
+
+// Returns true if the call should be skipped
+bool GLState::Filter(GL_STATE_CATEGORY Category, bool IsRedundant)
+{
+    if (s_isFilteringEnabled && IsRedundant) {
+        s_stats.NumFiltered[Category]++;
+        return true;
+    }
+
+    s_stats.NumIssued[Category]++;
+
+    return false;
+}
+
+
+void GLState::UseProgram(GLuint Program)
+{
+    if (Filter(GL_STATE_PROGRAM, s_state.Program == Program)) {
+        return;
+    }
+
+    glUseProgram(Program);
+    s_state.Program = Program;
+}
+
+
+GLuint GLState::GetProgram()
+{
+    return s_state.Program;
+}
+
+
+void GLState::BindVertexArray(GLuint VAO)
+{
+    if (Filter(GL_STATE_VERTEX_ARRAY, s_state.VAO == VAO)) {
+        return;
+    }
+
+    glBindVertexArray(VAO);
+    s_state.VAO = VAO;
+}
+
+
+void GLState::BindTexture(GLenum TextureUnit, GLenum Target, GLuint Texture)
+{
+    uint Unit = TextureUnit - GL_TEXTURE0;
+
+    if (Unit >= MAX_TEXTURE_UNITS) {
+        Filter(GL_STATE_TEXTURE, false);
+        glActiveTexture(TextureUnit);
+        glBindTexture(Target, Texture);
+        s_state.ActiveTextureUnit = TextureUnit;
+        return;
+    }
+
+    TextureUnitState& State = s_state.TextureUnits[Unit];
+
+    // A unit has a binding point per target. Only the last one is
+    // shadowed so a bind to a different target is always issued.
+    bool IsRedundant = (State.Target == Target) && (State.Texture == Texture);
+
+    if (Filter(GL_STATE_TEXTURE, IsRedundant)) {
+        return;
+    }
+
+    if (IsDSAAvailable()) {
+        glBindTextureUnit(Unit, Texture);
+    } else {
+        if (!s_isFilteringEnabled || (s_state.ActiveTextureUnit != TextureUnit)) {
+            glActiveTexture(TextureUnit);
+            s_state.ActiveTextureUnit = TextureUnit;
+        }
+
+        glBindTexture(Target, Texture);
+    }
+
+    State.Target = Target;
+    State.Texture = Texture;
+}
+
+
+void GLState::BindFramebuffer(GLenum Target, GLuint FBO)
+{
+    bool IsRedundant = false;
+
+    switch (Target) {
+    case GL_FRAMEBUFFER:
+        IsRedundant = (s_state.DrawFBO == FBO) && (s_state.ReadFBO == FBO);
+        break;
+
+    case GL_DRAW_FRAMEBUFFER:
+        IsRedundant = (s_state.DrawFBO == FBO);
+        break;
+
+    case GL_READ_FRAMEBUFFER:
+        IsRedundant = (s_state.ReadFBO == FBO);
+        break;
+
+    default:
+        OGLDEV_ERROR("Invalid framebuffer target 0x%x\n", Target);
+        exit(0);
+    }
+
+    if (Filter(GL_STATE_FRAMEBUFFER, IsRedundant)) {
+        return;
+    }
+
+    glBindFramebuffer(Target, FBO);
+
+    if (Target != GL_READ_FRAMEBUFFER) {
+        s_state.DrawFBO = FBO;
+    }
+
+    if (Target != GL_DRAW_FRAMEBUFFER) {
+        s_state.ReadFBO = FBO;
+    }
+}
+
+
+void GLState::Viewport(int x, int y, int Width, int Height)
+{
+    bool IsRedundant = s_state.IsViewportKnown &&
+                       (s_state.Viewport[0] == x) && (s_state.Viewport[1] == y) &&
+                       (s_state.Viewport[2] == Width) && (s_state.Viewport[3] == Height);
+
+    if (Filter(GL_STATE_VIEWPORT, IsRedundant)) {
+        return;
+    }
+
+    glViewport(x, y, Width, Height);
+
+    s_state.Viewport[0] = x;
+    s_state.Viewport[1] = y;
+    s_state.Viewport[2] = Width;
+    s_state.Viewport[3] = Height;
+    s_state.IsViewportKnown = true;
+}
+
+
+void GLState::SetCap(GLenum Cap, bool Enable)
+{
+    GLuint NewState = Enable ? GL_TRUE : GL_FALSE;
+    GLuint* pState = NULL;
+
+    for (int i = 0 ; i < (int)NUM_TRACKED_CAPS ; i++) {
+        if (TrackedCaps[i] == Cap) {
+            pState = &s_state.Caps[i];
+            break;
+        }
+    }
+
+    if (Filter(GL_STATE_CAPABILITY, pState && (*pState == NewState))) {
+        return;
+    }
+
+    if (Enable) {
+        glEnable(Cap);
+    } else {
+        glDisable(Cap);
+    }
+
+    if (pState) {
+        *pState = NewState;
+    }
+}
+
+
+void GLState::Enable(GLenum Cap)
+{
+    SetCap(Cap, true);
+}
+
+
+void GLState::Disable(GLenum Cap)
+{
+    SetCap(Cap, false);
+}
+
+
+void GLState::BlendFunc(GLenum SrcFactor, GLenum DstFactor)
+{
+    if (Filter(GL_STATE_BLEND, (s_state.BlendSrc == SrcFactor) && (s_state.BlendDst == DstFactor))) {
+        return;
+    }
+
+    glBlendFunc(SrcFactor, DstFactor);
+    s_state.BlendSrc = SrcFactor;
+    s_state.BlendDst = DstFactor;
+}
+
+
+void GLState::DepthFunc(GLenum Func)
+{
+    if (Filter(GL_STATE_DEPTH, s_state.DepthFunc == Func)) {
+        return;
+    }
+
+    glDepthFunc(Func);
+    s_state.DepthFunc = Func;
+}
+
+
+void GLState::DepthMask(bool Enable)
+{
+    GLuint NewState = Enable ? GL_TRUE : GL_FALSE;
+
+    if (Filter(GL_STATE_DEPTH, s_state.DepthMask == NewState)) {
+        return;
+    }
+
+    glDepthMask(Enable ? GL_TRUE : GL_FALSE);
+    s_state.DepthMask = NewState;
+}
@@ -0,0 +1,215 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+
+#include "ogldev_util.h"
+#include "ogldev_engine_common.h"
+#include "ogldev_texture.h"
+#include "ogldev_gl_state.h"
+#include "ogldev_gpu_particles.h"
+
+// Same layout as the DrawCommand block in the shaders
+struct DrawArraysIndirectCommand {
+    GLuint VertexCount;
+    GLuint InstanceCount;
+    GLuint First;
+    GLuint BaseInstance;
+};
+
+
+GPUParticleSystem::GPUParticleSystem()
+{
+}
+
+
+GPUParticleSystem::~GPUParticleSystem()
+{
+    if (m_buffers[0] != 0) {
+        glDeleteBuffers(NUM_BUFFERS, m_buffers);
+    }
+
+    if (m_VAO != 0) {
+        glDeleteVertexArrays(1, &m_VAO);
+    }
+}
+
+
+bool GPUParticleSystem::IsSupported()
+{
+    return GLEW_VERSION_4_3 ||
+           (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_draw_indirect);
+}
+
+
+bool GPUParticleSystem::Init(int MaxParticles, const ParticleEmitterDesc& Emitter)
+{
+    if (!IsSupported()) {
+        printf("GPU particles require compute shaders and shader storage buffers\n");
+        return false;
+    }
+
+    m_maxParticles = MaxParticles;
+    m_emitter = Emitter;
+    m_clock = ParticleEmissionClock();
+    m_numEmitted = 0;
+
+    glGenBuffers(NUM_BUFFERS, m_buffers);
+
+    // All zero - age >= lifetime means dead
+    for (int i = POS_AGE_BUFFER ; i <= VEL_LIFETIME_BUFFER ; i++) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Vector4f) * MaxParticles, NULL, GL_DYNAMIC_DRAW);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32F, GL_RED, GL_FLOAT, NULL);
+    }
+
+    // The emit pass pops from the end so the first particle goes to slot 0
+    std::vector<GLuint> DeadList(MaxParticles);
+
+    for (int i = 0 ; i < MaxParticles ; i++) {
+        DeadList[i] = MaxParticles - 1 - i;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[DEAD_LIST_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * MaxParticles, DeadList.data(), GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[ALIVE_LIST_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * MaxParticles, NULL, GL_DYNAMIC_DRAW);
+
+    GLint DeadCount = MaxParticles;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[COUNTERS_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DeadCount), &DeadCount, GL_DYNAMIC_DRAW);
+
+    DrawArraysIndirectCommand Cmd = { 4, 0, 0, 0 };     // one quad per instance
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[DRAW_COMMAND_BUFFER]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Cmd), &Cmd, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glGenVertexArrays(1, &m_VAO);
+
+    if (!m_updateTech.Init()) {
+        return false;
+    }
+
+    if (!m_emitTech.Init()) {
+        return false;
+    }
+
+    if (!m_renderTech.Init()) {
+        return false;
+    }
+
+    m_renderTech.Enable();
+    m_renderTech.SetColorTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+
+    return GLCheckError();
+}
+
+
+void GPUParticleSystem::BindStorageBuffers()
+{
+    for (int i = 0 ; i < NUM_BUFFERS ; i++) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, m_buffers[i]);
+    }
+}
+
+
+void GPUParticleSystem::Update(float DeltaTimeSecs)
+{
+    u32 EmitCount = (u32)m_clock.Advance(m_emitter.EmitRate, DeltaTimeSecs);
+
+    BindStorageBuffers();
+
+    // The alive list is rebuilt from scratch by the two passes
+    GLuint Zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[DRAW_COMMAND_BUFFER]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetof(DrawArraysIndirectCommand, InstanceCount), sizeof(Zero), &Zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    m_updateTech.Enable();
+    m_updateTech.SetMaxParticles(m_maxParticles);
+    m_updateTech.SetDeltaTime(DeltaTimeSecs);
+    m_updateTech.SetEmitter(m_emitter);
+    glDispatchCompute((m_maxParticles + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE, 1, 1);
+
+    if (EmitCount > 0) {
+        // The emit pass needs the complete dead list
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        m_emitTech.Enable();
+        m_emitTech.SetEmitCount(EmitCount, m_numEmitted);
+        m_emitTech.SetEmitter(m_emitter);
+        glDispatchCompute((EmitCount + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE, 1, 1);
+
+        m_numEmitted += EmitCount;
+    }
+
+    // The draw reads the alive list in the vertex shader and the instance count as a command
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+
+void GPUParticleSystem::Render(const Matrix4f& VP, const Vector3f& CameraPos)
+{
+    m_renderTech.Enable();
+    m_renderTech.SetVP(VP);
+    m_renderTech.SetCameraPosition(CameraPos);
+    m_renderTech.SetBillboardSize(m_billboardSize);
+
+    if (m_pTexture) {
+        m_pTexture->Bind(COLOR_TEXTURE_UNIT);
+    }
+
+    BindStorageBuffers();
+
+    GLState::BindVertexArray(m_VAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffers[DRAW_COMMAND_BUFFER]);
+
+    glDrawArraysIndirect(GL_TRIANGLE_STRIP, NULL);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    GLState::BindVertexArray(0);
+}
+
+
+int GPUParticleSystem::ReadNumAlive() const
+{
+    GLuint NumAlive = 0;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[DRAW_COMMAND_BUFFER]);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetof(DrawArraysIndirectCommand, InstanceCount), sizeof(NumAlive), &NumAlive);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    return (int)NumAlive;
+}
+
+
+void GPUParticleSystem::ReadParticles(std::vector<Vector4f>& PosAge, std::vector<Vector4f>& VelLifetime) const
+{
+    PosAge.resize(m_maxParticles);
+    VelLifetime.resize(m_maxParticles);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[POS_AGE_BUFFER]);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Vector4f) * m_maxParticles, PosAge.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[VEL_LIFETIME_BUFFER]);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Vector4f) * m_maxParticles, VelLifetime.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
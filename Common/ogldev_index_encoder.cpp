@@ -0,0 +1,439 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+
+#include "ogldev_index_encoder.h"
+
+
+void BuildGridStrips(int Width, int Depth, int CacheSize, std::vector<uint>& Indices, std::vector<IndexRange>& Ranges)
+{
+    if ((Width < 2) || (Depth < 2)) {
+        printf("%s:%d - invalid grid size %dx%d\n", __FILE__, __LINE__, Width, Depth);
+        exit(0);
+    }
+
+    Indices.clear();
+    Ranges.clear();
+
+    // The top row of a band is also the bottom row of the next one. When
+    // even two rows don't fit the whole grid is a single band and PackIndices
+    // falls back to 32 bits.
+    int NumQuadRows = Depth - 1;
+    int RowsPerBand = 0xFFFF / Width - 1;
+
+    if (RowsPerBand < 1) {
+        RowsPerBand = NumQuadRows;
+    }
+
+    // The first strip of every row of strips loads both of its columns
+    // interleaved. The column that the next strip reuses must survive the
+    // first vertex of that strip so two columns of StripHeight + 1 vertices
+    // and one more vertex must fit in the cache.
+    int StripHeight = std::max((CacheSize - 3) / 2, 1);
+
+    for (int BandZ = 0 ; BandZ < NumQuadRows ; BandZ += RowsPerBand) {
+        int BandEnd = std::min(BandZ + RowsPerBand, NumQuadRows);
+
+        IndexRange Range;
+        Range.Start = (int)Indices.size();
+        Range.BaseVertex = BandZ * Width;
+
+        for (int StripZ = BandZ ; StripZ < BandEnd ; StripZ += StripHeight) {
+            int StripEnd = std::min(StripZ + StripHeight, BandEnd);
+
+            for (int x = 0 ; x < Width - 1 ; x++) {
+                if ((int)Indices.size() > Range.Start) {
+                    Indices.push_back(OGLDEV_RESTART_INDEX);
+                }
+
+                // Right before left gives the BL-TR diagonal with the
+                // winding of the triangle list
+                for (int z = StripZ ; z <= StripEnd ; z++) {
+                    Indices.push_back(z * Width + x + 1);
+                    Indices.push_back(z * Width + x);
+                }
+            }
+        }
+
+        Range.Count = (int)Indices.size() - Range.Start;
+        Ranges.push_back(Range);
+    }
+}
+
+
+void BuildTriangleFans(const uint* pTriangles, int NumIndices, std::vector<uint>& Fans)
+{
+    Fans.clear();
+
+    for (int i = 0 ; i < NumIndices ; i += 3) {
+        bool ContinuesFan = (i > 0) &&
+                            (pTriangles[i] == pTriangles[i - 3]) &&
+                            (pTriangles[i + 1] == pTriangles[i - 1]);
+
+        if (ContinuesFan) {
+            Fans.push_back(pTriangles[i + 2]);
+        } else {
+            if (i > 0) {
+                Fans.push_back(OGLDEV_RESTART_INDEX);
+            }
+
+            Fans.push_back(pTriangles[i]);
+            Fans.push_back(pTriangles[i + 1]);
+            Fans.push_back(pTriangles[i + 2]);
+        }
+    }
+}
+
+
+//
+// A FIFO cache that only remembers when each vertex went in. A vertex is
+// still in the cache if less than CacheSize vertices went in after it.
+//
+class VertexCacheSim
+{
+public:
+    VertexCacheSim(uint MaxIndex, int CacheSize) : m_insertTime(MaxIndex + 1, INT_MIN / 2)
+    {
+        m_cacheSize = CacheSize;
+    }
+
+    // The number of vertices that went in since Index did
+    int GetAge(uint Index) const
+    {
+        return m_time - m_insertTime[Index];
+    }
+
+    bool IsInCache(uint Index) const
+    {
+        return GetAge(Index) <= m_cacheSize;
+    }
+
+    // Returns true on a miss
+    bool Access(uint Index)
+    {
+        if (IsInCache(Index)) {
+            return false;
+        }
+
+        m_insertTime[Index] = m_time;
+        m_time++;
+
+        return true;
+    }
+
+private:
+    std::vector<int> m_insertTime;
+    int m_time = 0;
+    int m_cacheSize = 0;
+};
+
+
+static uint FindMaxIndex(const uint* pIndices, int NumIndices)
+{
+    uint MaxIndex = 0;
+
+    for (int i = 0 ; i < NumIndices ; i++) {
+        if (pIndices[i] != OGLDEV_RESTART_INDEX) {
+            MaxIndex = std::max(MaxIndex, pIndices[i]);
+        }
+    }
+
+    return MaxIndex;
+}
+
+
+struct Primitive {
+    int Start = 0;
+    int Count = 0;
+};
+
+
+static void SplitPrimitives(INDEX_TOPOLOGY Topology, const std::vector<uint>& Indices, std::vector<Primitive>& Primitives)
+{
+    Primitives.clear();
+
+    Primitive Prim;
+
+    for (int i = 0 ; i < (int)Indices.size() ; i++) {
+        if (Indices[i] == OGLDEV_RESTART_INDEX) {
+            if (Prim.Count > 0) {
+                Primitives.push_back(Prim);
+            }
+
+            Prim.Start = i + 1;
+            Prim.Count = 0;
+        } else {
+            Prim.Count++;
+
+            if ((Topology == INDEX_TOPOLOGY_TRIANGLES) && (Prim.Count == 3)) {
+                Primitives.push_back(Prim);
+                Prim.Start = i + 1;
+                Prim.Count = 0;
+            }
+        }
+    }
+
+    if (Prim.Count > 0) {
+        Primitives.push_back(Prim);
+    }
+}
+
+
+void OptimizeVertexCache(INDEX_TOPOLOGY Topology, std::vector<uint>& Indices, int CacheSize)
+{
+    std::vector<Primitive> Primitives;
+    SplitPrimitives(Topology, Indices, Primitives);
+
+    int NumPrimitives = (int)Primitives.size();
+
+    if (NumPrimitives < 2) {
+        return;
+    }
+
+    uint MaxIndex = FindMaxIndex(&Indices[0], (int)Indices.size());
+
+    // The primitives of every vertex, laid out by vertex
+    std::vector<int> AdjacencyStart(MaxIndex + 2, 0);
+
+    for (int p = 0 ; p < NumPrimitives ; p++) {
+        for (int i = 0 ; i < Primitives[p].Count ; i++) {
+            AdjacencyStart[Indices[Primitives[p].Start + i] + 1]++;
+        }
+    }
+
+    for (uint v = 0 ; v <= MaxIndex ; v++) {
+        AdjacencyStart[v + 1] += AdjacencyStart[v];
+    }
+
+    std::vector<int> Adjacency(AdjacencyStart[MaxIndex + 1]);
+    std::vector<int> Fill(AdjacencyStart.begin(), AdjacencyStart.end() - 1);
+
+    for (int p = 0 ; p < NumPrimitives ; p++) {
+        for (int i = 0 ; i < Primitives[p].Count ; i++) {
+            Adjacency[Fill[Indices[Primitives[p].Start + i]]++] = p;
+        }
+    }
+
+    VertexCacheSim Cache(MaxIndex, CacheSize);
+
+    // The last vertices that went into the cache - only their primitives
+    // can score
+    std::vector<uint> Recent(CacheSize, OGLDEV_RESTART_INDEX);
+    int RecentPos = 0;
+
+    // The number of primitives that still need every vertex
+    std::vector<int> Remaining(MaxIndex + 1, 0);
+
+    for (int p = 0 ; p < NumPrimitives ; p++) {
+        for (int i = 0 ; i < Primitives[p].Count ; i++) {
+            Remaining[Indices[Primitives[p].Start + i]]++;
+        }
+    }
+
+    std::vector<bool> IsEmitted(NumPrimitives, false);
+    int NextInOrder = 0;
+
+    std::vector<uint> Output;
+    Output.reserve(Indices.size());
+
+    for (int n = 0 ; n < NumPrimitives ; n++) {
+        int Best = -1;
+        int BestScore = INT_MIN;
+
+        for (int r = 0 ; r < CacheSize ; r++) {
+            uint v = Recent[r];
+
+            if ((v == OGLDEV_RESTART_INDEX) || !Cache.IsInCache(v)) {
+                continue;
+            }
+
+            for (int a = AdjacencyStart[v] ; a < AdjacencyStart[v + 1] ; a++) {
+                int p = Adjacency[a];
+
+                if (IsEmitted[p]) {
+                    continue;
+                }
+
+                // A hit saves a vertex shader run, more so for the older
+                // vertices that the FIFO is about to drop and for those with
+                // few primitives left that will soon stop taking space. A
+                // miss pushes the vertices of the next primitives out.
+                int Score = 0;
+
+                for (int i = 0 ; i < Primitives[p].Count ; i++) {
+                    uint u = Indices[Primitives[p].Start + i];
+
+                    if (Cache.IsInCache(u)) {
+                        Score += 5 + Cache.GetAge(u) + 20 / Remaining[u];
+                    } else {
+                        Score -= 5;
+                    }
+                }
+
+                if ((Score > BestScore) || ((Score == BestScore) && (p < Best))) {
+                    Best = p;
+                    BestScore = Score;
+                }
+            }
+        }
+
+        // Nothing connected to the cache - continue with the original order
+        if (Best == -1) {
+            while (IsEmitted[NextInOrder]) {
+                NextInOrder++;
+            }
+
+            Best = NextInOrder;
+        }
+
+        IsEmitted[Best] = true;
+
+        if ((Topology != INDEX_TOPOLOGY_TRIANGLES) && (Output.size() > 0)) {
+            Output.push_back(OGLDEV_RESTART_INDEX);
+        }
+
+        for (int i = 0 ; i < Primitives[Best].Count ; i++) {
+            uint v = Indices[Primitives[Best].Start + i];
+            Output.push_back(v);
+            Remaining[v]--;
+
+            if (Cache.Access(v)) {
+                Recent[RecentPos] = v;
+                RecentPos = (RecentPos + 1) % CacheSize;
+            }
+        }
+    }
+
+    Indices.swap(Output);
+}
+
+
+void DecodeTriangles(INDEX_TOPOLOGY Topology, const uint* pIndices, int NumIndices, std::vector<uint>& Triangles)
+{
+    Triangles.clear();
+
+    if (Topology == INDEX_TOPOLOGY_TRIANGLES) {
+        Triangles.assign(pIndices, pIndices + NumIndices);
+        return;
+    }
+
+    int First = 0;
+
+    for (int i = 0 ; i <= NumIndices ; i++) {
+        if ((i < NumIndices) && (pIndices[i] != OGLDEV_RESTART_INDEX)) {
+            continue;
+        }
+
+        // [First, i) is a single strip/fan
+        for (int j = First ; j + 2 < i ; j++) {
+            uint v0, v1, v2;
+
+            if (Topology == INDEX_TOPOLOGY_TRIANGLE_FAN) {
+                v0 = pIndices[First];
+                v1 = pIndices[j + 1];
+                v2 = pIndices[j + 2];
+            } else if ((j - First) % 2 == 0) {
+                v0 = pIndices[j];
+                v1 = pIndices[j + 1];
+                v2 = pIndices[j + 2];
+            } else {
+                v0 = pIndices[j + 1];
+                v1 = pIndices[j];
+                v2 = pIndices[j + 2];
+            }
+
+            if ((v0 != v1) && (v1 != v2) && (v0 != v2)) {
+                Triangles.push_back(v0);
+                Triangles.push_back(v1);
+                Triangles.push_back(v2);
+            }
+        }
+
+        First = i + 1;
+    }
+}
+
+
+float CalcACMR(INDEX_TOPOLOGY Topology, const uint* pIndices, int NumIndices, int CacheSize)
+{
+    std::vector<uint> Triangles;
+    DecodeTriangles(Topology, pIndices, NumIndices, Triangles);
+
+    int NumTriangles = (int)Triangles.size() / 3;
+
+    if (NumTriangles == 0) {
+        return 0.0f;
+    }
+
+    // The GPU caches the vertices of the index stream as it is, not of the
+    // decoded triangles
+    VertexCacheSim Cache(FindMaxIndex(pIndices, NumIndices), CacheSize);
+    int NumMisses = 0;
+
+    for (int i = 0 ; i < NumIndices ; i++) {
+        if ((pIndices[i] != OGLDEV_RESTART_INDEX) && Cache.Access(pIndices[i])) {
+            NumMisses++;
+        }
+    }
+
+    return (float)NumMisses / (float)NumTriangles;
+}
+
+
+int PackIndices(const std::vector<uint>& Indices, const std::vector<IndexRange>& Ranges, std::vector<uchar>& Buffer)
+{
+    bool Fits16Bit = true;
+
+    for (int r = 0 ; (r < (int)Ranges.size()) && Fits16Bit ; r++) {
+        const IndexRange& Range = Ranges[r];
+
+        for (int i = Range.Start ; i < Range.Start + Range.Count ; i++) {
+            if ((Indices[i] != OGLDEV_RESTART_INDEX) && (Indices[i] - Range.BaseVertex >= 0xFFFF)) {
+                Fits16Bit = false;
+                break;
+            }
+        }
+    }
+
+    int IndexSize = Fits16Bit ? sizeof(ushort) : sizeof(uint);
+    uint RestartIndex = GetRestartIndex(IndexSize);
+
+    Buffer.resize(Indices.size() * IndexSize);
+
+    for (int r = 0 ; r < (int)Ranges.size() ; r++) {
+        const IndexRange& Range = Ranges[r];
+
+        for (int i = Range.Start ; i < Range.Start + Range.Count ; i++) {
+            uint Index = (Indices[i] == OGLDEV_RESTART_INDEX) ? RestartIndex : Indices[i] - Range.BaseVertex;
+
+            if (Fits16Bit) {
+                ushort Index16 = (ushort)Index;
+                memcpy(&Buffer[i * IndexSize], &Index16, IndexSize);
+            } else {
+                memcpy(&Buffer[i * IndexSize], &Index, IndexSize);
+            }
+        }
+    }
+
+    return IndexSize;
+}
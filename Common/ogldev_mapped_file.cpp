@@ -0,0 +1,163 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "ogldev_mapped_file.h"
+
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+
+#ifdef _WIN32
+bool MappedFile::Open(const char* pFilename, MAPPED_FILE_ACCESS Access)
+{
+    Close();
+
+    DWORD Flags = (Access == MAPPED_FILE_ACCESS_SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+
+    HANDLE File = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, Flags, NULL);
+
+    if (File == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER Size;
+
+    if (!GetFileSizeEx(File, &Size) || ((u64)Size.QuadPart > SIZE_MAX)) {
+        CloseHandle(File);
+        return false;
+    }
+
+    m_fileHandle = File;
+    m_size = (u64)Size.QuadPart;
+    m_isOpen = true;
+
+    // A zero length file cannot be mapped
+    if (m_size == 0) {
+        return true;
+    }
+
+    m_mappingHandle = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (m_mappingHandle) {
+        m_pData = MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    if (!m_pData) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+
+void MappedFile::Close()
+{
+    if (m_pData) {
+        UnmapViewOfFile(m_pData);
+    }
+
+    if (m_mappingHandle) {
+        CloseHandle(m_mappingHandle);
+    }
+
+    if (m_fileHandle) {
+        CloseHandle(m_fileHandle);
+    }
+
+    m_pData = NULL;
+    m_mappingHandle = NULL;
+    m_fileHandle = NULL;
+    m_size = 0;
+    m_isOpen = false;
+}
+#else
+bool MappedFile::Open(const char* pFilename, MAPPED_FILE_ACCESS Access)
+{
+    Close();
+
+    int fd = open(pFilename, O_RDONLY);
+
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat stat_buf;
+
+    if ((fstat(fd, &stat_buf) != 0) || ((u64)stat_buf.st_size > SIZE_MAX)) {
+        close(fd);
+        return false;
+    }
+
+    u64 Size = (u64)stat_buf.st_size;
+
+    // A zero length file cannot be mapped
+    if (Size == 0) {
+        close(fd);
+        m_isOpen = true;
+        return true;
+    }
+
+    void* p = mmap(NULL, (size_t)Size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps its own reference to the file
+    close(fd);
+
+    if (p == MAP_FAILED) {
+        return false;
+    }
+
+    if (Access == MAPPED_FILE_ACCESS_SEQUENTIAL) {
+        madvise(p, (size_t)Size, MADV_SEQUENTIAL);
+        madvise(p, (size_t)Size, MADV_WILLNEED);
+    } else {
+        madvise(p, (size_t)Size, MADV_RANDOM);
+    }
+
+    m_pData = p;
+    m_size = Size;
+    m_isOpen = true;
+
+    return true;
+}
+
+
+void MappedFile::Close()
+{
+    if (m_pData) {
+        munmap(m_pData, (size_t)m_size);
+    }
+
+    m_pData = NULL;
+    m_size = 0;
+    m_isOpen = false;
+}
+#endif
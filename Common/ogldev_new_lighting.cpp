@@ -81,6 +81,12 @@ bool LightingTechnique::Init(int SubTech)
         }
         break;
 
+    case SUBTECH_INSTANCED:
+        if (!AddShader(GL_VERTEX_SHADER, "../Common/Shaders/lighting_new_instanced.vs")) {
+            return false;
+        }
+        break;
+
     default:
         printf("Invalid lighting subtechnique %d\n", SubTech);
         exit(0);
@@ -147,10 +153,18 @@ bool LightingTechnique::InitCommon()
     WireframeWidthLoc = GetUniformLocation("gWireframeWidth");
     WireframeColorLoc = GetUniformLocation("gWireframeColor");
 
-    if (WVPLoc == INVALID_UNIFORM_LOCATION ||
-        WorldMatrixLoc == INVALID_UNIFORM_LOCATION ||
-        LightWVPLoc == INVALID_UNIFORM_LOCATION ||  // required only for shadow mapping
-        samplerLoc == INVALID_UNIFORM_LOCATION ||
+    // With instancing the matrices are vertex attributes
+    if (m_subTech != SUBTECH_INSTANCED) {
+        if (WVPLoc == INVALID_UNIFORM_LOCATION ||
+            WorldMatrixLoc == INVALID_UNIFORM_LOCATION ||
+            LightWVPLoc == INVALID_UNIFORM_LOCATION) {  // required only for shadow mapping
+#ifdef FAIL_ON_MISSING_LOC
+            return false;
+#endif
+        }
+    }
+
+    if (samplerLoc == INVALID_UNIFORM_LOCATION ||
         shadowMapLoc == INVALID_UNIFORM_LOCATION ||
         shadowCubeMapLoc == INVALID_UNIFORM_LOCATION ||
         shadowMapWidthLoc == INVALID_UNIFORM_LOCATION ||
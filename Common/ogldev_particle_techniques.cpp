@@ -0,0 +1,171 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_util.h"
+#include "ogldev_particle_techniques.h"
+
+
+bool ParticleUpdateTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "../Common/Shaders/particles_update.comp")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_maxParticlesLoc = GetUniformLocation("gMaxParticles");
+    m_deltaTimeLoc = GetUniformLocation("gDeltaTime");
+    m_gravityLoc = GetUniformLocation("gGravity");
+    m_dragLoc = GetUniformLocation("gDrag");
+
+    return
+        ((m_maxParticlesLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_deltaTimeLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_gravityLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_dragLoc != INVALID_UNIFORM_LOCATION));
+}
+
+
+void ParticleUpdateTechnique::SetMaxParticles(u32 MaxParticles)
+{
+    glUniform1ui(m_maxParticlesLoc, MaxParticles);
+}
+
+
+void ParticleUpdateTechnique::SetDeltaTime(float DeltaTimeSecs)
+{
+    glUniform1f(m_deltaTimeLoc, DeltaTimeSecs);
+}
+
+
+void ParticleUpdateTechnique::SetEmitter(const ParticleEmitterDesc& Emitter)
+{
+    glUniform3f(m_gravityLoc, Emitter.Gravity.x, Emitter.Gravity.y, Emitter.Gravity.z);
+    glUniform1f(m_dragLoc, Emitter.Drag);
+}
+
+
+bool ParticleEmitTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_COMPUTE_SHADER, "../Common/Shaders/particles_emit.comp")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_emitCountLoc = GetUniformLocation("gEmitCount");
+    m_emitBaseLoc = GetUniformLocation("gEmitBase");
+    m_emitterPosLoc = GetUniformLocation("gEmitterPos");
+    m_velocityLoc = GetUniformLocation("gVelocity");
+    m_velocitySpreadLoc = GetUniformLocation("gVelocitySpread");
+    m_minLifetimeLoc = GetUniformLocation("gMinLifetime");
+    m_maxLifetimeLoc = GetUniformLocation("gMaxLifetime");
+
+    return
+        ((m_emitCountLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_emitBaseLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_emitterPosLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_velocityLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_velocitySpreadLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_minLifetimeLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_maxLifetimeLoc != INVALID_UNIFORM_LOCATION));
+}
+
+
+void ParticleEmitTechnique::SetEmitCount(u32 EmitCount, u32 EmitBase)
+{
+    glUniform1ui(m_emitCountLoc, EmitCount);
+    glUniform1ui(m_emitBaseLoc, EmitBase);
+}
+
+
+void ParticleEmitTechnique::SetEmitter(const ParticleEmitterDesc& Emitter)
+{
+    glUniform3f(m_emitterPosLoc, Emitter.Pos.x, Emitter.Pos.y, Emitter.Pos.z);
+    glUniform3f(m_velocityLoc, Emitter.Velocity.x, Emitter.Velocity.y, Emitter.Velocity.z);
+    glUniform1f(m_velocitySpreadLoc, Emitter.VelocitySpread);
+    glUniform1f(m_minLifetimeLoc, Emitter.MinLifetime);
+    glUniform1f(m_maxLifetimeLoc, Emitter.MaxLifetime);
+}
+
+
+bool ParticleRenderTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_VERTEX_SHADER, "../Common/Shaders/particles_render.vs")) {
+        return false;
+    }
+
+    if (!AddShader(GL_FRAGMENT_SHADER, "../Common/Shaders/particles_render.fs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_VPLoc = GetUniformLocation("gVP");
+    m_cameraPosLoc = GetUniformLocation("gCameraPos");
+    m_colorMapLoc = GetUniformLocation("gColorMap");
+    m_billboardSizeLoc = GetUniformLocation("gBillboardSize");
+
+    return
+        ((m_VPLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_cameraPosLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_colorMapLoc != INVALID_UNIFORM_LOCATION) &&
+        (m_billboardSizeLoc != INVALID_UNIFORM_LOCATION));
+}
+
+
+void ParticleRenderTechnique::SetVP(const Matrix4f& VP)
+{
+    glUniformMatrix4fv(m_VPLoc, 1, GL_TRUE, (const GLfloat*)VP.m);
+}
+
+
+void ParticleRenderTechnique::SetCameraPosition(const Vector3f& Pos)
+{
+    glUniform3f(m_cameraPosLoc, Pos.x, Pos.y, Pos.z);
+}
+
+
+void ParticleRenderTechnique::SetColorTextureUnit(unsigned int TextureUnit)
+{
+    glUniform1i(m_colorMapLoc, TextureUnit);
+}
+
+
+void ParticleRenderTechnique::SetBillboardSize(float BillboardSize)
+{
+    glUniform1f(m_billboardSizeLoc, BillboardSize);
+}
@@ -16,9 +16,16 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <stddef.h>
+
 #include "ogldev_engine_common.h"
+#include "ogldev_gl_state.h"
+#include "ogldev_parallel.h"
 #include "ogldev_phong_renderer.h"
 
+#define INITIAL_NUM_INSTANCES 1024
+#define MIN_INSTANCES_PER_JOB 4096
+
 
 PhongRenderer::PhongRenderer()
 {
@@ -45,6 +52,16 @@ void PhongRenderer::InitPhongRenderer(int SubTech)
     m_lightingTech.SetTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
     //    m_lightingTech.SetSpecularExponentTextureUnit(SPECULAR_EXPONENT_UNIT_INDEX);
 
+    if (!m_instancedLightingTech.Init(LightingTechnique::SUBTECH_INSTANCED)) {
+        printf("Error initializing the instanced lighting technique\n");
+        exit(1);
+    }
+
+    m_instancedLightingTech.Enable();
+    m_instancedLightingTech.SetTextureUnit(COLOR_TEXTURE_UNIT_INDEX);
+
+    m_instanceBuffer.Init(INITIAL_NUM_INSTANCES * sizeof(BasicMesh::InstanceData));
+
     if (!m_skinningTech.Init()) {
         printf("Error initializing the skinning technique\n");
         exit(1);
@@ -59,7 +76,7 @@ void PhongRenderer::InitPhongRenderer(int SubTech)
         exit(1);
     }
 
-    glUseProgram(0);
+    GLState::UseProgram(0);
 }
 
 
@@ -71,10 +88,7 @@ void PhongRenderer::StartShadowPass()
 
 void PhongRenderer::SwitchToLightingTech()
 {
-    GLint cur_prog = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &cur_prog);
-
-    if (cur_prog != m_lightingTech.GetProgram()) {
+    if (GLState::GetProgram() != m_lightingTech.GetProgram()) {
         m_lightingTech.Enable();
     }
 }
@@ -82,15 +96,20 @@ void PhongRenderer::SwitchToLightingTech()
 
 void PhongRenderer::SwitchToSkinningTech()
 {
-    GLint cur_prog = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &cur_prog);
-
-    if (cur_prog != m_skinningTech.GetProgram()) {
+    if (GLState::GetProgram() != m_skinningTech.GetProgram()) {
         m_skinningTech.Enable();
     }
 }
 
 
+void PhongRenderer::SwitchToInstancedLightingTech()
+{
+    if (GLState::GetProgram() != m_instancedLightingTech.GetProgram()) {
+        m_instancedLightingTech.Enable();
+    }
+}
+
+
 void PhongRenderer::SetDirLight(const DirectionalLight& DirLight)
 {
     m_dirLight = DirLight;
@@ -100,6 +119,9 @@ void PhongRenderer::SetDirLight(const DirectionalLight& DirLight)
 
     m_skinningTech.Enable();
     m_skinningTech.SetDirectionalLight(m_dirLight, false);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetDirectionalLight(m_dirLight, false);
 }
 
 
@@ -126,6 +148,9 @@ void PhongRenderer::SetPointLights(uint NumLights, const PointLight* pPointLight
 
     m_skinningTech.Enable();
     m_skinningTech.SetPointLights(NumLights, pPointLights, false);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetPointLights(NumLights, pPointLights, false);
 }
 
 
@@ -152,6 +177,9 @@ void PhongRenderer::SetSpotLights(uint NumLights, const SpotLight* pSpotLights)
 
     m_skinningTech.Enable();
     m_skinningTech.SetSpotLights(NumLights, pSpotLights, false);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetSpotLights(NumLights, pSpotLights, false);
 }
 
 
@@ -237,6 +265,74 @@ void PhongRenderer::Render(BasicMesh* pMesh)
 }
 
 
+void PhongRenderer::RenderInstanced(BasicMesh* pMesh, uint NumInstances, const WorldTrans* pWorldTrans)
+{
+    if (!m_pCamera) {
+        printf("PhongRenderer: camera not initialized\n");
+        exit(0);
+    }
+
+    if (NumInstances == 0) {
+        return;
+    }
+
+    SwitchToInstancedLightingTech();
+
+    // The instanced shader lights in world space so the identity transform
+    // makes the 'local' light params equal to the world ones
+    WorldTrans Identity;
+    RefreshLightingPosAndDirs(Identity);
+
+    if (m_dirLight.DiffuseIntensity > 0.0) {
+        m_instancedLightingTech.SetDirectionalLight(m_dirLight);
+    }
+
+    m_instancedLightingTech.UpdatePointLightsPos(m_numPointLights, m_pointLights);
+
+    m_instancedLightingTech.UpdateSpotLightsPosAndDir(m_numSpotLights, m_spotLights);
+
+    m_instancedLightingTech.SetMaterial(pMesh->GetMaterial());
+
+    if (m_isPBR) {
+        m_instancedLightingTech.SetPBR(true);
+        m_instancedLightingTech.SetPBRMaterial(pMesh->GetPBRMaterial());
+    } else {
+        m_instancedLightingTech.SetPBR(false);
+    }
+
+    m_instancedLightingTech.SetCameraLocalPos(m_pCamera->GetPos());
+    m_instancedLightingTech.SetCameraWorldPos(m_pCamera->GetPos());
+
+    const Matrix4f& VP = m_pCamera->GetViewProjMatrix();
+
+    BasicMesh::InstanceData* pInstances =
+        (BasicMesh::InstanceData*)m_instanceBuffer.Map(NumInstances * sizeof(BasicMesh::InstanceData));
+
+    // Written straight into the mapped buffer. PackInstanceMatrices writes
+    // WVP/World pairs, the layout of InstanceData.
+    static_assert(sizeof(BasicMesh::InstanceData) == 2 * sizeof(Matrix4f), "InstanceData must be two matrices");
+    static_assert(offsetof(BasicMesh::InstanceData, World) == sizeof(Matrix4f), "World must follow WVP");
+
+    Matrix4f* pMatrices = (Matrix4f*)pInstances;
+
+    int Count = (int)NumInstances;
+    int NumJobs = std::max(1, std::min(m_jobs.GetNumThreads(), Count / MIN_INSTANCES_PER_JOB));
+    int JobSize = (Count + NumJobs - 1) / NumJobs;
+
+    m_jobs.Dispatch(NumJobs, [&](int Job, int) {
+        int Start = Job * JobSize;
+        int End = std::min(Start + JobSize, Count);
+        PackInstanceMatrices(VP, pWorldTrans + Start, End - Start, pMatrices + 2 * Start);
+    });
+
+    GLintptr Offset = m_instanceBuffer.Unmap();
+
+    pMesh->RenderInstanced(NumInstances, m_instanceBuffer.GetBuffer(), Offset);
+
+    m_instanceBuffer.Fence();
+}
+
+
 void PhongRenderer::RenderAnimation(SkinnedMesh* pMesh, float AnimationTimeSec, int AnimationIndex)
 {
     RenderAnimationCommon(pMesh);
@@ -344,6 +440,7 @@ void PhongRenderer::RenderToShadowMap(BasicMesh* pMesh, const SpotLight& SpotLig
     Matrix4f WVP = Projection * View * World;
 
     m_shadowMapTech.SetWVP(WVP);
+    m_shadowMapTech.CommitDraw();
 
     pMesh->Render();
 }
@@ -351,19 +448,23 @@ void PhongRenderer::RenderToShadowMap(BasicMesh* pMesh, const SpotLight& SpotLig
 
 void PhongRenderer::RefreshLightingPosAndDirs(BasicMesh* pMesh)
 {
-    WorldTrans& meshWorldTransform = pMesh->GetWorldTransform();
+    RefreshLightingPosAndDirs(pMesh->GetWorldTransform());
+}
+
 
+void PhongRenderer::RefreshLightingPosAndDirs(const WorldTrans& worldTransform)
+{
     if (m_dirLight.DiffuseIntensity > 0.0) {
-        m_dirLight.CalcLocalDirection(meshWorldTransform);
+        m_dirLight.CalcLocalDirection(worldTransform);
         //        m_dirLight.GetLocalDirection().Print();
     }
 
     for (uint i = 0 ; i < m_numPointLights ; i++) {
-        m_pointLights[i].CalcLocalPosition(meshWorldTransform);
+        m_pointLights[i].CalcLocalPosition(worldTransform);
     }
 
     for (uint i = 0 ; i < m_numSpotLights ; i++) {
-        m_spotLights[i].CalcLocalDirectionAndPosition(meshWorldTransform);
+        m_spotLights[i].CalcLocalDirectionAndPosition(worldTransform);
     }
 }
 
@@ -372,11 +473,7 @@ void PhongRenderer::GetWVP(BasicMesh* pMesh, Matrix4f& WVP)
 {
     WorldTrans& meshWorldTransform = pMesh->GetWorldTransform();
 
-    Matrix4f World = meshWorldTransform.GetMatrix();
-    Matrix4f View = m_pCamera->GetMatrix();
-    Matrix4f Projection = m_pCamera->GetProjectionMat();
-
-    WVP = Projection * View * World;
+    WVP = meshWorldTransform.GetWVP(*m_pCamera);
 }
 
 
@@ -387,6 +484,9 @@ void PhongRenderer::ControlRimLight(bool IsEnabled)
 
     m_skinningTech.Enable();
     m_skinningTech.ControlRimLight(IsEnabled);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.ControlRimLight(IsEnabled);
 }
 
 
@@ -397,6 +497,9 @@ void PhongRenderer::ControlCellShading(bool IsEnabled)
 
     m_skinningTech.Enable();
     m_skinningTech.ControlCellShading(IsEnabled);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.ControlCellShading(IsEnabled);
 }
 
 
@@ -409,6 +512,10 @@ void PhongRenderer::SetLinearFog(float FogStart, float FogEnd, const Vector3f& F
     SwitchToSkinningTech();
     m_skinningTech.SetLinearFog(FogStart, FogEnd);
     m_skinningTech.SetFogColor(FogColor);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetLinearFog(FogStart, FogEnd);
+    m_instancedLightingTech.SetFogColor(FogColor);
 }
 
 
@@ -421,6 +528,10 @@ void PhongRenderer::SetExpFog(float FogEnd, const Vector3f& FogColor, float FogD
     SwitchToSkinningTech();
     m_skinningTech.SetExpFog(FogEnd, FogDensity);
     m_skinningTech.SetFogColor(FogColor);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetExpFog(FogEnd, FogDensity);
+    m_instancedLightingTech.SetFogColor(FogColor);
 }
 
 
@@ -433,6 +544,10 @@ void PhongRenderer::SetExpSquaredFog(float FogEnd, const Vector3f& FogColor, flo
     SwitchToSkinningTech();
     m_skinningTech.SetExpSquaredFog(FogEnd, FogDensity);
     m_skinningTech.SetFogColor(FogColor);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetExpSquaredFog(FogEnd, FogDensity);
+    m_instancedLightingTech.SetFogColor(FogColor);
 }
 
 
@@ -445,6 +560,10 @@ void PhongRenderer::SetLayeredFog(float FogTop, float FogEnd, const Vector3f& Fo
     SwitchToSkinningTech();
     m_skinningTech.SetLayeredFog(FogTop, FogEnd);
     m_skinningTech.SetFogColor(FogColor);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetLayeredFog(FogTop, FogEnd);
+    m_instancedLightingTech.SetFogColor(FogColor);
 }
 
 
@@ -457,6 +576,10 @@ void PhongRenderer::SetAnimatedFog(float FogEnd, float FogDensity, const Vector3
     SwitchToSkinningTech();
     m_skinningTech.SetAnimatedFog(FogEnd, FogDensity);
     m_skinningTech.SetFogColor(FogColor);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetAnimatedFog(FogEnd, FogDensity);
+    m_instancedLightingTech.SetFogColor(FogColor);
 }
 
 
@@ -467,6 +590,9 @@ void PhongRenderer::UpdateAnimatedFogTime(float FogTime)
 
     SwitchToSkinningTech();
     m_skinningTech.SetFogTime(FogTime);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetFogTime(FogTime);
 }
 
 void PhongRenderer::DisableFog()
@@ -476,6 +602,9 @@ void PhongRenderer::DisableFog()
 
     SwitchToSkinningTech();
     m_skinningTech.SetFogColor(Vector3f(0.0f, 0.0f, 0.0f));
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetFogColor(Vector3f(0.0f, 0.0f, 0.0f));
 }
 
 
@@ -488,6 +617,9 @@ void PhongRenderer::SetPBR(bool IsPBR)
 
     SwitchToSkinningTech();
     m_skinningTech.SetPBR(IsPBR);
+
+    SwitchToInstancedLightingTech();
+    m_instancedLightingTech.SetPBR(IsPBR);
 }
 
 
@@ -19,6 +19,7 @@
 
 #include "ogldev_shadow_cube_map_fbo.h"
 #include "ogldev_util.h"
+#include "ogldev_gl_state.h"
 
 
 ShadowCubeMapFBO::ShadowCubeMapFBO()
@@ -97,8 +98,8 @@ bool ShadowCubeMapFBO::Init(unsigned int size)
 
 void ShadowCubeMapFBO::BindForWriting(GLenum CubeFace)
 {
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
-    glViewport(0, 0, m_size, m_size);  // set the width/height of the shadow map!
+    GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    GLState::Viewport(0, 0, m_size, m_size);  // set the width/height of the shadow map!
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, CubeFace, m_shadowCubeMap, 0);
     glDrawBuffer(GL_COLOR_ATTACHMENT0);
 }
@@ -106,6 +107,5 @@ void ShadowCubeMapFBO::BindForWriting(GLenum CubeFace)
 
 void ShadowCubeMapFBO::BindForReading(GLenum TextureUnit)
 {
-    glActiveTexture(TextureUnit);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_shadowCubeMap);
+    GLState::BindTexture(TextureUnit, GL_TEXTURE_CUBE_MAP, m_shadowCubeMap);
 }
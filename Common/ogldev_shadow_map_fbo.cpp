@@ -20,6 +20,7 @@
 #include "ogldev_types.h"
 #include "ogldev_shadow_map_fbo.h"
 #include "ogldev_util.h"
+#include "ogldev_gl_state.h"
 #include "ogldev_engine_common.h"
 
 ShadowMapFBO::ShadowMapFBO()
@@ -141,32 +142,14 @@ bool ShadowMapFBO::InitDSA(unsigned int Width, unsigned int Height, bool ForPCF)
 
 void ShadowMapFBO::BindForWriting()
 {
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
-    glViewport(0, 0, m_width, m_height);  // set the width/height of the shadow map!
+    GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    GLState::Viewport(0, 0, m_width, m_height);  // set the width/height of the shadow map!
 }
 
 
 void ShadowMapFBO::BindForReading(GLenum TextureUnit)
 {
-    if (IsGLVersionHigher(4, 5)) {
-        BindForReadingDSA(TextureUnit);
-    }
-    else {
-        BindForReadingNonDSA(TextureUnit);
-    }
-}
-
-
-void ShadowMapFBO::BindForReadingNonDSA(GLenum TextureUnit)
-{
-    glActiveTexture(TextureUnit);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMap);
-}
-
-
-void ShadowMapFBO::BindForReadingDSA(GLenum TextureUnit)
-{
-    glBindTextureUnit(TextureUnit - GL_TEXTURE0, m_shadowMap);
+    GLState::BindTexture(TextureUnit, GL_TEXTURE_2D, m_shadowMap);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -226,18 +209,15 @@ bool CascadedShadowMapFBO::Init(unsigned int WindowWidth, unsigned int WindowHei
 void CascadedShadowMapFBO::BindForWriting(uint CascadeIndex)
 {
     assert(CascadeIndex < ARRAY_SIZE_IN_ELEMENTS(m_shadowMap));
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowMap[CascadeIndex], 0);
 }
 
 
 void CascadedShadowMapFBO::BindForReading()
 {
-    glActiveTexture(CASCACDE_SHADOW_TEXTURE_UNIT0);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMap[0]);
-
-    glActiveTexture(CASCACDE_SHADOW_TEXTURE_UNIT1);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMap[1]);
+    GLState::BindTexture(CASCACDE_SHADOW_TEXTURE_UNIT0, GL_TEXTURE_2D, m_shadowMap[0]);
+    GLState::BindTexture(CASCACDE_SHADOW_TEXTURE_UNIT1, GL_TEXTURE_2D, m_shadowMap[1]);
 
     glActiveTexture(CASCACDE_SHADOW_TEXTURE_UNIT2);
     glBindTexture(GL_TEXTURE_2D, m_shadowMap[2]);
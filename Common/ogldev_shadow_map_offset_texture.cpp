@@ -18,69 +18,383 @@
 
 #include <vector>
 #include <math.h>
-#include <random>
 
+#include "ogldev_util.h"
+#include "ogldev_mapped_file.h"
 #include "ogldev_math_3d.h"
+#include "ogldev_parallel.h"
 #include "ogldev_shadow_map_offset_texture.h"
 
-float jitter()
+#define OFFSET_TEXTURE_CACHE_MAGIC   0x4f46534d   // 'MSFO'
+#define OFFSET_TEXTURE_CACHE_VERSION 1
+
+struct OffsetTextureCacheHeader {
+    u32 Magic;
+    u32 Version;
+    u32 WindowSize;
+    u32 FilterSize;
+    u32 IsHalfFloat;
+    u32 DataSize;
+};
+
+
+// Stateless integer hash (lowbias32). Every sample derives its jitter from its
+// own index so the generator is deterministic and can be split across threads.
+static inline u32 HashU32(u32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+
+static inline float Jitter(u32 Index)
+{
+    // Top 24 bits mapped to [-0.5, 0.5). The constant keeps index zero from hashing to zero.
+    return (float)(HashU32(Index + 0x9e3779b9U) >> 8) * (1.0f / 16777216.0f) - 0.5f;
+}
+
+
+//
+// sin(2 pi x) and cos(2 pi x) for x in [0, 1]. x is split into the nearest
+// quarter turn Q and a remainder angle in [-pi/4, pi/4] where the Taylor
+// polynomials below are accurate to a few 1e-8. The quarter turn then
+// swaps/negates the results.
+//
+#define SIN_C3  (-1.0f / 6.0f)
+#define SIN_C5  (1.0f / 120.0f)
+#define SIN_C7  (-1.0f / 5040.0f)
+#define SIN_C9  (1.0f / 362880.0f)
+#define COS_C2  (-1.0f / 2.0f)
+#define COS_C4  (1.0f / 24.0f)
+#define COS_C6  (-1.0f / 720.0f)
+#define COS_C8  (1.0f / 40320.0f)
+
+static inline void SinCos2Pi(float x, float& Sin, float& Cos)
+{
+    int Q = (int)lrintf(x * 4.0f);
+    float t = (x - (float)Q * 0.25f) * 2.0f * (float)M_PI;
+    float t2 = t * t;
+
+    float s = t * (1.0f + t2 * (SIN_C3 + t2 * (SIN_C5 + t2 * (SIN_C7 + t2 * SIN_C9))));
+    float c = 1.0f + t2 * (COS_C2 + t2 * (COS_C4 + t2 * (COS_C6 + t2 * COS_C8)));
+
+    if (Q & 1) {
+        float Temp = s;
+        s = c;
+        c = Temp;
+    }
+
+    Sin = (Q & 2) ? -s : s;
+    Cos = ((Q + 1) & 2) ? -c : c;
+}
+
+
+#if defined(OGLDEV_MATH_SSE)
+
+// Four samples: (pRadius[i] * cos, pRadius[i] * sin) of 2 pi pX[i], interleaved
+static inline void PolarToCartesian4(const float* pRadius, const float* pX, float* pOut)
 {
-    static std::default_random_engine generator;
-    static std::uniform_real_distribution<float> distrib(-0.5f, 0.5f);
-    return distrib(generator);
+    __m128 x = _mm_loadu_ps(pX);
+    __m128i Q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(4.0f)));     // round to nearest
+    __m128 t = _mm_sub_ps(x, _mm_mul_ps(_mm_cvtepi32_ps(Q), _mm_set1_ps(0.25f)));
+    t = _mm_mul_ps(t, _mm_set1_ps(2.0f * (float)M_PI));
+    __m128 t2 = _mm_mul_ps(t, t);
+
+    __m128 s = _mm_add_ps(_mm_set1_ps(SIN_C7), _mm_mul_ps(t2, _mm_set1_ps(SIN_C9)));
+    s = _mm_add_ps(_mm_set1_ps(SIN_C5), _mm_mul_ps(t2, s));
+    s = _mm_add_ps(_mm_set1_ps(SIN_C3), _mm_mul_ps(t2, s));
+    s = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(t2, s));
+    s = _mm_mul_ps(t, s);
+
+    __m128 c = _mm_add_ps(_mm_set1_ps(COS_C6), _mm_mul_ps(t2, _mm_set1_ps(COS_C8)));
+    c = _mm_add_ps(_mm_set1_ps(COS_C4), _mm_mul_ps(t2, c));
+    c = _mm_add_ps(_mm_set1_ps(COS_C2), _mm_mul_ps(t2, c));
+    c = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(t2, c));
+
+    __m128 Swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(Q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 Sin = _mm_or_ps(_mm_and_ps(Swap, c), _mm_andnot_ps(Swap, s));
+    __m128 Cos = _mm_or_ps(_mm_and_ps(Swap, s), _mm_andnot_ps(Swap, c));
+
+    // Bit 1 of Q (of Q + 1 for the cosine) moved to the sign bit
+    __m128i Two = _mm_set1_epi32(2);
+    Sin = _mm_xor_ps(Sin, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(Q, Two), 30)));
+    Cos = _mm_xor_ps(Cos, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(Q, _mm_set1_epi32(1)), Two), 30)));
+
+    __m128 r = _mm_loadu_ps(pRadius);
+    Sin = _mm_mul_ps(r, Sin);
+    Cos = _mm_mul_ps(r, Cos);
+
+    _mm_storeu_ps(pOut, _mm_unpacklo_ps(Cos, Sin));
+    _mm_storeu_ps(pOut + 4, _mm_unpackhi_ps(Cos, Sin));
 }
 
+#elif defined(OGLDEV_MATH_NEON)
 
-static void GenOffsetTextureData(int WindowSize, int FilterSize, std::vector<float>& Data)
+static inline void PolarToCartesian4(const float* pRadius, const float* pX, float* pOut)
 {
-    int BufferSize = WindowSize * WindowSize * FilterSize * FilterSize * 2;
+    float32x4_t x = vld1q_f32(pX);
+    int32x4_t Q = vcvtnq_s32_f32(vmulq_n_f32(x, 4.0f));     // round to nearest
+    float32x4_t t = vsubq_f32(x, vmulq_n_f32(vcvtq_f32_s32(Q), 0.25f));
+    t = vmulq_n_f32(t, 2.0f * (float)M_PI);
+    float32x4_t t2 = vmulq_f32(t, t);
+
+    float32x4_t s = vmlaq_n_f32(vdupq_n_f32(SIN_C7), t2, SIN_C9);
+    s = vmlaq_f32(vdupq_n_f32(SIN_C5), t2, s);
+    s = vmlaq_f32(vdupq_n_f32(SIN_C3), t2, s);
+    s = vmlaq_f32(vdupq_n_f32(1.0f), t2, s);
+    s = vmulq_f32(t, s);
 
-    Data.resize(BufferSize);
+    float32x4_t c = vmlaq_n_f32(vdupq_n_f32(COS_C6), t2, COS_C8);
+    c = vmlaq_f32(vdupq_n_f32(COS_C4), t2, c);
+    c = vmlaq_f32(vdupq_n_f32(COS_C2), t2, c);
+    c = vmlaq_f32(vdupq_n_f32(1.0f), t2, c);
 
-    int Index = 0;
+    uint32x4_t Swap = vtstq_s32(Q, vdupq_n_s32(1));
+    float32x4_t Sin = vbslq_f32(Swap, c, s);
+    float32x4_t Cos = vbslq_f32(Swap, s, c);
 
-    for (int TexY = 0 ; TexY < WindowSize ; TexY++) {
-        for (int TexX = 0 ; TexX < WindowSize ; TexX++) {
-            for (int v = FilterSize - 1 ; v >= 0 ; v--) {
-                for (int u = 0 ; u < FilterSize ; u++) {
-                    float x = ((float)u + 0.5f + jitter()) / (float)FilterSize;
-                    float y = ((float)v + 0.5f + jitter()) / (float)FilterSize;
+    // Bit 1 of Q (of Q + 1 for the cosine) moved to the sign bit
+    uint32x4_t SinSign = vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(Q), vdupq_n_u32(2)), 30);
+    uint32x4_t CosSign = vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(vaddq_s32(Q, vdupq_n_s32(1))), vdupq_n_u32(2)), 30);
+    Sin = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(Sin), SinSign));
+    Cos = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(Cos), CosSign));
 
-                    assert(Index + 1 < Data.size());
-                    Data[Index]     = sqrtf(y) * cosf(2 * (float)M_PI * x);
-                    Data[Index + 1] = sqrtf(y) * sinf(2 * (float)M_PI * x);
+    float32x4_t r = vld1q_f32(pRadius);
 
-                    Index += 2;
+    float32x4x2_t Out;
+    Out.val[0] = vmulq_f32(r, Cos);
+    Out.val[1] = vmulq_f32(r, Sin);
+    vst2q_f32(pOut, Out);
+}
+
+#else
+
+static inline void PolarToCartesian4(const float* pRadius, const float* pX, float* pOut)
+{
+    for (int i = 0 ; i < 4 ; i++) {
+        float Sin, Cos;
+        SinCos2Pi(pX[i], Sin, Cos);
+        pOut[i * 2]     = pRadius[i] * Cos;
+        pOut[i * 2 + 1] = pRadius[i] * Sin;
+    }
+}
+
+#endif
+
+
+void ShadowMapOffsetTexture::GenOffsetTextureData(int WindowSize, int FilterSize, std::vector<float>& Data)
+{
+    int NumFilterSamples = FilterSize * FilterSize;
+    int TexelSize = NumFilterSamples * 2;
+
+    Data.resize((size_t)WindowSize * WindowSize * TexelSize);
+
+    float* pData = Data.data();
+
+    ParallelFor(0, WindowSize, [&](int StartY, int EndY) {
+        // Scratch arrays in SoA layout for the polar to cartesian kernel
+        std::vector<float> Radius(NumFilterSamples);
+        std::vector<float> Turns(NumFilterSamples);     // the angle in full turns
+
+        for (int TexY = StartY ; TexY < EndY ; TexY++) {
+            for (int TexX = 0 ; TexX < WindowSize ; TexX++) {
+                u32 TexelIndex = (u32)(TexY * WindowSize + TexX);
+                u32 Seed = TexelIndex * (u32)NumFilterSamples * 2;
+
+                int i = 0;
+
+                for (int v = FilterSize - 1 ; v >= 0 ; v--) {
+                    for (int u = 0 ; u < FilterSize ; u++) {
+                        Turns[i] = ((float)u + 0.5f + Jitter(Seed + i * 2)) / (float)FilterSize;
+                        float y = ((float)v + 0.5f + Jitter(Seed + i * 2 + 1)) / (float)FilterSize;
+                        Radius[i] = sqrtf(y);
+                        i++;
+                    }
+                }
+
+                float* pTexel = pData + (size_t)TexelIndex * TexelSize;
+
+                int s = 0;
+
+                for ( ; s + 4 <= NumFilterSamples ; s += 4) {
+                    PolarToCartesian4(&Radius[s], &Turns[s], pTexel + s * 2);
+                }
+
+                for ( ; s < NumFilterSamples ; s++) {
+                    float Sin, Cos;
+                    SinCos2Pi(Turns[s], Sin, Cos);
+                    pTexel[s * 2]     = Radius[s] * Cos;
+                    pTexel[s * 2 + 1] = Radius[s] * Sin;
                 }
             }
         }
+    });
+}
+
+
+static inline u16 FloatToHalf(float f)
+{
+    u32 x;
+    memcpy(&x, &f, sizeof(x));
+
+    u32 Sign = (x >> 16) & 0x8000;
+    int Exp = (int)((x >> 23) & 0xff) - 127 + 15;
+    u32 Mantissa = x & 0x7fffff;
+
+    if (Exp <= 0) {
+        // Offsets are in [-1, 1] so denormals are flushed to zero
+        return (u16)Sign;
+    }
+
+    if (Exp >= 31) {
+        return (u16)(Sign | 0x7bff);   // clamp to the largest finite half
+    }
+
+    // Round to nearest
+    u32 h = Sign | ((u32)Exp << 10) | (Mantissa >> 13);
+
+    if (Mantissa & 0x1000) {
+        h++;
     }
+
+    return (u16)h;
+}
+
+
+void ShadowMapOffsetTexture::ConvertToHalfFloat(const std::vector<float>& Data, std::vector<u16>& HalfData)
+{
+    HalfData.resize(Data.size());
+
+    const float* pSrc = Data.data();
+    u16* pDst = HalfData.data();
+
+    ParallelFor(0, (int)Data.size(), [&](int Start, int End) {
+        for (int i = Start ; i < End ; i++) {
+            pDst[i] = FloatToHalf(pSrc[i]);
+        }
+    }, 64 * 1024);
 }
 
 
-ShadowMapOffsetTexture::ShadowMapOffsetTexture(int WindowSize, int FilterSize)
+ShadowMapOffsetTexture::ShadowMapOffsetTexture(int WindowSize, int FilterSize, bool UseHalfFloat, const char* pCacheFilename)
 {
+    if (pCacheFilename && LoadFromCache(pCacheFilename, WindowSize, FilterSize, UseHalfFloat)) {
+        return;
+    }
+
     std::vector<float> Data;
 
     GenOffsetTextureData(WindowSize, FilterSize, Data);
 
-    CreateTexture(WindowSize, FilterSize, Data);
+    if (UseHalfFloat) {
+        std::vector<u16> HalfData;
+        ConvertToHalfFloat(Data, HalfData);
+        CreateTexture(WindowSize, FilterSize, UseHalfFloat, HalfData.data());
+
+        if (pCacheFilename) {
+            SaveToCache(pCacheFilename, WindowSize, FilterSize, UseHalfFloat, HalfData.data(), HalfData.size() * sizeof(u16));
+        }
+    } else {
+        CreateTexture(WindowSize, FilterSize, UseHalfFloat, Data.data());
+
+        if (pCacheFilename) {
+            SaveToCache(pCacheFilename, WindowSize, FilterSize, UseHalfFloat, Data.data(), Data.size() * sizeof(float));
+        }
+    }
+}
+
+
+ShadowMapOffsetTexture::~ShadowMapOffsetTexture()
+{
+    if (m_textureObj) {
+        glDeleteTextures(1, &m_textureObj);
+    }
 }
 
 
-void ShadowMapOffsetTexture::CreateTexture(int WindowSize, int FilterSize, const vector<float>& Data)
+static size_t CalcDataSize(int WindowSize, int FilterSize, bool UseHalfFloat)
+{
+    size_t ElemSize = UseHalfFloat ? sizeof(u16) : sizeof(float);
+    return (size_t)WindowSize * WindowSize * FilterSize * FilterSize * 2 * ElemSize;
+}
+
+
+static bool IsHeaderValid(const OffsetTextureCacheHeader& Header, int WindowSize, int FilterSize, bool UseHalfFloat)
+{
+    return (Header.Magic == OFFSET_TEXTURE_CACHE_MAGIC) &&
+           (Header.Version == OFFSET_TEXTURE_CACHE_VERSION) &&
+           (Header.WindowSize == (u32)WindowSize) &&
+           (Header.FilterSize == (u32)FilterSize) &&
+           (Header.IsHalfFloat == (u32)UseHalfFloat) &&
+           (Header.DataSize == CalcDataSize(WindowSize, FilterSize, UseHalfFloat));
+}
+
+
+bool ShadowMapOffsetTexture::LoadFromCache(const char* pCacheFilename, int WindowSize, int FilterSize, bool UseHalfFloat)
+{
+    MappedFile File;
+
+    if (!File.Open(pCacheFilename) || (File.GetSize() < sizeof(OffsetTextureCacheHeader))) {
+        return false;
+    }
+
+    const OffsetTextureCacheHeader* pHeader = (const OffsetTextureCacheHeader*)File.GetData();
+
+    if (!IsHeaderValid(*pHeader, WindowSize, FilterSize, UseHalfFloat) ||
+        (File.GetSize() < sizeof(OffsetTextureCacheHeader) + pHeader->DataSize)) {
+        return false;
+    }
+
+    // Upload straight from the mapped pages - no intermediate copy
+    CreateTexture(WindowSize, FilterSize, UseHalfFloat, (const char*)File.GetData() + sizeof(OffsetTextureCacheHeader));
+
+    return true;
+}
+
+
+void ShadowMapOffsetTexture::SaveToCache(const char* pCacheFilename, int WindowSize, int FilterSize, bool UseHalfFloat,
+                                         const void* pData, size_t DataSize)
+{
+    OffsetTextureCacheHeader Header;
+    Header.Magic = OFFSET_TEXTURE_CACHE_MAGIC;
+    Header.Version = OFFSET_TEXTURE_CACHE_VERSION;
+    Header.WindowSize = WindowSize;
+    Header.FilterSize = FilterSize;
+    Header.IsHalfFloat = UseHalfFloat;
+    Header.DataSize = (u32)DataSize;
+
+    std::vector<char> Buffer(sizeof(Header) + DataSize);
+    memcpy(Buffer.data(), &Header, sizeof(Header));
+    memcpy(Buffer.data() + sizeof(Header), pData, DataSize);
+
+    WriteBinaryFile(pCacheFilename, Buffer.data(), (int)Buffer.size());
+}
+
+
+void ShadowMapOffsetTexture::CreateTexture(int WindowSize, int FilterSize, bool UseHalfFloat, const void* pData)
 {
     int NumFilterSamples = FilterSize * FilterSize;
 
+    GLenum InternalFormat = UseHalfFloat ? GL_RGBA16F : GL_RGBA32F;
+    GLenum Type = UseHalfFloat ? GL_HALF_FLOAT : GL_FLOAT;
+
     glActiveTexture(GL_TEXTURE1);
 
     glGenTextures(1, &m_textureObj);
 
     glBindTexture(GL_TEXTURE_3D, m_textureObj);
 
-    glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32F, NumFilterSamples / 2, WindowSize, WindowSize );
+    glTexStorage3D(GL_TEXTURE_3D, 1, InternalFormat, NumFilterSamples / 2, WindowSize, WindowSize);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, NumFilterSamples / 2, WindowSize, WindowSize, GL_RGBA, Type, pData);
 
-    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, NumFilterSamples / 2, WindowSize, WindowSize, GL_RGBA, GL_FLOAT, &Data[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
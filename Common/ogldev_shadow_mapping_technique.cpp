@@ -42,14 +42,5 @@ bool ShadowMappingTechnique::Init()
         return false;
     }
 
-    m_WVPLoc = GetUniformLocation("gWVP");
-
-    return (m_WVPLoc != INVALID_UNIFORM_LOCATION);
-}
-
-
-
-void ShadowMappingTechnique::SetWVP(const Matrix4f& WVP)
-{
-    glUniformMatrix4fv(m_WVPLoc, 1, GL_TRUE, (const GLfloat*)WVP.m);
+    return m_drawBuffer.Init(m_shaderProg, "DrawBlock", SHADOW_MAPPING_DRAW_BINDING, sizeof(DrawBlock));
 }
@@ -42,29 +42,13 @@ bool ShadowMappingPointLightTechnique::Init()
         return false;
     }
 
-    m_WVPLoc = GetUniformLocation("gWVP");
-    m_worldMatrixLoc = GetUniformLocation("gWorld");
     m_lightWorldPosLoc = GetUniformLocation("gLightWorldPos");
 
-    if (m_WVPLoc == INVALID_UNIFORM_LOCATION ||
-        m_worldMatrixLoc == INVALID_UNIFORM_LOCATION ||
-        m_lightWorldPosLoc == INVALID_UNIFORM_LOCATION) {
+    if (m_lightWorldPosLoc == INVALID_UNIFORM_LOCATION) {
         return false;
     }
 
-    return true;
-}
-
-
-void ShadowMappingPointLightTechnique::SetWVP(const Matrix4f& WVP)
-{
-    glUniformMatrix4fv(m_WVPLoc, 1, GL_TRUE, (const GLfloat*)WVP.m);
-}
-
-
-void ShadowMappingPointLightTechnique::SetWorld(const Matrix4f& World)
-{
-    glUniformMatrix4fv(m_worldMatrixLoc, 1, GL_TRUE, (const GLfloat*)World.m);
+    return m_drawBuffer.Init(m_shaderProg, "DrawBlock", SHADOW_MAPPING_POINT_LIGHT_DRAW_BINDING, sizeof(DrawBlock));
 }
 
 
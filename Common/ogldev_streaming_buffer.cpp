@@ -0,0 +1,271 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "ogldev_util.h"
+#include "ogldev_streaming_buffer.h"
+
+// Keeps every region start legal as a uniform/storage buffer offset
+#define REGION_ALIGNMENT 256
+
+// Region size of a UniformDrawBuffer when BeginDraws() was not called
+#define DEFAULT_NUM_DRAWS 256
+
+
+static size_t AlignRegionSize(size_t Size)
+{
+    return (Size + REGION_ALIGNMENT - 1) & ~((size_t)REGION_ALIGNMENT - 1);
+}
+
+
+StreamingBuffer::~StreamingBuffer()
+{
+    DestroyBuffer();
+}
+
+
+void StreamingBuffer::Init(size_t RegionSize, int NumRegions)
+{
+    if (NumRegions <= 0) {
+        OGLDEV_ERROR("Invalid number of regions %d\n", NumRegions);
+        exit(0);
+    }
+
+    m_numRegions = NumRegions;
+    m_isPersistent = IsGLVersionHigher(4, 4);
+
+    CreateBuffer(RegionSize);
+}
+
+
+void StreamingBuffer::CreateBuffer(size_t RegionSize)
+{
+    m_regionSize = AlignRegionSize(RegionSize);
+    m_curRegion = 0;
+    m_fences.assign(m_numRegions, (GLsync)0);
+
+    size_t TotalSize = m_regionSize * m_numRegions;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+    if (m_isPersistent) {
+        GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, TotalSize, NULL, Flags);
+        m_pMappedData = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, TotalSize, Flags);
+
+        if (!m_pMappedData) {
+            OGLDEV_ERROR0("Error mapping the streaming buffer\n");
+            exit(0);
+        }
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, TotalSize, NULL, GL_STREAM_DRAW);
+        m_stagingData.resize(m_regionSize);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void StreamingBuffer::DestroyBuffer()
+{
+    for (int i = 0 ; i < (int)m_fences.size() ; i++) {
+        WaitForRegion(i);
+    }
+
+    if (m_buffer != 0) {
+        if (m_pMappedData) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            m_pMappedData = NULL;
+        }
+
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+}
+
+
+void StreamingBuffer::WaitForRegion(int Region)
+{
+    GLsync Fence = m_fences[Region];
+
+    if (!Fence) {
+        return;
+    }
+
+    GLenum Status = glClientWaitSync(Fence, 0, 0);
+
+    while ((Status != GL_ALREADY_SIGNALED) && (Status != GL_CONDITION_SATISFIED)) {
+        if (Status == GL_WAIT_FAILED) {
+            OGLDEV_ERROR0("glClientWaitSync failed\n");
+            break;
+        }
+
+        Status = glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1ms
+    }
+
+    glDeleteSync(Fence);
+    m_fences[Region] = (GLsync)0;
+}
+
+
+void* StreamingBuffer::Map(size_t Size)
+{
+    if (Size > m_regionSize) {
+        DestroyBuffer();
+        CreateBuffer(Size * 2);
+    }
+
+    m_curRegion = (m_curRegion + 1) % m_numRegions;
+    m_curSize = Size;
+
+    if (!m_isPersistent) {
+        return m_stagingData.data();
+    }
+
+    WaitForRegion(m_curRegion);
+
+    return m_pMappedData + m_curRegion * m_regionSize;
+}
+
+
+GLintptr StreamingBuffer::Unmap()
+{
+    GLintptr Offset = (GLintptr)(m_curRegion * m_regionSize);
+
+    if (!m_isPersistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, Offset, m_curSize, m_stagingData.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    return Offset;
+}
+
+
+GLintptr StreamingBuffer::FlushRange(size_t Start, size_t Size)
+{
+    GLintptr Offset = (GLintptr)(m_curRegion * m_regionSize + Start);
+
+    if (!m_isPersistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, Offset, Size, m_stagingData.data() + Start);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    return Offset;
+}
+
+
+void StreamingBuffer::Fence()
+{
+    if (m_isPersistent) {
+        m_fences[m_curRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+
+bool UniformDrawBuffer::Init(GLuint Program, const char* pBlockName, GLuint Binding, size_t DrawSize)
+{
+    GLuint BlockIndex = glGetUniformBlockIndex(Program, pBlockName);
+
+    if (BlockIndex == GL_INVALID_INDEX) {
+        printf("Cannot find uniform block '%s'\n", pBlockName);
+        return false;
+    }
+
+    glUniformBlockBinding(Program, BlockIndex, Binding);
+
+    // Catches a shader that was changed without the matching struct
+    GLint BlockSize = 0;
+    glGetActiveUniformBlockiv(Program, BlockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &BlockSize);
+
+    if ((size_t)BlockSize > DrawSize) {
+        printf("Uniform block '%s' is %d bytes but its struct is only %d bytes\n", pBlockName, BlockSize, (int)DrawSize);
+        return false;
+    }
+
+    GLint Alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &Alignment);
+
+    if (Alignment <= 0) {
+        Alignment = REGION_ALIGNMENT;
+    }
+
+    m_binding = Binding;
+    m_drawSize = DrawSize;
+    m_drawStride = ((DrawSize + Alignment - 1) / Alignment) * Alignment;
+
+    m_buffer.Init(m_drawStride * DEFAULT_NUM_DRAWS);
+
+    return true;
+}
+
+
+void UniformDrawBuffer::BeginDraws(unsigned int NumDraws)
+{
+    if (m_pDrawData) {
+        m_buffer.Fence();
+    }
+
+    MapRegion(NumDraws > 0 ? NumDraws : 1);
+}
+
+
+void UniformDrawBuffer::MapRegion(unsigned int NumDraws)
+{
+    m_pDrawData = (char*)m_buffer.Map(NumDraws * m_drawStride);
+    m_numDraws = 0;
+    m_maxDraws = NumDraws;
+}
+
+
+void UniformDrawBuffer::CommitDraw(const void* pData)
+{
+    if (m_numDraws == m_maxDraws) {
+        // Not started or more draws than BeginDraws() was told about - continue in another region
+        if (m_pDrawData) {
+            m_buffer.Fence();
+        }
+
+        MapRegion(m_maxDraws > 0 ? m_maxDraws : DEFAULT_NUM_DRAWS);
+    }
+
+    size_t Start = m_numDraws * m_drawStride;
+    memcpy(m_pDrawData + Start, pData, m_drawSize);
+    GLintptr Offset = m_buffer.FlushRange(Start, m_drawSize);
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, m_binding, m_buffer.GetBuffer(), Offset, m_drawSize);
+
+    m_numDraws++;
+}
+
+
+void UniformDrawBuffer::EndDraws()
+{
+    if (m_pDrawData) {
+        m_buffer.Fence();
+    }
+
+    m_pDrawData = NULL;
+    m_numDraws = 0;
+    m_maxDraws = 0;
+}
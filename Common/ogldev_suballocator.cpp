@@ -0,0 +1,485 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <assert.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ogldev_suballocator.h"
+
+// Don't split off free blocks smaller than this
+#define TLSF_MIN_BLOCK_SIZE 16
+
+
+static inline int FindMSB(u64 x)
+{
+#ifdef _MSC_VER
+    unsigned long Index;
+    _BitScanReverse64(&Index, x);
+    return (int)Index;
+#else
+    return 63 - __builtin_clzll(x);
+#endif
+}
+
+
+static inline int FindLSB(u64 x)
+{
+#ifdef _MSC_VER
+    unsigned long Index;
+    _BitScanForward64(&Index, x);
+    return (int)Index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+
+static inline u64 AlignUp(u64 Value, u64 Alignment)
+{
+    return (Value + Alignment - 1) / Alignment * Alignment;
+}
+
+
+static void MapSize(u64 Size, int& fl, int& sl)
+{
+    if (Size < TLSF_SL_COUNT) {
+        // The first level is linear - one list per size
+        fl = 0;
+        sl = (int)Size;
+    } else {
+        int MSB = FindMSB(Size);
+        fl = MSB - TLSF_SL_BITS + 1;
+        sl = (int)(Size >> (MSB - TLSF_SL_BITS)) - TLSF_SL_COUNT;
+    }
+}
+
+
+void TLSFAllocator::Init(u64 Size)
+{
+    m_blocks.clear();
+    m_unusedBlocks.clear();
+
+    for (int fl = 0 ; fl < TLSF_FL_COUNT ; fl++) {
+        m_slBitmap[fl] = 0;
+
+        for (int sl = 0 ; sl < TLSF_SL_COUNT ; sl++) {
+            m_freeLists[fl][sl] = SUBALLOC_INVALID_HANDLE;
+        }
+    }
+
+    m_flBitmap = 0;
+    m_size = Size;
+    m_usedSize = 0;
+    m_numAllocations = 0;
+    m_numFreeBlocks = 0;
+
+    u32 Index = NewBlock();
+    m_blocks[Index].Offset = 0;
+    m_blocks[Index].Size = Size;
+    InsertFreeBlock(Index);
+}
+
+
+u32 TLSFAllocator::NewBlock()
+{
+    if (!m_unusedBlocks.empty()) {
+        u32 Index = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+        m_blocks[Index] = Block();
+        return Index;
+    }
+
+    m_blocks.push_back(Block());
+    return (u32)m_blocks.size() - 1;
+}
+
+
+void TLSFAllocator::ReleaseBlock(u32 Index)
+{
+    m_blocks[Index].Size = 0;
+    m_unusedBlocks.push_back(Index);
+}
+
+
+void TLSFAllocator::InsertFreeBlock(u32 Index)
+{
+    Block& b = m_blocks[Index];
+
+    int fl, sl;
+    MapSize(b.Size, fl, sl);
+
+    b.IsFree = true;
+    b.PrevFree = SUBALLOC_INVALID_HANDLE;
+    b.NextFree = m_freeLists[fl][sl];
+
+    if (b.NextFree != SUBALLOC_INVALID_HANDLE) {
+        m_blocks[b.NextFree].PrevFree = Index;
+    }
+
+    m_freeLists[fl][sl] = Index;
+    m_flBitmap |= (1ull << fl);
+    m_slBitmap[fl] |= (1u << sl);
+    m_numFreeBlocks++;
+}
+
+
+void TLSFAllocator::RemoveFreeBlock(u32 Index)
+{
+    Block& b = m_blocks[Index];
+
+    int fl, sl;
+    MapSize(b.Size, fl, sl);
+
+    if (b.PrevFree != SUBALLOC_INVALID_HANDLE) {
+        m_blocks[b.PrevFree].NextFree = b.NextFree;
+    } else {
+        m_freeLists[fl][sl] = b.NextFree;
+
+        if (b.NextFree == SUBALLOC_INVALID_HANDLE) {
+            m_slBitmap[fl] &= ~(1u << sl);
+
+            if (m_slBitmap[fl] == 0) {
+                m_flBitmap &= ~(1ull << fl);
+            }
+        }
+    }
+
+    if (b.NextFree != SUBALLOC_INVALID_HANDLE) {
+        m_blocks[b.NextFree].PrevFree = b.PrevFree;
+    }
+
+    b.IsFree = false;
+    b.PrevFree = SUBALLOC_INVALID_HANDLE;
+    b.NextFree = SUBALLOC_INVALID_HANDLE;
+    m_numFreeBlocks--;
+}
+
+
+u32 TLSFAllocator::FindFreeBlock(u64 Size) const
+{
+    // Round up to the next list so that any block found is large enough
+    if (Size >= TLSF_SL_COUNT) {
+        Size += (1ull << (FindMSB(Size) - TLSF_SL_BITS)) - 1;
+    }
+
+    int fl, sl;
+    MapSize(Size, fl, sl);
+
+    if (fl >= TLSF_FL_COUNT) {
+        return SUBALLOC_INVALID_HANDLE;
+    }
+
+    u32 SLMap = m_slBitmap[fl] & (~0u << sl);
+
+    if (SLMap == 0) {
+        if (fl + 1 >= TLSF_FL_COUNT) {
+            return SUBALLOC_INVALID_HANDLE;
+        }
+
+        u64 FLMap = m_flBitmap & (~0ull << (fl + 1));
+
+        if (FLMap == 0) {
+            return SUBALLOC_INVALID_HANDLE;
+        }
+
+        fl = FindLSB(FLMap);
+        SLMap = m_slBitmap[fl];
+    }
+
+    sl = FindLSB(SLMap);
+
+    return m_freeLists[fl][sl];
+}
+
+
+bool TLSFAllocator::Allocate(u64 Size, u64 Alignment, u64& Offset, u32& Handle)
+{
+    if (Size == 0) {
+        Size = 1;
+    }
+
+    if (Alignment == 0) {
+        Alignment = 1;
+    }
+
+    u32 Index = FindFreeBlock(Size);
+
+    // The first candidate may be too small once its start is aligned
+    if ((Index != SUBALLOC_INVALID_HANDLE) &&
+        (AlignUp(m_blocks[Index].Offset, Alignment) + Size > m_blocks[Index].Offset + m_blocks[Index].Size)) {
+        Index = FindFreeBlock(Size + Alignment - 1);
+    }
+
+    if (Index == SUBALLOC_INVALID_HANDLE) {
+        return false;
+    }
+
+    RemoveFreeBlock(Index);
+
+    u64 AlignedOffset = AlignUp(m_blocks[Index].Offset, Alignment);
+    u64 Padding = AlignedOffset - m_blocks[Index].Offset;
+
+    // The block before is never free (it would have been merged) so the padding becomes a separate free block
+    if (Padding > 0) {
+        u32 PadIndex = NewBlock();
+        Block& Pad = m_blocks[PadIndex];
+        Block& b = m_blocks[Index];
+        Pad.Offset = b.Offset;
+        Pad.Size = Padding;
+        Pad.PrevPhys = b.PrevPhys;
+        Pad.NextPhys = Index;
+
+        if (b.PrevPhys != SUBALLOC_INVALID_HANDLE) {
+            m_blocks[b.PrevPhys].NextPhys = PadIndex;
+        }
+
+        b.PrevPhys = PadIndex;
+        b.Offset = AlignedOffset;
+        b.Size -= Padding;
+
+        InsertFreeBlock(PadIndex);
+    }
+
+    u64 Remainder = m_blocks[Index].Size - Size;
+
+    if (Remainder >= TLSF_MIN_BLOCK_SIZE) {
+        u32 TailIndex = NewBlock();
+        Block& Tail = m_blocks[TailIndex];
+        Block& b = m_blocks[Index];
+        Tail.Offset = b.Offset + Size;
+        Tail.Size = Remainder;
+        Tail.PrevPhys = Index;
+        Tail.NextPhys = b.NextPhys;
+
+        if (b.NextPhys != SUBALLOC_INVALID_HANDLE) {
+            m_blocks[b.NextPhys].PrevPhys = TailIndex;
+        }
+
+        b.NextPhys = TailIndex;
+        b.Size = Size;
+
+        InsertFreeBlock(TailIndex);
+    }
+
+    m_usedSize += m_blocks[Index].Size;
+    m_numAllocations++;
+
+    Offset = m_blocks[Index].Offset;
+    Handle = Index;
+
+    return true;
+}
+
+
+// Absorbs the next physical block into Index. Both must be out of the free lists.
+void TLSFAllocator::MergeWithNext(u32 Index)
+{
+    Block& b = m_blocks[Index];
+    u32 NextIndex = b.NextPhys;
+    Block& Next = m_blocks[NextIndex];
+
+    b.Size += Next.Size;
+    b.NextPhys = Next.NextPhys;
+
+    if (Next.NextPhys != SUBALLOC_INVALID_HANDLE) {
+        m_blocks[Next.NextPhys].PrevPhys = Index;
+    }
+
+    ReleaseBlock(NextIndex);
+}
+
+
+void TLSFAllocator::Free(u32 Handle)
+{
+    assert(Handle < m_blocks.size());
+    assert(!m_blocks[Handle].IsFree && (m_blocks[Handle].Size > 0));
+
+    m_usedSize -= m_blocks[Handle].Size;
+    m_numAllocations--;
+
+    u32 Index = Handle;
+
+    u32 NextIndex = m_blocks[Index].NextPhys;
+
+    if ((NextIndex != SUBALLOC_INVALID_HANDLE) && m_blocks[NextIndex].IsFree) {
+        RemoveFreeBlock(NextIndex);
+        MergeWithNext(Index);
+    }
+
+    u32 PrevIndex = m_blocks[Index].PrevPhys;
+
+    if ((PrevIndex != SUBALLOC_INVALID_HANDLE) && m_blocks[PrevIndex].IsFree) {
+        RemoveFreeBlock(PrevIndex);
+        MergeWithNext(PrevIndex);
+        Index = PrevIndex;
+    }
+
+    InsertFreeBlock(Index);
+}
+
+
+SubAllocatorStats TLSFAllocator::GetStats() const
+{
+    SubAllocatorStats Stats;
+    Stats.TotalSize = m_size;
+    Stats.UsedSize = m_usedSize;
+    Stats.NumAllocations = m_numAllocations;
+    Stats.NumFreeBlocks = m_numFreeBlocks;
+
+    // The largest block is in the highest non empty list
+    if (m_flBitmap != 0) {
+        int fl = FindMSB(m_flBitmap);
+        int sl = FindMSB(m_slBitmap[fl]);
+
+        for (u32 i = m_freeLists[fl][sl] ; i != SUBALLOC_INVALID_HANDLE ; i = m_blocks[i].NextFree) {
+            if (m_blocks[i].Size > Stats.LargestFreeBlock) {
+                Stats.LargestFreeBlock = m_blocks[i].Size;
+            }
+        }
+    }
+
+    return Stats;
+}
+
+
+bool TLSFAllocator::Validate() const
+{
+    u32 First = SUBALLOC_INVALID_HANDLE;
+
+    for (u32 i = 0 ; i < m_blocks.size() ; i++) {
+        if ((m_blocks[i].Size > 0) && (m_blocks[i].PrevPhys == SUBALLOC_INVALID_HANDLE)) {
+            if (First != SUBALLOC_INVALID_HANDLE) {
+                printf("TLSF: more than one first block\n");
+                return false;
+            }
+            First = i;
+        }
+    }
+
+    u64 Offset = 0;
+    u64 UsedSize = 0;
+    u32 NumAllocations = 0;
+    u32 NumFreeBlocks = 0;
+    bool PrevIsFree = false;
+
+    for (u32 i = First ; i != SUBALLOC_INVALID_HANDLE ; i = m_blocks[i].NextPhys) {
+        const Block& b = m_blocks[i];
+
+        if (b.Offset != Offset) {
+            printf("TLSF: block %d starts at %llu instead of %llu\n", i, (unsigned long long)b.Offset, (unsigned long long)Offset);
+            return false;
+        }
+
+        if (b.IsFree) {
+            if (PrevIsFree) {
+                printf("TLSF: two adjacent free blocks at %llu\n", (unsigned long long)b.Offset);
+                return false;
+            }
+
+            int fl, sl;
+            MapSize(b.Size, fl, sl);
+
+            bool Found = false;
+
+            for (u32 j = m_freeLists[fl][sl] ; j != SUBALLOC_INVALID_HANDLE ; j = m_blocks[j].NextFree) {
+                if (j == i) {
+                    Found = true;
+                    break;
+                }
+            }
+
+            if (!Found) {
+                printf("TLSF: free block %d is not in its list\n", i);
+                return false;
+            }
+
+            NumFreeBlocks++;
+        } else {
+            UsedSize += b.Size;
+            NumAllocations++;
+        }
+
+        PrevIsFree = b.IsFree;
+        Offset += b.Size;
+    }
+
+    if ((Offset != m_size) || (UsedSize != m_usedSize) ||
+        (NumAllocations != m_numAllocations) || (NumFreeBlocks != m_numFreeBlocks)) {
+        printf("TLSF: totals don't match\n");
+        return false;
+    }
+
+    return true;
+}
+
+
+void RingAllocator::Init(u64 Size)
+{
+    m_size = Size;
+    m_head = 0;
+    m_tail = 0;
+}
+
+
+bool RingAllocator::Allocate(u64 Size, u64 Alignment, u64& Offset)
+{
+    if (Alignment == 0) {
+        Alignment = 1;
+    }
+
+    // When the ring is empty restart at the beginning of the range so that
+    // a large allocation is not rejected because of where the head happens to be
+    if ((m_head == m_tail) && (m_head % m_size != 0)) {
+        m_head = m_tail = (m_head / m_size + 1) * m_size;
+    }
+
+    u64 Pos = m_head % m_size;
+    u64 Start = AlignUp(Pos, Alignment);
+    u64 Advance = 0;
+
+    if (Start + Size > m_size) {
+        // Skip the end of the range instead of wrapping the allocation
+        Start = 0;
+        Advance = (m_size - Pos) + Size;
+    } else {
+        Advance = (Start - Pos) + Size;
+    }
+
+    if ((Size > m_size) || (m_head + Advance - m_tail > m_size)) {
+        return false;
+    }
+
+    m_head += Advance;
+    Offset = Start;
+
+    return true;
+}
+
+
+void RingAllocator::Release(u64 Marker)
+{
+    assert(Marker <= m_head);
+
+    // Markers can be released out of order - older ones are already covered
+    if (Marker > m_tail) {
+        m_tail = Marker;
+    }
+}
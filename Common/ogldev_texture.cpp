@@ -18,8 +18,11 @@
 
 #include <iostream>
 #include <math.h>
+#include <limits.h>
 #include "ogldev_util.h"
 #include "ogldev_texture.h"
+#include "ogldev_gl_state.h"
+#include "ogldev_mapped_file.h"
 #include "3rdparty/stb_image.h"
 #include "3rdparty/stb_image_write.h"
 
@@ -49,7 +52,21 @@ bool Texture::Load()
 {
     stbi_set_flip_vertically_on_load(1);
 
-    unsigned char* pImageData = stbi_load(m_fileName.c_str(), &m_imageWidth, &m_imageHeight, &m_imageBPP, 0);
+    // stb decodes straight from the mapped pages instead of going through its own FILE buffer
+    MappedFile File;
+
+    if (!File.Open(m_fileName.c_str())) {
+        OGLDEV_FILE_ERROR(m_fileName.c_str());
+        exit(0);
+    }
+
+    if (File.GetSize() > INT_MAX) {
+        printf("Texture file '%s' is too big for stb_image\n", m_fileName.c_str());
+        exit(0);
+    }
+
+    unsigned char* pImageData = stbi_load_from_memory((const stbi_uc*)File.GetData(), (int)File.GetSize(),
+                                                      &m_imageWidth, &m_imageHeight, &m_imageBPP, 0);
 
     if (!pImageData) {
         printf("Can't load texture from '%s' - %s\n", m_fileName.c_str(), stbi_failure_reason());
@@ -60,6 +77,8 @@ bool Texture::Load()
 
     LoadInternal(pImageData);
 
+    stbi_image_free(pImageData);
+
     return true;
 }
 
@@ -134,6 +153,9 @@ void Texture::LoadInternalNonDSA(const void* pImageData)
     glGenerateMipmap(m_textureTarget);
 
     glBindTexture(m_textureTarget, 0);
+
+    // The binding of the active unit was changed behind the back of GLState
+    GLState::Invalidate();
 }
 
 void Texture::LoadInternalDSA(const void* pImageData)
@@ -183,18 +205,40 @@ void Texture::LoadInternalDSA(const void* pImageData)
 }
 
 
-void Texture::LoadF32(int Width, int Height, const float* pImageData)
+void Texture::LoadF32(int Width, int Height, const float* pImageData, int NumChannels)
 {
     if (!IsGLVersionHigher(4, 5)) {
         OGLDEV_ERROR("Non DSA version is not implemented\n");
     }
 
+    GLenum InternalFormat = GL_R32F;
+    GLenum Format = GL_RED;
+
+    switch (NumChannels) {
+    case 1:
+        break;
+
+    case 2:
+        InternalFormat = GL_RG32F;
+        Format = GL_RG;
+        break;
+
+    case 4:
+        InternalFormat = GL_RGBA32F;
+        Format = GL_RGBA;
+        break;
+
+    default:
+        OGLDEV_ERROR("Invalid number of channels %d\n", NumChannels);
+        exit(0);
+    }
+
     m_imageWidth = Width;
     m_imageHeight = Height;
 
     glCreateTextures(m_textureTarget, 1, &m_textureObj);
-    glTextureStorage2D(m_textureObj, 1, GL_R32F, m_imageWidth, m_imageHeight);
-    glTextureSubImage2D(m_textureObj, 0, 0, 0, m_imageWidth, m_imageHeight, GL_RED, GL_FLOAT, pImageData);
+    glTextureStorage2D(m_textureObj, 1, InternalFormat, m_imageWidth, m_imageHeight);
+    glTextureSubImage2D(m_textureObj, 0, 0, 0, m_imageWidth, m_imageHeight, Format, GL_FLOAT, pImageData);
 
     glTextureParameteri(m_textureObj, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTextureParameteri(m_textureObj, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -206,22 +250,5 @@ void Texture::LoadF32(int Width, int Height, const float* pImageData)
 
 void Texture::Bind(GLenum TextureUnit)
 {
-    if (IsGLVersionHigher(4, 5)) {
-        BindInternalDSA(TextureUnit);
-    } else {
-        BindInternalNonDSA(TextureUnit);
-    }
-}
-
-
-void Texture::BindInternalNonDSA(GLenum TextureUnit)
-{
-    glActiveTexture(TextureUnit);
-    glBindTexture(m_textureTarget, m_textureObj);
-}
-
-
-void Texture::BindInternalDSA(GLenum TextureUnit)
-{
-    glBindTextureUnit(TextureUnit - GL_TEXTURE0, m_textureObj);
+    GLState::BindTexture(TextureUnit, m_textureTarget, m_textureObj);
 }
@@ -36,75 +36,29 @@
 #include <stdarg.h>
 
 #include "ogldev_util.h"
+#include "ogldev_mapped_file.h"
 
 bool ReadFile(const char* pFileName, string& outFile)
 {
-    ifstream f(pFileName);
+    MappedFile File;
 
-    bool ret = false;
-
-    if (f.is_open()) {
-        string line;
-        while (getline(f, line)) {
-            outFile.append(line);
-            outFile.append("\n");
-        }
-
-        f.close();
-
-        ret = true;
-    }
-    else {
+    if (!File.Open(pFileName)) {
         OGLDEV_FILE_ERROR(pFileName);
+        return false;
     }
 
-    return ret;
-}
-
-
-#ifdef _WIN32
-char* ReadBinaryFile(const char* pFilename, int& size)
-{
-    FILE* f = NULL;
+    // One copy straight from the mapped pages instead of a getline + append per line
+    outFile.append((const char*)File.GetData(), (size_t)File.GetSize());
 
-    errno_t err = fopen_s(&f, pFilename, "rb");
-
-    if (!f) {
-        char buf[256] = { 0 };
-        strerror_s(buf, sizeof(buf), err);
-        OGLDEV_ERROR("Error opening '%s': %s\n", pFilename, buf);
-        exit(0);
-    }
-
-    struct stat stat_buf;
-    int error = stat(pFilename, &stat_buf);
-
-    if (error) {
-        char buf[256] = { 0 };
-        strerror_s(buf, sizeof(buf), err);
-        OGLDEV_ERROR("Error getting file stats: %s\n", buf);
-        return NULL;
-    }
-
-    size = stat_buf.st_size;
-
-    char* p = (char*)malloc(size);
-    assert(p);
-
-    size_t bytes_read = fread(p, 1, size, f);
-
-    if (bytes_read != size) {
-        char buf[256] = { 0 };
-        strerror_s(buf, sizeof(buf), err);
-        OGLDEV_ERROR("Read file error file: %s\n", buf);
-        exit(0);
+    if ((File.GetSize() > 0) && (outFile.back() != '\n')) {
+        outFile.append("\n");
     }
 
-    fclose(f);
-
-    return p;
+    return true;
 }
 
+
+#ifdef _WIN32
 void WriteBinaryFile(const char* pFilename, const void* pData, int size)
 {
     FILE* f = NULL;
@@ -127,41 +81,6 @@ void WriteBinaryFile(const char* pFilename, const void* pData, int size)
 }
 
 #else
-char* ReadBinaryFile(const char* pFilename, int& size)
-{
-    FILE* f = fopen(pFilename, "rb");
-
-    if (!f) {
-        OGLDEV_ERROR("Error opening '%s': %s\n", pFilename, strerror(errno));
-        exit(0);
-    }
-
-    struct stat stat_buf;
-    int error = stat(pFilename, &stat_buf);
-
-    if (error) {
-        OGLDEV_ERROR("Error getting file stats: %s\n", strerror(errno));
-        return NULL;
-    }
-
-    size = stat_buf.st_size;
-
-    char* p = (char*)malloc(size);
-    assert(p);
-
-    size_t bytes_read = fread(p, 1, size, f);
-
-    if (bytes_read != size) {
-        OGLDEV_ERROR("Read file error file: %s\n", strerror(errno));
-        exit(0);
-    }
-
-    fclose(f);
-
-    return p;
-}
-
-
 void WriteBinaryFile(const char* pFilename, const void* pData, int size)
 {
     FILE* f = fopen(pFilename, "wb");
@@ -23,6 +23,7 @@
 
 #include "ogldev_vulkan.h"
 #include "ogldev_util.h"
+#include "ogldev_mapped_file.h"
 
 
 void VulkanPrintImageUsageFlags(const VkImageUsageFlags& flags)
@@ -78,14 +79,18 @@ void VulkanEnumExtProps(std::vector<VkExtensionProperties>& ExtProps)
 
 VkShaderModule VulkanCreateShaderModule(VkDevice& device, const char* pFileName)
 {
-    int codeSize = 0;
-    char* pShaderCode = ReadBinaryFile(pFileName, codeSize);
-    assert(pShaderCode);
-  
+    MappedFile ShaderFile;
+
+    if (!ShaderFile.Open(pFileName)) {
+        OGLDEV_FILE_ERROR(pFileName);
+        exit(1);
+    }
+
+    // The mapping is page aligned so the SPIR-V words are passed without a copy
     VkShaderModuleCreateInfo shaderCreateInfo = {};
     shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shaderCreateInfo.codeSize = codeSize;
-    shaderCreateInfo.pCode = (const uint32_t*)pShaderCode;
+    shaderCreateInfo.codeSize = (size_t)ShaderFile.GetSize();
+    shaderCreateInfo.pCode = (const uint32_t*)ShaderFile.GetData();
     
     VkShaderModule shaderModule;
     VkResult res = vkCreateShaderModule(device, &shaderCreateInfo, NULL, &shaderModule);
@@ -106,6 +111,42 @@ uint VulkanGetPhysicalDevicesCount(const VkInstance& inst)
 }
 
 
+static void VulkanPrintMemoryTypes(const VkPhysicalDeviceMemoryProperties& MemProps)
+{
+    printf("Num memory types %d\n", MemProps.memoryTypeCount);
+    for (uint j = 0 ; j < MemProps.memoryTypeCount ; j++) {
+        printf("%d: (%x) ", j, MemProps.memoryTypes[j].propertyFlags);
+        
+        if (MemProps.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+            printf("DEVICE LOCAL ");
+        }
+
+        if (MemProps.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            printf("HOST VISIBLE ");
+        }
+        
+        if (MemProps.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+            printf("HOST COHERENT ");
+        }
+
+        if (MemProps.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) {
+            printf("HOST CACHED ");
+        }
+
+        if (MemProps.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            printf("LAZILY ALLOCATED ");
+        }
+
+        if (MemProps.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_PROTECTED_BIT) {
+            printf("PROTECTED ");
+        }
+        
+        printf("\n");
+    }
+    printf("Num heap types %d\n", MemProps.memoryHeapCount);
+}
+
+
 void VulkanGetPhysicalDevices(const VkInstance& inst, const VkSurfaceKHR& Surface, VulkanPhysicalDevices& PhysDevices)
 {
     uint NumDevices = VulkanGetPhysicalDevicesCount(inst);
@@ -136,6 +177,15 @@ void VulkanGetPhysicalDevices(const VkInstance& inst, const VkSurfaceKHR& Surfac
 
         vkGetPhysicalDeviceQueueFamilyProperties(PhysDev, &NumQFamily, &(PhysDevices.m_qFamilyProps[i][0]));
         
+        vkGetPhysicalDeviceMemoryProperties(PhysDev, &PhysDevices.m_memProps[i]);
+
+        VulkanPrintMemoryTypes(PhysDevices.m_memProps[i]);
+
+        // Headless devices (no surface) skip all the presentation queries
+        if (Surface == VK_NULL_HANDLE) {
+            continue;
+        }
+
         for (uint q = 0 ; q < NumQFamily ; q++) {
             res = vkGetPhysicalDeviceSurfaceSupportKHR(PhysDev, q, Surface, &(PhysDevices.m_qSupportsPresent[i][q]));
             CHECK_VULKAN_ERROR("vkGetPhysicalDeviceSurfaceSupportKHR error %d\n", res);
@@ -168,40 +218,6 @@ void VulkanGetPhysicalDevices(const VkInstance& inst, const VkSurfaceKHR& Surfac
         assert(NumPresentModes != 0);
 
         printf("Number of presentation modes %d\n", NumPresentModes);
-        
-        vkGetPhysicalDeviceMemoryProperties(PhysDev, &PhysDevices.m_memProps[i]);
-        
-        printf("Num memory types %d\n", PhysDevices.m_memProps[i].memoryTypeCount);
-        for (uint j = 0 ; j < PhysDevices.m_memProps[i].memoryTypeCount ; j++) {
-            printf("%d: (%x) ", j, PhysDevices.m_memProps[i].memoryTypes[j].propertyFlags);
-            
-            if (PhysDevices.m_memProps[i].memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-                printf("DEVICE LOCAL ");
-            }
-
-            if (PhysDevices.m_memProps[i].memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
-                printf("HOST VISIBLE ");
-            }
-            
-            if (PhysDevices.m_memProps[i].memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
-                printf("HOST COHERENT ");
-            }
-
-            if (PhysDevices.m_memProps[i].memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) {
-                printf("HOST CACHED ");
-            }
-
-            if (PhysDevices.m_memProps[i].memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
-                printf("LAZILY ALLOCATED ");
-            }
-
-            if (PhysDevices.m_memProps[i].memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_PROTECTED_BIT) {
-                printf("PROTECTED ");
-            }
-            
-            printf("\n");
-        }
-        printf("Num heap types %d\n", PhysDevices.m_memProps[i].memoryHeapCount);
     }
 }
 
@@ -18,9 +18,28 @@
 
 #ifdef OGLDEV_VULKAN
 
+#include <string.h>
+
 #include "ogldev_util.h"
+#include "ogldev_mapped_file.h"
 #include "ogldev_vulkan_core.h"
 
+#define PIPELINE_CACHE_MAGIC   0x4350474f   // 'OGPC'
+#define PIPELINE_CACHE_VERSION 1
+
+// Drivers are supposed to reject a cache blob from another device or driver but
+// some of them crash on it, so the blob is wrapped with our own header
+struct PipelineCacheFileHeader {
+    u32 Magic;
+    u32 Version;
+    u32 VendorID;
+    u32 DeviceID;
+    u32 DriverVersion;
+    u8 PipelineCacheUUID[VK_UUID_SIZE];
+    u32 DataSize;
+    u32 DataHash;
+};
+
 PFN_vkCreateDebugReportCallbackEXT my_vkCreateDebugReportCallbackEXT = NULL;
 
 
@@ -46,12 +65,26 @@ OgldevVulkanCore::OgldevVulkanCore(const char* pAppName)
     m_appName = std::string(pAppName);
     m_gfxDevIndex = -1;
     m_gfxQueueFamily = -1;
+    m_surface = VK_NULL_HANDLE;
+    m_pipelineCache = VK_NULL_HANDLE;
+    m_isHeadless = false;
+
+    m_pipelineCacheFilename = m_appName + "_pipeline_cache.bin";
+
+    for (uint i = 0 ; i < m_pipelineCacheFilename.size() ; i++) {
+        if (m_pipelineCacheFilename[i] == ' ') {
+            m_pipelineCacheFilename[i] = '_';
+        }
+    }
 }
 
 
 OgldevVulkanCore::~OgldevVulkanCore()
 {
-
+    if (m_pipelineCache != VK_NULL_HANDLE) {
+        SavePipelineCache();
+        vkDestroyPipelineCache(m_device, m_pipelineCache, NULL);
+    }
 }
 
 
@@ -70,6 +103,20 @@ void OgldevVulkanCore::Init(VulkanWindowControl* pWindowControl)
     VulkanGetPhysicalDevices(m_inst, m_surface, m_physDevices);
     SelectPhysicalDevice();
     CreateLogicalDevice();
+    CreatePipelineCache();
+}
+
+
+void OgldevVulkanCore::InitHeadless()
+{
+    m_isHeadless = true;
+
+    CreateInstance();
+
+    VulkanGetPhysicalDevices(m_inst, VK_NULL_HANDLE, m_physDevices);
+    SelectPhysicalDevice();
+    CreateLogicalDevice();
+    CreatePipelineCache();
 }
 
 const VkPhysicalDevice& OgldevVulkanCore::GetPhysDevice() const
@@ -78,6 +125,12 @@ const VkPhysicalDevice& OgldevVulkanCore::GetPhysDevice() const
     return m_physDevices.m_devices[m_gfxDevIndex];
 }
 
+const VkPhysicalDeviceProperties& OgldevVulkanCore::GetPhysDeviceProps() const
+{
+    assert(m_gfxDevIndex >= 0);
+    return m_physDevices.m_devProps[m_gfxDevIndex];
+}
+
 const VkSurfaceFormatKHR& OgldevVulkanCore::GetSurfaceFormat() const
 {
     assert(m_gfxDevIndex >= 0);
@@ -109,7 +162,7 @@ void OgldevVulkanCore::SelectPhysicalDevice()
                     (flags & VK_QUEUE_SPARSE_BINDING_BIT) ? "Yes" : "No");
 
             if ((flags & VK_QUEUE_GRAPHICS_BIT) && (m_gfxDevIndex == -1)) {
-                if (!m_physDevices.m_qSupportsPresent[i][j]) {
+                if (!m_isHeadless && !m_physDevices.m_qSupportsPresent[i][j]) {
                     printf("Present is not supported\n");
                     continue;
                 }
@@ -136,17 +189,19 @@ void OgldevVulkanCore::CreateInstance()
     appInfo.engineVersion = 1;
     appInfo.apiVersion = VK_API_VERSION_1_0;
 
-    const char* pInstExt[] = {
+    std::vector<const char*> InstExt;
 #ifdef ENABLE_DEBUG_LAYERS
-        VK_EXT_DEBUG_REPORT_EXTENSION_NAME,
+    InstExt.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 #endif
-        VK_KHR_SURFACE_EXTENSION_NAME,
+
+    if (!m_isHeadless) {
+        InstExt.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 #ifdef _WIN32
-        VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
+        InstExt.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #else
-        VK_KHR_XCB_SURFACE_EXTENSION_NAME
+        InstExt.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
 #endif
-    };
+    }
 
 #ifdef ENABLE_DEBUG_LAYERS
     const char* pInstLayers[] = {
@@ -161,8 +216,8 @@ void OgldevVulkanCore::CreateInstance()
     instInfo.enabledLayerCount = ARRAY_SIZE_IN_ELEMENTS(pInstLayers);
     instInfo.ppEnabledLayerNames = pInstLayers;
 #endif
-    instInfo.enabledExtensionCount = ARRAY_SIZE_IN_ELEMENTS(pInstExt);
-    instInfo.ppEnabledExtensionNames = pInstExt;
+    instInfo.enabledExtensionCount = (u32)InstExt.size();
+    instInfo.ppEnabledExtensionNames = InstExt.empty() ? NULL : InstExt.data();
 
     VkResult res = vkCreateInstance(&instInfo, NULL, &m_inst);
     CHECK_VULKAN_ERROR("vkCreateInstance %d\n", res);
@@ -204,8 +259,9 @@ void OgldevVulkanCore::CreateLogicalDevice()
 
     VkDeviceCreateInfo devInfo = {};
     devInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    devInfo.enabledExtensionCount = ARRAY_SIZE_IN_ELEMENTS(pDevExt);
-    devInfo.ppEnabledExtensionNames = pDevExt;
+    // A headless device never creates a swap chain
+    devInfo.enabledExtensionCount = m_isHeadless ? 0 : ARRAY_SIZE_IN_ELEMENTS(pDevExt);
+    devInfo.ppEnabledExtensionNames = m_isHeadless ? NULL : pDevExt;
     devInfo.queueCreateInfoCount = 1;
     devInfo.pQueueCreateInfos = &qInfo;
 
@@ -217,6 +273,149 @@ void OgldevVulkanCore::CreateLogicalDevice()
 }
 
 
+// FNV-1a
+static u32 HashPipelineCacheData(const char* pData, size_t Size)
+{
+    u32 Hash = 2166136261U;
+
+    for (size_t i = 0 ; i < Size ; i++) {
+        Hash ^= (u8)pData[i];
+        Hash *= 16777619U;
+    }
+
+    return Hash;
+}
+
+
+static void InitPipelineCacheHeader(PipelineCacheFileHeader& Header, const VkPhysicalDeviceProperties& Props)
+{
+    memset(&Header, 0, sizeof(Header));
+    Header.Magic = PIPELINE_CACHE_MAGIC;
+    Header.Version = PIPELINE_CACHE_VERSION;
+    Header.VendorID = Props.vendorID;
+    Header.DeviceID = Props.deviceID;
+    Header.DriverVersion = Props.driverVersion;
+    memcpy(Header.PipelineCacheUUID, Props.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+
+// On success pData points into the mapping of the file so File must stay open
+// until the pipeline cache has been created
+bool OgldevVulkanCore::LoadPipelineCacheFile(MappedFile& File, const void*& pData, size_t& DataSize)
+{
+    if (!File.Open(m_pipelineCacheFilename.c_str())) {
+        return false;
+    }
+
+    PipelineCacheFileHeader Expected;
+    InitPipelineCacheHeader(Expected, GetPhysDeviceProps());
+
+    if (File.GetSize() < sizeof(PipelineCacheFileHeader)) {
+        printf("Pipeline cache '%s' is truncated\n", m_pipelineCacheFilename.c_str());
+        return false;
+    }
+
+    const PipelineCacheFileHeader& Header = *(const PipelineCacheFileHeader*)File.GetData();
+
+    if ((Header.Magic != Expected.Magic) || (Header.Version != Expected.Version) ||
+        (Header.VendorID != Expected.VendorID) || (Header.DeviceID != Expected.DeviceID) ||
+        (Header.DriverVersion != Expected.DriverVersion) ||
+        (memcmp(Header.PipelineCacheUUID, Expected.PipelineCacheUUID, VK_UUID_SIZE) != 0)) {
+        printf("Pipeline cache '%s' was created by another device or driver - ignoring it\n", m_pipelineCacheFilename.c_str());
+        return false;
+    }
+
+    const char* p = (const char*)File.GetData() + sizeof(PipelineCacheFileHeader);
+
+    if ((File.GetSize() < sizeof(PipelineCacheFileHeader) + Header.DataSize) ||
+        (HashPipelineCacheData(p, Header.DataSize) != Header.DataHash)) {
+        printf("Pipeline cache '%s' is corrupted - ignoring it\n", m_pipelineCacheFilename.c_str());
+        return false;
+    }
+
+    pData = p;
+    DataSize = Header.DataSize;
+
+    return true;
+}
+
+
+void OgldevVulkanCore::CreatePipelineCache()
+{
+    MappedFile File;
+    const void* pData = NULL;
+    size_t DataSize = 0;
+    LoadPipelineCacheFile(File, pData, DataSize);
+
+    VkPipelineCacheCreateInfo cacheCreateInfo = {};
+    cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheCreateInfo.initialDataSize = DataSize;
+    cacheCreateInfo.pInitialData = pData;
+
+    VkResult res = vkCreatePipelineCache(m_device, &cacheCreateInfo, NULL, &m_pipelineCache);
+
+    if ((res != VK_SUCCESS) && (DataSize > 0)) {
+        // The driver rejected the blob - start with an empty cache
+        cacheCreateInfo.initialDataSize = 0;
+        cacheCreateInfo.pInitialData = NULL;
+        res = vkCreatePipelineCache(m_device, &cacheCreateInfo, NULL, &m_pipelineCache);
+        DataSize = 0;
+    }
+
+    CHECK_VULKAN_ERROR("vkCreatePipelineCache error %d\n", res);
+
+    printf("Pipeline cache created (%d bytes loaded from '%s')\n", (int)DataSize, m_pipelineCacheFilename.c_str());
+}
+
+
+void OgldevVulkanCore::SavePipelineCache()
+{
+    size_t DataSize = 0;
+    VkResult res = vkGetPipelineCacheData(m_device, m_pipelineCache, &DataSize, NULL);
+    CHECK_VULKAN_ERROR("vkGetPipelineCacheData error %d\n", res);
+
+    std::vector<char> Buffer(sizeof(PipelineCacheFileHeader) + DataSize);
+    char* pData = Buffer.data() + sizeof(PipelineCacheFileHeader);
+
+    res = vkGetPipelineCacheData(m_device, m_pipelineCache, &DataSize, pData);
+    CHECK_VULKAN_ERROR("vkGetPipelineCacheData error %d\n", res);
+
+    PipelineCacheFileHeader Header;
+    InitPipelineCacheHeader(Header, GetPhysDeviceProps());
+    Header.DataSize = (u32)DataSize;
+    Header.DataHash = HashPipelineCacheData(pData, DataSize);
+    memcpy(Buffer.data(), &Header, sizeof(Header));
+
+    // Write to a temporary file and rename it so that a crash in the middle never leaves a torn cache behind
+    std::string TempFilename = m_pipelineCacheFilename + ".tmp";
+
+    FILE* f = fopen(TempFilename.c_str(), "wb");
+
+    if (!f) {
+        printf("Cannot write the pipeline cache to '%s'\n", TempFilename.c_str());
+        return;
+    }
+
+    size_t BytesWritten = fwrite(Buffer.data(), 1, sizeof(Header) + DataSize, f);
+    fclose(f);
+
+    if (BytesWritten != sizeof(Header) + DataSize) {
+        printf("Error writing the pipeline cache to '%s'\n", TempFilename.c_str());
+        remove(TempFilename.c_str());
+        return;
+    }
+
+#ifdef _WIN32
+    remove(m_pipelineCacheFilename.c_str());    // rename() does not overwrite on Windows
+#endif
+
+    if (rename(TempFilename.c_str(), m_pipelineCacheFilename.c_str()) != 0) {
+        printf("Error renaming '%s' to '%s'\n", TempFilename.c_str(), m_pipelineCacheFilename.c_str());
+        remove(TempFilename.c_str());
+    }
+}
+
+
 u32 OgldevVulkanCore::GetMemoryTypeIndex(u32 memTypeBits, VkMemoryPropertyFlags reqMemPropFlags)
 {
     const VkPhysicalDeviceMemoryProperties& physDeviceMemProps = m_physDevices.m_memProps[m_gfxDevIndex];
@@ -0,0 +1,394 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef OGLDEV_VULKAN
+
+#include <chrono>
+
+#include "ogldev_vulkan_frames.h"
+
+
+static long long GetTimeMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+VulkanFramesInFlight::~VulkanFramesInFlight()
+{
+    Destroy();
+}
+
+
+void VulkanFramesInFlight::Init(OgldevVulkanCore* pCore, VkQueue Queue, int NumFrames, int NumImages)
+{
+    if ((NumFrames <= 0) || (NumFrames > MAX_FRAMES_IN_FLIGHT)) {
+        OGLDEV_ERROR("Invalid number of frames in flight %d\n", NumFrames);
+        exit(0);
+    }
+
+    m_pCore = pCore;
+    m_queue = Queue;
+    m_curFrame = 0;
+    m_lastBeginTime = 0;
+    m_frames.resize(NumFrames);
+    m_imageFences.assign(NumImages, VK_NULL_HANDLE);
+    m_curImage = 0;
+
+    for (int i = 0 ; i < NumImages ; i++) {
+        m_renderCompleteSems.push_back(m_pCore->CreateSemaphore());
+    }
+
+    VkDevice& Device = m_pCore->GetDevice();
+
+    for (int i = 0 ; i < NumFrames ; i++) {
+        Frame& f = m_frames[i];
+
+        f.ImageAvailableSem = m_pCore->CreateSemaphore();
+
+        // Created signaled so that the first BeginFrame() on each slot does not block
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        VkResult res = vkCreateFence(Device, &fenceInfo, NULL, &f.Fence);
+        CHECK_VULKAN_ERROR("vkCreateFence error %d\n", res);
+
+        // The whole pool is reset once per frame instead of the individual buffers
+        VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
+        cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        cmdPoolCreateInfo.queueFamilyIndex = m_pCore->GetQueueFamily();
+
+        res = vkCreateCommandPool(Device, &cmdPoolCreateInfo, NULL, &f.CmdPool);
+        CHECK_VULKAN_ERROR("vkCreateCommandPool error %d\n", res);
+
+        VkCommandBufferAllocateInfo cmdBufAllocInfo = {};
+        cmdBufAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmdBufAllocInfo.commandPool = f.CmdPool;
+        cmdBufAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmdBufAllocInfo.commandBufferCount = 1;
+
+        res = vkAllocateCommandBuffers(Device, &cmdBufAllocInfo, &f.CmdBuf);
+        CHECK_VULKAN_ERROR("vkAllocateCommandBuffers error %d\n", res);
+    }
+
+    printf("Created %d frames in flight\n", NumFrames);
+}
+
+
+void VulkanFramesInFlight::Destroy()
+{
+    if (m_frames.empty()) {
+        return;
+    }
+
+    WaitIdle();
+
+    VkDevice& Device = m_pCore->GetDevice();
+
+    for (uint i = 0 ; i < m_frames.size() ; i++) {
+        Frame& f = m_frames[i];
+        vkDestroyCommandPool(Device, f.CmdPool, NULL);
+        vkDestroyFence(Device, f.Fence, NULL);
+        vkDestroySemaphore(Device, f.ImageAvailableSem, NULL);
+    }
+
+    for (uint i = 0 ; i < m_renderCompleteSems.size() ; i++) {
+        vkDestroySemaphore(Device, m_renderCompleteSems[i], NULL);
+    }
+
+    m_frames.clear();
+    m_imageFences.clear();
+    m_renderCompleteSems.clear();
+}
+
+
+void VulkanFramesInFlight::WaitForFence(VkFence Fence)
+{
+    VkResult res = vkWaitForFences(m_pCore->GetDevice(), 1, &Fence, VK_TRUE, UINT64_MAX);
+    CHECK_VULKAN_ERROR("vkWaitForFences error %d\n", res);
+}
+
+
+void VulkanFramesInFlight::RunDeferredDeletes(Frame& f)
+{
+    for (uint i = 0 ; i < f.DeferredDeletes.size() ; i++) {
+        f.DeferredDeletes[i]();
+    }
+
+    f.DeferredDeletes.clear();
+}
+
+
+VkCommandBuffer VulkanFramesInFlight::BeginFrame()
+{
+    Frame& f = m_frames[m_curFrame];
+
+    long long WaitStart = GetTimeMicros();
+
+    bool Stalled = (vkGetFenceStatus(m_pCore->GetDevice(), f.Fence) == VK_NOT_READY);
+
+    if (Stalled) {
+        WaitForFence(f.Fence);
+    }
+
+    UpdateStats((double)(GetTimeMicros() - WaitStart) / 1000.0, Stalled);
+
+    // The fence stays signaled until Submit() so that a failed image acquire
+    // does not leave the slot with a fence that nothing will ever signal
+    RunDeferredDeletes(f);
+
+    VkResult res = vkResetCommandPool(m_pCore->GetDevice(), f.CmdPool, 0);
+    CHECK_VULKAN_ERROR("vkResetCommandPool error %d\n", res);
+
+    return f.CmdBuf;
+}
+
+
+void VulkanFramesInFlight::UpdateStats(double WaitMs, bool Stalled)
+{
+    long long Now = GetTimeMicros();
+
+    if (m_stats.NumFrames > 0) {
+        double FrameMs = (double)(Now - m_lastBeginTime) / 1000.0;
+        m_stats.TotalFrameMs += FrameMs;
+
+        if ((m_stats.NumFrames == 1) || (FrameMs < m_stats.MinFrameMs)) {
+            m_stats.MinFrameMs = FrameMs;
+        }
+
+        if (FrameMs > m_stats.MaxFrameMs) {
+            m_stats.MaxFrameMs = FrameMs;
+        }
+    }
+
+    m_lastBeginTime = Now;
+    m_stats.NumFrames++;
+
+    if (Stalled) {
+        m_stats.NumStalls++;
+    }
+
+    m_stats.TotalWaitMs += WaitMs;
+
+    if (WaitMs > m_stats.MaxWaitMs) {
+        m_stats.MaxWaitMs = WaitMs;
+    }
+}
+
+
+void VulkanFramesInFlight::WaitForImage(uint ImageIndex)
+{
+    if (ImageIndex >= m_imageFences.size()) {
+        m_imageFences.resize(ImageIndex + 1, VK_NULL_HANDLE);
+    }
+
+    while (ImageIndex >= m_renderCompleteSems.size()) {
+        m_renderCompleteSems.push_back(m_pCore->CreateSemaphore());
+    }
+
+    m_curImage = ImageIndex;
+
+    VkFence Fence = m_imageFences[ImageIndex];
+
+    if ((Fence != VK_NULL_HANDLE) && (Fence != m_frames[m_curFrame].Fence)) {
+        WaitForFence(Fence);
+    }
+
+    m_imageFences[ImageIndex] = m_frames[m_curFrame].Fence;
+}
+
+
+void VulkanFramesInFlight::Submit(VkCommandBuffer CmdBuf, VkPipelineStageFlags WaitStage)
+{
+    Frame& f = m_frames[m_curFrame];
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &CmdBuf;
+    submitInfo.pWaitSemaphores      = &f.ImageAvailableSem;
+    submitInfo.waitSemaphoreCount   = 1;
+    submitInfo.pWaitDstStageMask    = &WaitStage;
+    submitInfo.pSignalSemaphores    = &m_renderCompleteSems[m_curImage];
+    submitInfo.signalSemaphoreCount = 1;
+
+    VkResult res = vkResetFences(m_pCore->GetDevice(), 1, &f.Fence);
+    CHECK_VULKAN_ERROR("vkResetFences error %d\n", res);
+
+    res = vkQueueSubmit(m_queue, 1, &submitInfo, f.Fence);
+    CHECK_VULKAN_ERROR("vkQueueSubmit error %d\n", res);
+}
+
+
+void VulkanFramesInFlight::EndFrame()
+{
+    m_curFrame = (m_curFrame + 1) % (int)m_frames.size();
+}
+
+
+void VulkanFramesInFlight::DeferDestroy(const std::function<void()>& Func)
+{
+    m_frames[m_curFrame].DeferredDeletes.push_back(Func);
+}
+
+
+void VulkanFramesInFlight::WaitIdle()
+{
+    // Also covers the submissions that are not fenced by a frame slot
+    VkResult res = vkQueueWaitIdle(m_queue);
+    CHECK_VULKAN_ERROR("vkQueueWaitIdle error %d\n", res);
+
+    for (uint i = 0 ; i < m_frames.size() ; i++) {
+        RunDeferredDeletes(m_frames[i]);
+    }
+}
+
+
+VulkanOffscreenSwapChain::~VulkanOffscreenSwapChain()
+{
+    Destroy();
+}
+
+
+void VulkanOffscreenSwapChain::Init(OgldevVulkanCore* pCore, VkQueue Queue, uint Width, uint Height,
+                                    int NumImages, VkFormat Format)
+{
+    m_pCore = pCore;
+    m_queue = Queue;
+    m_width = Width;
+    m_height = Height;
+    m_format = Format;
+    m_nextImage = 0;
+
+    m_images.resize(NumImages);
+    m_views.resize(NumImages);
+    m_memory.resize(NumImages);
+
+    VkDevice& Device = m_pCore->GetDevice();
+
+    for (int i = 0 ; i < NumImages ; i++) {
+        VkImageCreateInfo imageCreateInfo = {};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = Format;
+        imageCreateInfo.extent.width = Width;
+        imageCreateInfo.extent.height = Height;
+        imageCreateInfo.extent.depth = 1;
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkResult res = vkCreateImage(Device, &imageCreateInfo, NULL, &m_images[i]);
+        CHECK_VULKAN_ERROR("vkCreateImage error %d\n", res);
+
+        VkMemoryRequirements memReqs;
+        vkGetImageMemoryRequirements(Device, m_images[i], &memReqs);
+
+        VkMemoryAllocateInfo memAllocInfo = {};
+        memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memAllocInfo.allocationSize = memReqs.size;
+        memAllocInfo.memoryTypeIndex = m_pCore->GetMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        res = vkAllocateMemory(Device, &memAllocInfo, NULL, &m_memory[i]);
+        CHECK_VULKAN_ERROR("vkAllocateMemory error %d\n", res);
+
+        res = vkBindImageMemory(Device, m_images[i], m_memory[i], 0);
+        CHECK_VULKAN_ERROR("vkBindImageMemory error %d\n", res);
+
+        VkImageViewCreateInfo ViewCreateInfo = {};
+        ViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ViewCreateInfo.image = m_images[i];
+        ViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        ViewCreateInfo.format = Format;
+        ViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        ViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        ViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        ViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        ViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        ViewCreateInfo.subresourceRange.baseMipLevel = 0;
+        ViewCreateInfo.subresourceRange.levelCount = 1;
+        ViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+        ViewCreateInfo.subresourceRange.layerCount = 1;
+
+        res = vkCreateImageView(Device, &ViewCreateInfo, NULL, &m_views[i]);
+        CHECK_VULKAN_ERROR("vkCreateImageView error %d\n", res);
+    }
+}
+
+
+void VulkanOffscreenSwapChain::Destroy()
+{
+    if (m_images.empty()) {
+        return;
+    }
+
+    VkDevice& Device = m_pCore->GetDevice();
+
+    vkQueueWaitIdle(m_queue);
+
+    for (uint i = 0 ; i < m_images.size() ; i++) {
+        vkDestroyImageView(Device, m_views[i], NULL);
+        vkDestroyImage(Device, m_images[i], NULL);
+        vkFreeMemory(Device, m_memory[i], NULL);
+    }
+
+    m_images.clear();
+    m_views.clear();
+    m_memory.clear();
+}
+
+
+void VulkanOffscreenSwapChain::AcquireNextImage(VkSemaphore SignalSem, uint& ImageIndex)
+{
+    ImageIndex = m_nextImage;
+    m_nextImage = (m_nextImage + 1) % (uint)m_images.size();
+
+    // An empty submission that only signals the semaphore, like the presentation engine does
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pSignalSemaphores    = &SignalSem;
+    submitInfo.signalSemaphoreCount = 1;
+
+    VkResult res = vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE);
+    CHECK_VULKAN_ERROR("vkQueueSubmit error %d\n", res);
+}
+
+
+void VulkanOffscreenSwapChain::Present(VkSemaphore WaitSem, uint ImageIndex)
+{
+    // Consume the render complete semaphore so it can be signaled again
+    VkPipelineStageFlags waitFlags = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pWaitSemaphores    = &WaitSem;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitDstStageMask  = &waitFlags;
+
+    VkResult res = vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE);
+    CHECK_VULKAN_ERROR("vkQueueSubmit error %d\n", res);
+}
+
+#endif
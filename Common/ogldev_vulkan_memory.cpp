@@ -0,0 +1,428 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef OGLDEV_VULKAN
+
+#include <string.h>
+
+#include "ogldev_vulkan_memory.h"
+
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+    Destroy();
+}
+
+
+void VulkanMemoryAllocator::Init(OgldevVulkanCore* pCore, VkDeviceSize BlockSize)
+{
+    m_pCore = pCore;
+    m_blockSize = BlockSize;
+    m_numDeviceAllocations = 0;
+}
+
+
+void VulkanMemoryAllocator::Destroy()
+{
+    for (int i = 0 ; i < (int)m_blocks.size() ; i++) {
+        if (m_blocks[i].Memory != VK_NULL_HANDLE) {
+            if (!m_blocks[i].Allocator.IsEmpty()) {
+                printf("Warning: destroying a memory block with %d live allocations\n", m_blocks[i].Allocator.GetStats().NumAllocations);
+            }
+
+            DestroyBlock(i);
+        }
+    }
+
+    m_blocks.clear();
+}
+
+
+int VulkanMemoryAllocator::CreateBlock(u32 MemoryTypeIndex, bool IsLinear, VkDeviceSize Size, bool IsDedicated)
+{
+    u32 MaxAllocations = m_pCore->GetPhysDeviceProps().limits.maxMemoryAllocationCount;
+
+    if ((u32)m_numDeviceAllocations >= MaxAllocations) {
+        OGLDEV_ERROR("Reached the limit of %d device memory allocations\n", MaxAllocations);
+        exit(0);
+    }
+
+    int Index = -1;
+
+    for (int i = 0 ; i < (int)m_blocks.size() ; i++) {
+        if (m_blocks[i].Memory == VK_NULL_HANDLE) {
+            Index = i;
+            break;
+        }
+    }
+
+    if (Index == -1) {
+        m_blocks.resize(m_blocks.size() + 1);
+        Index = (int)m_blocks.size() - 1;
+    }
+
+    MemoryBlock& Block = m_blocks[Index];
+
+    VkMemoryAllocateInfo memAllocInfo = {};
+    memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memAllocInfo.allocationSize = Size;
+    memAllocInfo.memoryTypeIndex = MemoryTypeIndex;
+
+    VkResult res = vkAllocateMemory(m_pCore->GetDevice(), &memAllocInfo, NULL, &Block.Memory);
+    CHECK_VULKAN_ERROR("vkAllocateMemory error %d\n", res);
+
+    Block.Size = Size;
+    Block.MemoryTypeIndex = MemoryTypeIndex;
+    Block.IsLinear = IsLinear;
+    Block.IsDedicated = IsDedicated;
+    Block.pMappedData = NULL;
+    Block.Allocator.Init(Size);
+
+    m_numDeviceAllocations++;
+
+    return Index;
+}
+
+
+void VulkanMemoryAllocator::DestroyBlock(int Index)
+{
+    MemoryBlock& Block = m_blocks[Index];
+
+    if (Block.pMappedData) {
+        vkUnmapMemory(m_pCore->GetDevice(), Block.Memory);
+        Block.pMappedData = NULL;
+    }
+
+    vkFreeMemory(m_pCore->GetDevice(), Block.Memory, NULL);
+    Block.Memory = VK_NULL_HANDLE;
+
+    m_numDeviceAllocations--;
+}
+
+
+VulkanAllocation VulkanMemoryAllocator::Allocate(const VkMemoryRequirements& MemReqs, VkMemoryPropertyFlags MemProps, bool IsLinear)
+{
+    u32 MemoryTypeIndex = m_pCore->GetMemoryTypeIndex(MemReqs.memoryTypeBits, MemProps);
+
+    bool IsHostVisible = (MemProps & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+
+    VkDeviceSize Alignment = MemReqs.alignment;
+
+    // Keeps flushes of non coherent memory from touching the neighbors
+    if (IsHostVisible && (Alignment < m_pCore->GetPhysDeviceProps().limits.nonCoherentAtomSize)) {
+        Alignment = m_pCore->GetPhysDeviceProps().limits.nonCoherentAtomSize;
+    }
+
+    int BlockIndex = -1;
+    u64 Offset = 0;
+    u32 Handle = SUBALLOC_INVALID_HANDLE;
+
+    if (MemReqs.size > m_blockSize / 2) {
+        BlockIndex = CreateBlock(MemoryTypeIndex, IsLinear, MemReqs.size, true);
+        m_blocks[BlockIndex].Allocator.Allocate(MemReqs.size, 1, Offset, Handle);
+    } else {
+        for (int i = 0 ; i < (int)m_blocks.size() ; i++) {
+            MemoryBlock& Block = m_blocks[i];
+
+            if ((Block.Memory != VK_NULL_HANDLE) && !Block.IsDedicated &&
+                (Block.MemoryTypeIndex == MemoryTypeIndex) && (Block.IsLinear == IsLinear) &&
+                Block.Allocator.Allocate(MemReqs.size, Alignment, Offset, Handle)) {
+                BlockIndex = i;
+                break;
+            }
+        }
+
+        if (BlockIndex == -1) {
+            BlockIndex = CreateBlock(MemoryTypeIndex, IsLinear, m_blockSize, false);
+            m_blocks[BlockIndex].Allocator.Allocate(MemReqs.size, Alignment, Offset, Handle);
+        }
+    }
+
+    MemoryBlock& Block = m_blocks[BlockIndex];
+
+    // The block may have been created by a device local request on the same memory type
+    if (IsHostVisible && !Block.pMappedData) {
+        VkResult res = vkMapMemory(m_pCore->GetDevice(), Block.Memory, 0, Block.Size, 0, &Block.pMappedData);
+        CHECK_VULKAN_ERROR("vkMapMemory error %d\n", res);
+    }
+
+    VulkanAllocation Alloc;
+    Alloc.Memory = Block.Memory;
+    Alloc.Offset = Offset;
+    Alloc.Size = MemReqs.size;
+    Alloc.pMappedData = Block.pMappedData ? (char*)Block.pMappedData + Offset : NULL;
+    Alloc.Block = BlockIndex;
+    Alloc.Handle = Handle;
+
+    return Alloc;
+}
+
+
+VulkanAllocation VulkanMemoryAllocator::AllocateBufferMemory(VkBuffer Buffer, VkMemoryPropertyFlags MemProps)
+{
+    VkMemoryRequirements memReqs = {};
+    vkGetBufferMemoryRequirements(m_pCore->GetDevice(), Buffer, &memReqs);
+
+    VulkanAllocation Alloc = Allocate(memReqs, MemProps, true);
+
+    VkResult res = vkBindBufferMemory(m_pCore->GetDevice(), Buffer, Alloc.Memory, Alloc.Offset);
+    CHECK_VULKAN_ERROR("vkBindBufferMemory error %d\n", res);
+
+    return Alloc;
+}
+
+
+VulkanAllocation VulkanMemoryAllocator::AllocateImageMemory(VkImage Image, VkMemoryPropertyFlags MemProps)
+{
+    VkMemoryRequirements memReqs = {};
+    vkGetImageMemoryRequirements(m_pCore->GetDevice(), Image, &memReqs);
+
+    VulkanAllocation Alloc = Allocate(memReqs, MemProps, false);
+
+    VkResult res = vkBindImageMemory(m_pCore->GetDevice(), Image, Alloc.Memory, Alloc.Offset);
+    CHECK_VULKAN_ERROR("vkBindImageMemory error %d\n", res);
+
+    return Alloc;
+}
+
+
+VkBuffer VulkanMemoryAllocator::CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags MemProps, VulkanAllocation& Alloc)
+{
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = Size;
+    bufferCreateInfo.usage = Usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer Buffer;
+    VkResult res = vkCreateBuffer(m_pCore->GetDevice(), &bufferCreateInfo, NULL, &Buffer);
+    CHECK_VULKAN_ERROR("vkCreateBuffer error %d\n", res);
+
+    Alloc = AllocateBufferMemory(Buffer, MemProps);
+
+    return Buffer;
+}
+
+
+void VulkanMemoryAllocator::DestroyBuffer(VkBuffer Buffer, VulkanAllocation& Alloc)
+{
+    vkDestroyBuffer(m_pCore->GetDevice(), Buffer, NULL);
+    Free(Alloc);
+}
+
+
+void VulkanMemoryAllocator::Free(VulkanAllocation& Alloc)
+{
+    if (Alloc.Block < 0) {
+        return;
+    }
+
+    MemoryBlock& Block = m_blocks[Alloc.Block];
+
+    Block.Allocator.Free(Alloc.Handle);
+
+    if (Block.IsDedicated) {
+        DestroyBlock(Alloc.Block);
+    }
+
+    Alloc = VulkanAllocation();
+}
+
+
+void VulkanMemoryAllocator::FreeEmptyBlocks()
+{
+    for (int i = 0 ; i < (int)m_blocks.size() ; i++) {
+        if ((m_blocks[i].Memory != VK_NULL_HANDLE) && m_blocks[i].Allocator.IsEmpty()) {
+            DestroyBlock(i);
+        }
+    }
+}
+
+
+SubAllocatorStats VulkanMemoryAllocator::GetStats() const
+{
+    SubAllocatorStats Total;
+
+    for (uint i = 0 ; i < m_blocks.size() ; i++) {
+        if (m_blocks[i].Memory == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        SubAllocatorStats Stats = m_blocks[i].Allocator.GetStats();
+
+        Total.TotalSize += Stats.TotalSize;
+        Total.UsedSize += Stats.UsedSize;
+        Total.NumAllocations += Stats.NumAllocations;
+        Total.NumFreeBlocks += Stats.NumFreeBlocks;
+
+        if (Stats.LargestFreeBlock > Total.LargestFreeBlock) {
+            Total.LargestFreeBlock = Stats.LargestFreeBlock;
+        }
+    }
+
+    return Total;
+}
+
+
+void VulkanMemoryAllocator::PrintStats() const
+{
+    SubAllocatorStats Stats = GetStats();
+
+    printf("Device memory: %d allocations in %d blocks, %.2f/%.2f MB used, %d free ranges, fragmentation %.2f\n",
+           Stats.NumAllocations, m_numDeviceAllocations,
+           (double)Stats.UsedSize / (1024.0 * 1024.0), (double)Stats.TotalSize / (1024.0 * 1024.0),
+           Stats.NumFreeBlocks, Stats.GetFragmentation());
+}
+
+
+VulkanStagingRing::~VulkanStagingRing()
+{
+    Destroy();
+}
+
+
+void VulkanStagingRing::Init(OgldevVulkanCore* pCore, VulkanMemoryAllocator* pAllocator, VkDeviceSize Size)
+{
+    m_pCore = pCore;
+    m_pAllocator = pAllocator;
+
+    m_buffer = m_pAllocator->CreateBuffer(Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                          m_alloc);
+    m_ring.Init(Size);
+    m_submittedMarker = m_ring.GetMarker();
+}
+
+
+void VulkanStagingRing::Destroy()
+{
+    if (m_buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    while (!m_pending.empty()) {
+        ReleaseOldest(true);
+    }
+
+    for (uint i = 0 ; i < m_freeFences.size() ; i++) {
+        vkDestroyFence(m_pCore->GetDevice(), m_freeFences[i], NULL);
+    }
+
+    m_freeFences.clear();
+
+    m_pAllocator->DestroyBuffer(m_buffer, m_alloc);
+    m_buffer = VK_NULL_HANDLE;
+}
+
+
+VkFence VulkanStagingRing::GetFence()
+{
+    if (!m_freeFences.empty()) {
+        VkFence Fence = m_freeFences.back();
+        m_freeFences.pop_back();
+        return Fence;
+    }
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence Fence;
+    VkResult res = vkCreateFence(m_pCore->GetDevice(), &fenceInfo, NULL, &Fence);
+    CHECK_VULKAN_ERROR("vkCreateFence error %d\n", res);
+
+    return Fence;
+}
+
+
+void VulkanStagingRing::ReleaseOldest(bool Wait)
+{
+    PendingSubmission& Oldest = m_pending.front();
+
+    if (Wait) {
+        VkResult res = vkWaitForFences(m_pCore->GetDevice(), 1, &Oldest.Fence, VK_TRUE, UINT64_MAX);
+        CHECK_VULKAN_ERROR("vkWaitForFences error %d\n", res);
+    }
+
+    m_ring.Release(Oldest.Marker);
+
+    VkResult res = vkResetFences(m_pCore->GetDevice(), 1, &Oldest.Fence);
+    CHECK_VULKAN_ERROR("vkResetFences error %d\n", res);
+
+    m_freeFences.push_back(Oldest.Fence);
+    m_pending.pop_front();
+}
+
+
+VkDeviceSize VulkanStagingRing::Upload(const void* pData, VkDeviceSize Size, VkDeviceSize Alignment)
+{
+    u64 Offset = 0;
+
+    while (!m_ring.Allocate(Size, Alignment, Offset)) {
+        if (m_pending.empty()) {
+            OGLDEV_ERROR("%d bytes do not fit in the staging ring (%d bytes)\n", (int)Size, (int)m_ring.GetSize());
+            exit(0);
+        }
+
+        ReleaseOldest(true);
+    }
+
+    memcpy((char*)m_alloc.pMappedData + Offset, pData, Size);
+
+    return Offset;
+}
+
+
+void VulkanStagingRing::CopyToBuffer(VkCommandBuffer CmdBuf, const void* pData, VkDeviceSize Size, VkBuffer Dst, VkDeviceSize DstOffset)
+{
+    VkBufferCopy bufferCopy = {};
+    bufferCopy.srcOffset = Upload(pData, Size);
+    bufferCopy.dstOffset = DstOffset;
+    bufferCopy.size = Size;
+
+    vkCmdCopyBuffer(CmdBuf, m_buffer, Dst, 1, &bufferCopy);
+}
+
+
+void VulkanStagingRing::Submit(VkQueue Queue)
+{
+    u64 Marker = m_ring.GetMarker();
+
+    if (Marker == m_submittedMarker) {
+        return;
+    }
+
+    // An empty submission - its fence signals when all the work submitted before it is done
+    VkFence Fence = GetFence();
+
+    VkResult res = vkQueueSubmit(Queue, 0, NULL, Fence);
+    CHECK_VULKAN_ERROR("vkQueueSubmit error %d\n", res);
+
+    PendingSubmission Submission = { Fence, Marker };
+    m_pending.push_back(Submission);
+    m_submittedMarker = Marker;
+}
+
+
+void VulkanStagingRing::Reclaim()
+{
+    while (!m_pending.empty() && (vkGetFenceStatus(m_pCore->GetDevice(), m_pending.front().Fence) == VK_SUCCESS)) {
+        ReleaseOldest(false);
+    }
+}
+
+#endif
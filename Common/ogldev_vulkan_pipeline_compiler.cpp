@@ -0,0 +1,120 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef OGLDEV_VULKAN
+
+#include "ogldev_vulkan_pipeline_compiler.h"
+
+
+VulkanPipelineCompiler::~VulkanPipelineCompiler()
+{
+    Destroy();
+}
+
+
+void VulkanPipelineCompiler::Init(OgldevVulkanCore* pCore, JobSystem* pJobs)
+{
+    m_pCore = pCore;
+    m_pJobs = pJobs;
+}
+
+
+void VulkanPipelineCompiler::Destroy()
+{
+    if (!m_pJobs) {
+        return;
+    }
+
+    // The tasks point to this object
+    {
+        std::unique_lock<std::mutex> Lock(m_mutex);
+        m_doneCond.wait(Lock, [this]() { return m_numInProgress == 0; });
+    }
+
+    m_pJobs = NULL;
+
+    // Nobody is going to receive these
+    for (uint i = 0 ; i < m_finished.size() ; i++) {
+        vkDestroyPipeline(m_pCore->GetDevice(), m_finished[i].Pipeline, NULL);
+    }
+
+    m_finished.clear();
+}
+
+
+void VulkanPipelineCompiler::Compile(const VulkanPipelineCreateFunc& CreateFunc, const VulkanPipelineReadyFunc& ReadyFunc)
+{
+    Request r;
+    r.CreateFunc = CreateFunc;
+    r.ReadyFunc = ReadyFunc;
+    r.Pipeline = VK_NULL_HANDLE;
+
+    {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        m_numInProgress++;
+    }
+
+    m_pJobs->Submit([this, r](int) { CompileRequest(r); });
+}
+
+
+int VulkanPipelineCompiler::Update()
+{
+    std::vector<Request> Finished;
+    int NumInProgress = 0;
+
+    {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        Finished.swap(m_finished);
+        NumInProgress = m_numInProgress;
+    }
+
+    // Outside the lock - a callback may queue more pipelines
+    for (uint i = 0 ; i < Finished.size() ; i++) {
+        Finished[i].ReadyFunc(Finished[i].Pipeline);
+    }
+
+    return NumInProgress;
+}
+
+
+void VulkanPipelineCompiler::WaitAll()
+{
+    do {
+        std::unique_lock<std::mutex> Lock(m_mutex);
+        m_doneCond.wait(Lock, [this]() { return m_numInProgress == 0; });
+    } while (Update() > 0);
+}
+
+
+void VulkanPipelineCompiler::CompileRequest(Request r)
+{
+    r.Pipeline = r.CreateFunc(m_pCore->GetDevice(), m_pCore->GetPipelineCache());
+
+    // Notify under the lock - Destroy() may return and free the compiler as
+    // soon as it sees the count drop to zero
+    std::lock_guard<std::mutex> Lock(m_mutex);
+    m_finished.push_back(r);
+    m_numInProgress--;
+
+    if (m_numInProgress == 0) {
+        m_doneCond.notify_all();
+    }
+}
+
+#endif
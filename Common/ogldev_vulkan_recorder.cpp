@@ -0,0 +1,167 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef OGLDEV_VULKAN
+
+#include "ogldev_vulkan_recorder.h"
+
+// More jobs than threads so that a thread that finishes early can pick up another chunk
+#define JOBS_PER_THREAD 2
+
+
+VulkanParallelRecorder::~VulkanParallelRecorder()
+{
+    Destroy();
+}
+
+
+void VulkanParallelRecorder::Init(OgldevVulkanCore* pCore, int NumFrames, int NumThreads)
+{
+    m_pCore = pCore;
+    m_pJobSystem = new JobSystem(NumThreads);
+    m_curFrame = 0;
+
+    int NumPoolThreads = m_pJobSystem->GetNumThreads();
+
+    m_pools.resize(NumFrames);
+
+    for (int f = 0 ; f < NumFrames ; f++) {
+        m_pools[f].resize(NumPoolThreads);
+
+        for (int t = 0 ; t < NumPoolThreads ; t++) {
+            VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
+            cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            cmdPoolCreateInfo.queueFamilyIndex = m_pCore->GetQueueFamily();
+
+            VkResult res = vkCreateCommandPool(m_pCore->GetDevice(), &cmdPoolCreateInfo, NULL, &m_pools[f][t].CmdPool);
+            CHECK_VULKAN_ERROR("vkCreateCommandPool error %d\n", res);
+        }
+    }
+
+    printf("Parallel recorder: %d threads, %d frames\n", NumPoolThreads, NumFrames);
+}
+
+
+void VulkanParallelRecorder::Destroy()
+{
+    if (!m_pJobSystem) {
+        return;
+    }
+
+    for (uint f = 0 ; f < m_pools.size() ; f++) {
+        for (uint t = 0 ; t < m_pools[f].size() ; t++) {
+            // Destroying the pool frees its command buffers
+            vkDestroyCommandPool(m_pCore->GetDevice(), m_pools[f][t].CmdPool, NULL);
+        }
+    }
+
+    m_pools.clear();
+
+    delete m_pJobSystem;
+    m_pJobSystem = NULL;
+}
+
+
+void VulkanParallelRecorder::BeginFrame(int Frame)
+{
+    m_curFrame = Frame;
+
+    std::vector<ThreadPool>& Pools = m_pools[Frame];
+
+    for (uint t = 0 ; t < Pools.size() ; t++) {
+        VkResult res = vkResetCommandPool(m_pCore->GetDevice(), Pools[t].CmdPool, 0);
+        CHECK_VULKAN_ERROR("vkResetCommandPool error %d\n", res);
+        Pools[t].NumUsed = 0;
+    }
+}
+
+
+// Only called by the thread that owns the pool
+VkCommandBuffer VulkanParallelRecorder::GetSecondaryCmdBuf(int Thread)
+{
+    ThreadPool& Pool = m_pools[m_curFrame][Thread];
+
+    if (Pool.NumUsed == (int)Pool.CmdBufs.size()) {
+        VkCommandBufferAllocateInfo cmdBufAllocInfo = {};
+        cmdBufAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmdBufAllocInfo.commandPool = Pool.CmdPool;
+        cmdBufAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        cmdBufAllocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer CmdBuf;
+        VkResult res = vkAllocateCommandBuffers(m_pCore->GetDevice(), &cmdBufAllocInfo, &CmdBuf);
+        CHECK_VULKAN_ERROR("vkAllocateCommandBuffers error %d\n", res);
+
+        Pool.CmdBufs.push_back(CmdBuf);
+    }
+
+    return Pool.CmdBufs[Pool.NumUsed++];
+}
+
+
+void VulkanParallelRecorder::Record(VkCommandBuffer PrimaryCmdBuf, VkRenderPass RenderPass, uint Subpass, VkFramebuffer Framebuffer,
+                                    int NumItems, const VulkanRecordFunc& Func, int MinItemsPerJob)
+{
+    if (NumItems <= 0) {
+        return;
+    }
+
+    if (MinItemsPerJob < 1) {
+        MinItemsPerJob = 1;
+    }
+
+    int MaxJobs = m_pJobSystem->GetNumThreads() * JOBS_PER_THREAD;
+    int NumJobs = std::min((NumItems + MinItemsPerJob - 1) / MinItemsPerJob, MaxJobs);
+    int ItemsPerJob = (NumItems + NumJobs - 1) / NumJobs;
+
+    m_jobCmdBufs.resize(NumJobs);
+
+    m_pJobSystem->Dispatch(NumJobs, [&](int Job, int Thread) {
+        VkCommandBuffer CmdBuf = GetSecondaryCmdBuf(Thread);
+
+        VkCommandBufferInheritanceInfo inheritanceInfo = {};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = RenderPass;
+        inheritanceInfo.subpass = Subpass;
+        inheritanceInfo.framebuffer = Framebuffer;
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        VkResult res = vkBeginCommandBuffer(CmdBuf, &beginInfo);
+        CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
+
+        int Start = Job * ItemsPerJob;
+        int End = std::min(Start + ItemsPerJob, NumItems);
+
+        Func(CmdBuf, Start, End);
+
+        res = vkEndCommandBuffer(CmdBuf);
+        CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
+
+        // Indexed by job so the draw order does not depend on the scheduling
+        m_jobCmdBufs[Job] = CmdBuf;
+    });
+
+    vkCmdExecuteCommands(PrimaryCmdBuf, NumJobs, m_jobCmdBufs.data());
+}
+
+#endif
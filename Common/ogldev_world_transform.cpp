@@ -16,12 +16,18 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "ogldev_world_transform.h"
 
+// Instances per MatrixMulBatch call in PackInstanceMatrices
+#define INSTANCE_PACK_BATCH 64
+
 
 void WorldTrans::SetScale(float scale)
 {
     m_scale = scale;
+    m_isDirty = true;
 }
 
 
@@ -30,6 +36,7 @@ void WorldTrans::SetRotation(float x, float y, float z)
     m_rotation.x = x;
     m_rotation.y = y;
     m_rotation.z = z;
+    m_isDirty = true;
 }
 
 
@@ -38,12 +45,14 @@ void WorldTrans::SetPosition(float x, float y, float z)
     m_pos.x = x;
     m_pos.y = y;
     m_pos.z = z;
+    m_isDirty = true;
 }
 
 
 void WorldTrans::SetPosition(const Vector3f& WorldPos)
 {
     m_pos = WorldPos;
+    m_isDirty = true;
 }
 
 
@@ -52,10 +61,11 @@ void WorldTrans::Rotate(float x, float y, float z)
     m_rotation.x += x;
     m_rotation.y += y;
     m_rotation.z += z;
+    m_isDirty = true;
 }
 
 
-Matrix4f WorldTrans::GetMatrix() const
+void WorldTrans::UpdateMatrices() const
 {
     Matrix4f Scale;
     Scale.InitScaleTransform(m_scale, m_scale, m_scale);
@@ -66,9 +76,40 @@ Matrix4f WorldTrans::GetMatrix() const
     Matrix4f Translation;
     Translation.InitTranslationTransform(m_pos.x, m_pos.y, m_pos.z);
 
-    Matrix4f WorldTransformation = Translation * Rotation * Scale;
+    m_worldMatrix = Translation * Rotation * Scale;
+
+    // The scaling is uniform so the inverse transpose of R*s is R/s = (R*s)/(s*s)
+    Matrix3f World3x3(m_worldMatrix);
+    float InvScaleSq = 1.0f / (m_scale * m_scale);
+
+    for (int i = 0 ; i < 3 ; i++) {
+        for (int j = 0 ; j < 3 ; j++) {
+            m_normalMatrix.m[i][j] = World3x3.m[i][j] * InvScaleSq;
+        }
+    }
+
+    m_isDirty = false;
+    m_isWVPDirty = true;
+}
+
+
+Matrix4f WorldTrans::GetMatrix() const
+{
+    if (m_isDirty) {
+        UpdateMatrices();
+    }
+
+    return m_worldMatrix;
+}
+
+
+const Matrix3f& WorldTrans::GetNormalMatrix() const
+{
+    if (m_isDirty) {
+        UpdateMatrices();
+    }
 
-    return WorldTransformation;
+    return m_normalMatrix;
 }
 
 
@@ -114,3 +155,26 @@ Vector3f WorldTrans::WorldDirToLocalDir(const Vector3f& WorldDirection) const
 
     return LocalDirection;
 }
+
+
+void PackInstanceMatrices(const Matrix4f& VP, const WorldTrans* pWorldTrans, int Count, Matrix4f* pOut)
+{
+    Matrix4f World[INSTANCE_PACK_BATCH];
+    Matrix4f WVP[INSTANCE_PACK_BATCH];
+
+    for (int Start = 0 ; Start < Count ; Start += INSTANCE_PACK_BATCH) {
+        int BatchSize = std::min(INSTANCE_PACK_BATCH, Count - Start);
+
+        for (int i = 0 ; i < BatchSize ; i++) {
+            World[i] = pWorldTrans[Start + i].GetMatrix();
+        }
+
+        MatrixMulBatch(VP, World, WVP, BatchSize);
+
+        for (int i = 0 ; i < BatchSize ; i++) {
+            Matrix4f* pInstance = pOut + 2 * (Start + i);
+            MatrixTransposeSIMD(&WVP[i].m[0][0], &pInstance[0].m[0][0]);
+            MatrixTransposeSIMD(&World[i].m[0][0], &pInstance[1].m[0][0]);
+        }
+    }
+}
@@ -18,9 +18,81 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
 
 #include "ogldev_util.h"
 #include "technique.h"
+#include "ogldev_gl_state.h"
+#include "ogldev_mapped_file.h"
+
+#define PROGRAM_BINARY_CACHE_MAGIC   0x4250474f   // 'OGPB'
+#define PROGRAM_BINARY_CACHE_VERSION 1
+
+struct ProgramBinaryHeader {
+    u32 Magic;
+    u32 Format;
+    u64 Key;
+    u32 DataSize;
+    u32 Padding = 0;
+};
+
+std::string Technique::s_programBinaryCacheDir = "shader_cache";
+
+
+// FNV-1a
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 1099511628211ULL
+
+static u64 HashBytes(u64 Hash, const void* pData, size_t Size)
+{
+    const u8* p = (const u8*)pData;
+
+    for (size_t i = 0 ; i < Size ; i++) {
+        Hash ^= p[i];
+        Hash *= FNV_PRIME;
+    }
+
+    return Hash;
+}
+
+
+static u64 HashString(u64 Hash, const char* s)
+{
+    return s ? HashBytes(Hash, s, strlen(s) + 1) : Hash;
+}
+
+
+static bool IsProgramBinarySupported()
+{
+    static int Supported = -1;
+
+    if (Supported == -1) {
+        GLint NumFormats = 0;
+
+        if (GLEW_ARB_get_program_binary) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &NumFormats);
+        }
+
+        Supported = (NumFormats > 0) ? 1 : 0;
+    }
+
+    return Supported == 1;
+}
+
+
+static void MakeDir(const char* pDir)
+{
+#ifdef _WIN32
+    _mkdir(pDir);
+#else
+    mkdir(pDir, 0755);
+#endif
+}
+
 
 Technique::Technique()
 {
@@ -61,16 +133,26 @@ bool Technique::Init()
 // Use this method to add shaders to the program. When finished - call finalize()
 bool Technique::AddShader(GLenum ShaderType, const char* pFilename)
 {
-    string s;
+    ShaderSource Shader;
+    Shader.Type = ShaderType;
+    Shader.Filename = pFilename;
 
-    if (!ReadFile(pFilename, s)) {
+    if (!ReadFile(pFilename, Shader.Source)) {
         return false;
     }
 
-    GLuint ShaderObj = glCreateShader(ShaderType);
+    m_shaderSources.push_back(Shader);
+
+    return true;
+}
+
+
+bool Technique::CompileShader(const ShaderSource& Shader)
+{
+    GLuint ShaderObj = glCreateShader(Shader.Type);
 
     if (ShaderObj == 0) {
-        fprintf(stderr, "Error creating shader type %d\n", ShaderType);
+        fprintf(stderr, "Error creating shader type %d\n", Shader.Type);
         return false;
     }
 
@@ -78,8 +160,8 @@ bool Technique::AddShader(GLenum ShaderType, const char* pFilename)
     m_shaderObjList.push_back(ShaderObj);
 
     const GLchar* p[1];
-    p[0] = s.c_str();
-    GLint Lengths[1] = { (GLint)s.size() };
+    p[0] = Shader.Source.c_str();
+    GLint Lengths[1] = { (GLint)Shader.Source.size() };
 
     glShaderSource(ShaderObj, 1, p, Lengths);
 
@@ -91,7 +173,7 @@ bool Technique::AddShader(GLenum ShaderType, const char* pFilename)
     if (!success) {
         GLchar InfoLog[1024];
         glGetShaderInfoLog(ShaderObj, 1024, NULL, InfoLog);
-        fprintf(stderr, "Error compiling '%s': '%s'\n", pFilename, InfoLog);
+        fprintf(stderr, "Error compiling '%s': '%s'\n", Shader.Filename.c_str(), InfoLog);
         return false;
     }
 
@@ -101,9 +183,7 @@ bool Technique::AddShader(GLenum ShaderType, const char* pFilename)
 }
 
 
-// After all the shaders have been added to the program call this function
-// to link and validate the program.
-bool Technique::Finalize()
+bool Technique::Link()
 {
     GLint Success = 0;
     GLchar ErrorLog[1024] = { 0 };
@@ -125,6 +205,56 @@ bool Technique::Finalize()
      //   return false;
     }
 
+    return true;
+}
+
+
+// After all the shaders have been added to the program call this function
+// to link and validate the program.
+bool Technique::Finalize()
+{
+    // Only the first link goes through the cache. A technique that changes the pre-link
+    // state and calls Finalize() again (e.g. to set the transform feedback varyings)
+    // gets a regular link from source.
+    bool UseCache = !m_isFinalized && !s_programBinaryCacheDir.empty() && IsProgramBinarySupported();
+    m_isFinalized = true;
+
+    u64 Key = 0;
+    string CacheFilename;
+
+    if (UseCache) {
+        Key = CalcProgramKey();
+
+        char Name[64];
+        SNPRINTF(Name, sizeof(Name), "/%016llx.bin", (unsigned long long)Key);
+        CacheFilename = s_programBinaryCacheDir + Name;
+
+        // The sources are kept in case Finalize() is called again
+        if (LoadProgramBinary(CacheFilename, Key)) {
+            return GLCheckError();
+        }
+    }
+
+    for (std::list<ShaderSource>::iterator it = m_shaderSources.begin() ; it != m_shaderSources.end() ; it++) {
+        if (!CompileShader(*it)) {
+            return false;
+        }
+    }
+
+    m_shaderSources.clear();
+
+    if (UseCache) {
+        glProgramParameteri(m_shaderProg, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    if (!Link()) {
+        return false;
+    }
+
+    if (UseCache) {
+        SaveProgramBinary(CacheFilename, Key);
+    }
+
     // Delete the intermediate shader objects that have been added to the program
     for (ShaderObjList::iterator it = m_shaderObjList.begin() ; it != m_shaderObjList.end() ; it++) {
         glDeleteShader(*it);
@@ -136,9 +266,117 @@ bool Technique::Finalize()
 }
 
 
+u64 Technique::CalcProgramKey() const
+{
+    u64 Hash = FNV_OFFSET_BASIS;
+
+    int Version = PROGRAM_BINARY_CACHE_VERSION;
+    Hash = HashBytes(Hash, &Version, sizeof(Version));
+
+    // A driver update can change the binary format without changing the format enum
+    Hash = HashString(Hash, (const char*)glGetString(GL_VENDOR));
+    Hash = HashString(Hash, (const char*)glGetString(GL_RENDERER));
+    Hash = HashString(Hash, (const char*)glGetString(GL_VERSION));
+
+    for (std::list<ShaderSource>::const_iterator it = m_shaderSources.begin() ; it != m_shaderSources.end() ; it++) {
+        Hash = HashBytes(Hash, &it->Type, sizeof(it->Type));
+        Hash = HashBytes(Hash, it->Source.data(), it->Source.size());
+    }
+
+    return Hash;
+}
+
+
+bool Technique::LoadProgramBinary(const string& Filename, u64 Key)
+{
+    MappedFile File;
+
+    if (!File.Open(Filename.c_str()) || (File.GetSize() < sizeof(ProgramBinaryHeader))) {
+        return false;
+    }
+
+    const ProgramBinaryHeader* pHeader = (const ProgramBinaryHeader*)File.GetData();
+
+    if ((pHeader->Magic != PROGRAM_BINARY_CACHE_MAGIC) ||
+        (pHeader->Key != Key) ||
+        (File.GetSize() < sizeof(ProgramBinaryHeader) + pHeader->DataSize)) {
+        return false;
+    }
+
+    // The driver reads the binary straight from the mapped pages
+    glProgramBinary(m_shaderProg, pHeader->Format, (const char*)File.GetData() + sizeof(ProgramBinaryHeader), (GLsizei)pHeader->DataSize);
+
+    GLint Success = 0;
+    glGetProgramiv(m_shaderProg, GL_LINK_STATUS, &Success);
+
+    if (!Success) {
+        // The driver can reject a binary for any reason - compile from source
+        printf("Program binary '%s' was rejected by the driver\n", Filename.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+void Technique::SaveProgramBinary(const string& Filename, u64 Key)
+{
+    GLint Length = 0;
+    glGetProgramiv(m_shaderProg, GL_PROGRAM_BINARY_LENGTH, &Length);
+
+    if (Length <= 0) {
+        return;
+    }
+
+    std::vector<char> Buffer(sizeof(ProgramBinaryHeader) + Length);
+
+    ProgramBinaryHeader Header;
+    Header.Magic = PROGRAM_BINARY_CACHE_MAGIC;
+    Header.Format = 0;
+    Header.Key = Key;
+
+    GLsizei BytesWritten = 0;
+    glGetProgramBinary(m_shaderProg, Length, &BytesWritten, &Header.Format, Buffer.data() + sizeof(Header));
+
+    Header.DataSize = (u32)BytesWritten;
+    memcpy(Buffer.data(), &Header, sizeof(Header));
+
+    MakeDir(s_programBinaryCacheDir.c_str());
+
+    // Write to a temporary file and rename it so that another instance never reads a partial file
+    string TempFilename = Filename + ".tmp";
+
+    FILE* f = fopen(TempFilename.c_str(), "wb");
+
+    if (!f) {
+        printf("Cannot write the program binary to '%s'\n", TempFilename.c_str());
+        return;
+    }
+
+    size_t Size = sizeof(Header) + BytesWritten;
+    bool ok = (fwrite(Buffer.data(), 1, Size, f) == Size);
+    fclose(f);
+
+#ifdef _WIN32
+    remove(Filename.c_str());
+#endif
+
+    if (!ok || (rename(TempFilename.c_str(), Filename.c_str()) != 0)) {
+        printf("Error writing the program binary to '%s'\n", Filename.c_str());
+        remove(TempFilename.c_str());
+    }
+}
+
+
+void Technique::SetProgramBinaryCacheDir(const char* pDir)
+{
+    s_programBinaryCacheDir = pDir ? pDir : "";
+}
+
+
 void Technique::Enable()
 {
-    glUseProgram(m_shaderProg);
+    GLState::UseProgram(m_shaderProg);
 }
 
 
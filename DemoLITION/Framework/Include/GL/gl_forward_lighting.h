@@ -23,18 +23,32 @@
 #include "ogldev_math_3d.h"
 #include "ogldev_material.h"
 #include "ogldev_world_transform.h"
+#include "ogldev_streaming_buffer.h"
 #include "demolition_lights.h"
 #include "Int/core_model.h"
-
+#include "gl_forward_lighting_blocks.h"
+
+//
+// All the values except the samplers live in uniform buffers (see gl_forward_lighting_blocks.h).
+// The setters only update the CPU copies. The frame, lights and material blocks are uploaded
+// by CommitDraw() when they change and the per-draw block is appended to a streaming buffer.
+//
+// Usage:
+//     BeginDraws(NumDraws);
+//     for each draw: SetWVP()/SetMaterial()/etc, CommitDraw(), glDraw*()
+//     EndDraws();
+//
 class ForwardLightingTechnique : public Technique
 {
 public:
 
-    static const unsigned int MAX_POINT_LIGHTS = 2;
-    static const unsigned int MAX_SPOT_LIGHTS = 2;
+    static const unsigned int MAX_POINT_LIGHTS = FORWARD_LIGHTING_MAX_POINT_LIGHTS;
+    static const unsigned int MAX_SPOT_LIGHTS = FORWARD_LIGHTING_MAX_SPOT_LIGHTS;
 
     ForwardLightingTechnique();
 
+    ~ForwardLightingTechnique();
+
     virtual bool Init();
 
     void SetWVP(const Matrix4f& WVP);
@@ -76,88 +90,49 @@ public:
     void SetFogTime(float Time);
     void SetLightingEnabled(bool LightingEnabled);
 
+    // Binds the uniform buffers and reserves room for NumDraws draws in the streaming buffer.
+    // More draws are allowed but they cost another region of the streaming buffer.
+    void BeginDraws(unsigned int NumDraws);
+
+    // Makes the current values visible to the next draw call
+    void CommitDraw();
+
+    void EndDraws();
+
 protected:
 
     bool InitCommon();
 
 private:
     void SetExpFogCommon(float FogEnd, float FogDensity);
+    bool InitUniformBlocks();
+    bool ConfigUniformBlock(const char* pName, GLuint Binding, size_t Size);
+    void MapDrawBuffer(unsigned int NumDraws);
+    void UploadDirtyBlocks();
 
-    GLuint WVPLoc = INVALID_UNIFORM_LOCATION;
-    GLuint WorldMatrixLoc = INVALID_UNIFORM_LOCATION;
-    GLuint NormalMatrixLoc = INVALID_UNIFORM_LOCATION;
-    GLuint LightWVPLoc = INVALID_UNIFORM_LOCATION; // required only for shadow mapping
     GLuint samplerLoc = INVALID_UNIFORM_LOCATION;
-    GLuint hasSamplerLoc = INVALID_UNIFORM_LOCATION;
     GLuint shadowMapLoc = INVALID_UNIFORM_LOCATION;
     GLuint shadowCubeMapLoc = INVALID_UNIFORM_LOCATION;
     GLuint NormalMapLoc = INVALID_UNIFORM_LOCATION;
-    GLuint HasNormalMapLoc = INVALID_UNIFORM_LOCATION;
-    GLuint shadowMapWidthLoc = INVALID_UNIFORM_LOCATION;
-    GLuint shadowMapHeightLoc = INVALID_UNIFORM_LOCATION;
-    GLuint shadowMapFilterSizeLoc = INVALID_UNIFORM_LOCATION;
     GLuint shadowMapOffsetTextureLoc = INVALID_UNIFORM_LOCATION;
-    GLuint ShadowMapOffsetTextureSizeLoc = INVALID_UNIFORM_LOCATION;
-    GLuint ShadowMapOffsetFilterSizeLoc = INVALID_UNIFORM_LOCATION;
-    GLuint ShadowMapRandomRadiusLoc = INVALID_UNIFORM_LOCATION;
     GLuint samplerSpecularExponentLoc = INVALID_UNIFORM_LOCATION;
-    GLuint CameraWorldPosLoc = INVALID_UNIFORM_LOCATION;
-    GLuint NumPointLightsLoc = INVALID_UNIFORM_LOCATION;
-    GLuint NumSpotLightsLoc = INVALID_UNIFORM_LOCATION;
-    GLuint ColorModLocation = INVALID_UNIFORM_LOCATION;
-    GLuint ColorAddLocation = INVALID_UNIFORM_LOCATION;
-    GLuint EnableRimLightLoc = INVALID_UNIFORM_LOCATION;
-    GLuint EnableCellShadingLoc = INVALID_UNIFORM_LOCATION;
-    GLuint EnableSpecularExponent = INVALID_UNIFORM_LOCATION;
-    GLuint FogStartLoc = INVALID_UNIFORM_LOCATION;
-    GLuint FogEndLoc = INVALID_UNIFORM_LOCATION;
-    GLuint FogColorLoc = INVALID_UNIFORM_LOCATION;
-    GLuint ExpFogDensityLoc = INVALID_UNIFORM_LOCATION;
-    GLuint ExpSquaredFogEnabledLoc = INVALID_UNIFORM_LOCATION;
-    GLuint LayeredFogTopLoc = INVALID_UNIFORM_LOCATION;
-    GLuint FogTimeLoc = INVALID_UNIFORM_LOCATION;
-    GLuint LightingEnabledLoc = INVALID_UNIFORM_LOCATION;
-
-    struct {
-        GLuint AmbientColor;
-        GLuint DiffuseColor;
-        GLuint SpecularColor;
-    } materialLoc;
-
-    struct {
-        GLuint Color;
-        GLuint AmbientIntensity;
-        GLuint Direction;
-        GLuint DiffuseIntensity;
-    } dirLightLoc;
-
-    struct {
-        GLuint Color;
-        GLuint AmbientIntensity;
-        GLuint WorldPos;
-        GLuint DiffuseIntensity;
-
-        struct
-        {
-            GLuint Constant;
-            GLuint Linear;
-            GLuint Exp;
-        } Atten;
-    } PointLightsLocation[MAX_POINT_LIGHTS];
-
-    struct {
-        GLuint Color;
-        GLuint AmbientIntensity;
-        GLuint DiffuseIntensity;
-        GLuint Position;
-        GLuint Direction;
-        GLuint Cutoff;
-        struct {
-            GLuint Constant;
-            GLuint Linear;
-            GLuint Exp;
-        } Atten;
-    } SpotLightsLocation[MAX_SPOT_LIGHTS];
+
+    UBOFrame m_frame;
+    UBOLights m_lights;
+    UBOMaterialTable m_materials;
+    UBODraw m_draw;
+    bool m_isFrameDirty = true;
+    bool m_isLightsDirty = true;
+
+    GLuint m_frameBuffer = 0;
+    GLuint m_lightsBuffer = 0;
+    GLuint m_materialsBuffer = 0;
+
+    StreamingBuffer m_drawBuffer;
+    size_t m_drawStride = 0;
+    char* m_pDrawData = NULL;
+    unsigned int m_numDraws = 0;
+    unsigned int m_maxDraws = 0;
 };
 
 
@@ -0,0 +1,193 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GL_FORWARD_LIGHTING_BLOCKS_H
+#define GL_FORWARD_LIGHTING_BLOCKS_H
+
+#include <map>
+
+#include "ogldev_math_3d.h"
+#include "ogldev_material.h"
+#include "demolition_lights.h"
+
+//
+// CPU side images of the uniform blocks in forward_lighting.vs/fs.
+// The structs follow the std140 layout rules so they are copied into
+// the uniform buffers as is. Keep them in sync with the shaders.
+// Nothing here calls GL.
+//
+
+#define FORWARD_LIGHTING_MAX_POINT_LIGHTS 2
+#define FORWARD_LIGHTING_MAX_SPOT_LIGHTS  2
+#define FORWARD_LIGHTING_MAX_MATERIALS    256
+
+// Uniform buffer binding points
+#define FORWARD_LIGHTING_FRAME_BINDING     0    // once per frame
+#define FORWARD_LIGHTING_LIGHTS_BINDING    1    // once per frame
+#define FORWARD_LIGHTING_MATERIALS_BINDING 2    // when a material is added/changed
+#define FORWARD_LIGHTING_DRAW_BINDING      3    // per draw, from a streaming buffer
+
+
+struct UBOFrame {
+    Vector3f CameraWorldPos = Vector3f(0.0f, 0.0f, 0.0f);
+    float FogStart = -1.0f;
+    Vector3f FogColor = Vector3f(0.0f, 0.0f, 0.0f);
+    float FogEnd = -1.0f;
+    Vector4f ColorMod = Vector4f(1.0f, 1.0f, 1.0f, 1.0f);
+    Vector4f ColorAdd = Vector4f(0.0f, 0.0f, 0.0f, 0.0f);
+    float ExpFogDensity = 1.0f;
+    float LayeredFogTop = -1.0f;
+    float FogTime = -1.0f;
+    float RimLightPower = 2.0f;
+    float ShadowMapOffsetTextureSize = 0.0f;
+    float ShadowMapOffsetFilterSize = 0.0f;
+    float ShadowMapRandomRadius = 0.0f;
+    int ShadowMapWidth = 0;
+    int ShadowMapHeight = 0;
+    int ShadowMapFilterSize = 0;
+    int ExpSquaredFogEnabled = 0;       // GLSL bools are 4 bytes in std140
+    int RimLightEnabled = 0;
+    int CellShadingEnabled = 0;
+    int LightingEnabled = 1;
+    int Padding[2] = { 0, 0 };
+};
+
+
+struct UBOBaseLight {
+    Vector3f Color = Vector3f(0.0f, 0.0f, 0.0f);
+    float AmbientIntensity = 0.0f;
+    float DiffuseIntensity = 0.0f;
+    float Padding[3] = { 0.0f, 0.0f, 0.0f };    // a struct is rounded up to a multiple of vec4
+};
+
+
+struct UBODirectionalLight {
+    UBOBaseLight Base;
+    Vector3f Direction = Vector3f(0.0f, 0.0f, 0.0f);
+    float Padding = 0.0f;
+};
+
+
+struct UBOAttenuation {
+    float Constant = 0.0f;
+    float Linear = 0.0f;
+    float Exp = 0.0f;
+    float Padding = 0.0f;
+};
+
+
+struct UBOPointLight {
+    UBOBaseLight Base;
+    Vector3f WorldPos = Vector3f(0.0f, 0.0f, 0.0f);
+    float Padding = 0.0f;
+    UBOAttenuation Atten;
+};
+
+
+struct UBOSpotLight {
+    UBOPointLight Base;
+    Vector3f Direction = Vector3f(0.0f, 0.0f, 0.0f);
+    float Cutoff = 0.0f;
+};
+
+
+struct UBOLights {
+    UBODirectionalLight DirectionalLight;
+    UBOPointLight PointLights[FORWARD_LIGHTING_MAX_POINT_LIGHTS];
+    UBOSpotLight SpotLights[FORWARD_LIGHTING_MAX_SPOT_LIGHTS];
+    int NumPointLights = 0;
+    int NumSpotLights = 0;
+    int Padding[2] = { 0, 0 };
+};
+
+
+struct UBOMaterial {
+    Vector3f AmbientColor = Vector3f(0.0f, 0.0f, 0.0f);
+    float Padding0 = 0.0f;
+    Vector3f DiffuseColor = Vector3f(0.0f, 0.0f, 0.0f);
+    float Padding1 = 0.0f;
+    Vector3f SpecularColor = Vector3f(0.0f, 0.0f, 0.0f);
+    float Padding2 = 0.0f;
+};
+
+
+// The matrices are declared row_major in the shaders so Matrix4f is copied without a transpose
+struct UBODraw {
+    Matrix4f WVP;
+    Matrix4f LightWVP;
+    Matrix4f World;
+    float NormalMatrix[3][4];     // a row_major mat3 is three vec4 rows
+    int MaterialIndex = 0;
+    int HasSampler = 0;
+    int HasNormalMap = 0;
+    int EnableSpecularExponent = 0;
+};
+
+
+void PackDirectionalLight(UBODirectionalLight& Dst, const DirectionalLight& Light);
+
+void PackDirectionalLightDir(UBODirectionalLight& Dst, const DirectionalLight& Light);
+
+void PackPointLight(UBOPointLight& Dst, const PointLight& Light);
+
+void PackPointLightPos(UBOPointLight& Dst, const PointLight& Light);
+
+void PackSpotLight(UBOSpotLight& Dst, const SpotLight& Light);
+
+void PackSpotLightPosAndDir(UBOSpotLight& Dst, const SpotLight& Light);
+
+void PackMaterial(UBOMaterial& Dst, const Material& Mat);
+
+void PackNormalMatrix(float Dst[3][4], const Matrix3f& NormalMatrix);
+
+
+//
+// The material block is a table that the draws index. A material gets a slot
+// the first time it is used and the slot is rewritten only when the material
+// changes, so in a steady state the table is not uploaded at all.
+// The owner uploads the dirty range and calls ClearDirty().
+//
+class UBOMaterialTable {
+ public:
+    UBOMaterialTable() {}
+
+    int GetIndex(const Material& Mat);
+
+    bool IsDirty() const { return m_dirtyEnd > m_dirtyBegin; }
+
+    // Range of slots [First, First + Count) that must be uploaded
+    void GetDirtyRange(int& First, int& Count) const;
+
+    void ClearDirty();
+
+    const UBOMaterial* GetData() const { return m_materials; }
+
+    int GetNumMaterials() const { return m_numMaterials; }
+
+ private:
+
+    void MarkDirty(int Index);
+
+    UBOMaterial m_materials[FORWARD_LIGHTING_MAX_MATERIALS];
+    std::map<const Material*, int> m_slots;
+    int m_numMaterials = 0;
+    int m_dirtyBegin = 0;
+    int m_dirtyEnd = 0;
+};
+
+#endif  /* GL_FORWARD_LIGHTING_BLOCKS_H */
@@ -109,6 +109,8 @@ private:
     void RenderWithForwardLighting(CoreSceneObject* pSceneObject);
     void RenderWithFlatColor(CoreSceneObject* pSceneObject);
     void StartRenderWithForwardLighting(GLScene* pScene, CoreSceneObject* pSceneObject);
+    uint CountDraws(const std::list<CoreSceneObject*>& RenderList);
+    uint CountForwardLightingDraws(GLScene* pScene);
     void GetWVP(CoreSceneObject* pSceneObject, Matrix4f& WVP);
     void SwitchToLightingTech();
     void InitShadowMapping();
@@ -132,6 +134,7 @@ private:
     Matrix4f m_lightPersProjMatrix;
     Matrix4f m_lightOrthoProjMatrix;
     Matrix4f m_lightViewMatrix;
+    Matrix4f m_lightViewProjMatrix;     // m_lightPersProjMatrix * m_lightViewMatrix
 
     ForwardLightingTechnique m_lightingTech;
     //ForwardSkinningTechnique m_skinningTech;
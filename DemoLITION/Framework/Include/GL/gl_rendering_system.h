@@ -27,6 +27,7 @@
 #include "Int/core_rendering_system.h"
 #include "gl_forward_renderer.h"
 #include "GL/gl_scene.h"
+#include "ogldev_gl_state.h"
 
 class RenderingSystemGL : public CoreRenderingSystem
 {
@@ -68,5 +69,6 @@ class RenderingSystemGL : public CoreRenderingSystem
     ForwardRenderer m_forwardRenderer;
     std::vector<Texture*> m_textures;
     int m_numTextures = 0;
+    GLStateStats m_lastFrameGLStats;
 };
 
@@ -69,6 +69,9 @@ public:
 
     void Render(uint NumInstances, const Matrix4f* WVPMats, const Matrix4f* WorldMats);
 
+    // Render(pRenderCallbacks) issues one draw per mesh
+    uint GetNumMeshes() const { return (uint)m_Meshes.size(); }
+
     PBRMaterial& GetPBRMaterial() { return m_Materials[0].PBRmaterial; };
 
     void GetLeadingVertex(uint DrawIndex, uint PrimID, Vector3f& Vertex);
@@ -43,7 +43,7 @@ class CoreRenderingSystem : public RenderingSystem
 
     virtual void SetScene(Scene* pScene);
 
-    virtual Texture* GetTexture(int TextureHandle) = NULL;
+    virtual Texture* GetTexture(int TextureHandle) = 0;
 
     virtual void GetWindowSize(int& Width, int& Height) const { Width = m_windowWidth; Height = m_windowHeight; }
 
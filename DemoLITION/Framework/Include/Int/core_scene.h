@@ -20,9 +20,12 @@
 #pragma once
 
 #include <list>
+#include <deque>
+#include <algorithm>
 
+#include "ogldev_parallel.h"
 #include "demolition_scene.h"
-#include "Int\core_model.h"
+#include "Int/core_model.h"
 
 
 class CoreSceneObject : public SceneObject {
@@ -41,8 +44,41 @@ public:
 
     CoreModel* GetModel() const { return m_pModel; }
 
+    CoreSceneObject* GetParent() const { return m_pParent; }
+
+    const std::vector<CoreSceneObject*>& GetChildren() const { return m_children; }
+
+    void SetParent(CoreSceneObject* pParent)
+    {
+        if (m_pParent) {
+            std::vector<CoreSceneObject*>& Siblings = m_pParent->m_children;
+            Siblings.erase(std::find(Siblings.begin(), Siblings.end(), this));
+        }
+
+        m_pParent = pParent;
+        m_hasParent = (pParent != NULL);
+
+        if (m_pParent) {
+            m_pParent->m_children.push_back(this);
+        }
+
+        // The world matrix must be recalculated relative to the new parent
+        m_isDirty = true;
+        m_isMoved = true;
+    }
+
+    // Used by the scene graph update
+    bool IsMoved() const { return m_isMoved; }
+    void ClearMoved() { m_isMoved = false; }
+    void SetWorldMatrix(const Matrix4f& World) const { SceneObject::SetWorldMatrix(World); }
+    void SetNodeIndex(int Index) { m_nodeIndex = Index; }
+    int GetNodeIndex() const { return m_nodeIndex; }
+
 private:
     CoreModel* m_pModel = NULL;
+    CoreSceneObject* m_pParent = NULL;
+    std::vector<CoreSceneObject*> m_children;
+    int m_nodeIndex = -1;      // position in the breadth first order of the scene graph
 };
 
 
@@ -76,6 +112,15 @@ public:
 
     bool RemoveFromRenderList(SceneObject* pSceneObject);
 
+    bool SetParent(SceneObject* pChild, SceneObject* pParent);
+
+    // Recalculates the world transforms of the objects that moved and their subtrees.
+    // Called once per frame before rendering.
+    void UpdateTransforms();
+
+    // The number of objects whose world transform was recalculated by the last UpdateTransforms
+    int GetNumUpdatedNodes() const;
+
     bool IsClearFrame() const { return m_clearFrame; }
 
     const Vector4f& GetClearColor() { return m_clearColor; }
@@ -89,8 +134,24 @@ protected:
 private:
     void CreateDefaultCamera();
     CoreSceneObject* CreateSceneObjectInternal(CoreModel* pModel);
+    void RebuildHierarchy();
+    void UpdateNodes(int Start, int End, bool ForceUpdate);
 
     BasicCamera m_defaultCamera;
-    std::vector<CoreSceneObject> m_sceneObjects;
-    int m_numSceneObjects = 0;
+    std::deque<CoreSceneObject> m_sceneObjects;     // a deque never moves the existing objects
+
+    // Scene graph in breadth first order. A parent always comes before its
+    // children so the world transforms are updated in a single linear pass.
+    // The local transformations are kept as a structure of arrays in the same
+    // order and are copied from the objects only when they move.
+    std::vector<CoreSceneObject*> m_nodes;
+    std::vector<int> m_parentIndex;         // -1 for root objects
+    std::vector<Vector3f> m_positions;
+    std::vector<Vector3f> m_rotations;
+    std::vector<Vector3f> m_scales;
+    std::vector<Matrix4f> m_worldMatrices;
+    std::vector<u8> m_dirtyFlags;
+    std::vector<int> m_levelStart;          // first node of every level plus the total number of nodes
+    bool m_isHierarchyDirty = false;
+    JobSystem m_jobs;                       // persistent workers for the large levels
 };
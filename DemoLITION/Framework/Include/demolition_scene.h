@@ -29,24 +29,54 @@ class SceneObject {
 public:
     SceneObject() {}
 
-    void SetPosition(float x, float y, float z) { m_pos.x = x; m_pos.y = y; m_pos.z = z; }
-    void SetRotation(float x, float y, float z) { m_rot.x = x; m_rot.y = y; m_rot.z = z; }
-    void SetScale(float x, float y, float z) { m_scale.x = x; m_scale.y = y; m_scale.z = z; }
+    // The transformation is relative to the parent (see Scene::SetParent)
+    void SetPosition(float x, float y, float z) { m_pos.x = x; m_pos.y = y; m_pos.z = z; OnChange(); }
+    void SetRotation(float x, float y, float z) { m_rot.x = x; m_rot.y = y; m_rot.z = z; OnChange(); }
+    void SetScale(float x, float y, float z) { m_scale.x = x; m_scale.y = y; m_scale.z = z; OnChange(); }
 
-    void SetPosition(const Vector3f& Pos) { m_pos = Pos; }
-    void SetRotation(const Vector3f& Rot) { m_rot = Rot; }
-    void SetScale(const Vector3f& Scale) { m_scale = Scale; }
+    void SetPosition(const Vector3f& Pos) { m_pos = Pos; OnChange(); }
+    void SetRotation(const Vector3f& Rot) { m_rot = Rot; OnChange(); }
+    void SetScale(const Vector3f& Scale) { m_scale = Scale; OnChange(); }
 
-    Matrix4f GetMatrix() const;
+    const Vector3f& GetPosition() const { return m_pos; }
+    const Vector3f& GetRotation() const { return m_rot; }
+    const Vector3f& GetScale() const { return m_scale; }
+
+    // The matrices below are cached and only rebuilt after one of the setters was called.
+    // For objects with a parent the world matrices are refreshed by Scene::UpdateTransforms.
+    const Matrix4f& GetMatrix() const;
+
+    // Inverse transpose of the upper 3x3 - takes normals to world space
+    const Matrix3f& GetNormalMatrix() const;
+
+    // Also rebuilt when Camera changes (see BasicCamera::GetGeneration)
+    const Matrix4f& GetWVP(const BasicCamera& Camera) const;
 
     void SetFlatColor(const Vector4f Col) { m_flatColor = Col; }
     const Vector4f& GetFlatColor() const { return m_flatColor; }
 
+protected:
+    // Takes the world matrix computed by the scene graph
+    void SetWorldMatrix(const Matrix4f& World) const;
+
+    bool m_hasParent = false;
+    bool m_isMoved = true;      // cleared by the scene graph update
+    mutable bool m_isDirty = true;
+
 private:
+    void OnChange() { m_isDirty = true; m_isMoved = true; }
+    void UpdateRoot() const;
+
     Vector3f m_pos = Vector3f(0.0f, 0.0f, 0.0f);
     Vector3f m_rot = Vector3f(0.0f, 0.0f, 0.0f);
     Vector3f m_scale = Vector3f(1.0f, 1.0f, 1.0f);
     Vector4f m_flatColor = Vector4f(-1.0f, -1.0f, -1.0f, -1.0f);
+
+    mutable bool m_isWVPDirty = true;
+    mutable uint m_wvpCameraGeneration = 0;
+    mutable Matrix4f m_worldMatrix;
+    mutable Matrix3f m_normalMatrix;
+    mutable Matrix4f m_wvp;
 };
 
 
@@ -64,6 +94,11 @@ public:
 
     virtual bool RemoveFromRenderList(SceneObject* pSceneObject) = 0;
 
+    // pChild will follow the transformation of pParent. Pass NULL to detach it.
+    // Returns false and leaves the graph unchanged if pParent is pChild or one
+    // of its descendants.
+    virtual bool SetParent(SceneObject* pChild, SceneObject* pParent) = 0;
+
     virtual void SetCamera(const Vector3f& Pos, const Vector3f& Target) = 0;
 
     std::vector<PointLight>& GetPointLights() { return m_pointLights; }
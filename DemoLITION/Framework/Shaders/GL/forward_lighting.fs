@@ -53,43 +53,63 @@ struct Material
     vec3 SpecularColor;
 };
 
-uniform DirectionalLight gDirectionalLight;
-uniform int gNumPointLights;
-uniform PointLight gPointLights[MAX_POINT_LIGHTS];
-uniform int gNumSpotLights;
-uniform SpotLight gSpotLights[MAX_SPOT_LIGHTS];
-uniform Material gMaterial;
-uniform bool gHasSampler = false;
+const int MAX_MATERIALS = 256;
+
+// The uniform blocks must match the structs in gl_forward_lighting_blocks.h
+
+layout (std140) uniform FrameBlock {
+    vec3 gCameraWorldPos;
+    float gFogStart;
+    vec3 gFogColor;
+    float gFogEnd;
+    vec4 gColorMod;
+    vec4 gColorAdd;
+    float gExpFogDensity;
+    float gLayeredFogTop;
+    float gFogTime;
+    float gRimLightPower;
+    float gShadowMapOffsetTextureSize;
+    float gShadowMapOffsetFilterSize;
+    float gShadowMapRandomRadius;
+    int gShadowMapWidth;
+    int gShadowMapHeight;
+    int gShadowMapFilterSize;
+    bool gExpSquaredFogEnabled;
+    bool gRimLightEnabled;
+    bool gCellShadingEnabled;
+    bool gLightingEnabled;
+};
+
+layout (std140) uniform LightsBlock {
+    DirectionalLight gDirectionalLight;
+    PointLight gPointLights[MAX_POINT_LIGHTS];
+    SpotLight gSpotLights[MAX_SPOT_LIGHTS];
+    int gNumPointLights;
+    int gNumSpotLights;
+};
+
+layout (std140) uniform MaterialsBlock {
+    Material gMaterials[MAX_MATERIALS];
+};
+
+// Same as in forward_lighting.vs
+layout (std140, row_major) uniform DrawBlock {
+    mat4 gWVP;
+    mat4 gLightWVP;
+    mat4 gWorld;
+    mat3 gNormalMatrix;
+    int gMaterialIndex;
+    bool gHasSampler;
+    bool gHasNormalMap;
+    bool gEnableSpecularExponent;
+};
+
 layout(binding = 0) uniform sampler2D gSampler;
 layout(binding = 1) uniform sampler2D gSamplerSpecularExponent;
 layout(binding = 2) uniform sampler2D gShadowMap;        // required only for shadow mapping (spot/directional light)
 layout(binding = 3) uniform samplerCube gShadowCubeMap;  // required only for shadow mapping (point light)
 layout(binding = 4) uniform sampler3D gShadowMapOffsetTexture;
 layout(binding = 5) uniform sampler2D gNormalMap;
-uniform bool gHasNormalMap = false;
-uniform int gShadowMapWidth = 0;
-uniform int gShadowMapHeight = 0;
-uniform int gShadowMapFilterSize = 0;
-uniform float gShadowMapOffsetTextureSize;
-uniform float gShadowMapOffsetFilterSize;
-uniform float gShadowMapRandomRadius = 0.0;
-uniform vec3 gCameraWorldPos;
-uniform vec4 gColorMod = vec4(1);
-uniform vec4 gColorAdd = vec4(0);
-uniform float gRimLightPower = 2.0;
-uniform bool gRimLightEnabled = false;
-uniform bool gCellShadingEnabled = false;
-uniform bool gEnableSpecularExponent = false;
-uniform bool gLightingEnabled = true;
-
-// Fog
-uniform float gExpFogDensity = 1.0;
-uniform bool gExpSquaredFogEnabled = false;
-uniform float gLayeredFogTop = -1.0;
-uniform float gFogStart = -1.0;
-uniform float gFogEnd = -1.0;
-uniform float gFogTime = -1.0;
-uniform vec3 gFogColor = vec3(0.0, 0.0, 0.0);
 
 const int toon_color_levels = 4;
 const float toon_scale_factor = 1.0f / toon_color_levels;
@@ -279,7 +299,7 @@ vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal,
 {
     vec4 AmbientColor = vec4(Light.Color, 1.0f) *
                         Light.AmbientIntensity *
-                        vec4(gMaterial.AmbientColor, 1.0f);
+                        vec4(gMaterials[gMaterialIndex].AmbientColor, 1.0f);
 
     float DiffuseFactor = dot(Normal, -LightDirection);
 
@@ -294,7 +314,7 @@ vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal,
 
         DiffuseColor = vec4(Light.Color, 1.0f) *
                        Light.DiffuseIntensity *
-                       vec4(gMaterial.DiffuseColor, 1.0f) *
+                       vec4(gMaterials[gMaterialIndex].DiffuseColor, 1.0f) *
                        DiffuseFactor;
 
         vec3 PixelToCamera = normalize(gCameraWorldPos - WorldPos0);
@@ -311,7 +331,7 @@ vec4 CalcLightInternal(BaseLight Light, vec3 LightDirection, vec3 Normal,
             SpecularFactor = pow(SpecularFactor, SpecularExponent);
             SpecularColor = vec4(Light.Color, 1.0f) *
                             Light.DiffuseIntensity * // using the diffuse intensity for diffuse/specular
-                            vec4(gMaterial.SpecularColor, 1.0f) *
+                            vec4(gMaterials[gMaterialIndex].SpecularColor, 1.0f) *
                             SpecularFactor;
         }
 
@@ -6,10 +6,17 @@ layout (location = 2) in vec3 Normal;
 layout (location = 3) in vec3 Tangent;
 layout (location = 4) in vec3 Bitangent;
 
-uniform mat4 gWVP;
-uniform mat4 gLightWVP;
-uniform mat4 gWorld;
-uniform mat3 gNormalMatrix;
+// Must match UBODraw in gl_forward_lighting_blocks.h and the declaration in forward_lighting.fs
+layout (std140, row_major) uniform DrawBlock {
+    mat4 gWVP;
+    mat4 gLightWVP;
+    mat4 gWorld;
+    mat3 gNormalMatrix;
+    int gMaterialIndex;
+    bool gHasSampler;
+    bool gHasNormalMap;
+    bool gEnableSpecularExponent;
+};
 
 out vec2 TexCoord0;
 out vec3 Normal0;
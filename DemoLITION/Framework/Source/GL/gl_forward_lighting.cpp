@@ -22,8 +22,29 @@
 
 ForwardLightingTechnique::ForwardLightingTechnique()
 {
+    m_draw.WVP.InitIdentity();
+    m_draw.LightWVP.InitIdentity();
+    m_draw.World.InitIdentity();
+    PackNormalMatrix(m_draw.NormalMatrix, Matrix3f(m_draw.World));
 }
 
+
+ForwardLightingTechnique::~ForwardLightingTechnique()
+{
+    if (m_frameBuffer != 0) {
+        glDeleteBuffers(1, &m_frameBuffer);
+    }
+
+    if (m_lightsBuffer != 0) {
+        glDeleteBuffers(1, &m_lightsBuffer);
+    }
+
+    if (m_materialsBuffer != 0) {
+        glDeleteBuffers(1, &m_materialsBuffer);
+    }
+}
+
+
 bool ForwardLightingTechnique::Init()
 {
     if (!Technique::Init()) {
@@ -47,208 +68,192 @@ bool ForwardLightingTechnique::Init()
 
 bool ForwardLightingTechnique::InitCommon()
 {
-    WVPLoc = GetUniformLocation("gWVP");
-    WorldMatrixLoc = GetUniformLocation("gWorld");
-    NormalMatrixLoc = GetUniformLocation("gNormalMatrix");
-    LightWVPLoc = GetUniformLocation("gLightWVP");
     samplerLoc = GetUniformLocation("gSampler");
-    hasSamplerLoc = GetUniformLocation("gHasSampler");
     shadowMapLoc = GetUniformLocation("gShadowMap");
     shadowCubeMapLoc = GetUniformLocation("gShadowCubeMap");
-    shadowMapWidthLoc = GetUniformLocation("gShadowMapWidth");
-    shadowMapHeightLoc = GetUniformLocation("gShadowMapHeight");
-    shadowMapFilterSizeLoc = GetUniformLocation("gShadowMapFilterSize");
     shadowMapOffsetTextureLoc = GetUniformLocation("gShadowMapOffsetTexture");
     NormalMapLoc = GetUniformLocation("gNormalMap");
-    HasNormalMapLoc = GetUniformLocation("gHasNormalMap");
-    ShadowMapOffsetTextureSizeLoc = GetUniformLocation("gShadowMapOffsetTextureSize");
-    ShadowMapOffsetFilterSizeLoc = GetUniformLocation("gShadowMapOffsetFilterSize");
-    ShadowMapRandomRadiusLoc = GetUniformLocation("gShadowMapRandomRadius");
     samplerSpecularExponentLoc = GetUniformLocation("gSamplerSpecularExponent");
-    materialLoc.AmbientColor = GetUniformLocation("gMaterial.AmbientColor");
-    materialLoc.DiffuseColor = GetUniformLocation("gMaterial.DiffuseColor");
-    materialLoc.SpecularColor = GetUniformLocation("gMaterial.SpecularColor");
-    dirLightLoc.Color = GetUniformLocation("gDirectionalLight.Base.Color");
-    dirLightLoc.AmbientIntensity = GetUniformLocation("gDirectionalLight.Base.AmbientIntensity");
-    dirLightLoc.Direction = GetUniformLocation("gDirectionalLight.Direction");
-    dirLightLoc.DiffuseIntensity = GetUniformLocation("gDirectionalLight.Base.DiffuseIntensity");
-    CameraWorldPosLoc = GetUniformLocation("gCameraWorldPos");
-    NumPointLightsLoc = GetUniformLocation("gNumPointLights");
-    NumSpotLightsLoc = GetUniformLocation("gNumSpotLights");
-    ColorModLocation = GetUniformLocation("gColorMod");
-    ColorAddLocation = GetUniformLocation("gColorAdd");
-    EnableRimLightLoc = GetUniformLocation("gRimLightEnabled");
-    EnableCellShadingLoc = GetUniformLocation("gCellShadingEnabled");
-    EnableSpecularExponent = GetUniformLocation("gEnableSpecularExponent");
-    FogStartLoc = GetUniformLocation("gFogStart");
-    FogEndLoc = GetUniformLocation("gFogEnd");
-    FogColorLoc = GetUniformLocation("gFogColor");
-    ExpFogDensityLoc = GetUniformLocation("gExpFogDensity");
-    ExpSquaredFogEnabledLoc = GetUniformLocation("gExpSquaredFogEnabled");
-    LayeredFogTopLoc = GetUniformLocation("gLayeredFogTop");
-    FogTimeLoc = GetUniformLocation("gFogTime");
-    LightingEnabledLoc = GetUniformLocation("gLightingEnabled");
-
-    if (WVPLoc == INVALID_UNIFORM_LOCATION ||
-        WorldMatrixLoc == INVALID_UNIFORM_LOCATION ||
-        NormalMatrixLoc == INVALID_UNIFORM_LOCATION ||
-        LightWVPLoc == INVALID_UNIFORM_LOCATION ||  // required only for shadow mapping
-        samplerLoc == INVALID_UNIFORM_LOCATION ||
-        hasSamplerLoc == INVALID_UNIFORM_LOCATION ||
+
+    if (samplerLoc == INVALID_UNIFORM_LOCATION ||
         shadowMapLoc == INVALID_UNIFORM_LOCATION ||
         shadowCubeMapLoc == INVALID_UNIFORM_LOCATION ||
         NormalMapLoc == INVALID_UNIFORM_LOCATION ||
-        HasNormalMapLoc == INVALID_UNIFORM_LOCATION ||
-        shadowMapWidthLoc == INVALID_UNIFORM_LOCATION ||
-        shadowMapHeightLoc == INVALID_UNIFORM_LOCATION ||
-        shadowMapFilterSizeLoc == INVALID_UNIFORM_LOCATION ||
         shadowMapOffsetTextureLoc == INVALID_UNIFORM_LOCATION ||
-        ShadowMapOffsetTextureSizeLoc == INVALID_UNIFORM_LOCATION ||
-        ShadowMapOffsetFilterSizeLoc == INVALID_UNIFORM_LOCATION ||
-        ShadowMapRandomRadiusLoc == INVALID_UNIFORM_LOCATION ||
-        samplerSpecularExponentLoc == INVALID_UNIFORM_LOCATION ||
-        materialLoc.AmbientColor == INVALID_UNIFORM_LOCATION ||
-        materialLoc.DiffuseColor == INVALID_UNIFORM_LOCATION ||
-        materialLoc.SpecularColor == INVALID_UNIFORM_LOCATION ||
-        CameraWorldPosLoc == INVALID_UNIFORM_LOCATION ||
-        dirLightLoc.Color == INVALID_UNIFORM_LOCATION ||
-        dirLightLoc.DiffuseIntensity == INVALID_UNIFORM_LOCATION ||
-        dirLightLoc.Direction == INVALID_UNIFORM_LOCATION ||
-        dirLightLoc.AmbientIntensity == INVALID_UNIFORM_LOCATION ||
-        NumPointLightsLoc == INVALID_UNIFORM_LOCATION ||
-        NumSpotLightsLoc == INVALID_UNIFORM_LOCATION ||
-        EnableRimLightLoc == INVALID_UNIFORM_LOCATION ||
-        EnableCellShadingLoc == INVALID_UNIFORM_LOCATION ||
-        EnableSpecularExponent == INVALID_UNIFORM_LOCATION ||
-        FogStartLoc == INVALID_UNIFORM_LOCATION ||
-        FogEndLoc == INVALID_UNIFORM_LOCATION ||
-        FogColorLoc == INVALID_UNIFORM_LOCATION ||
-        ExpFogDensityLoc == INVALID_UNIFORM_LOCATION ||
-        ExpSquaredFogEnabledLoc == INVALID_UNIFORM_LOCATION ||
-        LayeredFogTopLoc == INVALID_UNIFORM_LOCATION ||
-        FogTimeLoc == INVALID_UNIFORM_LOCATION ||
-        ColorModLocation == INVALID_UNIFORM_LOCATION ||
-        ColorAddLocation == INVALID_UNIFORM_LOCATION ||
-        LightingEnabledLoc == INVALID_UNIFORM_LOCATION) {
+        samplerSpecularExponentLoc == INVALID_UNIFORM_LOCATION) {
 #ifdef FAIL_ON_MISSING_LOC
         return false;
 #endif
     }
 
-    for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(PointLightsLocation) ; i++) {
-        char Name[128];
-        memset(Name, 0, sizeof(Name));
-        SNPRINTF(Name, sizeof(Name), "gPointLights[%d].Base.Color", i);
-        PointLightsLocation[i].Color = GetUniformLocation(Name);
+    return InitUniformBlocks();
+}
 
-        SNPRINTF(Name, sizeof(Name), "gPointLights[%d].Base.AmbientIntensity", i);
-        PointLightsLocation[i].AmbientIntensity = GetUniformLocation(Name);
 
-        SNPRINTF(Name, sizeof(Name), "gPointLights[%d].WorldPos", i);
-        PointLightsLocation[i].WorldPos = GetUniformLocation(Name);
+bool ForwardLightingTechnique::InitUniformBlocks()
+{
+    if (!ConfigUniformBlock("FrameBlock", FORWARD_LIGHTING_FRAME_BINDING, sizeof(UBOFrame)) ||
+        !ConfigUniformBlock("LightsBlock", FORWARD_LIGHTING_LIGHTS_BINDING, sizeof(UBOLights)) ||
+        !ConfigUniformBlock("MaterialsBlock", FORWARD_LIGHTING_MATERIALS_BINDING, sizeof(UBOMaterial) * FORWARD_LIGHTING_MAX_MATERIALS) ||
+        !ConfigUniformBlock("DrawBlock", FORWARD_LIGHTING_DRAW_BINDING, sizeof(UBODraw))) {
+        return false;
+    }
 
-        SNPRINTF(Name, sizeof(Name), "gPointLights[%d].Base.DiffuseIntensity", i);
-        PointLightsLocation[i].DiffuseIntensity = GetUniformLocation(Name);
+    glGenBuffers(1, &m_frameBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(UBOFrame), NULL, GL_DYNAMIC_DRAW);
 
-        SNPRINTF(Name, sizeof(Name), "gPointLights[%d].Atten.Constant", i);
-        PointLightsLocation[i].Atten.Constant = GetUniformLocation(Name);
+    glGenBuffers(1, &m_lightsBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_lightsBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(UBOLights), NULL, GL_DYNAMIC_DRAW);
 
-        SNPRINTF(Name, sizeof(Name), "gPointLights[%d].Atten.Linear", i);
-        PointLightsLocation[i].Atten.Linear = GetUniformLocation(Name);
+    glGenBuffers(1, &m_materialsBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_materialsBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(UBOMaterial) * FORWARD_LIGHTING_MAX_MATERIALS, NULL, GL_DYNAMIC_DRAW);
 
-        SNPRINTF(Name, sizeof(Name), "gPointLights[%d].Atten.Exp", i);
-        PointLightsLocation[i].Atten.Exp = GetUniformLocation(Name);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-        if (PointLightsLocation[i].Color == INVALID_UNIFORM_LOCATION ||
-            PointLightsLocation[i].AmbientIntensity == INVALID_UNIFORM_LOCATION ||
-            PointLightsLocation[i].WorldPos == INVALID_UNIFORM_LOCATION ||
-            PointLightsLocation[i].DiffuseIntensity == INVALID_UNIFORM_LOCATION ||
-            PointLightsLocation[i].Atten.Constant == INVALID_UNIFORM_LOCATION ||
-            PointLightsLocation[i].Atten.Linear == INVALID_UNIFORM_LOCATION ||
-            PointLightsLocation[i].Atten.Exp == INVALID_UNIFORM_LOCATION) {
-#ifdef FAIL_ON_MISSING_LOC
-            return false;
-#endif
-        }
-    }
+    GLint Alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &Alignment);
 
-    for (unsigned int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(SpotLightsLocation) ; i++) {
-        char Name[128];
-        memset(Name, 0, sizeof(Name));
-        SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Base.Base.Color", i);
-        SpotLightsLocation[i].Color = GetUniformLocation(Name);
+    if (Alignment <= 0) {
+        Alignment = 256;
+    }
 
-        SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Base.Base.AmbientIntensity", i);
-        SpotLightsLocation[i].AmbientIntensity = GetUniformLocation(Name);
+    m_drawStride = ((sizeof(UBODraw) + Alignment - 1) / Alignment) * Alignment;
 
-        SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Direction", i);
-        SpotLightsLocation[i].Direction = GetUniformLocation(Name);
+    m_drawBuffer.Init(m_drawStride * 256);
 
-        SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Base.WorldPos", i);
-        SpotLightsLocation[i].Position = GetUniformLocation(Name);
+    return true;
+}
 
-        SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Cutoff", i);
-        SpotLightsLocation[i].Cutoff = GetUniformLocation(Name);
 
-        SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Base.Base.DiffuseIntensity", i);
-        SpotLightsLocation[i].DiffuseIntensity = GetUniformLocation(Name);
+bool ForwardLightingTechnique::ConfigUniformBlock(const char* pName, GLuint Binding, size_t Size)
+{
+    GLuint BlockIndex = glGetUniformBlockIndex(m_shaderProg, pName);
 
-        SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Base.Atten.Constant", i);
-        SpotLightsLocation[i].Atten.Constant = GetUniformLocation(Name);
+    if (BlockIndex == GL_INVALID_INDEX) {
+        printf("Cannot find uniform block '%s'\n", pName);
+        return false;
+    }
 
-        SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Base.Atten.Linear", i);
-        SpotLightsLocation[i].Atten.Linear = GetUniformLocation(Name);
+    glUniformBlockBinding(m_shaderProg, BlockIndex, Binding);
 
-        SNPRINTF(Name, sizeof(Name), "gSpotLights[%d].Base.Atten.Exp", i);
-        SpotLightsLocation[i].Atten.Exp = GetUniformLocation(Name);
+    // Catches a shader that was changed without the matching struct in gl_forward_lighting_blocks.h
+    GLint BlockSize = 0;
+    glGetActiveUniformBlockiv(m_shaderProg, BlockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &BlockSize);
 
-        if (SpotLightsLocation[i].Color == INVALID_UNIFORM_LOCATION ||
-            SpotLightsLocation[i].AmbientIntensity == INVALID_UNIFORM_LOCATION ||
-            SpotLightsLocation[i].Position == INVALID_UNIFORM_LOCATION ||
-            SpotLightsLocation[i].Direction == INVALID_UNIFORM_LOCATION ||
-            SpotLightsLocation[i].Cutoff == INVALID_UNIFORM_LOCATION ||
-            SpotLightsLocation[i].DiffuseIntensity == INVALID_UNIFORM_LOCATION ||
-            SpotLightsLocation[i].Atten.Constant == INVALID_UNIFORM_LOCATION ||
-            SpotLightsLocation[i].Atten.Linear == INVALID_UNIFORM_LOCATION ||
-            SpotLightsLocation[i].Atten.Exp == INVALID_UNIFORM_LOCATION) {
-#ifdef FAIL_ON_MISSING_LOC
-            return false;
-#endif
-        }
+    if ((size_t)BlockSize > Size) {
+        printf("Uniform block '%s' is %d bytes but its struct is only %d bytes\n", pName, BlockSize, (int)Size);
+        return false;
     }
 
     return true;
 }
 
 
+void ForwardLightingTechnique::BeginDraws(unsigned int NumDraws)
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, FORWARD_LIGHTING_FRAME_BINDING, m_frameBuffer);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FORWARD_LIGHTING_LIGHTS_BINDING, m_lightsBuffer);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FORWARD_LIGHTING_MATERIALS_BINDING, m_materialsBuffer);
+
+    MapDrawBuffer(NumDraws > 0 ? NumDraws : 1);
+}
+
+
+void ForwardLightingTechnique::MapDrawBuffer(unsigned int NumDraws)
+{
+    m_pDrawData = (char*)m_drawBuffer.Map(NumDraws * m_drawStride);
+    m_numDraws = 0;
+    m_maxDraws = NumDraws;
+}
+
+
+void ForwardLightingTechnique::CommitDraw()
+{
+    if (m_numDraws == m_maxDraws) {
+        // More draws than BeginDraws() was told about - continue in another region
+        m_drawBuffer.Fence();
+        MapDrawBuffer(m_maxDraws > 0 ? m_maxDraws : 1);
+    }
+
+    UploadDirtyBlocks();
+
+    size_t Start = m_numDraws * m_drawStride;
+    memcpy(m_pDrawData + Start, &m_draw, sizeof(UBODraw));
+    GLintptr Offset = m_drawBuffer.FlushRange(Start, sizeof(UBODraw));
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, FORWARD_LIGHTING_DRAW_BINDING, m_drawBuffer.GetBuffer(), Offset, sizeof(UBODraw));
+
+    m_numDraws++;
+}
+
+
+void ForwardLightingTechnique::EndDraws()
+{
+    m_drawBuffer.Fence();
+    m_pDrawData = NULL;
+    m_numDraws = 0;
+    m_maxDraws = 0;
+}
+
+
+void ForwardLightingTechnique::UploadDirtyBlocks()
+{
+    if (m_isFrameDirty) {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_frameBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(UBOFrame), &m_frame);
+        m_isFrameDirty = false;
+    }
+
+    if (m_isLightsDirty) {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_lightsBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(UBOLights), &m_lights);
+        m_isLightsDirty = false;
+    }
+
+    if (m_materials.IsDirty()) {
+        int First = 0;
+        int Count = 0;
+        m_materials.GetDirtyRange(First, Count);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_materialsBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, First * sizeof(UBOMaterial), Count * sizeof(UBOMaterial), m_materials.GetData() + First);
+        m_materials.ClearDirty();
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+
 void ForwardLightingTechnique::SetWVP(const Matrix4f& WVP)
 {
-    glUniformMatrix4fv(WVPLoc, 1, GL_TRUE, (const GLfloat*)WVP.m);
+    m_draw.WVP = WVP;
 }
 
 
 void ForwardLightingTechnique::SetWorldMatrix(const Matrix4f& World)
 {
-    glUniformMatrix4fv(WorldMatrixLoc, 1, GL_TRUE, (const GLfloat*)World.m);
+    m_draw.World = World;
 }
 
 
 void ForwardLightingTechnique::SetNormalMatrix(const Matrix3f& NormalMatrix)
 {
-    glUniformMatrix3fv(NormalMatrixLoc, 1, GL_TRUE, (const GLfloat*)NormalMatrix.m);
+    PackNormalMatrix(m_draw.NormalMatrix, NormalMatrix);
 }
 
 
 void ForwardLightingTechnique::SetLightWVP(const Matrix4f& LightWVP)
 {
-    glUniformMatrix4fv(LightWVPLoc, 1, GL_TRUE, (const GLfloat*)LightWVP.m);
+    m_draw.LightWVP = LightWVP;
 }
 
 
 void ForwardLightingTechnique::SetTextureUnit(unsigned int TextureUnit)
 {
     glUniform1i(samplerLoc, TextureUnit);
-    glUniform1i(hasSamplerLoc, 1);
+    m_draw.HasSampler = 1;
 }
 
 
@@ -260,25 +265,27 @@ void ForwardLightingTechnique::SetNormalMapTextureUnit(int TextureUnit)
 
 void ForwardLightingTechnique::ControlNormalMap(bool Enable)
 {
-    glUniform1i(HasNormalMapLoc, Enable);
+    m_draw.HasNormalMap = Enable;
 }
 
 
 void ForwardLightingTechnique::DisableDiffuseTexture()
 {
-    glUniform1i(hasSamplerLoc, 0);
+    m_draw.HasSampler = 0;
 }
 
 void ForwardLightingTechnique::SetShadowMapSize(unsigned int Width, unsigned int Height)
 {
-    glUniform1i(shadowMapWidthLoc, Width);
-    glUniform1i(shadowMapHeightLoc, Height);
+    m_frame.ShadowMapWidth = Width;
+    m_frame.ShadowMapHeight = Height;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetShadowMapFilterSize(unsigned int Size)
 {
-    glUniform1i(shadowMapFilterSizeLoc, Size);
+    m_frame.ShadowMapFilterSize = Size;
+    m_isFrameDirty = true;
 }
 
 
@@ -302,9 +309,10 @@ void ForwardLightingTechnique::SetShadowMapOffsetTextureUnit(unsigned int Textur
 
 void ForwardLightingTechnique::SetShadowMapOffsetTextureParams(float TextureSize, float FilterSize, float Radius)
 {
-    glUniform1f(ShadowMapOffsetTextureSizeLoc, TextureSize);
-    glUniform1f(ShadowMapOffsetFilterSizeLoc, FilterSize);
-    glUniform1f(ShadowMapRandomRadiusLoc, Radius);
+    m_frame.ShadowMapOffsetTextureSize = TextureSize;
+    m_frame.ShadowMapOffsetFilterSize = FilterSize;
+    m_frame.ShadowMapRandomRadius = Radius;
+    m_isFrameDirty = true;
 }
 
 
@@ -316,9 +324,8 @@ void ForwardLightingTechnique::SetSpecularExponentTextureUnit(unsigned int Textu
 
 void ForwardLightingTechnique::SetDirectionalLight(const DirectionalLight& DirLight, bool WithDir)
 {
-    glUniform3f(dirLightLoc.Color, DirLight.Color.x, DirLight.Color.y, DirLight.Color.z);
-    glUniform1f(dirLightLoc.AmbientIntensity, DirLight.AmbientIntensity);
-    glUniform1f(dirLightLoc.DiffuseIntensity, DirLight.DiffuseIntensity);
+    PackDirectionalLight(m_lights.DirectionalLight, DirLight);
+    m_isLightsDirty = true;
 
     if (WithDir) {
         UpdateDirLightDirection(DirLight);
@@ -328,42 +335,38 @@ void ForwardLightingTechnique::SetDirectionalLight(const DirectionalLight& DirLi
 
 void ForwardLightingTechnique::UpdateDirLightDirection(const DirectionalLight& DirLight)
 {
-    Vector3f LocalDirection = DirLight.WorldDirection;
-
-    LocalDirection.Normalize();
-
-    glUniform3f(dirLightLoc.Direction, LocalDirection.x, LocalDirection.y, LocalDirection.z);
+    PackDirectionalLightDir(m_lights.DirectionalLight, DirLight);
+    m_isLightsDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetCameraWorldPos(const Vector3f& CameraWorldPos)
 {
-    glUniform3f(CameraWorldPosLoc, CameraWorldPos.x, CameraWorldPos.y, CameraWorldPos.z);
+    m_frame.CameraWorldPos = CameraWorldPos;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetMaterial(const Material& material)
 {
-    glUniform3f(materialLoc.AmbientColor, material.AmbientColor.r, material.AmbientColor.g, material.AmbientColor.b);
-    glUniform3f(materialLoc.DiffuseColor, material.DiffuseColor.r, material.DiffuseColor.g, material.DiffuseColor.b);
-    glUniform3f(materialLoc.SpecularColor, material.SpecularColor.r, material.SpecularColor.g, material.SpecularColor.b);
+    m_draw.MaterialIndex = m_materials.GetIndex(material);
 }
 
 
 void ForwardLightingTechnique::SetPointLights(unsigned int NumLights, const PointLight* pLights, bool WithPos)
 {
-    glUniform1i(NumPointLightsLoc, NumLights);
+    if (NumLights > MAX_POINT_LIGHTS) {
+        NumLights = MAX_POINT_LIGHTS;
+    }
+
+    m_lights.NumPointLights = NumLights;
 
     for (unsigned int i = 0 ; i < NumLights ; i++) {
-        glUniform3f(PointLightsLocation[i].Color, pLights[i].Color.x, pLights[i].Color.y, pLights[i].Color.z);
-        glUniform1f(PointLightsLocation[i].AmbientIntensity, pLights[i].AmbientIntensity);
-        glUniform1f(PointLightsLocation[i].DiffuseIntensity, pLights[i].DiffuseIntensity);
-        glUniform1f(PointLightsLocation[i].Atten.Constant, pLights[i].Attenuation.Constant);
-        glUniform1f(PointLightsLocation[i].Atten.Linear, pLights[i].Attenuation.Linear);
-        // TODO: assimp puts a very small fraction here leading to burnout of the image
-        glUniform1f(PointLightsLocation[i].Atten.Exp, pLights[i].Attenuation.Exp * 2000.0f); 
+        PackPointLight(m_lights.PointLights[i], pLights[i]);
     }
 
+    m_isLightsDirty = true;
+
     if (WithPos) {
         UpdatePointLightsPos(NumLights, pLights);
     }
@@ -372,27 +375,31 @@ void ForwardLightingTechnique::SetPointLights(unsigned int NumLights, const Poin
 
 void ForwardLightingTechnique::UpdatePointLightsPos(unsigned int NumLights, const PointLight* pLights)
 {
+    if (NumLights > MAX_POINT_LIGHTS) {
+        NumLights = MAX_POINT_LIGHTS;
+    }
+
     for (unsigned int i = 0 ; i < NumLights ; i++) {
-        const Vector3f& WorldPos = pLights[i].WorldPosition;
-        glUniform3f(PointLightsLocation[i].WorldPos, WorldPos.x, WorldPos.y, WorldPos.z);
+        PackPointLightPos(m_lights.PointLights[i], pLights[i]);
     }
+
+    m_isLightsDirty = true;
 }
 
 void ForwardLightingTechnique::SetSpotLights(unsigned int NumLights, const SpotLight* pLights, bool WithPosAndDir)
 {
-    glUniform1i(NumSpotLightsLoc, NumLights);
+    if (NumLights > MAX_SPOT_LIGHTS) {
+        NumLights = MAX_SPOT_LIGHTS;
+    }
+
+    m_lights.NumSpotLights = NumLights;
 
     for (unsigned int i = 0 ; i < NumLights ; i++) {
-        glUniform3f(SpotLightsLocation[i].Color, pLights[i].Color.x, pLights[i].Color.y, pLights[i].Color.z);
-        glUniform1f(SpotLightsLocation[i].AmbientIntensity, pLights[i].AmbientIntensity);
-        glUniform1f(SpotLightsLocation[i].DiffuseIntensity, pLights[i].DiffuseIntensity);
-        glUniform1f(SpotLightsLocation[i].Cutoff, cosf(ToRadian(pLights[i].Cutoff)));
-        glUniform1f(SpotLightsLocation[i].Atten.Constant, pLights[i].Attenuation.Constant);
-        glUniform1f(SpotLightsLocation[i].Atten.Linear,   pLights[i].Attenuation.Linear);
-        // TODO: assimp puts a very small fraction here leading to burnout of the image
-        glUniform1f(SpotLightsLocation[i].Atten.Exp, pLights[i].Attenuation.Exp * 5.0f);
+        PackSpotLight(m_lights.SpotLights[i], pLights[i]);
     }
 
+    m_isLightsDirty = true;
+
     if (WithPosAndDir) {
         UpdateSpotLightsPosAndDir(NumLights, pLights);
     }
@@ -401,55 +408,49 @@ void ForwardLightingTechnique::SetSpotLights(unsigned int NumLights, const SpotL
 
 void ForwardLightingTechnique::UpdateSpotLightsPosAndDir(unsigned int NumLights, const SpotLight* pLights)
 {
+    if (NumLights > MAX_SPOT_LIGHTS) {
+        NumLights = MAX_SPOT_LIGHTS;
+    }
+
     for (unsigned int i = 0 ; i < NumLights ; i++) {
-        Vector3f Direction = pLights[i].WorldDirection;
-        Direction.Normalize();
-        glUniform3f(SpotLightsLocation[i].Direction, Direction.x, Direction.y, Direction.z);
-        const Vector3f& WorldPos = pLights[i].WorldPosition;
-        glUniform3f(SpotLightsLocation[i].Position, WorldPos.x, WorldPos.y, WorldPos.z);
+        PackSpotLightPosAndDir(m_lights.SpotLights[i], pLights[i]);
     }
+
+    m_isLightsDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetColorMod(const Vector4f& Color)
 {
-    glUniform4f(ColorModLocation, Color.x, Color.y, Color.z, Color.w);
+    m_frame.ColorMod = Color;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetColorAdd(const Vector4f& Color)
 {
-    glUniform4f(ColorAddLocation, Color.x, Color.y, Color.z, Color.w);
+    m_frame.ColorAdd = Color;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::ControlRimLight(bool IsEnabled)
 {
-    if (IsEnabled) {
-        glUniform1i(EnableRimLightLoc, 1);
-    } else {
-        glUniform1i(EnableRimLightLoc, 0);
-    }
+    m_frame.RimLightEnabled = IsEnabled ? 1 : 0;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::ControlCellShading(bool IsEnabled)
 {
-    if (IsEnabled) {
-        glUniform1i(EnableCellShadingLoc, 1);
-    } else {
-        glUniform1i(EnableCellShadingLoc, 0);
-    }
+    m_frame.CellShadingEnabled = IsEnabled ? 1 : 0;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::ControlSpecularExponent(bool IsEnabled)
 {
-    if (IsEnabled) {
-        glUniform1i(EnableSpecularExponent, 1);
-    } else {
-        glUniform1i(EnableSpecularExponent, 0);
-    }
+    m_draw.EnableSpecularExponent = IsEnabled ? 1 : 0;
 }
 
 
@@ -470,25 +471,26 @@ void ForwardLightingTechnique::SetLinearFog(float FogStart, float FogEnd)
         exit(1);
     }
 
-    glUniform1f(LayeredFogTopLoc, -1.0f);
-    glUniform1f(FogTimeLoc, -1.0f);
+    m_frame.LayeredFogTop = -1.0f;
+    m_frame.FogTime = -1.0f;
 
-    glUniform1f(FogStartLoc, FogStart);
-    glUniform1f(FogEndLoc, FogEnd);
+    m_frame.FogStart = FogStart;
+    m_frame.FogEnd = FogEnd;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetExpFog(float FogEnd, float FogDensity)
 {
     SetExpFogCommon(FogEnd, FogDensity);
-    glUniform1i(ExpSquaredFogEnabledLoc, 0);
+    m_frame.ExpSquaredFogEnabled = 0;
 }
 
 
 void ForwardLightingTechnique::SetExpSquaredFog(float FogEnd, float FogDensity)
 {
     SetExpFogCommon(FogEnd, FogDensity);
-    glUniform1i(ExpSquaredFogEnabledLoc, 1);
+    m_frame.ExpSquaredFogEnabled = 1;
 }
 
 
@@ -504,12 +506,13 @@ void ForwardLightingTechnique::SetExpFogCommon(float FogEnd, float FogDensity)
         exit(1);
     }
 
-    glUniform1f(FogStartLoc, -1.0f);
-    glUniform1f(LayeredFogTopLoc, -1.0f);
-    glUniform1f(FogTimeLoc, -1.0f);
+    m_frame.FogStart = -1.0f;
+    m_frame.LayeredFogTop = -1.0f;
+    m_frame.FogTime = -1.0f;
 
-    glUniform1f(FogEndLoc, FogEnd);
-    glUniform1f(ExpFogDensityLoc, FogDensity);
+    m_frame.FogEnd = FogEnd;
+    m_frame.ExpFogDensity = FogDensity;
+    m_isFrameDirty = true;
 }
 
 
@@ -525,37 +528,42 @@ void ForwardLightingTechnique::SetLayeredFog(float FogTop, float FogEnd)
         exit(1);
     }
 
-    glUniform1f(FogStartLoc, -1.0f);
-    glUniform1f(FogTimeLoc, -1.0f);
+    m_frame.FogStart = -1.0f;
+    m_frame.FogTime = -1.0f;
 
-    glUniform1f(LayeredFogTopLoc, FogTop);
-    glUniform1f(FogEndLoc, FogEnd);
+    m_frame.LayeredFogTop = FogTop;
+    m_frame.FogEnd = FogEnd;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetFogColor(const Vector3f& FogColor)
 {
-    glUniform3f(FogColorLoc, FogColor.r, FogColor.g, FogColor.b);
+    m_frame.FogColor = FogColor;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetFogTime(float Time)
 {
-    glUniform1f(FogTimeLoc, Time);
+    m_frame.FogTime = Time;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetAnimatedFog(float FogEnd, float FogDensity)
 {
-    glUniform1f(FogStartLoc, -1.0f);
-    glUniform1f(LayeredFogTopLoc, -1.0f);
+    m_frame.FogStart = -1.0f;
+    m_frame.LayeredFogTop = -1.0f;
 
-    glUniform1f(FogEndLoc, FogEnd);
-    glUniform1f(ExpFogDensityLoc, FogDensity);
+    m_frame.FogEnd = FogEnd;
+    m_frame.ExpFogDensity = FogDensity;
+    m_isFrameDirty = true;
 }
 
 
 void ForwardLightingTechnique::SetLightingEnabled(bool LightingEnabled)
 {
-    glUniform1i(LightingEnabledLoc, LightingEnabled);
+    m_frame.LightingEnabled = LightingEnabled ? 1 : 0;
+    m_isFrameDirty = true;
 }
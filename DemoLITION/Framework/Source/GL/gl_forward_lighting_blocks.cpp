@@ -0,0 +1,198 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include <string.h>
+
+#include "GL/gl_forward_lighting_blocks.h"
+
+// The std140 offsets of the members in forward_lighting.vs/fs
+static_assert(offsetof(UBOFrame, FogStart) == 12, "std140 mismatch");
+static_assert(offsetof(UBOFrame, FogColor) == 16, "std140 mismatch");
+static_assert(offsetof(UBOFrame, ColorMod) == 32, "std140 mismatch");
+static_assert(offsetof(UBOFrame, ExpFogDensity) == 64, "std140 mismatch");
+static_assert(offsetof(UBOFrame, ShadowMapOffsetTextureSize) == 80, "std140 mismatch");
+static_assert(offsetof(UBOFrame, ShadowMapHeight) == 96, "std140 mismatch");
+static_assert(offsetof(UBOFrame, CellShadingEnabled) == 112, "std140 mismatch");
+static_assert(sizeof(UBOFrame) == 128, "std140 mismatch");
+
+static_assert(sizeof(UBOBaseLight) == 32, "std140 mismatch");
+static_assert(offsetof(UBODirectionalLight, Direction) == 32, "std140 mismatch");
+static_assert(sizeof(UBODirectionalLight) == 48, "std140 mismatch");
+static_assert(offsetof(UBOPointLight, WorldPos) == 32, "std140 mismatch");
+static_assert(offsetof(UBOPointLight, Atten) == 48, "std140 mismatch");
+static_assert(sizeof(UBOPointLight) == 64, "std140 mismatch");
+static_assert(offsetof(UBOSpotLight, Direction) == 64, "std140 mismatch");
+static_assert(offsetof(UBOSpotLight, Cutoff) == 76, "std140 mismatch");
+static_assert(sizeof(UBOSpotLight) == 80, "std140 mismatch");
+static_assert(offsetof(UBOLights, PointLights) == 48, "std140 mismatch");
+static_assert(offsetof(UBOLights, SpotLights) == 48 + 64 * FORWARD_LIGHTING_MAX_POINT_LIGHTS, "std140 mismatch");
+static_assert(offsetof(UBOLights, NumPointLights) == 48 + 64 * FORWARD_LIGHTING_MAX_POINT_LIGHTS + 80 * FORWARD_LIGHTING_MAX_SPOT_LIGHTS, "std140 mismatch");
+
+static_assert(offsetof(UBOMaterial, DiffuseColor) == 16, "std140 mismatch");
+static_assert(offsetof(UBOMaterial, SpecularColor) == 32, "std140 mismatch");
+static_assert(sizeof(UBOMaterial) == 48, "std140 mismatch");
+
+static_assert(offsetof(UBODraw, LightWVP) == 64, "std140 mismatch");
+static_assert(offsetof(UBODraw, World) == 128, "std140 mismatch");
+static_assert(offsetof(UBODraw, NormalMatrix) == 192, "std140 mismatch");
+static_assert(offsetof(UBODraw, MaterialIndex) == 240, "std140 mismatch");
+static_assert(sizeof(UBODraw) == 256, "std140 mismatch");
+
+
+static void PackBaseLight(UBOBaseLight& Dst, const BaseLight& Light)
+{
+    Dst.Color = Light.Color;
+    Dst.AmbientIntensity = Light.AmbientIntensity;
+    Dst.DiffuseIntensity = Light.DiffuseIntensity;
+}
+
+
+void PackDirectionalLight(UBODirectionalLight& Dst, const DirectionalLight& Light)
+{
+    PackBaseLight(Dst.Base, Light);
+}
+
+
+void PackDirectionalLightDir(UBODirectionalLight& Dst, const DirectionalLight& Light)
+{
+    Vector3f Direction = Light.WorldDirection;
+    Direction.Normalize();
+    Dst.Direction = Direction;
+}
+
+
+void PackPointLight(UBOPointLight& Dst, const PointLight& Light)
+{
+    PackBaseLight(Dst.Base, Light);
+    Dst.Atten.Constant = Light.Attenuation.Constant;
+    Dst.Atten.Linear = Light.Attenuation.Linear;
+    // TODO: assimp puts a very small fraction here leading to burnout of the image
+    Dst.Atten.Exp = Light.Attenuation.Exp * 2000.0f;
+}
+
+
+void PackPointLightPos(UBOPointLight& Dst, const PointLight& Light)
+{
+    Dst.WorldPos = Light.WorldPosition;
+}
+
+
+void PackSpotLight(UBOSpotLight& Dst, const SpotLight& Light)
+{
+    PackBaseLight(Dst.Base.Base, Light);
+    Dst.Cutoff = cosf(ToRadian(Light.Cutoff));
+    Dst.Base.Atten.Constant = Light.Attenuation.Constant;
+    Dst.Base.Atten.Linear = Light.Attenuation.Linear;
+    // TODO: assimp puts a very small fraction here leading to burnout of the image
+    Dst.Base.Atten.Exp = Light.Attenuation.Exp * 5.0f;
+}
+
+
+void PackSpotLightPosAndDir(UBOSpotLight& Dst, const SpotLight& Light)
+{
+    Vector3f Direction = Light.WorldDirection;
+    Direction.Normalize();
+    Dst.Direction = Direction;
+    Dst.Base.WorldPos = Light.WorldPosition;
+}
+
+
+void PackMaterial(UBOMaterial& Dst, const Material& Mat)
+{
+    Dst.AmbientColor = Mat.AmbientColor;
+    Dst.DiffuseColor = Mat.DiffuseColor;
+    Dst.SpecularColor = Mat.SpecularColor;
+}
+
+
+void PackNormalMatrix(float Dst[3][4], const Matrix3f& NormalMatrix)
+{
+    for (int i = 0 ; i < 3 ; i++) {
+        Dst[i][0] = NormalMatrix.m[i][0];
+        Dst[i][1] = NormalMatrix.m[i][1];
+        Dst[i][2] = NormalMatrix.m[i][2];
+        Dst[i][3] = 0.0f;
+    }
+}
+
+
+int UBOMaterialTable::GetIndex(const Material& Mat)
+{
+    UBOMaterial Packed;
+    PackMaterial(Packed, Mat);
+
+    std::map<const Material*, int>::iterator it = m_slots.find(&Mat);
+
+    if (it != m_slots.end()) {
+        int Index = it->second;
+
+        if (memcmp(&m_materials[Index], &Packed, sizeof(Packed)) != 0) {
+            m_materials[Index] = Packed;
+            MarkDirty(Index);
+        }
+
+        return Index;
+    }
+
+    if (m_numMaterials == FORWARD_LIGHTING_MAX_MATERIALS) {
+        // Start over. The slots are reused only by the draws that follow
+        // the next upload so the draws already issued are not affected.
+        m_slots.clear();
+        m_numMaterials = 0;
+    }
+
+    int Index = m_numMaterials++;
+    m_materials[Index] = Packed;
+    m_slots[&Mat] = Index;
+    MarkDirty(Index);
+
+    return Index;
+}
+
+
+void UBOMaterialTable::MarkDirty(int Index)
+{
+    if (!IsDirty()) {
+        m_dirtyBegin = Index;
+        m_dirtyEnd = Index + 1;
+        return;
+    }
+
+    if (Index < m_dirtyBegin) {
+        m_dirtyBegin = Index;
+    }
+
+    if (Index + 1 > m_dirtyEnd) {
+        m_dirtyEnd = Index + 1;
+    }
+}
+
+
+void UBOMaterialTable::GetDirtyRange(int& First, int& Count) const
+{
+    First = m_dirtyBegin;
+    Count = m_dirtyEnd - m_dirtyBegin;
+}
+
+
+void UBOMaterialTable::ClearDirty()
+{
+    m_dirtyBegin = 0;
+    m_dirtyEnd = 0;
+}
@@ -19,6 +19,7 @@
 #include "ogldev_engine_common.h"
 #include "GL/gl_forward_renderer.h"
 #include "GL/gl_rendering_system.h"
+#include "ogldev_gl_state.h"
 
 #define SHADOW_MAP_WIDTH 2048
 #define SHADOW_MAP_HEIGHT 2048
@@ -65,7 +66,7 @@ void ForwardRenderer::InitForwardRenderer(RenderingSystemGL* pRenderingSystemGL)
 
     InitShadowMapping();
 
-    glUseProgram(0);
+    GLState::UseProgram(0);
 }
 
 
@@ -136,12 +137,8 @@ void ForwardRenderer::InitShadowMapping()
 
 void ForwardRenderer::SwitchToLightingTech()
 {
-    GLint cur_prog = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &cur_prog);
-
-    if (cur_prog != m_lightingTech.GetProgram()) {
-        m_lightingTech.Enable();
-    }
+    // GLState drops the call if the lighting program is already bound
+    m_lightingTech.Enable();
 }
 
 
@@ -177,6 +174,7 @@ void ForwardRenderer::ShadowMapPass(GLScene* pScene)
 
     if (NumSpotLights > 0) {
         m_lightViewMatrix.InitCameraTransform(SpotLights[0].WorldPosition, SpotLights[0].WorldDirection * -1.0f, SpotLights[0].Up);
+        m_lightViewProjMatrix = m_lightPersProjMatrix * m_lightViewMatrix;
     }
 
     const std::vector<DirectionalLight>& DirLights = pScene->GetDirLights();
@@ -185,6 +183,7 @@ void ForwardRenderer::ShadowMapPass(GLScene* pScene)
     if (DirLights.size() == 1) {
         NumDirLights = 1;
         m_lightViewMatrix.InitCameraTransform(Origin, DirLights[0].WorldDirection, DirLights[0].Up);
+        m_lightViewProjMatrix = m_lightPersProjMatrix * m_lightViewMatrix;
     } else if (DirLights.size() > 1) {
         printf("%s:%d - only a single directional light is supported\n", __FILE__, __LINE__);
     }
@@ -208,13 +207,18 @@ void ForwardRenderer::ShadowMapPassPoint(const std::list<CoreSceneObject*>& Rend
 
     glClearColor(FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX);
 
+    m_shadowMapPointLightTech.BeginDraws(NUM_CUBE_MAP_FACES * CountDraws(RenderList));
+
     for (uint i = 0; i < NUM_CUBE_MAP_FACES; i++) {
         m_shadowCubeMapFBO.BindForWriting(gCameraDirections[i].CubemapFace);
-        glViewport(0, 0, SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT);
+        GLState::Viewport(0, 0, SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT);
         glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
         m_lightViewMatrix.InitCameraTransform(PointLights[0].WorldPosition, gCameraDirections[i].Target, gCameraDirections[i].Up);
+        m_lightViewProjMatrix = m_lightPersProjMatrix * m_lightViewMatrix;
         RenderEntireRenderList(RenderList);
     }
+
+    m_shadowMapPointLightTech.EndDraws();
 }
 
 
@@ -224,7 +228,9 @@ void ForwardRenderer::ShadowMapPassDirAndSpot(const std::list<CoreSceneObject*>&
     m_shadowMapFBO.BindForWriting();
     glClear(GL_DEPTH_BUFFER_BIT);
     m_shadowMapTech.Enable();
+    m_shadowMapTech.BeginDraws(CountDraws(RenderList));
     RenderEntireRenderList(RenderList);
+    m_shadowMapTech.EndDraws();
 }
 
 
@@ -239,7 +245,7 @@ void ForwardRenderer::RenderEntireRenderList(const std::list<CoreSceneObject*>&
 
 void ForwardRenderer::LightingPass(GLScene* pScene)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
 
     if (m_curRenderPass == RENDER_PASS_SHADOW) {
         m_shadowMapFBO.BindForReading(SHADOW_TEXTURE_UNIT);
@@ -254,7 +260,7 @@ void ForwardRenderer::LightingPass(GLScene* pScene)
     int WindowHeight = 0;
     m_pRenderingSystemGL->GetWindowSize(WindowWidth, WindowHeight);
 
-    glViewport(0, 0, WindowWidth, WindowHeight);
+    GLState::Viewport(0, 0, WindowWidth, WindowHeight);
 
     bool FirstTimeForwardLighting = true;
 
@@ -276,6 +282,38 @@ void ForwardRenderer::LightingPass(GLScene* pScene)
             RenderWithFlatColor(pSceneObject);
         }
     }
+
+    if (!FirstTimeForwardLighting) {
+        m_lightingTech.EndDraws();
+    }
+}
+
+
+uint ForwardRenderer::CountDraws(const std::list<CoreSceneObject*>& RenderList)
+{
+    uint NumDraws = 0;
+
+    for (std::list<CoreSceneObject*>::const_iterator it = RenderList.begin(); it != RenderList.end(); it++) {
+        NumDraws += (*it)->GetModel()->GetNumMeshes();
+    }
+
+    return NumDraws;
+}
+
+
+uint ForwardRenderer::CountForwardLightingDraws(GLScene* pScene)
+{
+    uint NumDraws = 0;
+
+    const std::list<CoreSceneObject*>& RenderList = pScene->GetRenderList();
+
+    for (std::list<CoreSceneObject*>::const_iterator it = RenderList.begin(); it != RenderList.end(); it++) {
+        if ((*it)->GetFlatColor().x == -1.0f) {
+            NumDraws += (*it)->GetModel()->GetNumMeshes();
+        }
+    }
+
+    return NumDraws;
 }
 
 
@@ -315,11 +353,18 @@ void ForwardRenderer::StartRenderWithForwardLighting(GLScene* pScene, CoreSceneO
     }
 
     m_lightingTech.SetCameraWorldPos(m_pCurCamera->GetPos());
+
+    m_lightingTech.BeginDraws(CountForwardLightingDraws(pScene));
 }
 
 
 void ForwardRenderer::RenderWithForwardLighting(CoreSceneObject* pSceneObject)
 {
+    m_pcurSceneObject = pSceneObject;
+
+    // A flat color object may have been rendered since the previous one
+    SwitchToLightingTech();
+
     CoreModel* pModel = pSceneObject->GetModel();
     bool NormalMapEnabled = pModel->GetNormalMap() != NULL;
     m_lightingTech.ControlNormalMap(NormalMapEnabled);
@@ -406,14 +451,7 @@ void ForwardRenderer::RenderWithFlatColor(CoreSceneObject* pSceneObject)
 
 void ForwardRenderer::GetWVP(CoreSceneObject* pSceneObject, Matrix4f& WVP)
 {
-    Matrix4f World = pSceneObject->GetMatrix();
-    Matrix4f View = m_pCurCamera->GetMatrix();
-    Matrix4f Projection = m_pCurCamera->GetProjectionMat();
-
-   // Projection.Print();
- //   exit(0);
-
-    WVP = Projection * View * World;
+    WVP = pSceneObject->GetWVP(*m_pCurCamera);
 }
 
 
@@ -539,40 +577,52 @@ void ForwardRenderer::SetWorldMatrix_CB(const Matrix4f& World)
 
 void ForwardRenderer::SetWorldMatrix_CB_ShadowPass(const Matrix4f& World)
 {
-    Matrix4f ObjectMatrix = m_pcurSceneObject->GetMatrix();
    // Matrix4f WVP = m_lightOrthoProjMatrix * m_lightViewMatrix * World * ObjectMatrix;
-    Matrix4f WVP = m_lightPersProjMatrix * m_lightViewMatrix * World;
+    Matrix4f WVP = m_lightViewProjMatrix * World;
     m_shadowMapTech.SetWVP(WVP);
+    m_shadowMapTech.CommitDraw();
 }
 
 
 void ForwardRenderer::SetWorldMatrix_CB_ShadowPassPoint(const Matrix4f& World)
 {
-    Matrix4f ObjectMatrix = m_pcurSceneObject->GetMatrix();
-    Matrix4f WVP = m_lightPersProjMatrix * m_lightViewMatrix * World * ObjectMatrix;
+    const Matrix4f& ObjectMatrix = m_pcurSceneObject->GetMatrix();
+    Matrix4f WVP = m_lightViewProjMatrix * World * ObjectMatrix;
     m_shadowMapPointLightTech.SetWorld(World);
     m_shadowMapPointLightTech.SetWVP(WVP);
+    m_shadowMapPointLightTech.CommitDraw();
 }
 
 
 void ForwardRenderer::SetWorldMatrix_CB_LightingPass(const Matrix4f& World)
 {
-    Matrix4f ObjectMatrix = m_pcurSceneObject->GetMatrix();
+    const Matrix4f& ObjectMatrix = m_pcurSceneObject->GetMatrix();
+
+    // Meshes that are attached to the root node of the model have an identity
+    // transformation so the matrices cached by the scene object can be used as is
+    if (World.IsIdentity()) {
+        m_lightingTech.SetWorldMatrix(ObjectMatrix);
+        m_lightingTech.SetWVP(m_pcurSceneObject->GetWVP(*m_pCurCamera));
+        m_lightingTech.SetLightWVP(m_lightViewProjMatrix * ObjectMatrix);
+        m_lightingTech.SetNormalMatrix(m_pcurSceneObject->GetNormalMatrix());
+        m_lightingTech.CommitDraw();
+        return;
+    }
+
     Matrix4f FinalWorldMatrix = World * ObjectMatrix;
     m_lightingTech.SetWorldMatrix(FinalWorldMatrix);
 
-    Matrix4f View = m_pCurCamera->GetMatrix();
-    Matrix4f Projection = m_pCurCamera->GetProjectionMat();
-    Matrix4f WVP = Projection * View * FinalWorldMatrix;
+    Matrix4f WVP = m_pCurCamera->GetViewProjMatrix() * FinalWorldMatrix;
     m_lightingTech.SetWVP(WVP);
 
     //Matrix4f LightWVP = m_lightOrthoProjMatrix * m_lightViewMatrix * World;
-    Matrix4f LightWVP = m_lightPersProjMatrix * m_lightViewMatrix * FinalWorldMatrix;    
+    Matrix4f LightWVP = m_lightViewProjMatrix * FinalWorldMatrix;
     m_lightingTech.SetLightWVP(LightWVP);
 
-    Matrix4f InverseWorld = FinalWorldMatrix.Inverse();
-    Matrix3f World3x3(InverseWorld);
-    Matrix3f WorldTranspose = World3x3.Transpose();
+    // (World * Object)^-T = World^-T * Object^-T
+    Matrix3f InverseWorld(World.InverseAffine());
+    Matrix3f NormalMatrix = InverseWorld.Transpose() * m_pcurSceneObject->GetNormalMatrix();
 
-    m_lightingTech.SetNormalMatrix(WorldTranspose);
+    m_lightingTech.SetNormalMatrix(NormalMatrix);
+    m_lightingTech.CommitDraw();
 }
\ No newline at end of file
@@ -80,6 +80,9 @@ void RenderingSystemGL::CreateWindowInternal()
 
     glfwSetCursorPos(m_pWindow, m_windowWidth / 2, m_windowHeight / 2);
 
+    // All the GL state changes of the framework go through GLState (F9 toggles)
+    GLState::SetFilteringEnabled(true);
+
     SetDefaultGLState();
 
     InitCallbacks();
@@ -155,8 +158,8 @@ void RenderingSystemGL::SetDefaultGLState()
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glFrontFace(GL_CW);
     glCullFace(GL_BACK);
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
+    GLState::Enable(GL_CULL_FACE);
+    GLState::Enable(GL_DEPTH_TEST);
 }
 
 
@@ -184,7 +187,12 @@ void RenderingSystemGL::Execute()
         m_pCamera->OnRender();
         m_pGameCallbacks->OnFrame();
         if (m_pScene) {
+            ((GLScene*)m_pScene)->UpdateTransforms();
+            // The game may have called GL directly in OnFrame()
+            GLState::Invalidate();
+            GLState::ResetStats();
             m_forwardRenderer.Render((GLScene*)m_pScene);
+            m_lastFrameGLStats = GLState::GetStats();
         } else {
             printf("Warning! no scene is set in the rendering subsystem\n");
         }
@@ -213,6 +221,14 @@ void RenderingSystemGL::OnKeyCallback(GLFWwindow* window, int key, int scancode,
             Shutdown();
             exit(0);
 
+        case GLFW_KEY_F9:
+            if (action == GLFW_PRESS) {
+                m_lastFrameGLStats.Print();
+                GLState::SetFilteringEnabled(!GLState::IsFilteringEnabled());
+                printf("GL state filtering %s\n", GLState::IsFilteringEnabled() ? "enabled" : "disabled");
+            }
+            break;
+
         default:
             m_pCamera->OnKeyboard(key);
         }
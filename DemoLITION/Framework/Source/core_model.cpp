@@ -19,6 +19,7 @@
 #include "ogldev_engine_common.h"
 #include "Int/core_rendering_system.h"
 #include "Int/core_model.h"
+#include "ogldev_gl_state.h"
 
 #include "3rdparty/meshoptimizer/src/meshoptimizer.h"
 
@@ -95,7 +96,7 @@ bool CoreModel::LoadAssimpModel(const string& Filename, int WindowWidth, int Win
         glCreateBuffers(ARRAY_SIZE_IN_ELEMENTS(m_Buffers), m_Buffers);
     } else {
     	glGenVertexArrays(1, &m_VAO);
-	    glBindVertexArray(m_VAO);
+	    GLState::BindVertexArray(m_VAO);
 	    glGenBuffers(ARRAY_SIZE_IN_ELEMENTS(m_Buffers), m_Buffers);
     }
 
@@ -116,7 +117,7 @@ bool CoreModel::LoadAssimpModel(const string& Filename, int WindowWidth, int Win
     }
 
     // Make sure the VAO is not changed from the outside
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
 
     return Ret;
 }
@@ -669,14 +670,14 @@ void CoreModel::PopulateBuffersDSA()
 
 void CoreModel::Render(DemolitionRenderCallbacks* pRenderCallbacks)
 {
-    glBindVertexArray(m_VAO);
+    GLState::BindVertexArray(m_VAO);
 
     for (unsigned int i = 0 ; i < m_Meshes.size() ; i++) {
         RenderMesh(i, pRenderCallbacks);
     }
 
     // Make sure the VAO is not changed from the outside
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
 }
 
 
@@ -728,7 +729,7 @@ void CoreModel::RenderMesh(int MeshIndex, DemolitionRenderCallbacks* pRenderCall
 
 void CoreModel::Render(unsigned int DrawIndex, unsigned int PrimID)
 {
-    glBindVertexArray(m_VAO);
+    GLState::BindVertexArray(m_VAO);
 
     unsigned int MaterialIndex = m_Meshes[DrawIndex].MaterialIndex;
     assert(MaterialIndex < m_Materials.size());
@@ -748,7 +749,7 @@ void CoreModel::Render(unsigned int DrawIndex, unsigned int PrimID)
                              m_Meshes[DrawIndex].BaseVertex);
 
     // Make sure the VAO is not changed from the outside
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
 }
 
 
@@ -762,7 +763,7 @@ void CoreModel::Render(unsigned int NumInstances, const Matrix4f* WVPMats, const
     glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[WORLD_MAT_BUFFER]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Matrix4f) * NumInstances, WorldMats, GL_DYNAMIC_DRAW);
 
-    glBindVertexArray(m_VAO);
+    GLState::BindVertexArray(m_VAO);
 
     for (unsigned int i = 0 ; i < m_Meshes.size() ; i++) {
         const unsigned int MaterialIndex = m_Meshes[i].MaterialIndex;
@@ -786,7 +787,7 @@ void CoreModel::Render(unsigned int NumInstances, const Matrix4f* WVPMats, const
     }
 
     // Make sure the VAO is not changed from the outside
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
 }
 
 
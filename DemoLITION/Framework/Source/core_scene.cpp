@@ -19,22 +19,75 @@
 #include "Int/core_scene.h"
 #include "Int/core_rendering_system.h"
 
-#define NUM_SCENE_OBJECTS 1024
+// Levels of the scene graph smaller than this are updated on the calling thread
+#define MIN_NODES_PER_JOB 1024
 
-Matrix4f SceneObject::GetMatrix() const
+
+static Matrix4f CalcLocalMatrix(const Vector3f& Pos, const Vector3f& Rot, const Vector3f& Scale)
 {
-    Matrix4f Scale;
-    Scale.InitScaleTransform(m_scale);
+    Matrix4f ScaleTrans;
+    ScaleTrans.InitScaleTransform(Scale);
 
     Matrix4f Rotation;
-    Rotation.InitRotateTransform(m_rot);
+    Rotation.InitRotateTransform(Rot);
 
     Matrix4f Translation;
-    Translation.InitTranslationTransform(m_pos);
+    Translation.InitTranslationTransform(Pos);
+
+    return Translation * Rotation * ScaleTrans;
+}
+
+
+void SceneObject::SetWorldMatrix(const Matrix4f& World) const
+{
+    m_worldMatrix = World;
+
+    // The scaling may be non uniform so we need the real inverse transpose
+    Matrix3f InverseWorld(m_worldMatrix.InverseAffine());
+    m_normalMatrix = InverseWorld.Transpose();
+
+    m_isDirty = false;
+    m_isWVPDirty = true;
+}
+
+
+// The world matrix of a root object is its local matrix. Objects with a parent
+// are updated by Scene::UpdateTransforms.
+void SceneObject::UpdateRoot() const
+{
+    if (!m_hasParent && m_isDirty) {
+        SetWorldMatrix(CalcLocalMatrix(m_pos, m_rot, m_scale));
+    }
+}
+
+
+const Matrix4f& SceneObject::GetMatrix() const
+{
+    UpdateRoot();
+
+    return m_worldMatrix;
+}
+
+
+const Matrix3f& SceneObject::GetNormalMatrix() const
+{
+    UpdateRoot();
+
+    return m_normalMatrix;
+}
+
+
+const Matrix4f& SceneObject::GetWVP(const BasicCamera& Camera) const
+{
+    UpdateRoot();
 
-    Matrix4f WorldTransformation = Translation * Rotation * Scale;
+    if (m_isWVPDirty || (m_wvpCameraGeneration != Camera.GetGeneration())) {
+        m_wvp = Camera.GetViewProjMatrix() * m_worldMatrix;
+        m_wvpCameraGeneration = Camera.GetGeneration();
+        m_isWVPDirty = false;
+    }
 
-    return WorldTransformation;
+    return m_wvp;
 }
 
 
@@ -47,7 +100,6 @@ CoreScene::CoreScene(CoreRenderingSystem* pRenderingSystem)
 {
     m_pCoreRenderingSystem = pRenderingSystem;
     CreateDefaultCamera();
-    m_sceneObjects.resize(NUM_SCENE_OBJECTS);
 }
 
 void CoreScene::LoadScene(const std::string& Filename)
@@ -85,7 +137,11 @@ void CoreScene::CreateDefaultCamera()
     float zFar = 1000.0f;
     int WindowWidth = 0;
     int WindowHeight = 0;
-    m_pCoreRenderingSystem->GetWindowSize(WindowWidth, WindowHeight);
+
+    // A scene without a rendering system is used by the tools and the tests
+    if (m_pCoreRenderingSystem) {
+        m_pCoreRenderingSystem->GetWindowSize(WindowWidth, WindowHeight);
+    }
 
     PersProjInfo persProjInfo = { FOV, (float)WindowWidth, (float)WindowHeight, zNear, zFar };
 
@@ -127,11 +183,6 @@ bool CoreScene::RemoveFromRenderList(SceneObject* pSceneObject)
 
 SceneObject* CoreScene::CreateSceneObject(Model* pModel)
 {
-    if (m_numSceneObjects == NUM_SCENE_OBJECTS) {
-        printf("%s:%d - out of scene objects space\n", __FILE__, __LINE__);
-        exit(0);
-    }
-    
     CoreSceneObject* pCoreSceneObject = CreateSceneObjectInternal((CoreModel*)pModel);
 
     return pCoreSceneObject;
@@ -150,16 +201,161 @@ SceneObject* CoreScene::CreateSceneObject(const std::string& BasicShape)
 
 CoreSceneObject* CoreScene::CreateSceneObjectInternal(CoreModel* pModel)
 {
-    m_sceneObjects[m_numSceneObjects].SetModel(pModel);
+    m_sceneObjects.emplace_back();
 
-    CoreSceneObject* pCoreSceneObject = &(m_sceneObjects[m_numSceneObjects]);
+    CoreSceneObject* pCoreSceneObject = &m_sceneObjects.back();
 
-    m_numSceneObjects++;
+    pCoreSceneObject->SetModel(pModel);
+
+    m_isHierarchyDirty = true;
 
     return pCoreSceneObject;
 }
 
 
+bool CoreScene::SetParent(SceneObject* pChild, SceneObject* pParent)
+{
+    CoreSceneObject* pCoreChild = (CoreSceneObject*)pChild;
+    CoreSceneObject* pCoreParent = (CoreSceneObject*)pParent;
+
+    if (!pCoreChild) {
+        printf("%s:%d - child must not be NULL\n", __FILE__, __LINE__);
+        exit(0);
+    }
+
+    for (CoreSceneObject* p = pCoreParent ; p ; p = p->GetParent()) {
+        if (p == pCoreChild) {
+            printf("%s:%d - setting the parent would create a cycle in the scene graph\n", __FILE__, __LINE__);
+            return false;
+        }
+    }
+
+    pCoreChild->SetParent(pCoreParent);
+
+    m_isHierarchyDirty = true;
+
+    return true;
+}
+
+
+void CoreScene::RebuildHierarchy()
+{
+    int NumNodes = (int)m_sceneObjects.size();
+
+    m_nodes.clear();
+    m_nodes.reserve(NumNodes);
+    m_parentIndex.resize(NumNodes);
+    m_positions.resize(NumNodes);
+    m_rotations.resize(NumNodes);
+    m_scales.resize(NumNodes);
+    m_worldMatrices.resize(NumNodes);
+    m_dirtyFlags.resize(NumNodes);
+    m_levelStart.clear();
+
+    // The first level are the objects without a parent, in creation order
+    for (CoreSceneObject& Object : m_sceneObjects) {
+        if (!Object.GetParent()) {
+            Object.SetNodeIndex((int)m_nodes.size());
+            m_parentIndex[m_nodes.size()] = -1;
+            m_nodes.push_back(&Object);
+        }
+    }
+
+    // Breadth first - each level is the children of the previous level
+    int LevelStart = 0;
+
+    while (LevelStart < (int)m_nodes.size()) {
+        int LevelEnd = (int)m_nodes.size();
+        m_levelStart.push_back(LevelStart);
+
+        for (int i = LevelStart ; i < LevelEnd ; i++) {
+            for (CoreSceneObject* pChild : m_nodes[i]->GetChildren()) {
+                pChild->SetNodeIndex((int)m_nodes.size());
+                m_parentIndex[m_nodes.size()] = i;
+                m_nodes.push_back(pChild);
+            }
+        }
+
+        LevelStart = LevelEnd;
+    }
+
+    m_levelStart.push_back((int)m_nodes.size());
+
+    m_isHierarchyDirty = false;
+}
+
+
+void CoreScene::UpdateTransforms()
+{
+    bool ForceUpdate = m_isHierarchyDirty;
+
+    if (m_isHierarchyDirty) {
+        RebuildHierarchy();
+    }
+
+    // A parent is always in an earlier level than its children so each level
+    // only depends on the previous one and can be split across the workers
+    for (int Level = 0 ; Level < (int)m_levelStart.size() - 1 ; Level++) {
+        int LevelStart = m_levelStart[Level];
+        int LevelEnd = m_levelStart[Level + 1];
+        int Count = LevelEnd - LevelStart;
+
+        int NumJobs = std::max(1, std::min(m_jobs.GetNumThreads(), Count / MIN_NODES_PER_JOB));
+        int JobSize = (Count + NumJobs - 1) / NumJobs;
+
+        m_jobs.Dispatch(NumJobs, [&](int Job, int) {
+            int Start = LevelStart + Job * JobSize;
+            UpdateNodes(Start, std::min(Start + JobSize, LevelEnd), ForceUpdate);
+        });
+    }
+}
+
+
+void CoreScene::UpdateNodes(int Start, int End, bool ForceUpdate)
+{
+    for (int i = Start ; i < End ; i++) {
+        CoreSceneObject* pObject = m_nodes[i];
+        int Parent = m_parentIndex[i];
+
+        bool IsDirty = ForceUpdate || pObject->IsMoved();
+
+        if (IsDirty) {
+            m_positions[i] = pObject->GetPosition();
+            m_rotations[i] = pObject->GetRotation();
+            m_scales[i] = pObject->GetScale();
+            pObject->ClearMoved();
+        }
+
+        if (Parent >= 0) {
+            IsDirty = IsDirty || m_dirtyFlags[Parent];
+        }
+
+        m_dirtyFlags[i] = IsDirty;
+
+        // Clean subtrees are skipped
+        if (!IsDirty) {
+            continue;
+        }
+
+        Matrix4f Local = CalcLocalMatrix(m_positions[i], m_rotations[i], m_scales[i]);
+
+        if (Parent >= 0) {
+            m_worldMatrices[i] = m_worldMatrices[Parent] * Local;
+        } else {
+            m_worldMatrices[i] = Local;
+        }
+
+        pObject->SetWorldMatrix(m_worldMatrices[i]);
+    }
+}
+
+
+int CoreScene::GetNumUpdatedNodes() const
+{
+    return (int)std::count(m_dirtyFlags.begin(), m_dirtyFlags.end(), 1);
+}
+
+
 const std::vector<PointLight>& CoreScene::GetPointLights()
 {
     if (m_pointLights.size() > 0) {
@@ -111,9 +111,9 @@ public:
       //  m_phongRenderer.RenderAnimation(m_pMesh, AnimationTimeSec, m_animationIndex);
 
         for (int i = 0; i < NUM_ASTEROIDS; i++) {
-            m_pMesh->SetPosition(m_asteroids[i].Pos);
-            m_phongRenderer.Render(m_pMesh);
-            m_pMesh->SetPosition(m_asteroids[i].Pos.z -= m_asteroids[i].Speed);
+            m_asteroidTransforms[i].SetRotation(0.0f, 180.0f + foo, 0.0f);
+            m_asteroidTransforms[i].SetPosition(m_asteroids[i].Pos);
+            m_asteroids[i].Pos.z -= m_asteroids[i].Speed;
             float zFar = m_pGameCamera->GetPersProjInfo().zFar;
             if (m_asteroids[i].Pos.Distance(m_pGameCamera->GetPos()) > zFar) {
              //   printf("new %d\n", i);
@@ -124,7 +124,9 @@ public:
                 m_asteroids[i].Speed = RandomFloatRange(5.1f, 5.3f);
 
             }
-        }        
+        }
+
+        m_phongRenderer.RenderInstanced(m_pMesh, NUM_ASTEROIDS, m_asteroidTransforms.data());
     }
 
 
@@ -267,6 +269,7 @@ private:
     void InitAsteroids()
     {
         m_asteroids.resize(NUM_ASTEROIDS);
+        m_asteroidTransforms.resize(NUM_ASTEROIDS);
 
         float zFar = m_pGameCamera->GetPersProjInfo().zFar;
         for (int i = 0; i < NUM_ASTEROIDS; i++) {
@@ -299,6 +302,7 @@ private:
     };
 
     std::vector<Asteroid> m_asteroids;
+    std::vector<WorldTrans> m_asteroidTransforms;
 };
 
 Tutorial49* app = NULL;
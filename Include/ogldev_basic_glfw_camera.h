@@ -46,7 +46,7 @@ public:
 
     void SetTarget(const Vector3f& target);
 
-    void SetUp(float x, float y, float z) { m_up.x = x; m_up.y = y; m_up.z = z;}
+    void SetUp(float x, float y, float z) { m_up.x = x; m_up.y = y; m_up.z = z; OnChange(); }
 
     bool OnKeyboard(int key);
 
@@ -66,7 +66,8 @@ public:
 
     const PersProjInfo& GetPersProjInfo() const { return m_persProjInfo; }
 
-    Matrix4f GetViewProjMatrix() const;
+    // Cached - rebuilt only after the camera has changed
+    const Matrix4f& GetViewProjMatrix() const;
 
     Matrix4f GetViewMatrix() const { return GetMatrix(); }
 
@@ -80,10 +81,16 @@ public:
 
     const std::string& GetName() const { return m_name; }
 
+    // Changes whenever the view or projection changes. Two cameras with the same
+    // generation are guaranteed to have the same matrices so it can be used as a cache key.
+    uint GetGeneration() const { return m_generation; }
+
 private:
 
     void InitInternal();
     void Update();
+    void OnChange();
+    void UpdateViewProj() const;
 
     std::string m_name;
 
@@ -107,6 +114,11 @@ private:
     
     PersProjInfo m_persProjInfo;
     Matrix4f m_projection;
+
+    uint m_generation = 0;
+    mutable uint m_viewGeneration = (uint)-1;
+    mutable Matrix4f m_view;
+    mutable Matrix4f m_viewProj;
 };
 
 #endif
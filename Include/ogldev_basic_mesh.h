@@ -53,6 +53,15 @@ public:
 
     void Render(uint NumInstances, const Matrix4f* WVPMats, const Matrix4f* WorldMats);
 
+    // Per-instance data is read from InstanceBuffer starting at BaseOffset.
+    // Each instance is an InstanceData struct with both matrices transposed.
+    void RenderInstanced(uint NumInstances, GLuint InstanceBuffer, GLintptr BaseOffset);
+
+    struct InstanceData {
+        Matrix4f WVP;
+        Matrix4f World;
+    };
+
     const Material& GetMaterial();
 
     PBRMaterial& GetPBRMaterial() { return m_Materials[0].PBRmaterial; };
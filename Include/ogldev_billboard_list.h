@@ -24,27 +24,112 @@
 
 #include "ogldev_texture.h"
 #include "ogldev_billboard_technique.h"
+#include "ogldev_parallel.h"
 
+// Number of regions in the streaming buffer. The CPU writes one region while
+// the GPU may still read the previous ones.
+#define BILLBOARD_LIST_NUM_REGIONS 3
+
+struct Billboard
+{
+    Vector3f Pos;                                   // bottom left corner
+    float Size = 1.0f;
+    Vector4f Color = Vector4f(1.0f, 1.0f, 1.0f, 1.0f);  // multiplies the texture
+    u32 AtlasIndex = 0;                             // see BillboardTechnique::SetAtlasSize
+};
+
+
+//
+// The billboards are kept on the CPU and the visible ones are streamed every
+// frame into a persistently mapped buffer (GL 4.4; glBufferSubData otherwise).
+// Render() culls them against the view frustum and optionally sorts them back
+// to front for blending. Both steps run on a pool of worker threads.
+//
+// By default every billboard is an instance of a 4 vertex strip that is built
+// in the vertex shader. The geometry shader path is kept for comparison.
+//
 class BillboardList
 {
 public:
     BillboardList();    
     ~BillboardList();
     
+    // Static list - one white billboard of size 1 per position
     bool Init(const std::string& TexFilename, const std::vector<Vector3f>& Positions);
-    
+
+    // Dynamic list that can hold up to MaxBillboards
+    bool Init(const std::string& TexFilename, int MaxBillboards, int AtlasCols = 1, int AtlasRows = 1);
+
+    void SetBillboards(const std::vector<Billboard>& Billboards);
+
+    void UpdateBillboard(int Index, const Billboard& b);
+
+    int GetNumBillboards() const { return (int)m_billboards.size(); }
+
+    const Billboard& GetBillboard(int Index) const { return m_billboards[Index]; }
+
+    void SetCullingEnabled(bool Enabled) { m_isCullingEnabled = Enabled; m_isDirty = true; }
+
+    // Only needed when blending is enabled by the caller
+    void SetSortingEnabled(bool Enabled) { m_isSortingEnabled = Enabled; m_isDirty = true; }
+
+    void SetUseGeometryShader(bool UseGS) { m_useGeometryShader = UseGS; }
+
     void Render(const Matrix4f& VP, const Vector3f& CameraPos);
 
+    // Number of billboards drawn by the last Render()
+    int GetNumVisible() const { return m_numVisible; }
+
 private:
-    void CreatePositionBuffer(const std::vector<Vector3f>& Positions);
-    
-    int m_numPoints = 0;
-    GLuint m_vao = INVALID_OGL_VALUE;
+
+    struct BillboardInstance {
+        Vector3f Pos;
+        float Size;
+        u32 Color;      // RGBA8
+        u32 AtlasIndex;
+    };
+
+    void CreateBuffers();
+
+    void SetupVertexAttribs(GLuint VAO, GLuint Divisor);
+
+    void CullAndSort(const Matrix4f& VP);
+
+    void Upload(const Matrix4f& VP);
+
+    int m_maxBillboards = 0;
+    std::vector<Billboard> m_billboards;
+    bool m_isCullingEnabled = true;
+    bool m_isSortingEnabled = false;
+    bool m_useGeometryShader = false;
+    bool m_isDirty = true;      // the billboards changed since the last upload
+    int m_atlasCols = 1;
+    int m_atlasRows = 1;
+
+    // Indices of the visible billboards in draw order
+    std::vector<u32> m_visible;
+    std::vector<u32> m_sortKeys;
+    std::vector<u32> m_tempKeys;
+    std::vector<u32> m_tempVisible;
+    std::vector<std::vector<u32>> m_chunkVisible;
+    std::vector<std::vector<u32>> m_chunkKeys;
+    std::vector<BillboardInstance> m_uploadBuffer;  // when persistent mapping is not available
+    JobSystem m_jobs;
+
+    int m_numVisible = 0;
+    int m_firstInstance = 0;    // of the last upload in the buffer
+
+    GLuint m_pointsVAO = INVALID_OGL_VALUE;     // geometry shader path
+    GLuint m_instancedVAO = INVALID_OGL_VALUE;
     GLuint m_VB = INVALID_OGL_VALUE;
+    BillboardInstance* m_pMappedVB = NULL;      // persistent mapping of all the regions
+    GLsync m_fences[BILLBOARD_LIST_NUM_REGIONS] = {};
+    int m_currRegion = 0;
+
     Texture* m_pTexture;
     BillboardTechnique m_technique;
+    InstancedBillboardTechnique m_instancedTechnique;
 };
 
 
 #endif	/* BILLBOARD_LIST_H */
-
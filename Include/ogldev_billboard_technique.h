@@ -32,12 +32,33 @@ public:
     void SetVP(const Matrix4f& VP);
     void SetCameraPosition(const Vector3f& Pos);
     void SetColorTextureUnit(unsigned int TextureUnit);
+
+    // The texture is a grid of Cols x Rows tiles. Tile 0 is at texture coordinate (0, 0)
+    // and the index grows along the rows.
+    void SetAtlasSize(int Cols, int Rows);
     
+protected:
+
+    bool InitUniforms();
+
 private:
 
     GLuint m_VPLocation;
     GLuint m_cameraPosLocation;
     GLuint m_colorMapLocation;
+    GLuint m_atlasSizeLocation;
+};
+
+
+// Expands one instance into a quad in the vertex shader instead of a point in
+// the geometry shader
+class InstancedBillboardTechnique : public BillboardTechnique
+{
+public:
+
+    InstancedBillboardTechnique() {}
+
+    virtual bool Init();
 };
 
 #endif	/* BILLBOARD_TECHNIQUE_H */
@@ -0,0 +1,99 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_CPU_PARTICLES_H
+#define OGLDEV_CPU_PARTICLES_H
+
+#include <vector>
+
+#include "ogldev_particles.h"
+#include "ogldev_parallel.h"
+
+//
+// CPU reference of GPUParticleSystem. The particles are stored as one array
+// per component and updated by SIMD kernels on all the cores. It does not
+// touch GL so it can run headless, e.g. to validate the compute shaders or
+// to simulate on a server.
+//
+// The free list is rebuilt in ascending slot order regardless of the number
+// of threads, so a run is deterministic.
+//
+class CPUParticleSystem {
+ public:
+    CPUParticleSystem() {}
+
+    void Init(int MaxParticles, const ParticleEmitterDesc& Emitter);
+
+    void SetEmitter(const ParticleEmitterDesc& Emitter) { m_emitter = Emitter; }
+
+    const ParticleEmitterDesc& GetEmitter() const { return m_emitter; }
+
+    // Number of chunks the update is split into. 0 means one per thread of
+    // the job system (all the cores).
+    void SetNumThreads(int NumThreads) { m_numThreads = NumThreads; }
+
+    void Update(float DeltaTimeSecs);
+
+    int GetMaxParticles() const { return m_maxParticles; }
+
+    int GetNumAlive() const { return m_maxParticles - (int)m_freeList.size(); }
+
+    // Number of particles requested by the emitter since Init, including
+    // the ones that were dropped because all the slots were taken
+    u32 GetNumEmitted() const { return m_numEmitted; }
+
+    bool IsAlive(int i) const { return m_age[i] < m_lifetime[i]; }
+
+    Vector3f GetPos(int i) const { return Vector3f(m_posX[i], m_posY[i], m_posZ[i]); }
+
+    Vector3f GetVel(int i) const { return Vector3f(m_velX[i], m_velY[i], m_velZ[i]); }
+
+    float GetAge(int i) const { return m_age[i]; }
+
+    float GetLifetime(int i) const { return m_lifetime[i]; }
+
+    // Bounding box of the live particles. Returns false if there are none.
+    bool CalcBounds(Vector3f& Min, Vector3f& Max) const;
+
+ private:
+
+    void UpdateRange(int Start, int End, float DeltaTimeSecs, std::vector<u32>& Died);
+
+    void Emit(int Count);
+
+    ParticleEmitterDesc m_emitter;
+    ParticleEmissionClock m_clock;
+    int m_maxParticles = 0;
+    int m_numThreads = 0;
+    JobSystem m_jobs;
+    u32 m_numEmitted = 0;
+
+    std::vector<float> m_posX;
+    std::vector<float> m_posY;
+    std::vector<float> m_posZ;
+    std::vector<float> m_velX;
+    std::vector<float> m_velY;
+    std::vector<float> m_velZ;
+    std::vector<float> m_age;
+    std::vector<float> m_lifetime;
+
+    // Dead slots. Emission pops from the back.
+    std::vector<u32> m_freeList;
+};
+
+#endif
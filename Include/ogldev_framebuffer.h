@@ -30,6 +30,8 @@ public:
 
     void Init(int Width, int Height);
 
+    void Destroy();
+
     void BindForWriting();
 
     void UnbindWriting();
@@ -42,11 +44,15 @@ public:
 
     GLuint GetDepthTexture() const { return m_depthBuffer; }
 
+    int GetWidth() const { return m_width; }
+
+    int GetHeight() const { return m_height; }
+
 private:
     int m_width = 0;
     int m_height = 0;
-    GLuint m_fbo = -1;
-    GLuint m_textureBuffer = -1;
-    GLuint m_depthBuffer = -1;
+    GLuint m_fbo = 0;
+    GLuint m_textureBuffer = 0;
+    GLuint m_depthBuffer = 0;
     SaveViewport m_saveViewport;
 };
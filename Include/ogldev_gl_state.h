@@ -0,0 +1,113 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_GL_STATE_H
+#define OGLDEV_GL_STATE_H
+
+#include <GL/glew.h>
+
+#include "ogldev_types.h"
+
+enum GL_STATE_CATEGORY {
+    GL_STATE_PROGRAM = 0,
+    GL_STATE_VERTEX_ARRAY,
+    GL_STATE_TEXTURE,
+    GL_STATE_FRAMEBUFFER,
+    GL_STATE_VIEWPORT,
+    GL_STATE_CAPABILITY,        // glEnable/glDisable
+    GL_STATE_BLEND,
+    GL_STATE_DEPTH,
+    GL_STATE_NUM_CATEGORIES
+};
+
+
+struct GLStateStats {
+    u64 NumIssued[GL_STATE_NUM_CATEGORIES] = {};
+    u64 NumFiltered[GL_STATE_NUM_CATEGORIES] = {};
+
+    u64 GetTotalIssued() const;
+    u64 GetTotalFiltered() const;
+    void Print() const;
+};
+
+
+//
+// Shadows the bound program, VAO, textures, framebuffers, viewport and the
+// blend/depth state so that calls which don't change anything never reach
+// the driver. Filtering is off by default; when it is off every call is
+// forwarded as is and only counted, which gives the baseline for comparison.
+//
+// The shadow copy is only correct if all the changes go through this class.
+// Code that calls GL directly (third party libraries, texture loading, etc)
+// must be followed by Invalidate(). Invalidating once per frame is cheap.
+//
+class GLState {
+ public:
+
+    static void SetFilteringEnabled(bool Enabled);
+
+    static bool IsFilteringEnabled() { return s_isFilteringEnabled; }
+
+    // Forget everything; the next call of each kind is always issued
+    static void Invalidate();
+
+    static void UseProgram(GLuint Program);
+
+    // The program of the last UseProgram (tracked even when filtering is
+    // off). Doesn't match any program after Invalidate().
+    static GLuint GetProgram();
+
+    static void BindVertexArray(GLuint VAO);
+
+    // TextureUnit is GL_TEXTURE0 + i like in glActiveTexture
+    static void BindTexture(GLenum TextureUnit, GLenum Target, GLuint Texture);
+
+    // GL_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER
+    static void BindFramebuffer(GLenum Target, GLuint FBO);
+
+    static void Viewport(int x, int y, int Width, int Height);
+
+    // GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, etc
+    static void Enable(GLenum Cap);
+
+    static void Disable(GLenum Cap);
+
+    static void BlendFunc(GLenum SrcFactor, GLenum DstFactor);
+
+    static void DepthFunc(GLenum Func);
+
+    static void DepthMask(bool Enable);
+
+    // IsGLVersionHigher(4, 5) evaluated once
+    static bool IsDSAAvailable();
+
+    static const GLStateStats& GetStats() { return s_stats; }
+
+    static void ResetStats();
+
+ private:
+
+    static bool Filter(GL_STATE_CATEGORY Category, bool IsRedundant);
+
+    static void SetCap(GLenum Cap, bool Enable);
+
+    static bool s_isFilteringEnabled;
+    static GLStateStats s_stats;
+};
+
+#endif
@@ -0,0 +1,105 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_GPU_PARTICLES_H
+#define OGLDEV_GPU_PARTICLES_H
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "ogldev_particles.h"
+#include "ogldev_particle_techniques.h"
+
+class Texture;
+
+//
+// Particle system that lives entirely in shader storage buffers. Every frame
+// a compute pass updates the live particles, pushes the ones that die on an
+// atomic dead list and appends the survivors to the alive list. A second pass
+// pops slots from the dead list for the new particles. The alive list feeds an
+// indirect instanced draw so the CPU never learns how many particles there are.
+//
+// Requires GL 4.3 (compute shaders + SSBOs). See CPUParticleSystem for the
+// same simulation on the CPU.
+//
+class GPUParticleSystem {
+ public:
+    GPUParticleSystem();
+
+    ~GPUParticleSystem();
+
+    static bool IsSupported();
+
+    bool Init(int MaxParticles, const ParticleEmitterDesc& Emitter);
+
+    void SetEmitter(const ParticleEmitterDesc& Emitter) { m_emitter = Emitter; }
+
+    const ParticleEmitterDesc& GetEmitter() const { return m_emitter; }
+
+    // Not owned by the particle system
+    void SetTexture(Texture* pTexture) { m_pTexture = pTexture; }
+
+    void SetBillboardSize(float BillboardSize) { m_billboardSize = BillboardSize; }
+
+    void Update(float DeltaTimeSecs);
+
+    void Render(const Matrix4f& VP, const Vector3f& CameraPos);
+
+    int GetMaxParticles() const { return m_maxParticles; }
+
+    // See CPUParticleSystem::GetNumEmitted
+    u32 GetNumEmitted() const { return m_numEmitted; }
+
+    // The following read back from the GPU and stall the pipeline.
+    // Use them for debugging and validation only.
+
+    int ReadNumAlive() const;
+
+    // xyz + age and xyz + lifetime per slot. A slot is alive if age < lifetime.
+    void ReadParticles(std::vector<Vector4f>& PosAge, std::vector<Vector4f>& VelLifetime) const;
+
+ private:
+
+    void BindStorageBuffers();
+
+    enum {
+        POS_AGE_BUFFER = 0,
+        VEL_LIFETIME_BUFFER,
+        DEAD_LIST_BUFFER,
+        ALIVE_LIST_BUFFER,
+        COUNTERS_BUFFER,
+        DRAW_COMMAND_BUFFER,
+        NUM_BUFFERS
+    };
+
+    ParticleEmitterDesc m_emitter;
+    ParticleEmissionClock m_clock;
+    int m_maxParticles = 0;
+    u32 m_numEmitted = 0;
+    float m_billboardSize = 0.01f;
+
+    GLuint m_buffers[NUM_BUFFERS] = {};
+    GLuint m_VAO = 0;   // the render pass has no vertex attributes but GL core needs a VAO
+    Texture* m_pTexture = NULL;
+
+    ParticleUpdateTechnique m_updateTech;
+    ParticleEmitTechnique m_emitTech;
+    ParticleRenderTechnique m_renderTech;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_INDEX_ENCODER_H
+#define OGLDEV_INDEX_ENCODER_H
+
+#include <vector>
+
+#include "ogldev_types.h"
+
+// Separates the strips and fans. PackIndices turns it into 0xFFFF when
+// the indices go into 16 bits.
+#define OGLDEV_RESTART_INDEX 0xFFFFFFFF
+
+// The post transform cache that the orderings are tuned for and the ACMR
+// is measured with. Small enough for any GPU.
+#define OGLDEV_VERTEX_CACHE_SIZE 16
+
+enum INDEX_TOPOLOGY {
+    INDEX_TOPOLOGY_TRIANGLES,
+    INDEX_TOPOLOGY_TRIANGLE_STRIP,
+    INDEX_TOPOLOGY_TRIANGLE_FAN
+};
+
+
+// A draw call over [Start, Start + Count) of the index buffer
+struct IndexRange {
+    int Start = 0;
+    int Count = 0;
+    int BaseVertex = 0;
+};
+
+
+inline uint GetRestartIndex(int IndexSize)
+{
+    return (IndexSize == sizeof(ushort)) ? 0xFFFF : OGLDEV_RESTART_INDEX;
+}
+
+
+//
+// Triangle strips for a grid of Width x Depth vertices in row major order.
+// They have the same triangles as the two triangles per quad of the terrain
+// triangle lists (BL, TL, TR and BL, TR, BR) - same diagonal, same winding.
+//
+// The rows are split into bands whose vertices fit in 16 bit indices and
+// every band gets a range for a draw call with its first vertex as the base.
+// Inside a band each strip goes up a single column of quads for only a few
+// rows so that the column it shares with the next strip is still in a
+// cache of CacheSize vertices. The indices are absolute.
+//
+void BuildGridStrips(int Width, int Depth, int CacheSize, std::vector<uint>& Indices, std::vector<IndexRange>& Ranges);
+
+// Joins the triangles that continue the fan of the previous triangle - same
+// first vertex, the second vertex is the third of the previous one - into
+// fans separated by the restart index
+void BuildTriangleFans(const uint* pTriangles, int NumIndices, std::vector<uint>& Fans);
+
+// Reorders the triangles, or the strips/fans between the restart indices, so
+// that each one reuses as many vertices of a FIFO cache of CacheSize
+// vertices as possible. Does not change the primitives themselves.
+void OptimizeVertexCache(INDEX_TOPOLOGY Topology, std::vector<uint>& Indices, int CacheSize);
+
+// Average cache miss ratio - the vertices that miss a FIFO cache of
+// CacheSize vertices divided by the number of triangles. 0.5 is the best a
+// large grid can do and 3 the worst.
+float CalcACMR(INDEX_TOPOLOGY Topology, const uint* pIndices, int NumIndices, int CacheSize);
+
+// Expands strips/fans to a triangle list in the winding that GL uses. The
+// degenerate triangles are dropped.
+void DecodeTriangles(INDEX_TOPOLOGY Topology, const uint* pIndices, int NumIndices, std::vector<uint>& Triangles);
+
+// Writes the indices of every range relative to its base vertex. Returns 2
+// if all of them fit in 16 bits and the buffer holds ushorts, otherwise 4
+// and the buffer holds uints.
+int PackIndices(const std::vector<uint>& Indices, const std::vector<IndexRange>& Ranges, std::vector<uchar>& Buffer);
+
+#endif
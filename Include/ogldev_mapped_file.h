@@ -0,0 +1,70 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_MAPPED_FILE_H
+#define OGLDEV_MAPPED_FILE_H
+
+#include <stddef.h>
+
+#include "ogldev_types.h"
+
+enum MAPPED_FILE_ACCESS {
+    MAPPED_FILE_ACCESS_SEQUENTIAL,  // read once from start to end - prefetch aggressively
+    MAPPED_FILE_ACCESS_RANDOM,      // sparse reads - don't read ahead
+};
+
+//
+// A read only view of a whole file. The pages are mapped directly from the
+// page cache so nothing is copied until the caller touches the data, and
+// the size is 64 bit. The mapping is released by Close() or the destructor,
+// so a pointer from GetData() must not outlive the object.
+//
+// Open() does not report errors; a missing file is a normal condition for
+// the caches that use this class.
+//
+class MappedFile {
+ public:
+    MappedFile() {}
+
+    ~MappedFile();
+
+    bool Open(const char* pFilename, MAPPED_FILE_ACCESS Access = MAPPED_FILE_ACCESS_SEQUENTIAL);
+
+    void Close();
+
+    bool IsOpen() const { return m_isOpen; }
+
+    // NULL for an empty file
+    const void* GetData() const { return m_pData; }
+
+    u64 GetSize() const { return m_size; }
+
+ private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void* m_pData = NULL;
+    u64 m_size = 0;
+    bool m_isOpen = false;
+#ifdef _WIN32
+    void* m_fileHandle = NULL;
+    void* m_mappingHandle = NULL;
+#endif
+};
+
+#endif
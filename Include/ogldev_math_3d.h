@@ -33,6 +33,7 @@
 #include <cfloat>
 
 #include "ogldev_util.h"
+#include "ogldev_math_simd.h"
 
 #include <assimp/vector3.h>
 #include <assimp/matrix3x3.h>
@@ -546,18 +547,24 @@ public:
         m[3][0] = 0.0f; m[3][1] = 0.0f; m[3][2] = 0.0f; m[3][3] = 1.0f;
     }
 
+    inline bool IsIdentity() const
+    {
+        for (int i = 0 ; i < 4 ; i++) {
+            for (int j = 0 ; j < 4 ; j++) {
+                if (m[i][j] != ((i == j) ? 1.0f : 0.0f)) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
     inline Matrix4f operator*(const Matrix4f& Right) const
     {
         Matrix4f Ret;
 
-        for (unsigned int i = 0 ; i < 4 ; i++) {
-            for (unsigned int j = 0 ; j < 4 ; j++) {
-                Ret.m[i][j] = m[i][0] * Right.m[0][j] +
-                              m[i][1] * Right.m[1][j] +
-                              m[i][2] * Right.m[2][j] +
-                              m[i][3] * Right.m[3][j];
-            }
-        }
+        MatrixMulSIMD(&m[0][0], &Right.m[0][0], &Ret.m[0][0]);
 
         return Ret;
     }
@@ -566,10 +573,26 @@ public:
     {
         Vector4f r;
 
-        r.x = m[0][0]* v.x + m[0][1]* v.y + m[0][2]* v.z + m[0][3]* v.w;
-        r.y = m[1][0]* v.x + m[1][1]* v.y + m[1][2]* v.z + m[1][3]* v.w;
-        r.z = m[2][0]* v.x + m[2][1]* v.y + m[2][2]* v.z + m[2][3]* v.w;
-        r.w = m[3][0]* v.x + m[3][1]* v.y + m[3][2]* v.z + m[3][3]* v.w;
+        MatrixMulVec4SIMD(&m[0][0], &v.x, &r.x);
+
+        return r;
+    }
+
+    // Scalar versions of the operators - used as the reference for the SIMD code
+    Matrix4f MulReference(const Matrix4f& Right) const
+    {
+        Matrix4f Ret;
+
+        MatrixMulScalar(&m[0][0], &Right.m[0][0], &Ret.m[0][0]);
+
+        return Ret;
+    }
+
+    Vector4f MulReference(const Vector4f& v) const
+    {
+        Vector4f r;
+
+        MatrixMulVec4Scalar(&m[0][0], &v.x, &r.x);
 
         return r;
     }
@@ -588,8 +611,15 @@ public:
 
     float Determinant() const;
 
+    // Uses the fastest backend available on the CPU (see SetMathBackend)
     Matrix4f Inverse() const;
 
+    // Scalar cofactor expansion - the reference for the SIMD version
+    Matrix4f InverseReference() const;
+
+    // Fast path for matrices whose bottom row is (0, 0, 0, 1), e.g. world and view matrices
+    Matrix4f InverseAffine() const;
+
     void InitScaleTransform(float ScaleX, float ScaleY, float ScaleZ);
     void InitScaleTransform(float Scale);
     void InitScaleTransform(const Vector3f& Scale);
@@ -863,4 +893,38 @@ int CalcNextPowerOfTwo(int x);
 
 bool IsPointInsideViewFrustum(const Vector3f& p, const Matrix4f& VP);
 
+//
+// Runtime selection of the SIMD backend used by Matrix4f::Inverse and the batched
+// kernels below. The best supported backend is picked on first use. The inline
+// Matrix4f operators always use the baseline instruction set of the target.
+//
+// MatrixMulBatch and TransformVectors have a kernel per backend. Inverse only has
+// an SSE kernel: the AVX backend uses it as well (a single 4x4 inverse does not
+// fill 8 lanes) and NEON uses the scalar code - see GetInverseBackend.
+//
+enum MATH_BACKEND {
+    MATH_BACKEND_SCALAR = 0,
+    MATH_BACKEND_SSE    = 1,
+    MATH_BACKEND_AVX    = 2,
+    MATH_BACKEND_NEON   = 3,
+};
+
+MATH_BACKEND GetMathBackend();
+
+bool IsMathBackendSupported(MATH_BACKEND Backend);
+
+// Returns false (and keeps the current backend) if Backend is not supported by the CPU
+bool SetMathBackend(MATH_BACKEND Backend);
+
+const char* GetMathBackendName(MATH_BACKEND Backend);
+
+// The backend whose kernel Matrix4f::Inverse runs when Backend is selected
+MATH_BACKEND GetInverseBackend(MATH_BACKEND Backend);
+
+// pOut[i] = Left * pRight[i]. pOut must not alias pRight.
+void MatrixMulBatch(const Matrix4f& Left, const Matrix4f* pRight, Matrix4f* pOut, int Count);
+
+// pOut[i] = m * pIn[i]. pOut may alias pIn.
+void TransformVectors(const Matrix4f& m, const Vector4f* pIn, Vector4f* pOut, int Count);
+
 #endif  /* MATH_3D_H */
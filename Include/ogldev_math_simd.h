@@ -0,0 +1,188 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_MATH_SIMD_H
+#define OGLDEV_MATH_SIMD_H
+
+//
+// Inline 4x4 kernels on row major float[16] matrices. These are used by the inline
+// operators of Matrix4f so they only rely on the instruction set that is guaranteed
+// by the target (SSE2 on x86-64, NEON on ARM64). Wider kernels (AVX) are selected at
+// runtime in math_3d.cpp. Define OGLDEV_MATH_NO_SIMD to force the scalar code.
+//
+
+#ifndef OGLDEV_MATH_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define OGLDEV_MATH_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define OGLDEV_MATH_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+
+inline void MatrixMulScalar(const float* pLeft, const float* pRight, float* pOut)
+{
+    for (int i = 0 ; i < 4 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            pOut[i * 4 + j] = pLeft[i * 4 + 0] * pRight[0 * 4 + j] +
+                              pLeft[i * 4 + 1] * pRight[1 * 4 + j] +
+                              pLeft[i * 4 + 2] * pRight[2 * 4 + j] +
+                              pLeft[i * 4 + 3] * pRight[3 * 4 + j];
+        }
+    }
+}
+
+
+inline void MatrixMulVec4Scalar(const float* pMat, const float* pVec, float* pOut)
+{
+    for (int i = 0 ; i < 4 ; i++) {
+        pOut[i] = pMat[i * 4 + 0] * pVec[0] +
+                  pMat[i * 4 + 1] * pVec[1] +
+                  pMat[i * 4 + 2] * pVec[2] +
+                  pMat[i * 4 + 3] * pVec[3];
+    }
+}
+
+
+inline void MatrixTransposeScalar(const float* pIn, float* pOut)
+{
+    for (int i = 0 ; i < 4 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            pOut[j * 4 + i] = pIn[i * 4 + j];
+        }
+    }
+}
+
+
+#if defined(OGLDEV_MATH_SSE)
+
+// Row i of the result is a linear combination of the rows of the right matrix
+inline void MatrixMulSIMD(const float* pLeft, const float* pRight, float* pOut)
+{
+    __m128 r0 = _mm_loadu_ps(pRight);
+    __m128 r1 = _mm_loadu_ps(pRight + 4);
+    __m128 r2 = _mm_loadu_ps(pRight + 8);
+    __m128 r3 = _mm_loadu_ps(pRight + 12);
+
+    for (int i = 0 ; i < 4 ; i++) {
+        const float* pRow = pLeft + i * 4;
+        __m128 Res = _mm_mul_ps(_mm_set1_ps(pRow[0]), r0);
+        Res = _mm_add_ps(Res, _mm_mul_ps(_mm_set1_ps(pRow[1]), r1));
+        Res = _mm_add_ps(Res, _mm_mul_ps(_mm_set1_ps(pRow[2]), r2));
+        Res = _mm_add_ps(Res, _mm_mul_ps(_mm_set1_ps(pRow[3]), r3));
+        _mm_storeu_ps(pOut + i * 4, Res);
+    }
+}
+
+
+inline void MatrixMulVec4SIMD(const float* pMat, const float* pVec, float* pOut)
+{
+    __m128 v = _mm_loadu_ps(pVec);
+
+    __m128 x = _mm_mul_ps(_mm_loadu_ps(pMat), v);
+    __m128 y = _mm_mul_ps(_mm_loadu_ps(pMat + 4), v);
+    __m128 z = _mm_mul_ps(_mm_loadu_ps(pMat + 8), v);
+    __m128 w = _mm_mul_ps(_mm_loadu_ps(pMat + 12), v);
+
+    // Horizontal add of the four products
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(pOut, _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w)));
+}
+
+
+inline void MatrixTransposeSIMD(const float* pIn, float* pOut)
+{
+    __m128 r0 = _mm_loadu_ps(pIn);
+    __m128 r1 = _mm_loadu_ps(pIn + 4);
+    __m128 r2 = _mm_loadu_ps(pIn + 8);
+    __m128 r3 = _mm_loadu_ps(pIn + 12);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps(pOut, r0);
+    _mm_storeu_ps(pOut + 4, r1);
+    _mm_storeu_ps(pOut + 8, r2);
+    _mm_storeu_ps(pOut + 12, r3);
+}
+
+#elif defined(OGLDEV_MATH_NEON)
+
+inline void MatrixMulSIMD(const float* pLeft, const float* pRight, float* pOut)
+{
+    float32x4_t r0 = vld1q_f32(pRight);
+    float32x4_t r1 = vld1q_f32(pRight + 4);
+    float32x4_t r2 = vld1q_f32(pRight + 8);
+    float32x4_t r3 = vld1q_f32(pRight + 12);
+
+    for (int i = 0 ; i < 4 ; i++) {
+        float32x4_t Row = vld1q_f32(pLeft + i * 4);
+        float32x4_t Res = vmulq_laneq_f32(r0, Row, 0);
+        Res = vfmaq_laneq_f32(Res, r1, Row, 1);
+        Res = vfmaq_laneq_f32(Res, r2, Row, 2);
+        Res = vfmaq_laneq_f32(Res, r3, Row, 3);
+        vst1q_f32(pOut + i * 4, Res);
+    }
+}
+
+
+inline void MatrixMulVec4SIMD(const float* pMat, const float* pVec, float* pOut)
+{
+    float32x4_t v = vld1q_f32(pVec);
+
+    pOut[0] = vaddvq_f32(vmulq_f32(vld1q_f32(pMat), v));
+    pOut[1] = vaddvq_f32(vmulq_f32(vld1q_f32(pMat + 4), v));
+    pOut[2] = vaddvq_f32(vmulq_f32(vld1q_f32(pMat + 8), v));
+    pOut[3] = vaddvq_f32(vmulq_f32(vld1q_f32(pMat + 12), v));
+}
+
+
+// The de-interleaving load puts column i of the input in lane vector i
+inline void MatrixTransposeSIMD(const float* pIn, float* pOut)
+{
+    float32x4x4_t Cols = vld4q_f32(pIn);
+
+    vst1q_f32(pOut, Cols.val[0]);
+    vst1q_f32(pOut + 4, Cols.val[1]);
+    vst1q_f32(pOut + 8, Cols.val[2]);
+    vst1q_f32(pOut + 12, Cols.val[3]);
+}
+
+#else
+
+inline void MatrixMulSIMD(const float* pLeft, const float* pRight, float* pOut)
+{
+    MatrixMulScalar(pLeft, pRight, pOut);
+}
+
+
+inline void MatrixMulVec4SIMD(const float* pMat, const float* pVec, float* pOut)
+{
+    MatrixMulVec4Scalar(pMat, pVec, pOut);
+}
+
+
+inline void MatrixTransposeSIMD(const float* pIn, float* pOut)
+{
+    MatrixTransposeScalar(pIn, pOut);
+}
+
+#endif
+
+#endif  /* OGLDEV_MATH_SIMD_H */
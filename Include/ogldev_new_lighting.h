@@ -107,6 +107,7 @@ public:
     static const int SUBTECH_DEFAULT = 0;
     static const int SUBTECH_PASSTHRU_GS = 1;
     static const int SUBTECH_WIREFRAME_ON_MESH = 2;
+    static const int SUBTECH_INSTANCED = 3;
 
     LightingTechnique();
 
@@ -0,0 +1,238 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_PARALLEL_H
+#define OGLDEV_PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+
+inline int GetNumWorkerThreads()
+{
+    int NumThreads = (int)std::thread::hardware_concurrency();
+
+    if (NumThreads <= 0) {
+        NumThreads = 1;
+    }
+
+    return NumThreads;
+}
+
+
+//
+// Splits the range [Start, End) into contiguous chunks and runs
+// Func(ChunkStart, ChunkEnd) on each chunk in a separate thread.
+// The calling thread processes the last chunk and then waits for the rest.
+// MinChunkSize prevents spinning up threads for tiny amounts of work.
+// The threads are started on every call so this is only for one-off work
+// (bakes at load time). Work that runs every frame goes to a JobSystem.
+//
+inline void ParallelFor(int Start, int End, const std::function<void(int, int)>& Func, int MinChunkSize = 1)
+{
+    int Count = End - Start;
+
+    if (Count <= 0) {
+        return;
+    }
+
+    MinChunkSize = std::max(MinChunkSize, 1);
+
+    int NumChunks = std::min(GetNumWorkerThreads(), (Count + MinChunkSize - 1) / MinChunkSize);
+
+    if (NumChunks <= 1) {
+        Func(Start, End);
+        return;
+    }
+
+    int ChunkSize = (Count + NumChunks - 1) / NumChunks;
+
+    std::vector<std::thread> Threads;
+    Threads.reserve(NumChunks - 1);
+
+    int ChunkStart = Start;
+
+    for (int i = 0 ; i < NumChunks - 1 ; i++) {
+        int ChunkEnd = std::min(ChunkStart + ChunkSize, End);
+        Threads.emplace_back(Func, ChunkStart, ChunkEnd);
+        ChunkStart = ChunkEnd;
+    }
+
+    if (ChunkStart < End) {
+        Func(ChunkStart, End);
+    }
+
+    for (std::thread& t : Threads) {
+        t.join();
+    }
+}
+
+
+//
+// A pool of persistent worker threads for work that is dispatched every frame
+// (where starting threads in ParallelFor would cost too much). Dispatch() runs
+// Func(JobIndex, ThreadIndex) for every job and returns when all are done.
+// ThreadIndex is stable for a thread - 0 is the calling thread - so it can be
+// used to index per-thread resources that must not be shared (e.g. command pools).
+//
+// Submit() queues a background task that the idle workers pick up between
+// dispatches (e.g. pipeline compiles). A dispatch waits for the tasks that are
+// already running so keep each task short enough to be done within a frame.
+//
+class JobSystem {
+ public:
+    JobSystem(int NumThreads = 0)
+    {
+        if (NumThreads <= 0) {
+            NumThreads = GetNumWorkerThreads();
+        }
+
+        for (int i = 1 ; i < NumThreads ; i++) {
+            m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+        }
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            m_quit = true;
+        }
+
+        m_wakeCond.notify_all();
+
+        for (std::thread& t : m_workers) {
+            t.join();
+        }
+    }
+
+    // Including the calling thread
+    int GetNumThreads() const { return (int)m_workers.size() + 1; }
+
+    // Func(ThreadIndex) runs on one of the workers, or right here if there are none.
+    // The tasks that are still queued when the JobSystem is destroyed are run first.
+    void Submit(const std::function<void(int)>& Func)
+    {
+        if (m_workers.empty()) {
+            Func(0);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            m_tasks.push_back(Func);
+        }
+
+        m_wakeCond.notify_one();
+    }
+
+    void Dispatch(int NumJobs, const std::function<void(int, int)>& Func)
+    {
+        if (NumJobs <= 0) {
+            return;
+        }
+
+        if ((NumJobs == 1) || m_workers.empty()) {
+            for (int i = 0 ; i < NumJobs ; i++) {
+                Func(i, 0);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            m_pFunc = &Func;
+            m_numJobs = NumJobs;
+            m_nextJob = 0;
+            m_numActiveWorkers = (int)m_workers.size();
+            m_generation++;
+        }
+
+        m_wakeCond.notify_all();
+
+        RunJobs(0);
+
+        std::unique_lock<std::mutex> Lock(m_mutex);
+        m_doneCond.wait(Lock, [this]() { return m_numActiveWorkers == 0; });
+        m_pFunc = NULL;
+    }
+
+ private:
+
+    void RunJobs(int ThreadIndex)
+    {
+        int Job;
+
+        while ((Job = m_nextJob.fetch_add(1)) < m_numJobs) {
+            (*m_pFunc)(Job, ThreadIndex);
+        }
+    }
+
+    void WorkerLoop(int ThreadIndex)
+    {
+        unsigned long long SeenGeneration = 0;
+
+        std::unique_lock<std::mutex> Lock(m_mutex);
+
+        while (true) {
+            m_wakeCond.wait(Lock, [&]() { return m_quit || (m_generation != SeenGeneration) || !m_tasks.empty(); });
+
+            // A dispatch goes first - the calling thread is waiting for it
+            if (m_generation != SeenGeneration) {
+                SeenGeneration = m_generation;
+
+                Lock.unlock();
+                RunJobs(ThreadIndex);
+                Lock.lock();
+
+                if (--m_numActiveWorkers == 0) {
+                    m_doneCond.notify_one();
+                }
+            } else if (!m_tasks.empty()) {
+                std::function<void(int)> Task = m_tasks.front();
+                m_tasks.pop_front();
+
+                Lock.unlock();
+                Task(ThreadIndex);
+                Lock.lock();
+            } else {
+                return;     // m_quit
+            }
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCond;
+    std::condition_variable m_doneCond;
+    const std::function<void(int, int)>* m_pFunc = NULL;
+    std::deque<std::function<void(int)>> m_tasks;
+    std::atomic<int> m_nextJob{0};
+    int m_numJobs = 0;
+    int m_numActiveWorkers = 0;
+    unsigned long long m_generation = 0;
+    bool m_quit = false;
+};
+
+#endif  /* OGLDEV_PARALLEL_H */
@@ -0,0 +1,100 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_PARTICLE_TECHNIQUES_H
+#define OGLDEV_PARTICLE_TECHNIQUES_H
+
+#include "technique.h"
+#include "ogldev_math_3d.h"
+#include "ogldev_particles.h"
+
+// Work group size of particles_update.comp and particles_emit.comp
+#define PARTICLE_GROUP_SIZE 256
+
+class ParticleUpdateTechnique : public Technique
+{
+public:
+
+    ParticleUpdateTechnique() {}
+
+    virtual bool Init();
+
+    void SetMaxParticles(u32 MaxParticles);
+
+    void SetDeltaTime(float DeltaTimeSecs);
+
+    void SetEmitter(const ParticleEmitterDesc& Emitter);
+
+private:
+
+    GLuint m_maxParticlesLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_deltaTimeLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_gravityLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_dragLoc = INVALID_UNIFORM_LOCATION;
+};
+
+
+class ParticleEmitTechnique : public Technique
+{
+public:
+
+    ParticleEmitTechnique() {}
+
+    virtual bool Init();
+
+    void SetEmitCount(u32 EmitCount, u32 EmitBase);
+
+    void SetEmitter(const ParticleEmitterDesc& Emitter);
+
+private:
+
+    GLuint m_emitCountLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_emitBaseLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_emitterPosLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_velocityLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_velocitySpreadLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_minLifetimeLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_maxLifetimeLoc = INVALID_UNIFORM_LOCATION;
+};
+
+
+class ParticleRenderTechnique : public Technique
+{
+public:
+
+    ParticleRenderTechnique() {}
+
+    virtual bool Init();
+
+    void SetVP(const Matrix4f& VP);
+
+    void SetCameraPosition(const Vector3f& Pos);
+
+    void SetColorTextureUnit(unsigned int TextureUnit);
+
+    void SetBillboardSize(float BillboardSize);
+
+private:
+
+    GLuint m_VPLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_cameraPosLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_colorMapLoc = INVALID_UNIFORM_LOCATION;
+    GLuint m_billboardSizeLoc = INVALID_UNIFORM_LOCATION;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_PARTICLES_H
+#define OGLDEV_PARTICLES_H
+
+#include "ogldev_types.h"
+#include "ogldev_math_3d.h"
+
+//
+// Definitions shared by the GPU particle system (ogldev_gpu_particles.h) and
+// its CPU reference (ogldev_cpu_particles.h). The two run the same simulation:
+//
+//   - every frame the live particles are updated first and then new particles
+//     are emitted into the slots of the dead ones
+//   - update: Vel += (Gravity - Drag * Vel) * dt, Pos += Vel * dt, Age += dt.
+//     A particle dies when its age reaches its lifetime.
+//   - the random values of the N'th emitted particle (counting from Init) come
+//     from ParticleRandom01(N * 4 + k) so they don't depend on which slot or
+//     thread it ends up in
+//
+// The GLSL versions live in Common/Shaders/particles_*.comp. Keep them in sync.
+//
+
+struct ParticleEmitterDesc {
+    Vector3f Pos = Vector3f(0.0f, 0.0f, 0.0f);
+    float EmitRate = 1000.0f;                       // particles per second
+    Vector3f Velocity = Vector3f(0.0f, 5.0f, 0.0f); // initial velocity...
+    float VelocitySpread = 1.0f;                    // ...plus a random [-Spread, Spread] per axis
+    Vector3f Gravity = Vector3f(0.0f, -9.81f, 0.0f);
+    float Drag = 0.0f;                              // fraction of the velocity lost per second
+    float MinLifetime = 1.0f;                       // seconds
+    float MaxLifetime = 2.0f;
+};
+
+
+// Stateless integer hash (lowbias32)
+inline u32 ParticleHash(u32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+
+// [0, 1) with 24 bits so that float rounding is the same on the CPU and the GPU
+inline float ParticleRandom01(u32 Seed)
+{
+    return (float)(ParticleHash(Seed) >> 8) * (1.0f / 16777216.0f);
+}
+
+
+inline void ParticleEmitValues(const ParticleEmitterDesc& Emitter, u32 EmitIndex, Vector3f& Vel, float& Lifetime)
+{
+    u32 Seed = EmitIndex * 4;
+    Vel.x = Emitter.Velocity.x + Emitter.VelocitySpread * (ParticleRandom01(Seed + 0) * 2.0f - 1.0f);
+    Vel.y = Emitter.Velocity.y + Emitter.VelocitySpread * (ParticleRandom01(Seed + 1) * 2.0f - 1.0f);
+    Vel.z = Emitter.Velocity.z + Emitter.VelocitySpread * (ParticleRandom01(Seed + 2) * 2.0f - 1.0f);
+    Lifetime = Emitter.MinLifetime + (Emitter.MaxLifetime - Emitter.MinLifetime) * ParticleRandom01(Seed + 3);
+}
+
+
+//
+// Turns the emission rate into a whole number of particles per frame.
+// The fraction is carried over to the next frame.
+//
+class ParticleEmissionClock {
+ public:
+    ParticleEmissionClock() {}
+
+    int Advance(float EmitRate, float DeltaTimeSecs)
+    {
+        m_accum += EmitRate * DeltaTimeSecs;
+        int Count = (int)m_accum;
+        m_accum -= (float)Count;
+        return Count;
+    }
+
+ private:
+    float m_accum = 0.0f;
+};
+
+#endif
@@ -26,6 +26,8 @@
 #include "ogldev_basic_mesh.h"
 #include "ogldev_skinned_mesh.h"
 #include "ogldev_shadow_mapping_technique.h"
+#include "ogldev_streaming_buffer.h"
+#include "ogldev_parallel.h"
 
 
 class PhongRenderer {
@@ -84,6 +86,9 @@ class PhongRenderer {
 
     void Render(BasicMesh* pMesh);
 
+    // Renders the mesh once per transform using hardware instancing. Shadows are not supported.
+    void RenderInstanced(BasicMesh* pMesh, uint NumInstances, const WorldTrans* pWorldTrans);
+
     void RenderAnimation(SkinnedMesh* pMesh, float AnimationTimeSec, int AnimationIndex = 0);
 
     void RenderAnimationBlended(SkinnedMesh* pMesh,
@@ -97,16 +102,23 @@ class PhongRenderer {
 
     void GetWVP(BasicMesh* pMesh, Matrix4f& WVP);
 
+    // Enable the technique unless it is already bound. The bound program is
+    // the one tracked by GLState so this never queries GL.
     void SwitchToLightingTech();
     void SwitchToSkinningTech();
+    void SwitchToInstancedLightingTech();
 
     void RefreshLightingPosAndDirs(BasicMesh* pMesh);
+    void RefreshLightingPosAndDirs(const WorldTrans& worldTransform);
 
     void RenderAnimationCommon(SkinnedMesh* pMesh);
 
     const BasicCamera* m_pCamera = NULL;
     int m_subTech = LightingTechnique::SUBTECH_DEFAULT;
     LightingTechnique m_lightingTech;
+    LightingTechnique m_instancedLightingTech;
+    StreamingBuffer m_instanceBuffer;
+    JobSystem m_jobs;   // packs the instance matrices every frame
     SkinningTechnique m_skinningTech;
     ShadowMappingTechnique m_shadowMapTech;
 
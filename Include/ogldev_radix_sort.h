@@ -0,0 +1,114 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_RADIX_SORT_H
+#define OGLDEV_RADIX_SORT_H
+
+#include <string.h>
+#include <vector>
+
+#include "ogldev_types.h"
+#include "ogldev_parallel.h"
+
+// Below this a chunk is not worth a job
+#define RADIX_SORT_MIN_CHUNK_SIZE 8192
+
+
+// Maps a float to a u32 with the same ordering (negatives included)
+inline u32 FloatToSortableKey(float f)
+{
+    u32 u;
+    memcpy(&u, &f, sizeof(u));
+    return (u & 0x80000000) ? ~u : (u | 0x80000000);
+}
+
+
+//
+// Stable LSD radix sort of 32 bit keys in ascending order, moving Values along
+// with the keys. Four passes of 8 bits; each pass builds one histogram per chunk,
+// turns them into scatter offsets and scatters the chunks in parallel. The scatter
+// is stable - every chunk writes its keys of a digit after those of the previous
+// chunks - so the result is deterministic regardless of how many chunks the
+// thread count gives. TempKeys/TempValues are scratch buffers that can be kept
+// between calls to avoid the allocations.
+//
+inline void ParallelRadixSort(JobSystem& Jobs,
+                              std::vector<u32>& Keys, std::vector<u32>& Values,
+                              std::vector<u32>& TempKeys, std::vector<u32>& TempValues)
+{
+    int Count = (int)Keys.size();
+
+    if (Count <= 1) {
+        return;
+    }
+
+    TempKeys.resize(Count);
+    TempValues.resize(Count);
+
+    int NumChunks = std::max(1, std::min(Jobs.GetNumThreads(), Count / RADIX_SORT_MIN_CHUNK_SIZE));
+    int ChunkSize = (Count + NumChunks - 1) / NumChunks;
+
+    std::vector<u32> Offsets(NumChunks * 256);
+
+    u32* pSrcKeys = Keys.data();
+    u32* pSrcValues = Values.data();
+    u32* pDstKeys = TempKeys.data();
+    u32* pDstValues = TempValues.data();
+
+    // An even number of passes leaves the result in Keys/Values
+    for (int Shift = 0 ; Shift < 32 ; Shift += 8) {
+        std::fill(Offsets.begin(), Offsets.end(), 0);
+
+        Jobs.Dispatch(NumChunks, [&](int Chunk, int) {
+            u32* pHistogram = &Offsets[Chunk * 256];
+            int End = std::min((Chunk + 1) * ChunkSize, Count);
+
+            for (int i = Chunk * ChunkSize ; i < End ; i++) {
+                pHistogram[(pSrcKeys[i] >> Shift) & 0xff]++;
+            }
+        });
+
+        // Digit major, chunk minor - chunk c writes its digit d after the
+        // digit d keys of chunks 0..c-1
+        u32 Sum = 0;
+
+        for (int Digit = 0 ; Digit < 256 ; Digit++) {
+            for (int Chunk = 0 ; Chunk < NumChunks ; Chunk++) {
+                u32 n = Offsets[Chunk * 256 + Digit];
+                Offsets[Chunk * 256 + Digit] = Sum;
+                Sum += n;
+            }
+        }
+
+        Jobs.Dispatch(NumChunks, [&](int Chunk, int) {
+            u32* pOffsets = &Offsets[Chunk * 256];
+            int End = std::min((Chunk + 1) * ChunkSize, Count);
+
+            for (int i = Chunk * ChunkSize ; i < End ; i++) {
+                u32 Pos = pOffsets[(pSrcKeys[i] >> Shift) & 0xff]++;
+                pDstKeys[Pos] = pSrcKeys[i];
+                pDstValues[Pos] = pSrcValues[i];
+            }
+        });
+
+        std::swap(pSrcKeys, pDstKeys);
+        std::swap(pSrcValues, pDstValues);
+    }
+}
+
+#endif
@@ -38,9 +38,6 @@ private:
     bool InitNonDSA(unsigned int Width, unsigned int Height, bool ForPCF = false);
     bool InitDSA(unsigned int Width, unsigned int Height, bool ForPCF = false);
 
-    void BindForReadingNonDSA(GLenum TextureUnit);
-    void BindForReadingDSA(GLenum TextureUnit);
-
     uint m_width = 0;
     uint m_height = 0;
     GLuint m_fbo;
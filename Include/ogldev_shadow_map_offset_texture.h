@@ -19,19 +19,37 @@
 #ifndef SHADOW_MAP_OFFSET_TEXTURE_H
 #define SHADOW_MAP_OFFSET_TEXTURE_H
 
+#include <vector>
 #include <GL/glew.h>
 
+#include "ogldev_types.h"
+
 class ShadowMapOffsetTexture {
 
  public:
-    ShadowMapOffsetTexture(int WindowSize, int FilterSize);
+    // If pCacheFilename is not NULL the offsets are loaded from that file when it
+    // matches the requested parameters. Otherwise they are generated and saved to it.
+    ShadowMapOffsetTexture(int WindowSize, int FilterSize, bool UseHalfFloat = false, const char* pCacheFilename = NULL);
+
+    ~ShadowMapOffsetTexture();
 
     void Bind(GLenum TextureUnit);
 
+    // Deterministic - the same sizes always produce the same offsets
+    static void GenOffsetTextureData(int WindowSize, int FilterSize, std::vector<float>& Data);
+
+    static void ConvertToHalfFloat(const std::vector<float>& Data, std::vector<u16>& HalfData);
+
  private:
-    GLuint m_textureObj;
 
-    void CreateTexture(int WindowSize, int FilterSize, const vector<float>& Data);
+    bool LoadFromCache(const char* pCacheFilename, int WindowSize, int FilterSize, bool UseHalfFloat);
+
+    void SaveToCache(const char* pCacheFilename, int WindowSize, int FilterSize, bool UseHalfFloat,
+                     const void* pData, size_t DataSize);
+
+    void CreateTexture(int WindowSize, int FilterSize, bool UseHalfFloat, const void* pData);
+
+    GLuint m_textureObj = 0;
 };
 
 #endif
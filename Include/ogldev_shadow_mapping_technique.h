@@ -21,6 +21,9 @@
 
 #include "technique.h"
 #include "ogldev_math_3d.h"
+#include "ogldev_streaming_buffer.h"
+
+#define SHADOW_MAPPING_DRAW_BINDING 4
 
 
 class ShadowMappingTechnique : public Technique
@@ -31,11 +34,27 @@ class ShadowMappingTechnique : public Technique
 
     virtual bool Init();
 
-    void SetWVP(const Matrix4f& WVP);
+    // The WVP matrix is set per draw in a uniform block:
+    //     BeginDraws(NumDraws);           // optional
+    //     for each draw: SetWVP(), CommitDraw(), glDraw*()
+    //     EndDraws();
+    void BeginDraws(unsigned int NumDraws) { m_drawBuffer.BeginDraws(NumDraws); }
+
+    void SetWVP(const Matrix4f& WVP) { m_draw.WVP = WVP; }
+
+    void CommitDraw() { m_drawBuffer.CommitDraw(&m_draw); }
+
+    void EndDraws() { m_drawBuffer.EndDraws(); }
 
  private:
 
-    GLuint m_WVPLoc = INVALID_UNIFORM_LOCATION;
+    // Matches DrawBlock in shadow_map.vs
+    struct DrawBlock {
+        Matrix4f WVP;
+    };
+
+    DrawBlock m_draw;
+    UniformDrawBuffer m_drawBuffer;
 };
 
 
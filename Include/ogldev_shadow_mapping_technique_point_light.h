@@ -21,6 +21,9 @@
 
 #include "technique.h"
 #include "ogldev_math_3d.h"
+#include "ogldev_streaming_buffer.h"
+
+#define SHADOW_MAPPING_POINT_LIGHT_DRAW_BINDING 5
 
 
 class ShadowMappingPointLightTechnique : public Technique
@@ -31,14 +34,33 @@ class ShadowMappingPointLightTechnique : public Technique
 
     virtual bool Init();
 
-    void SetWVP(const Matrix4f& WVP);
-    void SetWorld(const Matrix4f& World);
     void SetLightWorldPos(const Vector3f& Pos);
 
+    // The matrices are set per draw in a uniform block:
+    //     BeginDraws(NumDraws);           // optional
+    //     for each draw: SetWVP(), SetWorld(), CommitDraw(), glDraw*()
+    //     EndDraws();
+    void BeginDraws(unsigned int NumDraws) { m_drawBuffer.BeginDraws(NumDraws); }
+
+    void SetWVP(const Matrix4f& WVP) { m_draw.WVP = WVP; }
+
+    void SetWorld(const Matrix4f& World) { m_draw.World = World; }
+
+    void CommitDraw() { m_drawBuffer.CommitDraw(&m_draw); }
+
+    void EndDraws() { m_drawBuffer.EndDraws(); }
+
  private:
 
-    GLint m_WVPLoc = INVALID_UNIFORM_LOCATION;
-    GLint m_worldMatrixLoc = INVALID_UNIFORM_LOCATION;
+    // Matches DrawBlock in shadow_map_point_light.vs
+    struct DrawBlock {
+        Matrix4f WVP;
+        Matrix4f World;
+    };
+
+    DrawBlock m_draw;
+    UniformDrawBuffer m_drawBuffer;
+
     GLint m_lightWorldPosLoc = INVALID_UNIFORM_LOCATION;
 };
 
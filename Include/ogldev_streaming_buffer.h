@@ -0,0 +1,119 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_STREAMING_BUFFER_H
+#define OGLDEV_STREAMING_BUFFER_H
+
+#include <vector>
+#include <GL/glew.h>
+
+//
+// A buffer for data that is rewritten every frame (instance transforms, etc).
+// The buffer is split into NumRegions regions that are used in round robin.
+// On GL 4.4 and up the buffer is persistently mapped and each region is
+// protected by a fence so the CPU never overwrites data that the GPU is still
+// reading. On older versions Unmap() falls back to glBufferSubData.
+//
+// Usage:
+//     void* p = Buf.Map(Size);
+//     ... write Size bytes to p ...
+//     GLintptr Offset = Buf.Unmap();
+//     ... issue the draws that read [Offset, Offset + Size) ...
+//     Buf.Fence();
+//
+class StreamingBuffer {
+ public:
+    StreamingBuffer() {}
+
+    ~StreamingBuffer();
+
+    void Init(size_t RegionSize, int NumRegions = 3);
+
+    // Grows the regions if Size does not fit
+    void* Map(size_t Size);
+
+    GLintptr Unmap();
+
+    // Makes [Start, Start + Size) of the mapped region visible to the GPU and returns
+    // its offset in the buffer. The rest of the region can still be written, which
+    // lets the draws consume the region while it is being filled.
+    GLintptr FlushRange(size_t Start, size_t Size);
+
+    void Fence();
+
+    GLuint GetBuffer() const { return m_buffer; }
+
+ private:
+
+    void CreateBuffer(size_t RegionSize);
+
+    void DestroyBuffer();
+
+    void WaitForRegion(int Region);
+
+    GLuint m_buffer = 0;
+    size_t m_regionSize = 0;
+    int m_numRegions = 0;
+    int m_curRegion = 0;
+    size_t m_curSize = 0;
+    bool m_isPersistent = false;
+    char* m_pMappedData = NULL;
+    std::vector<GLsync> m_fences;
+    std::vector<char> m_stagingData;    // only when persistent mapping is not available
+};
+
+//
+// Per-draw data of a uniform block that is appended to a StreamingBuffer so
+// that the draws of a pass cost a memcpy and a glBindBufferRange instead of
+// a glUniform* call per uniform. Each slot is aligned to
+// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+//
+// Usage:
+//     Buf.BeginDraws(NumDraws);       // optional - sizes the region
+//     for each draw: Buf.CommitDraw(&Data), glDraw*()
+//     Buf.EndDraws();
+//
+// CommitDraw() continues in a new region when the current one is full so a
+// pass that does not know its number of draws up front still works.
+//
+class UniformDrawBuffer {
+ public:
+    UniformDrawBuffer() {}
+
+    bool Init(GLuint Program, const char* pBlockName, GLuint Binding, size_t DrawSize);
+
+    void BeginDraws(unsigned int NumDraws);
+
+    void CommitDraw(const void* pData);
+
+    void EndDraws();
+
+ private:
+
+    void MapRegion(unsigned int NumDraws);
+
+    StreamingBuffer m_buffer;
+    GLuint m_binding = 0;
+    size_t m_drawSize = 0;
+    size_t m_drawStride = 0;
+    char* m_pDrawData = NULL;
+    unsigned int m_numDraws = 0;
+    unsigned int m_maxDraws = 0;
+};
+
+#endif
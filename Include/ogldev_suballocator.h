@@ -0,0 +1,153 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_SUBALLOCATOR_H
+#define OGLDEV_SUBALLOCATOR_H
+
+#include <vector>
+
+#include "ogldev_types.h"
+
+//
+// Pure bookkeeping allocators that hand out offsets inside a range. They don't
+// touch any memory so they can sub-allocate GPU memory blocks and be tested
+// without a device.
+//
+
+#define SUBALLOC_INVALID_HANDLE 0xffffffff
+
+#define TLSF_SL_BITS  5                         // 32 second level lists per first level
+#define TLSF_SL_COUNT (1 << TLSF_SL_BITS)
+#define TLSF_FL_COUNT (64 - TLSF_SL_BITS + 1)
+
+
+struct SubAllocatorStats {
+    u64 TotalSize = 0;
+    u64 UsedSize = 0;
+    u32 NumAllocations = 0;
+    u32 NumFreeBlocks = 0;
+    u64 LargestFreeBlock = 0;
+
+    u64 GetFreeSize() const { return TotalSize - UsedSize; }
+
+    // 0 when all the free space is in one block, close to 1 when it is split into many small holes
+    float GetFragmentation() const
+    {
+        u64 FreeSize = GetFreeSize();
+        return FreeSize > 0 ? 1.0f - (float)LargestFreeBlock / (float)FreeSize : 0.0f;
+    }
+};
+
+
+//
+// Two-Level Segregated Fit allocator. Free blocks are kept in lists indexed by
+// (log2 of the size, linear subdivision of the size) and two levels of bitmaps
+// find a large enough list in constant time. Neighboring free blocks are merged
+// on Free().
+//
+class TLSFAllocator
+{
+public:
+    TLSFAllocator() {}
+
+    void Init(u64 Size);
+
+    // Returns false if there is no free block that can hold Size bytes at the requested alignment
+    bool Allocate(u64 Size, u64 Alignment, u64& Offset, u32& Handle);
+
+    void Free(u32 Handle);
+
+    u64 GetOffset(u32 Handle) const { return m_blocks[Handle].Offset; }
+
+    u64 GetSize(u32 Handle) const { return m_blocks[Handle].Size; }
+
+    bool IsEmpty() const { return m_numAllocations == 0; }
+
+    SubAllocatorStats GetStats() const;
+
+    // Walks all the blocks and checks the internal invariants (for testing)
+    bool Validate() const;
+
+private:
+
+    struct Block {
+        u64 Offset = 0;
+        u64 Size = 0;
+        u32 PrevPhys = SUBALLOC_INVALID_HANDLE;
+        u32 NextPhys = SUBALLOC_INVALID_HANDLE;
+        u32 PrevFree = SUBALLOC_INVALID_HANDLE;
+        u32 NextFree = SUBALLOC_INVALID_HANDLE;
+        bool IsFree = false;
+    };
+
+    u32 NewBlock();
+
+    void ReleaseBlock(u32 Index);
+
+    void InsertFreeBlock(u32 Index);
+
+    void RemoveFreeBlock(u32 Index);
+
+    u32 FindFreeBlock(u64 Size) const;
+
+    void MergeWithNext(u32 Index);
+
+    std::vector<Block> m_blocks;
+    std::vector<u32> m_unusedBlocks;
+    u32 m_freeLists[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    u64 m_flBitmap = 0;
+    u32 m_slBitmap[TLSF_FL_COUNT];
+    u64 m_size = 0;
+    u64 m_usedSize = 0;
+    u32 m_numAllocations = 0;
+    u32 m_numFreeBlocks = 0;
+};
+
+
+//
+// Allocates linearly from a circular range. Space is returned in allocation order
+// by calling Release() with a marker that was returned by GetMarker() after the
+// allocations that are no longer in use (e.g. after the GPU is done with them).
+//
+class RingAllocator
+{
+public:
+    RingAllocator() {}
+
+    void Init(u64 Size);
+
+    // An allocation never wraps around the end of the range
+    bool Allocate(u64 Size, u64 Alignment, u64& Offset);
+
+    u64 GetMarker() const { return m_head; }
+
+    // Frees everything that was allocated before the marker. Older markers are ignored.
+    void Release(u64 Marker);
+
+    u64 GetSize() const { return m_size; }
+
+    u64 GetUsedSize() const { return m_head - m_tail; }
+
+private:
+    // Both grow monotonically - the offset in the range is the value modulo the size
+    u64 m_head = 0;
+    u64 m_tail = 0;
+    u64 m_size = 0;
+};
+
+#endif
@@ -39,7 +39,8 @@ public:
 
     void LoadRaw(int Width, int Height, int BPP, const unsigned char* pImageData);
 
-    void LoadF32(int Width, int Height, const float* pImageData);
+    // NumChannels: 1 (R32F), 2 (RG32F) or 4 (RGBA32F)
+    void LoadF32(int Width, int Height, const float* pImageData, int NumChannels = 1);
 
     // Must be called at least once for the specific texture unit
     void Bind(GLenum TextureUnit);
@@ -57,9 +58,6 @@ private:
     void LoadInternalNonDSA(const void* pImageData);
     void LoadInternalDSA(const void* pImageData);    
 
-    void BindInternalNonDSA(GLenum TextureUnit);
-    void BindInternalDSA(GLenum TextureUnit);
-
     std::string m_fileName;
     GLenum m_textureTarget;
     GLuint m_textureObj;
@@ -39,7 +39,6 @@
 using namespace std;
 
 bool ReadFile(const char* fileName, string& outFile);
-char* ReadBinaryFile(const char* pFileName, int& size);
 
 void WriteBinaryFile(const char* pFilename, const void* pData, int size);
 
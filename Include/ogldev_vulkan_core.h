@@ -24,6 +24,7 @@
 #include <assert.h>
 
 #include "ogldev_vulkan.h"
+#include "ogldev_mapped_file.h"
 
 class OgldevVulkanCore
 {
@@ -32,8 +33,15 @@ public:
     ~OgldevVulkanCore();
     
     void Init(VulkanWindowControl* pWindowControl);
+
+    // No surface and no swap chain - for offscreen rendering and CI runs (e.g. on lavapipe)
+    void InitHeadless();
+
+    bool IsHeadless() const { return m_isHeadless; }
               
     const VkPhysicalDevice& GetPhysDevice() const;
+
+    const VkPhysicalDeviceProperties& GetPhysDeviceProps() const;
     
     const VkSurfaceFormatKHR& GetSurfaceFormat() const;
     
@@ -50,23 +58,35 @@ public:
     u32 GetMemoryTypeIndex(u32 memTypeBits, VkMemoryPropertyFlags memPropFlags);
     
     VkSemaphore CreateSemaphore();
+
+    // Created by Init() from the cache file of the previous run (if it was written by
+    // the same device and driver). Pass it to every vkCreate*Pipelines call.
+    VkPipelineCache GetPipelineCache() const { return m_pipelineCache; }
+
+    // Also called by the destructor
+    void SavePipelineCache();
     
 private:
     void CreateInstance();
     void CreateSurface();
     void SelectPhysicalDevice();
     void CreateLogicalDevice();
+    void CreatePipelineCache();
+    bool LoadPipelineCacheFile(MappedFile& File, const void*& pData, size_t& DataSize);
 
     // Vulkan objects
     VkInstance m_inst;
     VkSurfaceKHR m_surface;
     VulkanPhysicalDevices m_physDevices;
     VkDevice m_device;
+    VkPipelineCache m_pipelineCache;
     
     // Internal stuff
     std::string m_appName;
     int m_gfxDevIndex;
     int m_gfxQueueFamily;
+    bool m_isHeadless;
+    std::string m_pipelineCacheFilename;
 };
 
 
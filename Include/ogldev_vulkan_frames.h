@@ -0,0 +1,192 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_VULKAN_FRAMES_H
+#define OGLDEV_VULKAN_FRAMES_H
+
+#ifdef OGLDEV_VULKAN
+
+#include <vector>
+#include <functional>
+
+#include "ogldev_vulkan_core.h"
+
+#define MAX_FRAMES_IN_FLIGHT 4
+
+
+struct VulkanFrameStats {
+    int NumFrames = 0;
+    int NumStalls = 0;              // frames where the CPU had to wait for the GPU
+    double TotalWaitMs = 0.0;       // time spent blocked on the frame fences
+    double MaxWaitMs = 0.0;
+    double TotalFrameMs = 0.0;      // BeginFrame to BeginFrame
+    double MinFrameMs = 0.0;
+    double MaxFrameMs = 0.0;
+
+    double GetAvgFrameMs() const { return NumFrames > 1 ? TotalFrameMs / (NumFrames - 1) : 0.0; }
+
+    // Fraction of frames where the CPU recorded the next frame while the GPU was still busy
+    double GetOverlap() const { return NumFrames > 0 ? 1.0 - (double)NumStalls / NumFrames : 0.0; }
+};
+
+
+//
+// Lets the CPU record frame N+1 while the GPU is still working on frame N.
+// Every frame slot owns its own image available semaphore, fence, command pool and
+// command buffer. The render complete semaphores belong to the swap chain images
+// instead: the presentation engine waits on them with no fence, so a slot cannot
+// know when its own semaphore is free again, but an image is only acquired again
+// after its previous present is done with the semaphore.
+// Resources that the GPU may still be using can be handed to DeferDestroy() and
+// they are released when the slot comes around again (and its fence has signaled).
+//
+// Usage:
+//     VkCommandBuffer CmdBuf = Frames.BeginFrame();
+//     SwapChain.AcquireNextImage(Frames.GetImageAvailableSem(), ImageIndex);
+//     Frames.WaitForImage(ImageIndex);
+//     ... record CmdBuf ...
+//     Frames.Submit(CmdBuf);
+//     SwapChain.Present(Frames.GetRenderCompleteSem(ImageIndex), ImageIndex);
+//     Frames.EndFrame();
+//
+class VulkanFramesInFlight
+{
+public:
+    VulkanFramesInFlight() {}
+
+    ~VulkanFramesInFlight();
+
+    void Init(OgldevVulkanCore* pCore, VkQueue Queue, int NumFrames = 2, int NumImages = 0);
+
+    void Destroy();
+
+    // Blocks until the GPU is done with the current slot, recycles its resources
+    // and returns its (reset) command buffer
+    VkCommandBuffer BeginFrame();
+
+    // Waits for the frame that last rendered into the swap chain image (can be
+    // a different slot when the number of images differs from the number of frames).
+    // Must be called before Submit() - it selects the render complete semaphore.
+    void WaitForImage(uint ImageIndex);
+
+    // Waits on the image available semaphore, signals the render complete semaphore
+    // of the image and the fence of the current slot. The fence is only reset here, right before
+    // the submit, so a frame that is abandoned after BeginFrame() (e.g. the swap
+    // chain is out of date) leaves it signaled.
+    void Submit(VkCommandBuffer CmdBuf, VkPipelineStageFlags WaitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+    void EndFrame();
+
+    // Func is called once the GPU is guaranteed to be done with the current frame
+    void DeferDestroy(const std::function<void()>& Func);
+
+    // Waits for all frames and runs all the pending deferred deletions
+    void WaitIdle();
+
+    VkSemaphore GetImageAvailableSem() const { return m_frames[m_curFrame].ImageAvailableSem; }
+
+    VkSemaphore GetRenderCompleteSem(uint ImageIndex) const { return m_renderCompleteSems[ImageIndex]; }
+
+    int GetCurFrame() const { return m_curFrame; }
+
+    int GetNumFrames() const { return (int)m_frames.size(); }
+
+    const VulkanFrameStats& GetStats() const { return m_stats; }
+
+    void ResetStats() { m_stats = VulkanFrameStats(); }
+
+private:
+
+    struct Frame {
+        VkSemaphore ImageAvailableSem = VK_NULL_HANDLE;
+        VkFence Fence = VK_NULL_HANDLE;
+        VkCommandPool CmdPool = VK_NULL_HANDLE;
+        VkCommandBuffer CmdBuf = VK_NULL_HANDLE;
+        std::vector< std::function<void()> > DeferredDeletes;
+    };
+
+    void WaitForFence(VkFence Fence);
+
+    void RunDeferredDeletes(Frame& f);
+
+    void UpdateStats(double WaitMs, bool Stalled);
+
+    OgldevVulkanCore* m_pCore = NULL;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    std::vector<Frame> m_frames;
+    std::vector<VkFence> m_imageFences;     // fence of the frame that last used each image
+    std::vector<VkSemaphore> m_renderCompleteSems;     // one per image
+    uint m_curImage = 0;
+    int m_curFrame = 0;
+    long long m_lastBeginTime = 0;          // in microseconds
+    VulkanFrameStats m_stats;
+};
+
+
+//
+// Stands in for a VkSwapchainKHR when there is no window (headless CI, lavapipe).
+// Owns NumImages color images that can be rendered into. AcquireNextImage()
+// and Present() go through the same semaphores as the real swap chain so the
+// frame pacing of the render loop is the same.
+//
+class VulkanOffscreenSwapChain
+{
+public:
+    VulkanOffscreenSwapChain() {}
+
+    ~VulkanOffscreenSwapChain();
+
+    void Init(OgldevVulkanCore* pCore, VkQueue Queue, uint Width, uint Height,
+              int NumImages = 3, VkFormat Format = VK_FORMAT_R8G8B8A8_UNORM);
+
+    void Destroy();
+
+    // Signals SignalSem when the image is available
+    void AcquireNextImage(VkSemaphore SignalSem, uint& ImageIndex);
+
+    // Waits on WaitSem before the image goes back to the pool
+    void Present(VkSemaphore WaitSem, uint ImageIndex);
+
+    int GetNumImages() const { return (int)m_images.size(); }
+
+    VkImage GetImage(uint ImageIndex) const { return m_images[ImageIndex]; }
+
+    VkImageView GetImageView(uint ImageIndex) const { return m_views[ImageIndex]; }
+
+    VkFormat GetFormat() const { return m_format; }
+
+    uint GetWidth() const { return m_width; }
+
+    uint GetHeight() const { return m_height; }
+
+private:
+
+    OgldevVulkanCore* m_pCore = NULL;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    std::vector<VkImage> m_images;
+    std::vector<VkImageView> m_views;
+    std::vector<VkDeviceMemory> m_memory;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    uint m_width = 0;
+    uint m_height = 0;
+    uint m_nextImage = 0;
+};
+
+#endif // OGLDEV_VULKAN
+
+#endif
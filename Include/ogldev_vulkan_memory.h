@@ -0,0 +1,161 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_VULKAN_MEMORY_H
+#define OGLDEV_VULKAN_MEMORY_H
+
+#ifdef OGLDEV_VULKAN
+
+#include <vector>
+#include <deque>
+
+#include "ogldev_vulkan_core.h"
+#include "ogldev_suballocator.h"
+
+#define VULKAN_DEFAULT_BLOCK_SIZE (64 * 1024 * 1024)
+
+
+struct VulkanAllocation {
+    VkDeviceMemory Memory = VK_NULL_HANDLE;
+    VkDeviceSize Offset = 0;
+    VkDeviceSize Size = 0;
+    void* pMappedData = NULL;           // only for host visible memory
+    int Block = -1;
+    u32 Handle = SUBALLOC_INVALID_HANDLE;
+};
+
+
+//
+// Sub-allocates buffers and images from large VkDeviceMemory blocks instead
+// of calling vkAllocateMemory for each resource. Every block belongs to one
+// memory type and is managed by a TLSFAllocator. Buffers and images never share
+// a block so bufferImageGranularity does not need to be handled. Host visible
+// blocks are mapped once when they are created. Requests larger than half a
+// block get a dedicated allocation.
+//
+class VulkanMemoryAllocator
+{
+public:
+    VulkanMemoryAllocator() {}
+
+    ~VulkanMemoryAllocator();
+
+    void Init(OgldevVulkanCore* pCore, VkDeviceSize BlockSize = VULKAN_DEFAULT_BLOCK_SIZE);
+
+    void Destroy();
+
+    // Allocate memory for the resource and bind it
+    VulkanAllocation AllocateBufferMemory(VkBuffer Buffer, VkMemoryPropertyFlags MemProps);
+
+    VulkanAllocation AllocateImageMemory(VkImage Image, VkMemoryPropertyFlags MemProps);
+
+    VkBuffer CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags MemProps, VulkanAllocation& Alloc);
+
+    void DestroyBuffer(VkBuffer Buffer, VulkanAllocation& Alloc);
+
+    void Free(VulkanAllocation& Alloc);
+
+    // Returns the device memory of blocks that have no allocations
+    void FreeEmptyBlocks();
+
+    // Totals over all the blocks
+    SubAllocatorStats GetStats() const;
+
+    int GetNumDeviceAllocations() const { return m_numDeviceAllocations; }
+
+    void PrintStats() const;
+
+private:
+
+    struct MemoryBlock {
+        VkDeviceMemory Memory = VK_NULL_HANDLE;
+        VkDeviceSize Size = 0;
+        u32 MemoryTypeIndex = 0;
+        bool IsLinear = true;           // buffers and linear images
+        bool IsDedicated = false;
+        void* pMappedData = NULL;
+        TLSFAllocator Allocator;
+    };
+
+    VulkanAllocation Allocate(const VkMemoryRequirements& MemReqs, VkMemoryPropertyFlags MemProps, bool IsLinear);
+
+    int CreateBlock(u32 MemoryTypeIndex, bool IsLinear, VkDeviceSize Size, bool IsDedicated);
+
+    void DestroyBlock(int Index);
+
+    OgldevVulkanCore* m_pCore = NULL;
+    VkDeviceSize m_blockSize = 0;
+    std::vector<MemoryBlock> m_blocks;  // destroyed blocks stay in the vector with a NULL memory
+    int m_numDeviceAllocations = 0;
+};
+
+
+//
+// A persistently mapped, host visible buffer for uploads. Upload() copies the data
+// into the ring and returns its offset for use as the source of a copy command.
+// Submit() is called after the command buffers that read the data have been
+// submitted - it queues a fence and the space is reclaimed once that fence signals.
+//
+class VulkanStagingRing
+{
+public:
+    VulkanStagingRing() {}
+
+    ~VulkanStagingRing();
+
+    void Init(OgldevVulkanCore* pCore, VulkanMemoryAllocator* pAllocator, VkDeviceSize Size);
+
+    void Destroy();
+
+    // Blocks on older submissions if the ring is full
+    VkDeviceSize Upload(const void* pData, VkDeviceSize Size, VkDeviceSize Alignment = 16);
+
+    // Upload + a copy command into Dst
+    void CopyToBuffer(VkCommandBuffer CmdBuf, const void* pData, VkDeviceSize Size, VkBuffer Dst, VkDeviceSize DstOffset = 0);
+
+    void Submit(VkQueue Queue);
+
+    // Returns the space of all finished submissions without blocking
+    void Reclaim();
+
+    VkBuffer GetBuffer() const { return m_buffer; }
+
+private:
+
+    struct PendingSubmission {
+        VkFence Fence;
+        u64 Marker;
+    };
+
+    void ReleaseOldest(bool Wait);
+
+    VkFence GetFence();
+
+    OgldevVulkanCore* m_pCore = NULL;
+    VulkanMemoryAllocator* m_pAllocator = NULL;
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    VulkanAllocation m_alloc;
+    RingAllocator m_ring;
+    u64 m_submittedMarker = 0;
+    std::deque<PendingSubmission> m_pending;
+    std::vector<VkFence> m_freeFences;
+};
+
+#endif // OGLDEV_VULKAN
+
+#endif
@@ -0,0 +1,87 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_VULKAN_PIPELINE_COMPILER_H
+#define OGLDEV_VULKAN_PIPELINE_COMPILER_H
+
+#ifdef OGLDEV_VULKAN
+
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#include "ogldev_vulkan_core.h"
+#include "ogldev_parallel.h"
+
+// Runs on a worker thread. Must create the pipeline with the given cache and must
+// own everything that its create info points to (i.e. capture by value).
+typedef std::function<VkPipeline(VkDevice Device, VkPipelineCache Cache)> VulkanPipelineCreateFunc;
+
+// Runs on the thread that calls Update()
+typedef std::function<void(VkPipeline Pipeline)> VulkanPipelineReadyFunc;
+
+
+//
+// Compiles pipelines as background tasks of a JobSystem through the pipeline cache of
+// the core (vkCreateGraphicsPipelines is allowed to use the same cache from several threads).
+// The ready callbacks are deferred to Update() so that the caller never has to
+// synchronize its own state with the workers.
+//
+class VulkanPipelineCompiler
+{
+public:
+    VulkanPipelineCompiler() {}
+
+    ~VulkanPipelineCompiler();
+
+    // The JobSystem is shared with the rest of the app and must outlive the compiler
+    void Init(OgldevVulkanCore* pCore, JobSystem* pJobs);
+
+    // Waits for the queued pipelines; their callbacks are not called
+    void Destroy();
+
+    void Compile(const VulkanPipelineCreateFunc& CreateFunc, const VulkanPipelineReadyFunc& ReadyFunc);
+
+    // Calls the callbacks of the pipelines that are ready. Returns the number of pipelines still in progress.
+    int Update();
+
+    // Blocks until everything that was queued is compiled and calls the callbacks
+    void WaitAll();
+
+private:
+
+    struct Request {
+        VulkanPipelineCreateFunc CreateFunc;
+        VulkanPipelineReadyFunc ReadyFunc;
+        VkPipeline Pipeline;
+    };
+
+    void CompileRequest(Request r);
+
+    OgldevVulkanCore* m_pCore = NULL;
+    JobSystem* m_pJobs = NULL;
+    std::mutex m_mutex;
+    std::condition_variable m_doneCond;
+    std::vector<Request> m_finished;
+    int m_numInProgress = 0;       // queued + compiling
+};
+
+#endif // OGLDEV_VULKAN
+
+#endif
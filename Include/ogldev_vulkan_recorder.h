@@ -0,0 +1,90 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OGLDEV_VULKAN_RECORDER_H
+#define OGLDEV_VULKAN_RECORDER_H
+
+#ifdef OGLDEV_VULKAN
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "ogldev_vulkan_core.h"
+#include "ogldev_parallel.h"
+
+// Records the items [Start, End) into CmdBuf. Called on a worker thread.
+typedef std::function<void(VkCommandBuffer CmdBuf, int Start, int End)> VulkanRecordFunc;
+
+
+//
+// Splits the recording of a frame across the threads of a JobSystem. Every
+// (frame in flight, thread) pair has its own command pool so no locking is needed
+// and a pool is only reset when the GPU is done with the frame that used it.
+// The chunks are recorded into secondary command buffers and executed in order
+// from the primary command buffer.
+//
+// Usage:
+//     Recorder.BeginFrame(Frames.GetCurFrame());    // after VulkanFramesInFlight::BeginFrame()
+//     vkCmdBeginRenderPass(CmdBuf, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+//     Recorder.Record(CmdBuf, RenderPass, 0, Framebuffer, NumDraws, [&](VkCommandBuffer c, int Start, int End) { ... });
+//     vkCmdEndRenderPass(CmdBuf);
+//
+// A secondary command buffer does not inherit any state so the callback has to
+// bind the pipeline, descriptor sets and dynamic state that its draws need.
+//
+class VulkanParallelRecorder
+{
+public:
+    VulkanParallelRecorder() {}
+
+    ~VulkanParallelRecorder();
+
+    // NumThreads 0 means one per core
+    void Init(OgldevVulkanCore* pCore, int NumFrames, int NumThreads = 0);
+
+    void Destroy();
+
+    // Resets the command pools of the frame slot. The GPU must be done with it.
+    void BeginFrame(int Frame);
+
+    void Record(VkCommandBuffer PrimaryCmdBuf, VkRenderPass RenderPass, uint Subpass, VkFramebuffer Framebuffer,
+                int NumItems, const VulkanRecordFunc& Func, int MinItemsPerJob = 256);
+
+    int GetNumThreads() const { return m_pJobSystem ? m_pJobSystem->GetNumThreads() : 0; }
+
+private:
+
+    struct ThreadPool {
+        VkCommandPool CmdPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> CmdBufs;     // grows on demand and is recycled every frame
+        int NumUsed = 0;
+    };
+
+    VkCommandBuffer GetSecondaryCmdBuf(int Thread);
+
+    OgldevVulkanCore* m_pCore = NULL;
+    JobSystem* m_pJobSystem = NULL;
+    std::vector< std::vector<ThreadPool> > m_pools;     // [frame][thread]
+    int m_curFrame = 0;
+    std::vector<VkCommandBuffer> m_jobCmdBufs;
+};
+
+#endif // OGLDEV_VULKAN
+
+#endif
@@ -20,6 +20,7 @@
 #define WORLD_TRANSFORM_H
 
 #include "ogldev_math_3d.h"
+#include "ogldev_basic_glfw_camera.h"
 
 class WorldTrans {
  public:
@@ -33,8 +34,28 @@ class WorldTrans {
 
     void Rotate(float x, float y, float z);
 
+    // The matrices below are cached and only rebuilt after the transform has changed
     Matrix4f GetMatrix() const;
 
+    // Inverse transpose of the upper 3x3 - takes normals to world space
+    const Matrix3f& GetNormalMatrix() const;
+
+    // Also rebuilt when Camera changes (see BasicCamera::GetGeneration)
+    const Matrix4f& GetWVP(const BasicCamera& Camera) const
+    {
+        if (m_isDirty) {
+            UpdateMatrices();
+        }
+
+        if (m_isWVPDirty || (m_wvpCameraGeneration != Camera.GetGeneration())) {
+            m_wvp = Camera.GetViewProjMatrix() * m_worldMatrix;
+            m_wvpCameraGeneration = Camera.GetGeneration();
+            m_isWVPDirty = false;
+        }
+
+        return m_wvp;
+    }
+
     Vector3f WorldPosToLocalPos(const Vector3f& WorldPos) const;
     Vector3f WorldDirToLocalDir(const Vector3f& WorldDir) const;
 
@@ -46,10 +67,28 @@ class WorldTrans {
     Vector3f GetRotation() const { return m_rotation; }
 
  private:
+    void UpdateMatrices() const;
+
     float    m_scale    = 1.0f;
     Vector3f m_rotation = Vector3f(0.0f, 0.0f, 0.0f);
     Vector3f m_pos      = Vector3f(0.0f, 0.0f, 0.0f);
+
+    mutable bool     m_isDirty = true;
+    mutable bool     m_isWVPDirty = true;
+    mutable uint     m_wvpCameraGeneration = 0;
+    mutable Matrix4f m_worldMatrix;
+    mutable Matrix3f m_normalMatrix;
+    mutable Matrix4f m_wvp;
 };
 
 
+//
+// Fills the per instance matrices of instanced rendering. Instance i gets two
+// column major matrices (the layout of BasicMesh::InstanceData):
+// pOut[2 * i] = (VP * World)^T and pOut[2 * i + 1] = World^T. The products go
+// through MatrixMulBatch and the transposes through the SIMD kernel.
+//
+void PackInstanceMatrices(const Matrix4f& VP, const WorldTrans* pWorldTrans, int Count, Matrix4f* pOut);
+
+
 #endif
@@ -20,8 +20,11 @@
 #define TECHNIQUE_H
 
 #include <list>
+#include <string>
 #include <GL/glew.h>
 
+#include "ogldev_types.h"
+
 class Technique
 {
 public:
@@ -36,6 +39,10 @@ public:
 
     GLuint GetProgram() const { return m_shaderProg; }
 
+    // Linked programs are saved with glGetProgramBinary and loaded on the next run
+    // if the shader sources and the driver have not changed. NULL disables the cache.
+    static void SetProgramBinaryCacheDir(const char* pDir);
+
 protected:
 
     bool AddShader(GLenum ShaderType, const char* pFilename);
@@ -48,8 +55,30 @@ protected:
 
 private:
 
+    struct ShaderSource {
+        GLenum Type;
+        std::string Filename;
+        std::string Source;
+    };
+
+    bool CompileShader(const ShaderSource& Shader);
+
+    bool Link();
+
+    bool LoadProgramBinary(const std::string& Filename, u64 Key);
+
+    void SaveProgramBinary(const std::string& Filename, u64 Key);
+
+    u64 CalcProgramKey() const;
+
     typedef std::list<GLuint> ShaderObjList;
     ShaderObjList m_shaderObjList;
+
+    // Compilation is deferred to Finalize() so that it can be skipped when the program is in the cache
+    std::list<ShaderSource> m_shaderSources;
+    bool m_isFinalized = false;
+
+    static std::string s_programBinaryCacheDir;
 };
 
 #endif  /* TECHNIQUE_H */
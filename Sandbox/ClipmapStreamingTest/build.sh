@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include -I../../Include/assimp5 -I../../Terrain12"
+
+$CC clipmap_streaming_test.cpp ../../Terrain12/clipmap.cpp ../../Terrain12/height_tile_streamer.cpp ../../Common/ogldev_mapped_file.cpp ../../Common/math_3d.cpp $CPPFLAGS -lpthread -o clipmap_streaming_test
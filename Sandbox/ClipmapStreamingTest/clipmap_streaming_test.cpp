@@ -0,0 +1,283 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//
+// Flies a synthetic camera over a tile pyramid and checks that the clipmap
+// of Terrain12 streams in the right heights, that the dirty rects reproduce
+// the levels exactly (like the texture upload would) and that the tile cache
+// stays within its budget. No GL is needed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <unistd.h>
+
+#include "clipmap.h"
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+#define WORLD_SIZE   1000     // not a multiple of the tile size on purpose
+#define TILE_SIZE    32
+#define NUM_LEVELS   4
+#define LEVEL_SIZE   64
+#define WORLD_SCALE  2.0f
+
+static const char* pTileDir = "clipmap_test_tiles";
+
+
+static float TestHeight(int x, int z)
+{
+    return (float)((x * 7 + z * 13) % 1000);
+}
+
+
+static float ExpectedHeight(int Level, int x, int z)
+{
+    int X = x * (1 << Level);
+    int Z = z * (1 << Level);
+
+    if ((x < 0) || (z < 0) || (X >= WORLD_SIZE) || (Z >= WORLD_SIZE)) {
+        return 0.0f;
+    }
+
+    return TestHeight(X, Z);
+}
+
+
+// Stands in for the texture array of the renderer
+struct Mirror {
+    std::vector<std::vector<float>> Levels;
+
+    void Init(int TextureSize)
+    {
+        Levels.assign(NUM_LEVELS, std::vector<float>(TextureSize * TextureSize, -1.0f));
+    }
+
+    void Upload(Clipmap& Map)
+    {
+        int TextureSize = Map.GetTextureSize();
+        std::vector<ClipmapRect> Rects;
+
+        for (int l = 0 ; l < NUM_LEVELS ; l++) {
+            Map.GetDirtyRects(l, Rects);
+
+            for (const ClipmapRect& r : Rects) {
+                CHECK((r.x0 >= 0) && (r.z0 >= 0) && (r.x1 <= TextureSize) && (r.z1 <= TextureSize) && !r.IsEmpty());
+
+                for (int z = r.z0 ; z < r.z1 ; z++) {
+                    for (int x = r.x0 ; x < r.x1 ; x++) {
+                        Levels[l][z * TextureSize + x] = Map.GetLevelHeights(l)[z * TextureSize + x];
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+static void CheckLevels(Clipmap& Map, const Mirror& m)
+{
+    int TextureSize = Map.GetTextureSize();
+    int NumWrong = 0;
+    int NumStale = 0;
+
+    for (int l = 0 ; l < NUM_LEVELS ; l++) {
+        int OriginX = Map.GetOriginX(l);
+        int OriginZ = Map.GetOriginZ(l);
+
+        CHECK((OriginX % 2) == 0);
+        CHECK((OriginZ % 2) == 0);
+
+        for (int z = OriginZ ; z < OriginZ + TextureSize ; z++) {
+            for (int x = OriginX ; x < OriginX + TextureSize ; x++) {
+                float h = Map.GetLevelHeight(l, x, z);
+
+                if (h != ExpectedHeight(l, x, z)) {
+                    NumWrong++;
+                }
+
+                int Texel = (((z % TextureSize) + TextureSize) % TextureSize) * TextureSize + (((x % TextureSize) + TextureSize) % TextureSize);
+
+                if (m.Levels[l][Texel] != h) {
+                    NumStale++;
+                }
+            }
+        }
+
+        if (l > 0) {
+            int HoleX, HoleZ;
+            Map.GetHoleOffset(l, HoleX, HoleZ);
+            CHECK((HoleX == LEVEL_SIZE / 4) || (HoleX == LEVEL_SIZE / 4 + 1));
+            CHECK((HoleZ == LEVEL_SIZE / 4) || (HoleZ == LEVEL_SIZE / 4 + 1));
+        }
+    }
+
+    CHECK(NumWrong == 0);
+    CHECK(NumStale == 0);
+}
+
+
+// Updates until everything arrived, like a few frames with the camera standing still
+static int Settle(Clipmap& Map, HeightTileStreamer& Streamer, const Vector3f& Pos, Mirror& m)
+{
+    int NumFrames = 0;
+
+    while (Map.GetFinestCompleteLevel() != 0) {
+        Streamer.WaitIdle();
+        Map.Update(Pos);
+        m.Upload(Map);
+        NumFrames++;
+
+        CHECK(Streamer.GetNumResidentTiles() <= Streamer.GetMaxResidentTiles());
+
+        if (NumFrames > 100) {
+            printf("The clipmap did not settle\n");
+            NumErrors++;
+            break;
+        }
+    }
+
+    return NumFrames;
+}
+
+
+static void TestFlight()
+{
+    std::vector<float> Heights(WORLD_SIZE * WORLD_SIZE);
+
+    for (int z = 0 ; z < WORLD_SIZE ; z++) {
+        for (int x = 0 ; x < WORLD_SIZE ; x++) {
+            Heights[z * WORLD_SIZE + x] = TestHeight(x, z);
+        }
+    }
+
+    CHECK(WriteHeightTilePyramid(pTileDir, Heights.data(), WORLD_SIZE, TILE_SIZE, NUM_LEVELS));
+
+    HeightTileStreamer Streamer;
+    Streamer.Init(pTileDir, TILE_SIZE, Clipmap::GetMaxResidentTiles(NUM_LEVELS, LEVEL_SIZE, TILE_SIZE));
+
+    Clipmap Map;
+    Map.Init(&Streamer, NUM_LEVELS, LEVEL_SIZE, WORLD_SCALE);
+
+    Mirror m;
+    m.Init(Map.GetTextureSize());
+
+    // Nothing is resident before the first update
+    Vector3f Pos(500.0f * WORLD_SCALE, 0.0f, 500.0f * WORLD_SCALE);
+    Map.Update(Pos);
+    m.Upload(Map);
+    CHECK(Map.GetFinestCompleteLevel() == -1);
+
+    Settle(Map, Streamer, Pos, m);
+    CHECK(Map.GetFinestCompleteLevel() == 0);
+    CheckLevels(Map, m);
+
+    // The camera height comes from the finest level
+    float x = 123.25f;
+    float z = 456.5f;
+    Pos = Vector3f(x * WORLD_SCALE, 0.0f, z * WORLD_SCALE);
+    Map.Update(Pos);
+    m.Upload(Map);
+    Settle(Map, Streamer, Pos, m);
+    float Expected = (1.0f - 0.5f) * ((1.0f - 0.25f) * TestHeight(123, 456) + 0.25f * TestHeight(124, 456)) +
+                     0.5f * ((1.0f - 0.25f) * TestHeight(123, 457) + 0.25f * TestHeight(124, 457));
+    CHECK(fabsf(Map.GetHeight(Pos.x, Pos.z) - Expected) < 0.01f);
+
+    // Small steps only stream the edges. Walk diagonally over the world,
+    // off its edge and back.
+    int LoadsBefore = Streamer.GetNumLoads();
+    int NumSteps = 0;
+
+    for (float t = 0.0f ; t <= 1.0f ; t += 0.01f) {
+        Pos.x = (-200.0f + 1400.0f * t) * WORLD_SCALE;
+        Pos.z = (1100.0f - 1300.0f * t) * WORLD_SCALE;
+        Map.Update(Pos);
+        m.Upload(Map);
+        Settle(Map, Streamer, Pos, m);
+        CheckLevels(Map, m);
+        NumSteps++;
+    }
+
+    int NumLoads = Streamer.GetNumLoads() - LoadsBefore;
+    printf("%d steps, %d tiles loaded, at most %d resident\n", NumSteps, NumLoads, Streamer.GetMaxResidentTiles());
+
+    // Far fewer than reloading every window on every step
+    CHECK(NumLoads < NumSteps * Clipmap::GetMaxResidentTiles(NUM_LEVELS, LEVEL_SIZE, TILE_SIZE) / 4);
+
+    // A jump replaces the levels completely
+    Pos = Vector3f(900.0f * WORLD_SCALE, 0.0f, 100.0f * WORLD_SCALE);
+    Map.Update(Pos);
+    m.Upload(Map);
+    Settle(Map, Streamer, Pos, m);
+    CheckLevels(Map, m);
+
+    // While moving without waiting for the loader the coarse levels stay usable
+    for (int i = 0 ; i < 50 ; i++) {
+        Pos.x -= 40.0f * WORLD_SCALE;
+        Map.Update(Pos);
+        m.Upload(Map);
+        CHECK(Streamer.GetNumResidentTiles() <= Streamer.GetMaxResidentTiles());
+    }
+
+    Settle(Map, Streamer, Pos, m);
+    CheckLevels(Map, m);
+
+    Streamer.Destroy();
+}
+
+
+static void RemoveTiles()
+{
+    for (int l = 0 ; l < NUM_LEVELS ; l++) {
+        int NumTiles = ((WORLD_SIZE >> l) + TILE_SIZE) / TILE_SIZE;
+
+        for (int z = 0 ; z < NumTiles ; z++) {
+            for (int x = 0 ; x < NumTiles ; x++) {
+                char Filename[256];
+                snprintf(Filename, sizeof(Filename), "%s/L%d_%d_%d.tile", pTileDir, l, x, z);
+                remove(Filename);
+            }
+        }
+    }
+
+    rmdir(pTileDir);
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestFlight();
+
+    RemoveTiles();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include -I../../Include/assimp5 -I../../Terrain5.1"
+
+$CC horizon_map_test.cpp ../../Terrain5.1/horizon_map.cpp ../../Common/ogldev_mapped_file.cpp ../../Common/math_3d.cpp $CPPFLAGS -lpthread -o horizon_map_test
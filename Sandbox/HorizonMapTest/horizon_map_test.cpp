@@ -0,0 +1,217 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Tests the horizon map of Terrain5.1 against a plain march without the
+// early exit and SIMD. No GL is needed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+
+#include "horizon_map.h"
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+// Same directions and steps as horizon_map.cpp
+static u8 ReferenceHorizon(const Array2D<float>& Heights, int Size, float WorldScale, int MaxDistance, int x, int z, int d)
+{
+    static const int DirX[HORIZON_NUM_DIRECTIONS] = { 1, 1, 0, -1, -1, -1,  0,  1 };
+    static const int DirZ[HORIZON_NUM_DIRECTIONS] = { 0, 1, 1,  1,  0, -1, -1, -1 };
+
+    float StepLength = sqrtf((float)(DirX[d] * DirX[d] + DirZ[d] * DirZ[d])) * WorldScale;
+    float h0 = Heights.Get(x, z);
+    float MaxTan = 0.0f;
+
+    for (int k = 1 ; k <= MaxDistance ; k += 1 + k / 16) {
+        int sx = x + k * DirX[d];
+        int sz = z + k * DirZ[d];
+
+        if ((sx < 0) || (sx >= Size) || (sz < 0) || (sz >= Size)) {
+            break;
+        }
+
+        MaxTan = std::max(MaxTan, (Heights.Get(sx, sz) - h0) * (1.0f / ((float)k * StepLength)));
+    }
+
+    return (u8)(atanf(MaxTan) * (255.0f / ((float)M_PI * 0.5f)) + 0.5f);
+}
+
+
+static void TestFlat()
+{
+    Array2D<float> Heights;
+    Heights.InitArray2D(32, 32, 10.0f);
+
+    HorizonMap Map(&Heights);
+    Map.Bake(32, 1.0f, 64);
+
+    bool AllZero = true;
+
+    for (int z = 0 ; z < 32 ; z++) {
+        for (int x = 0 ; x < 32 ; x++) {
+            for (int d = 0 ; d < HORIZON_NUM_DIRECTIONS ; d++) {
+                AllZero &= (Map.GetHorizonAngle(x, z, d) == 0.0f);
+            }
+
+            CHECK(Map.GetAmbientOcclusion(x, z) == 1.0f);
+        }
+    }
+
+    CHECK(AllZero);
+
+    // Straight down - fully lit
+    Map.InitLighter(Vector3f(0.0f, -1.0f, 0.0f), 0.0f);
+    CHECK(fabsf(Map.GetLighting(16, 16) - 1.0f) < 1e-5f);
+}
+
+
+static void TestWall()
+{
+    // A wall along z at x = 20
+    int Size = 64;
+    Array2D<float> Heights;
+    Heights.InitArray2D(Size, Size, 0.0f);
+
+    for (int z = 0 ; z < Size ; z++) {
+        Heights.Set(20, z, 10.0f);
+    }
+
+    HorizonMap Map(&Heights);
+    Map.Bake(Size, 1.0f, 64);
+
+    // 10 texels before the wall, looking at +X the horizon is atan(10/10) = 45 degrees
+    float Angle = Map.GetHorizonAngle(10, 32, 0);
+    CHECK(fabsf(Angle - (float)M_PI / 4.0f) < 0.01f);
+
+    // Nothing towards -X
+    CHECK(Map.GetHorizonAngle(10, 32, 4) == 0.0f);
+
+    // Sun from +X at 30 degrees is blocked, at 60 degrees it is not
+    Map.InitLighter(Vector3f(-cosf(ToRadian(30.0f)), -sinf(ToRadian(30.0f)), 0.0f), 0.0f);
+    CHECK(Map.GetSunVisibility(10, 32) == 0.0f);
+    CHECK(Map.GetSunVisibility(30, 32) == 1.0f);   // the other side of the wall
+
+    Map.InitLighter(Vector3f(-cosf(ToRadian(60.0f)), -sinf(ToRadian(60.0f)), 0.0f), 0.0f);
+    CHECK(Map.GetSunVisibility(10, 32) == 1.0f);
+
+    // The penumbra straddles the horizon
+    Map.InitLighter(Vector3f(-cosf(ToRadian(45.0f)), -sinf(ToRadian(45.0f)), 0.0f), 10.0f);
+    float Visibility = Map.GetSunVisibility(10, 32);
+    CHECK((Visibility > 0.3f) && (Visibility < 0.7f));
+
+    CHECK(Map.GetAmbientOcclusion(10, 32) < 1.0f);
+}
+
+
+static void TestAgainstReference(int Size, int MaxDistance, bool Async)
+{
+    Array2D<float> Heights;
+    Heights.InitArray2D(Size, Size, 0.0f);
+
+    srand(Size);
+
+    for (int z = 0 ; z < Size ; z++) {
+        for (int x = 0 ; x < Size ; x++) {
+            float h = 60.0f * sinf((float)x * 0.07f) * cosf((float)z * 0.05f) + (float)(rand() % 1000) * 0.01f;
+            Heights.Set(x, z, h);
+        }
+    }
+
+    float WorldScale = 2.0f;
+    HorizonMap Map(&Heights);
+
+    auto Start = std::chrono::steady_clock::now();
+
+    if (Async) {
+        Map.StartBake(Size, WorldScale, MaxDistance);
+        Map.WaitForBake();
+    } else {
+        Map.Bake(Size, WorldScale, MaxDistance);
+    }
+
+    double Ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+    printf("Baked %dx%d (max distance %d) in %.1f ms\n", Size, Size, MaxDistance, Ms);
+
+    CHECK(Map.IsReady());
+
+    int NumMismatches = 0;
+
+    for (int z = 0 ; z < Size ; z++) {
+        for (int x = 0 ; x < Size ; x++) {
+            for (int d = 0 ; d < HORIZON_NUM_DIRECTIONS ; d++) {
+                float Expected = (float)ReferenceHorizon(Heights, Size, WorldScale, MaxDistance, x, z, d) * ((float)M_PI * 0.5f / 255.0f);
+
+                if (Map.GetHorizonAngle(x, z, d) != Expected) {
+                    NumMismatches++;
+                }
+            }
+        }
+    }
+
+    CHECK(NumMismatches == 0);
+
+    // Save and load
+    const char* pFilename = "horizon_map_test.bin";
+    CHECK(Map.SaveToFile(pFilename));
+
+    HorizonMap Loaded(&Heights);
+    CHECK(Loaded.LoadFromFile(pFilename, WorldScale));
+
+    bool Same = true;
+
+    for (int z = 0 ; z < Size ; z += 7) {
+        for (int x = 0 ; x < Size ; x += 5) {
+            for (int d = 0 ; d < HORIZON_NUM_DIRECTIONS ; d++) {
+                Same &= (Loaded.GetHorizonAngle(x, z, d) == Map.GetHorizonAngle(x, z, d));
+            }
+        }
+    }
+
+    CHECK(Same);
+
+    remove(pFilename);
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestFlat();
+    TestWall();
+    TestAgainstReference(37, 16, false);
+    TestAgainstReference(200, 128, true);
+    TestAgainstReference(513, 256, false);
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+    return 0;
+}
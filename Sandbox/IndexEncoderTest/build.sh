@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include"
+
+$CC index_encoder_test.cpp ../../Common/ogldev_index_encoder.cpp $CPPFLAGS -o index_encoder_test
@@ -0,0 +1,281 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//
+// Checks that the strips and fans of the index encoder draw exactly the
+// triangles of the triangle lists they replace (with the same winding),
+// that the cache optimization only reorders them and lowers the ACMR, and
+// the 16 bit packing.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "ogldev_index_encoder.h"
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+struct Triangle {
+    uint v[3];
+
+    bool operator<(const Triangle& t) const
+    {
+        return memcmp(v, t.v, sizeof(v)) < 0;
+    }
+
+    bool operator==(const Triangle& t) const
+    {
+        return memcmp(v, t.v, sizeof(v)) == 0;
+    }
+};
+
+
+// Rotates every triangle so that it starts with its smallest index - keeps
+// the winding - and sorts them
+static std::vector<Triangle> Canonize(const std::vector<uint>& Indices)
+{
+    std::vector<Triangle> Triangles;
+
+    for (int i = 0 ; i < (int)Indices.size() ; i += 3) {
+        int First = 0;
+
+        for (int j = 1 ; j < 3 ; j++) {
+            if (Indices[i + j] < Indices[i + First]) {
+                First = j;
+            }
+        }
+
+        Triangle t;
+
+        for (int j = 0 ; j < 3 ; j++) {
+            t.v[j] = Indices[i + (First + j) % 3];
+        }
+
+        Triangles.push_back(t);
+    }
+
+    std::sort(Triangles.begin(), Triangles.end());
+
+    return Triangles;
+}
+
+
+// Same as TriangleList::InitIndices
+static void BuildGridTriangles(int Width, int Depth, std::vector<uint>& Indices)
+{
+    Indices.clear();
+
+    for (int z = 0 ; z < Depth - 1 ; z++) {
+        for (int x = 0 ; x < Width - 1 ; x++) {
+            uint IndexBottomLeft = z * Width + x;
+            uint IndexTopLeft = (z + 1) * Width + x;
+            uint IndexTopRight = (z + 1) * Width + x + 1;
+            uint IndexBottomRight = z * Width + x + 1;
+
+            Indices.push_back(IndexBottomLeft);
+            Indices.push_back(IndexTopLeft);
+            Indices.push_back(IndexTopRight);
+
+            Indices.push_back(IndexBottomLeft);
+            Indices.push_back(IndexTopRight);
+            Indices.push_back(IndexBottomRight);
+        }
+    }
+}
+
+
+// The full resolution fans of GeomipGrid::CreateTriangleFan for a patch of
+// PatchSize x PatchSize vertices in a grid that is Width vertices wide
+static void BuildPatchFans(int Width, int PatchSize, std::vector<uint>& Indices)
+{
+    Indices.clear();
+
+    for (int z = 0 ; z < PatchSize - 1 ; z += 2) {
+        for (int x = 0 ; x < PatchSize - 1 ; x += 2) {
+            uint Center = (z + 1) * Width + x + 1;
+            int RimX[] = { 0, 0, 0, 1, 2, 2, 2, 1, 0 };
+            int RimZ[] = { 0, 1, 2, 2, 2, 1, 0, 0, 0 };
+
+            for (int i = 0 ; i < 8 ; i++) {
+                Indices.push_back(Center);
+                Indices.push_back((z + RimZ[i]) * Width + x + RimX[i]);
+                Indices.push_back((z + RimZ[i + 1]) * Width + x + RimX[i + 1]);
+            }
+        }
+    }
+}
+
+
+static void TestGridStrips(int Width, int Depth, int ExpectedRanges)
+{
+    std::vector<uint> Triangles;
+    BuildGridTriangles(Width, Depth, Triangles);
+
+    std::vector<uint> Strips;
+    std::vector<IndexRange> Ranges;
+    BuildGridStrips(Width, Depth, OGLDEV_VERTEX_CACHE_SIZE, Strips, Ranges);
+
+    CHECK((int)Ranges.size() == ExpectedRanges);
+
+    // Every range is a separate draw call and together they cover the
+    // whole buffer
+    std::vector<uint> Decoded;
+    int End = 0;
+
+    for (int r = 0 ; r < (int)Ranges.size() ; r++) {
+        CHECK(Ranges[r].Start == End);
+        End += Ranges[r].Count;
+
+        std::vector<uint> RangeTriangles;
+        DecodeTriangles(INDEX_TOPOLOGY_TRIANGLE_STRIP, &Strips[Ranges[r].Start], Ranges[r].Count, RangeTriangles);
+        Decoded.insert(Decoded.end(), RangeTriangles.begin(), RangeTriangles.end());
+    }
+
+    CHECK(End == (int)Strips.size());
+    CHECK(Canonize(Decoded) == Canonize(Triangles));
+
+    float ListACMR = CalcACMR(INDEX_TOPOLOGY_TRIANGLES, &Triangles[0], (int)Triangles.size(), OGLDEV_VERTEX_CACHE_SIZE);
+    float StripsACMR = CalcACMR(INDEX_TOPOLOGY_TRIANGLE_STRIP, &Strips[0], (int)Strips.size(), OGLDEV_VERTEX_CACHE_SIZE);
+
+    printf("Grid %dx%d: %zu list indices ACMR %.3f, %zu strip indices ACMR %.3f\n",
+           Width, Depth, Triangles.size(), ListACMR, Strips.size(), StripsACMR);
+
+    CHECK(StripsACMR < ListACMR);
+    CHECK(StripsACMR < 0.65f);
+    CHECK(Strips.size() * 2 < Triangles.size());
+
+    std::vector<uchar> Buffer;
+    int IndexSize = PackIndices(Strips, Ranges, Buffer);
+    CHECK(IndexSize == sizeof(ushort));
+    CHECK(Buffer.size() == Strips.size() * sizeof(ushort));
+
+    // Unpacking with the base vertex of each range gives the strips back
+    const ushort* pPacked = (const ushort*)&Buffer[0];
+
+    for (int r = 0 ; r < (int)Ranges.size() ; r++) {
+        for (int i = Ranges[r].Start ; i < Ranges[r].Start + Ranges[r].Count ; i++) {
+            if (Strips[i] == OGLDEV_RESTART_INDEX) {
+                CHECK(pPacked[i] == 0xFFFF);
+            } else {
+                CHECK(pPacked[i] != 0xFFFF);
+                CHECK(pPacked[i] + (uint)Ranges[r].BaseVertex == Strips[i]);
+            }
+        }
+    }
+}
+
+
+static void TestWideGrid()
+{
+    // Not even two rows fit in 16 bits
+    std::vector<uint> Strips;
+    std::vector<IndexRange> Ranges;
+    BuildGridStrips(40000, 3, OGLDEV_VERTEX_CACHE_SIZE, Strips, Ranges);
+
+    CHECK(Ranges.size() == 1);
+
+    std::vector<uchar> Buffer;
+    CHECK(PackIndices(Strips, Ranges, Buffer) == sizeof(uint));
+    CHECK(Buffer.size() == Strips.size() * sizeof(uint));
+    CHECK(memcmp(&Buffer[0], &Strips[0], Buffer.size()) == 0);
+}
+
+
+static void TestFans()
+{
+    int Width = 257;
+    int PatchSize = 33;
+
+    std::vector<uint> Triangles;
+    BuildPatchFans(Width, PatchSize, Triangles);
+
+    std::vector<uint> Fans;
+    BuildTriangleFans(&Triangles[0], (int)Triangles.size(), Fans);
+
+    // A fan of 8 triangles is 10 indices and a restart
+    int NumFans = ((PatchSize - 1) / 2) * ((PatchSize - 1) / 2);
+    CHECK((int)Fans.size() == NumFans * 11 - 1);
+
+    // Exactly the same triangles in the same order
+    std::vector<uint> Decoded;
+    DecodeTriangles(INDEX_TOPOLOGY_TRIANGLE_FAN, &Fans[0], (int)Fans.size(), Decoded);
+    CHECK(Decoded == Triangles);
+
+    float Before = CalcACMR(INDEX_TOPOLOGY_TRIANGLE_FAN, &Fans[0], (int)Fans.size(), OGLDEV_VERTEX_CACHE_SIZE);
+
+    OptimizeVertexCache(INDEX_TOPOLOGY_TRIANGLE_FAN, Fans, OGLDEV_VERTEX_CACHE_SIZE);
+
+    float After = CalcACMR(INDEX_TOPOLOGY_TRIANGLE_FAN, &Fans[0], (int)Fans.size(), OGLDEV_VERTEX_CACHE_SIZE);
+
+    printf("Fans of a %dx%d patch: ACMR %.3f -> %.3f\n", PatchSize, PatchSize, Before, After);
+
+    CHECK(After < Before);
+    CHECK((int)Fans.size() == NumFans * 11 - 1);
+
+    DecodeTriangles(INDEX_TOPOLOGY_TRIANGLE_FAN, &Fans[0], (int)Fans.size(), Decoded);
+    CHECK(Canonize(Decoded) == Canonize(Triangles));
+
+    // A triangle list is reordered triangle by triangle
+    std::vector<uint> List = Triangles;
+    OptimizeVertexCache(INDEX_TOPOLOGY_TRIANGLES, List, OGLDEV_VERTEX_CACHE_SIZE);
+    CHECK(Canonize(List) == Canonize(Triangles));
+    CHECK(CalcACMR(INDEX_TOPOLOGY_TRIANGLES, &List[0], (int)List.size(), OGLDEV_VERTEX_CACHE_SIZE) <=
+          CalcACMR(INDEX_TOPOLOGY_TRIANGLES, &Triangles[0], (int)Triangles.size(), OGLDEV_VERTEX_CACHE_SIZE));
+}
+
+
+static void TestStripDecode()
+{
+    // The second triangle of a strip is flipped and degenerates are dropped
+    uint Strip[] = { 0, 1, 2, 3, OGLDEV_RESTART_INDEX, 4, 4, 5, 6 };
+    std::vector<uint> Decoded;
+    DecodeTriangles(INDEX_TOPOLOGY_TRIANGLE_STRIP, Strip, 9, Decoded);
+
+    uint Expected[] = { 0, 1, 2, 2, 1, 3, 5, 4, 6 };
+    CHECK(Decoded.size() == 9);
+    CHECK((Decoded.size() == 9) && (memcmp(&Decoded[0], Expected, sizeof(Expected)) == 0));
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestStripDecode();
+    TestGridStrips(37, 29, 1);
+    TestGridStrips(513, 513, 5);
+    TestGridStrips(500, 500, 4);
+    TestWideGrid();
+    TestFans();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
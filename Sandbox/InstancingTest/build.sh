@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include -I../../Include/assimp5"
+
+$CC instancing_test.cpp ../../Common/ogldev_streaming_buffer.cpp ../../Common/ogldev_world_transform.cpp ../../Common/math_3d.cpp $CPPFLAGS -o instancing_test
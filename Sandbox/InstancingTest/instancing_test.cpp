@@ -0,0 +1,550 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//
+// Checks the instance matrices of PhongRenderer::RenderInstanced against the
+// scalar reference, the region rotation of the streaming buffer that they
+// are written to and the per-draw uniform slots of UniformDrawBuffer. The GL
+// calls of the streaming buffer go to a fake driver that records them so
+// this runs without a context.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "ogldev_util.h"
+#include "ogldev_world_transform.h"
+#include "ogldev_streaming_buffer.h"
+
+#define EPSILON 1e-4f
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+//
+// Fake driver
+//
+static bool IsPersistentAvailable = true;
+
+struct FakeDriver {
+    GLuint NextBuffer = 1;
+    std::vector<GLuint> LiveBuffers;
+    std::vector<char> Storage;             // the store of the last buffer
+    uintptr_t NextFence = 1;
+    std::vector<GLsync> LiveFences;
+    std::vector<GLsync> CreatedFences;     // in order
+    std::vector<GLsync> WaitedFences;      // in order
+    int NumSubData = 0;
+    GLint UniformBlockSize = 0;            // 0 - the program has no such block
+    GLuint UniformBlockBinding = 0;
+    std::vector<GLintptr> BoundOffsets;    // glBindBufferRange, in order
+    GLsizeiptr BoundSize = 0;
+};
+
+static FakeDriver Driver;
+
+
+static void GLAPIENTRY FakeGenBuffers(GLsizei n, GLuint* pBuffers)
+{
+    for (int i = 0 ; i < n ; i++) {
+        pBuffers[i] = Driver.NextBuffer++;
+        Driver.LiveBuffers.push_back(pBuffers[i]);
+    }
+}
+
+
+static void GLAPIENTRY FakeDeleteBuffers(GLsizei n, const GLuint* pBuffers)
+{
+    for (int i = 0 ; i < n ; i++) {
+        for (int j = 0 ; j < (int)Driver.LiveBuffers.size() ; j++) {
+            if (Driver.LiveBuffers[j] == pBuffers[i]) {
+                Driver.LiveBuffers.erase(Driver.LiveBuffers.begin() + j);
+                break;
+            }
+        }
+    }
+}
+
+
+static void GLAPIENTRY FakeBindBuffer(GLenum, GLuint)
+{
+}
+
+
+static void GLAPIENTRY FakeBufferStorage(GLenum, GLsizeiptr Size, const void*, GLbitfield)
+{
+    Driver.Storage.assign(Size, 0);
+}
+
+
+static void GLAPIENTRY FakeBufferData(GLenum, GLsizeiptr Size, const void*, GLenum)
+{
+    Driver.Storage.assign(Size, 0);
+}
+
+
+static void GLAPIENTRY FakeBufferSubData(GLenum, GLintptr Offset, GLsizeiptr Size, const void* pData)
+{
+    CHECK(Offset + Size <= (GLsizeiptr)Driver.Storage.size());
+    memcpy(&Driver.Storage[Offset], pData, Size);
+    Driver.NumSubData++;
+}
+
+
+static void* GLAPIENTRY FakeMapBufferRange(GLenum, GLintptr Offset, GLsizeiptr, GLbitfield)
+{
+    return &Driver.Storage[Offset];
+}
+
+
+static GLboolean GLAPIENTRY FakeUnmapBuffer(GLenum)
+{
+    return GL_TRUE;
+}
+
+
+static GLsync GLAPIENTRY FakeFenceSync(GLenum, GLbitfield)
+{
+    GLsync Fence = (GLsync)Driver.NextFence++;
+    Driver.LiveFences.push_back(Fence);
+    Driver.CreatedFences.push_back(Fence);
+    return Fence;
+}
+
+
+static GLenum GLAPIENTRY FakeClientWaitSync(GLsync Fence, GLbitfield, GLuint64)
+{
+    Driver.WaitedFences.push_back(Fence);
+    return GL_ALREADY_SIGNALED;
+}
+
+
+static void GLAPIENTRY FakeDeleteSync(GLsync Fence)
+{
+    for (int i = 0 ; i < (int)Driver.LiveFences.size() ; i++) {
+        if (Driver.LiveFences[i] == Fence) {
+            Driver.LiveFences.erase(Driver.LiveFences.begin() + i);
+            return;
+        }
+    }
+
+    printf("Deleting an unknown fence\n");
+    NumErrors++;
+}
+
+
+static GLuint GLAPIENTRY FakeGetUniformBlockIndex(GLuint, const GLchar*)
+{
+    return (Driver.UniformBlockSize > 0) ? 0 : GL_INVALID_INDEX;
+}
+
+
+static void GLAPIENTRY FakeUniformBlockBinding(GLuint, GLuint, GLuint Binding)
+{
+    Driver.UniformBlockBinding = Binding;
+}
+
+
+static void GLAPIENTRY FakeGetActiveUniformBlockiv(GLuint, GLuint, GLenum, GLint* pParam)
+{
+    *pParam = Driver.UniformBlockSize;
+}
+
+
+static void GLAPIENTRY FakeBindBufferRange(GLenum Target, GLuint Binding, GLuint, GLintptr Offset, GLsizeiptr Size)
+{
+    CHECK(Target == GL_UNIFORM_BUFFER);
+    CHECK(Binding == Driver.UniformBlockBinding);
+    Driver.BoundOffsets.push_back(Offset);
+    Driver.BoundSize = Size;
+}
+
+
+PFNGLGENBUFFERSPROC __glewGenBuffers = FakeGenBuffers;
+PFNGLDELETEBUFFERSPROC __glewDeleteBuffers = FakeDeleteBuffers;
+PFNGLBINDBUFFERPROC __glewBindBuffer = FakeBindBuffer;
+PFNGLBUFFERSTORAGEPROC __glewBufferStorage = FakeBufferStorage;
+PFNGLBUFFERDATAPROC __glewBufferData = FakeBufferData;
+PFNGLBUFFERSUBDATAPROC __glewBufferSubData = FakeBufferSubData;
+PFNGLMAPBUFFERRANGEPROC __glewMapBufferRange = FakeMapBufferRange;
+PFNGLUNMAPBUFFERPROC __glewUnmapBuffer = FakeUnmapBuffer;
+PFNGLFENCESYNCPROC __glewFenceSync = FakeFenceSync;
+PFNGLCLIENTWAITSYNCPROC __glewClientWaitSync = FakeClientWaitSync;
+PFNGLDELETESYNCPROC __glewDeleteSync = FakeDeleteSync;
+PFNGLGETUNIFORMBLOCKINDEXPROC __glewGetUniformBlockIndex = FakeGetUniformBlockIndex;
+PFNGLUNIFORMBLOCKBINDINGPROC __glewUniformBlockBinding = FakeUniformBlockBinding;
+PFNGLGETACTIVEUNIFORMBLOCKIVPROC __glewGetActiveUniformBlockiv = FakeGetActiveUniformBlockiv;
+PFNGLBINDBUFFERRANGEPROC __glewBindBufferRange = FakeBindBufferRange;
+
+extern "C" {
+
+void GLAPIENTRY glGetIntegerv(GLenum Name, GLint* pParam)
+{
+    CHECK(Name == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT);
+    *pParam = 256;
+}
+
+}
+
+
+int IsGLVersionHigher(int, int)
+{
+    return IsPersistentAvailable;
+}
+
+
+void OgldevError(const char* pFileName, uint line, const char* msg, ... )
+{
+    printf("%s:%d: unexpected error: %s", pFileName, line, msg);
+    NumErrors++;
+}
+
+
+//
+// Instance matrices
+//
+static float RandomFloat(float Min, float Max)
+{
+    return Min + (Max - Min) * ((float)rand() / (float)RAND_MAX);
+}
+
+
+static void FillMatrix(Matrix4f& m, float Value)
+{
+    for (int i = 0 ; i < 4 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            m.m[i][j] = Value;
+        }
+    }
+}
+
+
+static bool IsEqual(const Matrix4f& a, const Matrix4f& b)
+{
+    for (int i = 0 ; i < 4 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            float Tolerance = EPSILON * fmaxf(1.0f, fabsf(b.m[i][j]));
+
+            if (fabsf(a.m[i][j] - b.m[i][j]) > Tolerance) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+static void TestPacking(int NumInstances)
+{
+    std::vector<WorldTrans> Transforms(NumInstances);
+
+    for (int i = 0 ; i < NumInstances ; i++) {
+        Transforms[i].SetScale(RandomFloat(0.5f, 2.0f));
+        Transforms[i].SetRotation(RandomFloat(-180.0f, 180.0f), RandomFloat(-180.0f, 180.0f), RandomFloat(-180.0f, 180.0f));
+        Transforms[i].SetPosition(RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f));
+    }
+
+    PersProjInfo PersProj = { 45.0f, 1920.0f, 1080.0f, 0.1f, 1000.0f };
+    Matrix4f Projection;
+    Projection.InitPersProjTransform(PersProj);
+
+    Matrix4f View;
+    View.InitCameraTransform(Vector3f(10.0f, 20.0f, -30.0f), Vector3f(0.0f, 0.0f, 1.0f), Vector3f(0.0f, 1.0f, 0.0f));
+
+    Matrix4f VP = Projection.MulReference(View);
+
+    // One guard matrix on each side catches writes out of the range
+    Matrix4f Guard;
+    FillMatrix(Guard, -12345.0f);
+    std::vector<Matrix4f> Packed(2 * NumInstances + 2, Guard);
+
+    PackInstanceMatrices(VP, Transforms.data(), NumInstances, &Packed[1]);
+
+    CHECK(memcmp(&Packed[0], &Guard, sizeof(Matrix4f)) == 0);
+    CHECK(memcmp(&Packed[2 * NumInstances + 1], &Guard, sizeof(Matrix4f)) == 0);
+
+    int NumMismatches = 0;
+
+    for (int i = 0 ; i < NumInstances ; i++) {
+        Matrix4f World = Transforms[i].GetMatrix();
+        Matrix4f WVP = VP.MulReference(World);
+        Matrix4f WorldT = World.Transpose();
+
+        // The transpose only moves the values so the world matrix is exact
+        if (!IsEqual(Packed[1 + 2 * i], WVP.Transpose()) ||
+            (memcmp(&Packed[2 + 2 * i], &WorldT, sizeof(Matrix4f)) != 0)) {
+            NumMismatches++;
+        }
+    }
+
+    CHECK(NumMismatches == 0);
+
+    // RenderInstanced packs the instances in chunks from several threads
+    if (NumInstances > 1) {
+        std::vector<Matrix4f> Chunked(2 * NumInstances);
+        int Split = NumInstances / 3;
+
+        PackInstanceMatrices(VP, Transforms.data(), Split, &Chunked[0]);
+        PackInstanceMatrices(VP, Transforms.data() + Split, NumInstances - Split, &Chunked[2 * Split]);
+
+        CHECK(memcmp(&Chunked[0], &Packed[1], Chunked.size() * sizeof(Matrix4f)) == 0);
+    }
+
+    printf("Packed %d instances\n", NumInstances);
+}
+
+
+//
+// Streaming buffer
+//
+static void TestPersistentRing()
+{
+    Driver = FakeDriver();
+    IsPersistentAvailable = true;
+
+    int NumRegions = 3;
+    int NumFrames = 8;
+
+    {
+        StreamingBuffer Buf;
+        Buf.Init(1000, NumRegions);
+
+        CHECK(Driver.LiveBuffers.size() == 1);
+        CHECK(Driver.Storage.size() == 1024 * NumRegions);   // aligned to 256
+
+        const char* pBase = &Driver.Storage[0];
+
+        for (int Frame = 0 ; Frame < NumFrames ; Frame++) {
+            // Every frame takes the next region, starting with the second one
+            int Region = (Frame + 1) % NumRegions;
+
+            char* p = (char*)Buf.Map(1000);
+            CHECK(p == pBase + Region * 1024);
+            memset(p, Frame, 1000);
+
+            GLintptr Offset = Buf.Unmap();
+            CHECK(Offset == Region * 1024);
+            CHECK(Offset % 256 == 0);
+
+            Buf.Fence();
+
+            // The region of frame N is reused by frame N + NumRegions which
+            // must first wait on the fence of frame N, and only on that one
+            int NumWaited = std::max(0, Frame + 1 - NumRegions);
+            CHECK((int)Driver.WaitedFences.size() == NumWaited);
+
+            if (NumWaited > 0) {
+                CHECK(Driver.WaitedFences.back() == Driver.CreatedFences[Frame - NumRegions]);
+            }
+
+            // Only the regions in flight have a fence
+            CHECK((int)Driver.LiveFences.size() == std::min(Frame + 1, NumRegions));
+        }
+
+        CHECK(Driver.NumSubData == 0);
+
+        // The data of the last frames are still in their regions
+        for (int Frame = NumFrames - NumRegions ; Frame < NumFrames ; Frame++) {
+            int Region = (Frame + 1) % NumRegions;
+            CHECK(pBase[Region * 1024] == Frame);
+            CHECK(pBase[Region * 1024 + 999] == Frame);
+        }
+
+        // Growing waits for everything in flight and starts a new buffer
+        char* p = (char*)Buf.Map(5000);
+        CHECK(Driver.LiveFences.empty());
+        CHECK(Driver.LiveBuffers.size() == 1);
+        CHECK(Driver.Storage.size() == 10240 * NumRegions);
+        CHECK(p == &Driver.Storage[10240]);
+        CHECK(Buf.Unmap() == 10240);
+        Buf.Fence();
+    }
+
+    // The destructor waits for the last fence and frees the buffer
+    CHECK(Driver.LiveFences.empty());
+    CHECK(Driver.LiveBuffers.empty());
+}
+
+
+static void TestSubDataRing()
+{
+    Driver = FakeDriver();
+    IsPersistentAvailable = false;
+
+    int NumRegions = 3;
+
+    {
+        StreamingBuffer Buf;
+        Buf.Init(512, NumRegions);
+
+        for (int Frame = 0 ; Frame < 5 ; Frame++) {
+            int Region = (Frame + 1) % NumRegions;
+
+            char* p = (char*)Buf.Map(300);
+            memset(p, Frame + 1, 300);
+
+            GLintptr Offset = Buf.Unmap();
+            CHECK(Offset == Region * 512);
+            CHECK(Driver.NumSubData == Frame + 1);
+            CHECK(Driver.Storage[Offset] == Frame + 1);
+            CHECK(Driver.Storage[Offset + 299] == Frame + 1);
+            CHECK(Driver.Storage[Offset + 300] == 0);   // only the mapped size is uploaded
+
+            // No fences without persistent mapping
+            Buf.Fence();
+            CHECK(Driver.CreatedFences.empty());
+        }
+    }
+
+    CHECK(Driver.LiveBuffers.empty());
+}
+
+
+//
+// Per-draw uniforms
+//
+struct DrawData {
+    Matrix4f WVP;
+    Matrix4f World;
+};
+
+
+static DrawData MakeDrawData(int Draw)
+{
+    DrawData Data;
+    FillMatrix(Data.WVP, (float)(Draw + 1));
+    FillMatrix(Data.World, (float)-(Draw + 1));
+    return Data;
+}
+
+
+static bool IsSlot(GLintptr Offset, int Draw)
+{
+    DrawData Expected = MakeDrawData(Draw);
+    return memcmp(&Driver.Storage[Offset], &Expected, sizeof(DrawData)) == 0;
+}
+
+
+static void TestUniformDrawBuffer(bool IsPersistent)
+{
+    Driver = FakeDriver();
+    IsPersistentAvailable = IsPersistent;
+
+    {
+        // The shader does not match the struct
+        UniformDrawBuffer Buf;
+        CHECK(!Buf.Init(1, "DrawBlock", 4, sizeof(DrawData)));
+        Driver.UniformBlockSize = sizeof(DrawData) + 16;
+        CHECK(!Buf.Init(1, "DrawBlock", 4, sizeof(DrawData)));
+    }
+
+    Driver.UniformBlockSize = sizeof(DrawData);
+
+    {
+        UniformDrawBuffer Buf;
+        CHECK(Buf.Init(1, "DrawBlock", 4, sizeof(DrawData)));
+        CHECK(Driver.UniformBlockBinding == 4);
+
+        // The draws of a pass are consecutive slots of one region
+        int Draw = 0;
+        Buf.BeginDraws(3);
+
+        for ( ; Draw < 3 ; Draw++) {
+            DrawData Data = MakeDrawData(Draw);
+            Buf.CommitDraw(&Data);
+        }
+
+        CHECK(Driver.BoundOffsets.size() == 3);
+        CHECK(Driver.BoundSize == sizeof(DrawData));
+
+        for (int i = 0 ; i < 3 ; i++) {
+            CHECK(Driver.BoundOffsets[i] == Driver.BoundOffsets[0] + i * 256);   // aligned slots
+            CHECK(IsSlot(Driver.BoundOffsets[i], i));
+        }
+
+        // One more than BeginDraws() was told about - continues in the next region
+        DrawData Data = MakeDrawData(Draw++);
+        Buf.CommitDraw(&Data);
+        CHECK(Driver.BoundOffsets[3] % 256 == 0);
+        CHECK((Driver.BoundOffsets[3] < Driver.BoundOffsets[0]) || (Driver.BoundOffsets[3] > Driver.BoundOffsets[2]));
+        CHECK(IsSlot(Driver.BoundOffsets[3], 3));
+        CHECK(IsSlot(Driver.BoundOffsets[2], 2));       // the full region is left alone
+        CHECK((int)Driver.CreatedFences.size() == (IsPersistent ? 1 : 0));
+
+        Buf.EndDraws();
+        CHECK((int)Driver.CreatedFences.size() == (IsPersistent ? 2 : 0));
+
+        // Without BeginDraws() the draws still get their own slots
+        for (int i = 0 ; i < 10 ; i++, Draw++) {
+            Data = MakeDrawData(Draw);
+            Buf.CommitDraw(&Data);
+        }
+
+        CHECK(Driver.BoundOffsets.size() == 14);
+
+        for (int i = 4 ; i < 14 ; i++) {
+            CHECK(Driver.BoundOffsets[i] == Driver.BoundOffsets[4] + (i - 4) * 256);
+            CHECK(IsSlot(Driver.BoundOffsets[i], i));
+        }
+
+        // Only the draw itself is uploaded, not the whole slot or region
+        CHECK(Driver.NumSubData == (IsPersistent ? 0 : 14));
+
+        Buf.EndDraws();
+    }
+
+    CHECK(Driver.LiveFences.empty());
+    CHECK(Driver.LiveBuffers.empty());
+
+    printf("Per-draw uniform slots with %s\n", IsPersistent ? "persistent mapping" : "glBufferSubData");
+}
+
+
+int main(int argc, char* argv[])
+{
+    srand(1234);
+
+    TestPacking(0);
+    TestPacking(1);
+    TestPacking(64);
+    TestPacking(1000);
+    TestPersistentRing();
+    TestSubDataRing();
+    TestUniformDrawBuffer(true);
+    TestUniformDrawBuffer(false);
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
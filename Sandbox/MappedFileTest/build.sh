@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include"
+
+$CC mapped_file_test.cpp ../../Common/ogldev_mapped_file.cpp $CPPFLAGS -o mapped_file_test
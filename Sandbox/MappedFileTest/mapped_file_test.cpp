@@ -0,0 +1,131 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Tests MappedFile on regular, empty and missing files. No GL is needed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "ogldev_mapped_file.h"
+
+#define TEST_FILENAME  "mapped_file_test.bin"
+#define EMPTY_FILENAME "mapped_file_test_empty.bin"
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+static void WriteTestFile(const char* pFilename, const std::vector<unsigned char>& Data)
+{
+    FILE* f = fopen(pFilename, "wb");
+
+    if (!f) {
+        printf("Cannot create '%s'\n", pFilename);
+        exit(1);
+    }
+
+    if (!Data.empty()) {
+        fwrite(Data.data(), 1, Data.size(), f);
+    }
+
+    fclose(f);
+}
+
+
+static void TestRegularFile()
+{
+    // Not a multiple of the page size so the tail of the last page is exercised
+    std::vector<unsigned char> Data(3 * 4096 + 123);
+
+    for (size_t i = 0 ; i < Data.size() ; i++) {
+        Data[i] = (unsigned char)(i * 31 + 7);
+    }
+
+    WriteTestFile(TEST_FILENAME, Data);
+
+    MappedFile File;
+    CHECK(!File.IsOpen());
+    CHECK(File.Open(TEST_FILENAME));
+    CHECK(File.IsOpen());
+    CHECK(File.GetSize() == Data.size());
+    CHECK(File.GetData() != NULL);
+    CHECK(memcmp(File.GetData(), Data.data(), Data.size()) == 0);
+
+    // Reopening releases the previous mapping
+    CHECK(File.Open(TEST_FILENAME, MAPPED_FILE_ACCESS_RANDOM));
+    CHECK(File.GetSize() == Data.size());
+    CHECK(memcmp(File.GetData(), Data.data(), Data.size()) == 0);
+
+    File.Close();
+    CHECK(!File.IsOpen());
+    CHECK(File.GetData() == NULL);
+    CHECK(File.GetSize() == 0);
+
+    remove(TEST_FILENAME);
+}
+
+
+static void TestEmptyFile()
+{
+    WriteTestFile(EMPTY_FILENAME, std::vector<unsigned char>());
+
+    MappedFile File;
+    CHECK(File.Open(EMPTY_FILENAME));
+    CHECK(File.IsOpen());
+    CHECK(File.GetSize() == 0);
+    CHECK(File.GetData() == NULL);
+
+    File.Close();
+    remove(EMPTY_FILENAME);
+}
+
+
+static void TestMissingFile()
+{
+    MappedFile File;
+    CHECK(!File.Open("this_file_does_not_exist.bin"));
+    CHECK(!File.IsOpen());
+    CHECK(File.GetData() == NULL);
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestRegularFile();
+    TestEmptyFile();
+    TestMissingFile();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include -I../../Include/assimp5"
+
+$CC math_simd_test.cpp ../../Common/math_3d.cpp ../../Common/ogldev_world_transform.cpp $CPPFLAGS -o math_simd_test
@@ -0,0 +1,247 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Checks every math backend supported by the CPU against the scalar reference
+// and prints the time each one takes on the same workload.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "ogldev_math_3d.h"
+#include "ogldev_world_transform.h"
+
+#define NUM_MATRICES 4096
+#define NUM_ITERATIONS 200
+#define EPSILON 1e-3f
+
+static int NumErrors = 0;
+
+
+static float RandomFloat(float Min, float Max)
+{
+    return Min + (Max - Min) * ((float)rand() / (float)RAND_MAX);
+}
+
+
+static Matrix4f RandomWorldMatrix()
+{
+    WorldTrans t;
+    t.SetScale(RandomFloat(0.5f, 2.0f));
+    t.SetRotation(RandomFloat(-180.0f, 180.0f), RandomFloat(-180.0f, 180.0f), RandomFloat(-180.0f, 180.0f));
+    t.SetPosition(RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f));
+    return t.GetMatrix();
+}
+
+
+static Matrix4f RandomMatrix()
+{
+    Matrix4f m;
+
+    for (int i = 0 ; i < 4 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            m.m[i][j] = RandomFloat(-1.0f, 1.0f);
+        }
+    }
+
+    // Diagonally dominant so it is always invertible
+    for (int i = 0 ; i < 4 ; i++) {
+        m.m[i][i] += 5.0f;
+    }
+
+    return m;
+}
+
+
+static bool IsEqual(const Matrix4f& a, const Matrix4f& b)
+{
+    for (int i = 0 ; i < 4 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            float Tolerance = EPSILON * fmaxf(1.0f, fabsf(b.m[i][j]));
+            if (fabsf(a.m[i][j] - b.m[i][j]) > Tolerance) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+static bool IsEqual(const Vector4f& a, const Vector4f& b)
+{
+    const float* pa = &a.x;
+    const float* pb = &b.x;
+
+    for (int i = 0 ; i < 4 ; i++) {
+        float Tolerance = EPSILON * fmaxf(1.0f, fabsf(pb[i]));
+        if (fabsf(pa[i] - pb[i]) > Tolerance) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static void Check(bool Cond, const char* pBackend, const char* pTest, int Index)
+{
+    if (!Cond) {
+        printf("FAILED: %s %s (element %d)\n", pBackend, pTest, Index);
+        NumErrors++;
+    }
+}
+
+
+static void TestBackend(MATH_BACKEND Backend, const std::vector<Matrix4f>& Matrices,
+                        const std::vector<Matrix4f>& WorldMatrices, const std::vector<Vector4f>& Vectors)
+{
+    SetMathBackend(Backend);
+
+    const char* pName = GetMathBackendName(Backend);
+
+    for (int i = 0 ; i < NUM_MATRICES ; i++) {
+        const Matrix4f& a = Matrices[i];
+        const Matrix4f& b = Matrices[(i + 1) % NUM_MATRICES];
+
+        Check(IsEqual(a * b, a.MulReference(b)), pName, "Matrix4f * Matrix4f", i);
+        Check(IsEqual(a * Vectors[i], a.MulReference(Vectors[i])), pName, "Matrix4f * Vector4f", i);
+        Check(IsEqual(a.Inverse(), a.InverseReference()), pName, "Inverse", i);
+        Check(IsEqual(WorldMatrices[i].InverseAffine(), WorldMatrices[i].InverseReference()), pName, "InverseAffine", i);
+    }
+
+    std::vector<Matrix4f> Batch(NUM_MATRICES);
+    MatrixMulBatch(Matrices[0], Matrices.data(), Batch.data(), NUM_MATRICES);
+
+    for (int i = 0 ; i < NUM_MATRICES ; i++) {
+        Check(IsEqual(Batch[i], Matrices[0].MulReference(Matrices[i])), pName, "MatrixMulBatch", i);
+    }
+
+    // Odd count to exercise the tail of the wide kernels
+    std::vector<Vector4f> Transformed(NUM_MATRICES - 1);
+    TransformVectors(Matrices[1], Vectors.data(), Transformed.data(), NUM_MATRICES - 1);
+
+    for (int i = 0 ; i < NUM_MATRICES - 1 ; i++) {
+        Check(IsEqual(Transformed[i], Matrices[1].MulReference(Vectors[i])), pName, "TransformVectors", i);
+    }
+}
+
+
+static double TimeMs(std::chrono::high_resolution_clock::time_point Start)
+{
+    std::chrono::duration<double, std::milli> d = std::chrono::high_resolution_clock::now() - Start;
+    return d.count();
+}
+
+
+static void BenchmarkBackend(MATH_BACKEND Backend, const std::vector<Matrix4f>& Matrices, const std::vector<Vector4f>& Vectors)
+{
+    SetMathBackend(Backend);
+
+    std::vector<Matrix4f> OutMatrices(NUM_MATRICES);
+    std::vector<Vector4f> OutVectors(NUM_MATRICES);
+
+    float Sum = 0.0f;   // keeps the compiler from dropping the loops
+
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0 ; i < NUM_ITERATIONS ; i++) {
+        MatrixMulBatch(Matrices[i], Matrices.data(), OutMatrices.data(), NUM_MATRICES);
+        Sum += OutMatrices[i].m[0][0];
+    }
+
+    double BatchTime = TimeMs(Start);
+
+    Start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0 ; i < NUM_ITERATIONS ; i++) {
+        TransformVectors(Matrices[i], Vectors.data(), OutVectors.data(), NUM_MATRICES);
+        Sum += OutVectors[i].x;
+    }
+
+    double TransformTime = TimeMs(Start);
+
+    printf("%-8s MatrixMulBatch %8.2fms  TransformVectors %8.2fms  ",
+           GetMathBackendName(Backend), BatchTime, TransformTime);
+
+    // Only timed for the backends that have their own kernel
+    MATH_BACKEND InverseBackend = GetInverseBackend(Backend);
+
+    if (InverseBackend != Backend) {
+        printf("Inverse uses the %s kernel  (%f)\n", GetMathBackendName(InverseBackend), Sum);
+        return;
+    }
+
+    Start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0 ; i < NUM_ITERATIONS ; i++) {
+        for (int j = 0 ; j < NUM_MATRICES ; j++) {
+            OutMatrices[j] = Matrices[j].Inverse();
+        }
+        Sum += OutMatrices[i].m[0][0];
+    }
+
+    double InverseTime = TimeMs(Start);
+
+    printf("Inverse %8.2fms  (%f)\n", InverseTime, Sum);
+}
+
+
+int main(int argc, char* argv[])
+{
+    srand(0);
+
+    std::vector<Matrix4f> Matrices(NUM_MATRICES);
+    std::vector<Matrix4f> WorldMatrices(NUM_MATRICES);
+    std::vector<Vector4f> Vectors(NUM_MATRICES);
+
+    for (int i = 0 ; i < NUM_MATRICES ; i++) {
+        Matrices[i] = RandomMatrix();
+        WorldMatrices[i] = RandomWorldMatrix();
+        Vectors[i] = Vector4f(RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), 1.0f);
+    }
+
+    MATH_BACKEND DefaultBackend = GetMathBackend();
+
+    printf("Default backend: %s\n", GetMathBackendName(DefaultBackend));
+
+    MATH_BACKEND Backends[] = { MATH_BACKEND_SCALAR, MATH_BACKEND_SSE, MATH_BACKEND_AVX, MATH_BACKEND_NEON };
+
+    for (MATH_BACKEND Backend : Backends) {
+        if (IsMathBackendSupported(Backend)) {
+            TestBackend(Backend, Matrices, WorldMatrices, Vectors);
+            BenchmarkBackend(Backend, Matrices, Vectors);
+        }
+    }
+
+    SetMathBackend(DefaultBackend);
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
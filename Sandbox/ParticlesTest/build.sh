@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include -I../../Include/assimp5"
+
+$CC particles_test.cpp ../../Common/ogldev_cpu_particles.cpp ../../Common/math_3d.cpp $CPPFLAGS -lpthread -o particles_test
@@ -0,0 +1,230 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Tests CPUParticleSystem - the CPU reference of the compute shader particles.
+// No GL is needed.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#include "ogldev_cpu_particles.h"
+
+#define FRAME_TIME (1.0f / 60.0f)
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+static bool IsSameState(const CPUParticleSystem& a, const CPUParticleSystem& b)
+{
+    if ((a.GetNumAlive() != b.GetNumAlive()) || (a.GetNumEmitted() != b.GetNumEmitted())) {
+        return false;
+    }
+
+    for (int i = 0 ; i < a.GetMaxParticles() ; i++) {
+        Vector3f PosA = a.GetPos(i), PosB = b.GetPos(i);
+        Vector3f VelA = a.GetVel(i), VelB = b.GetVel(i);
+
+        if ((memcmp(&PosA, &PosB, sizeof(PosA)) != 0) ||
+            (memcmp(&VelA, &VelB, sizeof(VelA)) != 0) ||
+            (a.GetAge(i) != b.GetAge(i)) ||
+            (a.GetLifetime(i) != b.GetLifetime(i))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static void TestDeterminism()
+{
+    ParticleEmitterDesc Emitter;
+    Emitter.EmitRate = 60000.0f;
+    Emitter.Drag = 0.3f;
+    Emitter.MinLifetime = 0.5f;
+    Emitter.MaxLifetime = 1.0f;
+
+    // Not a multiple of 4 so that the scalar tail is used
+    const int MaxParticles = 100003;
+
+    CPUParticleSystem Single, Multi;
+    Single.Init(MaxParticles, Emitter);
+    Single.SetNumThreads(1);
+    Multi.Init(MaxParticles, Emitter);
+    Multi.SetNumThreads(5);
+
+    for (int i = 0 ; i < 120 ; i++) {
+        Single.Update(FRAME_TIME);
+        Multi.Update(FRAME_TIME);
+    }
+
+    CHECK(Single.GetNumAlive() > 0);
+    CHECK(IsSameState(Single, Multi));
+}
+
+
+static void TestSteadyState()
+{
+    ParticleEmitterDesc Emitter;
+    Emitter.EmitRate = 1000.0f;
+    Emitter.MinLifetime = 1.0f;
+    Emitter.MaxLifetime = 2.0f;
+
+    CPUParticleSystem ps;
+    ps.Init(10000, Emitter);
+
+    for (int i = 0 ; i < 300 ; i++) {
+        ps.Update(FRAME_TIME);
+    }
+
+    // Little's law - rate * mean lifetime
+    int Expected = 1500;
+    CHECK(abs(ps.GetNumAlive() - Expected) < Expected / 10);
+
+    // The clock carries the fraction so nothing is lost over 5 seconds
+    CHECK(abs((int)ps.GetNumEmitted() - 5000) <= 1);
+
+    int NumAlive = 0;
+
+    for (int i = 0 ; i < ps.GetMaxParticles() ; i++) {
+        if (ps.IsAlive(i)) {
+            NumAlive++;
+            CHECK(ps.GetAge(i) < ps.GetLifetime(i));
+            CHECK((ps.GetLifetime(i) >= 1.0f) && (ps.GetLifetime(i) < 2.0f));
+        }
+    }
+
+    CHECK(NumAlive == ps.GetNumAlive());
+}
+
+
+static void TestCapacity()
+{
+    ParticleEmitterDesc Emitter;
+    Emitter.EmitRate = 100000.0f;
+    Emitter.MinLifetime = 10.0f;
+    Emitter.MaxLifetime = 10.0f;
+
+    CPUParticleSystem ps;
+    ps.Init(100, Emitter);
+
+    for (int i = 0 ; i < 10 ; i++) {
+        ps.Update(FRAME_TIME);
+        CHECK(ps.GetNumAlive() <= 100);
+    }
+
+    CHECK(ps.GetNumAlive() == 100);
+    CHECK(ps.GetNumEmitted() > 100);
+}
+
+
+static void TestMotion()
+{
+    ParticleEmitterDesc Emitter;
+    Emitter.Pos = Vector3f(1.0f, 2.0f, 3.0f);
+    Emitter.EmitRate = 60.0f;       // one per frame
+    Emitter.Velocity = Vector3f(1.0f, 0.0f, 0.0f);
+    Emitter.VelocitySpread = 0.0f;
+    Emitter.Gravity = Vector3f(0.0f, 0.0f, 0.0f);
+    Emitter.MinLifetime = 100.0f;
+    Emitter.MaxLifetime = 100.0f;
+
+    CPUParticleSystem ps;
+    ps.Init(1000, Emitter);
+
+    for (int i = 0 ; i < 61 ; i++) {
+        ps.Update(FRAME_TIME);
+    }
+
+    // The first particle was emitted at the end of the first frame and has moved for 60 frames
+    CHECK(ps.GetNumAlive() == 61);
+    CHECK(fabsf(ps.GetAge(0) - 1.0f) < 1e-4f);
+    CHECK(fabsf(ps.GetPos(0).x - 2.0f) < 1e-4f);
+    CHECK(ps.GetPos(0).y == 2.0f);
+    CHECK(ps.GetPos(0).z == 3.0f);
+
+    Vector3f Min, Max;
+    CHECK(ps.CalcBounds(Min, Max));
+    CHECK(Min.x == 1.0f);
+    CHECK(fabsf(Max.x - 2.0f) < 1e-4f);
+
+    CPUParticleSystem Empty;
+    Empty.Init(16, Emitter);
+    CHECK(!Empty.CalcBounds(Min, Max));
+}
+
+
+static void TestPerformance()
+{
+    ParticleEmitterDesc Emitter;
+    Emitter.EmitRate = 1000000.0f;
+    Emitter.Drag = 0.1f;
+    Emitter.MinLifetime = 2.0f;
+    Emitter.MaxLifetime = 3.0f;
+
+    const int MaxParticles = 1000000;
+    const int NumFrames = 300;
+
+    for (int NumThreads = 1 ; NumThreads >= 0 ; NumThreads--) {
+        CPUParticleSystem ps;
+        ps.Init(MaxParticles, Emitter);
+        ps.SetNumThreads(NumThreads);
+
+        auto Start = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0 ; i < NumFrames ; i++) {
+            ps.Update(FRAME_TIME);
+        }
+
+        auto End = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(End - Start).count();
+
+        printf("%d particles, %s: %.3f ms per frame (%d alive)\n",
+               MaxParticles, NumThreads == 1 ? "1 thread" : "all threads", ms / NumFrames, ps.GetNumAlive());
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestDeterminism();
+    TestSteadyState();
+    TestCapacity();
+    TestMotion();
+    TestPerformance();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
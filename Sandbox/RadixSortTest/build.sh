@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include"
+
+$CC radix_sort_test.cpp $CPPFLAGS -lpthread -o radix_sort_test
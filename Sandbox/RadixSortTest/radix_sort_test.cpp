@@ -0,0 +1,136 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Tests ParallelRadixSort against std::stable_sort. No GL is needed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+#include "ogldev_radix_sort.h"
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+static void TestFloatKeys()
+{
+    float Values[] = { -1000.0f, -2.5f, -1.0f, -0.0f, 0.0f, 1e-20f, 0.5f, 1.0f, 3.0f, 1e20f };
+    int Count = sizeof(Values) / sizeof(Values[0]);
+
+    for (int i = 0 ; i < Count - 1 ; i++) {
+        CHECK(FloatToSortableKey(Values[i]) <= FloatToSortableKey(Values[i + 1]));
+    }
+
+    CHECK(FloatToSortableKey(-1.0f) < FloatToSortableKey(1.0f));
+}
+
+
+static void TestSort(int Count, int NumThreads)
+{
+    std::vector<u32> Keys(Count), Values(Count);
+
+    srand(Count);
+
+    for (int i = 0 ; i < Count ; i++) {
+        // Few distinct values so that stability matters
+        Keys[i] = ((u32)rand() * 2654435761u) & 0xff00ff0f;
+        Values[i] = i;
+    }
+
+    std::vector<std::pair<u32, u32>> Expected(Count);
+
+    for (int i = 0 ; i < Count ; i++) {
+        Expected[i] = std::make_pair(Keys[i], Values[i]);
+    }
+
+    std::stable_sort(Expected.begin(), Expected.end(),
+                     [](const std::pair<u32, u32>& a, const std::pair<u32, u32>& b) { return a.first < b.first; });
+
+    JobSystem Jobs(NumThreads);
+    std::vector<u32> TempKeys, TempValues;
+    ParallelRadixSort(Jobs, Keys, Values, TempKeys, TempValues);
+
+    bool Same = true;
+
+    for (int i = 0 ; i < Count ; i++) {
+        if ((Keys[i] != Expected[i].first) || (Values[i] != Expected[i].second)) {
+            Same = false;
+            break;
+        }
+    }
+
+    CHECK(Same);
+}
+
+
+static void TestPerformance()
+{
+    const int Count = 1000000;
+
+    std::vector<u32> Keys(Count), Values(Count), TempKeys, TempValues;
+
+    for (int i = 0 ; i < Count ; i++) {
+        Keys[i] = (u32)i * 2654435761u;
+        Values[i] = i;
+    }
+
+    JobSystem Jobs;
+
+    auto Start = std::chrono::high_resolution_clock::now();
+    ParallelRadixSort(Jobs, Keys, Values, TempKeys, TempValues);
+    auto End = std::chrono::high_resolution_clock::now();
+
+    printf("Sorted %d keys on %d threads in %.3f ms\n", Count, Jobs.GetNumThreads(),
+           std::chrono::duration<double, std::milli>(End - Start).count());
+
+    CHECK(std::is_sorted(Keys.begin(), Keys.end()));
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestFloatKeys();
+
+    int Counts[] = { 0, 1, 2, 100, 8191, 100000, 250001 };
+
+    for (int Count : Counts) {
+        TestSort(Count, 1);
+        TestSort(Count, 4);
+    }
+
+    TestPerformance();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -pthread -I../../DemoLITION/Framework/Include -I../../Include -I../../Include/assimp5"
+
+$CC scene_graph_test.cpp ../../DemoLITION/Framework/Source/core_scene.cpp ../../Common/ogldev_basic_glfw_camera.cpp ../../Common/math_3d.cpp $CPPFLAGS -o scene_graph_test
@@ -0,0 +1,267 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//
+// Checks the world transforms of the DemoLITION scene graph against the
+// product of the local matrices, that UpdateTransforms skips the subtrees
+// that did not move, reparenting and the rejection of cycles. Runs on a
+// scene without a rendering system.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "Int/core_scene.h"
+
+#define EPSILON 1e-4f
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+static float RandomFloat(float Min, float Max)
+{
+    return Min + (Max - Min) * ((float)rand() / (float)RAND_MAX);
+}
+
+
+static void SetRandomTransform(SceneObject* pObject)
+{
+    pObject->SetPosition(RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f));
+    pObject->SetRotation(RandomFloat(-180.0f, 180.0f), RandomFloat(-180.0f, 180.0f), RandomFloat(-180.0f, 180.0f));
+    pObject->SetScale(RandomFloat(0.5f, 2.0f), RandomFloat(0.5f, 2.0f), RandomFloat(0.5f, 2.0f));
+}
+
+
+// Translation * Rotation * Scale with the scalar code
+static Matrix4f LocalMatrix(const SceneObject* pObject)
+{
+    Matrix4f Scale;
+    Scale.InitScaleTransform(pObject->GetScale());
+
+    Matrix4f Rotation;
+    Rotation.InitRotateTransform(pObject->GetRotation());
+
+    Matrix4f Translation;
+    Translation.InitTranslationTransform(pObject->GetPosition());
+
+    return Translation.MulReference(Rotation.MulReference(Scale));
+}
+
+
+static bool IsEqual(const Matrix4f& a, const Matrix4f& b)
+{
+    for (int i = 0 ; i < 4 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            float Tolerance = EPSILON * fmaxf(1.0f, fabsf(b.m[i][j]));
+
+            if (fabsf(a.m[i][j] - b.m[i][j]) > Tolerance) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+static SceneObject* CreateObject(CoreScene& Scene)
+{
+    SceneObject* pObject = Scene.CreateSceneObject((Model*)NULL);
+    SetRandomTransform(pObject);
+    return pObject;
+}
+
+
+static void TestHierarchy()
+{
+    CoreScene Scene(NULL);
+
+    //   Root
+    //   +-- A
+    //   |   +-- Leaf
+    //   +-- B
+    //
+    //   Other
+    SceneObject* pRoot = CreateObject(Scene);
+    SceneObject* pA = CreateObject(Scene);
+    SceneObject* pB = CreateObject(Scene);
+    SceneObject* pLeaf = CreateObject(Scene);
+    SceneObject* pOther = CreateObject(Scene);
+
+    CHECK(Scene.SetParent(pLeaf, pA));      // before its parent is attached
+    CHECK(Scene.SetParent(pA, pRoot));
+    CHECK(Scene.SetParent(pB, pRoot));
+
+    Scene.UpdateTransforms();
+    CHECK(Scene.GetNumUpdatedNodes() == 5);
+
+    Matrix4f RootWorld = LocalMatrix(pRoot);
+    Matrix4f AWorld = RootWorld.MulReference(LocalMatrix(pA));
+
+    CHECK(IsEqual(pRoot->GetMatrix(), RootWorld));
+    CHECK(IsEqual(pA->GetMatrix(), AWorld));
+    CHECK(IsEqual(pB->GetMatrix(), RootWorld.MulReference(LocalMatrix(pB))));
+    CHECK(IsEqual(pLeaf->GetMatrix(), AWorld.MulReference(LocalMatrix(pLeaf))));
+    CHECK(IsEqual(pOther->GetMatrix(), LocalMatrix(pOther)));
+
+    // The normal matrix follows the world matrix
+    Matrix3f Normal = Matrix3f(AWorld.Inverse()).Transpose();
+
+    for (int i = 0 ; i < 3 ; i++) {
+        for (int j = 0 ; j < 3 ; j++) {
+            CHECK(fabsf(pA->GetNormalMatrix().m[i][j] - Normal.m[i][j]) < EPSILON * fmaxf(1.0f, fabsf(Normal.m[i][j])));
+        }
+    }
+
+    // Nothing moved
+    Scene.UpdateTransforms();
+    CHECK(Scene.GetNumUpdatedNodes() == 0);
+
+    // Only the subtree of what moved is updated
+    SetRandomTransform(pA);
+    Scene.UpdateTransforms();
+    CHECK(Scene.GetNumUpdatedNodes() == 2);
+    AWorld = RootWorld.MulReference(LocalMatrix(pA));
+    CHECK(IsEqual(pLeaf->GetMatrix(), AWorld.MulReference(LocalMatrix(pLeaf))));
+
+    SetRandomTransform(pRoot);
+    Scene.UpdateTransforms();
+    CHECK(Scene.GetNumUpdatedNodes() == 4);
+    RootWorld = LocalMatrix(pRoot);
+    AWorld = RootWorld.MulReference(LocalMatrix(pA));
+    CHECK(IsEqual(pB->GetMatrix(), RootWorld.MulReference(LocalMatrix(pB))));
+    CHECK(IsEqual(pLeaf->GetMatrix(), AWorld.MulReference(LocalMatrix(pLeaf))));
+
+    SetRandomTransform(pOther);
+    Scene.UpdateTransforms();
+    CHECK(Scene.GetNumUpdatedNodes() == 1);
+    CHECK(IsEqual(pOther->GetMatrix(), LocalMatrix(pOther)));
+
+    // Reparenting moves the whole subtree
+    CHECK(Scene.SetParent(pA, pOther));
+    Scene.UpdateTransforms();
+    Matrix4f OtherWorld = LocalMatrix(pOther);
+    AWorld = OtherWorld.MulReference(LocalMatrix(pA));
+    CHECK(IsEqual(pA->GetMatrix(), AWorld));
+    CHECK(IsEqual(pLeaf->GetMatrix(), AWorld.MulReference(LocalMatrix(pLeaf))));
+    CHECK(IsEqual(pB->GetMatrix(), RootWorld.MulReference(LocalMatrix(pB))));
+
+    SetRandomTransform(pRoot);
+    Scene.UpdateTransforms();
+    CHECK(Scene.GetNumUpdatedNodes() == 2);     // Root and B
+
+    // A detached object is a root again - even before the next update
+    CHECK(Scene.SetParent(pLeaf, NULL));
+    CHECK(IsEqual(pLeaf->GetMatrix(), LocalMatrix(pLeaf)));
+    Scene.UpdateTransforms();
+    CHECK(IsEqual(pLeaf->GetMatrix(), LocalMatrix(pLeaf)));
+
+    // Cycles are rejected and the graph stays as it is
+    CHECK(!Scene.SetParent(pOther, pOther));
+    CHECK(!Scene.SetParent(pOther, pA));
+    CHECK(Scene.SetParent(pLeaf, pA));
+    CHECK(!Scene.SetParent(pOther, pLeaf));
+
+    Scene.UpdateTransforms();
+    OtherWorld = LocalMatrix(pOther);
+    AWorld = OtherWorld.MulReference(LocalMatrix(pA));
+    CHECK(IsEqual(pOther->GetMatrix(), OtherWorld));
+    CHECK(IsEqual(pLeaf->GetMatrix(), AWorld.MulReference(LocalMatrix(pLeaf))));
+}
+
+
+static void TestLargeLevels()
+{
+    CoreScene Scene(NULL);
+
+    // Two levels of more than MIN_NODES_PER_JOB (1024) objects
+    int NumChildren = 3000;
+
+    SceneObject* pRoot = CreateObject(Scene);
+    std::vector<SceneObject*> Children;
+    std::vector<SceneObject*> GrandChildren;
+
+    for (int i = 0 ; i < NumChildren ; i++) {
+        Children.push_back(CreateObject(Scene));
+        GrandChildren.push_back(CreateObject(Scene));
+        CHECK(Scene.SetParent(Children[i], pRoot));
+        CHECK(Scene.SetParent(GrandChildren[i], Children[i]));
+    }
+
+    int NumObjects = 1 + 2 * NumChildren;
+
+    for (int Pass = 0 ; Pass < 2 ; Pass++) {
+        Scene.UpdateTransforms();
+        CHECK(Scene.GetNumUpdatedNodes() == NumObjects);
+
+        Matrix4f RootWorld = LocalMatrix(pRoot);
+        int NumMismatches = 0;
+
+        for (int i = 0 ; i < NumChildren ; i++) {
+            Matrix4f ChildWorld = RootWorld.MulReference(LocalMatrix(Children[i]));
+
+            if (!IsEqual(Children[i]->GetMatrix(), ChildWorld) ||
+                !IsEqual(GrandChildren[i]->GetMatrix(), ChildWorld.MulReference(LocalMatrix(GrandChildren[i])))) {
+                NumMismatches++;
+            }
+        }
+
+        CHECK(NumMismatches == 0);
+
+        // Moving the root updates everything
+        SetRandomTransform(pRoot);
+    }
+
+    Scene.UpdateTransforms();
+
+    SetRandomTransform(GrandChildren[1234]);
+    SetRandomTransform(Children[2999]);
+    Scene.UpdateTransforms();
+    CHECK(Scene.GetNumUpdatedNodes() == 3);
+
+    Matrix4f ChildWorld = LocalMatrix(pRoot).MulReference(LocalMatrix(Children[1234]));
+    CHECK(IsEqual(GrandChildren[1234]->GetMatrix(), ChildWorld.MulReference(LocalMatrix(GrandChildren[1234]))));
+
+    printf("Updated a scene graph of %d objects\n", NumObjects);
+}
+
+
+int main(int argc, char* argv[])
+{
+    srand(1234);
+
+    TestHierarchy();
+    TestLargeLevels();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
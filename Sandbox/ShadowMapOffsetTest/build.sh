@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include -I../../Include/assimp5"
+
+$CC shadow_map_offset_test.cpp ../../Common/ogldev_shadow_map_offset_texture.cpp ../../Common/ogldev_mapped_file.cpp ../../Common/ogldev_util.cpp ../../Common/math_3d.cpp $CPPFLAGS -lpthread -o shadow_map_offset_test
@@ -0,0 +1,290 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//
+// Checks that the PCF offsets are bit identical from one generation to the
+// next, that every sample stays in its stratum of the filter window and that
+// the cache file gives back exactly what was uploaded, in float and half
+// float. The texture calls go to a fake driver that keeps the uploaded data.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include "ogldev_util.h"
+#include "ogldev_shadow_map_offset_texture.h"
+
+#define CACHE_FILENAME "shadow_map_offset_test.bin"
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+//
+// Fake driver
+//
+struct UploadedTexture {
+    GLenum InternalFormat = 0;
+    GLenum Type = 0;
+    int Width = 0;
+    int Height = 0;
+    int Depth = 0;
+    std::vector<char> Data;
+};
+
+static UploadedTexture Uploaded;
+
+
+static void GLAPIENTRY FakeActiveTexture(GLenum)
+{
+}
+
+
+static void GLAPIENTRY FakeTexStorage3D(GLenum, GLsizei, GLenum InternalFormat, GLsizei Width, GLsizei Height, GLsizei Depth)
+{
+    Uploaded.InternalFormat = InternalFormat;
+    Uploaded.Width = Width;
+    Uploaded.Height = Height;
+    Uploaded.Depth = Depth;
+}
+
+
+static void GLAPIENTRY FakeTexSubImage3D(GLenum, GLint, GLint, GLint, GLint, GLsizei Width, GLsizei Height, GLsizei Depth,
+                                         GLenum Format, GLenum Type, const void* pData)
+{
+    CHECK(Format == GL_RGBA);
+    CHECK((Width == Uploaded.Width) && (Height == Uploaded.Height) && (Depth == Uploaded.Depth));
+
+    size_t ElemSize = (Type == GL_HALF_FLOAT) ? sizeof(u16) : sizeof(float);
+    size_t Size = (size_t)Width * Height * Depth * 4 * ElemSize;
+
+    Uploaded.Type = Type;
+    Uploaded.Data.assign((const char*)pData, (const char*)pData + Size);
+}
+
+
+PFNGLACTIVETEXTUREPROC __glewActiveTexture = FakeActiveTexture;
+PFNGLTEXSTORAGE3DPROC __glewTexStorage3D = FakeTexStorage3D;
+PFNGLTEXSUBIMAGE3DPROC __glewTexSubImage3D = FakeTexSubImage3D;
+
+extern "C" {
+
+void GLAPIENTRY glGenTextures(GLsizei n, GLuint* pTextures)
+{
+    for (int i = 0 ; i < n ; i++) {
+        pTextures[i] = i + 1;
+    }
+}
+
+void GLAPIENTRY glDeleteTextures(GLsizei, const GLuint*) {}
+void GLAPIENTRY glBindTexture(GLenum, GLuint) {}
+void GLAPIENTRY glPixelStorei(GLenum, GLint) {}
+void GLAPIENTRY glTexParameteri(GLenum, GLenum, GLint) {}
+GLenum GLAPIENTRY glGetError() { return GL_NO_ERROR; }
+
+}
+
+
+static bool ReadCache(std::vector<char>& Contents)
+{
+    FILE* f = fopen(CACHE_FILENAME, "rb");
+
+    if (!f) {
+        return false;
+    }
+
+    char Buffer[4096];
+    size_t Size;
+    Contents.clear();
+
+    while ((Size = fread(Buffer, 1, sizeof(Buffer), f)) > 0) {
+        Contents.insert(Contents.end(), Buffer, Buffer + Size);
+    }
+
+    fclose(f);
+
+    return true;
+}
+
+
+static void WriteCache(const std::vector<char>& Contents)
+{
+    FILE* f = fopen(CACHE_FILENAME, "wb");
+    fwrite(Contents.data(), 1, Contents.size(), f);
+    fclose(f);
+}
+
+
+//
+// Generator
+//
+static void TestDeterminism(int WindowSize, int FilterSize)
+{
+    std::vector<float> First, Second;
+
+    ShadowMapOffsetTexture::GenOffsetTextureData(WindowSize, FilterSize, First);
+    ShadowMapOffsetTexture::GenOffsetTextureData(WindowSize, FilterSize, Second);
+
+    size_t NumFloats = (size_t)WindowSize * WindowSize * FilterSize * FilterSize * 2;
+    CHECK(First.size() == NumFloats);
+    CHECK((First.size() == Second.size()) && (memcmp(First.data(), Second.data(), First.size() * sizeof(float)) == 0));
+
+    // Sample i of a texel is (u, v) of the filter window, rows from the top.
+    // The jitter keeps it inside its cell in polar coordinates: the angle in
+    // [u, u + 1] / FilterSize turns and the squared radius in [v, v + 1] / FilterSize.
+    float Tolerance = 1e-4f;
+    int NumOutside = 0;
+
+    for (int t = 0 ; t < WindowSize * WindowSize ; t++) {
+        const float* pTexel = &First[(size_t)t * FilterSize * FilterSize * 2];
+        int i = 0;
+
+        for (int v = FilterSize - 1 ; v >= 0 ; v--) {
+            for (int u = 0 ; u < FilterSize ; u++) {
+                float x = pTexel[i * 2];
+                float y = pTexel[i * 2 + 1];
+                i++;
+
+                float RadiusSq = (x * x + y * y) * FilterSize;
+                float Turns = atan2f(y, x) / (2.0f * (float)M_PI);
+
+                if (Turns < 0.0f) {
+                    Turns += 1.0f;
+                }
+
+                Turns *= FilterSize;
+
+                // A full turn is the same as none
+                if ((u == 0) && (Turns > FilterSize - Tolerance)) {
+                    Turns -= FilterSize;
+                }
+
+                if ((RadiusSq < v - Tolerance) || (RadiusSq > v + 1 + Tolerance) ||
+                    (Turns < u - Tolerance) || (Turns > u + 1 + Tolerance)) {
+                    NumOutside++;
+                }
+            }
+        }
+    }
+
+    CHECK(NumOutside == 0);
+
+    printf("Generated %dx%d texels with %dx%d samples\n", WindowSize, WindowSize, FilterSize, FilterSize);
+}
+
+
+//
+// Cache
+//
+static void TestCache(bool UseHalfFloat)
+{
+    int WindowSize = 16;
+    int FilterSize = 8;
+
+    remove(CACHE_FILENAME);
+
+    std::vector<float> Expected;
+    ShadowMapOffsetTexture::GenOffsetTextureData(WindowSize, FilterSize, Expected);
+
+    std::vector<u16> ExpectedHalf;
+    ShadowMapOffsetTexture::ConvertToHalfFloat(Expected, ExpectedHalf);
+
+    const void* pExpected = UseHalfFloat ? (const void*)ExpectedHalf.data() : (const void*)Expected.data();
+    size_t ExpectedSize = UseHalfFloat ? ExpectedHalf.size() * sizeof(u16) : Expected.size() * sizeof(float);
+
+    // First run - generated and saved
+    {
+        ShadowMapOffsetTexture Texture(WindowSize, FilterSize, UseHalfFloat, CACHE_FILENAME);
+    }
+
+    CHECK(Uploaded.InternalFormat == (UseHalfFloat ? GL_RGBA16F : GL_RGBA32F));
+    CHECK(Uploaded.Type == (UseHalfFloat ? GL_HALF_FLOAT : GL_FLOAT));
+    CHECK((Uploaded.Width == FilterSize * FilterSize / 2) && (Uploaded.Height == WindowSize) && (Uploaded.Depth == WindowSize));
+    CHECK((Uploaded.Data.size() == ExpectedSize) && (memcmp(Uploaded.Data.data(), pExpected, ExpectedSize) == 0));
+
+    std::vector<char> Saved;
+    CHECK(ReadCache(Saved));
+    CHECK(Saved.size() > ExpectedSize);
+
+    size_t HeaderSize = Saved.size() - ExpectedSize;
+    CHECK(memcmp(Saved.data() + HeaderSize, pExpected, ExpectedSize) == 0);
+
+    // Second run - the file is uploaded as is. Changing one sample in the
+    // file shows that the data comes from there and not from the generator.
+    Saved[HeaderSize] ^= 1;
+    WriteCache(Saved);
+
+    {
+        ShadowMapOffsetTexture Texture(WindowSize, FilterSize, UseHalfFloat, CACHE_FILENAME);
+    }
+
+    CHECK((Uploaded.Data.size() == ExpectedSize) && (memcmp(Uploaded.Data.data(), Saved.data() + HeaderSize, ExpectedSize) == 0));
+
+    std::vector<char> Reloaded;
+    CHECK(ReadCache(Reloaded));
+    CHECK(Reloaded == Saved);       // not rewritten
+
+    // Different parameters - generated again and the file is replaced
+    {
+        ShadowMapOffsetTexture Texture(WindowSize, FilterSize / 2, UseHalfFloat, CACHE_FILENAME);
+    }
+
+    CHECK(Uploaded.Width == FilterSize * FilterSize / 8);
+    CHECK(ReadCache(Reloaded));
+    CHECK(Reloaded.size() == HeaderSize + ExpectedSize / 4);
+
+    // Truncated file - generated again
+    Saved.resize(Saved.size() / 2);
+    WriteCache(Saved);
+
+    {
+        ShadowMapOffsetTexture Texture(WindowSize, FilterSize, UseHalfFloat, CACHE_FILENAME);
+    }
+
+    CHECK((Uploaded.Data.size() == ExpectedSize) && (memcmp(Uploaded.Data.data(), pExpected, ExpectedSize) == 0));
+
+    remove(CACHE_FILENAME);
+
+    printf("Cache round trip with %s\n", UseHalfFloat ? "half floats" : "floats");
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestDeterminism(16, 8);
+    TestDeterminism(32, 3);     // not a multiple of four samples
+    TestDeterminism(64, 4);
+    TestCache(false);
+    TestCache(true);
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
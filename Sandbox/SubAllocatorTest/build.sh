@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include"
+
+$CC suballocator_test.cpp ../../Common/ogldev_suballocator.cpp $CPPFLAGS -o suballocator_test
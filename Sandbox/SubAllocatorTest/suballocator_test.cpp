@@ -0,0 +1,260 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Tests the bookkeeping of the TLSF and ring sub-allocators that back the
+// Vulkan memory allocator. No device is needed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#include "ogldev_suballocator.h"
+
+#define BLOCK_SIZE (64ull * 1024 * 1024)
+#define NUM_OPERATIONS 200000
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+struct Allocation {
+    u64 Offset;
+    u64 Size;
+    u32 Handle;
+};
+
+
+static bool Overlaps(const Allocation& a, const Allocation& b)
+{
+    return (a.Offset < b.Offset + b.Size) && (b.Offset < a.Offset + a.Size);
+}
+
+
+static void TestTLSFBasic()
+{
+    TLSFAllocator Allocator;
+    Allocator.Init(1024);
+
+    u64 Offset;
+    u32 Handle;
+
+    CHECK(Allocator.Allocate(1024, 1, Offset, Handle));
+    CHECK(Offset == 0);
+    CHECK(!Allocator.Allocate(1, 1, Offset, Handle));
+
+    Allocator.Free(Handle);
+    CHECK(Allocator.IsEmpty());
+    CHECK(Allocator.GetStats().NumFreeBlocks == 1);
+
+    // Alignment - the padding must come back when everything is freed
+    u32 h1, h2, h3;
+    u64 o1, o2, o3;
+    CHECK(Allocator.Allocate(10, 1, o1, h1));
+    CHECK(Allocator.Allocate(100, 256, o2, h2));
+    CHECK(o2 % 256 == 0);
+    CHECK(Allocator.Allocate(100, 64, o3, h3));
+    CHECK(o3 % 64 == 0);
+    CHECK(Allocator.Validate());
+
+    Allocator.Free(h2);
+    Allocator.Free(h1);
+    Allocator.Free(h3);
+    CHECK(Allocator.Validate());
+
+    SubAllocatorStats Stats = Allocator.GetStats();
+    CHECK(Stats.NumFreeBlocks == 1);
+    CHECK(Stats.LargestFreeBlock == 1024);
+    CHECK(Stats.GetFragmentation() == 0.0f);
+}
+
+
+static void TestTLSFRandom()
+{
+    TLSFAllocator Allocator;
+    Allocator.Init(BLOCK_SIZE);
+
+    std::vector<Allocation> Allocations;
+    srand(1);
+
+    int NumFailed = 0;
+
+    for (int i = 0 ; i < NUM_OPERATIONS ; i++) {
+        bool DoAlloc = Allocations.empty() || (rand() % 100 < 55);
+
+        if (DoAlloc) {
+            // Mostly small buffers with an occasional large texture
+            u64 Size = (rand() % 10 == 0) ? (u64)(rand() % (4 * 1024 * 1024)) + 1 : (u64)(rand() % 65536) + 1;
+            u64 Alignment = 1ull << (rand() % 9);
+
+            Allocation a;
+            a.Size = Size;
+
+            if (Allocator.Allocate(Size, Alignment, a.Offset, a.Handle)) {
+                CHECK(a.Offset % Alignment == 0);
+                CHECK(a.Offset + a.Size <= BLOCK_SIZE);
+                CHECK(Allocator.GetSize(a.Handle) >= Size);
+                Allocations.push_back(a);
+            } else {
+                NumFailed++;
+            }
+        } else {
+            int Index = rand() % Allocations.size();
+            Allocator.Free(Allocations[Index].Handle);
+            Allocations[Index] = Allocations.back();
+            Allocations.pop_back();
+        }
+
+        if (i % 10000 == 0) {
+            CHECK(Allocator.Validate());
+        }
+    }
+
+    // Brute force overlap check on the live allocations
+    std::vector<Allocation> Sorted = Allocations;
+
+    for (uint i = 0 ; i < Sorted.size() ; i++) {
+        for (uint j = i + 1 ; j < Sorted.size() ; j++) {
+            if (Overlaps(Sorted[i], Sorted[j])) {
+                NumErrors++;
+                printf("Overlap between %llu and %llu\n", (unsigned long long)Sorted[i].Offset, (unsigned long long)Sorted[j].Offset);
+                break;
+            }
+        }
+    }
+
+    SubAllocatorStats Stats = Allocator.GetStats();
+
+    printf("TLSF: %d live allocations, %.1f MB used, %d free blocks, fragmentation %.2f, %d failed\n",
+           Stats.NumAllocations, (double)Stats.UsedSize / (1024.0 * 1024.0), Stats.NumFreeBlocks,
+           Stats.GetFragmentation(), NumFailed);
+
+    for (uint i = 0 ; i < Allocations.size() ; i++) {
+        Allocator.Free(Allocations[i].Handle);
+    }
+
+    CHECK(Allocator.Validate());
+    CHECK(Allocator.IsEmpty());
+    CHECK(Allocator.GetStats().NumFreeBlocks == 1);
+}
+
+
+static void BenchmarkTLSF()
+{
+    TLSFAllocator Allocator;
+    Allocator.Init(BLOCK_SIZE);
+
+    std::vector<u32> Handles(4096);
+    srand(2);
+
+    auto Start = std::chrono::steady_clock::now();
+
+    int NumOps = 0;
+
+    for (int Round = 0 ; Round < 100 ; Round++) {
+        for (uint i = 0 ; i < Handles.size() ; i++) {
+            u64 Offset;
+            Allocator.Allocate((rand() % 16384) + 1, 256, Offset, Handles[i]);
+        }
+
+        for (uint i = 0 ; i < Handles.size() ; i++) {
+            Allocator.Free(Handles[i]);
+        }
+
+        NumOps += (int)Handles.size() * 2;
+    }
+
+    double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+
+    printf("TLSF: %.1f ns per allocate/free\n", Ns / NumOps);
+}
+
+
+static void TestRing()
+{
+    RingAllocator Ring;
+    Ring.Init(1000);
+
+    u64 Offset;
+
+    CHECK(Ring.Allocate(400, 1, Offset) && (Offset == 0));
+    u64 Marker1 = Ring.GetMarker();
+    CHECK(Ring.Allocate(400, 256, Offset) && (Offset == 512));
+    u64 Marker2 = Ring.GetMarker();
+
+    // Does not fit at the end and the start is still in use
+    CHECK(!Ring.Allocate(200, 1, Offset));
+
+    Ring.Release(Marker1);
+    CHECK(Ring.Allocate(200, 1, Offset) && (Offset == 0));
+
+    // 88 bytes at the end are skipped so only the released range counts
+    CHECK(!Ring.Allocate(300, 1, Offset));
+
+    Ring.Release(Marker2);
+    CHECK(Ring.Allocate(300, 1, Offset) && (Offset == 200));
+    CHECK(Ring.GetUsedSize() == 88 + 200 + 300);
+
+    Ring.Release(Ring.GetMarker());
+    CHECK(Ring.GetUsedSize() == 0);
+    CHECK(!Ring.Allocate(1001, 1, Offset));
+    CHECK(Ring.Allocate(1000, 1, Offset));
+
+    // Simulates frames in flight: release the allocations of the frame before the previous one
+    Ring.Init(64 * 1024);
+    std::vector<u64> FrameMarkers;
+
+    for (int Frame = 0 ; Frame < 1000 ; Frame++) {
+        if (FrameMarkers.size() >= 2) {
+            Ring.Release(FrameMarkers[FrameMarkers.size() - 2]);
+        }
+
+        for (int i = 0 ; i < 10 ; i++) {
+            CHECK(Ring.Allocate(1000 + (Frame % 7) * 100, 16, Offset));
+            CHECK((Offset % 16 == 0) && (Offset + 1000 <= 64 * 1024));
+        }
+
+        FrameMarkers.push_back(Ring.GetMarker());
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestTLSFBasic();
+    TestTLSFRandom();
+    BenchmarkTLSF();
+    TestRing();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include -I../../Terrain12"
+
+$CC terrain_brush_test.cpp ../../Terrain12/terrain_brush.cpp $CPPFLAGS -o terrain_brush_test
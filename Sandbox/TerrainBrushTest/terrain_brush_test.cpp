@@ -0,0 +1,219 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//
+// Checks the terrain brushes of Terrain12 on a small height map: the
+// falloff, that nothing outside the rect changes, and that the smooth and
+// flatten brushes move the heights the right way. No GL is needed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "terrain_brush.h"
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+#define SIZE 33
+
+
+static float TestHeight(int x, int z)
+{
+    return (float)((x * 7 + z * 13) % 17);
+}
+
+
+static void InitHeightMap(Array2D<float>& HeightMap)
+{
+    HeightMap.InitArray2D(SIZE, SIZE);
+
+    for (int z = 0 ; z < SIZE ; z++) {
+        for (int x = 0 ; x < SIZE ; x++) {
+            HeightMap.Set(x, z, TestHeight(x, z));
+        }
+    }
+}
+
+
+static bool IsOutside(int x0, int z0, int x1, int z1, int x, int z)
+{
+    return (x < x0) || (x >= x1) || (z < z0) || (z >= z1);
+}
+
+
+static void CheckOutsideUnchanged(const Array2D<float>& HeightMap, int x0, int z0, int x1, int z1)
+{
+    for (int z = 0 ; z < SIZE ; z++) {
+        for (int x = 0 ; x < SIZE ; x++) {
+            if (IsOutside(x0, z0, x1, z1, x, z)) {
+                CHECK(HeightMap.Get(x, z) == TestHeight(x, z));
+            }
+        }
+    }
+}
+
+
+static void TestWeight()
+{
+    // Odd sized rect - the middle texel gets the full brush
+    CHECK(CalcBrushWeight(4, 4, 13, 13, 8, 8) == 1.0f);
+    CHECK(CalcBrushWeight(4, 4, 13, 13, 4, 4) == 0.0f);     // corner
+    CHECK(CalcBrushWeight(4, 4, 13, 13, 4, 8) > 0.0f);      // middle of an edge
+    CHECK(CalcBrushWeight(4, 4, 13, 13, 6, 8) > CalcBrushWeight(4, 4, 13, 13, 5, 8));
+
+    // Symmetric
+    CHECK(fabsf(CalcBrushWeight(4, 4, 13, 13, 5, 7) - CalcBrushWeight(4, 4, 13, 13, 11, 9)) < 1e-6f);
+
+    // A single texel
+    CHECK(CalcBrushWeight(3, 3, 4, 4, 3, 3) == 1.0f);
+}
+
+
+static void TestClip()
+{
+    int x0 = -5, z0 = 10, x1 = 5, z1 = SIZE + 3;
+    CHECK(ClipBrushRect(SIZE, x0, z0, x1, z1));
+    CHECK((x0 == 0) && (z0 == 10) && (x1 == 5) && (z1 == SIZE));
+
+    x0 = SIZE; z0 = 0; x1 = SIZE + 4; z1 = 4;
+    CHECK(!ClipBrushRect(SIZE, x0, z0, x1, z1));
+}
+
+
+static void TestRaise()
+{
+    Array2D<float> HeightMap;
+    InitHeightMap(HeightMap);
+    std::vector<float> Scratch;
+
+    TerrainBrush Brush;
+    Brush.Type = TERRAIN_BRUSH_RAISE;
+    Brush.Strength = -3.0f;
+
+    ApplyTerrainBrush(HeightMap, SIZE, Brush, 10, 12, 21, 23, Scratch);
+
+    CheckOutsideUnchanged(HeightMap, 10, 12, 21, 23);
+
+    for (int z = 12 ; z < 23 ; z++) {
+        for (int x = 10 ; x < 21 ; x++) {
+            float Expected = TestHeight(x, z) - 3.0f * CalcBrushWeight(10, 12, 21, 23, x, z);
+            CHECK(fabsf(HeightMap.Get(x, z) - Expected) < 1e-5f);
+        }
+    }
+
+    CHECK(HeightMap.Get(15, 17) == TestHeight(15, 17) - 3.0f);
+}
+
+
+static void TestFlatten()
+{
+    Array2D<float> HeightMap;
+    InitHeightMap(HeightMap);
+    std::vector<float> Scratch;
+
+    TerrainBrush Brush;
+    Brush.Type = TERRAIN_BRUSH_FLATTEN;
+    Brush.Strength = 1.0f;
+    Brush.TargetHeight = 8.0f;
+
+    ApplyTerrainBrush(HeightMap, SIZE, Brush, 0, 0, 9, 9, Scratch);
+
+    CheckOutsideUnchanged(HeightMap, 0, 0, 9, 9);
+
+    CHECK(HeightMap.Get(4, 4) == 8.0f);
+
+    for (int z = 0 ; z < 9 ; z++) {
+        for (int x = 0 ; x < 9 ; x++) {
+            // Never overshoots the target
+            float Before = fabsf(TestHeight(x, z) - 8.0f);
+            float After = fabsf(HeightMap.Get(x, z) - 8.0f);
+            CHECK(After <= Before + 1e-5f);
+        }
+    }
+}
+
+
+static void TestSmooth()
+{
+    Array2D<float> HeightMap;
+    InitHeightMap(HeightMap);
+    std::vector<float> Scratch;
+
+    TerrainBrush Brush;
+    Brush.Type = TERRAIN_BRUSH_SMOOTH;
+    Brush.Strength = 1.0f;
+
+    // Against the corner of the map so the edge texels have fewer neighbors
+    int x0 = SIZE - 7, z0 = SIZE - 7, x1 = SIZE, z1 = SIZE;
+    ApplyTerrainBrush(HeightMap, SIZE, Brush, x0, z0, x1, z1, Scratch);
+
+    CheckOutsideUnchanged(HeightMap, x0, z0, x1, z1);
+
+    // The middle texel becomes the average of the original 3x3 - not of
+    // neighbors that were already smoothed
+    int cx = SIZE - 4, cz = SIZE - 4;
+    float Sum = 0.0f;
+
+    for (int z = cz - 1 ; z <= cz + 1 ; z++) {
+        for (int x = cx - 1 ; x <= cx + 1 ; x++) {
+            Sum += TestHeight(x, z);
+        }
+    }
+
+    CHECK(fabsf(HeightMap.Get(cx, cz) - Sum / 9.0f) < 1e-5f);
+
+    // Smoothing lowers the roughness inside the rect
+    float RoughnessBefore = 0.0f;
+    float RoughnessAfter = 0.0f;
+
+    for (int z = z0 ; z < z1 ; z++) {
+        for (int x = x0 ; x < x1 - 1 ; x++) {
+            RoughnessBefore += fabsf(TestHeight(x + 1, z) - TestHeight(x, z));
+            RoughnessAfter += fabsf(HeightMap.Get(x + 1, z) - HeightMap.Get(x, z));
+        }
+    }
+
+    CHECK(RoughnessAfter < RoughnessBefore);
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestWeight();
+    TestClip();
+    TestRaise();
+    TestFlatten();
+    TestSmooth();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include -I../../Include/assimp5 -I../../Terrain12"
+
+$CC terrain_query_test.cpp ../../Terrain12/terrain_query.cpp ../../Common/math_3d.cpp $CPPFLAGS -lpthread -o terrain_query_test
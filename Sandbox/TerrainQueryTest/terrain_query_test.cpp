@@ -0,0 +1,329 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//
+// Checks the terrain queries of Terrain12 against brute force: the batched
+// (SIMD) height samples against the single ones, and the quadtree ray casts
+// against a test of every triangle, before and after the heights change.
+// No GL is needed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "terrain_query.h"
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+#define SIZE         101      // the quadtree levels have odd sizes on purpose
+#define WORLD_SCALE  2.0f
+#define NUM_RAYS     2000
+
+
+static float RandomFloat(float Min, float Max)
+{
+    return Min + (Max - Min) * ((float)rand() / (float)RAND_MAX);
+}
+
+
+static void InitHeightMap(Array2D<float>& HeightMap)
+{
+    HeightMap.InitArray2D(SIZE, SIZE);
+
+    for (int z = 0 ; z < SIZE ; z++) {
+        for (int x = 0 ; x < SIZE ; x++) {
+            float h = 20.0f * sinf((float)x * 0.11f) * cosf((float)z * 0.07f) + RandomFloat(0.0f, 3.0f);
+            HeightMap.Set(x, z, h);
+        }
+    }
+}
+
+
+static bool BruteForceTriangle(const Vector3f& Origin, const Vector3f& Dir,
+                               const Vector3f& p0, const Vector3f& p1, const Vector3f& p2, float& t)
+{
+    Vector3f e1 = p1 - p0;
+    Vector3f e2 = p2 - p0;
+    Vector3f p = Dir.Cross(e2);
+    float Det = e1.Dot(p);
+
+    if (fabsf(Det) < 1e-12f) {
+        return false;
+    }
+
+    Vector3f s = Origin - p0;
+    float u = s.Dot(p) / Det;
+    Vector3f q = s.Cross(e1);
+    float v = Dir.Dot(q) / Det;
+
+    if ((u < 0.0f) || (v < 0.0f) || (u + v > 1.0f)) {
+        return false;
+    }
+
+    t = e2.Dot(q) / Det;
+
+    return true;
+}
+
+
+// Every triangle of the LOD 0 mesh - the diagonals go through the odd vertices
+static bool BruteForceRay(const Array2D<float>& HeightMap, const TerrainRay& Ray, float& Closest)
+{
+    bool IsHit = false;
+    Closest = Ray.MaxDistance;
+
+    for (int z = 0 ; z < SIZE - 1 ; z++) {
+        for (int x = 0 ; x < SIZE - 1 ; x++) {
+            Vector3f p00(x * WORLD_SCALE, HeightMap.Get(x, z), z * WORLD_SCALE);
+            Vector3f p10((x + 1) * WORLD_SCALE, HeightMap.Get(x + 1, z), z * WORLD_SCALE);
+            Vector3f p01(x * WORLD_SCALE, HeightMap.Get(x, z + 1), (z + 1) * WORLD_SCALE);
+            Vector3f p11((x + 1) * WORLD_SCALE, HeightMap.Get(x + 1, z + 1), (z + 1) * WORLD_SCALE);
+
+            bool MainDiagonal = ((x + z) % 2) == 0;
+
+            Vector3f Tris[2][3] = {
+                { p00, p10, MainDiagonal ? p11 : p01 },
+                { MainDiagonal ? p00 : p10, p11, p01 }
+            };
+
+            for (int i = 0 ; i < 2 ; i++) {
+                float t;
+
+                if (BruteForceTriangle(Ray.Origin, Ray.Dir, Tris[i][0], Tris[i][1], Tris[i][2], t) &&
+                    (t >= 0.0f) && (t <= Closest)) {
+                    Closest = t;
+                    IsHit = true;
+                }
+            }
+        }
+    }
+
+    return IsHit;
+}
+
+
+static void MakeRays(std::vector<TerrainRay>& Rays)
+{
+    float WorldSize = (SIZE - 1) * WORLD_SCALE;
+
+    Rays.resize(NUM_RAYS);
+
+    for (int i = 0 ; i < NUM_RAYS ; i++) {
+        TerrainRay& Ray = Rays[i];
+
+        switch (i % 4) {
+        case 0:     // projectiles from above
+            Ray.Origin = Vector3f(RandomFloat(0.0f, WorldSize), 60.0f, RandomFloat(0.0f, WorldSize));
+            Ray.Dir = Vector3f(RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, -0.05f), RandomFloat(-1.0f, 1.0f));
+            break;
+
+        case 1:     // lines of sight between two points above the ground
+            Ray.Origin = Vector3f(RandomFloat(0.0f, WorldSize), RandomFloat(5.0f, 30.0f), RandomFloat(0.0f, WorldSize));
+            Ray.Dir = Vector3f(RandomFloat(0.0f, WorldSize), RandomFloat(5.0f, 30.0f), RandomFloat(0.0f, WorldSize)) - Ray.Origin;
+            Ray.MaxDistance = 1.0f;
+            break;
+
+        case 2:     // from outside the terrain
+            Ray.Origin = Vector3f(-50.0f, RandomFloat(0.0f, 40.0f), RandomFloat(-50.0f, WorldSize + 50.0f));
+            Ray.Dir = Vector3f(1.0f, RandomFloat(-0.3f, 0.1f), RandomFloat(-0.5f, 0.5f));
+            break;
+
+        case 3:     // axis aligned
+            Ray.Origin = Vector3f(RandomFloat(0.0f, WorldSize), RandomFloat(0.0f, 30.0f), RandomFloat(0.0f, WorldSize));
+            Ray.Dir = ((i / 4) % 2) ? Vector3f(0.0f, 0.0f, -1.0f) : Vector3f(0.0f, -1.0f, 0.0f);
+            break;
+        }
+    }
+}
+
+
+static void CheckRays(const Array2D<float>& HeightMap, const TerrainQuery& Query)
+{
+    std::vector<TerrainRay> Rays;
+    MakeRays(Rays);
+
+    std::vector<TerrainRayHit> Hits(Rays.size());
+
+    auto Start = std::chrono::high_resolution_clock::now();
+    Query.CastRays(Rays.data(), Hits.data(), (int)Rays.size());
+    auto End = std::chrono::high_resolution_clock::now();
+    double QuadtreeMs = std::chrono::duration<double, std::milli>(End - Start).count();
+
+    int NumHits = 0;
+    int NumMismatches = 0;
+
+    Start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0 ; i < (int)Rays.size() ; i++) {
+        float Closest;
+        bool IsHit = BruteForceRay(HeightMap, Rays[i], Closest);
+        const TerrainRayHit& Hit = Hits[i];
+
+        // Grazing rays can go either way within the tolerance
+        float Tolerance = 1e-3f / Rays[i].Dir.Length();
+
+        if (IsHit != Hit.IsHit) {
+            NumMismatches++;
+            continue;
+        }
+
+        if (!IsHit) {
+            continue;
+        }
+
+        NumHits++;
+
+        if (fabsf(Closest - Hit.Distance) > Tolerance) {
+            NumMismatches++;
+            continue;
+        }
+
+        // The ray and the height samples agree on the surface
+        float Height = Query.GetHeight(Hit.Pos.x, Hit.Pos.z);
+        CHECK(fabsf(Height - Hit.Pos.y) < 1e-2f);
+        CHECK(Hit.Normal.y > 0.0f);
+        CHECK(fabsf(Hit.Normal.Length() - 1.0f) < 1e-4f);
+    }
+
+    End = std::chrono::high_resolution_clock::now();
+    double BruteForceMs = std::chrono::duration<double, std::milli>(End - Start).count();
+
+    printf("%d rays, %d hits, %d mismatches - quadtree %.2f ms, brute force %.2f ms\n",
+           (int)Rays.size(), NumHits, NumMismatches, QuadtreeMs, BruteForceMs);
+
+    CHECK(NumHits > (int)Rays.size() / 4);
+    CHECK(NumMismatches == 0);
+
+    // The job system gives the same results
+    JobSystem Jobs(4);
+    std::vector<TerrainRayHit> JobHits(Rays.size());
+    Query.CastRays(Rays.data(), JobHits.data(), (int)Rays.size(), &Jobs);
+
+    for (int i = 0 ; i < (int)Rays.size() ; i++) {
+        CHECK(JobHits[i].IsHit == Hits[i].IsHit);
+        CHECK(JobHits[i].Distance == Hits[i].Distance);
+    }
+}
+
+
+static void CheckHeights(const Array2D<float>& HeightMap, const TerrainQuery& Query)
+{
+    float WorldSize = (SIZE - 1) * WORLD_SCALE;
+
+    // On the vertices
+    for (int z = 0 ; z < SIZE ; z++) {
+        for (int x = 0 ; x < SIZE ; x++) {
+            CHECK(fabsf(Query.GetHeight(x * WORLD_SCALE, z * WORLD_SCALE) - HeightMap.Get(x, z)) < 1e-4f);
+        }
+    }
+
+    // Inside the cells, on the edges of the map and outside of it. 10001 is
+    // not a multiple of four so the scalar tail runs too.
+    std::vector<Vector2f> Points(10001);
+
+    for (int i = 0 ; i < (int)Points.size() ; i++) {
+        Points[i] = Vector2f(RandomFloat(-10.0f, WorldSize + 10.0f), RandomFloat(-10.0f, WorldSize + 10.0f));
+    }
+
+    Points[0] = Vector2f(WorldSize, WorldSize);
+    Points[1] = Vector2f(0.0f, WorldSize);
+
+    std::vector<float> Heights(Points.size());
+    Query.GetHeights(Points.data(), Heights.data(), (int)Points.size());
+
+    for (int i = 0 ; i < (int)Points.size() ; i++) {
+        float Expected = Query.GetHeight(Points[i].x, Points[i].y);
+        CHECK(fabsf(Heights[i] - Expected) < 1e-4f);
+    }
+
+    CHECK(fabsf(Heights[0] - HeightMap.Get(SIZE - 1, SIZE - 1)) < 1e-4f);
+    CHECK(fabsf(Heights[1] - HeightMap.Get(0, SIZE - 1)) < 1e-4f);
+
+    // The middle of the diagonal of a cell is the average of its ends
+    float h = Query.GetHeight(2.5f * WORLD_SCALE, 4.5f * WORLD_SCALE);
+    CHECK(fabsf(h - 0.5f * (HeightMap.Get(2, 4) + HeightMap.Get(3, 5))) < 1e-4f);
+
+    h = Query.GetHeight(3.5f * WORLD_SCALE, 4.5f * WORLD_SCALE);
+    CHECK(fabsf(h - 0.5f * (HeightMap.Get(4, 4) + HeightMap.Get(3, 5))) < 1e-4f);
+}
+
+
+static void CheckVisibility(Array2D<float>& HeightMap, TerrainQuery& Query)
+{
+    float Mid = (SIZE / 2) * WORLD_SCALE;
+
+    // Flatten the middle row and build a wall across it
+    for (int z = 0 ; z < SIZE ; z++) {
+        for (int x = 0 ; x < SIZE ; x++) {
+            HeightMap.Set(x, z, (x == SIZE / 2) ? 100.0f : 0.0f);
+        }
+    }
+
+    Query.UpdateRegion(0, 0, SIZE, SIZE);
+
+    CHECK(!Query.IsVisible(Vector3f(Mid - 20.0f, 10.0f, Mid), Vector3f(Mid + 20.0f, 10.0f, Mid)));
+    CHECK(Query.IsVisible(Vector3f(Mid - 20.0f, 10.0f, Mid), Vector3f(Mid - 5.0f, 10.0f, Mid + 30.0f)));
+    CHECK(Query.IsVisible(Vector3f(Mid - 20.0f, 110.0f, Mid), Vector3f(Mid + 20.0f, 110.0f, Mid)));
+}
+
+
+int main(int argc, char* argv[])
+{
+    srand(1);
+
+    Array2D<float> HeightMap;
+    InitHeightMap(HeightMap);
+
+    TerrainQuery Query;
+    Query.Init(&HeightMap, SIZE, WORLD_SCALE);
+
+    CheckHeights(HeightMap, Query);
+    CheckRays(HeightMap, Query);
+
+    // A bump that sticks out of the old bounds, refitted incrementally
+    for (int z = 40 ; z < 60 ; z++) {
+        for (int x = 20 ; x < 35 ; x++) {
+            HeightMap.At(x, z) += 45.0f;
+        }
+    }
+
+    Query.UpdateRegion(20, 40, 35, 60);
+
+    CheckHeights(HeightMap, Query);
+    CheckRays(HeightMap, Query);
+
+    CheckVisibility(HeightMap, Query);
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
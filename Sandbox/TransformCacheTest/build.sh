@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -pthread -I../../DemoLITION/Framework/Include -I../../Include -I../../Include/assimp5"
+
+$CC transform_cache_test.cpp ../../DemoLITION/Framework/Source/core_scene.cpp ../../Common/ogldev_world_transform.cpp ../../Common/ogldev_basic_glfw_camera.cpp ../../Common/math_3d.cpp $CPPFLAGS -o transform_cache_test
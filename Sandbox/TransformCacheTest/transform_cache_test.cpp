@@ -0,0 +1,242 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//
+// Checks the cached world, normal and WVP matrices of WorldTrans and of the
+// DemoLITION SceneObject: every setter and every camera change must rebuild
+// them and an unchanged object/camera must get the cached ones back. Also
+// checks that the camera generations stay unique when cameras change on
+// several threads.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "ogldev_world_transform.h"
+#include "Int/core_scene.h"
+
+#define EPSILON 1e-4f
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+static bool IsEqual(const Matrix4f& a, const Matrix4f& b)
+{
+    for (int i = 0 ; i < 4 ; i++) {
+        for (int j = 0 ; j < 4 ; j++) {
+            if (fabsf(a.m[i][j] - b.m[i][j]) > EPSILON * fmaxf(1.0f, fabsf(b.m[i][j]))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+static bool IsEqual(const Matrix3f& a, const Matrix3f& b)
+{
+    for (int i = 0 ; i < 3 ; i++) {
+        for (int j = 0 ; j < 3 ; j++) {
+            if (fabsf(a.m[i][j] - b.m[i][j]) > EPSILON * fmaxf(1.0f, fabsf(b.m[i][j]))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+// The transformation that the objects under test are set to
+struct Transform {
+    Vector3f Pos = Vector3f(0.0f, 0.0f, 0.0f);
+    Vector3f Rot = Vector3f(0.0f, 0.0f, 0.0f);
+    float Scale = 1.0f;
+
+    Matrix4f GetWorld() const
+    {
+        Matrix4f ScaleTrans, Rotation, Translation;
+        ScaleTrans.InitScaleTransform(Scale, Scale, Scale);
+        Rotation.InitRotateTransform(Rot.x, Rot.y, Rot.z);
+        Translation.InitTranslationTransform(Pos.x, Pos.y, Pos.z);
+        return Translation.MulReference(Rotation.MulReference(ScaleTrans));
+    }
+};
+
+
+static void SetScale(WorldTrans& Object, float Scale)
+{
+    Object.SetScale(Scale);
+}
+
+
+static void SetScale(SceneObject& Object, float Scale)
+{
+    Object.SetScale(Scale, Scale, Scale);
+}
+
+
+static BasicCamera CreateCamera()
+{
+    PersProjInfo PersProj = { 45.0f, 1920.0f, 1080.0f, 0.1f, 1000.0f };
+    return BasicCamera(PersProj, Vector3f(0.0f, 5.0f, -20.0f), Vector3f(0.0f, 0.0f, 1.0f), Vector3f(0.0f, 1.0f, 0.0f));
+}
+
+
+static Matrix4f CalcViewProj(const BasicCamera& Camera)
+{
+    Matrix4f View;
+    View.InitCameraTransform(Camera.GetPos(), Camera.GetTarget(), Camera.GetUp());
+    return Camera.GetProjectionMat().MulReference(View);
+}
+
+
+template<typename T>
+static void CheckMatrices(const T& Object, const Transform& Trans, const BasicCamera& Camera)
+{
+    Matrix4f World = Trans.GetWorld();
+
+    CHECK(IsEqual(Object.GetMatrix(), World));
+    CHECK(IsEqual(Object.GetNormalMatrix(), Matrix3f(World.Inverse()).Transpose()));
+    CHECK(IsEqual(Object.GetWVP(Camera), CalcViewProj(Camera).MulReference(World)));
+}
+
+
+template<typename T>
+static void TestObject(T& Object, const char* pName)
+{
+    BasicCamera Camera = CreateCamera();
+    Transform Trans;
+
+    CheckMatrices(Object, Trans, Camera);
+
+    // Every setter invalidates the world, normal and WVP matrices
+    Trans.Pos = Vector3f(1.0f, -2.0f, 3.0f);
+    Object.SetPosition(Trans.Pos.x, Trans.Pos.y, Trans.Pos.z);
+    CheckMatrices(Object, Trans, Camera);
+
+    Trans.Rot = Vector3f(30.0f, 45.0f, -60.0f);
+    Object.SetRotation(Trans.Rot.x, Trans.Rot.y, Trans.Rot.z);
+    CheckMatrices(Object, Trans, Camera);
+
+    Trans.Scale = 2.5f;
+    SetScale(Object, Trans.Scale);
+    CheckMatrices(Object, Trans, Camera);
+
+    // Every camera change invalidates the WVP matrix
+    Camera.SetPosition(10.0f, 0.0f, -5.0f);
+    CheckMatrices(Object, Trans, Camera);
+
+    Camera.SetTarget(0.0f, 0.0f, -1.0f);
+    CheckMatrices(Object, Trans, Camera);
+
+    Camera.SetUp(1.0f, 0.0f, 0.0f);
+    CheckMatrices(Object, Trans, Camera);
+
+    // Nothing changed - the cached matrices come back as they are
+    uint Generation = Camera.GetGeneration();
+    const Matrix4f* pWVP = &Object.GetWVP(Camera);
+    Matrix4f WVP = *pWVP;
+
+    for (int i = 0 ; i < 3 ; i++) {
+        CHECK(&Object.GetWVP(Camera) == pWVP);
+        CHECK(memcmp(&Object.GetWVP(Camera), &WVP, sizeof(Matrix4f)) == 0);
+        CHECK(Camera.GetGeneration() == Generation);
+    }
+
+    // A copy of the camera has the same generation and the same matrices
+    BasicCamera Copy = Camera;
+    CHECK(Copy.GetGeneration() == Generation);
+    CHECK(memcmp(&Object.GetWVP(Copy), &WVP, sizeof(Matrix4f)) == 0);
+
+    // Switching between two cameras gives the WVP of each one
+    BasicCamera Other = CreateCamera();
+    CHECK(Other.GetGeneration() != Generation);
+    CheckMatrices(Object, Trans, Other);
+    CheckMatrices(Object, Trans, Camera);
+
+    printf("%s: the cached matrices follow the object and the camera\n", pName);
+}
+
+
+static void TestConcurrentGenerations()
+{
+    int NumThreads = 4;
+    int NumChanges = 10000;
+
+    std::vector<std::vector<uint>> Generations(NumThreads);
+    std::vector<std::thread> Threads;
+
+    for (int t = 0 ; t < NumThreads ; t++) {
+        Threads.emplace_back([&, t]() {
+            BasicCamera Camera = CreateCamera();
+
+            for (int i = 0 ; i < NumChanges ; i++) {
+                Camera.SetPosition((float)i, 0.0f, 0.0f);
+                Generations[t].push_back(Camera.GetGeneration());
+            }
+        });
+    }
+
+    for (std::thread& t : Threads) {
+        t.join();
+    }
+
+    std::vector<uint> All;
+
+    for (int t = 0 ; t < NumThreads ; t++) {
+        All.insert(All.end(), Generations[t].begin(), Generations[t].end());
+    }
+
+    std::sort(All.begin(), All.end());
+
+    CHECK(std::adjacent_find(All.begin(), All.end()) == All.end());
+}
+
+
+int main(int argc, char* argv[])
+{
+    WorldTrans Trans;
+    TestObject(Trans, "WorldTrans");
+
+    CoreScene Scene(NULL);
+    SceneObject* pObject = Scene.CreateSceneObject((Model*)NULL);
+    TestObject(*pObject, "SceneObject");
+
+    TestConcurrentGenerations();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
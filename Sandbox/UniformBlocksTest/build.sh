@@ -0,0 +1,6 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../DemoLITION/Framework/Include -I../../Include -I../../Include/assimp5"
+
+$CC uniform_blocks_test.cpp ../../DemoLITION/Framework/Source/GL/gl_forward_lighting_blocks.cpp ../../Common/math_3d.cpp $CPPFLAGS -o uniform_blocks_test
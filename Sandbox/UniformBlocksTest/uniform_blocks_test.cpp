@@ -0,0 +1,183 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Tests the CPU packing of the uniform blocks of the DemoLITION forward
+// lighting technique. The std140 offsets are checked at compile time in
+// gl_forward_lighting_blocks.cpp; this checks the values and the material table.
+// No GL context is needed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "GL/gl_forward_lighting_blocks.h"
+
+static int NumErrors = 0;
+
+#define CHECK(cond)                                                 \
+    if (!(cond)) {                                                  \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        NumErrors++;                                                \
+    }
+
+
+static bool IsEqual(float a, float b)
+{
+    return fabsf(a - b) < 0.0001f;
+}
+
+
+static void TestLights()
+{
+    DirectionalLight DirLight;
+    DirLight.Color = Vector3f(1.0f, 0.5f, 0.25f);
+    DirLight.AmbientIntensity = 0.1f;
+    DirLight.DiffuseIntensity = 0.9f;
+    DirLight.WorldDirection = Vector3f(0.0f, -2.0f, 0.0f);
+
+    UBOLights Lights;
+    PackDirectionalLight(Lights.DirectionalLight, DirLight);
+    PackDirectionalLightDir(Lights.DirectionalLight, DirLight);
+
+    // Read back through the raw bytes at the std140 offsets
+    const char* p = (const char*)&Lights;
+    const float* pColor = (const float*)p;
+    CHECK(pColor[0] == 1.0f && pColor[1] == 0.5f && pColor[2] == 0.25f);
+    CHECK(*(const float*)(p + 12) == 0.1f);
+    CHECK(*(const float*)(p + 16) == 0.9f);
+    const float* pDir = (const float*)(p + 32);
+    CHECK(IsEqual(pDir[0], 0.0f) && IsEqual(pDir[1], -1.0f) && IsEqual(pDir[2], 0.0f));
+
+    PointLight Point;
+    Point.WorldPosition = Vector3f(1.0f, 2.0f, 3.0f);
+    Point.Attenuation.Linear = 0.5f;
+    Point.Attenuation.Exp = 0.001f;
+    PackPointLight(Lights.PointLights[1], Point);
+    PackPointLightPos(Lights.PointLights[1], Point);
+
+    const char* pPoint = p + 48 + 64;
+    const float* pPos = (const float*)(pPoint + 32);
+    CHECK(pPos[0] == 1.0f && pPos[1] == 2.0f && pPos[2] == 3.0f);
+    CHECK(*(const float*)(pPoint + 48 + 4) == 0.5f);
+    CHECK(IsEqual(*(const float*)(pPoint + 48 + 8), 2.0f));
+
+    SpotLight Spot;
+    Spot.Cutoff = 60.0f;
+    Spot.WorldPosition = Vector3f(4.0f, 5.0f, 6.0f);
+    Spot.WorldDirection = Vector3f(3.0f, 0.0f, 4.0f);
+    PackSpotLight(Lights.SpotLights[0], Spot);
+    PackSpotLightPosAndDir(Lights.SpotLights[0], Spot);
+
+    const char* pSpot = p + 48 + 64 * FORWARD_LIGHTING_MAX_POINT_LIGHTS;
+    CHECK(IsEqual(*(const float*)(pSpot + 76), 0.5f));
+    const float* pSpotPos = (const float*)(pSpot + 32);
+    CHECK(pSpotPos[0] == 4.0f && pSpotPos[1] == 5.0f && pSpotPos[2] == 6.0f);
+    const float* pSpotDir = (const float*)(pSpot + 64);
+    CHECK(IsEqual(pSpotDir[0], 0.6f) && IsEqual(pSpotDir[2], 0.8f));
+}
+
+
+static void TestDraw()
+{
+    UBODraw Draw;
+
+    Matrix4f World;
+    World.InitTranslationTransform(1.0f, 2.0f, 3.0f);
+    Draw.World = World;
+
+    // row_major: the translation is in the last float of each of the first three rows
+    const float* pWorld = (const float*)((const char*)&Draw + 128);
+    CHECK(pWorld[3] == 1.0f && pWorld[7] == 2.0f && pWorld[11] == 3.0f);
+
+    Matrix3f NormalMatrix(World);
+    NormalMatrix.m[0][1] = 7.0f;
+    PackNormalMatrix(Draw.NormalMatrix, NormalMatrix);
+
+    const float* pNormal = (const float*)((const char*)&Draw + 192);
+    CHECK(pNormal[0] == 1.0f && pNormal[1] == 7.0f && pNormal[3] == 0.0f);
+    CHECK(pNormal[5] == 1.0f && pNormal[7] == 0.0f);
+    CHECK(pNormal[10] == 1.0f && pNormal[11] == 0.0f);
+}
+
+
+static void TestMaterialTable()
+{
+    UBOMaterialTable Table;
+
+    Material Mat1;
+    Mat1.DiffuseColor = Vector3f(1.0f, 0.0f, 0.0f);
+    Material Mat2;
+    Mat2.DiffuseColor = Vector3f(0.0f, 1.0f, 0.0f);
+
+    int First = 0;
+    int Count = 0;
+
+    CHECK(!Table.IsDirty());
+    CHECK(Table.GetIndex(Mat1) == 0);
+    CHECK(Table.GetIndex(Mat2) == 1);
+    CHECK(Table.IsDirty());
+    Table.GetDirtyRange(First, Count);
+    CHECK(First == 0 && Count == 2);
+    CHECK(Table.GetData()[1].DiffuseColor.g == 1.0f);
+    Table.ClearDirty();
+
+    // Same materials again - nothing to upload
+    CHECK(Table.GetIndex(Mat1) == 0);
+    CHECK(Table.GetIndex(Mat2) == 1);
+    CHECK(!Table.IsDirty());
+
+    // A changed material keeps its slot and only that slot is uploaded
+    Mat2.SpecularColor = Vector3f(0.5f, 0.5f, 0.5f);
+    CHECK(Table.GetIndex(Mat2) == 1);
+    Table.GetDirtyRange(First, Count);
+    CHECK(First == 1 && Count == 1);
+    CHECK(Table.GetData()[1].SpecularColor.r == 0.5f);
+    Table.ClearDirty();
+
+    // Overflow starts over from the first slot
+    static Material Many[FORWARD_LIGHTING_MAX_MATERIALS];
+
+    for (int i = 2 ; i < FORWARD_LIGHTING_MAX_MATERIALS ; i++) {
+        CHECK(Table.GetIndex(Many[i]) == i);
+    }
+
+    CHECK(Table.GetNumMaterials() == FORWARD_LIGHTING_MAX_MATERIALS);
+    CHECK(Table.GetIndex(Many[0]) == 0);
+    CHECK(Table.GetNumMaterials() == 1);
+}
+
+
+int main(int argc, char* argv[])
+{
+    TestLights();
+    TestDraw();
+    TestMaterialTable();
+
+    if (NumErrors > 0) {
+        printf("%d errors\n", NumErrors);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
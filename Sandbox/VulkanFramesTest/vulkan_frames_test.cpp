@@ -0,0 +1,299 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Headless frame pacing test for VulkanFramesInFlight. Runs the same render loop
+// with 1, 2 and 3 frames in flight on an offscreen swap chain and prints how long
+// the CPU was blocked on the GPU. Works without a window so it can run on a
+// software device such as lavapipe:
+//
+//     VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./vulkan_frames_test
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "ogldev_vulkan_core.h"
+#include "ogldev_vulkan_frames.h"
+
+#define WINDOW_WIDTH 1280
+#define WINDOW_HEIGHT 720
+#define NUM_SWAP_CHAIN_IMAGES 3
+#define NUM_FRAMES 300
+#define NUM_CLEARS_PER_FRAME 8      // GPU load
+#define CPU_WORK_MICROS 2000        // CPU load - simulates the game logic and draw recording
+
+static int NumDeferredDeletes = 0;
+
+
+class FramesTest
+{
+public:
+
+    FramesTest() : m_core("VulkanFramesTest") {}
+
+    ~FramesTest();
+
+    void Init();
+
+    void Run(int NumFramesInFlight);
+
+    void RunWithAbandonedFrames(int NumFramesInFlight);
+
+private:
+
+    void CreateRenderPass();
+    void CreateFramebuffers();
+    void RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex, int Frame);
+    void SimulateCPUWork();
+
+    OgldevVulkanCore m_core;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    VulkanOffscreenSwapChain m_swapChain;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    std::vector<VkFramebuffer> m_fbs;
+};
+
+
+FramesTest::~FramesTest()
+{
+    for (uint i = 0 ; i < m_fbs.size() ; i++) {
+        vkDestroyFramebuffer(m_core.GetDevice(), m_fbs[i], NULL);
+    }
+
+    vkDestroyRenderPass(m_core.GetDevice(), m_renderPass, NULL);
+}
+
+
+void FramesTest::Init()
+{
+    m_core.InitHeadless();
+
+    vkGetDeviceQueue(m_core.GetDevice(), m_core.GetQueueFamily(), 0, &m_queue);
+
+    m_swapChain.Init(&m_core, m_queue, WINDOW_WIDTH, WINDOW_HEIGHT, NUM_SWAP_CHAIN_IMAGES);
+
+    CreateRenderPass();
+    CreateFramebuffers();
+}
+
+
+void FramesTest::CreateRenderPass()
+{
+    VkAttachmentReference attachRef = {};
+    attachRef.attachment = 0;
+    attachRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpassDesc = {};
+    subpassDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpassDesc.colorAttachmentCount = 1;
+    subpassDesc.pColorAttachments = &attachRef;
+
+    VkAttachmentDescription attachDesc = {};
+    attachDesc.format = m_swapChain.GetFormat();
+    attachDesc.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachDesc.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    VkRenderPassCreateInfo renderPassCreateInfo = {};
+    renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassCreateInfo.attachmentCount = 1;
+    renderPassCreateInfo.pAttachments = &attachDesc;
+    renderPassCreateInfo.subpassCount = 1;
+    renderPassCreateInfo.pSubpasses = &subpassDesc;
+
+    VkResult res = vkCreateRenderPass(m_core.GetDevice(), &renderPassCreateInfo, NULL, &m_renderPass);
+    CHECK_VULKAN_ERROR("vkCreateRenderPass error %d\n", res);
+}
+
+
+void FramesTest::CreateFramebuffers()
+{
+    m_fbs.resize(m_swapChain.GetNumImages());
+
+    for (uint i = 0 ; i < m_fbs.size() ; i++) {
+        VkImageView View = m_swapChain.GetImageView(i);
+
+        VkFramebufferCreateInfo fbCreateInfo = {};
+        fbCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        fbCreateInfo.renderPass = m_renderPass;
+        fbCreateInfo.attachmentCount = 1;
+        fbCreateInfo.pAttachments = &View;
+        fbCreateInfo.width = WINDOW_WIDTH;
+        fbCreateInfo.height = WINDOW_HEIGHT;
+        fbCreateInfo.layers = 1;
+
+        VkResult res = vkCreateFramebuffer(m_core.GetDevice(), &fbCreateInfo, NULL, &m_fbs[i]);
+        CHECK_VULKAN_ERROR("vkCreateFramebuffer error %d\n", res);
+    }
+}
+
+
+void FramesTest::RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex, int Frame)
+{
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkResult res = vkBeginCommandBuffer(CmdBuf, &beginInfo);
+    CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
+
+    float Intensity = (float)(Frame % 256) / 255.0f;
+
+    VkClearValue clearValue = {};
+    clearValue.color.float32[0] = Intensity;
+    clearValue.color.float32[1] = 1.0f - Intensity;
+    clearValue.color.float32[2] = 0.0f;
+    clearValue.color.float32[3] = 1.0f;
+
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = m_fbs[ImageIndex];
+    renderPassInfo.renderArea.extent.width = WINDOW_WIDTH;
+    renderPassInfo.renderArea.extent.height = WINDOW_HEIGHT;
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+
+    for (int i = 0 ; i < NUM_CLEARS_PER_FRAME ; i++) {
+        vkCmdBeginRenderPass(CmdBuf, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdEndRenderPass(CmdBuf);
+    }
+
+    res = vkEndCommandBuffer(CmdBuf);
+    CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
+}
+
+
+void FramesTest::SimulateCPUWork()
+{
+    auto Start = std::chrono::steady_clock::now();
+
+    while (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Start).count() < CPU_WORK_MICROS) {
+    }
+}
+
+
+void FramesTest::Run(int NumFramesInFlight)
+{
+    VulkanFramesInFlight Frames;
+
+    Frames.Init(&m_core, m_queue, NumFramesInFlight, m_swapChain.GetNumImages());
+
+    auto Start = std::chrono::steady_clock::now();
+
+    for (int i = 0 ; i < NUM_FRAMES ; i++) {
+        VkCommandBuffer CmdBuf = Frames.BeginFrame();
+
+        SimulateCPUWork();
+
+        uint ImageIndex = 0;
+        m_swapChain.AcquireNextImage(Frames.GetImageAvailableSem(), ImageIndex);
+
+        Frames.WaitForImage(ImageIndex);
+
+        RecordCommandBuffer(CmdBuf, ImageIndex, i);
+
+        Frames.Submit(CmdBuf);
+
+        m_swapChain.Present(Frames.GetRenderCompleteSem(ImageIndex), ImageIndex);
+
+        // Stands in for a per-frame resource (e.g. a staging buffer) that the GPU may still read
+        Frames.DeferDestroy([]() { NumDeferredDeletes++; });
+
+        Frames.EndFrame();
+    }
+
+    Frames.WaitIdle();
+
+    double TotalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+    const VulkanFrameStats& Stats = Frames.GetStats();
+
+    printf("Frames in flight %d: %.2f ms/frame (min %.2f max %.2f), CPU blocked %.2f ms/frame (max %.2f), overlap %.0f%%, total %.1f ms\n",
+           NumFramesInFlight, Stats.GetAvgFrameMs(), Stats.MinFrameMs, Stats.MaxFrameMs,
+           Stats.TotalWaitMs / Stats.NumFrames, Stats.MaxWaitMs, Stats.GetOverlap() * 100.0, TotalMs);
+}
+
+
+// Every other frame is dropped right after BeginFrame() - what the render loop
+// does when the swap chain is out of date and the image cannot be acquired - and
+// the next frame begins on the same slot. Blocks forever if BeginFrame() leaves
+// the fence of the slot unsignaled.
+void FramesTest::RunWithAbandonedFrames(int NumFramesInFlight)
+{
+    VulkanFramesInFlight Frames;
+
+    Frames.Init(&m_core, m_queue, NumFramesInFlight, m_swapChain.GetNumImages());
+
+    for (int i = 0 ; i < NUM_FRAMES ; i++) {
+        VkCommandBuffer CmdBuf = Frames.BeginFrame();
+
+        if (i % 2) {
+            continue;
+        }
+
+        uint ImageIndex = 0;
+        m_swapChain.AcquireNextImage(Frames.GetImageAvailableSem(), ImageIndex);
+
+        Frames.WaitForImage(ImageIndex);
+
+        RecordCommandBuffer(CmdBuf, ImageIndex, i);
+
+        Frames.Submit(CmdBuf);
+
+        m_swapChain.Present(Frames.GetRenderCompleteSem(ImageIndex), ImageIndex);
+
+        Frames.EndFrame();
+    }
+
+    Frames.WaitIdle();
+
+    printf("Frames in flight %d: %d frames abandoned after BeginFrame()\n", NumFramesInFlight, NUM_FRAMES / 2);
+}
+
+
+int main(int argc, char* argv[])
+{
+    FramesTest Test;
+
+    Test.Init();
+
+    for (int NumFramesInFlight = 1 ; NumFramesInFlight <= 3 ; NumFramesInFlight++) {
+        NumDeferredDeletes = 0;
+
+        Test.Run(NumFramesInFlight);
+
+        if (NumDeferredDeletes != NUM_FRAMES) {
+            printf("Error: %d deferred deletes instead of %d\n", NumDeferredDeletes, NUM_FRAMES);
+            return 1;
+        }
+
+        Test.RunWithAbandonedFrames(NumFramesInFlight);
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
@@ -0,0 +1,274 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Headless test for the pipeline cache and VulkanPipelineCompiler. Creates a set of
+// pipeline variants on the main thread and then again on the compiler threads.
+// The first run starts with an empty cache - run it a second time to see the
+// warm start (the cache file is written when the core is destroyed):
+//
+//     rm -f VulkanPipelineCacheTest_pipeline_cache.bin
+//     ./vulkan_pipeline_cache_test      # cold
+//     ./vulkan_pipeline_cache_test      # warm
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "ogldev_vulkan_core.h"
+#include "ogldev_vulkan_pipeline_compiler.h"
+
+#define NUM_CULL_MODES 4
+#define NUM_FRONT_FACES 2
+#define NUM_WRITE_MASKS 8
+#define NUM_VARIANTS (NUM_CULL_MODES * NUM_FRONT_FACES * NUM_WRITE_MASKS)
+
+
+// Everything a variant needs - captured by value by the compile job
+struct PipelineDesc {
+    VkShaderModule VS;
+    VkShaderModule FS;
+    VkPipelineLayout Layout;
+    VkRenderPass RenderPass;
+    VkCullModeFlags CullMode;
+    VkFrontFace FrontFace;
+    VkColorComponentFlags WriteMask;
+};
+
+
+static VkPipeline CreatePipeline(VkDevice Device, VkPipelineCache Cache, const PipelineDesc& Desc)
+{
+    VkPipelineShaderStageCreateInfo shaderStageCreateInfo[2] = {};
+
+    shaderStageCreateInfo[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageCreateInfo[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStageCreateInfo[0].module = Desc.VS;
+    shaderStageCreateInfo[0].pName = "main";
+    shaderStageCreateInfo[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageCreateInfo[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStageCreateInfo[1].module = Desc.FS;
+    shaderStageCreateInfo[1].pName = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo pipelineIACreateInfo = {};
+    pipelineIACreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    pipelineIACreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkViewport vp = {};
+    vp.width  = 1024.0f;
+    vp.height = 1024.0f;
+    vp.maxDepth = 1.0f;
+
+    VkRect2D scissor = {};
+    scissor.extent.width = 1024;
+    scissor.extent.height = 1024;
+
+    VkPipelineViewportStateCreateInfo vpCreateInfo = {};
+    vpCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    vpCreateInfo.viewportCount = 1;
+    vpCreateInfo.pViewports = &vp;
+    vpCreateInfo.scissorCount = 1;
+    vpCreateInfo.pScissors = &scissor;
+
+    VkPipelineRasterizationStateCreateInfo rastCreateInfo = {};
+    rastCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rastCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+    rastCreateInfo.cullMode = Desc.CullMode;
+    rastCreateInfo.frontFace = Desc.FrontFace;
+    rastCreateInfo.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo pipelineMSCreateInfo = {};
+    pipelineMSCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    pipelineMSCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState blendAttachState = {};
+    blendAttachState.colorWriteMask = Desc.WriteMask;
+
+    VkPipelineColorBlendStateCreateInfo blendCreateInfo = {};
+    blendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    blendCreateInfo.logicOp = VK_LOGIC_OP_COPY;
+    blendCreateInfo.attachmentCount = 1;
+    blendCreateInfo.pAttachments = &blendAttachState;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = ARRAY_SIZE_IN_ELEMENTS(shaderStageCreateInfo);
+    pipelineInfo.pStages = &shaderStageCreateInfo[0];
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &pipelineIACreateInfo;
+    pipelineInfo.pViewportState = &vpCreateInfo;
+    pipelineInfo.pRasterizationState = &rastCreateInfo;
+    pipelineInfo.pMultisampleState = &pipelineMSCreateInfo;
+    pipelineInfo.pColorBlendState = &blendCreateInfo;
+    pipelineInfo.layout = Desc.Layout;
+    pipelineInfo.renderPass = Desc.RenderPass;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline Pipeline;
+    VkResult res = vkCreateGraphicsPipelines(Device, Cache, 1, &pipelineInfo, NULL, &Pipeline);
+    CHECK_VULKAN_ERROR("vkCreateGraphicsPipelines error %d\n", res);
+
+    return Pipeline;
+}
+
+
+static VkRenderPass CreateRenderPass(VkDevice Device)
+{
+    VkAttachmentReference attachRef = {};
+    attachRef.attachment = 0;
+    attachRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpassDesc = {};
+    subpassDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpassDesc.colorAttachmentCount = 1;
+    subpassDesc.pColorAttachments = &attachRef;
+
+    VkAttachmentDescription attachDesc = {};
+    attachDesc.format = VK_FORMAT_R8G8B8A8_UNORM;
+    attachDesc.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachDesc.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    VkRenderPassCreateInfo renderPassCreateInfo = {};
+    renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassCreateInfo.attachmentCount = 1;
+    renderPassCreateInfo.pAttachments = &attachDesc;
+    renderPassCreateInfo.subpassCount = 1;
+    renderPassCreateInfo.pSubpasses = &subpassDesc;
+
+    VkRenderPass RenderPass;
+    VkResult res = vkCreateRenderPass(Device, &renderPassCreateInfo, NULL, &RenderPass);
+    CHECK_VULKAN_ERROR("vkCreateRenderPass error %d\n", res);
+
+    return RenderPass;
+}
+
+
+static double GetElapsedMs(std::chrono::steady_clock::time_point Start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+
+int main(int argc, char* argv[])
+{
+    OgldevVulkanCore Core("VulkanPipelineCacheTest");
+    Core.InitHeadless();
+
+    VkDevice Device = Core.GetDevice();
+
+    VkPipelineLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+    VkPipelineLayout Layout;
+    VkResult res = vkCreatePipelineLayout(Device, &layoutInfo, NULL, &Layout);
+    CHECK_VULKAN_ERROR("vkCreatePipelineLayout error %d\n", res);
+
+    VkRenderPass RenderPass = CreateRenderPass(Device);
+
+    std::vector<PipelineDesc> Descs;
+
+    for (int c = 0 ; c < NUM_CULL_MODES ; c++) {
+        for (int f = 0 ; f < NUM_FRONT_FACES ; f++) {
+            for (int m = 0 ; m < NUM_WRITE_MASKS ; m++) {
+                // New shader modules for each variant so the driver can't reuse the compiled
+                // shaders by module identity and has to go through the pipeline cache
+                PipelineDesc Desc;
+                Desc.VS = VulkanCreateShaderModule(Device, "../../tutorial52/Shaders/vs.spv");
+                Desc.FS = VulkanCreateShaderModule(Device, "../../tutorial52/Shaders/fs.spv");
+                Desc.Layout = Layout;
+                Desc.RenderPass = RenderPass;
+                Desc.CullMode = (VkCullModeFlags)c;
+                Desc.FrontFace = (VkFrontFace)f;
+                Desc.WriteMask = 0x8 | (VkColorComponentFlags)m;
+                Descs.push_back(Desc);
+            }
+        }
+    }
+
+    std::vector<VkPipeline> Pipelines(NUM_VARIANTS, VK_NULL_HANDLE);
+
+    auto Start = std::chrono::steady_clock::now();
+
+    for (int i = 0 ; i < NUM_VARIANTS ; i++) {
+        Pipelines[i] = CreatePipeline(Device, Core.GetPipelineCache(), Descs[i]);
+    }
+
+    printf("Main thread: %d pipelines in %.2f ms\n", NUM_VARIANTS, GetElapsedMs(Start));
+
+    for (int i = 0 ; i < NUM_VARIANTS ; i++) {
+        vkDestroyPipeline(Device, Pipelines[i], NULL);
+        Pipelines[i] = VK_NULL_HANDLE;
+    }
+
+    JobSystem Jobs;
+    VulkanPipelineCompiler Compiler;
+    Compiler.Init(&Core, &Jobs);
+
+    Start = std::chrono::steady_clock::now();
+
+    int NumReady = 0;
+
+    for (int i = 0 ; i < NUM_VARIANTS ; i++) {
+        PipelineDesc Desc = Descs[i];
+
+        Compiler.Compile([Desc](VkDevice d, VkPipelineCache c) { return CreatePipeline(d, c, Desc); },
+                         [&Pipelines, &NumReady, i](VkPipeline p) { Pipelines[i] = p; NumReady++; });
+    }
+
+    double QueueMs = GetElapsedMs(Start);
+
+    // A real app would keep rendering with a fallback material here and call Update() every frame
+    Compiler.WaitAll();
+
+    printf("Compiler on %d threads: %d pipelines in %.2f ms (%.2f ms to queue)\n", Jobs.GetNumThreads(), NUM_VARIANTS, GetElapsedMs(Start), QueueMs);
+
+    Compiler.Destroy();
+
+    bool ok = (NumReady == NUM_VARIANTS);
+
+    for (int i = 0 ; i < NUM_VARIANTS ; i++) {
+        if (Pipelines[i] == VK_NULL_HANDLE) {
+            ok = false;
+        }
+
+        vkDestroyPipeline(Device, Pipelines[i], NULL);
+        vkDestroyShaderModule(Device, Descs[i].VS, NULL);
+        vkDestroyShaderModule(Device, Descs[i].FS, NULL);
+    }
+
+    vkDestroyRenderPass(Device, RenderPass, NULL);
+    vkDestroyPipelineLayout(Device, Layout, NULL);
+
+    if (!ok) {
+        printf("Error: %d of %d pipelines are ready\n", NumReady, NUM_VARIANTS);
+        return 1;
+    }
+
+    printf("All tests passed\n");
+
+    return 0;
+}
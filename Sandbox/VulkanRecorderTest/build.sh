@@ -0,0 +1,7 @@
+#!/bin/bash
+
+CC=g++
+CPPFLAGS="-ggdb3 -O2 -I../../Include -DVULKAN -DOGLDEV_VULKAN"
+LDFLAGS="`pkg-config --libs vulkan` -lpthread"
+
+$CC vulkan_recorder_test.cpp ../../Common/ogldev_vulkan.cpp ../../Common/ogldev_vulkan_core.cpp ../../Common/ogldev_vulkan_frames.cpp ../../Common/ogldev_vulkan_recorder.cpp ../../Common/ogldev_util.cpp ../../Common/ogldev_mapped_file.cpp $CPPFLAGS $LDFLAGS -o vulkan_recorder_test
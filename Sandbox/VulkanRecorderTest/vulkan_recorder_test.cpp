@@ -0,0 +1,269 @@
+/*
+
+        Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+//
+// Headless benchmark for VulkanParallelRecorder. Every frame records NUM_DRAWS small
+// clears (standing in for draw calls) into secondary command buffers, first on one
+// thread and then on all the cores, and prints the CPU time spent recording.
+// Works on a software device such as lavapipe:
+//
+//     VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./vulkan_recorder_test
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "ogldev_vulkan_core.h"
+#include "ogldev_vulkan_frames.h"
+#include "ogldev_vulkan_recorder.h"
+
+#define WINDOW_WIDTH 1280
+#define WINDOW_HEIGHT 720
+#define NUM_SWAP_CHAIN_IMAGES 3
+#define NUM_FRAMES_IN_FLIGHT 2
+#define NUM_FRAMES 100
+#define NUM_DRAWS 20000
+#define RECT_SIZE 8
+#define CPU_WORK_PER_DRAW 200       // simulates the culling and state setup of a draw
+
+
+class RecorderTest
+{
+public:
+
+    RecorderTest() : m_core("VulkanRecorderTest") {}
+
+    ~RecorderTest();
+
+    void Init();
+
+    double Run(int NumThreads);
+
+private:
+
+    void CreateRenderPass();
+    void CreateFramebuffers();
+    void RecordDraws(VkCommandBuffer CmdBuf, int Start, int End, int Frame);
+
+    OgldevVulkanCore m_core;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    VulkanOffscreenSwapChain m_swapChain;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    std::vector<VkFramebuffer> m_fbs;
+};
+
+
+RecorderTest::~RecorderTest()
+{
+    for (uint i = 0 ; i < m_fbs.size() ; i++) {
+        vkDestroyFramebuffer(m_core.GetDevice(), m_fbs[i], NULL);
+    }
+
+    vkDestroyRenderPass(m_core.GetDevice(), m_renderPass, NULL);
+}
+
+
+void RecorderTest::Init()
+{
+    m_core.InitHeadless();
+
+    vkGetDeviceQueue(m_core.GetDevice(), m_core.GetQueueFamily(), 0, &m_queue);
+
+    m_swapChain.Init(&m_core, m_queue, WINDOW_WIDTH, WINDOW_HEIGHT, NUM_SWAP_CHAIN_IMAGES);
+
+    CreateRenderPass();
+    CreateFramebuffers();
+}
+
+
+void RecorderTest::CreateRenderPass()
+{
+    VkAttachmentReference attachRef = {};
+    attachRef.attachment = 0;
+    attachRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpassDesc = {};
+    subpassDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpassDesc.colorAttachmentCount = 1;
+    subpassDesc.pColorAttachments = &attachRef;
+
+    VkAttachmentDescription attachDesc = {};
+    attachDesc.format = m_swapChain.GetFormat();
+    attachDesc.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachDesc.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    VkRenderPassCreateInfo renderPassCreateInfo = {};
+    renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassCreateInfo.attachmentCount = 1;
+    renderPassCreateInfo.pAttachments = &attachDesc;
+    renderPassCreateInfo.subpassCount = 1;
+    renderPassCreateInfo.pSubpasses = &subpassDesc;
+
+    VkResult res = vkCreateRenderPass(m_core.GetDevice(), &renderPassCreateInfo, NULL, &m_renderPass);
+    CHECK_VULKAN_ERROR("vkCreateRenderPass error %d\n", res);
+}
+
+
+void RecorderTest::CreateFramebuffers()
+{
+    m_fbs.resize(m_swapChain.GetNumImages());
+
+    for (uint i = 0 ; i < m_fbs.size() ; i++) {
+        VkImageView View = m_swapChain.GetImageView(i);
+
+        VkFramebufferCreateInfo fbCreateInfo = {};
+        fbCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        fbCreateInfo.renderPass = m_renderPass;
+        fbCreateInfo.attachmentCount = 1;
+        fbCreateInfo.pAttachments = &View;
+        fbCreateInfo.width = WINDOW_WIDTH;
+        fbCreateInfo.height = WINDOW_HEIGHT;
+        fbCreateInfo.layers = 1;
+
+        VkResult res = vkCreateFramebuffer(m_core.GetDevice(), &fbCreateInfo, NULL, &m_fbs[i]);
+        CHECK_VULKAN_ERROR("vkCreateFramebuffer error %d\n", res);
+    }
+}
+
+
+void RecorderTest::RecordDraws(VkCommandBuffer CmdBuf, int Start, int End, int Frame)
+{
+    const int RectsPerRow = WINDOW_WIDTH / RECT_SIZE;
+    const int RectsPerColumn = WINDOW_HEIGHT / RECT_SIZE;
+
+    for (int i = Start ; i < End ; i++) {
+        // Busy work so that the recording is not only driver overhead
+        volatile float Dummy = 0.0f;
+        for (int j = 0 ; j < CPU_WORK_PER_DRAW ; j++) {
+            Dummy = Dummy + (float)j * 0.5f;
+        }
+
+        int Cell = (i + Frame) % (RectsPerRow * RectsPerColumn);
+
+        VkClearAttachment clearAttach = {};
+        clearAttach.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        clearAttach.colorAttachment = 0;
+        clearAttach.clearValue.color.float32[0] = (float)(i % 256) / 255.0f;
+        clearAttach.clearValue.color.float32[1] = 0.5f;
+        clearAttach.clearValue.color.float32[2] = 0.0f;
+        clearAttach.clearValue.color.float32[3] = 1.0f;
+
+        VkClearRect clearRect = {};
+        clearRect.rect.offset.x = (Cell % RectsPerRow) * RECT_SIZE;
+        clearRect.rect.offset.y = (Cell / RectsPerRow) * RECT_SIZE;
+        clearRect.rect.extent.width = RECT_SIZE;
+        clearRect.rect.extent.height = RECT_SIZE;
+        clearRect.baseArrayLayer = 0;
+        clearRect.layerCount = 1;
+
+        vkCmdClearAttachments(CmdBuf, 1, &clearAttach, 1, &clearRect);
+    }
+}
+
+
+// Returns the average recording time of a frame in milliseconds
+double RecorderTest::Run(int NumThreads)
+{
+    VulkanFramesInFlight Frames;
+    Frames.Init(&m_core, m_queue, NUM_FRAMES_IN_FLIGHT, m_swapChain.GetNumImages());
+
+    VulkanParallelRecorder Recorder;
+    Recorder.Init(&m_core, NUM_FRAMES_IN_FLIGHT, NumThreads);
+
+    double TotalRecordMs = 0.0;
+
+    for (int i = 0 ; i < NUM_FRAMES ; i++) {
+        VkCommandBuffer CmdBuf = Frames.BeginFrame();
+
+        Recorder.BeginFrame(Frames.GetCurFrame());
+
+        uint ImageIndex = 0;
+        m_swapChain.AcquireNextImage(Frames.GetImageAvailableSem(), ImageIndex);
+
+        Frames.WaitForImage(ImageIndex);
+
+        auto Start = std::chrono::steady_clock::now();
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        VkResult res = vkBeginCommandBuffer(CmdBuf, &beginInfo);
+        CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
+
+        VkClearValue clearValue = {};
+        clearValue.color.float32[3] = 1.0f;
+
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_renderPass;
+        renderPassInfo.framebuffer = m_fbs[ImageIndex];
+        renderPassInfo.renderArea.extent.width = WINDOW_WIDTH;
+        renderPassInfo.renderArea.extent.height = WINDOW_HEIGHT;
+        renderPassInfo.clearValueCount = 1;
+        renderPassInfo.pClearValues = &clearValue;
+
+        vkCmdBeginRenderPass(CmdBuf, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        Recorder.Record(CmdBuf, m_renderPass, 0, m_fbs[ImageIndex], NUM_DRAWS,
+                        [&](VkCommandBuffer c, int First, int Last) { RecordDraws(c, First, Last, i); });
+
+        vkCmdEndRenderPass(CmdBuf);
+
+        res = vkEndCommandBuffer(CmdBuf);
+        CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
+
+        TotalRecordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+        Frames.Submit(CmdBuf);
+
+        m_swapChain.Present(Frames.GetRenderCompleteSem(ImageIndex), ImageIndex);
+
+        Frames.EndFrame();
+    }
+
+    Frames.WaitIdle();
+
+    Recorder.Destroy();
+    Frames.Destroy();
+
+    return TotalRecordMs / NUM_FRAMES;
+}
+
+
+int main(int argc, char* argv[])
+{
+    RecorderTest Test;
+
+    Test.Init();
+
+    double SingleMs = Test.Run(1);
+    printf("1 thread: %.2f ms to record %d draws\n", SingleMs, NUM_DRAWS);
+
+    double ParallelMs = Test.Run(0);
+    printf("All cores: %.2f ms to record %d draws (%.2fx)\n", ParallelMs, NUM_DRAWS, SingleMs / ParallelMs);
+
+    return 0;
+}
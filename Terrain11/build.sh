@@ -13,11 +13,14 @@ SOURCES="terrain_demo11.cpp \
 	terrain.cpp \
 	lod_manager.cpp \
 	$OGLDEV_DIR/Common/ogldev_util.cpp \
+	$OGLDEV_DIR/Common/ogldev_index_encoder.cpp \
+	$OGLDEV_DIR/Common/ogldev_mapped_file.cpp \
 	$OGLDEV_DIR/Common/math_3d.cpp \
 	$OGLDEV_DIR/Common/ogldev_basic_glfw_camera.cpp \
 	$OGLDEV_DIR/Common/ogldev_glfw.cpp \
 	$OGLDEV_DIR/Common/ogldev_stb_image.cpp \
 	$OGLDEV_DIR/Common/technique.cpp \
+	$OGLDEV_DIR/Common/ogldev_gl_state.cpp \
 	$OGLDEV_DIR/Common/ogldev_texture.cpp \
 	$OGLDEV_DIR/Common/cubemap_texture.cpp \
 	$OGLDEV_DIR/Common/ogldev_skybox.cpp \
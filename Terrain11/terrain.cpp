@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "terrain.h"
+#include "ogldev_mapped_file.h"
 #include "texture_config.h"
 #include "3rdparty/stb_image_write.h"
 
@@ -121,24 +122,32 @@ void BaseTerrain::LoadFromFile(const char* pFilename)
 
 void BaseTerrain::LoadHeightMapFile(const char* pFilename)
 {
-    int FileSize = 0;
-    unsigned char* p = (unsigned char*)ReadBinaryFile(pFilename, FileSize);
+    MappedFile File;
+
+    if (!File.Open(pFilename)) {
+        OGLDEV_FILE_ERROR(pFilename);
+        exit(0);
+    }
+
+    u64 FileSize = File.GetSize();
 
     if (FileSize % sizeof(float) != 0) {
-        printf("%s:%d - '%s' does not contain an whole number of floats (size %d)\n", __FILE__, __LINE__, pFilename, FileSize);
+        printf("%s:%d - '%s' does not contain an whole number of floats (size %llu)\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_terrainSize = (int)sqrtf((float)FileSize / (float)sizeof(float));
+    m_terrainSize = (int)sqrt((double)FileSize / (double)sizeof(float));
 
     printf("Terrain size %d\n", m_terrainSize);
 
-    if ((m_terrainSize * m_terrainSize) != (FileSize / sizeof(float))) {
-        printf("%s:%d - '%s' does not contain a square height map - size %d\n", __FILE__, __LINE__, pFilename, FileSize);
+    if ((u64)m_terrainSize * m_terrainSize != (FileSize / sizeof(float))) {
+        printf("%s:%d - '%s' does not contain a square height map - size %llu\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize, (float*)p);
+    // The height map is modified later so it gets its own copy of the mapped pages
+    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize);
+    memcpy(m_heightMap.GetBaseAddr(), File.GetData(), FileSize);
 }
 
 
@@ -5,19 +5,28 @@ CC=g++
 CPPFLAGS=`pkg-config --cflags glew glfw3 assimp`
 CPPFLAGS="$CPPFLAGS -I$OGLDEV_DIR/Include -I$OGLDEV_DIR/Common/3rdparty/ImGui/GLFW -ggdb3"
 LDFLAGS=`pkg-config --libs glew glfw3 assimp`
-LDFLAGS="$LDFLAGS -lX11 -ldl -lmeshoptimizer"
+LDFLAGS="$LDFLAGS -lX11 -ldl -lmeshoptimizer -lpthread"
 SOURCES="terrain_demo12.cpp \
 	geomip_grid.cpp \
 	terrain_technique.cpp \
 	midpoint_disp_terrain.cpp \
 	terrain.cpp \
 	lod_manager.cpp \
+	height_tile_streamer.cpp \
+	clipmap.cpp \
+	clipmap_renderer.cpp \
+	clipmap_technique.cpp \
+	terrain_brush.cpp \
+	terrain_query.cpp \
 	$OGLDEV_DIR/Common/ogldev_util.cpp \
+	$OGLDEV_DIR/Common/ogldev_index_encoder.cpp \
+	$OGLDEV_DIR/Common/ogldev_mapped_file.cpp \
 	$OGLDEV_DIR/Common/math_3d.cpp \
 	$OGLDEV_DIR/Common/ogldev_basic_glfw_camera.cpp \
 	$OGLDEV_DIR/Common/ogldev_glfw.cpp \
 	$OGLDEV_DIR/Common/ogldev_stb_image.cpp \
 	$OGLDEV_DIR/Common/technique.cpp \
+	$OGLDEV_DIR/Common/ogldev_gl_state.cpp \
 	$OGLDEV_DIR/Common/ogldev_texture.cpp \
 	$OGLDEV_DIR/Common/cubemap_texture.cpp \
 	$OGLDEV_DIR/Common/ogldev_skydome.cpp \
@@ -0,0 +1,356 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ogldev_util.h"
+#include "clipmap.h"
+
+
+static int FloorDiv(int a, int b)
+{
+    return (a >= 0) ? (a / b) : -((-a + b - 1) / b);
+}
+
+
+static ClipmapRect Intersect(const ClipmapRect& a, const ClipmapRect& b)
+{
+    return ClipmapRect(std::max(a.x0, b.x0), std::max(a.z0, b.z0), std::min(a.x1, b.x1), std::min(a.z1, b.z1));
+}
+
+
+void Clipmap::Init(HeightTileStreamer* pStreamer, int NumLevels, int LevelSize, float WorldScale)
+{
+    if ((LevelSize < 16) || ((LevelSize & (LevelSize - 1)) != 0)) {
+        printf("%s:%d - the clipmap level size must be a power of two of at least 16 (got %d)\n", __FILE__, __LINE__, LevelSize);
+        exit(0);
+    }
+
+    m_pStreamer = pStreamer;
+    m_levelSize = LevelSize;
+    m_textureSize = LevelSize + 1;
+    m_tileSize = pStreamer->GetTileSize();
+    m_worldScale = WorldScale;
+
+    m_levels.clear();
+    m_levels.resize(NumLevels);
+
+    for (int l = 0 ; l < NumLevels ; l++) {
+        m_levels[l].Heights.assign(m_textureSize * m_textureSize, 0.0f);
+    }
+}
+
+
+int Clipmap::GetMaxResidentTiles(int NumLevels, int LevelSize, int TileSize)
+{
+    // A window of LevelSize + 1 vertices touches at most this many tiles per side
+    int TilesPerSide = (LevelSize + TileSize - 1) / TileSize + 1;
+
+    return NumLevels * TilesPerSide * TilesPerSide;
+}
+
+
+void Clipmap::Update(const Vector3f& CameraPos)
+{
+    m_pStreamer->BeginFrame();
+
+    for (int l = 0 ; l < (int)m_levels.size() ; l++) {
+        float Spacing = GetSpacing(l);
+
+        // Even origins line up with the vertices of the next level
+        int OriginX = 2 * (int)floorf(CameraPos.x / (Spacing * 2.0f)) - m_levelSize / 2;
+        int OriginZ = 2 * (int)floorf(CameraPos.z / (Spacing * 2.0f)) - m_levelSize / 2;
+
+        MoveLevel(l, OriginX, OriginZ);
+    }
+
+    // The coarse levels first - they are the fallback while the fine ones load
+    for (int l = (int)m_levels.size() - 1 ; l >= 0 ; l--) {
+        float TileWorldSize = GetSpacing(l) * (float)m_tileSize;
+        int CameraTileX = (int)floorf(CameraPos.x / TileWorldSize);
+        int CameraTileZ = (int)floorf(CameraPos.z / TileWorldSize);
+
+        ProcessPending(l, CameraTileX, CameraTileZ);
+    }
+}
+
+
+ClipmapRect Clipmap::GetWindow(int l) const
+{
+    const LevelData& lvl = m_levels[l];
+
+    return ClipmapRect(lvl.OriginX, lvl.OriginZ, lvl.OriginX + m_textureSize, lvl.OriginZ + m_textureSize);
+}
+
+
+void Clipmap::MoveLevel(int l, int OriginX, int OriginZ)
+{
+    LevelData& lvl = m_levels[l];
+
+    int OldOriginX = lvl.OriginX;
+    int OldOriginZ = lvl.OriginZ;
+    bool WasPlaced = lvl.IsPlaced;
+
+    if (WasPlaced && (OriginX == OldOriginX) && (OriginZ == OldOriginZ)) {
+        return;
+    }
+
+    lvl.OriginX = OriginX;
+    lvl.OriginZ = OriginZ;
+    lvl.IsPlaced = true;
+
+    ClipmapRect Window = GetWindow(l);
+
+    if (!WasPlaced || (abs(OriginX - OldOriginX) >= m_textureSize) || (abs(OriginZ - OldOriginZ) >= m_textureSize)) {
+        lvl.Pending.clear();
+        AddPending(l, Window);
+        return;
+    }
+
+    // Whatever is still pending must be inside the new window
+    int NumPending = 0;
+
+    for (const ClipmapRect& r : lvl.Pending) {
+        ClipmapRect Clipped = Intersect(r, Window);
+
+        if (!Clipped.IsEmpty()) {
+            lvl.Pending[NumPending++] = Clipped;
+        }
+    }
+
+    lvl.Pending.resize(NumPending);
+
+    // The columns that entered the window, full height...
+    ClipmapRect Columns;
+
+    if (OriginX > OldOriginX) {
+        Columns = ClipmapRect(OldOriginX + m_textureSize, Window.z0, Window.x1, Window.z1);
+    } else if (OriginX < OldOriginX) {
+        Columns = ClipmapRect(Window.x0, Window.z0, OldOriginX, Window.z1);
+    }
+
+    if (!Columns.IsEmpty()) {
+        AddPending(l, Columns);
+    }
+
+    // ...and the rows that entered it, without the columns
+    int x0 = std::max(OriginX, OldOriginX);
+    int x1 = std::min(OriginX, OldOriginX) + m_textureSize;
+    ClipmapRect Rows;
+
+    if (OriginZ > OldOriginZ) {
+        Rows = ClipmapRect(x0, OldOriginZ + m_textureSize, x1, Window.z1);
+    } else if (OriginZ < OldOriginZ) {
+        Rows = ClipmapRect(x0, Window.z0, x1, OldOriginZ);
+    }
+
+    if (!Rows.IsEmpty()) {
+        AddPending(l, Rows);
+    }
+}
+
+
+// Splits the rect along the tile boundaries
+void Clipmap::AddPending(int l, const ClipmapRect& Rect)
+{
+    int FirstTileX = FloorDiv(Rect.x0, m_tileSize);
+    int FirstTileZ = FloorDiv(Rect.z0, m_tileSize);
+    int LastTileX = FloorDiv(Rect.x1 - 1, m_tileSize);
+    int LastTileZ = FloorDiv(Rect.z1 - 1, m_tileSize);
+
+    for (int tz = FirstTileZ ; tz <= LastTileZ ; tz++) {
+        for (int tx = FirstTileX ; tx <= LastTileX ; tx++) {
+            ClipmapRect Tile(tx * m_tileSize, tz * m_tileSize, (tx + 1) * m_tileSize, (tz + 1) * m_tileSize);
+            m_levels[l].Pending.push_back(Intersect(Rect, Tile));
+        }
+    }
+}
+
+
+void Clipmap::ProcessPending(int l, int CameraTileX, int CameraTileZ)
+{
+    LevelData& lvl = m_levels[l];
+    int NumLevels = (int)m_levels.size();
+    int NumPending = 0;
+
+    for (int i = 0 ; i < (int)lvl.Pending.size() ; i++) {
+        ClipmapRect r = lvl.Pending[i];
+        HeightTileKey Key(l, FloorDiv(r.x0, m_tileSize), FloorDiv(r.z0, m_tileSize));
+
+        const float* pTile = m_pStreamer->GetTile(Key);
+
+        if (pTile) {
+            CopyFromTile(l, r, Key, pTile);
+            lvl.Dirty.push_back(r);
+        } else {
+            // Coarse levels first, then by distance from the camera
+            int Distance = std::max(abs(Key.x - CameraTileX), abs(Key.z - CameraTileZ));
+            int Priority = (NumLevels - 1 - l) * 0x10000 + std::min(Distance, 0xffff);
+            m_pStreamer->RequestTile(Key, Priority);
+            lvl.Pending[NumPending++] = r;
+        }
+    }
+
+    lvl.Pending.resize(NumPending);
+}
+
+
+void Clipmap::CopyFromTile(int l, const ClipmapRect& Rect, const HeightTileKey& Key, const float* pTile)
+{
+    float* pHeights = m_levels[l].Heights.data();
+
+    int TileX0 = Key.x * m_tileSize;
+    int TileZ0 = Key.z * m_tileSize;
+
+    // The rect is at most one texture wide so a row wraps at most once
+    int Width = Rect.x1 - Rect.x0;
+    int DstX = Wrap(Rect.x0);
+    int FirstPart = std::min(Width, m_textureSize - DstX);
+
+    for (int z = Rect.z0 ; z < Rect.z1 ; z++) {
+        const float* pSrc = pTile + (z - TileZ0) * m_tileSize + (Rect.x0 - TileX0);
+        float* pDstRow = pHeights + Wrap(z) * m_textureSize;
+
+        memcpy(pDstRow + DstX, pSrc, FirstPart * sizeof(float));
+
+        if (FirstPart < Width) {
+            memcpy(pDstRow, pSrc + FirstPart, (Width - FirstPart) * sizeof(float));
+        }
+    }
+}
+
+
+void Clipmap::GetHoleOffset(int Level, int& x, int& z) const
+{
+    assert(Level > 0);
+
+    x = m_levels[Level - 1].OriginX / 2 - m_levels[Level].OriginX;
+    z = m_levels[Level - 1].OriginZ / 2 - m_levels[Level].OriginZ;
+}
+
+
+bool Clipmap::IsLevelComplete(int Level) const
+{
+    return m_levels[Level].IsPlaced && m_levels[Level].Pending.empty();
+}
+
+
+int Clipmap::GetFinestCompleteLevel() const
+{
+    int Finest = -1;
+
+    for (int l = (int)m_levels.size() - 1 ; l >= 0 ; l--) {
+        if (!IsLevelComplete(l)) {
+            break;
+        }
+
+        Finest = l;
+    }
+
+    return Finest;
+}
+
+
+float Clipmap::GetLevelHeight(int Level, int x, int z) const
+{
+    return m_levels[Level].Heights[Wrap(z) * m_textureSize + Wrap(x)];
+}
+
+
+void Clipmap::GetDirtyRects(int Level, std::vector<ClipmapRect>& Rects)
+{
+    LevelData& lvl = m_levels[Level];
+    ClipmapRect Window = GetWindow(Level);
+
+    Rects.clear();
+
+    for (const ClipmapRect& Dirty : lvl.Dirty) {
+        // Parts that left the window were overwritten or are not needed
+        ClipmapRect r = Intersect(Dirty, Window);
+
+        if (r.IsEmpty()) {
+            continue;
+        }
+
+        int x0 = Wrap(r.x0);
+        int z0 = Wrap(r.z0);
+        int x1 = x0 + (r.x1 - r.x0);
+        int z1 = z0 + (r.z1 - r.z0);
+
+        // Split where the texture wraps around
+        int SplitX = std::min(x1, m_textureSize);
+        int SplitZ = std::min(z1, m_textureSize);
+
+        Rects.push_back(ClipmapRect(x0, z0, SplitX, SplitZ));
+
+        if (x1 > m_textureSize) {
+            Rects.push_back(ClipmapRect(0, z0, x1 - m_textureSize, SplitZ));
+        }
+
+        if (z1 > m_textureSize) {
+            Rects.push_back(ClipmapRect(x0, 0, SplitX, z1 - m_textureSize));
+        }
+
+        if ((x1 > m_textureSize) && (z1 > m_textureSize)) {
+            Rects.push_back(ClipmapRect(0, 0, x1 - m_textureSize, z1 - m_textureSize));
+        }
+    }
+
+    lvl.Dirty.clear();
+}
+
+
+float Clipmap::GetHeight(float x, float z) const
+{
+    int Finest = GetFinestCompleteLevel();
+
+    if (Finest < 0) {
+        return 0.0f;
+    }
+
+    for (int l = Finest ; l < (int)m_levels.size() ; l++) {
+        float Spacing = GetSpacing(l);
+        float GridX = x / Spacing;
+        float GridZ = z / Spacing;
+        int x0 = (int)floorf(GridX);
+        int z0 = (int)floorf(GridZ);
+
+        const LevelData& lvl = m_levels[l];
+
+        if ((x0 < lvl.OriginX) || (x0 >= lvl.OriginX + m_levelSize) ||
+            (z0 < lvl.OriginZ) || (z0 >= lvl.OriginZ + m_levelSize)) {
+            continue;
+        }
+
+        float FactorX = GridX - (float)x0;
+        float FactorZ = GridZ - (float)z0;
+
+        float h00 = GetLevelHeight(l, x0, z0);
+        float h10 = GetLevelHeight(l, x0 + 1, z0);
+        float h01 = GetLevelHeight(l, x0, z0 + 1);
+        float h11 = GetLevelHeight(l, x0 + 1, z0 + 1);
+
+        float Bottom = (h10 - h00) * FactorX + h00;
+        float Top = (h11 - h01) * FactorX + h01;
+
+        return (Top - Bottom) * FactorZ + Bottom;
+    }
+
+    return 0.0f;
+}
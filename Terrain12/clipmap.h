@@ -0,0 +1,137 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLIPMAP_H
+#define CLIPMAP_H
+
+#include <vector>
+
+#include "ogldev_math_3d.h"
+#include "height_tile_streamer.h"
+
+// Half open [x0, x1) x [z0, z1)
+struct ClipmapRect {
+    int x0 = 0;
+    int z0 = 0;
+    int x1 = 0;
+    int z1 = 0;
+
+    ClipmapRect() {}
+
+    ClipmapRect(int _x0, int _z0, int _x1, int _z1) : x0(_x0), z0(_z0), x1(_x1), z1(_z1) {}
+
+    bool IsEmpty() const { return (x0 >= x1) || (z0 >= z1); }
+};
+
+
+//
+// The CPU side of a geometry clipmap. Every level is a grid of LevelSize x
+// LevelSize cells centered on the camera. The vertices of level L are
+// WorldScale * 2^L apart so each level covers four times the area of the one
+// inside it, and the memory doesn't depend on the size of the world.
+//
+// The heights of a level live in a (LevelSize + 1)^2 array that is addressed
+// toroidally - vertex (x, z) is at (x mod size, z mod size). When the camera
+// moves only the rows and columns that enter the level are copied from the
+// height tiles, and only they need to be uploaded to the GPU.
+//
+// The origin of level L is kept on even vertices so that it lines up with
+// the vertices of level L + 1. That leaves the finer level one of four
+// positions inside the coarser one (see GetHoleOffset).
+//
+class Clipmap
+{
+public:
+    Clipmap() {}
+
+    // LevelSize is in cells - a power of two, at least 16
+    void Init(HeightTileStreamer* pStreamer, int NumLevels, int LevelSize, float WorldScale);
+
+    // Moves the levels with the camera, requests the tiles that are missing
+    // and copies the ones that have arrived
+    void Update(const Vector3f& CameraPos);
+
+    int GetNumLevels() const { return (int)m_levels.size(); }
+
+    int GetLevelSize() const { return m_levelSize; }
+
+    int GetTextureSize() const { return m_levelSize + 1; }
+
+    float GetWorldScale() const { return m_worldScale; }
+
+    float GetSpacing(int Level) const { return m_worldScale * (float)(1 << Level); }
+
+    // Grid coordinates of the first vertex of the level
+    int GetOriginX(int Level) const { return m_levels[Level].OriginX; }
+
+    int GetOriginZ(int Level) const { return m_levels[Level].OriginZ; }
+
+    // Where the next finer level starts, in cells of this level
+    void GetHoleOffset(int Level, int& x, int& z) const;
+
+    bool IsLevelComplete(int Level) const;
+
+    // The finest level that is complete together with all the levels above
+    // it. -1 if even the coarsest level is still loading.
+    int GetFinestCompleteLevel() const;
+
+    const float* GetLevelHeights(int Level) const { return m_levels[Level].Heights.data(); }
+
+    float GetLevelHeight(int Level, int x, int z) const;
+
+    // Returns the texels that changed since the previous call, already
+    // wrapped into [0, GetTextureSize())
+    void GetDirtyRects(int Level, std::vector<ClipmapRect>& Rects);
+
+    // Bilinear height at a world position from the finest complete level
+    float GetHeight(float x, float z) const;
+
+    // Enough tiles for the worst case of a single frame
+    static int GetMaxResidentTiles(int NumLevels, int LevelSize, int TileSize);
+
+private:
+
+    struct LevelData {
+        int OriginX = 0;
+        int OriginZ = 0;
+        bool IsPlaced = false;
+        std::vector<float> Heights;
+        std::vector<ClipmapRect> Pending;   // one tile each, waiting for the tile
+        std::vector<ClipmapRect> Dirty;     // copied but not picked up by GetDirtyRects
+    };
+
+    void MoveLevel(int l, int OriginX, int OriginZ);
+
+    void AddPending(int l, const ClipmapRect& Rect);
+
+    void ProcessPending(int l, int CameraTileX, int CameraTileZ);
+
+    void CopyFromTile(int l, const ClipmapRect& Rect, const HeightTileKey& Key, const float* pTile);
+
+    ClipmapRect GetWindow(int l) const;
+
+    int Wrap(int v) const { return ((v % m_textureSize) + m_textureSize) % m_textureSize; }
+
+    HeightTileStreamer* m_pStreamer = NULL;
+    int m_levelSize = 0;
+    int m_textureSize = 0;
+    int m_tileSize = 0;
+    float m_worldScale = 1.0f;
+    std::vector<LevelData> m_levels;
+};
+
+#endif
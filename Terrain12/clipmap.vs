@@ -0,0 +1,87 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 330
+
+layout (location = 0) in vec2 GridPos;     // in cells of the level, 0..level size
+
+uniform mat4 gVP;
+uniform sampler2DArray gHeightLevels;
+uniform int gLevel;
+uniform int gTextureSize;
+uniform ivec2 gOriginTexel;     // texel of the first vertex - the levels wrap around
+uniform vec2 gOrigin;           // world XZ of the first vertex
+uniform float gSpacing;         // world distance between the vertices of the level
+uniform vec2 gCameraPos;        // in cells, relative to the first vertex
+uniform float gMorphStart;      // in cells from the camera
+uniform float gMorphWidth;      // zero for the coarsest level
+uniform float gTexScale;
+uniform float gMinHeight;
+uniform float gMaxHeight;
+
+out vec4 Color;
+out vec2 Tex;
+out vec3 WorldPos;
+out vec3 Normal;
+
+
+float GetHeight(ivec2 Cell)
+{
+    Cell = clamp(Cell, ivec2(0), ivec2(gTextureSize - 1));
+    ivec2 Texel = (gOriginTexel + Cell) % gTextureSize;
+    return texelFetch(gHeightLevels, ivec3(Texel, gLevel), 0).r;
+}
+
+
+void main()
+{
+    ivec2 Cell = ivec2(GridPos);
+    float Height = GetHeight(Cell);
+
+    // Towards the outer edge the odd vertices move onto the edges of the
+    // coarser level so the two levels meet without cracks. The diagonal
+    // case follows the diagonal of the triangles.
+    if (gMorphWidth > 0.0) {
+        vec2 d = abs(GridPos - gCameraPos);
+        float Alpha = clamp((max(d.x, d.y) - gMorphStart) / gMorphWidth, 0.0, 1.0);
+        ivec2 Odd = Cell & 1;
+
+        if ((Alpha > 0.0) && ((Odd.x | Odd.y) != 0)) {
+            float CoarseHeight = 0.5 * (GetHeight(Cell - Odd) + GetHeight(Cell + Odd));
+            Height = mix(Height, CoarseHeight, Alpha);
+        }
+    }
+
+    vec2 WorldXZ = gOrigin + GridPos * gSpacing;
+    WorldPos = vec3(WorldXZ.x, Height, WorldXZ.y);
+
+    gl_Position = gVP * vec4(WorldPos, 1.0);
+
+    float DeltaHeight = gMaxHeight - gMinHeight;
+    float HeightRatio = (Height - gMinHeight) / DeltaHeight;
+    float c = HeightRatio * 0.8 + 0.2;
+    Color = vec4(c, c, c, 1.0);
+
+    Tex = WorldXZ * gTexScale;
+
+    float Left = GetHeight(Cell - ivec2(1, 0));
+    float Right = GetHeight(Cell + ivec2(1, 0));
+    float Down = GetHeight(Cell - ivec2(0, 1));
+    float Up = GetHeight(Cell + ivec2(0, 1));
+
+    Normal = vec3(Left - Right, 2.0 * gSpacing, Down - Up);
+}
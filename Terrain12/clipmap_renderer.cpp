@@ -0,0 +1,233 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_util.h"
+#include "ogldev_gl_state.h"
+#include "clipmap_renderer.h"
+#include "texture_config.h"
+
+
+ClipmapRenderer::~ClipmapRenderer()
+{
+    Destroy();
+}
+
+
+void ClipmapRenderer::Destroy()
+{
+    if (m_vao > 0) {
+        glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
+    }
+
+    if (m_vb > 0) {
+        glDeleteBuffers(1, &m_vb);
+        m_vb = 0;
+    }
+
+    if (m_ib > 0) {
+        glDeleteBuffers(1, &m_ib);
+        m_ib = 0;
+    }
+
+    if (m_heightLevels > 0) {
+        glDeleteTextures(1, &m_heightLevels);
+        m_heightLevels = 0;
+    }
+}
+
+
+void ClipmapRenderer::Init(int NumLevels, int LevelSize)
+{
+    Destroy();
+
+    m_numLevels = NumLevels;
+    m_levelSize = LevelSize;
+
+    int TextureSize = LevelSize + 1;
+
+    glGenTextures(1, &m_heightLevels);
+    GLState::BindTexture(HEIGHT_LEVELS_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, m_heightLevels);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, TextureSize, TextureSize, NumLevels, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+
+    CreateGrid();
+}
+
+
+void ClipmapRenderer::CreateGrid()
+{
+    int NumVertsPerSide = m_levelSize + 1;
+
+    std::vector<Vector2f> Vertices;
+    Vertices.reserve(NumVertsPerSide * NumVertsPerSide);
+
+    for (int z = 0 ; z < NumVertsPerSide ; z++) {
+        for (int x = 0 ; x < NumVertsPerSide ; x++) {
+            Vertices.push_back(Vector2f((float)x, (float)z));
+        }
+    }
+
+    // The full grid and then the ring for every position of the hole
+    std::vector<uint> Indices;
+
+    m_firstIndex[FULL_GRID] = 0;
+    AddCells(Indices, -1, -1);
+    m_numIndices[FULL_GRID] = (int)Indices.size();
+
+    int MinHole = m_levelSize / 4;
+
+    for (int i = 1 ; i < NUM_INDEX_RANGES ; i++) {
+        int HoleX = MinHole + ((i - 1) & 1);
+        int HoleZ = MinHole + ((i - 1) >> 1);
+
+        m_firstIndex[i] = (int)Indices.size();
+        AddCells(Indices, HoleX, HoleZ);
+        m_numIndices[i] = (int)Indices.size() - m_firstIndex[i];
+    }
+
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+
+    glGenBuffers(1, &m_vb);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vb);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
+
+    glGenBuffers(1, &m_ib);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
+
+    int POS_LOC = 0;
+
+    glEnableVertexAttribArray(POS_LOC);
+    glVertexAttribPointer(POS_LOC, 2, GL_FLOAT, GL_FALSE, sizeof(Vector2f), (const void*)0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+
+// Two triangles per cell with the same winding as the geomip grid. A
+// negative HoleX means no hole.
+void ClipmapRenderer::AddCells(std::vector<uint>& Indices, int HoleX, int HoleZ) const
+{
+    int NumVertsPerSide = m_levelSize + 1;
+    int HoleSize = m_levelSize / 2;
+
+    for (int z = 0 ; z < m_levelSize ; z++) {
+        for (int x = 0 ; x < m_levelSize ; x++) {
+            if ((HoleX >= 0) &&
+                (x >= HoleX) && (x < HoleX + HoleSize) &&
+                (z >= HoleZ) && (z < HoleZ + HoleSize)) {
+                continue;
+            }
+
+            uint IndexBottomLeft = z * NumVertsPerSide + x;
+            uint IndexBottomRight = IndexBottomLeft + 1;
+            uint IndexTopLeft = IndexBottomLeft + NumVertsPerSide;
+            uint IndexTopRight = IndexTopLeft + 1;
+
+            Indices.push_back(IndexBottomLeft);
+            Indices.push_back(IndexTopLeft);
+            Indices.push_back(IndexTopRight);
+
+            Indices.push_back(IndexBottomLeft);
+            Indices.push_back(IndexTopRight);
+            Indices.push_back(IndexBottomRight);
+        }
+    }
+}
+
+
+void ClipmapRenderer::UploadLevel(Clipmap& Map, int Level)
+{
+    Map.GetDirtyRects(Level, m_dirtyRects);
+
+    if (m_dirtyRects.empty()) {
+        return;
+    }
+
+    int TextureSize = Map.GetTextureSize();
+    const float* pHeights = Map.GetLevelHeights(Level);
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, TextureSize);
+
+    for (const ClipmapRect& r : m_dirtyRects) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, r.x0, r.z0, Level, r.x1 - r.x0, r.z1 - r.z0, 1,
+                        GL_RED, GL_FLOAT, pHeights + r.z0 * TextureSize + r.x0);
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+
+void ClipmapRenderer::Render(Clipmap& Map, ClipmapTechnique& Tech, const Vector3f& CameraPos)
+{
+    GLState::BindTexture(HEIGHT_LEVELS_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, m_heightLevels);
+
+    // Even the levels that are still loading - what arrived doesn't change
+    for (int l = 0 ; l < m_numLevels ; l++) {
+        UploadLevel(Map, l);
+    }
+
+    int Finest = Map.GetFinestCompleteLevel();
+
+    if (Finest < 0) {
+        return;
+    }
+
+    int TextureSize = Map.GetTextureSize();
+    Tech.SetTextureSize(TextureSize);
+
+    // The outer vertices of a level must be fully morphed. The camera is at
+    // least LevelSize / 2 - 2 cells from them.
+    float MorphWidth = (float)(m_levelSize / 8);
+    float MorphStart = (float)(m_levelSize / 2 - 2) - MorphWidth;
+
+    glBindVertexArray(m_vao);
+
+    for (int l = Finest ; l < m_numLevels ; l++) {
+        float Spacing = Map.GetSpacing(l);
+        int OriginX = Map.GetOriginX(l);
+        int OriginZ = Map.GetOriginZ(l);
+
+        int OriginTexelX = ((OriginX % TextureSize) + TextureSize) % TextureSize;
+        int OriginTexelZ = ((OriginZ % TextureSize) + TextureSize) % TextureSize;
+        Vector2f Origin((float)OriginX * Spacing, (float)OriginZ * Spacing);
+
+        Tech.SetLevel(l, OriginTexelX, OriginTexelZ, Origin, Spacing);
+
+        Vector2f LocalCameraPos(CameraPos.x / Spacing - (float)OriginX, CameraPos.z / Spacing - (float)OriginZ);
+        bool IsCoarsest = (l == m_numLevels - 1);
+        Tech.SetMorph(LocalCameraPos, MorphStart, IsCoarsest ? 0.0f : MorphWidth);
+
+        int Range = FULL_GRID;
+
+        if (l > Finest) {
+            int HoleX, HoleZ;
+            Map.GetHoleOffset(l, HoleX, HoleZ);
+            Range = 1 + (HoleX - m_levelSize / 4) + 2 * (HoleZ - m_levelSize / 4);
+        }
+
+        glDrawElements(GL_TRIANGLES, m_numIndices[Range], GL_UNSIGNED_INT, (const void*)(m_firstIndex[Range] * sizeof(uint)));
+    }
+
+    glBindVertexArray(0);
+}
@@ -0,0 +1,71 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLIPMAP_RENDERER_H
+#define CLIPMAP_RENDERER_H
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "clipmap.h"
+#include "clipmap_technique.h"
+
+//
+// Draws a Clipmap. All the levels share one grid of LevelSize x LevelSize
+// cells - the vertex shader scales and displaces it per level using a
+// texture array with a layer per level. The finest level that is drawn
+// uses the whole grid and the others leave a hole for the level inside
+// them. The hole can be in one of four places so there is an index range
+// for each of them.
+//
+class ClipmapRenderer
+{
+public:
+    ClipmapRenderer() {}
+
+    ~ClipmapRenderer();
+
+    void Init(int NumLevels, int LevelSize);
+
+    void Destroy();
+
+    // Uploads the texels that changed and draws the levels that are complete.
+    // The technique must be enabled.
+    void Render(Clipmap& Map, ClipmapTechnique& Tech, const Vector3f& CameraPos);
+
+private:
+
+    enum { FULL_GRID = 0, NUM_INDEX_RANGES = 5 };
+
+    void CreateGrid();
+
+    void AddCells(std::vector<uint>& Indices, int HoleX, int HoleZ) const;
+
+    void UploadLevel(Clipmap& Map, int Level);
+
+    int m_numLevels = 0;
+    int m_levelSize = 0;
+    GLuint m_vao = 0;
+    GLuint m_vb = 0;
+    GLuint m_ib = 0;
+    GLuint m_heightLevels = 0;
+    int m_firstIndex[NUM_INDEX_RANGES] = { 0 };
+    int m_numIndices[NUM_INDEX_RANGES] = { 0 };
+    std::vector<ClipmapRect> m_dirtyRects;
+};
+
+#endif
@@ -0,0 +1,163 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ogldev_util.h"
+#include "clipmap_technique.h"
+#include "texture_config.h"
+
+
+ClipmapTechnique::ClipmapTechnique()
+{
+}
+
+bool ClipmapTechnique::Init()
+{
+    if (!Technique::Init()) {
+        return false;
+    }
+
+    if (!AddShader(GL_VERTEX_SHADER, "clipmap.vs")) {
+        return false;
+    }
+
+    if (!AddShader(GL_FRAGMENT_SHADER, "terrain.fs")) {
+        return false;
+    }
+
+    if (!Finalize()) {
+        return false;
+    }
+
+    m_VPLoc = GetUniformLocation("gVP");
+    m_heightLevelsLoc = GetUniformLocation("gHeightLevels");
+    m_levelLoc = GetUniformLocation("gLevel");
+    m_textureSizeLoc = GetUniformLocation("gTextureSize");
+    m_originTexelLoc = GetUniformLocation("gOriginTexel");
+    m_originLoc = GetUniformLocation("gOrigin");
+    m_spacingLoc = GetUniformLocation("gSpacing");
+    m_cameraPosLoc = GetUniformLocation("gCameraPos");
+    m_morphStartLoc = GetUniformLocation("gMorphStart");
+    m_morphWidthLoc = GetUniformLocation("gMorphWidth");
+    m_texScaleLoc = GetUniformLocation("gTexScale");
+    m_minHeightLoc = GetUniformLocation("gMinHeight");
+    m_maxHeightLoc = GetUniformLocation("gMaxHeight");
+    m_tex0UnitLoc = GetUniformLocation("gTextureHeight0");
+    m_tex1UnitLoc = GetUniformLocation("gTextureHeight1");
+    m_tex2UnitLoc = GetUniformLocation("gTextureHeight2");
+    m_tex3UnitLoc = GetUniformLocation("gTextureHeight3");
+    m_tex0HeightLoc = GetUniformLocation("gHeight0");
+    m_tex1HeightLoc = GetUniformLocation("gHeight1");
+    m_tex2HeightLoc = GetUniformLocation("gHeight2");
+    m_tex3HeightLoc = GetUniformLocation("gHeight3");
+    m_reversedLightDirLoc = GetUniformLocation("gReversedLightDir");
+
+    if (m_VPLoc == INVALID_UNIFORM_LOCATION ||
+        m_heightLevelsLoc == INVALID_UNIFORM_LOCATION ||
+        m_levelLoc == INVALID_UNIFORM_LOCATION ||
+        m_textureSizeLoc == INVALID_UNIFORM_LOCATION ||
+        m_originTexelLoc == INVALID_UNIFORM_LOCATION ||
+        m_originLoc == INVALID_UNIFORM_LOCATION ||
+        m_spacingLoc == INVALID_UNIFORM_LOCATION ||
+        m_cameraPosLoc == INVALID_UNIFORM_LOCATION ||
+        m_morphStartLoc == INVALID_UNIFORM_LOCATION ||
+        m_morphWidthLoc == INVALID_UNIFORM_LOCATION ||
+        m_texScaleLoc == INVALID_UNIFORM_LOCATION ||
+        m_minHeightLoc == INVALID_UNIFORM_LOCATION ||
+        m_maxHeightLoc == INVALID_UNIFORM_LOCATION ||
+        m_tex0UnitLoc == INVALID_UNIFORM_LOCATION ||
+        m_tex1UnitLoc == INVALID_UNIFORM_LOCATION ||
+        m_tex2UnitLoc == INVALID_UNIFORM_LOCATION ||
+        m_tex3UnitLoc == INVALID_UNIFORM_LOCATION ||
+        m_tex0HeightLoc == INVALID_UNIFORM_LOCATION ||
+        m_tex1HeightLoc == INVALID_UNIFORM_LOCATION ||
+        m_tex2HeightLoc == INVALID_UNIFORM_LOCATION ||
+        m_tex3HeightLoc == INVALID_UNIFORM_LOCATION ||
+        m_reversedLightDirLoc == INVALID_UNIFORM_LOCATION) {
+        return false;
+    }
+
+    Enable();
+
+    glUniform1i(m_heightLevelsLoc, HEIGHT_LEVELS_TEXTURE_UNIT_INDEX);
+    glUniform1i(m_tex0UnitLoc, COLOR_TEXTURE_UNIT_INDEX_0);
+    glUniform1i(m_tex1UnitLoc, COLOR_TEXTURE_UNIT_INDEX_1);
+    glUniform1i(m_tex2UnitLoc, COLOR_TEXTURE_UNIT_INDEX_2);
+    glUniform1i(m_tex3UnitLoc, COLOR_TEXTURE_UNIT_INDEX_3);
+
+    glUseProgram(0);
+
+    return true;
+}
+
+
+void ClipmapTechnique::SetVP(const Matrix4f& VP)
+{
+    glUniformMatrix4fv(m_VPLoc, 1, GL_TRUE, (const GLfloat*)VP.m);
+}
+
+
+void ClipmapTechnique::SetTextureSize(int TextureSize)
+{
+    glUniform1i(m_textureSizeLoc, TextureSize);
+}
+
+
+void ClipmapTechnique::SetTexScale(float TexScale)
+{
+    glUniform1f(m_texScaleLoc, TexScale);
+}
+
+
+void ClipmapTechnique::SetMinMaxHeight(float Min, float Max)
+{
+    glUniform1f(m_minHeightLoc, Min);
+    glUniform1f(m_maxHeightLoc, Max);
+}
+
+
+void ClipmapTechnique::SetTextureHeights(float Tex0Height, float Tex1Height, float Tex2Height, float Tex3Height)
+{
+    glUniform1f(m_tex0HeightLoc, Tex0Height);
+    glUniform1f(m_tex1HeightLoc, Tex1Height);
+    glUniform1f(m_tex2HeightLoc, Tex2Height);
+    glUniform1f(m_tex3HeightLoc, Tex3Height);
+}
+
+
+void ClipmapTechnique::SetLightDir(const Vector3f& Dir)
+{
+    Vector3f ReversedLightDir = Dir * -1.0f;
+    ReversedLightDir = ReversedLightDir.Normalize();
+    glUniform3f(m_reversedLightDirLoc, ReversedLightDir.x, ReversedLightDir.y, ReversedLightDir.z);
+}
+
+
+void ClipmapTechnique::SetLevel(int Level, int OriginTexelX, int OriginTexelZ, const Vector2f& Origin, float Spacing)
+{
+    glUniform1i(m_levelLoc, Level);
+    glUniform2i(m_originTexelLoc, OriginTexelX, OriginTexelZ);
+    glUniform2f(m_originLoc, Origin.x, Origin.y);
+    glUniform1f(m_spacingLoc, Spacing);
+}
+
+
+void ClipmapTechnique::SetMorph(const Vector2f& CameraPos, float MorphStart, float MorphWidth)
+{
+    glUniform2f(m_cameraPosLoc, CameraPos.x, CameraPos.y);
+    glUniform1f(m_morphStartLoc, MorphStart);
+    glUniform1f(m_morphWidthLoc, MorphWidth);
+}
@@ -0,0 +1,74 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLIPMAP_TECHNIQUE_H
+#define CLIPMAP_TECHNIQUE_H
+
+#include "technique.h"
+#include "ogldev_math_3d.h"
+
+// clipmap.vs with the fragment shader of the regular terrain
+class ClipmapTechnique : public Technique
+{
+public:
+
+    ClipmapTechnique();
+
+    virtual bool Init();
+
+    void SetVP(const Matrix4f& VP);
+
+    void SetTextureSize(int TextureSize);
+
+    void SetTexScale(float TexScale);
+
+    void SetMinMaxHeight(float Min, float Max);
+
+    void SetTextureHeights(float Tex0Height, float Tex1Height, float Tex2Height, float Tex3Height);
+
+    void SetLightDir(const Vector3f& Dir);
+
+    void SetLevel(int Level, int OriginTexelX, int OriginTexelZ, const Vector2f& Origin, float Spacing);
+
+    void SetMorph(const Vector2f& CameraPos, float MorphStart, float MorphWidth);
+
+private:
+    GLuint m_VPLoc = -1;
+    GLuint m_heightLevelsLoc = -1;
+    GLuint m_levelLoc = -1;
+    GLuint m_textureSizeLoc = -1;
+    GLuint m_originTexelLoc = -1;
+    GLuint m_originLoc = -1;
+    GLuint m_spacingLoc = -1;
+    GLuint m_cameraPosLoc = -1;
+    GLuint m_morphStartLoc = -1;
+    GLuint m_morphWidthLoc = -1;
+    GLuint m_texScaleLoc = -1;
+    GLuint m_minHeightLoc = -1;
+    GLuint m_maxHeightLoc = -1;
+    GLuint m_tex0HeightLoc = -1;
+    GLuint m_tex1HeightLoc = -1;
+    GLuint m_tex2HeightLoc = -1;
+    GLuint m_tex3HeightLoc = -1;
+    GLuint m_tex0UnitLoc = -1;
+    GLuint m_tex1UnitLoc = -1;
+    GLuint m_tex2UnitLoc = -1;
+    GLuint m_tex3UnitLoc = -1;
+    GLuint m_reversedLightDirLoc = -1;
+};
+
+#endif  /* CLIPMAP_TECHNIQUE_H */
@@ -3,4 +3,9 @@
 
 #define Z_FAR 5000.0f
 
+#define CLIPMAP_TILE_DIR    "clipmap_tiles"
+#define CLIPMAP_TILE_SIZE   128
+#define CLIPMAP_NUM_LEVELS  6
+#define CLIPMAP_LEVEL_SIZE  128
+
 #endif
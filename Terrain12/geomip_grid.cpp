@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <vector>
+#include <algorithm>
 
 #include "ogldev_math_3d.h"
 #include "geomip_grid.h"
@@ -140,10 +141,11 @@ void GeomipGrid::CreateGLState()
 
 void GeomipGrid::PopulateBuffers(const BaseTerrain* pTerrain)
 {
-    std::vector<Vertex> Vertices;
-    Vertices.resize(m_width * m_depth);
-    printf("Preparing space for %zu vertices\n", Vertices.size());
-    InitVertices(pTerrain, Vertices);
+    // The vertices are kept for the runtime edits
+    m_vertices.clear();
+    m_vertices.resize(m_width * m_depth);
+    printf("Preparing space for %zu vertices\n", m_vertices.size());
+    InitVertices(pTerrain, m_vertices);
 
     int NumIndices = CalcNumIndices();
 	std::vector<unsigned int> Indices;
@@ -152,11 +154,26 @@ void GeomipGrid::PopulateBuffers(const BaseTerrain* pTerrain)
     NumIndices = InitIndices(Indices);
     printf("Final number of indices %d\n", NumIndices);
 
-    CalcNormals(Vertices, Indices);
+    CalcNormals(m_vertices, Indices);
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
+    const SingleLodInfo& Lod0 = m_lodInfo[0].info[0][0][0][0];
+    m_patchIndices.assign(Indices.begin() + Lod0.Start, Indices.begin() + Lod0.Start + Lod0.Count);
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * NumIndices, &Indices[0], GL_STATIC_DRAW);
+    m_patchBounds.resize(m_numPatchesX * m_numPatchesZ);
+
+    for (int PatchZ = 0 ; PatchZ < m_numPatchesZ ; PatchZ++) {
+        for (int PatchX = 0 ; PatchX < m_numPatchesX ; PatchX++) {
+            CalcPatchBounds(PatchX, PatchZ);
+        }
+    }
+
+    m_dirtyRows.assign(m_depth, DirtySpan());
+    m_numDirtyRows = 0;
+    m_flushRow = 0;
+
+    glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices[0]) * m_vertices.size(), &m_vertices[0], GL_DYNAMIC_DRAW);
+
+    EncodeIndices(Indices);
 }
 
 
@@ -176,6 +193,64 @@ int GeomipGrid::CalcNumIndices()
 }
 
 
+// The triangles of every LOD permutation are the fans of CreateTriangleFan
+// one after the other. They go into the index buffer as fans separated by
+// the restart index, reordered for the post transform cache. The indices
+// are relative to the base vertex of the patch so they fit in 16 bits
+// unless the terrain is very wide.
+void GeomipGrid::EncodeIndices(const std::vector<uint>& Triangles)
+{
+    std::vector<uint> Fans;
+    std::vector<uint> LodFans;
+    int NumTriangleIndices = 0;
+
+    for (int lod = 0 ; lod <= m_maxLOD ; lod++) {
+        float MissesBefore = 0.0f;
+        float MissesAfter = 0.0f;
+        int NumTriangles = 0;
+
+        for (int l = 0 ; l < LEFT ; l++) {
+            for (int r = 0 ; r < RIGHT ; r++) {
+                for (int t = 0 ; t < TOP ; t++) {
+                    for (int b = 0 ; b < BOTTOM ; b++) {
+                        SingleLodInfo& Info = m_lodInfo[lod].info[l][r][t][b];
+                        const uint* pTriangles = &Triangles[Info.Start];
+                        int NumPermTriangles = Info.Count / 3;
+
+                        MissesBefore += CalcACMR(INDEX_TOPOLOGY_TRIANGLES, pTriangles, Info.Count, OGLDEV_VERTEX_CACHE_SIZE) * NumPermTriangles;
+
+                        BuildTriangleFans(pTriangles, Info.Count, LodFans);
+                        OptimizeVertexCache(INDEX_TOPOLOGY_TRIANGLE_FAN, LodFans, OGLDEV_VERTEX_CACHE_SIZE);
+
+                        MissesAfter += CalcACMR(INDEX_TOPOLOGY_TRIANGLE_FAN, &LodFans[0], (int)LodFans.size(), OGLDEV_VERTEX_CACHE_SIZE) * NumPermTriangles;
+                        NumTriangles += NumPermTriangles;
+                        NumTriangleIndices += Info.Count;
+
+                        Info.Start = (int)Fans.size();
+                        Info.Count = (int)LodFans.size();
+                        Fans.insert(Fans.end(), LodFans.begin(), LodFans.end());
+                    }
+                }
+            }
+        }
+
+        printf("LOD %d: ACMR %.3f as triangles, %.3f as fans\n", lod, MissesBefore / NumTriangles, MissesAfter / NumTriangles);
+    }
+
+    std::vector<IndexRange> Ranges(1);
+    Ranges[0].Count = (int)Fans.size();
+
+    std::vector<uchar> Buffer;
+    m_indexSize = PackIndices(Fans, Ranges, Buffer);
+    m_indexType = (m_indexSize == sizeof(ushort)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    printf("Index buffer: %zu bytes as fans, %zu bytes as triangles\n",
+           Buffer.size(), NumTriangleIndices * sizeof(uint));
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Buffer.size(), &Buffer[0], GL_STATIC_DRAW);
+}
+
+
 void GeomipGrid::Vertex::InitVertex(const BaseTerrain* pTerrain, int x, int z)
 {
     float y = pTerrain->GetHeight(x, z);
@@ -378,6 +453,210 @@ void GeomipGrid::CalcNormals(std::vector<Vertex>& Vertices, std::vector<uint>& I
 }
 
 
+void GeomipGrid::UpdateHeights(int x0, int z0, int x1, int z1)
+{
+    x0 = std::max(x0, 0);
+    z0 = std::max(z0, 0);
+    x1 = std::min(x1, m_width);
+    z1 = std::min(z1, m_depth);
+
+    if ((x0 >= x1) || (z0 >= z1)) {
+        return;
+    }
+
+    for (int z = z0 ; z < z1 ; z++) {
+        for (int x = x0 ; x < x1 ; x++) {
+            m_vertices[z * m_width + x].Pos.y = m_pTerrain->GetHeight(x, z);
+        }
+    }
+
+    // A vertex shares triangles only with its eight neighbors so the normals
+    // change in a border of one vertex around the rect
+    int NormalX0 = std::max(x0 - 1, 0);
+    int NormalZ0 = std::max(z0 - 1, 0);
+    int NormalX1 = std::min(x1 + 1, m_width);
+    int NormalZ1 = std::min(z1 + 1, m_depth);
+
+    CalcNormalsRegion(NormalX0, NormalZ0, NormalX1, NormalZ1);
+
+    // The vertices on the edge between two patches belong to both
+    int PatchStep = m_patchSize - 1;
+    int PatchX0 = std::max((x0 - 1) / PatchStep, 0);
+    int PatchZ0 = std::max((z0 - 1) / PatchStep, 0);
+    int PatchX1 = std::min((x1 - 1) / PatchStep, m_numPatchesX - 1);
+    int PatchZ1 = std::min((z1 - 1) / PatchStep, m_numPatchesZ - 1);
+
+    for (int PatchZ = PatchZ0 ; PatchZ <= PatchZ1 ; PatchZ++) {
+        for (int PatchX = PatchX0 ; PatchX <= PatchX1 ; PatchX++) {
+            CalcPatchBounds(PatchX, PatchZ);
+        }
+    }
+
+    MarkDirty(NormalX0, NormalZ0, NormalX1, NormalZ1);
+}
+
+
+// Same as CalcNormals but only for the vertices in [x0, x1) x [z0, z1). Every
+// triangle that touches them is in one of the patches that contain them.
+void GeomipGrid::CalcNormalsRegion(int x0, int z0, int x1, int z1)
+{
+    for (int z = z0 ; z < z1 ; z++) {
+        for (int x = x0 ; x < x1 ; x++) {
+            m_vertices[z * m_width + x].Normal = Vector3f(0.0f, 0.0f, 0.0f);
+        }
+    }
+
+    int PatchStep = m_patchSize - 1;
+    int PatchX0 = std::max((x0 - 1) / PatchStep, 0);
+    int PatchZ0 = std::max((z0 - 1) / PatchStep, 0);
+    int PatchX1 = std::min((x1 - 1) / PatchStep, m_numPatchesX - 1);
+    int PatchZ1 = std::min((z1 - 1) / PatchStep, m_numPatchesZ - 1);
+
+    for (int PatchZ = PatchZ0 ; PatchZ <= PatchZ1 ; PatchZ++) {
+        for (int PatchX = PatchX0 ; PatchX <= PatchX1 ; PatchX++) {
+            int BaseVertex = PatchZ * PatchStep * m_width + PatchX * PatchStep;
+
+            for (int i = 0 ; i < (int)m_patchIndices.size() ; i += 3) {
+                uint Index[3];
+                bool IsInside[3];
+                bool IsAnyInside = false;
+
+                for (int j = 0 ; j < 3 ; j++) {
+                    Index[j] = BaseVertex + m_patchIndices[i + j];
+                    int x = Index[j] % m_width;
+                    int z = Index[j] / m_width;
+                    IsInside[j] = (x >= x0) && (x < x1) && (z >= z0) && (z < z1);
+                    IsAnyInside = IsAnyInside || IsInside[j];
+                }
+
+                if (!IsAnyInside) {
+                    continue;
+                }
+
+                Vector3f v1 = m_vertices[Index[1]].Pos - m_vertices[Index[0]].Pos;
+                Vector3f v2 = m_vertices[Index[2]].Pos - m_vertices[Index[0]].Pos;
+                Vector3f Normal = v1.Cross(v2);
+                Normal.Normalize();
+
+                for (int j = 0 ; j < 3 ; j++) {
+                    if (IsInside[j]) {
+                        m_vertices[Index[j]].Normal += Normal;
+                    }
+                }
+            }
+        }
+    }
+
+    for (int z = z0 ; z < z1 ; z++) {
+        for (int x = x0 ; x < x1 ; x++) {
+            m_vertices[z * m_width + x].Normal.Normalize();
+        }
+    }
+}
+
+
+void GeomipGrid::CalcPatchBounds(int PatchX, int PatchZ)
+{
+    int BaseX = PatchX * (m_patchSize - 1);
+    int BaseZ = PatchZ * (m_patchSize - 1);
+
+    PatchBounds& Bounds = m_patchBounds[PatchZ * m_numPatchesX + PatchX];
+    Bounds.MinHeight = Bounds.MaxHeight = m_vertices[BaseZ * m_width + BaseX].Pos.y;
+
+    for (int z = BaseZ ; z < BaseZ + m_patchSize ; z++) {
+        for (int x = BaseX ; x < BaseX + m_patchSize ; x++) {
+            float Height = m_vertices[z * m_width + x].Pos.y;
+            Bounds.MinHeight = std::min(Bounds.MinHeight, Height);
+            Bounds.MaxHeight = std::max(Bounds.MaxHeight, Height);
+        }
+    }
+}
+
+
+void GeomipGrid::GetMinMaxHeight(float& MinHeight, float& MaxHeight) const
+{
+    MinHeight = m_patchBounds[0].MinHeight;
+    MaxHeight = m_patchBounds[0].MaxHeight;
+
+    for (const PatchBounds& Bounds : m_patchBounds) {
+        MinHeight = std::min(MinHeight, Bounds.MinHeight);
+        MaxHeight = std::max(MaxHeight, Bounds.MaxHeight);
+    }
+}
+
+
+void GeomipGrid::MarkDirty(int x0, int z0, int x1, int z1)
+{
+    for (int z = z0 ; z < z1 ; z++) {
+        DirtySpan& Span = m_dirtyRows[z];
+
+        if (Span.x0 >= Span.x1) {
+            Span.x0 = x0;
+            Span.x1 = x1;
+            m_numDirtyRows++;
+        } else {
+            Span.x0 = std::min(Span.x0, x0);
+            Span.x1 = std::max(Span.x1, x1);
+        }
+    }
+}
+
+
+bool GeomipGrid::FlushDirtyVertices(int MaxBytes)
+{
+    int MaxVertices = MaxBytes / (int)sizeof(Vertex);
+
+    // Spans that continue each other in memory (e.g. whole rows) are uploaded
+    // together
+    int First = 0;
+    int Count = 0;
+
+    while ((m_numDirtyRows > 0) && (MaxVertices > 0)) {
+        DirtySpan& Span = m_dirtyRows[m_flushRow];
+
+        if (Span.x0 < Span.x1) {
+            int NumVertices = std::min(Span.x1 - Span.x0, MaxVertices);
+            int Start = m_flushRow * m_width + Span.x0;
+
+            if ((Count > 0) && (First + Count != Start)) {
+                UploadVertices(First, Count);
+                Count = 0;
+            }
+
+            if (Count == 0) {
+                First = Start;
+            }
+
+            Count += NumVertices;
+            MaxVertices -= NumVertices;
+            Span.x0 += NumVertices;
+
+            // Out of budget in the middle of the row - continue from here next time
+            if (Span.x0 < Span.x1) {
+                break;
+            }
+
+            Span = DirtySpan();
+            m_numDirtyRows--;
+        }
+
+        m_flushRow = (m_flushRow + 1) % m_depth;
+    }
+
+    if (Count > 0) {
+        UploadVertices(First, Count);
+    }
+
+    return m_numDirtyRows == 0;
+}
+
+
+void GeomipGrid::UploadVertices(int First, int Count)
+{
+    glNamedBufferSubData(m_vb, sizeof(Vertex) * First, sizeof(Vertex) * Count, &m_vertices[First]);
+}
+
+
 void clrscr()
 {
     std::system("cls");
@@ -396,8 +675,11 @@ void GeomipGrid::Render(const Vector3f& CameraPos, const Matrix4f& ViewProj)
 
     glBindVertexArray(m_vao);
 
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(GetRestartIndex(m_indexSize));
+
     if (gShowPoints > 0) {
-        glDrawElementsBaseVertex(GL_POINTS, m_lodInfo[0].info[0][0][0][0].Count, GL_UNSIGNED_INT, (void*)0, 0);
+        glDrawElementsBaseVertex(GL_POINTS, m_lodInfo[0].info[0][0][0][0].Count, m_indexType, (void*)0, 0);
     }
 
     if (gShowPoints != 2) {
@@ -429,18 +711,20 @@ void GeomipGrid::Render(const Vector3f& CameraPos, const Matrix4f& ViewProj)
                 int T = plod.Top;
                 int B = plod.Bottom;
 
-                size_t BaseIndex = sizeof(unsigned int) * m_lodInfo[C].info[L][R][T][B].Start;
+                size_t BaseIndex = m_indexSize * m_lodInfo[C].info[L][R][T][B].Start;
 
                 int BaseVertex = z * m_width + x;
 
-                glDrawElementsBaseVertex(GL_TRIANGLES, m_lodInfo[C].info[L][R][T][B].Count, 
-                                         GL_UNSIGNED_INT, (void*)BaseIndex, BaseVertex);
+                glDrawElementsBaseVertex(GL_TRIANGLE_FAN, m_lodInfo[C].info[L][R][T][B].Count, 
+                                         m_indexType, (void*)BaseIndex, BaseVertex);
             }
 
             if (gShowPoints == 3)  printf("\n");
         }
     }
 
+    glDisable(GL_PRIMITIVE_RESTART);
+
     glBindVertexArray(0);
 
     gShowPoints = 0;
@@ -476,33 +760,30 @@ bool GeomipGrid::IsPatchInsideViewFrustum_WorldSpace(int X, int Z, const Frustum
     int z0 = Z;
     int z1 = Z + m_patchSize - 1;
 
-    float h00 = m_pTerrain->GetHeight(x0, z0);
-    float h01 = m_pTerrain->GetHeight(x0, z1);
-    float h10 = m_pTerrain->GetHeight(x1, z0);
-    float h11 = m_pTerrain->GetHeight(x1, z1);
-
-    float MinHeight = std::min(h00, std::min(h01, std::min(h10, h11)));
-    float MaxHeight = std::max(h00, std::max(h01, std::max(h10, h11)));
+    // The bounds follow the runtime edits
+    const PatchBounds& Bounds = m_patchBounds[(Z / (m_patchSize - 1)) * m_numPatchesX + X / (m_patchSize - 1)];
+    float MinHeight = Bounds.MinHeight;
+    float MaxHeight = Bounds.MaxHeight;
 
-    Vector3f p00_low((float)x0 * m_worldScale, h00, (float)z0 * m_worldScale);
-    Vector3f p01_low((float)x0 * m_worldScale, h01, (float)z1 * m_worldScale);
-    Vector3f p10_low((float)x1 * m_worldScale, h10, (float)z0 * m_worldScale);
-    Vector3f p11_low((float)x1 * m_worldScale, h11, (float)z1 * m_worldScale);
+    Vector3f p00_low((float)x0 * m_worldScale, MinHeight, (float)z0 * m_worldScale);
+    Vector3f p01_low((float)x0 * m_worldScale, MinHeight, (float)z1 * m_worldScale);
+    Vector3f p10_low((float)x1 * m_worldScale, MinHeight, (float)z0 * m_worldScale);
+    Vector3f p11_low((float)x1 * m_worldScale, MinHeight, (float)z1 * m_worldScale);
 
-  /*  Vector3f p00_high((float)x0 * m_worldScale, MaxHeight, (float)z0 * m_worldScale);
+    Vector3f p00_high((float)x0 * m_worldScale, MaxHeight, (float)z0 * m_worldScale);
     Vector3f p01_high((float)x0 * m_worldScale, MaxHeight, (float)z1 * m_worldScale);
     Vector3f p10_high((float)x1 * m_worldScale, MaxHeight, (float)z0 * m_worldScale);
-    Vector3f p11_high((float)x1 * m_worldScale, MaxHeight, (float)z1 * m_worldScale);*/
+    Vector3f p11_high((float)x1 * m_worldScale, MaxHeight, (float)z1 * m_worldScale);
 
     bool InsideViewFrustm =
         fc.IsPointInsideViewFrustum(p00_low) ||
         fc.IsPointInsideViewFrustum(p01_low) ||
         fc.IsPointInsideViewFrustum(p10_low) ||
-        fc.IsPointInsideViewFrustum(p11_low);// ||
-     /*   fc.IsPointInsideViewFrustum(p00_high) ||
+        fc.IsPointInsideViewFrustum(p11_low) ||
+        fc.IsPointInsideViewFrustum(p00_high) ||
         fc.IsPointInsideViewFrustum(p01_high) ||
         fc.IsPointInsideViewFrustum(p10_high) ||
-        fc.IsPointInsideViewFrustum(p11_high);*/
+        fc.IsPointInsideViewFrustum(p11_high);
 
     return InsideViewFrustm;
 }
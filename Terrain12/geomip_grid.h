@@ -25,6 +25,7 @@
 
 #include "ogldev_math_3d.h"
 #include "lod_manager.h"
+#include "ogldev_index_encoder.h"
 
 // this header is included by terrain.h so we have a forward 
 // declaration for BaseTerrain.
@@ -42,6 +43,20 @@ class GeomipGrid {
 
     void Render(const Vector3f& CameraPos, const Matrix4f& ViewProj);
 
+    // Re-reads the heights in the half open rect [x0, x1) x [z0, z1) from the
+    // terrain and recalculates the normals and patch bounds that depend on
+    // them. Only the CPU copy changes - see FlushDirtyVertices.
+    void UpdateHeights(int x0, int z0, int x1, int z1);
+
+    // Uploads at most MaxBytes of the vertices that changed since the last
+    // call. Returns true when nothing is left.
+    bool FlushDirtyVertices(int MaxBytes);
+
+    bool HasDirtyVertices() const { return m_numDirtyRows > 0; }
+
+    // Over all the patches
+    void GetMinMaxHeight(float& MinHeight, float& MaxHeight) const;
+
  private:
 
     struct Vertex {
@@ -65,6 +80,14 @@ class GeomipGrid {
     int InitIndicesLODSingle(int Index, std::vector<uint>& Indices, int lodCore, int lodLeft, int lodRight, int lodTop, int lodBottom);
     
     void CalcNormals(std::vector<Vertex>& Vertices, std::vector<uint>& Indices);
+
+    void CalcNormalsRegion(int x0, int z0, int x1, int z1);
+
+    void CalcPatchBounds(int PatchX, int PatchZ);
+
+    void MarkDirty(int x0, int z0, int x1, int z1);
+
+    void UploadVertices(int First, int Count);
     
     uint AddTriangle(uint Index, std::vector<uint>& Indices, uint v1, uint v2, uint v3);
     
@@ -72,6 +95,8 @@ class GeomipGrid {
 
     int CalcNumIndices();
 
+    void EncodeIndices(const std::vector<uint>& Triangles);
+
     bool IsPatchInsideViewFrustum_ViewSpace(int X, int Z, const Matrix4f& ViewProj);
 
     bool IsPatchInsideViewFrustum_WorldSpace(int X, int Z, const FrustumCulling& FC);
@@ -87,8 +112,11 @@ class GeomipGrid {
     GLuint m_vao = 0;
     GLuint m_vb = 0;
     GLuint m_ib = 0;
+    GLenum m_indexType = GL_UNSIGNED_INT;
+    int m_indexSize = sizeof(uint);
     float m_worldScale = 1.0f;
 
+    // After EncodeIndices the range of the fans in the index buffer
     struct SingleLodInfo {
         int Start = 0;
         int Count = 0;
@@ -110,6 +138,29 @@ class GeomipGrid {
     const BaseTerrain* m_pTerrain = NULL;
     float m_patchWorldSize = 0.0f;
     float m_patchWorldHalfSize = 0.0f;
+
+    // The CPU copy of the vertex buffer and the LOD 0 triangles of a single
+    // patch, for the runtime edits
+    std::vector<Vertex> m_vertices;
+    std::vector<uint> m_patchIndices;
+
+    struct PatchBounds {
+        float MinHeight = 0.0f;
+        float MaxHeight = 0.0f;
+    };
+
+    std::vector<PatchBounds> m_patchBounds;
+
+    // The vertices that still need to be uploaded - a half open range of
+    // columns for every row
+    struct DirtySpan {
+        int x0 = 0;
+        int x1 = 0;
+    };
+
+    std::vector<DirtySpan> m_dirtyRows;
+    int m_numDirtyRows = 0;
+    int m_flushRow = 0;
 };
 
 #endif
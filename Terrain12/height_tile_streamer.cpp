@@ -0,0 +1,316 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "ogldev_mapped_file.h"
+#include "height_tile_streamer.h"
+
+
+u64 HeightTileKey::GetHash() const
+{
+    // 28 bits per coordinate is more than enough for any world
+    return ((u64)(Level & 0xff) << 56) | ((u64)(x & 0xfffffff) << 28) | (u64)(z & 0xfffffff);
+}
+
+
+static std::string GetTileFilename(const std::string& Dir, const HeightTileKey& Key)
+{
+    char Filename[64];
+    snprintf(Filename, sizeof(Filename), "/L%d_%d_%d.tile", Key.Level, Key.x, Key.z);
+    return Dir + Filename;
+}
+
+
+bool WriteHeightTilePyramid(const char* pDir, const float* pHeights, int Size, int TileSize, int NumLevels)
+{
+#ifdef _WIN32
+    _mkdir(pDir);
+#else
+    mkdir(pDir, 0755);
+#endif
+
+    std::vector<float> Tile(TileSize * TileSize);
+
+    for (int Level = 0 ; Level < NumLevels ; Level++) {
+        int Step = 1 << Level;
+        int LevelSize = (Size + Step - 1) / Step;
+        int NumTiles = (LevelSize + TileSize - 1) / TileSize;
+
+        for (int tz = 0 ; tz < NumTiles ; tz++) {
+            for (int tx = 0 ; tx < NumTiles ; tx++) {
+                for (int z = 0 ; z < TileSize ; z++) {
+                    for (int x = 0 ; x < TileSize ; x++) {
+                        int SrcX = (tx * TileSize + x) * Step;
+                        int SrcZ = (tz * TileSize + z) * Step;
+                        bool IsInside = (SrcX < Size) && (SrcZ < Size);
+                        Tile[z * TileSize + x] = IsInside ? pHeights[SrcZ * Size + SrcX] : 0.0f;
+                    }
+                }
+
+                std::string Filename = GetTileFilename(pDir, HeightTileKey(Level, tx, tz));
+
+                FILE* f = fopen(Filename.c_str(), "wb");
+
+                if (!f) {
+                    printf("Error opening '%s' for writing\n", Filename.c_str());
+                    return false;
+                }
+
+                size_t NumWritten = fwrite(Tile.data(), sizeof(float), Tile.size(), f);
+                fclose(f);
+
+                if (NumWritten != Tile.size()) {
+                    printf("Error writing '%s'\n", Filename.c_str());
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+HeightTileStreamer::~HeightTileStreamer()
+{
+    Destroy();
+}
+
+
+void HeightTileStreamer::Init(const char* pDir, int TileSize, int MaxResidentTiles)
+{
+    Destroy();
+
+    m_dir = pDir;
+    m_tileSize = TileSize;
+    m_maxResidentTiles = MaxResidentTiles;
+    m_flatTile.assign(TileSize * TileSize, 0.0f);
+    m_frame = 1;
+    m_numLoads = 0;
+    m_quit = false;
+
+    m_loaderThread = std::thread(&HeightTileStreamer::LoaderThread, this);
+}
+
+
+void HeightTileStreamer::Destroy()
+{
+    if (m_loaderThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            m_quit = true;
+        }
+
+        m_wakeLoader.notify_all();
+        m_loaderThread.join();
+    }
+
+    m_tiles.clear();
+    m_queue.clear();
+    m_isLoading = false;
+    m_isStalled = false;
+}
+
+
+void HeightTileStreamer::BeginFrame()
+{
+    {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        m_frame++;
+        m_queue.clear();
+        m_isStalled = false;
+    }
+
+    // Tiles of the previous frame can be evicted now
+    m_wakeLoader.notify_all();
+}
+
+
+void HeightTileStreamer::RequestTile(const HeightTileKey& Key, int Priority)
+{
+    u64 Hash = Key.GetHash();
+
+    {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+
+        auto it = m_tiles.find(Hash);
+
+        if (it != m_tiles.end()) {
+            it->second.LastUsedFrame = m_frame;
+            return;
+        }
+
+        if (m_isLoading && (m_loadingHash == Hash)) {
+            return;
+        }
+
+        Request& r = m_queue[Hash];
+        r.Key = Key;
+        r.Priority = Priority;
+    }
+
+    m_wakeLoader.notify_one();
+}
+
+
+const float* HeightTileStreamer::GetTile(const HeightTileKey& Key)
+{
+    std::lock_guard<std::mutex> Lock(m_mutex);
+
+    auto it = m_tiles.find(Key.GetHash());
+
+    if (it == m_tiles.end()) {
+        return NULL;
+    }
+
+    it->second.LastUsedFrame = m_frame;
+
+    return it->second.Heights.empty() ? m_flatTile.data() : it->second.Heights.data();
+}
+
+
+int HeightTileStreamer::GetNumResidentTiles()
+{
+    std::lock_guard<std::mutex> Lock(m_mutex);
+    return (int)m_tiles.size();
+}
+
+
+int HeightTileStreamer::GetNumQueuedTiles()
+{
+    std::lock_guard<std::mutex> Lock(m_mutex);
+    return (int)m_queue.size();
+}
+
+
+int HeightTileStreamer::GetNumLoads()
+{
+    std::lock_guard<std::mutex> Lock(m_mutex);
+    return m_numLoads;
+}
+
+
+void HeightTileStreamer::WaitIdle()
+{
+    std::unique_lock<std::mutex> Lock(m_mutex);
+
+    m_idle.wait(Lock, [this] { return !m_isLoading && (m_queue.empty() || m_isStalled); });
+}
+
+
+// Called with the mutex locked. Evicts the least recently used tile that
+// wasn't touched in this frame if the cache is full.
+bool HeightTileStreamer::MakeRoom()
+{
+    if ((int)m_tiles.size() < m_maxResidentTiles) {
+        return true;
+    }
+
+    auto Oldest = m_tiles.end();
+
+    for (auto it = m_tiles.begin() ; it != m_tiles.end() ; it++) {
+        if ((it->second.LastUsedFrame < m_frame) &&
+            ((Oldest == m_tiles.end()) || (it->second.LastUsedFrame < Oldest->second.LastUsedFrame))) {
+            Oldest = it;
+        }
+    }
+
+    if (Oldest == m_tiles.end()) {
+        return false;
+    }
+
+    m_tiles.erase(Oldest);
+
+    return true;
+}
+
+
+void HeightTileStreamer::LoaderThread()
+{
+    std::unique_lock<std::mutex> Lock(m_mutex);
+
+    while (!m_quit) {
+        if (m_queue.empty() || !MakeRoom()) {
+            // Either nothing to do or every resident tile is in use - the
+            // next BeginFrame will release some of them
+            m_isStalled = !m_queue.empty();
+            m_idle.notify_all();
+            m_wakeLoader.wait(Lock);
+            continue;
+        }
+
+        auto Best = m_queue.begin();
+
+        for (auto it = m_queue.begin() ; it != m_queue.end() ; it++) {
+            if (it->second.Priority < Best->second.Priority) {
+                Best = it;
+            }
+        }
+
+        HeightTileKey Key = Best->second.Key;
+        m_loadingHash = Best->first;
+        m_queue.erase(Best);
+        m_isLoading = true;
+
+        Lock.unlock();
+
+        std::vector<float> Heights;
+        LoadTile(Key, Heights);
+
+        Lock.lock();
+
+        // Only this thread adds tiles so the room made above is still there.
+        // It was requested in this frame so it must survive until the next.
+        Tile& t = m_tiles[m_loadingHash];
+        t.Heights.swap(Heights);
+        t.LastUsedFrame = m_frame;
+
+        m_isLoading = false;
+        m_numLoads++;
+    }
+}
+
+
+void HeightTileStreamer::LoadTile(const HeightTileKey& Key, std::vector<float>& Heights) const
+{
+    std::string Filename = GetTileFilename(m_dir, Key);
+
+    MappedFile File;
+
+    if (!File.Open(Filename.c_str())) {
+        return;     // outside of the world
+    }
+
+    u64 ExpectedSize = (u64)m_tileSize * m_tileSize * sizeof(float);
+
+    if (File.GetSize() != ExpectedSize) {
+        printf("%s:%d - '%s' has %llu bytes instead of %llu\n", __FILE__, __LINE__, Filename.c_str(),
+               (unsigned long long)File.GetSize(), (unsigned long long)ExpectedSize);
+        return;
+    }
+
+    Heights.resize(m_tileSize * m_tileSize);
+    memcpy(Heights.data(), File.GetData(), ExpectedSize);
+}
@@ -0,0 +1,135 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEIGHT_TILE_STREAMER_H
+#define HEIGHT_TILE_STREAMER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ogldev_types.h"
+
+//
+// A height tile holds TileSize x TileSize samples of one level of the tile
+// pyramid. Sample (x, z) of level L is sample (x << L, z << L) of level 0,
+// so every level is a point decimation of the one below it. The tiles are
+// raw floats, one file per tile, named L<level>_<x>_<z>.tile. A tile
+// without a file is flat (all zeros) - that is how the world ends.
+//
+struct HeightTileKey {
+    int Level = 0;
+    int x = 0;
+    int z = 0;
+
+    HeightTileKey() {}
+
+    HeightTileKey(int _Level, int _x, int _z) : Level(_Level), x(_x), z(_z) {}
+
+    u64 GetHash() const;
+};
+
+
+// Splits the height map into tiles for all the levels. Samples outside the
+// height map are zero.
+bool WriteHeightTilePyramid(const char* pDir, const float* pHeights, int Size, int TileSize, int NumLevels);
+
+
+//
+// Loads height tiles on a background thread. The main thread requests the
+// tiles that it needs every frame and picks up the ones that have arrived.
+// At most MaxResidentTiles are kept in memory - the least recently used tile
+// that wasn't touched in the current frame is evicted to make room.
+//
+class HeightTileStreamer
+{
+public:
+    HeightTileStreamer() {}
+
+    ~HeightTileStreamer();
+
+    void Init(const char* pDir, int TileSize, int MaxResidentTiles);
+
+    void Destroy();
+
+    // Drops the requests of the previous frame that weren't loaded yet so
+    // the queue only holds what the caller still needs.
+    void BeginFrame();
+
+    // Lower priorities are loaded first
+    void RequestTile(const HeightTileKey& Key, int Priority);
+
+    // NULL if the tile is not resident. The data stays valid until the
+    // next BeginFrame.
+    const float* GetTile(const HeightTileKey& Key);
+
+    int GetTileSize() const { return m_tileSize; }
+
+    int GetMaxResidentTiles() const { return m_maxResidentTiles; }
+
+    int GetNumResidentTiles();
+
+    int GetNumQueuedTiles();
+
+    // Number of tiles read from disk since Init
+    int GetNumLoads();
+
+    // For tests - blocks until the queue is empty
+    void WaitIdle();
+
+private:
+
+    struct Tile {
+        std::vector<float> Heights;     // empty for a tile without a file
+        u32 LastUsedFrame = 0;
+    };
+
+    struct Request {
+        HeightTileKey Key;
+        int Priority = 0;
+    };
+
+    void LoaderThread();
+
+    void LoadTile(const HeightTileKey& Key, std::vector<float>& Heights) const;
+
+    bool MakeRoom();
+
+    std::string m_dir;
+    int m_tileSize = 0;
+    int m_maxResidentTiles = 0;
+    std::vector<float> m_flatTile;
+
+    std::unordered_map<u64, Tile> m_tiles;          // resident
+    std::unordered_map<u64, Request> m_queue;       // waiting for the loader
+    u64 m_loadingHash = 0;
+    bool m_isLoading = false;
+    bool m_isStalled = false;       // the queue is not empty but there is no room
+    u32 m_frame = 1;
+    int m_numLoads = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeLoader;
+    std::condition_variable m_idle;
+    std::thread m_loaderThread;
+    bool m_quit = false;
+};
+
+#endif
@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "terrain.h"
+#include "ogldev_mapped_file.h"
 #include "texture_config.h"
 #include "3rdparty/stb_image_write.h"
 
@@ -43,6 +44,38 @@ void BaseTerrain::Destroy()
 }
 
 
+void BaseTerrain::WriteClipmapTiles(const char* pTileDir, int TileSize, int NumLevels)
+{
+    if (!WriteHeightTilePyramid(pTileDir, m_heightMap.GetBaseAddr(), m_terrainSize, TileSize, NumLevels)) {
+        printf("Error writing the clipmap tiles to '%s'\n", pTileDir);
+        exit(0);
+    }
+}
+
+
+void BaseTerrain::InitClipmap(const char* pTileDir, int TileSize, int NumLevels, int LevelSize)
+{
+    if (!m_isClipmapInitialized) {
+        if (!m_clipmapTech.Init()) {
+            printf("Error initializing the clipmap tech\n");
+            exit(0);
+        }
+
+        m_isClipmapInitialized = true;
+    }
+
+    m_tileStreamer.Init(pTileDir, TileSize, Clipmap::GetMaxResidentTiles(NumLevels, LevelSize, TileSize));
+    m_clipmap.Init(&m_tileStreamer, NumLevels, LevelSize, m_worldScale);
+    m_clipmapRenderer.Init(NumLevels, LevelSize);
+
+    m_clipmapTech.Enable();
+    m_clipmapTech.SetMinMaxHeight(m_minHeight, m_maxHeight);
+    m_clipmapTech.SetTexScale(m_textureScale / ((float)m_terrainSize * m_worldScale));
+
+    m_isClipmapMode = true;
+}
+
+
 
 void BaseTerrain::InitTerrain(float WorldScale, float TextureScale, const std::vector<string>& TextureFilenames)
 {
@@ -73,6 +106,8 @@ void BaseTerrain::InitTerrain(float WorldScale, float TextureScale, const std::v
 void BaseTerrain::Finalize()
 {
     m_geomipGrid.CreateGeomipGrid(m_terrainSize, m_terrainSize, m_patchSize, this);
+
+    m_query.Init(&m_heightMap, m_terrainSize, m_worldScale);
 }
 
 
@@ -114,24 +149,32 @@ void BaseTerrain::LoadFromFile(const char* pFilename)
 
 void BaseTerrain::LoadHeightMapFile(const char* pFilename)
 {
-    int FileSize = 0;
-    unsigned char* p = (unsigned char*)ReadBinaryFile(pFilename, FileSize);
+    MappedFile File;
+
+    if (!File.Open(pFilename)) {
+        OGLDEV_FILE_ERROR(pFilename);
+        exit(0);
+    }
+
+    u64 FileSize = File.GetSize();
 
     if (FileSize % sizeof(float) != 0) {
-        printf("%s:%d - '%s' does not contain an whole number of floats (size %d)\n", __FILE__, __LINE__, pFilename, FileSize);
+        printf("%s:%d - '%s' does not contain an whole number of floats (size %llu)\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_terrainSize = (int)sqrtf((float)FileSize / (float)sizeof(float));
+    m_terrainSize = (int)sqrt((double)FileSize / (double)sizeof(float));
 
     printf("Terrain size %d\n", m_terrainSize);
 
-    if ((m_terrainSize * m_terrainSize) != (FileSize / sizeof(float))) {
-        printf("%s:%d - '%s' does not contain a square height map - size %d\n", __FILE__, __LINE__, pFilename, FileSize);
+    if ((u64)m_terrainSize * m_terrainSize != (FileSize / sizeof(float))) {
+        printf("%s:%d - '%s' does not contain a square height map - size %llu\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize, (float*)p);
+    // The height map is modified later so it gets its own copy of the mapped pages
+    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize);
+    memcpy(m_heightMap.GetBaseAddr(), File.GetData(), FileSize);
 }
 
 
@@ -156,6 +199,12 @@ void BaseTerrain::SaveToFile(const char* pFilename)
 
 void BaseTerrain::Render(const BasicCamera& Camera)
 {
+    if (m_isClipmapMode) {
+        RenderClipmap(Camera);
+        m_pSkydome->Render(Camera);
+        return;
+    }
+
     Matrix4f VP = Camera.GetViewProjMatrix();
     Matrix4f View = Camera.GetMatrix();
 
@@ -170,12 +219,54 @@ void BaseTerrain::Render(const BasicCamera& Camera)
 	
     m_terrainTech.SetLightDir(m_lightDir);
 
+    if (m_geomipGrid.HasDirtyVertices()) {
+        m_geomipGrid.FlushDirtyVertices(m_maxUploadBytesPerFrame);
+    }
+
     m_geomipGrid.Render(Camera.GetPos(), VP);
 
     m_pSkydome->Render(Camera);
 }
 
 
+void BaseTerrain::RenderClipmap(const BasicCamera& Camera)
+{
+    m_clipmap.Update(Camera.GetPos());
+
+    m_clipmapTech.Enable();
+    m_clipmapTech.SetVP(Camera.GetViewProjMatrix());
+    m_clipmapTech.SetLightDir(m_lightDir);
+
+    for (int i = 0; i < ARRAY_SIZE_IN_ELEMENTS(m_pTextures); i++) {
+        if (m_pTextures[i]) {
+            m_pTextures[i]->Bind(COLOR_TEXTURE_UNIT_0 + i);
+        }
+    }
+
+    m_clipmapRenderer.Render(m_clipmap, m_clipmapTech, Camera.GetPos());
+}
+
+
+void BaseTerrain::ApplyBrush(const TerrainBrush& Brush, int x0, int z0, int x1, int z1)
+{
+    if (!ClipBrushRect(m_terrainSize, x0, z0, x1, z1)) {
+        return;
+    }
+
+    ApplyTerrainBrush(m_heightMap, m_terrainSize, Brush, x0, z0, x1, z1, m_brushScratch);
+
+    m_geomipGrid.UpdateHeights(x0, z0, x1, z1);
+    m_query.UpdateRegion(x0, z0, x1, z1);
+
+    float MinHeight, MaxHeight;
+    m_geomipGrid.GetMinMaxHeight(MinHeight, MaxHeight);
+
+    if ((MinHeight != m_minHeight) || (MaxHeight != m_maxHeight)) {
+        SetMinMaxHeight(MinHeight, MaxHeight);
+    }
+}
+
+
 void BaseTerrain::SetMinMaxHeight(float MinHeight, float MaxHeight)
 {
     m_minHeight = MinHeight;
@@ -183,12 +274,22 @@ void BaseTerrain::SetMinMaxHeight(float MinHeight, float MaxHeight)
 
     m_terrainTech.Enable();
     m_terrainTech.SetMinMaxHeight(MinHeight, MaxHeight);
+
+    if (m_isClipmapInitialized) {
+        m_clipmapTech.Enable();
+        m_clipmapTech.SetMinMaxHeight(MinHeight, MaxHeight);
+    }
 }
 
 
 void BaseTerrain::SetTextureHeights(float Tex0Height, float Tex1Height, float Tex2Height, float Tex3Height)
 {
     m_terrainTech.SetTextureHeights(Tex0Height, Tex1Height, Tex2Height, Tex3Height); 
+
+    if (m_isClipmapInitialized) {
+        m_clipmapTech.Enable();
+        m_clipmapTech.SetTextureHeights(Tex0Height, Tex1Height, Tex2Height, Tex3Height);
+    }
 }
 
 
@@ -205,6 +306,12 @@ Vector3f BaseTerrain::ConstrainCameraPosToTerrain(const Vector3f& CameraPos)
 {
     Vector3f NewCameraPos = CameraPos;
 
+    // The clipmap world has no edges
+    if (m_isClipmapMode) {
+        NewCameraPos.y = m_clipmap.GetHeight(CameraPos.x, CameraPos.z) + m_cameraHeight;
+        return NewCameraPos;
+    }
+
     // Make sure camera doesn't go outside of the terrain bounds
     if (CameraPos.x < 0.0f) {
         NewCameraPos.x = 0.0f;
@@ -25,7 +25,12 @@
 #include "ogldev_texture.h"
 
 #include "geomip_grid.h"
+#include "terrain_brush.h"
+#include "terrain_query.h"
 #include "terrain_technique.h"
+#include "clipmap.h"
+#include "clipmap_renderer.h"
+#include "clipmap_technique.h"
 #include "ogldev_skydome.h"
 
 class BaseTerrain
@@ -67,6 +72,31 @@ class BaseTerrain
 
     Vector3f ConstrainCameraPosToTerrain(const Vector3f& CameraPos);
 
+    // Writes the current height map as a tile pyramid for the clipmap mode
+    void WriteClipmapTiles(const char* pTileDir, int TileSize, int NumLevels);
+
+    // Switches to the clipmap mode. The heights are streamed from the tiles in
+    // pTileDir so the world can be much larger than the height map.
+    // LevelSize is in cells per side - a power of two.
+    void InitClipmap(const char* pTileDir, int TileSize, int NumLevels, int LevelSize);
+
+    void SetClipmapMode(bool Enabled) { m_isClipmapMode = Enabled && m_isClipmapInitialized; }
+
+    bool IsClipmapMode() const { return m_isClipmapMode; }
+
+    // Applies a brush to the half open rect [x0, x1) x [z0, z1) of the height
+    // map. Only the normals and bounds around the rect are recalculated and
+    // the changed vertices are uploaded over the next frames, at most
+    // SetMaxUploadBytesPerFrame bytes per frame. The clipmap mode doesn't see
+    // the edits until the tiles are written again.
+    void ApplyBrush(const TerrainBrush& Brush, int x0, int z0, int x1, int z1);
+
+    void SetMaxUploadBytesPerFrame(int MaxBytes) { m_maxUploadBytesPerFrame = MaxBytes; }
+
+    // Batched height samples and ray casts. Valid once the terrain is
+    // finalized and kept up to date with the brushes.
+    const TerrainQuery& GetQuery() const { return m_query; }
+
  protected:
 
 	void LoadHeightMapFile(const char* pFilename);
@@ -77,6 +107,8 @@ class BaseTerrain
 
     float GetWorldHeight(float x, float z) const;
 
+    void RenderClipmap(const BasicCamera& Camera);
+
     int m_terrainSize = 0;
     int m_patchSize = 0;
 	float m_worldScale = 1.0f;
@@ -92,6 +124,17 @@ private:
     Vector3f m_lightDir;
     float m_cameraHeight = 2.0f;
     Skydome* m_pSkydome = NULL;
+
+    HeightTileStreamer m_tileStreamer;
+    Clipmap m_clipmap;
+    ClipmapRenderer m_clipmapRenderer;
+    ClipmapTechnique m_clipmapTech;
+    bool m_isClipmapInitialized = false;
+    bool m_isClipmapMode = false;
+
+    TerrainQuery m_query;
+    int m_maxUploadBytesPerFrame = 512 * 1024;
+    std::vector<float> m_brushScratch;
 };
 
 #endif
@@ -0,0 +1,135 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+#include "terrain_brush.h"
+
+
+bool ClipBrushRect(int Size, int& x0, int& z0, int& x1, int& z1)
+{
+    x0 = std::max(x0, 0);
+    z0 = std::max(z0, 0);
+    x1 = std::min(x1, Size);
+    z1 = std::min(z1, Size);
+
+    return (x0 < x1) && (z0 < z1);
+}
+
+
+float CalcBrushWeight(int x0, int z0, int x1, int z1, int x, int z)
+{
+    // The ellipse reaches half a texel past the outer texels so that the
+    // middle of the edges still gets a little of the brush
+    float RadiusX = (float)(x1 - x0) / 2.0f;
+    float RadiusZ = (float)(z1 - z0) / 2.0f;
+    float CenterX = (float)x0 + RadiusX - 0.5f;
+    float CenterZ = (float)z0 + RadiusZ - 0.5f;
+
+    float dx = ((float)x - CenterX) / RadiusX;
+    float dz = ((float)z - CenterZ) / RadiusZ;
+    float d = sqrtf(dx * dx + dz * dz);
+
+    if (d >= 1.0f) {
+        return 0.0f;
+    }
+
+    return 1.0f - d * d * (3.0f - 2.0f * d);
+}
+
+
+static void ApplySmoothBrush(Array2D<float>& HeightMap, int Size, float Strength,
+                             int x0, int z0, int x1, int z1, std::vector<float>& Scratch)
+{
+    // The source heights with a border of one texel for the neighbors
+    int SrcX0 = std::max(x0 - 1, 0);
+    int SrcZ0 = std::max(z0 - 1, 0);
+    int SrcX1 = std::min(x1 + 1, Size);
+    int SrcZ1 = std::min(z1 + 1, Size);
+    int SrcWidth = SrcX1 - SrcX0;
+
+    Scratch.resize(SrcWidth * (SrcZ1 - SrcZ0));
+
+    for (int z = SrcZ0 ; z < SrcZ1 ; z++) {
+        for (int x = SrcX0 ; x < SrcX1 ; x++) {
+            Scratch[(z - SrcZ0) * SrcWidth + x - SrcX0] = HeightMap.Get(x, z);
+        }
+    }
+
+    for (int z = z0 ; z < z1 ; z++) {
+        for (int x = x0 ; x < x1 ; x++) {
+            float Weight = CalcBrushWeight(x0, z0, x1, z1, x, z) * Strength;
+
+            if (Weight <= 0.0f) {
+                continue;
+            }
+
+            float Sum = 0.0f;
+            int Count = 0;
+
+            for (int nz = std::max(z - 1, SrcZ0) ; nz <= std::min(z + 1, SrcZ1 - 1) ; nz++) {
+                for (int nx = std::max(x - 1, SrcX0) ; nx <= std::min(x + 1, SrcX1 - 1) ; nx++) {
+                    Sum += Scratch[(nz - SrcZ0) * SrcWidth + nx - SrcX0];
+                    Count++;
+                }
+            }
+
+            float Height = Scratch[(z - SrcZ0) * SrcWidth + x - SrcX0];
+            float Average = Sum / (float)Count;
+
+            HeightMap.Set(x, z, Height + (Average - Height) * Weight);
+        }
+    }
+}
+
+
+void ApplyTerrainBrush(Array2D<float>& HeightMap, int Size, const TerrainBrush& Brush,
+                       int x0, int z0, int x1, int z1, std::vector<float>& Scratch)
+{
+    switch (Brush.Type) {
+
+    case TERRAIN_BRUSH_RAISE:
+        for (int z = z0 ; z < z1 ; z++) {
+            for (int x = x0 ; x < x1 ; x++) {
+                float Weight = CalcBrushWeight(x0, z0, x1, z1, x, z);
+                HeightMap.At(x, z) += Brush.Strength * Weight;
+            }
+        }
+        break;
+
+    case TERRAIN_BRUSH_SMOOTH:
+        ApplySmoothBrush(HeightMap, Size, std::min(Brush.Strength, 1.0f), x0, z0, x1, z1, Scratch);
+        break;
+
+    case TERRAIN_BRUSH_FLATTEN:
+        for (int z = z0 ; z < z1 ; z++) {
+            for (int x = x0 ; x < x1 ; x++) {
+                float Weight = CalcBrushWeight(x0, z0, x1, z1, x, z) * std::min(Brush.Strength, 1.0f);
+                float Height = HeightMap.Get(x, z);
+                HeightMap.Set(x, z, Height + (Brush.TargetHeight - Height) * Weight);
+            }
+        }
+        break;
+
+    default:
+        printf("%s:%d - invalid brush type %d\n", __FILE__, __LINE__, Brush.Type);
+        exit(0);
+    }
+}
@@ -0,0 +1,55 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TERRAIN_BRUSH_H
+#define TERRAIN_BRUSH_H
+
+#include <vector>
+
+#include "ogldev_array_2d.h"
+
+enum TERRAIN_BRUSH_TYPE {
+    TERRAIN_BRUSH_RAISE = 0,      // a negative strength lowers the terrain
+    TERRAIN_BRUSH_SMOOTH = 1,
+    TERRAIN_BRUSH_FLATTEN = 2,
+    TERRAIN_BRUSH_NUM_TYPES = 3
+};
+
+
+struct TerrainBrush {
+    TERRAIN_BRUSH_TYPE Type = TERRAIN_BRUSH_RAISE;
+    float Strength = 1.0f;        // height units for raise, 0..1 for smooth and flatten
+    float TargetHeight = 0.0f;    // flatten only
+};
+
+
+// Clips the half open rect [x0, x1) x [z0, z1) to a Size x Size height map.
+// Returns false if nothing is left.
+bool ClipBrushRect(int Size, int& x0, int& z0, int& x1, int& z1);
+
+// The weight of the brush at (x, z) - one in the middle of the rect, fading
+// smoothly to zero on the ellipse that fits in it
+float CalcBrushWeight(int x0, int z0, int x1, int z1, int x, int z);
+
+// Applies the brush to the half open rect [x0, x1) x [z0, z1) of a
+// Size x Size height map. The rect must be clipped. Scratch keeps a copy of
+// the heights for the smooth brush so that the result doesn't depend on the
+// order of the texels.
+void ApplyTerrainBrush(Array2D<float>& HeightMap, int Size, const TerrainBrush& Brush,
+                       int x0, int z0, int x1, int z1, std::vector<float>& Scratch);
+
+#endif
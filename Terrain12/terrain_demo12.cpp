@@ -105,6 +105,12 @@ public:
                 ImGui::SliderFloat("Height2", &Height2, 128.0f, 192.0f);
                 ImGui::SliderFloat("Height3", &Height3, 192.0f, 256.0f);
 
+                ImGui::Text("Mode: %s (M to toggle)", m_terrain.IsClipmapMode() ? "clipmap" : "geomipmapping");
+
+                ImGui::Text("Brush: R raise, L lower, F flatten, G smooth");
+                ImGui::SliderInt("Brush radius", &this->m_brushRadius, 1, 64);
+                ImGui::SliderFloat("Brush strength", &this->m_brushStrength, 0.0f, 10.0f);
+
                 if (ImGui::Button("Generate")) {
                     m_terrain.Destroy();
                     srand(g_seed);
@@ -172,6 +178,29 @@ public:
 
     void KeyboardCB(uint key, int state)
     {
+        // The brushes keep going while the key is held down
+        if ((state == GLFW_PRESS) || (state == GLFW_REPEAT)) {
+
+            switch (key) {
+
+            case GLFW_KEY_R:
+                ApplyBrush(TERRAIN_BRUSH_RAISE, m_brushStrength);
+                break;
+
+            case GLFW_KEY_L:
+                ApplyBrush(TERRAIN_BRUSH_RAISE, -m_brushStrength);
+                break;
+
+            case GLFW_KEY_F:
+                ApplyBrush(TERRAIN_BRUSH_FLATTEN, m_brushStrength / 10.0f);
+                break;
+
+            case GLFW_KEY_G:
+                ApplyBrush(TERRAIN_BRUSH_SMOOTH, m_brushStrength / 10.0f);
+                break;
+            }
+        }
+
         if (state == GLFW_PRESS) {
 
             switch (key) {
@@ -205,6 +234,10 @@ public:
                 m_isPaused = !m_isPaused;
                 break;
 
+            case GLFW_KEY_M:
+                ToggleClipmap();
+                break;
+
             case GLFW_KEY_SPACE:
                 m_showGui = !m_showGui;
                 break;
@@ -317,6 +350,52 @@ private:
         ImGui_ImplOpenGL3_Init(glsl_version);
     }
 
+    void ToggleClipmap()
+    {
+        if (!m_isClipmapReady) {
+            // The tiles of the current height map stand in for a large world on disk
+            m_terrain.WriteClipmapTiles(CLIPMAP_TILE_DIR, CLIPMAP_TILE_SIZE, CLIPMAP_NUM_LEVELS);
+            m_terrain.InitClipmap(CLIPMAP_TILE_DIR, CLIPMAP_TILE_SIZE, CLIPMAP_NUM_LEVELS, CLIPMAP_LEVEL_SIZE);
+            m_isClipmapReady = true;
+        } else {
+            m_terrain.SetClipmapMode(!m_terrain.IsClipmapMode());
+        }
+
+        printf("clipmap %d\n", m_terrain.IsClipmapMode());
+    }
+
+
+    // The brush is centered where the camera looks at the terrain
+    void ApplyBrush(TERRAIN_BRUSH_TYPE Type, float Strength)
+    {
+        if (m_terrain.IsClipmapMode()) {
+            return;
+        }
+
+        TerrainRay Ray;
+        Ray.Origin = m_pGameCamera->GetPos();
+        Ray.Dir = m_pGameCamera->GetTarget();
+
+        TerrainRayHit Hit;
+
+        if (!m_terrain.GetQuery().CastRay(Ray, Hit)) {
+            return;
+        }
+
+        float WorldScale = m_terrain.GetWorldScale();
+        int CenterX = (int)(Hit.Pos.x / WorldScale + 0.5f);
+        int CenterZ = (int)(Hit.Pos.z / WorldScale + 0.5f);
+
+        TerrainBrush Brush;
+        Brush.Type = Type;
+        Brush.Strength = Strength;
+        Brush.TargetHeight = m_terrain.GetHeight(CenterX, CenterZ);
+
+        m_terrain.ApplyBrush(Brush, CenterX - m_brushRadius, CenterZ - m_brushRadius,
+                             CenterX + m_brushRadius + 1, CenterZ + m_brushRadius + 1);
+    }
+
+
     void ConstrainCameraToTerrain()
     {
         Vector3f NewCameraPos = m_terrain.ConstrainCameraPosToTerrain(m_pGameCamera->GetPos());
@@ -338,6 +417,9 @@ private:
     int m_patchSize = 17;
     float m_counter = 0.0f;
     bool m_constrainCamera = false;
+    bool m_isClipmapReady = false;
+    int m_brushRadius = 16;
+    float m_brushStrength = 2.0f;
 };
 
 TerrainDemo12* app = NULL;
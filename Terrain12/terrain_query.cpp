@@ -0,0 +1,671 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+#include "ogldev_math_simd.h"
+#include "terrain_query.h"
+
+#define TERRAIN_QUERY_RAYS_PER_JOB      256
+#define TERRAIN_QUERY_SAMPLES_PER_JOB   4096
+#define TERRAIN_QUERY_MAX_STACK         (4 * 32)
+
+// The node boxes are grown a little so that rays that graze the edge of a
+// cell are not lost to rounding
+#define TERRAIN_QUERY_BOX_EPSILON       1e-3f
+
+// Barycentric tolerance that closes the cracks between the triangles
+#define TERRAIN_QUERY_TRI_EPSILON       1e-5f
+
+
+// The diagonal of the cell goes through the center of the LOD 0 fan, which
+// is on odd coordinates. That makes it (x, z) - (x + 1, z + 1) when x + z is
+// even and (x + 1, z) - (x, z + 1) otherwise.
+static inline bool IsMainDiagonal(int x, int z)
+{
+    return ((x + z) & 1) == 0;
+}
+
+
+static inline float CalcCellHeight(float h00, float h10, float h01, float h11, float fx, float fz, bool MainDiagonal)
+{
+    if (MainDiagonal) {
+        if (fx >= fz) {
+            return h00 + fx * (h10 - h00) + fz * (h11 - h10);
+        } else {
+            return h00 + fz * (h01 - h00) + fx * (h11 - h01);
+        }
+    } else {
+        if (fx + fz <= 1.0f) {
+            return h00 + fx * (h10 - h00) + fz * (h01 - h00);
+        } else {
+            return h11 + (1.0f - fx) * (h01 - h11) + (1.0f - fz) * (h10 - h11);
+        }
+    }
+}
+
+
+void TerrainQuery::Init(const Array2D<float>* pHeightMap, int Size, float WorldScale)
+{
+    if (Size < 2) {
+        printf("%s:%d - the terrain must be at least 2x2 (%d)\n", __FILE__, __LINE__, Size);
+        exit(0);
+    }
+
+    m_pHeightMap = pHeightMap;
+    m_size = Size;
+    m_numCells = Size - 1;
+    m_worldScale = WorldScale;
+    m_invWorldScale = 1.0f / WorldScale;
+
+    m_levels.clear();
+
+    QuadtreeLevel Level;
+    Level.Width = m_numCells;
+    Level.Depth = m_numCells;
+    m_levels.push_back(Level);
+
+    while ((Level.Width > 1) || (Level.Depth > 1)) {
+        Level.Width = (Level.Width + 1) / 2;
+        Level.Depth = (Level.Depth + 1) / 2;
+        m_levels.push_back(Level);
+    }
+
+    for (QuadtreeLevel& l : m_levels) {
+        l.Bounds.resize(l.Width * l.Depth);
+    }
+
+    CalcCellBounds(0, 0, m_numCells, m_numCells);
+
+    for (int l = 1 ; l < (int)m_levels.size() ; l++) {
+        CalcNodeBounds(l, 0, 0, m_levels[l].Width, m_levels[l].Depth);
+    }
+}
+
+
+void TerrainQuery::UpdateRegion(int x0, int z0, int x1, int z1)
+{
+    // The cells that have one of the vertices as a corner
+    x0 = std::max(x0 - 1, 0);
+    z0 = std::max(z0 - 1, 0);
+    x1 = std::min(x1, m_numCells);
+    z1 = std::min(z1, m_numCells);
+
+    if ((x0 >= x1) || (z0 >= z1)) {
+        return;
+    }
+
+    CalcCellBounds(x0, z0, x1, z1);
+
+    for (int l = 1 ; l < (int)m_levels.size() ; l++) {
+        x0 >>= 1;
+        z0 >>= 1;
+        x1 = (x1 + 1) >> 1;
+        z1 = (z1 + 1) >> 1;
+
+        CalcNodeBounds(l, x0, z0, x1, z1);
+    }
+}
+
+
+void TerrainQuery::CalcCellBounds(int x0, int z0, int x1, int z1)
+{
+    QuadtreeLevel& Cells = m_levels[0];
+
+    for (int z = z0 ; z < z1 ; z++) {
+        for (int x = x0 ; x < x1 ; x++) {
+            float h00 = m_pHeightMap->Get(x, z);
+            float h10 = m_pHeightMap->Get(x + 1, z);
+            float h01 = m_pHeightMap->Get(x, z + 1);
+            float h11 = m_pHeightMap->Get(x + 1, z + 1);
+
+            NodeBounds& Bounds = Cells.Bounds[z * Cells.Width + x];
+            Bounds.MinHeight = std::min(std::min(h00, h10), std::min(h01, h11));
+            Bounds.MaxHeight = std::max(std::max(h00, h10), std::max(h01, h11));
+        }
+    }
+}
+
+
+void TerrainQuery::CalcNodeBounds(int Level, int x0, int z0, int x1, int z1)
+{
+    const QuadtreeLevel& Children = m_levels[Level - 1];
+    QuadtreeLevel& Nodes = m_levels[Level];
+
+    for (int z = z0 ; z < z1 ; z++) {
+        for (int x = x0 ; x < x1 ; x++) {
+            NodeBounds& Bounds = Nodes.Bounds[z * Nodes.Width + x];
+            Bounds = Children.Bounds[(2 * z) * Children.Width + 2 * x];
+
+            for (int j = 0 ; j < 2 ; j++) {
+                for (int i = 0 ; i < 2 ; i++) {
+                    int cx = 2 * x + i;
+                    int cz = 2 * z + j;
+
+                    if ((cx < Children.Width) && (cz < Children.Depth)) {
+                        const NodeBounds& Child = Children.Bounds[cz * Children.Width + cx];
+                        Bounds.MinHeight = std::min(Bounds.MinHeight, Child.MinHeight);
+                        Bounds.MaxHeight = std::max(Bounds.MaxHeight, Child.MaxHeight);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+float TerrainQuery::GetHeight(float x, float z) const
+{
+    float MaxCoord = (float)m_numCells;
+    float fx = std::min(std::max(x * m_invWorldScale, 0.0f), MaxCoord);
+    float fz = std::min(std::max(z * m_invWorldScale, 0.0f), MaxCoord);
+
+    int cx = std::min((int)fx, m_numCells - 1);
+    int cz = std::min((int)fz, m_numCells - 1);
+
+    fx -= (float)cx;
+    fz -= (float)cz;
+
+    const float* p = m_pHeightMap->GetBaseAddr() + cz * m_size + cx;
+
+    return CalcCellHeight(p[0], p[1], p[m_size], p[m_size + 1], fx, fz, IsMainDiagonal(cx, cz));
+}
+
+
+void TerrainQuery::GetHeights(const Vector2f* pPoints, float* pHeights, int Count, JobSystem* pJobs) const
+{
+    if (pJobs) {
+        int NumJobs = (Count + TERRAIN_QUERY_SAMPLES_PER_JOB - 1) / TERRAIN_QUERY_SAMPLES_PER_JOB;
+
+        pJobs->Dispatch(NumJobs, [&](int Job, int) {
+            int Start = Job * TERRAIN_QUERY_SAMPLES_PER_JOB;
+            int End = std::min(Start + TERRAIN_QUERY_SAMPLES_PER_JOB, Count);
+            GetHeightsRange(pPoints, pHeights, Start, End);
+        });
+    } else {
+        ParallelFor(0, Count, [&](int Start, int End) {
+            GetHeightsRange(pPoints, pHeights, Start, End);
+        }, TERRAIN_QUERY_SAMPLES_PER_JOB);
+    }
+}
+
+
+// Four samples at a time - the heights are gathered one by one but the cell
+// math and the choice of the triangle are done on all four
+void TerrainQuery::GetHeightsRange(const Vector2f* pPoints, float* pHeights, int Start, int End) const
+{
+    const float* pHeightMap = m_pHeightMap->GetBaseAddr();
+    int i = Start;
+
+#if defined(OGLDEV_MATH_SSE)
+    __m128 InvScale = _mm_set1_ps(m_invWorldScale);
+    __m128 Zero = _mm_setzero_ps();
+    __m128 One = _mm_set1_ps(1.0f);
+    __m128 MaxCoord = _mm_set1_ps((float)m_numCells);
+    __m128 MaxCell = _mm_set1_ps((float)(m_numCells - 1));
+
+    for ( ; i + 4 <= End ; i += 4) {
+        __m128 x = _mm_setr_ps(pPoints[i].x, pPoints[i + 1].x, pPoints[i + 2].x, pPoints[i + 3].x);
+        __m128 z = _mm_setr_ps(pPoints[i].y, pPoints[i + 1].y, pPoints[i + 2].y, pPoints[i + 3].y);
+
+        x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(x, InvScale), Zero), MaxCoord);
+        z = _mm_min_ps(_mm_max_ps(_mm_mul_ps(z, InvScale), Zero), MaxCoord);
+
+        // Truncation is floor because the coordinates are not negative
+        __m128 CellX = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(x)), MaxCell);
+        __m128 CellZ = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(z)), MaxCell);
+        __m128 fx = _mm_sub_ps(x, CellX);
+        __m128 fz = _mm_sub_ps(z, CellZ);
+
+        __m128i cx = _mm_cvttps_epi32(CellX);
+        __m128i cz = _mm_cvttps_epi32(CellZ);
+
+        int CX[4], CZ[4];
+        _mm_storeu_si128((__m128i*)CX, cx);
+        _mm_storeu_si128((__m128i*)CZ, cz);
+
+        float H00[4], H10[4], H01[4], H11[4];
+
+        for (int k = 0 ; k < 4 ; k++) {
+            const float* p = pHeightMap + CZ[k] * m_size + CX[k];
+            H00[k] = p[0];
+            H10[k] = p[1];
+            H01[k] = p[m_size];
+            H11[k] = p[m_size + 1];
+        }
+
+        __m128 h00 = _mm_loadu_ps(H00);
+        __m128 h10 = _mm_loadu_ps(H10);
+        __m128 h01 = _mm_loadu_ps(H01);
+        __m128 h11 = _mm_loadu_ps(H11);
+
+        __m128i Parity = _mm_and_si128(_mm_add_epi32(cx, cz), _mm_set1_epi32(1));
+        __m128 MainDiagonal = _mm_castsi128_ps(_mm_cmpeq_epi32(Parity, _mm_setzero_si128()));
+
+        // The two triangles of each diagonal
+        __m128 MainLower = _mm_add_ps(h00, _mm_add_ps(_mm_mul_ps(fx, _mm_sub_ps(h10, h00)), _mm_mul_ps(fz, _mm_sub_ps(h11, h10))));
+        __m128 MainUpper = _mm_add_ps(h00, _mm_add_ps(_mm_mul_ps(fz, _mm_sub_ps(h01, h00)), _mm_mul_ps(fx, _mm_sub_ps(h11, h01))));
+        __m128 AntiLower = _mm_add_ps(h00, _mm_add_ps(_mm_mul_ps(fx, _mm_sub_ps(h10, h00)), _mm_mul_ps(fz, _mm_sub_ps(h01, h00))));
+        __m128 AntiUpper = _mm_add_ps(h11, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(One, fx), _mm_sub_ps(h01, h11)),
+                                                      _mm_mul_ps(_mm_sub_ps(One, fz), _mm_sub_ps(h10, h11))));
+
+        __m128 IsMainLower = _mm_cmpge_ps(fx, fz);
+        __m128 IsAntiLower = _mm_cmple_ps(_mm_add_ps(fx, fz), One);
+
+        __m128 Main = _mm_or_ps(_mm_and_ps(IsMainLower, MainLower), _mm_andnot_ps(IsMainLower, MainUpper));
+        __m128 Anti = _mm_or_ps(_mm_and_ps(IsAntiLower, AntiLower), _mm_andnot_ps(IsAntiLower, AntiUpper));
+
+        _mm_storeu_ps(pHeights + i, _mm_or_ps(_mm_and_ps(MainDiagonal, Main), _mm_andnot_ps(MainDiagonal, Anti)));
+    }
+#elif defined(OGLDEV_MATH_NEON)
+    float32x4_t InvScale = vdupq_n_f32(m_invWorldScale);
+    float32x4_t Zero = vdupq_n_f32(0.0f);
+    float32x4_t One = vdupq_n_f32(1.0f);
+    float32x4_t MaxCoord = vdupq_n_f32((float)m_numCells);
+    float32x4_t MaxCell = vdupq_n_f32((float)(m_numCells - 1));
+
+    for ( ; i + 4 <= End ; i += 4) {
+        const float X[4] = { pPoints[i].x, pPoints[i + 1].x, pPoints[i + 2].x, pPoints[i + 3].x };
+        const float Z[4] = { pPoints[i].y, pPoints[i + 1].y, pPoints[i + 2].y, pPoints[i + 3].y };
+
+        float32x4_t x = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(X), InvScale), Zero), MaxCoord);
+        float32x4_t z = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(Z), InvScale), Zero), MaxCoord);
+
+        float32x4_t CellX = vminq_f32(vcvtq_f32_s32(vcvtq_s32_f32(x)), MaxCell);
+        float32x4_t CellZ = vminq_f32(vcvtq_f32_s32(vcvtq_s32_f32(z)), MaxCell);
+        float32x4_t fx = vsubq_f32(x, CellX);
+        float32x4_t fz = vsubq_f32(z, CellZ);
+
+        int32x4_t cx = vcvtq_s32_f32(CellX);
+        int32x4_t cz = vcvtq_s32_f32(CellZ);
+
+        int CX[4], CZ[4];
+        vst1q_s32(CX, cx);
+        vst1q_s32(CZ, cz);
+
+        float H00[4], H10[4], H01[4], H11[4];
+
+        for (int k = 0 ; k < 4 ; k++) {
+            const float* p = pHeightMap + CZ[k] * m_size + CX[k];
+            H00[k] = p[0];
+            H10[k] = p[1];
+            H01[k] = p[m_size];
+            H11[k] = p[m_size + 1];
+        }
+
+        float32x4_t h00 = vld1q_f32(H00);
+        float32x4_t h10 = vld1q_f32(H10);
+        float32x4_t h01 = vld1q_f32(H01);
+        float32x4_t h11 = vld1q_f32(H11);
+
+        uint32x4_t MainDiagonal = vceqq_s32(vandq_s32(vaddq_s32(cx, cz), vdupq_n_s32(1)), vdupq_n_s32(0));
+
+        float32x4_t MainLower = vaddq_f32(h00, vaddq_f32(vmulq_f32(fx, vsubq_f32(h10, h00)), vmulq_f32(fz, vsubq_f32(h11, h10))));
+        float32x4_t MainUpper = vaddq_f32(h00, vaddq_f32(vmulq_f32(fz, vsubq_f32(h01, h00)), vmulq_f32(fx, vsubq_f32(h11, h01))));
+        float32x4_t AntiLower = vaddq_f32(h00, vaddq_f32(vmulq_f32(fx, vsubq_f32(h10, h00)), vmulq_f32(fz, vsubq_f32(h01, h00))));
+        float32x4_t AntiUpper = vaddq_f32(h11, vaddq_f32(vmulq_f32(vsubq_f32(One, fx), vsubq_f32(h01, h11)),
+                                                         vmulq_f32(vsubq_f32(One, fz), vsubq_f32(h10, h11))));
+
+        float32x4_t Main = vbslq_f32(vcgeq_f32(fx, fz), MainLower, MainUpper);
+        float32x4_t Anti = vbslq_f32(vcleq_f32(vaddq_f32(fx, fz), One), AntiLower, AntiUpper);
+
+        vst1q_f32(pHeights + i, vbslq_f32(MainDiagonal, Main, Anti));
+    }
+#endif
+
+    for ( ; i < End ; i++) {
+        pHeights[i] = GetHeight(pPoints[i].x, pPoints[i].y);
+    }
+}
+
+
+// Returns a bit for every child of the node whose box the ray enters within
+// MaxDistance. Child (2x + i, 2z + j) is bit j * 2 + i.
+int TerrainQuery::TestChildren(int Level, int x, int z, const Vector3f& Origin, const Vector3f& InvDir, float MaxDistance) const
+{
+    const QuadtreeLevel& Children = m_levels[Level - 1];
+    float ChildSize = (float)(1 << (Level - 1));
+
+    float MinX[4], MaxX[4], MinY[4], MaxY[4], MinZ[4], MaxZ[4];
+    int ValidMask = 0;
+
+    for (int k = 0 ; k < 4 ; k++) {
+        int cx = 2 * x + (k & 1);
+        int cz = 2 * z + (k >> 1);
+
+        if ((cx < Children.Width) && (cz < Children.Depth)) {
+            const NodeBounds& Bounds = Children.Bounds[cz * Children.Width + cx];
+            MinX[k] = (float)cx * ChildSize * m_worldScale - TERRAIN_QUERY_BOX_EPSILON;
+            MaxX[k] = std::min((float)(cx + 1) * ChildSize, (float)m_numCells) * m_worldScale + TERRAIN_QUERY_BOX_EPSILON;
+            MinZ[k] = (float)cz * ChildSize * m_worldScale - TERRAIN_QUERY_BOX_EPSILON;
+            MaxZ[k] = std::min((float)(cz + 1) * ChildSize, (float)m_numCells) * m_worldScale + TERRAIN_QUERY_BOX_EPSILON;
+            MinY[k] = Bounds.MinHeight - TERRAIN_QUERY_BOX_EPSILON;
+            MaxY[k] = Bounds.MaxHeight + TERRAIN_QUERY_BOX_EPSILON;
+            ValidMask |= 1 << k;
+        } else {
+            MinX[k] = MaxX[k] = MinY[k] = MaxY[k] = MinZ[k] = MaxZ[k] = 0.0f;
+        }
+    }
+
+    int Mask = 0;
+
+#if defined(OGLDEV_MATH_SSE)
+    __m128 ox = _mm_set1_ps(Origin.x);
+    __m128 oy = _mm_set1_ps(Origin.y);
+    __m128 oz = _mm_set1_ps(Origin.z);
+    __m128 ix = _mm_set1_ps(InvDir.x);
+    __m128 iy = _mm_set1_ps(InvDir.y);
+    __m128 iz = _mm_set1_ps(InvDir.z);
+
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(MinX), ox), ix);
+    __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(MaxX), ox), ix);
+    __m128 Near = _mm_min_ps(t1, t2);
+    __m128 Far = _mm_max_ps(t1, t2);
+
+    t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(MinY), oy), iy);
+    t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(MaxY), oy), iy);
+    Near = _mm_max_ps(Near, _mm_min_ps(t1, t2));
+    Far = _mm_min_ps(Far, _mm_max_ps(t1, t2));
+
+    t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(MinZ), oz), iz);
+    t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(MaxZ), oz), iz);
+    Near = _mm_max_ps(Near, _mm_min_ps(t1, t2));
+    Far = _mm_min_ps(Far, _mm_max_ps(t1, t2));
+
+    Near = _mm_max_ps(Near, _mm_setzero_ps());
+    Far = _mm_min_ps(Far, _mm_set1_ps(MaxDistance));
+
+    Mask = _mm_movemask_ps(_mm_cmple_ps(Near, Far));
+#elif defined(OGLDEV_MATH_NEON)
+    float32x4_t ox = vdupq_n_f32(Origin.x);
+    float32x4_t oy = vdupq_n_f32(Origin.y);
+    float32x4_t oz = vdupq_n_f32(Origin.z);
+    float32x4_t ix = vdupq_n_f32(InvDir.x);
+    float32x4_t iy = vdupq_n_f32(InvDir.y);
+    float32x4_t iz = vdupq_n_f32(InvDir.z);
+
+    float32x4_t t1 = vmulq_f32(vsubq_f32(vld1q_f32(MinX), ox), ix);
+    float32x4_t t2 = vmulq_f32(vsubq_f32(vld1q_f32(MaxX), ox), ix);
+    float32x4_t Near = vminq_f32(t1, t2);
+    float32x4_t Far = vmaxq_f32(t1, t2);
+
+    t1 = vmulq_f32(vsubq_f32(vld1q_f32(MinY), oy), iy);
+    t2 = vmulq_f32(vsubq_f32(vld1q_f32(MaxY), oy), iy);
+    Near = vmaxq_f32(Near, vminq_f32(t1, t2));
+    Far = vminq_f32(Far, vmaxq_f32(t1, t2));
+
+    t1 = vmulq_f32(vsubq_f32(vld1q_f32(MinZ), oz), iz);
+    t2 = vmulq_f32(vsubq_f32(vld1q_f32(MaxZ), oz), iz);
+    Near = vmaxq_f32(Near, vminq_f32(t1, t2));
+    Far = vminq_f32(Far, vmaxq_f32(t1, t2));
+
+    Near = vmaxq_f32(Near, vdupq_n_f32(0.0f));
+    Far = vminq_f32(Far, vdupq_n_f32(MaxDistance));
+
+    uint32_t Lanes[4];
+    vst1q_u32(Lanes, vcleq_f32(Near, Far));
+
+    for (int k = 0 ; k < 4 ; k++) {
+        Mask |= (Lanes[k] & 1) << k;
+    }
+#else
+    for (int k = 0 ; k < 4 ; k++) {
+        float t1 = (MinX[k] - Origin.x) * InvDir.x;
+        float t2 = (MaxX[k] - Origin.x) * InvDir.x;
+        float Near = std::min(t1, t2);
+        float Far = std::max(t1, t2);
+
+        t1 = (MinY[k] - Origin.y) * InvDir.y;
+        t2 = (MaxY[k] - Origin.y) * InvDir.y;
+        Near = std::max(Near, std::min(t1, t2));
+        Far = std::min(Far, std::max(t1, t2));
+
+        t1 = (MinZ[k] - Origin.z) * InvDir.z;
+        t2 = (MaxZ[k] - Origin.z) * InvDir.z;
+        Near = std::max(Near, std::min(t1, t2));
+        Far = std::min(Far, std::max(t1, t2));
+
+        Near = std::max(Near, 0.0f);
+        Far = std::min(Far, MaxDistance);
+
+        if (Near <= Far) {
+            Mask |= 1 << k;
+        }
+    }
+#endif
+
+    return Mask & ValidMask;
+}
+
+
+// Moller-Trumbore without back face culling - a ray that starts under the
+// terrain hits it from below
+static bool IntersectTriangle(const Vector3f& Origin, const Vector3f& Dir,
+                              const Vector3f& p0, const Vector3f& p1, const Vector3f& p2, float& t)
+{
+    Vector3f e1 = p1 - p0;
+    Vector3f e2 = p2 - p0;
+    Vector3f p = Dir.Cross(e2);
+    float Det = e1.Dot(p);
+
+    if (fabsf(Det) < 1e-12f) {
+        return false;
+    }
+
+    float InvDet = 1.0f / Det;
+    Vector3f s = Origin - p0;
+    float u = s.Dot(p) * InvDet;
+
+    if ((u < -TERRAIN_QUERY_TRI_EPSILON) || (u > 1.0f + TERRAIN_QUERY_TRI_EPSILON)) {
+        return false;
+    }
+
+    Vector3f q = s.Cross(e1);
+    float v = Dir.Dot(q) * InvDet;
+
+    if ((v < -TERRAIN_QUERY_TRI_EPSILON) || (u + v > 1.0f + TERRAIN_QUERY_TRI_EPSILON)) {
+        return false;
+    }
+
+    t = e2.Dot(q) * InvDet;
+
+    return true;
+}
+
+
+bool TerrainQuery::IntersectCell(int x, int z, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, TerrainRayHit& Hit) const
+{
+    float x0 = (float)x * m_worldScale;
+    float x1 = (float)(x + 1) * m_worldScale;
+    float z0 = (float)z * m_worldScale;
+    float z1 = (float)(z + 1) * m_worldScale;
+
+    Vector3f p00(x0, m_pHeightMap->Get(x, z), z0);
+    Vector3f p10(x1, m_pHeightMap->Get(x + 1, z), z0);
+    Vector3f p01(x0, m_pHeightMap->Get(x, z + 1), z1);
+    Vector3f p11(x1, m_pHeightMap->Get(x + 1, z + 1), z1);
+
+    Vector3f Triangles[2][3];
+
+    if (IsMainDiagonal(x, z)) {
+        Triangles[0][0] = p00; Triangles[0][1] = p10; Triangles[0][2] = p11;
+        Triangles[1][0] = p00; Triangles[1][1] = p11; Triangles[1][2] = p01;
+    } else {
+        Triangles[0][0] = p00; Triangles[0][1] = p10; Triangles[0][2] = p01;
+        Triangles[1][0] = p10; Triangles[1][1] = p11; Triangles[1][2] = p01;
+    }
+
+    float ClosestDistance = MaxDistance;
+    int ClosestTriangle = -1;
+
+    for (int i = 0 ; i < 2 ; i++) {
+        float t;
+
+        if (IntersectTriangle(Origin, Dir, Triangles[i][0], Triangles[i][1], Triangles[i][2], t) &&
+            (t >= 0.0f) && (t <= ClosestDistance)) {
+            ClosestDistance = t;
+            ClosestTriangle = i;
+        }
+    }
+
+    if (ClosestTriangle < 0) {
+        return false;
+    }
+
+    const Vector3f* pTri = Triangles[ClosestTriangle];
+    Vector3f Normal = (pTri[1] - pTri[0]).Cross(pTri[2] - pTri[0]);
+
+    if (Normal.y < 0.0f) {
+        Normal = Normal * -1.0f;
+    }
+
+    Hit.IsHit = true;
+    Hit.Distance = ClosestDistance;
+    Hit.Pos = Origin + Dir * ClosestDistance;
+    Hit.Normal = Normal.Normalize();
+
+    return true;
+}
+
+
+// Keeps the slab tests away from division by zero. The tiny component
+// doesn't move the ray in any way that matters.
+static inline float SafeInverse(float d)
+{
+    if (fabsf(d) < 1e-20f) {
+        d = (d < 0.0f) ? -1e-20f : 1e-20f;
+    }
+
+    return 1.0f / d;
+}
+
+
+bool TerrainQuery::CastRay(const TerrainRay& Ray, TerrainRayHit& Hit) const
+{
+    Hit = TerrainRayHit();
+
+    if (m_levels.empty()) {
+        return false;
+    }
+
+    Vector3f InvDir(SafeInverse(Ray.Dir.x), SafeInverse(Ray.Dir.y), SafeInverse(Ray.Dir.z));
+
+    // The children are visited in the order the ray crosses them. A ray that
+    // only goes forward in X and Z can't enter both of the children that are
+    // diagonal to each other, so the first hit is the closest.
+    int FirstX = (Ray.Dir.x >= 0.0f) ? 0 : 1;
+    int FirstZ = (Ray.Dir.z >= 0.0f) ? 0 : 1;
+
+    struct StackEntry {
+        int Level;
+        int x;
+        int z;
+    };
+
+    StackEntry Stack[TERRAIN_QUERY_MAX_STACK];
+    int StackSize = 0;
+
+    // The root is tested as the only child of a node above it
+    int NumLevels = (int)m_levels.size();
+    const NodeBounds& Root = m_levels[NumLevels - 1].Bounds[0];
+    float Size = (float)m_numCells * m_worldScale;
+
+    float Near = 0.0f;
+    float Far = Ray.MaxDistance;
+    float Min[3] = { -TERRAIN_QUERY_BOX_EPSILON, Root.MinHeight - TERRAIN_QUERY_BOX_EPSILON, -TERRAIN_QUERY_BOX_EPSILON };
+    float Max[3] = { Size + TERRAIN_QUERY_BOX_EPSILON, Root.MaxHeight + TERRAIN_QUERY_BOX_EPSILON, Size + TERRAIN_QUERY_BOX_EPSILON };
+    float O[3] = { Ray.Origin.x, Ray.Origin.y, Ray.Origin.z };
+    float Inv[3] = { InvDir.x, InvDir.y, InvDir.z };
+
+    for (int a = 0 ; a < 3 ; a++) {
+        float t1 = (Min[a] - O[a]) * Inv[a];
+        float t2 = (Max[a] - O[a]) * Inv[a];
+        Near = std::max(Near, std::min(t1, t2));
+        Far = std::min(Far, std::max(t1, t2));
+    }
+
+    if (Near > Far) {
+        return false;
+    }
+
+    Stack[StackSize++] = { NumLevels - 1, 0, 0 };
+
+    while (StackSize > 0) {
+        StackEntry Node = Stack[--StackSize];
+
+        if (Node.Level == 0) {
+            if (IntersectCell(Node.x, Node.z, Ray.Origin, Ray.Dir, Ray.MaxDistance, Hit)) {
+                return true;
+            }
+
+            continue;
+        }
+
+        int Mask = TestChildren(Node.Level, Node.x, Node.z, Ray.Origin, InvDir, Ray.MaxDistance);
+
+        // The farthest child goes in first so that the nearest comes out first
+        for (int k = 3 ; k >= 0 ; k--) {
+            int i = (k & 1) ^ FirstX;
+            int j = (k >> 1) ^ FirstZ;
+
+            if (Mask & (1 << (j * 2 + i))) {
+                Stack[StackSize++] = { Node.Level - 1, 2 * Node.x + i, 2 * Node.z + j };
+            }
+        }
+    }
+
+    return false;
+}
+
+
+void TerrainQuery::CastRays(const TerrainRay* pRays, TerrainRayHit* pHits, int Count, JobSystem* pJobs) const
+{
+    if (pJobs) {
+        int NumJobs = (Count + TERRAIN_QUERY_RAYS_PER_JOB - 1) / TERRAIN_QUERY_RAYS_PER_JOB;
+
+        pJobs->Dispatch(NumJobs, [&](int Job, int) {
+            int Start = Job * TERRAIN_QUERY_RAYS_PER_JOB;
+            int End = std::min(Start + TERRAIN_QUERY_RAYS_PER_JOB, Count);
+
+            for (int i = Start ; i < End ; i++) {
+                CastRay(pRays[i], pHits[i]);
+            }
+        });
+    } else {
+        ParallelFor(0, Count, [&](int Start, int End) {
+            for (int i = Start ; i < End ; i++) {
+                CastRay(pRays[i], pHits[i]);
+            }
+        }, TERRAIN_QUERY_RAYS_PER_JOB);
+    }
+}
+
+
+bool TerrainQuery::IsVisible(const Vector3f& From, const Vector3f& To) const
+{
+    TerrainRay Ray;
+    Ray.Origin = From;
+    Ray.Dir = To - From;
+    Ray.MaxDistance = 1.0f;
+
+    TerrainRayHit Hit;
+
+    return !CastRay(Ray, Hit);
+}
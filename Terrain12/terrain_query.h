@@ -0,0 +1,112 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TERRAIN_QUERY_H
+#define TERRAIN_QUERY_H
+
+#include <float.h>
+#include <vector>
+
+#include "ogldev_array_2d.h"
+#include "ogldev_math_3d.h"
+#include "ogldev_parallel.h"
+
+struct TerrainRay {
+    Vector3f Origin;
+    Vector3f Dir;                   // doesn't need to be normalized
+    float MaxDistance = FLT_MAX;    // in units of Dir - 1 for a segment to Origin + Dir
+};
+
+
+struct TerrainRayHit {
+    bool IsHit = false;
+    float Distance = 0.0f;          // in units of Dir
+    Vector3f Pos;
+    Vector3f Normal;
+};
+
+
+//
+// Height and ray queries against the surface that GeomipGrid draws at LOD 0 -
+// two triangles per cell with the diagonal going through the fan centers.
+// Everything is in world space.
+//
+// The rays walk a min/max quadtree over the cells front to back and skip
+// every node whose bounding box they miss, so a ray over open terrain
+// touches a few dozen nodes instead of hundreds of cells. The four children
+// of a node are tested against the ray at once with SIMD, and the batches
+// are split across threads. The height samples are also done four at a time.
+//
+class TerrainQuery
+{
+public:
+    TerrainQuery() {}
+
+    // The height map is not copied - it must outlive the queries
+    void Init(const Array2D<float>* pHeightMap, int Size, float WorldScale);
+
+    // Refits the quadtree after the heights in the half open rect
+    // [x0, x1) x [z0, z1) of the height map changed
+    void UpdateRegion(int x0, int z0, int x1, int z1);
+
+    // Outside the terrain the height of the nearest edge is returned
+    float GetHeight(float x, float z) const;
+
+    // pPoints hold world XZ
+    void GetHeights(const Vector2f* pPoints, float* pHeights, int Count, JobSystem* pJobs = NULL) const;
+
+    bool CastRay(const TerrainRay& Ray, TerrainRayHit& Hit) const;
+
+    // A line of sight query is a ray with MaxDistance = 1
+    void CastRays(const TerrainRay* pRays, TerrainRayHit* pHits, int Count, JobSystem* pJobs = NULL) const;
+
+    bool IsVisible(const Vector3f& From, const Vector3f& To) const;
+
+private:
+
+    struct NodeBounds {
+        float MinHeight = 0.0f;
+        float MaxHeight = 0.0f;
+    };
+
+    // Level 0 has a node per cell, every level above it has a node for each
+    // 2 x 2 nodes of the one below it and the last level has a single node
+    struct QuadtreeLevel {
+        int Width = 0;
+        int Depth = 0;
+        std::vector<NodeBounds> Bounds;
+    };
+
+    void CalcCellBounds(int x0, int z0, int x1, int z1);
+
+    void CalcNodeBounds(int Level, int x0, int z0, int x1, int z1);
+
+    void GetHeightsRange(const Vector2f* pPoints, float* pHeights, int Start, int End) const;
+
+    bool IntersectCell(int x, int z, const Vector3f& Origin, const Vector3f& Dir, float MaxDistance, TerrainRayHit& Hit) const;
+
+    int TestChildren(int Level, int x, int z, const Vector3f& Origin, const Vector3f& InvDir, float MaxDistance) const;
+
+    const Array2D<float>* m_pHeightMap = NULL;
+    int m_size = 0;
+    int m_numCells = 0;
+    float m_worldScale = 1.0f;
+    float m_invWorldScale = 1.0f;
+    std::vector<QuadtreeLevel> m_levels;
+};
+
+#endif
@@ -9,6 +9,8 @@
 #define COLOR_TEXTURE_UNIT_INDEX_2 2
 #define COLOR_TEXTURE_UNIT_3 GL_TEXTURE3
 #define COLOR_TEXTURE_UNIT_INDEX_3 3
+#define HEIGHT_LEVELS_TEXTURE_UNIT GL_TEXTURE4
+#define HEIGHT_LEVELS_TEXTURE_UNIT_INDEX 4
 
 
 #endif
@@ -6,18 +6,19 @@ CPPFLAGS=`pkg-config --cflags glew glfw3 assimp`
 CPPFLAGS="$CPPFLAGS -I$OGLDEV_DIR/Include -I$OGLDEV_DIR/Common/3rdparty/ImGui/GLFW -ggdb3"
 LDFLAGS=`pkg-config --libs glew glfw3 assimp`
 LDFLAGS="$LDFLAGS -lX11 -ldl -lmeshoptimizer"
-SOURCES="terrain_demo12.cpp \
-	geomip_grid.cpp \
+SOURCES="terrain_demo13.cpp \
+	quad_list.cpp \
 	terrain_technique.cpp \
 	midpoint_disp_terrain.cpp \
 	terrain.cpp \
-	lod_manager.cpp \
 	$OGLDEV_DIR/Common/ogldev_util.cpp \
+	$OGLDEV_DIR/Common/ogldev_mapped_file.cpp \
 	$OGLDEV_DIR/Common/math_3d.cpp \
 	$OGLDEV_DIR/Common/ogldev_basic_glfw_camera.cpp \
 	$OGLDEV_DIR/Common/ogldev_glfw.cpp \
 	$OGLDEV_DIR/Common/ogldev_stb_image.cpp \
 	$OGLDEV_DIR/Common/technique.cpp \
+	$OGLDEV_DIR/Common/ogldev_gl_state.cpp \
 	$OGLDEV_DIR/Common/ogldev_texture.cpp \
 	$OGLDEV_DIR/Common/cubemap_texture.cpp \
 	$OGLDEV_DIR/Common/ogldev_skydome.cpp \
@@ -31,4 +32,4 @@ SOURCES="terrain_demo12.cpp \
 	$OGLDEV_DIR/Common/3rdparty/ImGui/GLFW/imgui_impl_glfw.cpp \
 	$OGLDEV_DIR/Common/3rdparty/ImGui/GLFW/imgui_impl_opengl3.cpp "
 
-$CC $SOURCES $CPPFLAGS $LDFLAGS -o terrain_demo12
+$CC $SOURCES $CPPFLAGS $LDFLAGS -o terrain_demo13
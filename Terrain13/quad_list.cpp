@@ -86,8 +86,8 @@ void QuadList::CreateGLState()
 	size_t NumFloats = 0;
 	
     glEnableVertexAttribArray(POS_LOC);
-    glVertexAttribPointer(POS_LOC, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(NumFloats * sizeof(float)));
-    NumFloats += 3;
+    glVertexAttribPointer(POS_LOC, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(NumFloats * sizeof(float)));
+    NumFloats += 2;
 
     glEnableVertexAttribArray(TEX_LOC);
     glVertexAttribPointer(TEX_LOC, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(NumFloats * sizeof(float)));
@@ -116,7 +116,7 @@ void QuadList::PopulateBuffers(const BaseTerrain* pTerrain)
 void QuadList::Vertex::InitVertex(const BaseTerrain* pTerrain, int Width, int Depth, int x, int z)
 {
 	float WorldScale = pTerrain->GetWorldScale();
-	Pos = Vector3f(x * WorldScale, 0.0f, z * WorldScale);
+	Pos = Vector2f(x * WorldScale, z * WorldScale);
     //Pos.Print();
 
     float TextureScale = pTerrain->GetTextureScale();
@@ -42,7 +42,7 @@ class QuadList {
  private:
 
     struct Vertex {
-        Vector3f Pos;
+        Vector2f Pos;       // XZ - the height comes from the height map in the TES
         Vector2f Tex;
 
         void InitVertex(const BaseTerrain* pTerrain, int Width, int Depth, int x, int z);
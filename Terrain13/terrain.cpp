@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "terrain.h"
+#include "ogldev_mapped_file.h"
 #include "texture_config.h"
 #include "3rdparty/stb_image_write.h"
 
@@ -76,6 +77,52 @@ void BaseTerrain::Finalize()
   //  m_heightMap.PrintFloat();
 
     m_heightMapTexture.LoadF32(m_terrainSize, m_terrainSize, m_heightMap.GetBaseAddr());
+
+    std::vector<float> PatchBounds;
+    CalcPatchBounds(PatchBounds);
+
+    m_patchBoundsTexture.LoadF32(m_numPatches - 1, m_numPatches - 1, PatchBounds.data(), 2);
+}
+
+
+// The TCS culls the patches against the frustum using these bounds so they must
+// contain every height the TES can sample inside the patch. The texel range is
+// taken from the texture coordinates of the quad list and grown by one texel for
+// the bilinear filter. The height map repeats, like the sampler.
+void BaseTerrain::CalcPatchBounds(std::vector<float>& Bounds) const
+{
+    int PatchesPerSide = m_numPatches - 1;
+    float TexelsPerPatch = m_textureScale * (float)m_terrainSize / (float)m_numPatches;
+
+    Bounds.resize(PatchesPerSide * PatchesPerSide * 2);
+
+    for (int pz = 0 ; pz < PatchesPerSide ; pz++) {
+        int z0 = (int)floorf((float)pz * TexelsPerPatch) - 1;
+        int z1 = (int)ceilf((float)(pz + 1) * TexelsPerPatch) + 1;
+
+        for (int px = 0 ; px < PatchesPerSide ; px++) {
+            int x0 = (int)floorf((float)px * TexelsPerPatch) - 1;
+            int x1 = (int)ceilf((float)(px + 1) * TexelsPerPatch) + 1;
+
+            float MinHeight = FLT_MAX;
+            float MaxHeight = -FLT_MAX;
+
+            for (int z = z0 ; z <= z1 ; z++) {
+                int WrappedZ = ((z % m_terrainSize) + m_terrainSize) % m_terrainSize;
+
+                for (int x = x0 ; x <= x1 ; x++) {
+                    int WrappedX = ((x % m_terrainSize) + m_terrainSize) % m_terrainSize;
+                    float Height = GetHeight(WrappedX, WrappedZ);
+                    MinHeight = std::min(MinHeight, Height);
+                    MaxHeight = std::max(MaxHeight, Height);
+                }
+            }
+
+            int Index = (pz * PatchesPerSide + px) * 2;
+            Bounds[Index] = MinHeight;
+            Bounds[Index + 1] = MaxHeight;
+        }
+    }
 }
 
 
@@ -117,24 +164,32 @@ void BaseTerrain::LoadFromFile(const char* pFilename)
 
 void BaseTerrain::LoadHeightMapFile(const char* pFilename)
 {
-    int FileSize = 0;
-    unsigned char* p = (unsigned char*)ReadBinaryFile(pFilename, FileSize);
+    MappedFile File;
+
+    if (!File.Open(pFilename)) {
+        OGLDEV_FILE_ERROR(pFilename);
+        exit(0);
+    }
+
+    u64 FileSize = File.GetSize();
 
     if (FileSize % sizeof(float) != 0) {
-        printf("%s:%d - '%s' does not contain an whole number of floats (size %d)\n", __FILE__, __LINE__, pFilename, FileSize);
+        printf("%s:%d - '%s' does not contain an whole number of floats (size %llu)\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_terrainSize = (int)sqrtf((float)FileSize / (float)sizeof(float));
+    m_terrainSize = (int)sqrt((double)FileSize / (double)sizeof(float));
 
     printf("Terrain size %d\n", m_terrainSize);
 
-    if ((m_terrainSize * m_terrainSize) != (FileSize / sizeof(float))) {
-        printf("%s:%d - '%s' does not contain a square height map - size %d\n", __FILE__, __LINE__, pFilename, FileSize);
+    if ((u64)m_terrainSize * m_terrainSize != (FileSize / sizeof(float))) {
+        printf("%s:%d - '%s' does not contain a square height map - size %llu\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize, (float*)p);
+    // The height map is modified later so it gets its own copy of the mapped pages
+    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize);
+    memcpy(m_heightMap.GetBaseAddr(), File.GetData(), FileSize);
 }
 
 
@@ -160,11 +215,12 @@ void BaseTerrain::SaveToFile(const char* pFilename)
 void BaseTerrain::Render(const BasicCamera& Camera)
 {
     Matrix4f VP = Camera.GetViewProjMatrix();
-    Matrix4f View = Camera.GetMatrix();
 
     m_terrainTech.Enable();
-    m_terrainTech.SetViewMatrix(View);
     m_terrainTech.SetVP(VP);
+    m_terrainTech.SetProjection(Camera.GetProjectionMat(), (int)Camera.GetPersProjInfo().Height);
+    m_terrainTech.SetNumPatches(m_numPatches - 1);
+    m_terrainTech.SetTessellationParams(m_tessParams);
 
     for (int i = 0; i < ARRAY_SIZE_IN_ELEMENTS(m_pTextures); i++) {
         if (m_pTextures[i]) {
@@ -173,6 +229,7 @@ void BaseTerrain::Render(const BasicCamera& Camera)
     }
 
     m_heightMapTexture.Bind(HEIGHT_MAP_TEXTURE_UNIT);
+    m_patchBoundsTexture.Bind(PATCH_BOUNDS_TEXTURE_UNIT);
 	
     m_terrainTech.SetLightDir(m_lightDir);
 
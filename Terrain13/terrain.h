@@ -31,7 +31,7 @@
 class BaseTerrain
 {
  public:
-    BaseTerrain() : m_heightMapTexture(GL_TEXTURE_2D) {}
+    BaseTerrain() : m_heightMapTexture(GL_TEXTURE_2D), m_patchBoundsTexture(GL_TEXTURE_2D) {}
 
     ~BaseTerrain();
 
@@ -67,6 +67,10 @@ class BaseTerrain
 
     Vector3f ConstrainCameraPosToTerrain(const Vector3f& CameraPos);
 
+    void SetTessellationParams(const TessellationParams& Params) { m_tessParams = Params; }
+
+    const TessellationParams& GetTessellationParams() const { return m_tessParams; }
+
  protected:
 
 	void LoadHeightMapFile(const char* pFilename);
@@ -77,6 +81,8 @@ class BaseTerrain
 
     float GetWorldHeight(float x, float z) const;
 
+    void CalcPatchBounds(std::vector<float>& Bounds) const;
+
     int m_terrainSize = 0;
     int m_numPatches = 0;
 	float m_worldScale = 1.0f;
@@ -86,6 +92,8 @@ private:
     float m_textureScale = 1.0f;
     Texture* m_pTextures[4] = { 0 };
     Texture m_heightMapTexture;
+    Texture m_patchBoundsTexture;       // RG - min/max height of every patch
+    TessellationParams m_tessParams;
     QuadList m_quadList;
     float m_minHeight = 0.0f;
     float m_maxHeight = 0.0f;
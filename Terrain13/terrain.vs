@@ -17,14 +17,14 @@
 
 #version 330
 
-layout (location = 0) in vec3 Pos0;
+layout (location = 0) in vec2 Pos0;     // XZ - the height comes from the height map in the TES
 layout (location = 1) in vec2 Tex0;
 
 out vec2 Tex1;
 
 void main()
 {
-    gl_Position = vec4(Pos0, 1.0);
+    gl_Position = vec4(Pos0.x, 0.0, Pos0.y, 1.0);
 
     Tex1 = Tex0;
 }
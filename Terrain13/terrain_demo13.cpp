@@ -103,6 +103,12 @@ public:
                 ImGui::SliderFloat("Height2", &Height2, 128.0f, 192.0f);
                 ImGui::SliderFloat("Height3", &Height3, 192.0f, 256.0f);
 
+                TessellationParams TessParams = m_terrain.GetTessellationParams();
+                ImGui::SliderFloat("Target edge pixels", &TessParams.TargetEdgeLength, 2.0f, 64.0f);
+                ImGui::SliderFloat("Max tess level", &TessParams.MaxTessLevel, 1.0f, 64.0f);
+                ImGui::Checkbox("Frustum culling", &TessParams.FrustumCulling);
+                m_terrain.SetTessellationParams(TessParams);
+
                 if (ImGui::Button("Generate")) {
                     m_terrain.Destroy();
                     srand(g_seed);
@@ -51,7 +51,13 @@ bool TerrainTechnique::Init()
     }
 
     m_VPLoc = GetUniformLocation("gVP");
-    m_ViewLoc = GetUniformLocation("gView");
+    m_projScaleLoc = GetUniformLocation("gProjScale");
+    m_numPatchesLoc = GetUniformLocation("gNumPatches");
+    m_patchBoundsLoc = GetUniformLocation("gPatchBounds");
+    m_targetEdgeLengthLoc = GetUniformLocation("gTargetEdgeLength");
+    m_minTessLevelLoc = GetUniformLocation("gMinTessLevel");
+    m_maxTessLevelLoc = GetUniformLocation("gMaxTessLevel");
+    m_frustumCullingLoc = GetUniformLocation("gFrustumCulling");
     m_tex0UnitLoc = GetUniformLocation("gTextureHeight0");
     m_tex1UnitLoc = GetUniformLocation("gTextureHeight1");
     m_tex2UnitLoc = GetUniformLocation("gTextureHeight2");
@@ -64,7 +70,13 @@ bool TerrainTechnique::Init()
     m_heightMapLoc = GetUniformLocation("gHeightMap");
 
     if (m_VPLoc == INVALID_UNIFORM_LOCATION ||
-        m_ViewLoc == INVALID_UNIFORM_LOCATION ||
+        m_projScaleLoc == INVALID_UNIFORM_LOCATION ||
+        m_numPatchesLoc == INVALID_UNIFORM_LOCATION ||
+        m_patchBoundsLoc == INVALID_UNIFORM_LOCATION ||
+        m_targetEdgeLengthLoc == INVALID_UNIFORM_LOCATION ||
+        m_minTessLevelLoc == INVALID_UNIFORM_LOCATION ||
+        m_maxTessLevelLoc == INVALID_UNIFORM_LOCATION ||
+        m_frustumCullingLoc == INVALID_UNIFORM_LOCATION ||
         m_tex0UnitLoc == INVALID_UNIFORM_LOCATION ||
         m_tex1UnitLoc == INVALID_UNIFORM_LOCATION ||
         m_tex2UnitLoc == INVALID_UNIFORM_LOCATION ||
@@ -85,6 +97,11 @@ bool TerrainTechnique::Init()
     glUniform1i(m_tex2UnitLoc, COLOR_TEXTURE_UNIT_INDEX_2);
     glUniform1i(m_tex3UnitLoc, COLOR_TEXTURE_UNIT_INDEX_3);
     glUniform1i(m_heightMapLoc, HEIGHT_MAP_TEXTURE_UNIT_INDEX);
+    glUniform1i(m_patchBoundsLoc, PATCH_BOUNDS_TEXTURE_UNIT_INDEX);
+
+    glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &m_maxTessGenLevel);
+
+    SetTessellationParams(TessellationParams());
 
     glUseProgram(0);
 
@@ -98,9 +115,26 @@ void TerrainTechnique::SetVP(const Matrix4f& VP)
 }
 
 
-void TerrainTechnique::SetViewMatrix(const Matrix4f& View)
+void TerrainTechnique::SetProjection(const Matrix4f& Projection, int ViewportHeight)
+{
+    glUniform1f(m_projScaleLoc, Projection.m[1][1] * (float)ViewportHeight * 0.5f);
+}
+
+
+void TerrainTechnique::SetNumPatches(int NumPatches)
 {
-    glUniformMatrix4fv(m_ViewLoc, 1, GL_TRUE, (const GLfloat*)View.m);
+    glUniform1i(m_numPatchesLoc, NumPatches);
+}
+
+
+void TerrainTechnique::SetTessellationParams(const TessellationParams& Params)
+{
+    float MaxTessLevel = std::min(Params.MaxTessLevel, (float)m_maxTessGenLevel);
+
+    glUniform1f(m_targetEdgeLengthLoc, std::max(Params.TargetEdgeLength, 1.0f));
+    glUniform1f(m_minTessLevelLoc, std::min(std::max(Params.MinTessLevel, 1.0f), MaxTessLevel));
+    glUniform1f(m_maxTessLevelLoc, MaxTessLevel);
+    glUniform1i(m_frustumCullingLoc, Params.FrustumCulling ? 1 : 0);
 }
 
 
@@ -21,6 +21,14 @@
 #include "technique.h"
 #include "ogldev_math_3d.h"
 
+struct TessellationParams {
+    float TargetEdgeLength = 16.0f;     // pixels per tessellated edge segment
+    float MinTessLevel = 1.0f;
+    float MaxTessLevel = 64.0f;         // clamped to GL_MAX_TESS_GEN_LEVEL
+    bool FrustumCulling = true;
+};
+
+
 class TerrainTechnique : public Technique
 {
 public:
@@ -31,7 +39,12 @@ public:
 
     void SetVP(const Matrix4f& VP);
 
-    void SetViewMatrix(const Matrix4f& View);
+    // Converts world units at a distance of one to pixels
+    void SetProjection(const Matrix4f& Projection, int ViewportHeight);
+
+    void SetNumPatches(int NumPatches);
+
+    void SetTessellationParams(const TessellationParams& Params);
 
     void SetTextureHeights(float Tex0Height, float Tex1Height, float Tex2Height, float Tex3Height);
 	
@@ -39,7 +52,14 @@ public:
 	
 private:
     GLuint m_VPLoc = -1;
-    GLuint m_ViewLoc = -1;
+    GLuint m_projScaleLoc = -1;
+    GLuint m_numPatchesLoc = -1;
+    GLuint m_patchBoundsLoc = -1;
+    GLuint m_targetEdgeLengthLoc = -1;
+    GLuint m_minTessLevelLoc = -1;
+    GLuint m_maxTessLevelLoc = -1;
+    GLuint m_frustumCullingLoc = -1;
+    int m_maxTessGenLevel = 64;
     GLuint m_tex0HeightLoc = -1;
     GLuint m_tex1HeightLoc = -1;
     GLuint m_tex2HeightLoc = -1;
@@ -5,7 +5,7 @@ CC=g++
 CPPFLAGS=`pkg-config --cflags glew glfw3`
 CPPFLAGS="$CPPFLAGS -I$OGLDEV_DIR/Include -ggdb3"
 LDFLAGS=`pkg-config --libs glew glfw3`
-LDFLAGS="$LDFLAGS -lX11"
-SOURCES="terrain_demo2.cpp terrain.cpp triangle_list.cpp terrain_technique.cpp fault_formation_terrain.cpp $OGLDEV_DIR/Common/ogldev_util.cpp $OGLDEV_DIR/Common/math_3d.cpp $OGLDEV_DIR/Common/ogldev_basic_glfw_camera.cpp $OGLDEV_DIR/Common/ogldev_glfw.cpp $OGLDEV_DIR/Common/technique.cpp"
+LDFLAGS="$LDFLAGS -lX11 -lpthread"
+SOURCES="terrain_demo2.cpp terrain.cpp triangle_list.cpp terrain_technique.cpp fault_formation_terrain.cpp $OGLDEV_DIR/Common/ogldev_util.cpp $OGLDEV_DIR/Common/ogldev_index_encoder.cpp $OGLDEV_DIR/Common/ogldev_mapped_file.cpp $OGLDEV_DIR/Common/math_3d.cpp $OGLDEV_DIR/Common/ogldev_basic_glfw_camera.cpp $OGLDEV_DIR/Common/ogldev_glfw.cpp $OGLDEV_DIR/Common/technique.cpp $OGLDEV_DIR/Common/ogldev_gl_state.cpp"
 
 $CC $SOURCES $CPPFLAGS $LDFLAGS -o terrain_demo2
@@ -16,7 +16,19 @@
 */
 
 
+#include <algorithm>
+
 #include "fault_formation_terrain.h"
+#include "ogldev_parallel.h"
+#include "ogldev_math_simd.h"
+
+// 64 x 64 floats (16KB) stay in the L1 cache while all the faults are applied
+#define FAULT_TILE_SIZE 64
+
+// Number of columns that the vertical FIR sweeps filter together
+#define FIR_COLUMN_BLOCK 64
+
+#define FIR_MIN_ROWS_PER_THREAD 64
 
 void FaultFormationTerrain::CreateFaultFormation(int TerrainSize, int Iterations, float MinHeight, float MaxHeight, float Filter)
 {  
@@ -41,78 +53,177 @@ void FaultFormationTerrain::CreateFaultFormationInternal(int Iterations, float M
 {
     float DeltaHeight = MaxHeight - MinHeight;
 
+    // The faults are generated up front in the same order as before so
+    // a given rand() seed still produces the same terrain
+    std::vector<Fault> Faults(Iterations);
+
     for (int CurIter = 0 ; CurIter < Iterations ; CurIter++) {
         float IterationRatio = ((float)CurIter / (float)Iterations);
-        float Height = MaxHeight - IterationRatio * DeltaHeight;
-
-        TerrainPoint p1, p2;
+        Fault& f = Faults[CurIter];
+        f.Height = MaxHeight - IterationRatio * DeltaHeight;
 
-        GenRandomTerrainPoints(p1, p2);
+        TerrainPoint p2;
 
-        int DirX = p2.x - p1.x;
-        int DirZ = p2.z - p1.z;
+        GenRandomTerrainPoints(f.p1, p2);
 
-        for (int z = 0 ; z < m_terrainSize ; z++) {
-            for (int x = 0 ; x < m_terrainSize ; x++) {
-                int DirX_in = x - p1.x;
-                int DirZ_in = z - p1.z;
+        f.DirX = p2.x - f.p1.x;
+        f.DirZ = p2.z - f.p1.z;
+    }
 
-                int CrossProduct = DirX_in * DirZ - DirX * DirZ_in;
+    // Every tile takes all the faults while it is in the cache. The faults
+    // are added in order in every cell so the result doesn't depend on the
+    // number of threads.
+    int NumTilesX = (m_terrainSize + FAULT_TILE_SIZE - 1) / FAULT_TILE_SIZE;
+
+    ParallelFor(0, NumTilesX * NumTilesX, [&](int First, int Last) {
+        for (int Tile = First ; Tile < Last ; Tile++) {
+            int StartX = (Tile % NumTilesX) * FAULT_TILE_SIZE;
+            int StartZ = (Tile / NumTilesX) * FAULT_TILE_SIZE;
+            int EndX = std::min(StartX + FAULT_TILE_SIZE, m_terrainSize);
+            int EndZ = std::min(StartZ + FAULT_TILE_SIZE, m_terrainSize);
+            ApplyFaultsToTile(Faults, StartX, StartZ, EndX, EndZ);
+        }
+    });
 
-                if (CrossProduct > 0) {
-                    float CurHeight = m_heightMap.Get(x, z);
-                    m_heightMap.Set(x, z, CurHeight + Height);
-                }
-            }
-        }        
-    }
-	
     ApplyFIRFilter(Filter);
 }
 
 
-void FaultFormationTerrain::ApplyFIRFilter(float Filter)
+// Adds Height to the cells of the row where the cross product is positive.
+// Cross is the cross product of the first cell and it grows by DirZ per cell.
+static void AddFaultToRow(float* pRow, int Count, int Cross, int DirZ, float Height)
 {
-    // left to right
-    for (int z = 0 ; z < m_terrainSize ; z++) {
-        float PrevVal = m_heightMap.Get(0, z);
-        for (int x = 1 ; x < m_terrainSize ; x++) {
-            PrevVal = FIRFilterSinglePoint(x, z, PrevVal, Filter);
-        }
+    int i = 0;
+
+#if defined(OGLDEV_MATH_SSE)
+    __m128i Cross4 = _mm_add_epi32(_mm_set1_epi32(Cross), _mm_setr_epi32(0, DirZ, 2 * DirZ, 3 * DirZ));
+    const __m128i Step4 = _mm_set1_epi32(4 * DirZ);
+    const __m128i Zero4 = _mm_setzero_si128();
+    const __m128 Height4 = _mm_set1_ps(Height);
+
+    for ( ; i + 4 <= Count ; i += 4) {
+        __m128 Mask = _mm_castsi128_ps(_mm_cmpgt_epi32(Cross4, Zero4));
+        _mm_storeu_ps(pRow + i, _mm_add_ps(_mm_loadu_ps(pRow + i), _mm_and_ps(Mask, Height4)));
+        Cross4 = _mm_add_epi32(Cross4, Step4);
     }
 
-    // right to left
-    for (int z = 0 ; z < m_terrainSize ; z++) {
-        float PrevVal = m_heightMap.Get(m_terrainSize - 1, z);
-        for (int x = m_terrainSize - 2 ; x >= 0 ; x--) {
-            PrevVal = FIRFilterSinglePoint(x, z, PrevVal, Filter);
-        }
+    Cross += i * DirZ;
+#elif defined(OGLDEV_MATH_NEON)
+    const int32_t Lanes[4] = { 0, DirZ, 2 * DirZ, 3 * DirZ };
+    int32x4_t Cross4 = vaddq_s32(vdupq_n_s32(Cross), vld1q_s32(Lanes));
+    const int32x4_t Step4 = vdupq_n_s32(4 * DirZ);
+    const uint32x4_t Height4 = vreinterpretq_u32_f32(vdupq_n_f32(Height));
+
+    for ( ; i + 4 <= Count ; i += 4) {
+        uint32x4_t Mask = vcgtq_s32(Cross4, vdupq_n_s32(0));
+        float32x4_t Delta = vreinterpretq_f32_u32(vandq_u32(Mask, Height4));
+        vst1q_f32(pRow + i, vaddq_f32(vld1q_f32(pRow + i), Delta));
+        Cross4 = vaddq_s32(Cross4, Step4);
     }
 
-    // bottom to top
-    for (int x = 0 ; x < m_terrainSize ; x++) {
-        float PrevVal = m_heightMap.Get(x, 0);
-        for (int z = 1 ; z < m_terrainSize ; z++) {
-            PrevVal = FIRFilterSinglePoint(x, z, PrevVal, Filter);
+    Cross += i * DirZ;
+#endif
+
+    for ( ; i < Count ; i++) {
+        if (Cross > 0) {
+            pRow[i] += Height;
         }
+
+        Cross += DirZ;
     }
+}
+
 
-    // top to bottom
-    for (int x = 0 ; x < m_terrainSize ; x++) {
-        float PrevVal = m_heightMap.Get(x, m_terrainSize - 1);
-        for (int z = m_terrainSize - 2 ; z >= 0 ; z--) {
-            PrevVal = FIRFilterSinglePoint(x, z, PrevVal, Filter);
+void FaultFormationTerrain::ApplyFaultsToTile(const std::vector<Fault>& Faults, int StartX, int StartZ, int EndX, int EndZ)
+{
+    float* pHeights = m_heightMap.GetBaseAddr();
+    int Width = EndX - StartX;
+
+    for (const Fault& f : Faults) {
+        // The cross product is linear in x and z so its range
+        // over the tile is set by the corners
+        int c0 = f.CrossProduct(StartX, StartZ);
+        int c1 = f.CrossProduct(EndX - 1, StartZ);
+        int c2 = f.CrossProduct(StartX, EndZ - 1);
+        int c3 = f.CrossProduct(EndX - 1, EndZ - 1);
+
+        int MinCross = std::min(std::min(c0, c1), std::min(c2, c3));
+        int MaxCross = std::max(std::max(c0, c1), std::max(c2, c3));
+
+        if (MaxCross <= 0) {
+            continue;
+        }
+
+        for (int z = StartZ ; z < EndZ ; z++) {
+            float* pRow = pHeights + (size_t)z * m_terrainSize + StartX;
+
+            if (MinCross > 0) {
+                for (int i = 0 ; i < Width ; i++) {
+                    pRow[i] += f.Height;
+                }
+            } else {
+                AddFaultToRow(pRow, Width, f.CrossProduct(StartX, z), f.DirZ, f.Height);
+            }
         }
     }
 }
 
 
-float FaultFormationTerrain::FIRFilterSinglePoint(int x, int z, float PrevVal, float Filter)
+static inline float FIRFilterSinglePoint(float PrevVal, float CurVal, float Filter)
+{
+    return Filter * PrevVal + (1 - Filter) * CurVal;
+}
+
+
+void FaultFormationTerrain::ApplyFIRFilter(float Filter)
 {
-    float CurVal = m_heightMap.Get(x, z);
-    float NewVal = Filter * PrevVal + (1 - Filter) * CurVal;
-    m_heightMap.Set(x, z, NewVal);
-    return NewVal;
+    float* pHeights = m_heightMap.GetBaseAddr();
+    int Size = m_terrainSize;
+
+    // The rows are independent: left to right and then right to left
+    ParallelFor(0, Size, [&](int First, int Last) {
+        for (int z = First ; z < Last ; z++) {
+            float* pRow = pHeights + (size_t)z * Size;
+
+            for (int x = 1 ; x < Size ; x++) {
+                pRow[x] = FIRFilterSinglePoint(pRow[x - 1], pRow[x], Filter);
+            }
+
+            for (int x = Size - 2 ; x >= 0 ; x--) {
+                pRow[x] = FIRFilterSinglePoint(pRow[x + 1], pRow[x], Filter);
+            }
+        }
+    }, FIR_MIN_ROWS_PER_THREAD);
+
+    // The columns are filtered in blocks of adjacent columns that advance
+    // together row by row, so the memory is still accessed sequentially.
+    // Bottom to top and then top to bottom.
+    int NumBlocks = (Size + FIR_COLUMN_BLOCK - 1) / FIR_COLUMN_BLOCK;
+
+    ParallelFor(0, NumBlocks, [&](int First, int Last) {
+        for (int Block = First ; Block < Last ; Block++) {
+            int StartX = Block * FIR_COLUMN_BLOCK;
+            int EndX = std::min(StartX + FIR_COLUMN_BLOCK, Size);
+
+            for (int z = 1 ; z < Size ; z++) {
+                float* pRow = pHeights + (size_t)z * Size;
+                const float* pPrevRow = pRow - Size;
+
+                for (int x = StartX ; x < EndX ; x++) {
+                    pRow[x] = FIRFilterSinglePoint(pPrevRow[x], pRow[x], Filter);
+                }
+            }
+
+            for (int z = Size - 2 ; z >= 0 ; z--) {
+                float* pRow = pHeights + (size_t)z * Size;
+                const float* pPrevRow = pRow + Size;
+
+                for (int x = StartX ; x < EndX ; x++) {
+                    pRow[x] = FIRFilterSinglePoint(pPrevRow[x], pRow[x], Filter);
+                }
+            }
+        }
+    });
 }
 
 
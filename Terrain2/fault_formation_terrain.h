@@ -19,6 +19,8 @@
 #ifndef FAULT_FORMATION_TERRAIN_H
 #define FAULT_FORMATION_TERRAIN_H
 
+#include <vector>
+
 #include "terrain.h"
 
 class FaultFormationTerrain : public BaseTerrain {
@@ -45,10 +47,23 @@ class FaultFormationTerrain : public BaseTerrain {
          }
      };
 
+     // A point is raised if (Pos - p1) x Dir > 0
+     struct Fault {
+         TerrainPoint p1;
+         int DirX = 0;
+         int DirZ = 0;
+         float Height = 0.0f;
+
+         int CrossProduct(int x, int z) const
+         {
+             return (x - p1.x) * DirZ - DirX * (z - p1.z);
+         }
+     };
+
     void CreateFaultFormationInternal(int Iterations, float MinHeight, float MaxHeight, float Filter);
     void GenRandomTerrainPoints(TerrainPoint& p1, TerrainPoint& p2);
+    void ApplyFaultsToTile(const std::vector<Fault>& Faults, int StartX, int StartZ, int EndX, int EndZ);
     void ApplyFIRFilter(float Filter);
-    float FIRFilterSinglePoint(int x, int z, float PrevFractalVal, float Filter);
 };
 
 #endif
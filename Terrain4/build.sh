@@ -5,18 +5,21 @@ CC=g++
 CPPFLAGS=`pkg-config --cflags glew glfw3`
 CPPFLAGS="$CPPFLAGS -I$OGLDEV_DIR/Include -I$OGLDEV_DIR/Common/3rdparty/ImGui/GLFW -ggdb3"
 LDFLAGS=`pkg-config --libs glew glfw3`
-LDFLAGS="$LDFLAGS -lX11 -ldl"
+LDFLAGS="$LDFLAGS -lX11 -ldl -lpthread"
 SOURCES="terrain_demo4.cpp \
 	single_tex_terrain_technique.cpp \
 	texture_generator.cpp terrain.cpp \
 	triangle_list.cpp terrain_technique.cpp \
 	midpoint_disp_terrain.cpp \
 	$OGLDEV_DIR/Common/ogldev_util.cpp \
+	$OGLDEV_DIR/Common/ogldev_index_encoder.cpp \
+	$OGLDEV_DIR/Common/ogldev_mapped_file.cpp \
 	$OGLDEV_DIR/Common/math_3d.cpp \
 	$OGLDEV_DIR/Common/ogldev_basic_glfw_camera.cpp \
 	$OGLDEV_DIR/Common/ogldev_glfw.cpp \
 	$OGLDEV_DIR/Common/ogldev_stb_image.cpp \
 	$OGLDEV_DIR/Common/technique.cpp \
+	$OGLDEV_DIR/Common/ogldev_gl_state.cpp \
 	$OGLDEV_DIR/Common/ogldev_texture.cpp \
 	$OGLDEV_DIR/Common/3rdparty/stb_image.cpp \
 	$OGLDEV_DIR/Common/3rdparty/ImGui/GLFW/imgui.cpp \
@@ -19,13 +19,22 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <algorithm>
 
 #include "texture_generator.h"
 #include "terrain.h"
 #include "ogldev_stb_image.h"
+#include "ogldev_parallel.h"
+#include "ogldev_math_simd.h"
 
 #include "3rdparty/stb_image_write.h"
 
+// Number of heights in the blend table
+#define BLEND_TABLE_SIZE 4096
+
+#define BAKE_MIN_ROWS_PER_THREAD 16
+
 TextureGenerator::TextureGenerator()
 {
 }
@@ -43,6 +52,79 @@ void TextureGenerator::LoadTile(const char* pFilename)
 
 
 Texture* TextureGenerator::GenerateTexture(int TextureSize, BaseTerrain* pTerrain, float MinHeight, float MaxHeight)
+{
+    int BPP = 3;
+    std::vector<unsigned char> TextureData;
+
+    BakeTexture(TextureSize, pTerrain, MinHeight, MaxHeight, TextureData);
+
+    Texture* pTexture = new Texture(GL_TEXTURE_2D);
+
+    if (!m_outputFilename.empty()) {
+        stbi_write_png(m_outputFilename.c_str(), TextureSize, TextureSize, BPP, TextureData.data(), TextureSize * BPP);
+    }
+
+    pTexture->LoadRaw(TextureSize, TextureSize, BPP, TextureData.data());
+
+    return pTexture;
+}
+
+
+// Blends the texel of every tile by its factor and stores the result as RGB.
+// The fractions are truncated like the casts of the scalar code.
+static inline void BlendTexel(const unsigned char** ppTexels, const float* pFactors, int NumTiles, unsigned char* pOut)
+{
+#if defined(OGLDEV_MATH_SSE)
+    __m128 Color = _mm_setzero_ps();
+
+    for (int Tile = 0 ; Tile < NumTiles ; Tile++) {
+        const unsigned char* p = ppTexels[Tile];
+        __m128 TileColor = _mm_cvtepi32_ps(_mm_setr_epi32(p[0], p[1], p[2], 0));
+        Color = _mm_add_ps(Color, _mm_mul_ps(_mm_set1_ps(pFactors[Tile]), TileColor));
+    }
+
+    // 32 -> 16 -> 8 bits with saturation
+    __m128i Color32 = _mm_cvttps_epi32(Color);
+    __m128i Color16 = _mm_packs_epi32(Color32, Color32);
+    int Color8 = _mm_cvtsi128_si32(_mm_packus_epi16(Color16, Color16));
+    pOut[0] = (unsigned char)(Color8 & 0xff);
+    pOut[1] = (unsigned char)((Color8 >> 8) & 0xff);
+    pOut[2] = (unsigned char)((Color8 >> 16) & 0xff);
+#elif defined(OGLDEV_MATH_NEON)
+    float32x4_t Color = vdupq_n_f32(0.0f);
+
+    for (int Tile = 0 ; Tile < NumTiles ; Tile++) {
+        const unsigned char* p = ppTexels[Tile];
+        const float TileColor[4] = { (float)p[0], (float)p[1], (float)p[2], 0.0f };
+        Color = vaddq_f32(Color, vmulq_f32(vdupq_n_f32(pFactors[Tile]), vld1q_f32(TileColor)));
+    }
+
+    // 32 -> 16 -> 8 bits with saturation
+    uint16x4_t Color16 = vqmovn_u32(vcvtq_u32_f32(Color));
+    uint8x8_t Color8 = vqmovn_u16(vcombine_u16(Color16, Color16));
+    pOut[0] = vget_lane_u8(Color8, 0);
+    pOut[1] = vget_lane_u8(Color8, 1);
+    pOut[2] = vget_lane_u8(Color8, 2);
+#else
+    float Red = 0.0f;
+    float Green = 0.0f;
+    float Blue = 0.0f;
+
+    for (int Tile = 0 ; Tile < NumTiles ; Tile++) {
+        const unsigned char* p = ppTexels[Tile];
+        Red   += pFactors[Tile] * (float)p[0];
+        Green += pFactors[Tile] * (float)p[1];
+        Blue  += pFactors[Tile] * (float)p[2];
+    }
+
+    pOut[0] = (unsigned char)std::min(Red, 255.0f);
+    pOut[1] = (unsigned char)std::min(Green, 255.0f);
+    pOut[2] = (unsigned char)std::min(Blue, 255.0f);
+#endif
+}
+
+
+void TextureGenerator::BakeTexture(int TextureSize, const BaseTerrain* pTerrain, float MinHeight, float MaxHeight, std::vector<unsigned char>& TextureData)
 {
     if (m_numTextureTiles == 0) {
         printf("%s:%d: no texture tiles loaded\n", __FILE__, __LINE__);
@@ -51,57 +133,108 @@ Texture* TextureGenerator::GenerateTexture(int TextureSize, BaseTerrain* pTerrai
 
     CalculateTextureRegions(MinHeight, MaxHeight);
 
+    CalculateBlendTable(MinHeight, MaxHeight);
+
     int BPP = 3;
-    int TextureBytes = TextureSize * TextureSize * BPP;
-    unsigned char* pTextureData = (unsigned char*)malloc(TextureBytes);
-    unsigned char* p = pTextureData;
+    TextureData.resize((size_t)TextureSize * TextureSize * BPP);
+
+    int TerrainSize = pTerrain->GetSize();
+    const float* pHeightMap = pTerrain->GetHeightMap().GetBaseAddr();
 
-    float HeightMapToTextureRatio = (float)pTerrain->GetSize() / (float)TextureSize;
+    float HeightMapToTextureRatio = (float)TerrainSize / (float)TextureSize;
 
     printf("Height map to texture ratio: %f\n", HeightMapToTextureRatio);
 
-    for (int y = 0 ; y < TextureSize ; y++) {
-        for (int x = 0 ; x < TextureSize ; x++) {
+    // The height map column and the interpolation ratio of every texture
+    // column are the same in all the rows
+    std::vector<int> BaseX(TextureSize);
+    std::vector<float> RatioX(TextureSize);
 
-            float InterpolatedHeight = pTerrain->GetHeightInterpolated((float)x * HeightMapToTextureRatio, 
-                                                                       (float)y * HeightMapToTextureRatio);
+    for (int x = 0 ; x < TextureSize ; x++) {
+        float HeightMapX = (float)x * HeightMapToTextureRatio;
+        BaseX[x] = (int)HeightMapX;
+        RatioX[x] = HeightMapX - floorf(HeightMapX);
+    }
 
-            float Red = 0.0f;
-            float Green = 0.0f;
-            float Blue = 0.0f;
+    float HeightRange = MaxHeight - MinHeight;
+    float HeightToTableIndex = (HeightRange > 0.0f) ? (float)(BLEND_TABLE_SIZE - 1) / HeightRange : 0.0f;
+    const float* pBlendTable = m_blendTable.data();
+    int NumTiles = m_numTextureTiles;
+
+    ParallelFor(0, TextureSize, [&](int FirstRow, int LastRow) {
+        for (int y = FirstRow ; y < LastRow ; y++) {
+            // Same as BaseTerrain::GetHeightInterpolated, with the row part done once
+            float HeightMapZ = (float)y * HeightMapToTextureRatio;
+            int BaseZ = (int)HeightMapZ;
+            float RatioZ = HeightMapZ - floorf(HeightMapZ);
+            bool IsLastRow = (BaseZ + 1 >= TerrainSize);
+            const float* pHeightRow = pHeightMap + (size_t)BaseZ * TerrainSize;
+            const float* pNextHeightRow = IsLastRow ? pHeightRow : pHeightRow + TerrainSize;
+
+            const unsigned char* pTileRows[MAX_TEXTURE_TILES];
+            int TileX[MAX_TEXTURE_TILES];
+
+            for (int Tile = 0 ; Tile < NumTiles ; Tile++) {
+                const STBImage& Image = m_textureTiles[Tile].Image;
+                pTileRows[Tile] = Image.m_imageData + (size_t)(y % Image.m_height) * Image.m_width * Image.m_bpp;
+                TileX[Tile] = 0;
+            }
 
-            for (int Tile = 0 ; Tile < m_numTextureTiles ; Tile++) {
-                Vector3f Color = m_textureTiles[Tile].Image.GetColor(x, y);
+            unsigned char* pOut = TextureData.data() + (size_t)y * TextureSize * BPP;
 
-                float BlendFactor = RegionPercent(Tile, InterpolatedHeight);
+            for (int x = 0 ; x < TextureSize ; x++) {
+                int bx = BaseX[x];
+                float BaseHeight = pHeightRow[bx];
+                float Height = BaseHeight;
 
-                Red   += BlendFactor * Color.r;
-                Green += BlendFactor * Color.g;
-                Blue  += BlendFactor * Color.b;
-            }
+                if (!IsLastRow && (bx + 1 < TerrainSize)) {
+                    float InterpolatedHeightX = (pHeightRow[bx + 1] - BaseHeight) * RatioX[x] + BaseHeight;
+                    float InterpolatedHeightZ = (pNextHeightRow[bx] - BaseHeight) * RatioZ + BaseHeight;
+                    Height = (InterpolatedHeightX + InterpolatedHeightZ) / 2.0f;
+                }
 
-            if (Red > 255.0f || Green > 255.0f || Blue > 255.0f) {
-                printf("%d:%d: %f %f %f\n", y, x, Red, Green, Blue);
-                exit(0);
-            }
+                float TableIndex = (Height - MinHeight) * HeightToTableIndex;
+                TableIndex = std::max(0.0f, std::min(TableIndex, (float)(BLEND_TABLE_SIZE - 1)));
+                int Entry = std::min((int)TableIndex, BLEND_TABLE_SIZE - 2);
+                float t = TableIndex - (float)Entry;
 
-            p[0] = (unsigned char)Red;
-            p[1] = (unsigned char)Green;
-            p[2] = (unsigned char)Blue;
+                const float* pEntry = pBlendTable + Entry * MAX_TEXTURE_TILES;
+                float Factors[MAX_TEXTURE_TILES];
+                const unsigned char* pTexels[MAX_TEXTURE_TILES];
 
-            p += 3;
+                for (int Tile = 0 ; Tile < NumTiles ; Tile++) {
+                    Factors[Tile] = pEntry[Tile] + (pEntry[Tile + MAX_TEXTURE_TILES] - pEntry[Tile]) * t;
+
+                    const STBImage& Image = m_textureTiles[Tile].Image;
+                    pTexels[Tile] = pTileRows[Tile] + TileX[Tile] * Image.m_bpp;
+
+                    // Wrap around like STBImage::GetColor
+                    if (++TileX[Tile] == Image.m_width) {
+                        TileX[Tile] = 0;
+                    }
+                }
+
+                BlendTexel(pTexels, Factors, NumTiles, pOut);
+                pOut += BPP;
+            }
         }
-    }
+    }, BAKE_MIN_ROWS_PER_THREAD);
+}
 
-    Texture* pTexture = new Texture(GL_TEXTURE_2D);
 
-    stbi_write_png("texture.png", TextureSize, TextureSize, BPP, pTextureData, TextureSize * BPP);
+void TextureGenerator::CalculateBlendTable(float MinHeight, float MaxHeight)
+{
+    m_blendTable.assign(BLEND_TABLE_SIZE * MAX_TEXTURE_TILES, 0.0f);
 
-    pTexture->LoadRaw(TextureSize, TextureSize, BPP, pTextureData);
+    float HeightStep = (MaxHeight - MinHeight) / (float)(BLEND_TABLE_SIZE - 1);
 
-    free(pTextureData);
+    for (int i = 0 ; i < BLEND_TABLE_SIZE ; i++) {
+        float Height = MinHeight + (float)i * HeightStep;
 
-    return pTexture;
+        for (int Tile = 0 ; Tile < m_numTextureTiles ; Tile++) {
+            m_blendTable[i * MAX_TEXTURE_TILES + Tile] = RegionPercent(Tile, Height);
+        }
+    }
 }
 
 
@@ -21,6 +21,8 @@
 #define TEXTURE_GENERATOR_H
 
 #include <stdio.h>
+#include <vector>
+#include <string>
 
 #include "ogldev_texture.h"
 #include "ogldev_stb_image.h"
@@ -50,16 +52,31 @@ class TextureGenerator {
 
     Texture* GenerateTexture(int TextureSize, BaseTerrain* pTerrain, float MinHeight, float MaxHeight);
 
+    // Blends the tiles by the height of the terrain into RGB texels. Runs on
+    // all the cores and doesn't need a GL context so it can be used offline.
+    void BakeTexture(int TextureSize, const BaseTerrain* pTerrain, float MinHeight, float MaxHeight, std::vector<unsigned char>& TextureData);
+
+    // GenerateTexture also saves the texture to this PNG file (NULL - don't save)
+    void SetOutputFilename(const char* pFilename) { m_outputFilename = pFilename ? pFilename : ""; }
+
  private:
 
     void CalculateTextureRegions(float MinHeight, float MaxHeight);
 
+    void CalculateBlendTable(float MinHeight, float MaxHeight);
+
     float RegionPercent(int Tile, float Height);
 
     #define MAX_TEXTURE_TILES 4
 
     TextureTile m_textureTiles[MAX_TEXTURE_TILES] = {};
     int m_numTextureTiles = 0;
+    std::string m_outputFilename;
+
+    // The blend factors of all the tiles at evenly spaced heights. The factors
+    // are linear between the region points so interpolating the table is
+    // almost exact.
+    std::vector<float> m_blendTable;   // MAX_TEXTURE_TILES factors per entry
 };
 
 #endif
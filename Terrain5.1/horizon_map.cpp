@@ -0,0 +1,352 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <algorithm>
+
+#include "horizon_map.h"
+#include "ogldev_parallel.h"
+#include "ogldev_math_simd.h"
+#include "ogldev_mapped_file.h"
+
+#define HORIZON_MAP_FILE_MAGIC 0x4d5a484f   // 'OHZM'
+
+// The march takes every texel up to here and then strides by one more
+// texel every HORIZON_STRIDE_GROWTH texels
+#define HORIZON_STRIDE_GROWTH 16
+
+#define HORIZON_MIN_ROWS_PER_THREAD 8
+
+// Same as the minimum brightness of the slope lighter
+#define HORIZON_AMBIENT 0.4f
+
+static const int DirX[HORIZON_NUM_DIRECTIONS] = { 1, 1, 0, -1, -1, -1,  0,  1 };
+static const int DirZ[HORIZON_NUM_DIRECTIONS] = { 0, 1, 1,  1,  0, -1, -1, -1 };
+
+struct HorizonMapFileHeader {
+    u32 Magic;
+    u32 TerrainSize;
+    u32 NumDirections;
+    u32 Padding = 0;
+};
+
+// The steps of one direction
+struct MarchDirection {
+    std::vector<int> Offsets;     // from the texel to the sample, in floats
+    std::vector<float> InvDist;   // 1 / horizontal distance of the sample
+};
+
+
+static float AngleToFloat(u8 Angle)
+{
+    return (float)Angle * ((float)M_PI * 0.5f / 255.0f);
+}
+
+
+static u8 FloatToAngle(float Angle)
+{
+    return (u8)(Angle * (255.0f / ((float)M_PI * 0.5f)) + 0.5f);
+}
+
+
+HorizonMap::~HorizonMap()
+{
+    WaitForBake();
+}
+
+
+void HorizonMap::Bake(int TerrainSize, float WorldScale, int MaxDistance)
+{
+    WaitForBake();
+
+    m_isReady = false;
+    m_terrainSize = TerrainSize;
+    m_worldScale = WorldScale;
+
+    BakeInternal(MaxDistance);
+
+    m_isReady = true;
+}
+
+
+void HorizonMap::StartBake(int TerrainSize, float WorldScale, int MaxDistance)
+{
+    WaitForBake();
+
+    m_isReady = false;
+    m_terrainSize = TerrainSize;
+    m_worldScale = WorldScale;
+
+    m_bakeThread = std::thread([this, MaxDistance]() {
+        BakeInternal(MaxDistance);
+        m_isReady = true;
+    });
+}
+
+
+void HorizonMap::WaitForBake()
+{
+    if (m_bakeThread.joinable()) {
+        m_bakeThread.join();
+    }
+}
+
+
+// Max over the steps [0, NumSteps) of the tangent of the elevation angle.
+// The steps are ordered by distance so once the highest point of the terrain
+// can't raise the horizon the rest of the march is skipped.
+static float MarchHorizon(const float* p, float HeadRoom, const MarchDirection& Dir, int NumSteps)
+{
+    const int* pOffsets = Dir.Offsets.data();
+    const float* pInvDist = Dir.InvDist.data();
+    float h0 = p[0];
+    float MaxTan = 0.0f;
+    int j = 0;
+
+#if defined(OGLDEV_MATH_SSE)
+    __m128 h04 = _mm_set1_ps(h0);
+    __m128 MaxTan4 = _mm_setzero_ps();
+
+    for ( ; j + 4 <= NumSteps ; j += 4) {
+        if (HeadRoom * pInvDist[j] <= MaxTan) {
+            break;
+        }
+
+        __m128 Heights = _mm_setr_ps(p[pOffsets[j]], p[pOffsets[j + 1]], p[pOffsets[j + 2]], p[pOffsets[j + 3]]);
+        __m128 Tan = _mm_mul_ps(_mm_sub_ps(Heights, h04), _mm_loadu_ps(pInvDist + j));
+        MaxTan4 = _mm_max_ps(MaxTan4, Tan);
+
+        __m128 m = _mm_max_ps(MaxTan4, _mm_shuffle_ps(MaxTan4, MaxTan4, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+        MaxTan = _mm_cvtss_f32(m);
+    }
+#elif defined(OGLDEV_MATH_NEON)
+    float32x4_t h04 = vdupq_n_f32(h0);
+    float32x4_t MaxTan4 = vdupq_n_f32(0.0f);
+
+    for ( ; j + 4 <= NumSteps ; j += 4) {
+        if (HeadRoom * pInvDist[j] <= MaxTan) {
+            break;
+        }
+
+        const float Samples[4] = { p[pOffsets[j]], p[pOffsets[j + 1]], p[pOffsets[j + 2]], p[pOffsets[j + 3]] };
+        float32x4_t Tan = vmulq_f32(vsubq_f32(vld1q_f32(Samples), h04), vld1q_f32(pInvDist + j));
+        MaxTan4 = vmaxq_f32(MaxTan4, Tan);
+
+        float32x2_t m = vpmax_f32(vget_low_f32(MaxTan4), vget_high_f32(MaxTan4));
+        MaxTan = vget_lane_f32(vpmax_f32(m, m), 0);
+    }
+#endif
+
+    for ( ; j < NumSteps ; j++) {
+        if (HeadRoom * pInvDist[j] <= MaxTan) {
+            break;
+        }
+
+        MaxTan = std::max(MaxTan, (p[pOffsets[j]] - h0) * pInvDist[j]);
+    }
+
+    return MaxTan;
+}
+
+
+void HorizonMap::BakeInternal(int MaxDistance)
+{
+    int Size = m_terrainSize;
+    const float* pHeights = m_pHeightmap->GetBaseAddr();
+
+    m_horizons.assign((size_t)Size * Size * HORIZON_NUM_DIRECTIONS, 0);
+
+    std::vector<int> Steps;
+
+    for (int k = 1 ; k <= MaxDistance ; k += 1 + k / HORIZON_STRIDE_GROWTH) {
+        Steps.push_back(k);
+    }
+
+    MarchDirection Dirs[HORIZON_NUM_DIRECTIONS];
+
+    for (int d = 0 ; d < HORIZON_NUM_DIRECTIONS ; d++) {
+        float StepLength = sqrtf((float)(DirX[d] * DirX[d] + DirZ[d] * DirZ[d])) * m_worldScale;
+
+        for (int k : Steps) {
+            Dirs[d].Offsets.push_back(k * (DirZ[d] * Size + DirX[d]));
+            Dirs[d].InvDist.push_back(1.0f / ((float)k * StepLength));
+        }
+    }
+
+    float MaxHeight = pHeights[0];
+
+    for (int i = 1 ; i < Size * Size ; i++) {
+        MaxHeight = std::max(MaxHeight, pHeights[i]);
+    }
+
+    ParallelFor(0, Size, [&](int FirstRow, int LastRow) {
+        for (int z = FirstRow ; z < LastRow ; z++) {
+            for (int x = 0 ; x < Size ; x++) {
+                const float* p = pHeights + (size_t)z * Size + x;
+                u8* pOut = m_horizons.data() + ((size_t)z * Size + x) * HORIZON_NUM_DIRECTIONS;
+
+                for (int d = 0 ; d < HORIZON_NUM_DIRECTIONS ; d++) {
+                    // Distance to the edge of the heightmap in this direction
+                    int LimitX = (DirX[d] > 0) ? Size - 1 - x : ((DirX[d] < 0) ? x : INT_MAX);
+                    int LimitZ = (DirZ[d] > 0) ? Size - 1 - z : ((DirZ[d] < 0) ? z : INT_MAX);
+                    int Limit = std::min(LimitX, LimitZ);
+                    int NumSteps = (int)(std::upper_bound(Steps.begin(), Steps.end(), Limit) - Steps.begin());
+
+                    float MaxTan = MarchHorizon(p, MaxHeight - p[0], Dirs[d], NumSteps);
+                    pOut[d] = FloatToAngle(atanf(MaxTan));
+                }
+            }
+        }
+    }, HORIZON_MIN_ROWS_PER_THREAD);
+}
+
+
+bool HorizonMap::SaveToFile(const char* pFilename) const
+{
+    FILE* f = fopen(pFilename, "wb");
+
+    if (!f) {
+        printf("%s:%d - cannot open '%s' for writing\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    HorizonMapFileHeader Header;
+    Header.Magic = HORIZON_MAP_FILE_MAGIC;
+    Header.TerrainSize = m_terrainSize;
+    Header.NumDirections = HORIZON_NUM_DIRECTIONS;
+
+    bool ok = (fwrite(&Header, sizeof(Header), 1, f) == 1) &&
+              (fwrite(m_horizons.data(), 1, m_horizons.size(), f) == m_horizons.size());
+
+    fclose(f);
+
+    if (!ok) {
+        printf("%s:%d - error writing '%s'\n", __FILE__, __LINE__, pFilename);
+    }
+
+    return ok;
+}
+
+
+bool HorizonMap::LoadFromFile(const char* pFilename, float WorldScale)
+{
+    WaitForBake();
+
+    MappedFile File;
+
+    if (!File.Open(pFilename) || (File.GetSize() < sizeof(HorizonMapFileHeader))) {
+        return false;
+    }
+
+    HorizonMapFileHeader Header;
+    memcpy(&Header, File.GetData(), sizeof(Header));
+
+    size_t DataSize = (size_t)Header.TerrainSize * Header.TerrainSize * HORIZON_NUM_DIRECTIONS;
+
+    if ((Header.Magic != HORIZON_MAP_FILE_MAGIC) ||
+        (Header.NumDirections != HORIZON_NUM_DIRECTIONS) ||
+        (File.GetSize() < sizeof(Header) + DataSize)) {
+        printf("%s:%d - '%s' is not a valid horizon map\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    const u8* pData = (const u8*)File.GetData() + sizeof(Header);
+    m_horizons.assign(pData, pData + DataSize);
+    m_terrainSize = (int)Header.TerrainSize;
+    m_worldScale = WorldScale;
+    m_isReady = true;
+
+    return true;
+}
+
+
+float HorizonMap::GetHorizonAngle(int x, int z, int Dir) const
+{
+    return AngleToFloat(m_horizons[((size_t)z * m_terrainSize + x) * HORIZON_NUM_DIRECTIONS + Dir]);
+}
+
+
+float HorizonMap::GetAmbientOcclusion(int x, int z) const
+{
+    float Occlusion = 0.0f;
+
+    for (int d = 0 ; d < HORIZON_NUM_DIRECTIONS ; d++) {
+        Occlusion += sinf(GetHorizonAngle(x, z, d));
+    }
+
+    return 1.0f - Occlusion / (float)HORIZON_NUM_DIRECTIONS;
+}
+
+
+void HorizonMap::InitLighter(const Vector3f& LightDir, float PenumbraAngle)
+{
+    m_reversedLightDir = LightDir * -1.0f;
+    m_reversedLightDir.Normalize();
+
+    float Azimuth = atan2f(m_reversedLightDir.z, m_reversedLightDir.x);
+
+    if (Azimuth < 0.0f) {
+        Azimuth += 2.0f * (float)M_PI;
+    }
+
+    float f = Azimuth / (2.0f * (float)M_PI / (float)HORIZON_NUM_DIRECTIONS);
+    m_lightDir0 = (int)f % HORIZON_NUM_DIRECTIONS;
+    m_lightDir1 = (m_lightDir0 + 1) % HORIZON_NUM_DIRECTIONS;
+    m_lightFactor = f - floorf(f);
+
+    m_sunElevation = asinf(std::max(-1.0f, std::min(m_reversedLightDir.y, 1.0f)));
+    m_penumbra = ToRadian(PenumbraAngle);
+}
+
+
+float HorizonMap::GetSunVisibility(int x, int z) const
+{
+    float Horizon0 = GetHorizonAngle(x, z, m_lightDir0);
+    float Horizon1 = GetHorizonAngle(x, z, m_lightDir1);
+    float Horizon = Horizon0 + (Horizon1 - Horizon0) * m_lightFactor;
+
+    if (m_penumbra <= 0.0f) {
+        return (m_sunElevation > Horizon) ? 1.0f : 0.0f;
+    }
+
+    float Visibility = (m_sunElevation - Horizon) / m_penumbra + 0.5f;
+
+    return std::max(0.0f, std::min(Visibility, 1.0f));
+}
+
+
+float HorizonMap::GetLighting(int x, int z) const
+{
+    int x0 = std::max(x - 1, 0);
+    int x1 = std::min(x + 1, m_terrainSize - 1);
+    int z0 = std::max(z - 1, 0);
+    int z1 = std::min(z + 1, m_terrainSize - 1);
+
+    // Central differences
+    float SlopeX = (m_pHeightmap->Get(x1, z) - m_pHeightmap->Get(x0, z)) / ((float)(x1 - x0) * m_worldScale);
+    float SlopeZ = (m_pHeightmap->Get(x, z1) - m_pHeightmap->Get(x, z0)) / ((float)(z1 - z0) * m_worldScale);
+    Vector3f Normal(-SlopeX, 1.0f, -SlopeZ);
+    Normal.Normalize();
+
+    float Diffuse = std::max(Normal.Dot(m_reversedLightDir), 0.0f);
+
+    return HORIZON_AMBIENT * GetAmbientOcclusion(x, z) + (1.0f - HORIZON_AMBIENT) * Diffuse * GetSunVisibility(x, z);
+}
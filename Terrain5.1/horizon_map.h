@@ -0,0 +1,99 @@
+/*
+    Copyright 2024 Etay Meiri
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HORIZON_MAP_H
+#define HORIZON_MAP_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "ogldev_types.h"
+#include "ogldev_array_2d.h"
+#include "ogldev_math_3d.h"
+
+// Directions are at 45 degree steps starting from +X towards +Z
+#define HORIZON_NUM_DIRECTIONS 8
+
+//
+// The horizon map stores for every heightmap texel the elevation angle of the
+// horizon in HORIZON_NUM_DIRECTIONS directions (one byte each). Baking it
+// marches the heightmap and is expensive, but once it exists the terrain can be
+// re-lit for any sun direction with two lookups per texel - the texel is in
+// shadow if the sun is below the horizon in its direction.
+//
+class HorizonMap
+{
+public:
+    HorizonMap(const Array2D<float>* pHeightmap) : m_pHeightmap(pHeightmap) {}
+
+    ~HorizonMap();
+
+    // Traces the horizons up to MaxDistance texels on all the cores
+    void Bake(int TerrainSize, float WorldScale, int MaxDistance);
+
+    // Same as Bake on a background thread. The heightmap must not change
+    // until IsReady() returns true (or WaitForBake() returns).
+    void StartBake(int TerrainSize, float WorldScale, int MaxDistance);
+
+    void WaitForBake();
+
+    bool IsReady() const { return m_isReady; }
+
+    bool SaveToFile(const char* pFilename) const;
+
+    bool LoadFromFile(const char* pFilename, float WorldScale);
+
+    // Elevation of the horizon in radians, [0, PI/2]
+    float GetHorizonAngle(int x, int z, int Dir) const;
+
+    // 1 - nothing blocks the sky, 0 - fully occluded
+    float GetAmbientOcclusion(int x, int z) const;
+
+    // PenumbraAngle is in degrees. It softens the shadow edge.
+    void InitLighter(const Vector3f& LightDir, float PenumbraAngle);
+
+    // Fraction of the sun that is above the horizon of the texel
+    float GetSunVisibility(int x, int z) const;
+
+    // Occluded ambient plus shadowed diffuse, [0, 1]
+    float GetLighting(int x, int z) const;
+
+private:
+
+    void BakeInternal(int MaxDistance);
+
+    const Array2D<float>* m_pHeightmap = NULL;
+
+    int m_terrainSize = 0;
+    float m_worldScale = 1.0f;
+
+    std::vector<u8> m_horizons;    // HORIZON_NUM_DIRECTIONS per texel
+
+    std::thread m_bakeThread;
+    std::atomic<bool> m_isReady { false };
+
+    // Set by InitLighter
+    Vector3f m_reversedLightDir = Vector3f(0.0f, 1.0f, 0.0f);
+    int m_lightDir0 = 0;           // the two directions around the light azimuth
+    int m_lightDir1 = 1;
+    float m_lightFactor = 0.0f;    // interpolation factor between them
+    float m_sunElevation = 0.0f;
+    float m_penumbra = 0.0f;
+};
+
+#endif
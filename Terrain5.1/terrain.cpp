@@ -25,11 +25,15 @@
 #include <string.h>
 
 #include "terrain.h"
+#include "ogldev_mapped_file.h"
 #include "texture_config.h"
 #include "3rdparty/stb_image_write.h"
 
 //#define DEBUG_PRINT
 
+// How far the horizon map looks for occluders, in heightmap texels
+#define HORIZON_MAX_DISTANCE 256
+
 BaseTerrain::~BaseTerrain()
 {
     Destroy();
@@ -38,6 +42,11 @@ BaseTerrain::~BaseTerrain()
 
 void BaseTerrain::Destroy()
 {
+    // The bake reads the heights
+    m_horizonMap.WaitForBake();
+    m_isHorizonBakePending = false;
+    m_isHorizonMapValid = false;
+
     m_heightMap.Destroy();
     m_triangleList.Destroy();
 }
@@ -104,24 +113,32 @@ void BaseTerrain::LoadFromFile(const char* pFilename)
 
 void BaseTerrain::LoadHeightMapFile(const char* pFilename)
 {
-    int FileSize = 0;
-    unsigned char* p = (unsigned char*)ReadBinaryFile(pFilename, FileSize);
+    MappedFile File;
+
+    if (!File.Open(pFilename)) {
+        OGLDEV_FILE_ERROR(pFilename);
+        exit(0);
+    }
+
+    u64 FileSize = File.GetSize();
 
     if (FileSize % sizeof(float) != 0) {
-        printf("%s:%d - '%s' does not contain an whole number of floats (size %d)\n", __FILE__, __LINE__, pFilename, FileSize);
+        printf("%s:%d - '%s' does not contain an whole number of floats (size %llu)\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_terrainSize = (int)sqrtf((float)FileSize / (float)sizeof(float));
+    m_terrainSize = (int)sqrt((double)FileSize / (double)sizeof(float));
 
     printf("Terrain size %d\n", m_terrainSize);
 
-    if ((m_terrainSize * m_terrainSize) != (FileSize / sizeof(float))) {
-        printf("%s:%d - '%s' does not contain a square height map - size %d\n", __FILE__, __LINE__, pFilename, FileSize);
+    if ((u64)m_terrainSize * m_terrainSize != (FileSize / sizeof(float))) {
+        printf("%s:%d - '%s' does not contain a square height map - size %llu\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize, (float*)p);
+    // The height map is modified later so it gets its own copy of the mapped pages
+    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize);
+    memcpy(m_heightMap.GetBaseAddr(), File.GetData(), FileSize);
 }
 
 
@@ -146,6 +163,12 @@ void BaseTerrain::SaveToFile(const char* pFilename)
 
 void BaseTerrain::Render(const BasicCamera& Camera)
 {
+    if (m_isHorizonBakePending && m_horizonMap.IsReady()) {
+        m_isHorizonBakePending = false;
+        m_isHorizonMapValid = true;
+        UpdateLighting();
+    }
+
     Matrix4f VP = Camera.GetViewProjMatrix();
 
     m_terrainTech.Enable();
@@ -182,6 +205,16 @@ float BaseTerrain::GetSlopeLighting(int x, int z) const
 }
 
 
+float BaseTerrain::GetLighting(int x, int z) const
+{
+    if (m_useHorizonMap) {
+        return m_horizonMap.GetLighting(x, z);
+    }
+
+    return m_slopeLighter.GetLighting(x, z);
+}
+
+
 void BaseTerrain::SetLight(const Vector3f& LightDir, float Softness)
 {
     m_lightDir = LightDir;
@@ -189,10 +222,55 @@ void BaseTerrain::SetLight(const Vector3f& LightDir, float Softness)
 }
 
 
-void BaseTerrain::FinalizeTerrain()
+void BaseTerrain::SetHorizonShadows(bool Enable)
 {
-    m_slopeLighter.InitLighter(m_lightDir, m_terrainSize, m_lightSoftness);
+    m_horizonShadows = Enable;
+
+    // No terrain yet - FinalizeTerrain will take care of it
+    if (!m_heightMap.GetBaseAddr()) {
+        return;
+    }
+
+    if (Enable && !m_isHorizonMapValid && !m_isHorizonBakePending) {
+        StartHorizonBake();
+    }
+
+    UpdateLighting();
+}
+
+
+void BaseTerrain::StartHorizonBake()
+{
+    m_horizonMap.StartBake(m_terrainSize, m_worldScale, HORIZON_MAX_DISTANCE);
+    m_isHorizonBakePending = true;
+}
+
+
+void BaseTerrain::UpdateLighting()
+{
+    m_useHorizonMap = m_horizonShadows && m_isHorizonMapValid;
+
+    if (m_useHorizonMap) {
+        m_horizonMap.InitLighter(m_lightDir, m_lightSoftness);
+    } else {
+        m_slopeLighter.InitLighter(m_lightDir, m_terrainSize, m_lightSoftness);
+    }
+
+    m_triangleList.Destroy();
     m_triangleList.CreateTriangleList(m_terrainSize, m_terrainSize, this);
 }
 
 
+void BaseTerrain::FinalizeTerrain()
+{
+    m_isHorizonMapValid = false;
+
+    // Until the bake is done the terrain uses the slope lighter
+    if (m_horizonShadows) {
+        StartHorizonBake();
+    }
+
+    UpdateLighting();
+}
+
+
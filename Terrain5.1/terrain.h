@@ -26,11 +26,12 @@
 #include "triangle_list.h"
 #include "terrain_technique.h"
 #include "slope_lighter.h"
+#include "horizon_map.h"
 
 class BaseTerrain
 {
  public:
-    BaseTerrain() : m_slopeLighter(&m_heightMap) {}
+    BaseTerrain() : m_slopeLighter(&m_heightMap), m_horizonMap(&m_heightMap) {}
 
     ~BaseTerrain();
 
@@ -60,8 +61,18 @@ class BaseTerrain
 	
     float GetSlopeLighting(int x, int z) const;
 
+    // Horizon map lighting when it is enabled and baked, slope lighting otherwise
+    float GetLighting(int x, int z) const;
+
     void SetLight(const Vector3f& LightDir, float Softness);
 
+    // The horizon map is baked in the background and the terrain switches
+    // to it when it is ready. Softness is then the penumbra angle in degrees.
+    void SetHorizonShadows(bool Enable);
+
+    // Re-lights the vertices for the current light without touching the heights
+    void UpdateLighting();
+
  protected:
 
 	void LoadHeightMapFile(const char* pFilename);
@@ -70,6 +81,8 @@ class BaseTerrain
 
     void FinalizeTerrain();
 
+    void StartHorizonBake();
+
     int m_terrainSize = 0;
 	float m_worldScale = 1.0f;
     Array2D<float> m_heightMap;    
@@ -83,6 +96,11 @@ private:
     TerrainTechnique m_terrainTech;
     TriangleList m_triangleList;
     SlopeLighter m_slopeLighter; 
+    HorizonMap m_horizonMap;
+    bool m_horizonShadows = false;
+    bool m_isHorizonBakePending = false;
+    bool m_isHorizonMapValid = false;   // baked from the current heights
+    bool m_useHorizonMap = false;
     Vector3f m_lightDir;
     float m_lightSoftness = 0.0f;
 };
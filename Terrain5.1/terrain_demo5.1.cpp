@@ -93,6 +93,10 @@ public:
                 ImGui::SliderFloat("Terrain roughness", &this->m_roughness, 0.0f, 5.0f);
                 ImGui::SliderFloat("Light Softness", &this->m_lightSoftness, 0.0f, 50.0f);
 
+                if (ImGui::Checkbox("Horizon shadows", &this->m_horizonShadows)) {
+                    m_terrain.SetHorizonShadows(m_horizonShadows);
+                }
+
                 static float Height0 = 64.0f;
                 static float Height1 = 128.0f;
                 static float Height2 = 192.0f;
@@ -197,13 +201,12 @@ public:
                 break;
 
             case GLFW_KEY_L:
-                m_terrain.Destroy();
-                srand(g_seed);
+                // The heights don't change so only the lighting is updated
                 m_counter += 0.1f;
                 m_lightDir.x = sinf(m_counter);
                 m_lightDir.z = cosf(m_counter);
                 m_terrain.SetLight(m_lightDir, m_lightSoftness);
-                m_terrain.CreateMidpointDisplacement(m_terrainSize, m_roughness, m_minHeight, m_maxHeight);
+                m_terrain.UpdateLighting();
                 break;
             }
         }
@@ -264,6 +267,7 @@ private:
         TextureFilenames.push_back("../Content/textures/water.png");        
 
         m_terrain.InitTerrain(WorldScale, TextureScale, TextureFilenames, m_lightDir, m_lightSoftness);
+        m_terrain.SetHorizonShadows(m_horizonShadows);
         m_terrain.CreateMidpointDisplacement(m_terrainSize, m_roughness, m_minHeight, m_maxHeight);
     }
 
@@ -294,6 +298,7 @@ private:
     int m_terrainSize = 512;
     float m_roughness = 1.0f;
     float m_lightSoftness = 4.0f;
+    bool m_horizonShadows = true;
     float m_minHeight = 0.0f;
     float m_maxHeight = 256.0f;
     Vector3f m_lightDir = Vector3f(1.0f, -0.5f, 1.0f);
@@ -116,7 +116,7 @@ void TriangleList::PopulateBuffers(const BaseTerrain* pTerrain)
 
     glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
+    InitStrips(Indices);
 }
 
 
@@ -208,11 +208,42 @@ void TriangleList::CalcNormals(std::vector<Vertex>& Vertices, std::vector<uint>&
 }
 
 
+// The triangle list is kept only for the normals. The index buffer gets
+// strips with primitive restart, in bands of rows whose indices fit in
+// 16 bits.
+void TriangleList::InitStrips(const std::vector<uint>& Triangles)
+{
+    std::vector<uint> Strips;
+    BuildGridStrips(m_width, m_depth, OGLDEV_VERTEX_CACHE_SIZE, Strips, m_ranges);
+
+    std::vector<uchar> Buffer;
+    m_indexSize = PackIndices(Strips, m_ranges, Buffer);
+    m_indexType = (m_indexSize == sizeof(ushort)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    float ListACMR = CalcACMR(INDEX_TOPOLOGY_TRIANGLES, &Triangles[0], (int)Triangles.size(), OGLDEV_VERTEX_CACHE_SIZE);
+    float StripsACMR = CalcACMR(INDEX_TOPOLOGY_TRIANGLE_STRIP, &Strips[0], (int)Strips.size(), OGLDEV_VERTEX_CACHE_SIZE);
+
+    printf("Triangle list: %zu indices (%zu bytes), ACMR %.3f\n", Triangles.size(), Triangles.size() * sizeof(uint), ListACMR);
+    printf("Triangle strips: %zu indices (%zu bytes) in %zu draws, ACMR %.3f\n", Strips.size(), Buffer.size(), m_ranges.size(), StripsACMR);
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Buffer.size(), &Buffer[0], GL_STATIC_DRAW);
+}
+
+
 void TriangleList::Render()
 {
     glBindVertexArray(m_vao);
 
-    glDrawElements(GL_TRIANGLES, (m_depth - 1) * (m_width - 1) * 6, GL_UNSIGNED_INT, NULL);
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(GetRestartIndex(m_indexSize));
+
+    for (int i = 0 ; i < (int)m_ranges.size() ; i++) {
+        const IndexRange& Range = m_ranges[i];
+        glDrawElementsBaseVertex(GL_TRIANGLE_STRIP, Range.Count, m_indexType,
+                                 (void*)((size_t)Range.Start * m_indexSize), Range.BaseVertex);
+    }
+
+    glDisable(GL_PRIMITIVE_RESTART);
 
     glBindVertexArray(0);
 }
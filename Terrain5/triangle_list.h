@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "ogldev_math_3d.h"
+#include "ogldev_index_encoder.h"
 
 // this header is included by terrain.h so we have a forward 
 // declaration for BaseTerrain.
@@ -56,6 +57,7 @@ class TriangleList {
 	void PopulateBuffers(const BaseTerrain* pTerrain);
     void InitVertices(const BaseTerrain* pTerrain, std::vector<Vertex>& Vertices);
     void InitIndices(std::vector<uint>& Indices);
+    void InitStrips(const std::vector<uint>& Triangles);
     void CalcNormals(std::vector<Vertex>& Vertices, std::vector<uint>& Indices);
 
     int m_width = 0;
@@ -63,6 +65,12 @@ class TriangleList {
     GLuint m_vao = 0;
     GLuint m_vb = 0;
     GLuint m_ib = 0;
+
+    // The strips are drawn in bands of rows with the first vertex of the
+    // band as the base vertex
+    std::vector<IndexRange> m_ranges;
+    GLenum m_indexType = GL_UNSIGNED_INT;
+    int m_indexSize = sizeof(uint);
 };
 
 #endif
@@ -141,7 +141,38 @@ void GeomipGrid::PopulateBuffers(const BaseTerrain* pTerrain)
 
     glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
+    EncodeIndices(Indices);
+}
+
+
+// Every 2x2 quads of the patch are a fan of eight triangles around the
+// center vertex. They go into the index buffer as fans separated by the
+// restart index, reordered for the post transform cache. The indices are
+// relative to the base vertex of the patch so they fit in 16 bits unless
+// the terrain is very wide.
+void GeomipGrid::EncodeIndices(const std::vector<uint>& Triangles)
+{
+    std::vector<uint> Fans;
+    BuildTriangleFans(&Triangles[0], (int)Triangles.size(), Fans);
+    OptimizeVertexCache(INDEX_TOPOLOGY_TRIANGLE_FAN, Fans, OGLDEV_VERTEX_CACHE_SIZE);
+
+    float TrianglesACMR = CalcACMR(INDEX_TOPOLOGY_TRIANGLES, &Triangles[0], (int)Triangles.size(), OGLDEV_VERTEX_CACHE_SIZE);
+    float FansACMR = CalcACMR(INDEX_TOPOLOGY_TRIANGLE_FAN, &Fans[0], (int)Fans.size(), OGLDEV_VERTEX_CACHE_SIZE);
+
+    printf("ACMR %.3f as triangles, %.3f as fans\n", TrianglesACMR, FansACMR);
+
+    std::vector<IndexRange> Ranges(1);
+    Ranges[0].Count = (int)Fans.size();
+
+    std::vector<uchar> Buffer;
+    m_indexSize = PackIndices(Fans, Ranges, Buffer);
+    m_indexType = (m_indexSize == sizeof(ushort)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    m_numIndices = (int)Fans.size();
+
+    printf("Index buffer: %zu bytes as fans, %zu bytes as triangles\n",
+           Buffer.size(), Triangles.size() * sizeof(uint));
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Buffer.size(), &Buffer[0], GL_STATIC_DRAW);
 }
 
 
@@ -278,12 +309,17 @@ void GeomipGrid::Render()
 {
     glBindVertexArray(m_vao);
 
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(GetRestartIndex(m_indexSize));
+
     for (int z = 0 ; z < m_depth - 1 ; z += (m_patchSize - 1)) {
         for (int x = 0 ; x < m_width - 1 ; x += (m_patchSize - 1)) {
             int BaseVertex = z * m_width + x;
-            glDrawElementsBaseVertex(GL_TRIANGLES, (m_patchSize - 1) * (m_patchSize - 1) * 6, GL_UNSIGNED_INT, NULL, BaseVertex);
+            glDrawElementsBaseVertex(GL_TRIANGLE_FAN, m_numIndices, m_indexType, NULL, BaseVertex);
         }
     }
 
+    glDisable(GL_PRIMITIVE_RESTART);
+
     glBindVertexArray(0);
 }
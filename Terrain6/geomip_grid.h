@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "ogldev_math_3d.h"
+#include "ogldev_index_encoder.h"
 
 // this header is included by terrain.h so we have a forward 
 // declaration for BaseTerrain.
@@ -57,6 +58,7 @@ class GeomipGrid {
     void InitVertices(const BaseTerrain* pTerrain, std::vector<Vertex>& Vertices);
     void InitIndices(std::vector<uint>& Indices);
     void CalcNormals(std::vector<Vertex>& Vertices, std::vector<uint>& Indices);
+    void EncodeIndices(const std::vector<uint>& Triangles);
 
     uint AddTriangle(uint Index, std::vector<uint>& Indices, uint v1, uint v2, uint v3);
 
@@ -66,6 +68,9 @@ class GeomipGrid {
     GLuint m_vao = 0;
     GLuint m_vb = 0;
     GLuint m_ib = 0;
+    GLenum m_indexType = GL_UNSIGNED_INT;
+    int m_indexSize = sizeof(uint);
+    int m_numIndices = 0;
 };
 
 #endif
@@ -25,6 +25,7 @@
 
 #include "ogldev_math_3d.h"
 #include "lod_manager.h"
+#include "ogldev_index_encoder.h"
 
 // this header is included by terrain.h so we have a forward 
 // declaration for BaseTerrain.
@@ -72,6 +73,8 @@ class GeomipGrid {
 
     int CalcNumIndices();
 
+    void EncodeIndices(const std::vector<uint>& Triangles);
+
     int m_width = 0;
     int m_depth = 0;
     int m_patchSize = 0;
@@ -79,7 +82,10 @@ class GeomipGrid {
     GLuint m_vao = 0;
     GLuint m_vb = 0;
     GLuint m_ib = 0;
+    GLenum m_indexType = GL_UNSIGNED_INT;
+    int m_indexSize = sizeof(uint);
 
+    // After EncodeIndices the range of the fans in the index buffer
     struct SingleLodInfo {
         int Start = 0;
         int Count = 0;
@@ -153,7 +153,7 @@ void GeomipGrid::PopulateBuffers(const BaseTerrain* pTerrain)
 
     glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * NumIndices, &Indices[0], GL_STATIC_DRAW);
+    EncodeIndices(Indices);
 }
 
 
@@ -173,6 +173,64 @@ int GeomipGrid::CalcNumIndices()
 }
 
 
+// The triangles of every LOD permutation are the fans of CreateTriangleFan
+// one after the other. They go into the index buffer as fans separated by
+// the restart index, reordered for the post transform cache. The indices
+// are relative to the base vertex of the patch so they fit in 16 bits
+// unless the terrain is very wide.
+void GeomipGrid::EncodeIndices(const std::vector<uint>& Triangles)
+{
+    std::vector<uint> Fans;
+    std::vector<uint> LodFans;
+    int NumTriangleIndices = 0;
+
+    for (int lod = 0 ; lod <= m_maxLOD ; lod++) {
+        float MissesBefore = 0.0f;
+        float MissesAfter = 0.0f;
+        int NumTriangles = 0;
+
+        for (int l = 0 ; l < LEFT ; l++) {
+            for (int r = 0 ; r < RIGHT ; r++) {
+                for (int t = 0 ; t < TOP ; t++) {
+                    for (int b = 0 ; b < BOTTOM ; b++) {
+                        SingleLodInfo& Info = m_lodInfo[lod].info[l][r][t][b];
+                        const uint* pTriangles = &Triangles[Info.Start];
+                        int NumPermTriangles = Info.Count / 3;
+
+                        MissesBefore += CalcACMR(INDEX_TOPOLOGY_TRIANGLES, pTriangles, Info.Count, OGLDEV_VERTEX_CACHE_SIZE) * NumPermTriangles;
+
+                        BuildTriangleFans(pTriangles, Info.Count, LodFans);
+                        OptimizeVertexCache(INDEX_TOPOLOGY_TRIANGLE_FAN, LodFans, OGLDEV_VERTEX_CACHE_SIZE);
+
+                        MissesAfter += CalcACMR(INDEX_TOPOLOGY_TRIANGLE_FAN, &LodFans[0], (int)LodFans.size(), OGLDEV_VERTEX_CACHE_SIZE) * NumPermTriangles;
+                        NumTriangles += NumPermTriangles;
+                        NumTriangleIndices += Info.Count;
+
+                        Info.Start = (int)Fans.size();
+                        Info.Count = (int)LodFans.size();
+                        Fans.insert(Fans.end(), LodFans.begin(), LodFans.end());
+                    }
+                }
+            }
+        }
+
+        printf("LOD %d: ACMR %.3f as triangles, %.3f as fans\n", lod, MissesBefore / NumTriangles, MissesAfter / NumTriangles);
+    }
+
+    std::vector<IndexRange> Ranges(1);
+    Ranges[0].Count = (int)Fans.size();
+
+    std::vector<uchar> Buffer;
+    m_indexSize = PackIndices(Fans, Ranges, Buffer);
+    m_indexType = (m_indexSize == sizeof(ushort)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    printf("Index buffer: %zu bytes as fans, %zu bytes as triangles\n",
+           Buffer.size(), NumTriangleIndices * sizeof(uint));
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Buffer.size(), &Buffer[0], GL_STATIC_DRAW);
+}
+
+
 void GeomipGrid::Vertex::InitVertex(const BaseTerrain* pTerrain, int x, int z)
 {
     float y = pTerrain->GetHeight(x, z);
@@ -383,8 +441,11 @@ void GeomipGrid::Render(const Vector3f& CameraPos, const Matrix4f& ViewProj)
 
     glBindVertexArray(m_vao);
 
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(GetRestartIndex(m_indexSize));
+
     if (gShowPoints > 0) {
-        glDrawElementsBaseVertex(GL_POINTS, m_lodInfo[0].info[0][0][0][0].Count, GL_UNSIGNED_INT, (void*)0, 0);
+        glDrawElementsBaseVertex(GL_POINTS, m_lodInfo[0].info[0][0][0][0].Count, m_indexType, (void*)0, 0);
     }
 
     if (gShowPoints != 2) {
@@ -412,18 +473,20 @@ void GeomipGrid::Render(const Vector3f& CameraPos, const Matrix4f& ViewProj)
                 int T = plod.Top;
                 int B = plod.Bottom;
 
-                size_t BaseIndex = sizeof(unsigned int) * m_lodInfo[C].info[L][R][T][B].Start;
+                size_t BaseIndex = m_indexSize * m_lodInfo[C].info[L][R][T][B].Start;
 
                 int BaseVertex = z * m_width + x;
 
-                glDrawElementsBaseVertex(GL_TRIANGLES, m_lodInfo[C].info[L][R][T][B].Count, 
-                                         GL_UNSIGNED_INT, (void*)BaseIndex, BaseVertex);
+                glDrawElementsBaseVertex(GL_TRIANGLE_FAN, m_lodInfo[C].info[L][R][T][B].Count, 
+                                         m_indexType, (void*)BaseIndex, BaseVertex);
             }
 
             printf("\n");
         }
     }
 
+    glDisable(GL_PRIMITIVE_RESTART);
+
     glBindVertexArray(0);
 }
 
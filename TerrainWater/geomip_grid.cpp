@@ -153,7 +153,7 @@ void GeomipGrid::PopulateBuffers(const BaseTerrain* pTerrain)
 
     glBufferData(GL_ARRAY_BUFFER, sizeof(Vertices[0]) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * NumIndices, &Indices[0], GL_STATIC_DRAW);
+    EncodeIndices(Indices);
 }
 
 
@@ -173,6 +173,64 @@ int GeomipGrid::CalcNumIndices()
 }
 
 
+// The triangles of every LOD permutation are the fans of CreateTriangleFan
+// one after the other. They go into the index buffer as fans separated by
+// the restart index, reordered for the post transform cache. The indices
+// are relative to the base vertex of the patch so they fit in 16 bits
+// unless the terrain is very wide.
+void GeomipGrid::EncodeIndices(const std::vector<uint>& Triangles)
+{
+    std::vector<uint> Fans;
+    std::vector<uint> LodFans;
+    int NumTriangleIndices = 0;
+
+    for (int lod = 0 ; lod <= m_maxLOD ; lod++) {
+        float MissesBefore = 0.0f;
+        float MissesAfter = 0.0f;
+        int NumTriangles = 0;
+
+        for (int l = 0 ; l < LEFT ; l++) {
+            for (int r = 0 ; r < RIGHT ; r++) {
+                for (int t = 0 ; t < TOP ; t++) {
+                    for (int b = 0 ; b < BOTTOM ; b++) {
+                        SingleLodInfo& Info = m_lodInfo[lod].info[l][r][t][b];
+                        const uint* pTriangles = &Triangles[Info.Start];
+                        int NumPermTriangles = Info.Count / 3;
+
+                        MissesBefore += CalcACMR(INDEX_TOPOLOGY_TRIANGLES, pTriangles, Info.Count, OGLDEV_VERTEX_CACHE_SIZE) * NumPermTriangles;
+
+                        BuildTriangleFans(pTriangles, Info.Count, LodFans);
+                        OptimizeVertexCache(INDEX_TOPOLOGY_TRIANGLE_FAN, LodFans, OGLDEV_VERTEX_CACHE_SIZE);
+
+                        MissesAfter += CalcACMR(INDEX_TOPOLOGY_TRIANGLE_FAN, &LodFans[0], (int)LodFans.size(), OGLDEV_VERTEX_CACHE_SIZE) * NumPermTriangles;
+                        NumTriangles += NumPermTriangles;
+                        NumTriangleIndices += Info.Count;
+
+                        Info.Start = (int)Fans.size();
+                        Info.Count = (int)LodFans.size();
+                        Fans.insert(Fans.end(), LodFans.begin(), LodFans.end());
+                    }
+                }
+            }
+        }
+
+        printf("LOD %d: ACMR %.3f as triangles, %.3f as fans\n", lod, MissesBefore / NumTriangles, MissesAfter / NumTriangles);
+    }
+
+    std::vector<IndexRange> Ranges(1);
+    Ranges[0].Count = (int)Fans.size();
+
+    std::vector<uchar> Buffer;
+    m_indexSize = PackIndices(Fans, Ranges, Buffer);
+    m_indexType = (m_indexSize == sizeof(ushort)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    printf("Index buffer: %zu bytes as fans, %zu bytes as triangles\n",
+           Buffer.size(), NumTriangleIndices * sizeof(uint));
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Buffer.size(), &Buffer[0], GL_STATIC_DRAW);
+}
+
+
 void GeomipGrid::Vertex::InitVertex(const BaseTerrain* pTerrain, int x, int z)
 {
     float y = pTerrain->GetHeight(x, z);
@@ -377,54 +435,78 @@ void GeomipGrid::CalcNormals(std::vector<Vertex>& Vertices, std::vector<uint>& I
 
 void GeomipGrid::Render(const Vector3f& CameraPos, const Matrix4f& ViewProj)
 {
-    m_lodManager.Update(CameraPos);
+    UpdateLOD(CameraPos);
+    CullPatches(ViewProj, m_drawList);
+    Submit(m_drawList);
+}
 
-    FrustumCulling fc(ViewProj);
 
-    glBindVertexArray(m_vao);
+void GeomipGrid::UpdateLOD(const Vector3f& CameraPos, int LodBias)
+{
+    m_lodManager.Update(CameraPos, LodBias);
+}
 
-    if (gShowPoints > 0) {
-        glDrawElementsBaseVertex(GL_POINTS, m_lodInfo[0].info[0][0][0][0].Count, GL_UNSIGNED_INT, (void*)0, 0);
-    }
 
-    if (gShowPoints != 2) {
-        float PatchSize = ((float)m_patchSize - 1.0f) * m_worldScale;  // m_patchSize is in vertices and PatchSize is the actual size (2 vertices --> size 1)
-        float HalfPatchSize =  PatchSize / 2.0f;
+void GeomipGrid::CullPatches(const Matrix4f& ViewProj, GeomipDrawList& DrawList) const
+{
+    DrawList.Clear();
+
+    FrustumCulling fc(ViewProj);
 
-        for (int PatchZ = 0 ; PatchZ < m_numPatchesZ ; PatchZ++) {
-            for (int PatchX = 0 ; PatchX < m_numPatchesX ; PatchX++) {
+    for (int PatchZ = 0 ; PatchZ < m_numPatchesZ ; PatchZ++) {
+        for (int PatchX = 0 ; PatchX < m_numPatchesX ; PatchX++) {
 
-                int x = PatchX * (m_patchSize - 1);
-                int z = PatchZ * (m_patchSize - 1);
+            int x = PatchX * (m_patchSize - 1);
+            int z = PatchZ * (m_patchSize - 1);
             
-                if (!IsPatchInsideViewFrustum_WorldSpace(x, z, fc)) {
-                    continue;
-                }
-
-                const LodManager::PatchLod& plod = m_lodManager.GetPatchLod(PatchX, PatchZ);
-                int C = plod.Core;
-                int L = plod.Left;
-                int R = plod.Right;
-                int T = plod.Top;
-                int B = plod.Bottom;
+            if (!IsPatchInsideViewFrustum_WorldSpace(x, z, fc)) {
+                continue;
+            }
 
-                size_t BaseIndex = sizeof(unsigned int) * m_lodInfo[C].info[L][R][T][B].Start;
+            const LodManager::PatchLod& plod = m_lodManager.GetPatchLod(PatchX, PatchZ);
+            int C = plod.Core;
+            int L = plod.Left;
+            int R = plod.Right;
+            int T = plod.Top;
+            int B = plod.Bottom;
 
-                int BaseVertex = z * m_width + x;
+            size_t BaseIndex = m_indexSize * m_lodInfo[C].info[L][R][T][B].Start;
 
-                glDrawElementsBaseVertex(GL_TRIANGLES, m_lodInfo[C].info[L][R][T][B].Count, 
-                                         GL_UNSIGNED_INT, (void*)BaseIndex, BaseVertex);
-            }
+            int BaseVertex = z * m_width + x;
 
-            //printf("\n");
+            DrawList.Counts.push_back(m_lodInfo[C].info[L][R][T][B].Count);
+            DrawList.IndexOffsets.push_back((const void*)BaseIndex);
+            DrawList.BaseVertices.push_back(BaseVertex);
         }
     }
+}
+
+
+void GeomipGrid::Submit(const GeomipDrawList& DrawList) const
+{
+    glBindVertexArray(m_vao);
+
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(GetRestartIndex(m_indexSize));
+
+    if (gShowPoints > 0) {
+        glDrawElementsBaseVertex(GL_POINTS, m_lodInfo[0].info[0][0][0][0].Count, m_indexType, (void*)0, 0);
+    }
+
+    if ((gShowPoints != 2) && !DrawList.Counts.empty()) {
+        // All the visible patches in a single call
+        glMultiDrawElementsBaseVertex(GL_TRIANGLE_FAN, (GLsizei*)DrawList.Counts.data(), m_indexType,
+                                      (void**)DrawList.IndexOffsets.data(),
+                                      (GLsizei)DrawList.Counts.size(), (GLint*)DrawList.BaseVertices.data());
+    }
+
+    glDisable(GL_PRIMITIVE_RESTART);
 
     glBindVertexArray(0);
 }
 
 
-bool GeomipGrid::IsPatchInsideViewFrustum_ViewSpace(int X, int Z, const Matrix4f& ViewProj)
+bool GeomipGrid::IsPatchInsideViewFrustum_ViewSpace(int X, int Z, const Matrix4f& ViewProj) const
 {
     int x0 = X;
     int x1 = X + m_patchSize - 1;
@@ -446,7 +528,7 @@ bool GeomipGrid::IsPatchInsideViewFrustum_ViewSpace(int X, int Z, const Matrix4f
 }
 
 
-bool GeomipGrid::IsPatchInsideViewFrustum_WorldSpace(int X, int Z, const FrustumCulling& fc)
+bool GeomipGrid::IsPatchInsideViewFrustum_WorldSpace(int X, int Z, const FrustumCulling& fc) const
 {
     int x0 = X;
     int x1 = X + m_patchSize - 1;
@@ -25,11 +25,27 @@
 
 #include "ogldev_math_3d.h"
 #include "lod_manager.h"
+#include "ogldev_index_encoder.h"
 
 // this header is included by terrain.h so we have a forward 
 // declaration for BaseTerrain.
 class BaseTerrain;
 
+// The visible patches of one camera with their LOD, ready to be drawn
+struct GeomipDrawList {
+    std::vector<GLsizei> Counts;
+    std::vector<const void*> IndexOffsets;
+    std::vector<GLint> BaseVertices;
+
+    void Clear()
+    {
+        Counts.clear();
+        IndexOffsets.clear();
+        BaseVertices.clear();
+    }
+};
+
+
 class GeomipGrid {
  public:
     GeomipGrid();
@@ -40,8 +56,18 @@ class GeomipGrid {
 
     void Destroy();
 
+    // UpdateLOD + CullPatches + Submit. Use the stages directly when
+    // several passes see the terrain in the same frame.
     void Render(const Vector3f& CameraPos, const Matrix4f& ViewProj);
 
+    // Recalculates the LOD of every patch - once per frame
+    void UpdateLOD(const Vector3f& CameraPos, int LodBias = 0);
+
+    // Builds the list of patches inside the frustum using the current LODs
+    void CullPatches(const Matrix4f& ViewProj, GeomipDrawList& DrawList) const;
+
+    void Submit(const GeomipDrawList& DrawList) const;
+
  private:
 
     struct Vertex {
@@ -72,9 +98,11 @@ class GeomipGrid {
 
     int CalcNumIndices();
 
-    bool IsPatchInsideViewFrustum_ViewSpace(int X, int Z, const Matrix4f& ViewProj);
+    void EncodeIndices(const std::vector<uint>& Triangles);
+
+    bool IsPatchInsideViewFrustum_ViewSpace(int X, int Z, const Matrix4f& ViewProj) const;
 
-    bool IsPatchInsideViewFrustum_WorldSpace(int X, int Z, const FrustumCulling& FC);
+    bool IsPatchInsideViewFrustum_WorldSpace(int X, int Z, const FrustumCulling& FC) const;
 
     int m_width = 0;
     int m_depth = 0;
@@ -83,8 +111,11 @@ class GeomipGrid {
     GLuint m_vao = 0;
     GLuint m_vb = 0;
     GLuint m_ib = 0;
+    GLenum m_indexType = GL_UNSIGNED_INT;
+    int m_indexSize = sizeof(uint);
     float m_worldScale = 1.0f;
 
+    // After EncodeIndices the range of the fans in the index buffer
     struct SingleLodInfo {
         int Start = 0;
         int Count = 0;
@@ -104,6 +135,7 @@ class GeomipGrid {
     int m_numPatchesZ = 0;
     LodManager m_lodManager;
     const BaseTerrain* m_pTerrain = NULL;
+    GeomipDrawList m_drawList;     // for Render()
 };
 
 #endif
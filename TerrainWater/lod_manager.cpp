@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <algorithm>
 
 #include "lod_manager.h"
 #include "demo_config.h"
@@ -41,14 +42,14 @@ void LodManager::CalcMaxLOD()
 }
 
 
-void LodManager::Update(const Vector3f& CameraPos)
+void LodManager::Update(const Vector3f& CameraPos, int LodBias)
 {
-    UpdateLodMapPass1(CameraPos);
+    UpdateLodMapPass1(CameraPos, LodBias);
     UpdateLodMapPass2(CameraPos);
 }
 
 
-void LodManager::UpdateLodMapPass1(const Vector3f& CameraPos)
+void LodManager::UpdateLodMapPass1(const Vector3f& CameraPos, int LodBias)
 {
     int CenterStep = m_patchSize / 2;
 
@@ -61,7 +62,7 @@ void LodManager::UpdateLodMapPass1(const Vector3f& CameraPos)
 
             float DistanceToCamera = CameraPos.Distance(PatchCenter);
 
-            int CoreLod = DistanceToLod(DistanceToCamera);
+            int CoreLod = std::min(DistanceToLod(DistanceToCamera) + LodBias, m_maxLOD);
 
             PatchLod* pPatchLOD = m_map.GetAddr(LodMapX, LodMapZ);
             pPatchLOD->Core = CoreLod;
@@ -15,6 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "simple_water.h"
 #include "texture_config.h"
 
@@ -28,7 +30,13 @@ SimpleWater::~SimpleWater()
 }
 
 
-void SimpleWater::Init(int Size, float WorldScale)
+static int ScaleTargetSize(int WindowSize, float Scale)
+{
+    return std::max(1, (int)((float)WindowSize * Scale + 0.5f));
+}
+
+
+void SimpleWater::Init(int Size, float WorldScale, int WindowWidth, int WindowHeight)
 {
     if (!m_waterTech.Init()) {
         printf("Error initializing water tech\n");
@@ -49,8 +57,44 @@ void SimpleWater::Init(int Size, float WorldScale)
 
     m_water.CreateTriangleList(2, 2, Size * WorldScale);
 
-    m_reflectionFBO.Init(1000, 1000);
-    m_refractionFBO.Init(1000, 1000);
+    m_windowWidth = WindowWidth;
+    m_windowHeight = WindowHeight;
+
+    m_reflectionFBO.Init(ScaleTargetSize(WindowWidth, m_quality.ReflectionScale), ScaleTargetSize(WindowHeight, m_quality.ReflectionScale));
+    m_refractionFBO.Init(ScaleTargetSize(WindowWidth, m_quality.RefractionScale), ScaleTargetSize(WindowHeight, m_quality.RefractionScale));
+}
+
+
+void SimpleWater::SetQuality(const WaterQuality& Quality)
+{
+    m_quality = Quality;
+
+    int Width = ScaleTargetSize(m_windowWidth, Quality.ReflectionScale);
+    int Height = ScaleTargetSize(m_windowHeight, Quality.ReflectionScale);
+
+    if ((Width != m_reflectionFBO.GetWidth()) || (Height != m_reflectionFBO.GetHeight())) {
+        m_reflectionFBO.Init(Width, Height);
+        m_hasReflection = false;
+    }
+
+    Width = ScaleTargetSize(m_windowWidth, Quality.RefractionScale);
+    Height = ScaleTargetSize(m_windowHeight, Quality.RefractionScale);
+
+    if ((Width != m_refractionFBO.GetWidth()) || (Height != m_refractionFBO.GetHeight())) {
+        m_refractionFBO.Init(Width, Height);
+    }
+}
+
+
+void SimpleWater::BeginFrame(const Vector3f& CameraPos)
+{
+    m_frameCount++;
+
+    // The first frame and any frame after the target was recreated must render it
+    m_isReflectionPassNeeded = !m_quality.HalfRateReflection || !m_hasReflection || (m_frameCount & 1);
+
+    float CameraHeightAboveWater = CameraPos.y - m_waterHeight;
+    m_isRefractionPassNeeded = (m_quality.RefractionSkipHeight <= 0.0f) || (CameraHeightAboveWater < m_quality.RefractionSkipHeight);
 }
 
 
@@ -61,6 +105,8 @@ void SimpleWater::Render(const Vector3f& CameraPos, const Matrix4f& VP, const Ve
     m_waterTech.SetCameraPos(CameraPos);
     m_waterTech.SetWaterHeight(m_waterHeight);
     m_waterTech.SetLightDir(LightDir);
+    m_waterTech.SetReflectionVP(m_reflectionVP);
+    m_waterTech.SetRefractionEnabled(m_isRefractionPassNeeded);
 
     static float sTime = 0.0f;
     sTime += 0.001f;
@@ -82,8 +128,9 @@ void SimpleWater::Render(const Vector3f& CameraPos, const Matrix4f& VP, const Ve
 }
 
 
-void SimpleWater::StartReflectionPass()
+void SimpleWater::StartReflectionPass(const Matrix4f& ReflectionVP)
 {
+    m_reflectionVP = ReflectionVP;
     m_reflectionFBO.BindForWriting();
 }
 
@@ -91,6 +138,7 @@ void SimpleWater::StartReflectionPass()
 void SimpleWater::EndReflectionPass()
 {
     m_reflectionFBO.UnbindWriting();
+    m_hasReflection = true;
 }
 
 
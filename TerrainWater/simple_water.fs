@@ -5,6 +5,7 @@ layout(location = 0) out vec4 FragColor;
 in vec2 oTex;
 in vec4 ClipSpaceCoords;
 in vec3 oVertexToCamera;
+in vec4 ReflectionClipSpaceCoords;
 
 uniform sampler2D gReflectionTexture;
 uniform sampler2D gRefractionTexture;
@@ -14,6 +15,7 @@ uniform sampler2D gDepthMap;
 uniform float gDUDVOffset = 0.0;
 uniform vec3 gLightColor;
 uniform vec3 gReversedLightDir;
+uniform bool gRefractionEnabled = true;
 
 const float WaveLength = 0.02;
 const float Shininess = 20.0;
@@ -23,10 +25,10 @@ void main()
 {
     vec4 NDCCoords = (ClipSpaceCoords / ClipSpaceCoords.w) / 2.0f + vec4(0.5);    
     vec2 RefractionTexCoords = NDCCoords.xy;
-    vec2 ReflectionTexCoords = RefractionTexCoords;
-    ReflectionTexCoords.y = 1.0 - ReflectionTexCoords.y;
+    vec2 ReflectionTexCoords = (ReflectionClipSpaceCoords.xy / ReflectionClipSpaceCoords.w) / 2.0 + vec2(0.5);
 
-    float Depth = texture(gDepthMap, RefractionTexCoords).r;
+    // Without the refraction pass there is no depth - treat the water as deep
+    float Depth = gRefractionEnabled ? texture(gDepthMap, RefractionTexCoords).r : 1.0;
 
     float ZNear = 1.0;
     float ZFar = 1000.0;
@@ -40,7 +42,7 @@ void main()
     ReflectionTexCoords = clamp(ReflectionTexCoords + dudv, 0.001, 0.999);
     RefractionTexCoords = clamp(RefractionTexCoords + dudv, 0.001, 0.999);
     vec4 reflectionColor = texture(gReflectionTexture, ReflectionTexCoords);
-    vec4 refractionColor = texture(gRefractionTexture, RefractionTexCoords);
+    vec4 refractionColor = gRefractionEnabled ? texture(gRefractionTexture, RefractionTexCoords) : vec4(0.0, 0.3, 0.5, 1.0);
 
     vec4 NormalColor = texture(gNormalMap, dudv1);
     vec3 Normal = vec3(NormalColor.r * 2.0 - 1.0, NormalColor.b * 4.0, NormalColor.g * 2.0 - 1.0);
@@ -23,6 +23,15 @@
 #include "simple_water_technique.h"
 #include "triangle_list.h"
 
+struct WaterQuality {
+    float ReflectionScale = 0.5f;       // size of the reflection target relative to the window
+    float RefractionScale = 0.5f;
+    int ReflectionLodBias = 1;          // coarser terrain in the reflection pass
+    bool HalfRateReflection = false;    // update the reflection every other frame
+    float RefractionSkipHeight = 300.0f;  // no refraction pass above this height over the water (0 - never skip)
+};
+
+
 class SimpleWater {
  public:
 
@@ -30,7 +39,12 @@ class SimpleWater {
 
     ~SimpleWater();
 
-    void Init(int Size, float WorldScale);
+    void Init(int Size, float WorldScale, int WindowWidth, int WindowHeight);
+
+    // Resizes the render targets if needed
+    void SetQuality(const WaterQuality& Quality);
+
+    const WaterQuality& GetQuality() const { return m_quality; }
 
     void SetWaterHeight(float Height) { m_waterHeight = Height; }
 
@@ -40,7 +54,16 @@ class SimpleWater {
 
     GLuint GetDUDVTexture() { return m_dudvMap.GetTexture(); }
 
-    void StartReflectionPass();
+    // Decides which passes are needed in this frame. Call once per frame before them.
+    void BeginFrame(const Vector3f& CameraPos);
+
+    bool IsReflectionPassNeeded() const { return m_isReflectionPassNeeded; }
+
+    bool IsRefractionPassNeeded() const { return m_isRefractionPassNeeded; }
+
+    // ReflectionVP is the mirrored camera. Render() uses it to reproject
+    // when the reflection is not updated every frame.
+    void StartReflectionPass(const Matrix4f& ReflectionVP);
     void EndReflectionPass();
 
     void StartRefractionPass();
@@ -58,6 +81,14 @@ class SimpleWater {
     Framebuffer m_refractionFBO;
     Texture m_dudvMap;
     Texture m_normalMap;
+    WaterQuality m_quality;
+    int m_windowWidth = 0;
+    int m_windowHeight = 0;
+    Matrix4f m_reflectionVP;
+    bool m_hasReflection = false;
+    int m_frameCount = 0;
+    bool m_isReflectionPassNeeded = true;
+    bool m_isRefractionPassNeeded = true;
 };
 
 #endif
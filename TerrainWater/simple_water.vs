@@ -6,10 +6,12 @@ layout (location = 1) in vec2 TexCoord;
 uniform mat4 gVP;
 uniform float gHeight = 0.0f;
 uniform vec3 gCameraPos;
+uniform mat4 gReflectionVP;     // the mirrored camera that rendered the reflection texture
 
 out vec2 oTex;
 out vec4 ClipSpaceCoords;
 out vec3 oVertexToCamera;
+out vec4 ReflectionClipSpaceCoords;
 
 const float Tiling = 6.0;
 
@@ -20,4 +22,6 @@ void main()
     gl_Position = ClipSpaceCoords;
     oTex = TexCoord * Tiling;
     oVertexToCamera = gCameraPos - NewPosition;
+    // Reprojects into the reflection texture even if it was rendered in an earlier frame
+    ReflectionClipSpaceCoords = gReflectionVP * vec4(NewPosition, 1.0);
 }
@@ -53,6 +53,8 @@ bool SimpleWaterTechnique::Init()
     m_cameraPosLoc = GetUniformLocation("gCameraPos");
     m_lightColorLoc = GetUniformLocation("gLightColor");
     m_reversedLightDirLoc = GetUniformLocation("gReversedLightDir");
+    m_reflectionVPLoc = GetUniformLocation("gReflectionVP");
+    m_refractionEnabledLoc = GetUniformLocation("gRefractionEnabled");
 
     if (m_VPLoc == INVALID_UNIFORM_LOCATION ||
         m_heightLoc == INVALID_UNIFORM_LOCATION ||
@@ -64,7 +66,9 @@ bool SimpleWaterTechnique::Init()
         m_dudvOffsetLoc == INVALID_UNIFORM_LOCATION ||
         m_cameraPosLoc == INVALID_UNIFORM_LOCATION ||
         m_lightColorLoc == INVALID_UNIFORM_LOCATION ||
-        m_reversedLightDirLoc == INVALID_UNIFORM_LOCATION) {
+        m_reversedLightDirLoc == INVALID_UNIFORM_LOCATION ||
+        m_reflectionVPLoc == INVALID_UNIFORM_LOCATION ||
+        m_refractionEnabledLoc == INVALID_UNIFORM_LOCATION) {
         return false;
     }
 
@@ -139,3 +143,14 @@ void SimpleWaterTechnique::SetLightDir(const Vector3f& LightDir)
     glUniform3f(m_reversedLightDirLoc, ReversedLightDir.x, ReversedLightDir.y, ReversedLightDir.z);
 }
 
+
+void SimpleWaterTechnique::SetReflectionVP(const Matrix4f& ReflectionVP)
+{
+    glUniformMatrix4fv(m_reflectionVPLoc, 1, GL_TRUE, (const GLfloat*)ReflectionVP.m);
+}
+
+
+void SimpleWaterTechnique::SetRefractionEnabled(bool Enabled)
+{
+    glUniform1i(m_refractionEnabledLoc, Enabled ? 1 : 0);
+}
@@ -40,6 +40,8 @@ public:
     void SetCameraPos(const Vector3f& CameraPos);
     void SetLightColor(const Vector3f& LightColor);
     void SetLightDir(const Vector3f& LightDir);
+    void SetReflectionVP(const Matrix4f& ReflectionVP);
+    void SetRefractionEnabled(bool Enabled);
 
 private:
     GLuint m_VPLoc = -1;
@@ -53,6 +55,8 @@ private:
     GLuint m_cameraPosLoc = -1;    
     GLuint m_lightColorLoc = -1;
     GLuint m_reversedLightDirLoc = -1;
+    GLuint m_reflectionVPLoc = -1;
+    GLuint m_refractionEnabledLoc = -1;
 };
 
 #endif  /* SIMPLE_WATER_TECHNIQUE_H */
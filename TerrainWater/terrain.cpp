@@ -26,6 +26,7 @@
 
 #include "demo_config.h"
 #include "terrain.h"
+#include "ogldev_mapped_file.h"
 #include "texture_config.h"
 #include "3rdparty/stb_image_write.h"
 
@@ -81,7 +82,7 @@ void BaseTerrain::Finalize()
 {
     m_geomipGrid.CreateGeomipGrid(m_terrainSize, m_terrainSize, m_patchSize, this);
 
-    m_water.Init(m_terrainSize, m_worldScale);
+    m_water.Init(m_terrainSize, m_worldScale, WINDOW_WIDTH, WINDOW_HEIGHT);
 }
 
 
@@ -119,30 +120,38 @@ void BaseTerrain::LoadFromFile(const char* pFilename)
 
     m_geomipGrid.CreateGeomipGrid(m_terrainSize, m_terrainSize, m_patchSize, this);
 	
-	m_water.Init(m_terrainSize, m_worldScale);
+	m_water.Init(m_terrainSize, m_worldScale, WINDOW_WIDTH, WINDOW_HEIGHT);
 }
 
 
 void BaseTerrain::LoadHeightMapFile(const char* pFilename)
 {
-    int FileSize = 0;
-    unsigned char* p = (unsigned char*)ReadBinaryFile(pFilename, FileSize);
+    MappedFile File;
+
+    if (!File.Open(pFilename)) {
+        OGLDEV_FILE_ERROR(pFilename);
+        exit(0);
+    }
+
+    u64 FileSize = File.GetSize();
 
     if (FileSize % sizeof(float) != 0) {
-        printf("%s:%d - '%s' does not contain an whole number of floats (size %d)\n", __FILE__, __LINE__, pFilename, FileSize);
+        printf("%s:%d - '%s' does not contain an whole number of floats (size %llu)\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_terrainSize = (int)sqrtf((float)FileSize / (float)sizeof(float));
+    m_terrainSize = (int)sqrt((double)FileSize / (double)sizeof(float));
 
     printf("Terrain size %d\n", m_terrainSize);
 
-    if ((m_terrainSize * m_terrainSize) != (FileSize / sizeof(float))) {
-        printf("%s:%d - '%s' does not contain a square height map - size %d\n", __FILE__, __LINE__, pFilename, FileSize);
+    if ((u64)m_terrainSize * m_terrainSize != (FileSize / sizeof(float))) {
+        printf("%s:%d - '%s' does not contain a square height map - size %llu\n", __FILE__, __LINE__, pFilename, (unsigned long long)FileSize);
         exit(0);
     }
 
-    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize, (float*)p);
+    // The height map is modified later so it gets its own copy of the mapped pages
+    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize);
+    memcpy(m_heightMap.GetBaseAddr(), File.GetData(), FileSize);
 }
 
 
@@ -190,9 +199,34 @@ void BaseTerrain::RenderTerrain(const BasicCamera& Camera)
 
     m_terrainTech.SetLightDir(m_lightDir);
 
-    RenderTerrainReflectionPass(Camera);
+    m_water.BeginFrame(Camera.GetPos());
+
+    // The LODs are calculated once for all the passes and the culling
+    // once per camera. The reflection pass culls with its own camera and
+    // may use coarser LODs. The draw list keeps the LODs it was culled
+    // with so the camera LODs can be calculated right after it.
+    BasicCamera ReflectionCamera = GetReflectionCamera(Camera);
+    int ReflectionLodBias = m_water.GetQuality().ReflectionLodBias;
+
+    if (m_water.IsReflectionPassNeeded() && (ReflectionLodBias != 0)) {
+        m_geomipGrid.UpdateLOD(Camera.GetPos(), ReflectionLodBias);
+        m_geomipGrid.CullPatches(ReflectionCamera.GetViewProjMatrix(), m_reflectionDrawList);
+    }
+
+    m_geomipGrid.UpdateLOD(Camera.GetPos());
+    m_geomipGrid.CullPatches(VP, m_cameraDrawList);
+
+    if (m_water.IsReflectionPassNeeded()) {
+        if (ReflectionLodBias == 0) {
+            m_geomipGrid.CullPatches(ReflectionCamera.GetViewProjMatrix(), m_reflectionDrawList);
+        }
+
+        RenderTerrainReflectionPass(ReflectionCamera);
+    }
 
-    RenderTerrainRefractionPass(Camera);
+    if (m_water.IsRefractionPassNeeded()) {
+        RenderTerrainRefractionPass(Camera);
+    }
 
     RenderTerrainDefaultPass(Camera);
 
@@ -203,10 +237,8 @@ void BaseTerrain::RenderTerrain(const BasicCamera& Camera)
 }
 
 
-void BaseTerrain::RenderTerrainReflectionPass(const BasicCamera& Camera)
+BasicCamera BaseTerrain::GetReflectionCamera(const BasicCamera& Camera) const
 {
-    m_water.StartReflectionPass();
-
     BasicCamera CameraUnderWater = Camera;
 
     // Set the position of the camera to be under the water
@@ -221,13 +253,23 @@ void BaseTerrain::RenderTerrainReflectionPass(const BasicCamera& Camera)
     CameraTargetUnderWater.y *= -1.0f;
     CameraUnderWater.SetTarget(CameraTargetUnderWater);
 
+    return CameraUnderWater;
+}
+
+
+void BaseTerrain::RenderTerrainReflectionPass(const BasicCamera& ReflectionCamera)
+{
+    Matrix4f ReflectionVP = ReflectionCamera.GetViewProjMatrix();
+
+    m_water.StartReflectionPass(ReflectionVP);
+
     Vector3f PlaneNormal(0, 1.0f, 0.0f);
     Vector3f PointOnPlane(0.0f, m_water.GetWaterHeight() + 0.5f, 0.0f);
     m_terrainTech.SetClipPlane(PlaneNormal, PointOnPlane);
 
-    m_terrainTech.SetVP(CameraUnderWater.GetViewProjMatrix());
-    m_geomipGrid.Render(CameraUnderWater.GetPos(), CameraUnderWater.GetViewProjMatrix());
-    m_pSkydome->Render(CameraUnderWater);
+    m_terrainTech.SetVP(ReflectionVP);
+    m_geomipGrid.Submit(m_reflectionDrawList);
+    m_pSkydome->Render(ReflectionCamera);
     m_terrainTech.Enable();
     m_water.EndReflectionPass();
 }
@@ -240,7 +282,7 @@ void BaseTerrain::RenderTerrainRefractionPass(const BasicCamera& Camera)
     Vector3f PointOnPlane(0.0f, m_water.GetWaterHeight() + 0.5f, 0.0f);
     m_terrainTech.SetClipPlane(PlaneNormal, PointOnPlane);
     m_terrainTech.SetVP(Camera.GetViewProjMatrix());
-    m_geomipGrid.Render(Camera.GetPos(), Camera.GetViewProjMatrix());
+    m_geomipGrid.Submit(m_cameraDrawList);
     m_water.EndRefractionPass();
 }
 
@@ -252,7 +294,7 @@ void BaseTerrain::RenderTerrainDefaultPass(const BasicCamera& Camera)
     m_terrainTech.SetClipPlane(PlaneNormal, PointOnPlane);
 
     m_terrainTech.SetVP(Camera.GetViewProjMatrix());
-    m_geomipGrid.Render(Camera.GetPos(), Camera.GetViewProjMatrix());
+    m_geomipGrid.Submit(m_cameraDrawList);
 }
 
 
@@ -71,6 +71,10 @@ class BaseTerrain
 	
     void SetWaterHeight(float Height) { m_water.SetWaterHeight(Height); }
 
+    void SetWaterQuality(const WaterQuality& Quality) { m_water.SetQuality(Quality); }
+
+    const WaterQuality& GetWaterQuality() const { return m_water.GetQuality(); }
+
     void ControlGUI(bool Enable) { m_guiEnabled = Enable; }
 
  protected:
@@ -92,12 +96,15 @@ class BaseTerrain
 
 private:
     void RenderTerrain(const BasicCamera& Camera);
-    void RenderTerrainReflectionPass(const BasicCamera& Camera);
+    BasicCamera GetReflectionCamera(const BasicCamera& Camera) const;
+    void RenderTerrainReflectionPass(const BasicCamera& ReflectionCamera);
     void RenderTerrainRefractionPass(const BasicCamera& Camera);
     void RenderTerrainDefaultPass(const BasicCamera& Camera);
     void RenderWater(const BasicCamera& Camera);
 
     GeomipGrid m_geomipGrid;
+    GeomipDrawList m_cameraDrawList;        // refraction and default passes
+    GeomipDrawList m_reflectionDrawList;
     float m_minHeight = 0.0f;
     float m_maxHeight = 0.0f;
     TerrainTechnique m_terrainTech;
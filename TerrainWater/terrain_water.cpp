@@ -93,6 +93,18 @@ public:
 
                 m_terrain.SetWaterHeight(m_waterHeight);
 
+                WaterQuality Quality = m_terrain.GetWaterQuality();
+                bool QualityChanged = false;
+                QualityChanged |= ImGui::SliderFloat("Reflection scale", &Quality.ReflectionScale, 0.125f, 1.0f);
+                QualityChanged |= ImGui::SliderFloat("Refraction scale", &Quality.RefractionScale, 0.125f, 1.0f);
+                QualityChanged |= ImGui::SliderInt("Reflection LOD bias", &Quality.ReflectionLodBias, 0, 4);
+                QualityChanged |= ImGui::Checkbox("Half rate reflection", &Quality.HalfRateReflection);
+                QualityChanged |= ImGui::SliderFloat("Refraction skip height", &Quality.RefractionSkipHeight, 0.0f, 1000.0f);
+
+                if (QualityChanged) {
+                    m_terrain.SetWaterQuality(Quality);
+                }
+
                 ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
                 ImGui::End();
 
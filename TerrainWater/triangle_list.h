@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "ogldev_math_3d.h"
+#include "ogldev_index_encoder.h"
 
 class TriangleList {
  public:
@@ -29,12 +30,19 @@ class TriangleList {
 
     void InitVertices(std::vector<Vertex>& Vertices, float WorldScale);
     void InitIndices(std::vector<uint>& Indices);
+    void InitStrips(const std::vector<uint>& Triangles);
 
     int m_width = 0;
     int m_depth = 0;
     GLuint m_vao;
     GLuint m_vb;
     GLuint m_ib;
+
+    // The strips are drawn in bands of rows with the first vertex of the
+    // band as the base vertex
+    std::vector<IndexRange> m_ranges;
+    GLenum m_indexType = GL_UNSIGNED_INT;
+    int m_indexSize = sizeof(uint);
 };
 
 #endif
@@ -6,4 +6,4 @@ CPPFLAGS="$CPPFLAGS -I../../Include"
 LDFLAGS=`pkg-config --libs glew assimp`
 LDFLAGS="$LDFLAGS -lglut -lX11"
 
-$CC tranform_order.cpp ../../Common/ogldev_util.cpp  ../../Common/math_3d.cpp ../../Common/ogldev_texture.cpp ../../Common/3rdparty/stb_image.cpp ../../Common/ogldev_world_transform.cpp camera.cpp ../../Common/ogldev_basic_mesh.cpp lighting_technique.cpp simple_technique.cpp ../../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tranform_order
+$CC tranform_order.cpp ../../Common/ogldev_util.cpp ../../Common/ogldev_mapped_file.cpp  ../../Common/math_3d.cpp ../../Common/ogldev_texture.cpp ../../Common/ogldev_gl_state.cpp ../../Common/3rdparty/stb_image.cpp ../../Common/ogldev_world_transform.cpp camera.cpp ../../Common/ogldev_basic_mesh.cpp lighting_technique.cpp simple_technique.cpp ../../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tranform_order
@@ -6,4 +6,4 @@ CPPFLAGS="$CPPFLAGS -I../Include -ggdb3"
 LDFLAGS=`pkg-config --libs glew ImageMagick++ assimp`
 LDFLAGS="$LDFLAGS -lglut -lX11"
 
-$CC tutorial23.cpp ../Common/ogldev_util.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/3rdparty/stb_image.cpp ../Common/ogldev_world_transform.cpp camera.cpp ../Common/ogldev_basic_mesh.cpp lighting_technique.cpp ../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial23
+$CC tutorial23.cpp ../Common/ogldev_util.cpp ../Common/ogldev_mapped_file.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/ogldev_gl_state.cpp ../Common/3rdparty/stb_image.cpp ../Common/ogldev_world_transform.cpp camera.cpp ../Common/ogldev_basic_mesh.cpp lighting_technique.cpp ../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial23
@@ -5,4 +5,4 @@ CPPFLAGS="-I../Include"
 LDFLAGS=`pkg-config --libs glew`
 LDFLAGS="$LDFLAGS -lglut"
 
-$CC tutorial08.cpp ../Common/ogldev_util.cpp $CPPFLAGS $LDFLAGS -o tutorial08
+$CC tutorial08.cpp ../Common/ogldev_util.cpp ../Common/ogldev_mapped_file.cpp $CPPFLAGS $LDFLAGS -o tutorial08
@@ -6,4 +6,4 @@ CPPFLAGS="$CPPFLAGS -I../Include -I../Common/FreetypeGL"
 LDFLAGS=`pkg-config --libs glew ImageMagick freetype2 glfw3`
 LDFLAGS="$LDFLAGS -lglut"
 
-$CC tutorial11.cpp ../Common/ogldev_util.cpp ../Common/pipeline.cpp ../Common/math_3d.cpp $CPPFLAGS $LDFLAGS -o tutorial11
+$CC tutorial11.cpp ../Common/ogldev_util.cpp ../Common/ogldev_mapped_file.cpp ../Common/pipeline.cpp ../Common/math_3d.cpp $CPPFLAGS $LDFLAGS -o tutorial11
@@ -6,4 +6,4 @@ CPPFLAGS="$CPPFLAGS -I../Include -I../Common/FreetypeGL"
 LDFLAGS=`pkg-config --libs glew ImageMagick freetype2 glfw3`
 LDFLAGS="$LDFLAGS -lglut ../Lib/libAntTweakBar.a -lX11"
 
-$CC tutorial14.cpp ../Common/ogldev_util.cpp ../Common/pipeline.cpp ../Common/math_3d.cpp ../Common/camera.cpp ../Common/ogldev_atb.cpp ../Common/glut_backend.cpp $CPPFLAGS $LDFLAGS -o tutorial14
+$CC tutorial14.cpp ../Common/ogldev_util.cpp ../Common/ogldev_mapped_file.cpp ../Common/pipeline.cpp ../Common/math_3d.cpp ../Common/camera.cpp ../Common/ogldev_atb.cpp ../Common/glut_backend.cpp $CPPFLAGS $LDFLAGS -o tutorial14
@@ -6,4 +6,4 @@ CPPFLAGS="$CPPFLAGS -I../Include -I../Common/FreetypeGL"
 LDFLAGS=`pkg-config --libs glew ImageMagick freetype2 glfw3`
 LDFLAGS="$LDFLAGS -lglut ../Lib/libAntTweakBar.a -lX11"
 
-$CC tutorial15.cpp ../Common/ogldev_util.cpp  ../Common/math_3d.cpp world_transform.cpp camera.cpp $CPPFLAGS $LDFLAGS -o tutorial15
+$CC tutorial15.cpp ../Common/ogldev_util.cpp ../Common/ogldev_mapped_file.cpp  ../Common/math_3d.cpp world_transform.cpp camera.cpp $CPPFLAGS $LDFLAGS -o tutorial15
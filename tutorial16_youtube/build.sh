@@ -6,4 +6,4 @@ CPPFLAGS="$CPPFLAGS -I../Include"
 LDFLAGS=`pkg-config --libs glew ImageMagick++`
 LDFLAGS="$LDFLAGS -lglut -lX11"
 
-$CC tutorial16.cpp ../Common/ogldev_util.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/3rdparty/stb_image.cpp world_transform.cpp camera.cpp $CPPFLAGS $LDFLAGS -o tutorial16
+$CC tutorial16.cpp ../Common/ogldev_util.cpp ../Common/ogldev_mapped_file.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/ogldev_gl_state.cpp ../Common/3rdparty/stb_image.cpp world_transform.cpp camera.cpp $CPPFLAGS $LDFLAGS -o tutorial16
@@ -6,4 +6,4 @@ CPPFLAGS="$CPPFLAGS -I../Include -ggdb3"
 LDFLAGS=`pkg-config --libs glew assimp`
 LDFLAGS="$LDFLAGS -lglut -lX11"
 
-$CC tutorial27.cpp ../Common/ogldev_util.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/3rdparty/stb_image.cpp ../Common/ogldev_world_transform.cpp camera.cpp skinning_technique.cpp skinned_mesh.cpp ../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial27
+$CC tutorial27.cpp ../Common/ogldev_util.cpp ../Common/ogldev_mapped_file.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/ogldev_gl_state.cpp ../Common/3rdparty/stb_image.cpp ../Common/ogldev_world_transform.cpp camera.cpp skinning_technique.cpp skinned_mesh.cpp ../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial27
@@ -22,6 +22,7 @@
 #include "ogldev_math_3d.h"
 
 #define MAX_PARTICLES 1000
+#define MAX_GPU_PARTICLES 100000
 #define PARTICLE_LIFETIME 10.0f
 
 #define PARTICLE_TYPE_LAUNCHER 0.0f
@@ -42,6 +43,7 @@ ParticleSystem::ParticleSystem()
     m_currVB = 0;
     m_currTFB = 1;
     m_isFirst = true;
+    m_useGPUParticles = false;
     m_time = 0;
     m_pTexture = NULL;            
     
@@ -66,8 +68,35 @@ ParticleSystem::~ParticleSystem()
 
 bool ParticleSystem::InitParticleSystem(const Vector3f& Pos)
 {   
-    Particle Particles[MAX_PARTICLES];
-    ZERO_MEM(Particles);
+    m_pTexture = new Texture(GL_TEXTURE_2D, "../Content/fireworks_red.jpg");
+    
+    if (!m_pTexture->Load()) {
+        return false;
+    }        
+
+    if (GPUParticleSystem::IsSupported()) {
+        ParticleEmitterDesc Fountain;
+        Fountain.Pos = Pos;
+        Fountain.EmitRate = 20000.0f;
+        Fountain.Velocity = Vector3f(0.0f, 0.5f, 0.0f);
+        Fountain.VelocitySpread = 0.15f;
+        Fountain.Gravity = Vector3f(0.0f, -0.5f, 0.0f);
+        Fountain.MinLifetime = 1.5f;
+        Fountain.MaxLifetime = 3.0f;
+
+        if (!m_gpuParticles.Init(MAX_GPU_PARTICLES, Fountain)) {
+            return false;
+        }
+
+        m_gpuParticles.SetTexture(m_pTexture);
+        m_gpuParticles.SetBillboardSize(0.01f);
+        m_useGPUParticles = true;
+
+        return GLCheckError();
+    }
+
+    // Value initialized - all zeros
+    std::vector<Particle> Particles(MAX_PARTICLES);
 
     Particles[0].Type = PARTICLE_TYPE_LAUNCHER;
     Particles[0].Pos = Pos;
@@ -80,7 +109,7 @@ bool ParticleSystem::InitParticleSystem(const Vector3f& Pos)
     for (unsigned int i = 0; i < 2 ; i++) {
         glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_transformFeedback[i]);
         glBindBuffer(GL_ARRAY_BUFFER, m_particleBuffer[i]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(Particles), Particles, GL_DYNAMIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Particle) * Particles.size(), Particles.data(), GL_DYNAMIC_DRAW);
         glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_particleBuffer[i]);        
     }
                       
@@ -111,12 +140,6 @@ bool ParticleSystem::InitParticleSystem(const Vector3f& Pos)
 
     m_billboardTechnique.SetBillboardSize(0.01f);
     
-    m_pTexture = new Texture(GL_TEXTURE_2D, "../Content/fireworks_red.jpg");
-    
-    if (!m_pTexture->Load()) {
-        return false;
-    }        
-    
     return GLCheckError();
 }
 
@@ -125,6 +148,12 @@ void ParticleSystem::Render(int DeltaTimeMillis, const Matrix4f& VP, const Vecto
 {
     m_time += DeltaTimeMillis;
     
+    if (m_useGPUParticles) {
+        m_gpuParticles.Update((float)DeltaTimeMillis / 1000.0f);
+        m_gpuParticles.Render(VP, CameraPos);
+        return;
+    }
+
     UpdateParticles(DeltaTimeMillis);
 
     RenderParticles(VP, CameraPos);
@@ -25,6 +25,7 @@
 #include "random_texture.h"
 #include "billboard_technique.h"
 #include "ogldev_texture.h"
+#include "ogldev_gpu_particles.h"
 
 class ParticleSystem
 {
@@ -42,6 +43,10 @@ private:
     void UpdateParticles(int DeltaTimeMillis);
     void RenderParticles(const Matrix4f& VP, const Vector3f& CameraPos);
     
+    // Compute shader particles when available, transform feedback otherwise
+    bool m_useGPUParticles;
+    GPUParticleSystem m_gpuParticles;
+
     bool m_isFirst;
     unsigned int m_currVB;
     unsigned int m_currTFB;
@@ -6,4 +6,4 @@ CPPFLAGS="$CPPFLAGS -I../Include -ggdb3"
 LDFLAGS=`pkg-config --libs glew assimp`
 LDFLAGS="$LDFLAGS -lglut -lX11 -lmeshoptimizer"
 
-$CC tutorial28.cpp ../Common/ogldev_util.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/3rdparty/stb_image.cpp ../Common/ogldev_world_transform.cpp ../Common/ogldev_basic_mesh.cpp camera.cpp skinning_technique.cpp skinned_mesh.cpp ../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial28
+$CC tutorial28.cpp ../Common/ogldev_util.cpp ../Common/ogldev_mapped_file.cpp  ../Common/math_3d.cpp ../Common/ogldev_texture.cpp ../Common/ogldev_gl_state.cpp ../Common/3rdparty/stb_image.cpp ../Common/ogldev_world_transform.cpp ../Common/ogldev_basic_mesh.cpp camera.cpp skinning_technique.cpp skinned_mesh.cpp ../Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial28
@@ -126,6 +126,7 @@ public:
 
         Matrix4f WVP = m_lightPersProjMatrix * LightView * World;
         m_shadowMapTech.SetWVP(WVP);
+        m_shadowMapTech.CommitDraw();
 
         m_pMesh1->Render();
     }
@@ -7,4 +7,4 @@ LDFLAGS=`pkg-config --libs glew assimp glfw3`
 LDFLAGS="$LDFLAGS -lglut -lX11 -lmeshoptimizer"
 ROOTDIR=".."
 
-$CC tutorial36.cpp $ROOTDIR/Common/ogldev_util.cpp  $ROOTDIR/Common/math_3d.cpp $ROOTDIR/Common/ogldev_texture.cpp $ROOTDIR/Common/3rdparty/stb_image.cpp $ROOTDIR/Common/ogldev_world_transform.cpp $ROOTDIR/Common/ogldev_basic_glfw_camera.cpp $ROOTDIR/Common/ogldev_basic_mesh.cpp  $ROOTDIR/Common/ogldev_new_lighting.cpp $ROOTDIR/Common/ogldev_glfw.cpp $ROOTDIR/Common/ogldev_shadow_mapping_technique.cpp $ROOTDIR/Common/ogldev_shadow_map_fbo.cpp $ROOTDIR/Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial36
+$CC tutorial36.cpp $ROOTDIR/Common/ogldev_util.cpp $ROOTDIR/Common/ogldev_mapped_file.cpp  $ROOTDIR/Common/math_3d.cpp $ROOTDIR/Common/ogldev_texture.cpp $ROOTDIR/Common/ogldev_gl_state.cpp $ROOTDIR/Common/3rdparty/stb_image.cpp $ROOTDIR/Common/ogldev_world_transform.cpp $ROOTDIR/Common/ogldev_basic_glfw_camera.cpp $ROOTDIR/Common/ogldev_basic_mesh.cpp  $ROOTDIR/Common/ogldev_new_lighting.cpp $ROOTDIR/Common/ogldev_glfw.cpp $ROOTDIR/Common/ogldev_shadow_mapping_technique.cpp $ROOTDIR/Common/ogldev_shadow_map_fbo.cpp $ROOTDIR/Common/ogldev_streaming_buffer.cpp $ROOTDIR/Common/technique.cpp $CPPFLAGS $LDFLAGS -o tutorial36
@@ -142,14 +142,19 @@ public:
         Vector3f Origin(0.0f, 0.0f, 0.0f);
         Vector3f Up(0.0f, 1.0f, 0.0f);
 
+        m_shadowMapTech.BeginDraws(ARRAY_SIZE_IN_ELEMENTS(m_positions));
+
         for (int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_positions) ; i++) {
             m_pMesh1->SetPosition(m_positions[i]);
             Matrix4f World = m_pMesh1->GetWorldMatrix();
             LightView.InitCameraTransform(Origin, m_dirLight.WorldDirection, Up);
             Matrix4f WVP = m_lightOrthoProjMatrix * LightView * World;
             m_shadowMapTech.SetWVP(WVP);
+            m_shadowMapTech.CommitDraw();
             m_pMesh1->Render();
         }
+
+        m_shadowMapTech.EndDraws();
     }
 
     void LightingPass()
@@ -9,8 +9,10 @@ ROOTDIR=".."
 
 $CC tutorial37.cpp \
     $ROOTDIR/Common/ogldev_util.cpp \
+    $ROOTDIR/Common/ogldev_mapped_file.cpp \
     $ROOTDIR/Common/math_3d.cpp \
     $ROOTDIR/Common/ogldev_texture.cpp \
+    $ROOTDIR/Common/ogldev_gl_state.cpp \
     $ROOTDIR/Common/3rdparty/stb_image.cpp \
     $ROOTDIR/Common/ogldev_world_transform.cpp \
     $ROOTDIR/Common/ogldev_basic_glfw_camera.cpp \
@@ -19,5 +21,6 @@ $CC tutorial37.cpp \
     $ROOTDIR/Common/ogldev_glfw.cpp \
     $ROOTDIR/Common/ogldev_shadow_mapping_technique_point_light.cpp \
     $ROOTDIR/Common/ogldev_shadow_cube_map_fbo.cpp \
+    $ROOTDIR/Common/ogldev_streaming_buffer.cpp \
     $ROOTDIR/Common/technique.cpp \
     $CPPFLAGS $LDFLAGS -o tutorial37
@@ -150,6 +150,9 @@ public:
 
         glClearColor(FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX);
 
+        int NumDrawsPerFace = ARRAY_SIZE_IN_ELEMENTS(m_housePositions) + ARRAY_SIZE_IN_ELEMENTS(m_cylinderPositions);
+        m_shadowMapTech.BeginDraws(NUM_CUBE_MAP_FACES * NumDrawsPerFace);
+
         for (uint i = 0 ; i < NUM_CUBE_MAP_FACES ; i++) {
 
             m_shadowCubeMapFBO.BindForWriting(gCameraDirections[i].CubemapFace);
@@ -165,6 +168,7 @@ public:
                 Matrix4f WVP = m_lightPersProjMatrix * LightView * World;
                 m_shadowMapTech.SetWVP(WVP);
                 m_shadowMapTech.SetWorld(World);
+                m_shadowMapTech.CommitDraw();
                 m_pMesh1->Render();
             }
 
@@ -174,9 +178,12 @@ public:
                 Matrix4f WVP = m_lightPersProjMatrix * LightView * World;
                 m_shadowMapTech.SetWVP(WVP);
                 m_shadowMapTech.SetWorld(World);
+                m_shadowMapTech.CommitDraw();
                 m_pMesh2->Render();
             }
         }
+
+        m_shadowMapTech.EndDraws();
     }
 
     void LightingPass()
@@ -150,14 +150,19 @@ public:
 
         m_lightOrthoProjMatrix.InitOrthoProjTransform(LightOrthoProjInfo);
 
+        m_shadowMapTech.BeginDraws(ARRAY_SIZE_IN_ELEMENTS(m_positions));
+
         for (int i = 0 ; i < ARRAY_SIZE_IN_ELEMENTS(m_positions) ; i++) {
             m_pMesh1->SetPosition(m_positions[i]);
             Matrix4f World = m_pMesh1->GetWorldMatrix();
             LightView.InitCameraTransform(m_lightWorldPos, m_dirLight.WorldDirection, Up);
             Matrix4f WVP = m_lightOrthoProjMatrix * LightView * World;
             m_shadowMapTech.SetWVP(WVP);
+            m_shadowMapTech.CommitDraw();
             m_pMesh1->Render();
         }
+
+        m_shadowMapTech.EndDraws();
     }
 
     void LightingPass()
@@ -43,6 +43,9 @@
 #define SHADOW_MAP_WIDTH 4096
 #define SHADOW_MAP_HEIGHT 4096
 
+// The random offsets are generated on the first run and loaded from here on the next ones
+#define SHADOW_MAP_OFFSETS_CACHE "shadow_map_offsets.bin"
+
 static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 static void CursorPosCallback(GLFWwindow* window, double x, double y);
 static void MouseButtonCallback(GLFWwindow* window, int Button, int Action, int Mode);
@@ -145,6 +148,7 @@ public:
         LightView.InitCameraTransform(Origin, m_dirLight.WorldDirection, Up);
         Matrix4f WVP = m_lightOrthoProjMatrix * LightView * World;
         m_shadowMapTech.SetWVP(WVP);
+        m_shadowMapTech.CommitDraw();
         m_pMesh1->Render();
     }
 
@@ -325,8 +329,13 @@ private:
             exit(1);
         }
 
+        // Half floats are precise enough for the offsets and halve the texture
+        bool UseHalfFloat = true;
+
         m_pShadowMapOffsetTexture = new ShadowMapOffsetTexture(m_shadowMapOffsetTextureSize,
-                                                               m_shadowMapOffsetFilterSize);
+                                                               m_shadowMapOffsetFilterSize,
+                                                               UseHalfFloat,
+                                                               SHADOW_MAP_OFFSETS_CACHE);
 
         m_pShadowMapOffsetTexture->Bind(SHADOW_MAP_RANDOM_OFFSET_TEXTURE_UNIT);
     }
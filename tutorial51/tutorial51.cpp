@@ -33,6 +33,7 @@
 #include "ogldev_app.h"
 #include "ogldev_util.h"
 #include "ogldev_vulkan_core.h"
+#include "ogldev_vulkan_frames.h"
 
 #include "ogldev_xcb_control.h"
 
@@ -62,8 +63,8 @@ public:
 private:
 
     void CreateSwapChain();
-    void CreateCommandBuffer();
-    void RecordCommandBuffers();
+    void CreateFramesInFlight();
+    void RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex);
     void RenderScene();
 
     std::string m_appName;
@@ -72,8 +73,7 @@ private:
     std::vector<VkImage> m_images;
     VkSwapchainKHR m_swapChainKHR;
     VkQueue m_queue;
-    std::vector<VkCommandBuffer> m_cmdBufs;
-    VkCommandPool m_cmdBufPool;
+    VulkanFramesInFlight m_frames;
 };
 
 
@@ -128,89 +128,74 @@ void OgldevVulkanApp::CreateSwapChain()
     printf("Number of images %d\n", NumSwapChainImages);
 
     m_images.resize(NumSwapChainImages);
-    m_cmdBufs.resize(NumSwapChainImages);
     
     res = vkGetSwapchainImagesKHR(m_core.GetDevice(), m_swapChainKHR, &NumSwapChainImages, &(m_images[0]));
     CHECK_VULKAN_ERROR("vkGetSwapchainImagesKHR error %d\n", res);
 }
 
 
-void OgldevVulkanApp::CreateCommandBuffer()
+void OgldevVulkanApp::CreateFramesInFlight()
 {
-    VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
-    cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    cmdPoolCreateInfo.queueFamilyIndex = m_core.GetQueueFamily();
-    
-    VkResult res = vkCreateCommandPool(m_core.GetDevice(), &cmdPoolCreateInfo, NULL, &m_cmdBufPool);    
-    CHECK_VULKAN_ERROR("vkCreateCommandPool error %d\n", res);
-    
-    printf("Command buffer pool created\n");
-    
-    VkCommandBufferAllocateInfo cmdBufAllocInfo = {};
-    cmdBufAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cmdBufAllocInfo.commandPool = m_cmdBufPool;
-    cmdBufAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    cmdBufAllocInfo.commandBufferCount = m_images.size();
-    
-    res = vkAllocateCommandBuffers(m_core.GetDevice(), &cmdBufAllocInfo, &m_cmdBufs[0]);            
-    CHECK_VULKAN_ERROR("vkAllocateCommandBuffers error %d\n", res);
-    
-    printf("Created command buffers\n");
+    // Two frames so the CPU can get one frame ahead of the GPU
+    m_frames.Init(&m_core, m_queue, 2, m_images.size());
 }
 
 
-void OgldevVulkanApp::RecordCommandBuffers() 
+void OgldevVulkanApp::RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex)
 {
+    // Recorded every frame into the command buffer of the frame slot
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-    
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
     VkClearColorValue clearColor = { 164.0f/256.0f, 30.0f/256.0f, 34.0f/256.0f, 0.0f };
-    VkClearValue clearValue = {};
-    clearValue.color = clearColor;
-    
+
     VkImageSubresourceRange imageRange = {};
     imageRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     imageRange.levelCount = 1;
     imageRange.layerCount = 1;
-          
-    for (uint i = 0 ; i < m_cmdBufs.size() ; i++) {             
-        VkResult res = vkBeginCommandBuffer(m_cmdBufs[i], &beginInfo);
-        CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
 
-        vkCmdClearColorImage(m_cmdBufs[i], m_images[i], VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &imageRange);                
+    VkResult res = vkBeginCommandBuffer(CmdBuf, &beginInfo);
+    CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
 
-        res = vkEndCommandBuffer(m_cmdBufs[i]);
-        CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
-    }
-    
-    printf("Command buffers recorded\n");    
+    vkCmdClearColorImage(CmdBuf, m_images[ImageIndex], VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &imageRange);
+
+    res = vkEndCommandBuffer(CmdBuf);
+    CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
 }
 
 
 void OgldevVulkanApp::RenderScene()
 {
+    VkCommandBuffer CmdBuf = m_frames.BeginFrame();
+
+    VkSemaphore ImageAvailableSem = m_frames.GetImageAvailableSem();
+
     uint ImageIndex = 0;
-    
-    VkResult res = vkAcquireNextImageKHR(m_core.GetDevice(), m_swapChainKHR, UINT64_MAX, NULL, NULL, &ImageIndex);
+
+    VkResult res = vkAcquireNextImageKHR(m_core.GetDevice(), m_swapChainKHR, UINT64_MAX, ImageAvailableSem, NULL, &ImageIndex);
     CHECK_VULKAN_ERROR("vkAcquireNextImageKHR error %d\n" , res);
-   
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount   = 1;
-    submitInfo.pCommandBuffers      = &m_cmdBufs[ImageIndex];
-    
-    res = vkQueueSubmit(m_queue, 1, &submitInfo, NULL);    
-    CHECK_VULKAN_ERROR("vkQueueSubmit error %d\n", res);
-    
+
+    m_frames.WaitForImage(ImageIndex);
+
+    VkSemaphore RenderCompleteSem = m_frames.GetRenderCompleteSem(ImageIndex);
+
+    RecordCommandBuffer(CmdBuf, ImageIndex);
+
+    m_frames.Submit(CmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.swapchainCount     = 1;
     presentInfo.pSwapchains        = &m_swapChainKHR;
     presentInfo.pImageIndices      = &ImageIndex;
-    
-    res = vkQueuePresentKHR(m_queue, &presentInfo);    
+    presentInfo.pWaitSemaphores    = &RenderCompleteSem;
+    presentInfo.waitSemaphoreCount = 1;
+
+    res = vkQueuePresentKHR(m_queue, &presentInfo);
     CHECK_VULKAN_ERROR("vkQueuePresentKHR error %d\n" , res);
+
+    m_frames.EndFrame();
 }
 
 
@@ -229,8 +214,7 @@ void OgldevVulkanApp::Init()
     vkGetDeviceQueue(m_core.GetDevice(), m_core.GetQueueFamily(), 0, &m_queue);
 
     CreateSwapChain();
-    CreateCommandBuffer();
-    RecordCommandBuffers();
+    CreateFramesInFlight();
 }
 
 
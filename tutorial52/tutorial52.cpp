@@ -33,6 +33,7 @@
 #include "ogldev_app.h"
 #include "ogldev_util.h"
 #include "ogldev_vulkan_core.h"
+#include "ogldev_vulkan_frames.h"
 
 #include "ogldev_xcb_control.h"
 
@@ -62,12 +63,12 @@ public:
 private:
 
     void CreateSwapChain();
-    void CreateCommandBuffer();
+    void CreateFramesInFlight();
     void CreateRenderPass();
     void CreateFramebuffer();
     void CreateShaders();
     void CreatePipeline();
-    void RecordCommandBuffers();
+    void RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex);
     void RenderScene();
 
     std::string m_appName;
@@ -76,8 +77,7 @@ private:
     std::vector<VkImage> m_images;
     VkSwapchainKHR m_swapChainKHR;
     VkQueue m_queue;
-    std::vector<VkCommandBuffer> m_cmdBufs;
-    VkCommandPool m_cmdBufPool;
+    VulkanFramesInFlight m_frames;
     std::vector<VkImageView> m_views;	
     VkRenderPass m_renderPass;
     std::vector<VkFramebuffer> m_fbs;
@@ -139,55 +139,34 @@ void OgldevVulkanApp::CreateSwapChain()
 
     m_images.resize(NumSwapChainImages);
     m_views.resize(NumSwapChainImages);
-    m_cmdBufs.resize(NumSwapChainImages);
     
     res = vkGetSwapchainImagesKHR(m_core.GetDevice(), m_swapChainKHR, &NumSwapChainImages, &(m_images[0]));
     CHECK_VULKAN_ERROR("vkGetSwapchainImagesKHR error %d\n", res);
 }
 
 
-void OgldevVulkanApp::CreateCommandBuffer()
+void OgldevVulkanApp::CreateFramesInFlight()
 {
-    VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
-    cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    cmdPoolCreateInfo.queueFamilyIndex = m_core.GetQueueFamily();
-    
-    VkResult res = vkCreateCommandPool(m_core.GetDevice(), &cmdPoolCreateInfo, NULL, &m_cmdBufPool);    
-    CHECK_VULKAN_ERROR("vkCreateCommandPool error %d\n", res);
-    
-    printf("Command buffer pool created\n");
-    
-    VkCommandBufferAllocateInfo cmdBufAllocInfo = {};
-    cmdBufAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cmdBufAllocInfo.commandPool = m_cmdBufPool;
-    cmdBufAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    cmdBufAllocInfo.commandBufferCount = m_images.size();
-    
-    res = vkAllocateCommandBuffers(m_core.GetDevice(), &cmdBufAllocInfo, &m_cmdBufs[0]);            
-    CHECK_VULKAN_ERROR("vkAllocateCommandBuffers error %d\n", res);
-    
-    printf("Created command buffers\n");
+    // Two frames so the CPU can get one frame ahead of the GPU
+    m_frames.Init(&m_core, m_queue, 2, m_images.size());
 }
 
 
-void OgldevVulkanApp::RecordCommandBuffers() 
+void OgldevVulkanApp::RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex)
 {
+    // Recorded every frame into the command buffer of the frame slot
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-    
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
     VkClearColorValue clearColor = { 164.0f/256.0f, 30.0f/256.0f, 34.0f/256.0f, 0.0f };
     VkClearValue clearValue = {};
     clearValue.color = clearColor;
-    
-    VkImageSubresourceRange imageRange = {};
-    imageRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    imageRange.levelCount = 1;
-    imageRange.layerCount = 1;
-    
+
     VkRenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = m_renderPass;   
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = m_fbs[ImageIndex];
     renderPassInfo.renderArea.offset.x = 0;
     renderPassInfo.renderArea.offset.y = 0;
     renderPassInfo.renderArea.extent.width = WINDOW_WIDTH;
@@ -200,61 +179,64 @@ void OgldevVulkanApp::RecordCommandBuffers()
     viewport.width = (float)WINDOW_WIDTH;
     viewport.minDepth = (float)0.0f;
     viewport.maxDepth = (float)1.0f;
-        
+
     VkRect2D scissor = { 0 };
     scissor.extent.width = WINDOW_WIDTH;
     scissor.extent.height = WINDOW_HEIGHT;
     scissor.offset.x = 0;
     scissor.offset.y = 0;
 
-    for (uint i = 0 ; i < m_cmdBufs.size() ; i++) {            
-        VkResult res = vkBeginCommandBuffer(m_cmdBufs[i], &beginInfo);
-        CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
-        renderPassInfo.framebuffer = m_fbs[i];
+    VkResult res = vkBeginCommandBuffer(CmdBuf, &beginInfo);
+    CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
 
-        vkCmdBeginRenderPass(m_cmdBufs[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(CmdBuf, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(m_cmdBufs[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
-        
-        vkCmdSetViewport(m_cmdBufs[i], 0, 1, &viewport);
+    vkCmdBindPipeline(CmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
 
-        vkCmdSetScissor(m_cmdBufs[i], 0, 1, &scissor);
+    vkCmdSetViewport(CmdBuf, 0, 1, &viewport);
 
-        vkCmdDraw(m_cmdBufs[i], 3, 1, 0, 0);
-        
-        vkCmdEndRenderPass(m_cmdBufs[i]);
-               
-        res = vkEndCommandBuffer(m_cmdBufs[i]);
-        CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
-    }
-    
-    printf("Command buffers recorded\n");    
+    vkCmdSetScissor(CmdBuf, 0, 1, &scissor);
+
+    vkCmdDraw(CmdBuf, 3, 1, 0, 0);
+
+    vkCmdEndRenderPass(CmdBuf);
+
+    res = vkEndCommandBuffer(CmdBuf);
+    CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
 }
 
 
 void OgldevVulkanApp::RenderScene()
 {
+    VkCommandBuffer CmdBuf = m_frames.BeginFrame();
+
+    VkSemaphore ImageAvailableSem = m_frames.GetImageAvailableSem();
+
     uint ImageIndex = 0;
-    
-    VkResult res = vkAcquireNextImageKHR(m_core.GetDevice(), m_swapChainKHR, UINT64_MAX, NULL, NULL, &ImageIndex);
+
+    VkResult res = vkAcquireNextImageKHR(m_core.GetDevice(), m_swapChainKHR, UINT64_MAX, ImageAvailableSem, NULL, &ImageIndex);
     CHECK_VULKAN_ERROR("vkAcquireNextImageKHR error %d\n" , res);
-   
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount   = 1;
-    submitInfo.pCommandBuffers      = &m_cmdBufs[ImageIndex];
-    
-    res = vkQueueSubmit(m_queue, 1, &submitInfo, NULL);    
-    CHECK_VULKAN_ERROR("vkQueueSubmit error %d\n", res);
-    
+
+    m_frames.WaitForImage(ImageIndex);
+
+    VkSemaphore RenderCompleteSem = m_frames.GetRenderCompleteSem(ImageIndex);
+
+    RecordCommandBuffer(CmdBuf, ImageIndex);
+
+    m_frames.Submit(CmdBuf);
+
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.swapchainCount     = 1;
     presentInfo.pSwapchains        = &m_swapChainKHR;
     presentInfo.pImageIndices      = &ImageIndex;
-    
-    res = vkQueuePresentKHR(m_queue, &presentInfo);    
+    presentInfo.pWaitSemaphores    = &RenderCompleteSem;
+    presentInfo.waitSemaphoreCount = 1;
+
+    res = vkQueuePresentKHR(m_queue, &presentInfo);
     CHECK_VULKAN_ERROR("vkQueuePresentKHR error %d\n" , res);
+
+    m_frames.EndFrame();
 }
 
 
@@ -413,7 +395,7 @@ void OgldevVulkanApp::CreatePipeline()
     pipelineInfo.renderPass = m_renderPass;
     pipelineInfo.basePipelineIndex = -1;
     
-    VkResult res = vkCreateGraphicsPipelines(m_core.GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &m_pipeline);
+    VkResult res = vkCreateGraphicsPipelines(m_core.GetDevice(), m_core.GetPipelineCache(), 1, &pipelineInfo, NULL, &m_pipeline);
     CHECK_VULKAN_ERROR("vkCreateGraphicsPipelines error %d\n", res);
     
     printf("Graphics pipeline created\n");
@@ -434,12 +416,11 @@ void OgldevVulkanApp::Init()
     vkGetDeviceQueue(m_core.GetDevice(), m_core.GetQueueFamily(), 0, &m_queue);
 
     CreateSwapChain();
-    CreateCommandBuffer();
+    CreateFramesInFlight();
     CreateRenderPass();
     CreateFramebuffer();
     CreateShaders();
     CreatePipeline();
-    RecordCommandBuffers();    
 }
 
 
@@ -33,6 +33,7 @@
 #include "ogldev_app.h"
 #include "ogldev_util.h"
 #include "ogldev_vulkan_core.h"
+#include "ogldev_vulkan_frames.h"
 #include "ogldev_math_3d.h"
 #include "ogldev_xcb_control.h"
 
@@ -62,13 +63,12 @@ public:
 private:
 
     void CreateSwapChain();
-    void CreateCommandBuffer();
     void CreateRenderPass();
     void CreateFramebuffer();
     void CreateShaders();
     void CreatePipeline();
-    void RecordCommandBuffers();
-    void CreateSemaphores();
+    void RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex);
+    void CreateFramesInFlight();
     void RenderScene();
 
     std::string m_appName;
@@ -77,8 +77,6 @@ private:
     std::vector<VkImage> m_images;
     VkSwapchainKHR m_swapChainKHR;
     VkQueue m_queue;
-    std::vector<VkCommandBuffer> m_cmdBufs;
-    VkCommandPool m_cmdBufPool;
     std::vector<VkImageView> m_views;	
     VkRenderPass m_renderPass;
     std::vector<VkFramebuffer> m_fbs;
@@ -86,8 +84,7 @@ private:
     VkShaderModule m_fsModule;
     VkPipeline m_pipeline;
     VkPipelineLayout m_pipelineLayout;
-    VkSemaphore m_presentCompleteSem;
-    VkSemaphore m_renderCompleteSem;
+    VulkanFramesInFlight m_frames;
 };
 
 
@@ -142,55 +139,27 @@ void OgldevVulkanApp::CreateSwapChain()
 
     m_images.resize(NumSwapChainImages);
     m_views.resize(NumSwapChainImages);
-    m_cmdBufs.resize(NumSwapChainImages);
     
     res = vkGetSwapchainImagesKHR(m_core.GetDevice(), m_swapChainKHR, &NumSwapChainImages, &(m_images[0]));
     CHECK_VULKAN_ERROR("vkGetSwapchainImagesKHR error %d\n", res);
 }
 
 
-void OgldevVulkanApp::CreateCommandBuffer()
-{
-    VkCommandPoolCreateInfo cmdPoolCreateInfo = {};
-    cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    cmdPoolCreateInfo.queueFamilyIndex = m_core.GetQueueFamily();
-
-    VkResult res = vkCreateCommandPool(m_core.GetDevice(), &cmdPoolCreateInfo, NULL, &m_cmdBufPool);    
-    CHECK_VULKAN_ERROR("vkCreateCommandPool error %d\n", res);
-    
-    printf("Command buffer pool created\n");
-    
-    VkCommandBufferAllocateInfo cmdBufAllocInfo = {};
-    cmdBufAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cmdBufAllocInfo.commandPool = m_cmdBufPool;
-    cmdBufAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    cmdBufAllocInfo.commandBufferCount = m_images.size();
-    
-    res = vkAllocateCommandBuffers(m_core.GetDevice(), &cmdBufAllocInfo, &m_cmdBufs[0]);            
-    CHECK_VULKAN_ERROR("vkAllocateCommandBuffers error %d\n", res);
-    
-    printf("Created command buffers\n");
-}
-
-
-void OgldevVulkanApp::RecordCommandBuffers() 
+void OgldevVulkanApp::RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex)
 {
+    // Recorded every frame into the command buffer of the frame slot
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-    
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
     VkClearColorValue clearColor = { 164.0f/256.0f, 30.0f/256.0f, 34.0f/256.0f, 0.0f };
     VkClearValue clearValue = {};
     clearValue.color = clearColor;
-    
-    VkImageSubresourceRange imageRange = {};
-    imageRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    imageRange.levelCount = 1;
-    imageRange.layerCount = 1;
-    
+
     VkRenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = m_renderPass;   
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = m_fbs[ImageIndex];
     renderPassInfo.renderArea.offset.x = 0;
     renderPassInfo.renderArea.offset.y = 0;
     renderPassInfo.renderArea.extent.width = WINDOW_WIDTH;
@@ -198,58 +167,53 @@ void OgldevVulkanApp::RecordCommandBuffers()
     renderPassInfo.clearValueCount = 1;
     renderPassInfo.pClearValues = &clearValue;
 
-    for (uint i = 0 ; i < m_cmdBufs.size() ; i++) {            
-        VkResult res = vkBeginCommandBuffer(m_cmdBufs[i], &beginInfo);
-        CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
-        renderPassInfo.framebuffer = m_fbs[i];
+    VkResult res = vkBeginCommandBuffer(CmdBuf, &beginInfo);
+    CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
 
-        vkCmdBeginRenderPass(m_cmdBufs[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(CmdBuf, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(m_cmdBufs[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
-        
-        vkCmdDraw(m_cmdBufs[i], 3, 1, 0, 0);
-        
-        vkCmdEndRenderPass(m_cmdBufs[i]);
-               
-        res = vkEndCommandBuffer(m_cmdBufs[i]);
-        CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
-    }
-    
-    printf("Command buffers recorded\n");    
+    vkCmdBindPipeline(CmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+
+    vkCmdDraw(CmdBuf, 3, 1, 0, 0);
+
+    vkCmdEndRenderPass(CmdBuf);
+
+    res = vkEndCommandBuffer(CmdBuf);
+    CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
 }
 
 
 void OgldevVulkanApp::RenderScene()
 {
+    VkCommandBuffer CmdBuf = m_frames.BeginFrame();
+
+    VkSemaphore ImageAvailableSem = m_frames.GetImageAvailableSem();
+
     uint ImageIndex = 0;
-    
-    VkResult res = vkAcquireNextImageKHR(m_core.GetDevice(), m_swapChainKHR, UINT64_MAX, m_presentCompleteSem, NULL, &ImageIndex);
+
+    VkResult res = vkAcquireNextImageKHR(m_core.GetDevice(), m_swapChainKHR, UINT64_MAX, ImageAvailableSem, NULL, &ImageIndex);
     CHECK_VULKAN_ERROR("vkAcquireNextImageKHR error %d\n" , res);
-   
-    VkPipelineStageFlags waitFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount   = 1;
-    submitInfo.pCommandBuffers      = &m_cmdBufs[ImageIndex];
-    submitInfo.pWaitSemaphores      = &m_presentCompleteSem;  
-    submitInfo.waitSemaphoreCount   = 1;
-    submitInfo.pWaitDstStageMask    = &waitFlags;
-    submitInfo.pSignalSemaphores    = &m_renderCompleteSem;
-    submitInfo.signalSemaphoreCount = 1;
-    
-    res = vkQueueSubmit(m_queue, 1, &submitInfo, NULL);    
-    CHECK_VULKAN_ERROR("vkQueueSubmit error %d\n", res);
-    
+
+    m_frames.WaitForImage(ImageIndex);
+
+    VkSemaphore RenderCompleteSem = m_frames.GetRenderCompleteSem(ImageIndex);
+
+    RecordCommandBuffer(CmdBuf, ImageIndex);
+
+    m_frames.Submit(CmdBuf);
+
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.swapchainCount     = 1;
     presentInfo.pSwapchains        = &m_swapChainKHR;
     presentInfo.pImageIndices      = &ImageIndex;
-    presentInfo.pWaitSemaphores    = &m_renderCompleteSem;
+    presentInfo.pWaitSemaphores    = &RenderCompleteSem;
     presentInfo.waitSemaphoreCount = 1;
-    
-    res = vkQueuePresentKHR(m_queue, &presentInfo);    
+
+    res = vkQueuePresentKHR(m_queue, &presentInfo);
     CHECK_VULKAN_ERROR("vkQueuePresentKHR error %d\n" , res);
+
+    m_frames.EndFrame();
 }
 
 
@@ -341,10 +305,10 @@ void OgldevVulkanApp::CreateShaders()
 }
 
 
-void OgldevVulkanApp::CreateSemaphores() 
+void OgldevVulkanApp::CreateFramesInFlight()
 {
-    m_presentCompleteSem = m_core.CreateSemaphore();
-    m_renderCompleteSem = m_core.CreateSemaphore();
+    // Two frames so the CPU can get one frame ahead of the GPU
+    m_frames.Init(&m_core, m_queue, 2, m_images.size());
 }
 
 
@@ -431,7 +395,7 @@ void OgldevVulkanApp::CreatePipeline()
     pipelineInfo.renderPass = m_renderPass;
     pipelineInfo.basePipelineIndex = -1;
     
-    res = vkCreateGraphicsPipelines(m_core.GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &m_pipeline);
+    res = vkCreateGraphicsPipelines(m_core.GetDevice(), m_core.GetPipelineCache(), 1, &pipelineInfo, NULL, &m_pipeline);
     CHECK_VULKAN_ERROR("vkCreateGraphicsPipelines error %d\n", res);
     
     printf("Graphics pipeline created\n");
@@ -452,13 +416,11 @@ void OgldevVulkanApp::Init()
     vkGetDeviceQueue(m_core.GetDevice(), m_core.GetQueueFamily(), 0, &m_queue);
 
     CreateSwapChain();    
-    CreateCommandBuffer();
     CreateRenderPass();
     CreateFramebuffer();
     CreateShaders();
     CreatePipeline();
-    CreateSemaphores();
-    RecordCommandBuffers();    
+    CreateFramesInFlight();
 }
 
 
@@ -33,6 +33,8 @@
 #include "ogldev_app.h"
 #include "ogldev_util.h"
 #include "ogldev_vulkan_core.h"
+#include "ogldev_vulkan_frames.h"
+#include "ogldev_vulkan_memory.h"
 #include "ogldev_math_3d.h"
 #include "ogldev_xcb_control.h"
 
@@ -69,8 +71,8 @@ private:
     void CreateVertexBuffer();
     void CreateShaders();
     void CreatePipeline();
-    void RecordCommandBuffers();
-    void CreateSemaphores();
+    void RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex);
+    void CreateFramesInFlight();
     void RenderScene();
 
     std::string m_appName;
@@ -79,7 +81,6 @@ private:
     std::vector<VkImage> m_images;
     VkSwapchainKHR m_swapChainKHR;
     VkQueue m_queue;
-    std::vector<VkCommandBuffer> m_cmdBufs;
     VkCommandBuffer m_copyCmdBuf;
     VkCommandPool m_cmdBufPool;
     std::vector<VkImageView> m_views;
@@ -89,19 +90,37 @@ private:
     VkShaderModule m_fsModule;
     VkPipeline m_pipeline;
     VkPipelineLayout m_pipelineLayout;
-    VkSemaphore m_presentCompleteSem;
-    VkSemaphore m_renderCompleteSem;
+    VulkanFramesInFlight m_frames;
+    VulkanMemoryAllocator m_memAllocator;
+    VulkanStagingRing m_stagingRing;
+    VkBuffer m_vb;
+    VulkanAllocation m_vbAlloc;
 };
 
 
 OgldevVulkanApp::OgldevVulkanApp(const char* pAppName) : m_core(pAppName)
 {
     m_appName = std::string(pAppName);
+    m_vb = VK_NULL_HANDLE;
 }
 
 
 OgldevVulkanApp::~OgldevVulkanApp()
 {
+    // The GPU must be done with the vertex buffer and the staging space
+    // before they go back to the allocator, and both must be freed before
+    // the allocator releases its blocks
+    if (m_vb == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkDeviceWaitIdle(m_core.GetDevice());
+
+    m_memAllocator.DestroyBuffer(m_vb, m_vbAlloc);
+    m_vb = VK_NULL_HANDLE;
+
+    m_stagingRing.Destroy();
+    m_memAllocator.Destroy();
 }
 
 
@@ -146,7 +165,6 @@ void OgldevVulkanApp::CreateSwapChain()
 
     m_images.resize(NumSwapChainImages);
     m_views.resize(NumSwapChainImages);
-    m_cmdBufs.resize(NumSwapChainImages);
 
     res = vkGetSwapchainImagesKHR(m_core.GetDevice(), m_swapChainKHR, &NumSwapChainImages, &(m_images[0]));
     CHECK_VULKAN_ERROR("vkGetSwapchainImagesKHR error %d\n", res);
@@ -179,29 +197,26 @@ void OgldevVulkanApp::CreateCommandBuffers()
 
     printf("Command buffer pool created\n");
 
-    CreateCommandBufferInternal(m_images.size(), &m_cmdBufs[0]);
+    // The frames in flight own the command buffers of the render loop
     CreateCommandBufferInternal(1, &m_copyCmdBuf);
 }
 
 
-void OgldevVulkanApp::RecordCommandBuffers()
+void OgldevVulkanApp::RecordCommandBuffer(VkCommandBuffer CmdBuf, uint ImageIndex)
 {
+    // Recorded every frame into the command buffer of the frame slot
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     VkClearColorValue clearColor = { 164.0f/256.0f, 30.0f/256.0f, 34.0f/256.0f, 0.0f };
     VkClearValue clearValue = {};
     clearValue.color = clearColor;
 
-    VkImageSubresourceRange imageRange = {};
-    imageRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    imageRange.levelCount = 1;
-    imageRange.layerCount = 1;
-
     VkRenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = m_fbs[ImageIndex];
     renderPassInfo.renderArea.offset.x = 0;
     renderPassInfo.renderArea.offset.y = 0;
     renderPassInfo.renderArea.extent.width = WINDOW_WIDTH;
@@ -209,58 +224,53 @@ void OgldevVulkanApp::RecordCommandBuffers()
     renderPassInfo.clearValueCount = 1;
     renderPassInfo.pClearValues = &clearValue;
 
-    for (uint i = 0 ; i < m_cmdBufs.size() ; i++) {
-        VkResult res = vkBeginCommandBuffer(m_cmdBufs[i], &beginInfo);
-        CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
-        renderPassInfo.framebuffer = m_fbs[i];
+    VkResult res = vkBeginCommandBuffer(CmdBuf, &beginInfo);
+    CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
 
-        vkCmdBeginRenderPass(m_cmdBufs[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(CmdBuf, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(m_cmdBufs[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    vkCmdBindPipeline(CmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
 
-        vkCmdDraw(m_cmdBufs[i], 3, 1, 0, 0);
+    vkCmdDraw(CmdBuf, 3, 1, 0, 0);
 
-        vkCmdEndRenderPass(m_cmdBufs[i]);
+    vkCmdEndRenderPass(CmdBuf);
 
-        res = vkEndCommandBuffer(m_cmdBufs[i]);
-        CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
-    }
-
-    printf("Command buffers recorded\n");
+    res = vkEndCommandBuffer(CmdBuf);
+    CHECK_VULKAN_ERROR("vkEndCommandBuffer error %d\n", res);
 }
 
 
 void OgldevVulkanApp::RenderScene()
 {
+    VkCommandBuffer CmdBuf = m_frames.BeginFrame();
+
+    VkSemaphore ImageAvailableSem = m_frames.GetImageAvailableSem();
+
     uint ImageIndex = 0;
 
-    VkResult res = vkAcquireNextImageKHR(m_core.GetDevice(), m_swapChainKHR, UINT64_MAX, m_presentCompleteSem, NULL, &ImageIndex);
+    VkResult res = vkAcquireNextImageKHR(m_core.GetDevice(), m_swapChainKHR, UINT64_MAX, ImageAvailableSem, NULL, &ImageIndex);
     CHECK_VULKAN_ERROR("vkAcquireNextImageKHR error %d\n" , res);
 
-    VkPipelineStageFlags waitFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount   = 1;
-    submitInfo.pCommandBuffers      = &m_cmdBufs[ImageIndex];
-    submitInfo.pWaitSemaphores      = &m_presentCompleteSem;
-    submitInfo.waitSemaphoreCount   = 1;
-    submitInfo.pWaitDstStageMask    = &waitFlags;
-    submitInfo.pSignalSemaphores    = &m_renderCompleteSem;
-    submitInfo.signalSemaphoreCount = 1;
+    m_frames.WaitForImage(ImageIndex);
 
-    res = vkQueueSubmit(m_queue, 1, &submitInfo, NULL);
-    CHECK_VULKAN_ERROR("vkQueueSubmit error %d\n", res);
+    VkSemaphore RenderCompleteSem = m_frames.GetRenderCompleteSem(ImageIndex);
+
+    RecordCommandBuffer(CmdBuf, ImageIndex);
+
+    m_frames.Submit(CmdBuf);
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.swapchainCount     = 1;
     presentInfo.pSwapchains        = &m_swapChainKHR;
     presentInfo.pImageIndices      = &ImageIndex;
-    presentInfo.pWaitSemaphores    = &m_renderCompleteSem;
+    presentInfo.pWaitSemaphores    = &RenderCompleteSem;
     presentInfo.waitSemaphoreCount = 1;
 
     res = vkQueuePresentKHR(m_queue, &presentInfo);
     CHECK_VULKAN_ERROR("vkQueuePresentKHR error %d\n" , res);
+
+    m_frames.EndFrame();
 }
 
 
@@ -350,64 +360,36 @@ void OgldevVulkanApp::CreateVertexBuffer()
 
     size_t verticesSize = sizeof(Vertices);
 
-    VkBufferCreateInfo vbCreateInfo = {};
-    vbCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    vbCreateInfo.size = verticesSize;
-    vbCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    VkBuffer stagingVB;
-    VkResult res = vkCreateBuffer(m_core.GetDevice(), &vbCreateInfo, NULL, &stagingVB);
-    CHECK_VULKAN_ERROR("vkCreateBuffer error %d\n", res);
-    printf("Create vertex buffer\n");
+    m_memAllocator.Init(&m_core);
+    m_stagingRing.Init(&m_core, &m_memAllocator, 4 * 1024 * 1024);
 
-    VkMemoryRequirements memReqs = {};
-    vkGetBufferMemoryRequirements(m_core.GetDevice(), stagingVB, &memReqs);
-    printf("Vertex buffer requires %lu bytes\n", memReqs.size);
-
-    VkMemoryAllocateInfo memAllocInfo = {};
-    memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memAllocInfo.allocationSize = memReqs.size;
-    memAllocInfo.memoryTypeIndex = m_core.GetMemoryTypeIndex(memReqs.memoryTypeBits,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    printf("Memory type index %d\n",memAllocInfo.memoryTypeIndex);
-
-    VkDeviceMemory stagingDevMem;
-    res = vkAllocateMemory(m_core.GetDevice(), &memAllocInfo, NULL, &stagingDevMem);
-    CHECK_VULKAN_ERROR("vkAllocateMemory error %d\n", res);
-    res = vkBindBufferMemory(m_core.GetDevice(), stagingVB, stagingDevMem, 0);
-    CHECK_VULKAN_ERROR("vkBindBufferMemory error %d\n", res);
-
-    void* mappedMemAddr = NULL;
-    res = vkMapMemory(m_core.GetDevice(), stagingDevMem, 0, memAllocInfo.allocationSize, 0, &mappedMemAddr);
-    memcpy(mappedMemAddr, &Vertices[0], verticesSize);
-    vkUnmapMemory(m_core.GetDevice(), stagingDevMem);
-
-    VkBuffer vb;
-    vbCreateInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-    res = vkCreateBuffer(m_core.GetDevice(), &vbCreateInfo, NULL, &vb);
-    CHECK_VULKAN_ERROR("vkCreateBuffer error %d\n", res);
-
-    vkGetBufferMemoryRequirements(m_core.GetDevice(), vb, &memReqs);
-    printf("Vertex buffer requires %lu bytes\n", memReqs.size);
-    memAllocInfo.allocationSize = memReqs.size;
-    memAllocInfo.memoryTypeIndex = m_core.GetMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    printf("Memory type index %d\n",memAllocInfo.memoryTypeIndex);
-
-    VkDeviceMemory devMem;
-    res = vkAllocateMemory(m_core.GetDevice(), &memAllocInfo, NULL, &devMem);
-    CHECK_VULKAN_ERROR("vkAllocateMemory error %d\n", res);
-    res = vkBindBufferMemory(m_core.GetDevice(), vb, devMem, 0);
-    CHECK_VULKAN_ERROR("vkBindBufferMemory error %d\n", res);
+    m_vb = m_memAllocator.CreateBuffer(verticesSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vbAlloc);
+    printf("Create vertex buffer\n");
 
     VkCommandBufferBeginInfo cmdBufBeginInfo = {};
     cmdBufBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cmdBufBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    res = vkBeginCommandBuffer(m_copyCmdBuf, &cmdBufBeginInfo);
+    VkResult res = vkBeginCommandBuffer(m_copyCmdBuf, &cmdBufBeginInfo);
     CHECK_VULKAN_ERROR("vkBeginCommandBuffer error %d\n", res);
 
-    VkBufferCopy bufferCopy = {};
-    bufferCopy.size = verticesSize;
-    vkCmdCopyBuffer(m_copyCmdBuf, stagingVB, vb, 1, &bufferCopy);
+    m_stagingRing.CopyToBuffer(m_copyCmdBuf, &Vertices[0], verticesSize, m_vb);
 
     vkEndCommandBuffer(m_copyCmdBuf);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &m_copyCmdBuf;
+
+    res = vkQueueSubmit(m_queue, 1, &submitInfo, NULL);
+    CHECK_VULKAN_ERROR("vkQueueSubmit error %d\n", res);
+
+    // The staging space is recycled once the copy is done
+    m_stagingRing.Submit(m_queue);
+
+    m_memAllocator.PrintStats();
 }
 
 
@@ -421,10 +403,10 @@ void OgldevVulkanApp::CreateShaders()
 }
 
 
-void OgldevVulkanApp::CreateSemaphores()
+void OgldevVulkanApp::CreateFramesInFlight()
 {
-    m_presentCompleteSem = m_core.CreateSemaphore();
-    m_renderCompleteSem = m_core.CreateSemaphore();
+    // Two frames so the CPU can get one frame ahead of the GPU
+    m_frames.Init(&m_core, m_queue, 2, m_images.size());
 }
 
 
@@ -529,7 +511,7 @@ void OgldevVulkanApp::CreatePipeline()
     pipelineInfo.renderPass = m_renderPass;
     pipelineInfo.basePipelineIndex = -1;
 
-    res = vkCreateGraphicsPipelines(m_core.GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &m_pipeline);
+    res = vkCreateGraphicsPipelines(m_core.GetDevice(), m_core.GetPipelineCache(), 1, &pipelineInfo, NULL, &m_pipeline);
     CHECK_VULKAN_ERROR("vkCreateGraphicsPipelines error %d\n", res);
 
     printf("Graphics pipeline created\n");
@@ -556,8 +538,7 @@ void OgldevVulkanApp::Init()
     CreateVertexBuffer();
     CreateShaders();
     CreatePipeline();
-    CreateSemaphores();
-    RecordCommandBuffers();
+    CreateFramesInFlight();
 }
 
 